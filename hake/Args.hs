@@ -29,6 +29,7 @@ data Args = Args {
       flounderExtraBindings :: [(String, [String])], -- build stubs for specific backends
       flounderTHCDefs :: [String], -- TODO: this can probably be subsumed into the above?
       flounderTHCStubs :: [String], -- TODO: this can probably be subsumed into the above?
+      flounderCxxDefs :: [String], -- C++ binding headers used by cxxFiles
       mackerelDevices :: [String],
       addCFlags :: [String],
       addCxxFlags :: [String],
@@ -58,6 +59,7 @@ defaultArgs = Args {
       flounderExtraBindings = [],
       flounderTHCDefs = [],
       flounderTHCStubs = [],
+      flounderCxxDefs = [],
       mackerelDevices = [],
       addCFlags = [],
       addCxxFlags = [],
@@ -102,6 +104,7 @@ showArgs prefix a =
     ++ "\n  flounderExtraBindings: " ++ (show $ flounderExtraBindings a)
     ++ "\n  flounderTHCDefs:       " ++ (show $ flounderTHCDefs a)
     ++ "\n  flounderTHCStubs:      " ++ (show $ flounderTHCStubs a)
+    ++ "\n  flounderCxxDefs:       " ++ (show $ flounderCxxDefs a)
     ++ "\n  addCFlags:             " ++ (show $ addCFlags a)
     ++ "\n  addCxxFlags:           " ++ (show $ addCxxFlags a)
     ++ "\n  omitCFlags:            " ++ (show $ omitCFlags a)
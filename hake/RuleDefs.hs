@@ -572,6 +572,8 @@ flounderTHCHdrPath ifn = "/include/if" </> (ifn ++ "_thc.h")
 flounderTHCStubPath opts ifn =
     (optSuffix opts) </> (ifn ++ "_thc.c")
 
+flounderCxxHdrPath ifn = "/include/if" </> (ifn ++ "_cxx.hpp")
+
 applicationPath name = "/sbin" </> name
 libraryPath libname = "/lib" </> ("lib" ++ libname ++ ".a")
 kernelPath = "/sbin/cpu"
@@ -645,6 +647,16 @@ flounderTHCFile opts ifn =
            Out (optArch opts) (flounderTHCHdrPath ifn)
          ]
 
+--
+-- Build a Flounder C++ binding header file from a definition.
+--
+flounderCxxFile :: Options -> String -> HRule
+flounderCxxFile opts ifn =
+    flounderRule opts [
+           Str "--cxx-header", flounderIfFileLoc ifn,
+           Out (optArch opts) (flounderCxxHdrPath ifn)
+         ]
+
 --
 -- Build a Flounder THC stubs file from a definition.
 --
@@ -673,6 +685,15 @@ flounderDefsDepend opts ifn backends srcs = Rules $
     [extraCDependencies opts (flounderIfDrvDefsPath ifn drv) srcs
            | drv <- backends, drv /= "generic" ]
 
+--
+-- Create a dependency on a Flounder C++ binding header, and the C headers
+-- it includes, for a set of C++ files
+--
+flounderCxxDefsDepend :: Options -> String -> [String] -> HRule
+flounderCxxDefsDepend opts ifn srcs = Rules
+    [ extraCDependencies opts (flounderCxxHdrPath ifn) srcs,
+      flounderDefsDepend opts ifn (optFlounderBackends opts) srcs ]
+
 --
 -- Emit all the Flounder-related rules/dependencies for a given target
 --
@@ -1007,6 +1028,8 @@ appBuildArch tdb tf args arch =
         mylink = if cxxsrcs == [] then link else linkCxx
     in
       Rules ( flounderRules opts args csrcs
+              ++
+              [ flounderCxxDefsDepend opts f cxxsrcs | f <- Args.flounderCxxDefs args ]
               ++
               [ mackerelDependencies opts m csrcs | m <- Args.mackerelDevices args ]
               ++
@@ -153,6 +153,7 @@ TESTS_k1om= \
 BENCH_COMMON= \
 	sbin/channel_cost_bench \
 	sbin/flounder_stubs_buffer_bench \
+	sbin/flounder_stubs_bulk_bench \
 	sbin/flounder_stubs_empty_bench \
 	sbin/flounder_stubs_payload_bench \
 	sbin/xcorecapbench
@@ -179,6 +180,7 @@ BENCH_x86_64= \
 	sbin/apicdrift_bench \
 	sbin/benchmarks/bomp_mm \
 	sbin/benchmarks/dma_bench \
+	sbin/benchmarks/nameservice_cache_bench \
 	sbin/benchmarks/xomp_share \
 	sbin/benchmarks/xomp_spawn \
 	sbin/benchmarks/xomp_work \
@@ -270,6 +272,7 @@ MODULES_x86_64= \
 	sbin/webserver \
 	sbin/routing_setup \
 	sbin/bcached \
+	sbin/pagecached \
 	sbin/xeon_phi_mgr \
 	sbin/xeon_phi \
 	sbin/dma_mgr \
@@ -41,6 +41,7 @@ errval_t cap_retype(struct capref dest_start, struct capref src,
 errval_t cap_create(struct capref dest, enum objtype type, uint8_t size_bits);
 errval_t cap_delete(struct capref cap);
 errval_t cap_revoke(struct capref cap);
+errval_t cap_revoke_multi(struct capref *caps, size_t count);
 struct cspace_allocator;
 errval_t cap_destroy(struct capref cap);
 
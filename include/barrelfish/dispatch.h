@@ -63,6 +63,19 @@ void disp_arch_init(dispatcher_handle_t handle);
  */
 void disp_resume(dispatcher_handle_t handle, arch_registers_state_t *archregs);
 
+#ifdef __x86_64__
+/**
+ * \brief Resume execution of a given register state, staying disabled
+ *
+ * This resumes disabled code from the trap save area after a page fault taken
+ * while disabled has been fixed up. It may only be called while the dispatcher
+ * is disabled.
+ *
+ * \param regs Register state snapshot
+ */
+void disp_resume_disabled(arch_registers_state_t *archregs);
+#endif
+
 /**
  * \brief Switch execution between two register states, and turn off
  * disabled activations.
@@ -16,6 +16,7 @@
 #define LIBBARRELFISH_EXCEPT_H
 
 #include <sys/cdefs.h>
+#include <stdbool.h>
 #include <barrelfish_kpi/registers_arch.h>
 
 __BEGIN_DECLS
@@ -58,6 +59,27 @@ errval_t thread_set_exception_handler(exception_handler_fn newhandler,
                                       void *new_stack_base, void *new_stack_top,
                                       void **old_stack_base, void **old_stack_top);
 
+/**
+ * \brief Page fault fixup function
+ *
+ * \param addr     Fault address
+ * \param subtype  Page fault type
+ * \param disabled true if the fault was taken while disabled, so no other
+ *                 thread of the dispatcher can run until the access succeeds
+ *
+ * \return true if the fault was fixed up and the faulting access should be
+ * retried, false to deliver the fault to the thread as usual.
+ *
+ * The fixup runs on the dispatcher stack while the dispatcher is disabled, on
+ * whichever core of the domain took the fault, also for faults taken while
+ * disabled. It must not block, allocate memory, or use the FPU.
+ */
+typedef bool (*pagefault_fixup_fn)(void *addr,
+                                   enum pagefault_exception_type subtype,
+                                   bool disabled);
+
+pagefault_fixup_fn disp_set_pagefault_fixup(pagefault_fixup_fn fixup);
+
 __END_DECLS
 
 #endif
@@ -29,12 +29,19 @@ enum memobj_type {
     ONE_FRAME_ONE_MAP,
     MEMOBJ_VFS, // see lib/vfs/mmap.c
     MEMOBJ_FIXED,
-    MEMOBJ_NUMA
+    MEMOBJ_NUMA,
+    MEMOBJ_PAGECACHE
 };
 
 typedef uint32_t memobj_flags_t;
 typedef uint32_t vs_prot_flags_t;
 
+/// memobj_anon: back offsets that were not filled with zeroed frames on demand
+#define MEMOBJ_ANON_DEMAND_ZERO     0x1
+
+/// Default number of pages allocated per demand-zero page fault
+#define MEMOBJ_ANON_FAULT_AROUND    16
+
 struct memobj;
 struct vregion;
 struct memobj_funcs {
@@ -103,6 +110,7 @@ struct memobj_frame_list {
     size_t size;                    ///< Size of the frame
     genpaddr_t pa;                  ///< XXX: physical address of frame
     genpaddr_t foffset;             ///< Offset into frame
+    bool cached;                    ///< Frame comes from the frame cache
     struct memobj_frame_list *next;
 };
 
@@ -111,7 +119,11 @@ struct memobj_anon {
     struct vregion_list *vregion_list;    ///< List of vregions mapped into the obj
     struct slab_allocator vregion_slab;       ///< Slab to back the vregion list
     struct memobj_frame_list *frame_list; ///< List of frames tracked by the obj
+    struct memobj_frame_list *frame_tail; ///< Last frame of the list
     struct slab_allocator frame_slab;         ///< Slab to back the frame list
+    size_t fault_around;                  ///< Pages allocated per demand-zero fault
+    size_t faults;                        ///< Number of page faults handled
+    size_t resident;                      ///< Bytes allocated on demand
 };
 
 /**
@@ -140,11 +152,45 @@ struct memobj_numa {
     struct capref   *frames;     ///< the tracked frames
 };
 
+/// Source of the pages of a page-cache backed memobj
+struct memobj_pagecache_ops {
+    /// Get the frame and offset holding a page, fetching it and up to
+    /// readahead following pages into the cache if it is not cached yet
+    errval_t (*get_page)(void *st, size_t page, size_t readahead,
+                         struct capref *ret_frame, genpaddr_t *ret_offset);
+    /// Get the frame and offset holding a page, only if it is cached
+    bool (*lookup_page)(void *st, size_t page, struct capref *ret_frame,
+                        genpaddr_t *ret_offset);
+};
+
+struct memobj_pagecache_map;
+
+/**
+ * this memobj can be mapped into a single vregion and maps in pages of a
+ * page cache on demand, sharing them read-only with other mappings
+ */
+struct memobj_pagecache {
+    struct memobj m;                       ///< public memobj interface
+    struct vregion *vregion;               ///< the associated vregion
+    const struct memobj_pagecache_ops *ops;///< page source
+    void *st;                              ///< argument to ops
+    size_t first_page;                     ///< page of the cache at offset 0
+    size_t npages;                         ///< pages covered by the memobj
+    struct memobj_pagecache_map *map;      ///< per-page mapping state
+    size_t next_page;                      ///< expected next sequential fault
+    size_t readahead;                      ///< current read-ahead, in pages
+    size_t faults;                         ///< number of page faults handled
+    size_t cow_faults;                     ///< faults that made a private copy
+    size_t pages_mapped;                   ///< pages mapped, incl. fault-around
+};
+
 errval_t memobj_create_pinned(struct memobj_pinned *memobj, size_t size,
                               memobj_flags_t flags);
 
 errval_t memobj_create_anon(struct memobj_anon *memobj, size_t size,
                             memobj_flags_t flags);
+errval_t memobj_create_anon_lazy(struct memobj_anon *memobj, size_t size,
+                                 memobj_flags_t flags, size_t fault_around);
 errval_t memobj_destroy_anon(struct memobj *memobj);
 
 errval_t memobj_create_one_frame(struct memobj_one_frame *memobj, size_t size,
@@ -169,6 +215,14 @@ errval_t memobj_create_numa(struct memobj_numa *numa, size_t size,
 
 errval_t memobj_destroy_numa(struct memobj *memobj);
 
+errval_t memobj_create_pagecache(struct memobj_pagecache *pc, size_t size,
+                                 memobj_flags_t flags,
+                                 const struct memobj_pagecache_ops *ops,
+                                 void *st, size_t first_page);
+errval_t memobj_destroy_pagecache(struct memobj *memobj);
+errval_t memobj_pagecache_invalidate(struct memobj_pagecache *pc,
+                                     size_t first, size_t count);
+
 __END_DECLS
 
 #endif // LIBBARRELFISH_MEMOBJ_H
@@ -0,0 +1,142 @@
+/**
+ * \file
+ * \brief Layout of the per-core name service cache
+ *
+ * The monitor of each core keeps a cache of name to IREF mappings in a frame
+ * that every domain on the core maps read-only. nameservice_lookup() probes
+ * the cache before asking the monitor, which fills it from octopus and keeps
+ * it up to date through octopus triggers.
+ *
+ * Only the monitor writes the frame. Each entry is guarded by a sequence
+ * count that is odd while the monitor updates the entry; a reader that sees
+ * an odd or changed count treats the probe as a miss rather than waiting, as
+ * the writer may be descheduled on the same core.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef BARRELFISH_NAMESERVICE_CACHE_H
+#define BARRELFISH_NAMESERVICE_CACHE_H
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/cdefs.h>
+
+#include <barrelfish/static_assert.h>
+
+__BEGIN_DECLS
+
+#define NS_CACHE_SIZE       (4 * BASE_PAGE_SIZE)  ///< Size of the cache frame
+#define NS_CACHE_ENTRIES    255     ///< Entries, after the counters line
+#define NS_CACHE_PROBE      8       ///< Entries probed for a name
+#define NS_CACHE_NAME_LEN   56      ///< Name space in an entry, incl. NUL
+
+/// Counters kept by the monitor, in the first line of the cache frame
+struct ns_cache_counters {
+    uint64_t lookups;       ///< Lookup requests from domains (cache misses)
+    uint64_t coalesced;     ///< Lookups that joined an outstanding query
+    uint64_t queries;       ///< Get queries sent to octopus
+    uint64_t fills;         ///< Entries filled from query results
+    uint64_t updates;       ///< Entries updated by set triggers
+    uint64_t invalidations; ///< Entries dropped by delete triggers
+    uint64_t evictions;     ///< Entries replaced to make room for a fill
+    uint64_t reserved;
+};
+
+struct ns_cache_entry {
+    volatile uint32_t seq;  ///< Odd while the monitor updates the entry
+    iref_t iref;            ///< Cached IREF, 0 if the entry is empty
+    char name[NS_CACHE_NAME_LEN];
+};
+
+struct ns_cache {
+    struct ns_cache_counters counters;
+    struct ns_cache_entry entries[NS_CACHE_ENTRIES];
+};
+
+STATIC_ASSERT(sizeof(struct ns_cache_entry) == 64, "ns_cache_entry size");
+STATIC_ASSERT(sizeof(struct ns_cache) <= NS_CACHE_SIZE, "ns_cache size");
+
+/**
+ * \brief Returns whether a lookup for name can be served from the cache
+ *
+ * Only plain record names fit: queries with attributes, regular expressions
+ * or variables are always sent to octopus.
+ */
+static inline bool ns_cache_name_ok(const char *name)
+{
+    if (name[0] < 'a' || name[0] > 'z') {
+        return false;
+    }
+    size_t i;
+    for (i = 1; name[i] != '\0'; i++) {
+        char c = name[i];
+        if (i == NS_CACHE_NAME_LEN - 1) {
+            return false;
+        }
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+              || (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// First entry probed for name (FNV-1a)
+static inline size_t ns_cache_hash(const char *name)
+{
+    uint32_t h = 2166136261U;
+    for (; *name != '\0'; name++) {
+        h = (h ^ (uint8_t)*name) * 16777619U;
+    }
+    return h % NS_CACHE_ENTRIES;
+}
+
+/**
+ * \brief Looks up name in the cache without blocking
+ *
+ * \param c     Cache to probe
+ * \param name  Name accepted by ns_cache_name_ok()
+ * \param iref  Returns the cached IREF on a hit
+ *
+ * \returns true on a hit, false if name is not cached or an entry it may
+ *          be in is being updated
+ */
+static inline bool ns_cache_probe(struct ns_cache *c, const char *name,
+                                  iref_t *iref)
+{
+    size_t slot = ns_cache_hash(name);
+    for (int i = 0; i < NS_CACHE_PROBE; i++) {
+        struct ns_cache_entry *e = &c->entries[(slot + i) % NS_CACHE_ENTRIES];
+
+        uint32_t seq = e->seq;
+        if (seq & 1) {
+            return false;
+        }
+        __sync_synchronize();
+        iref_t found = e->iref;
+        bool match = found != 0
+                     && strncmp(e->name, name, NS_CACHE_NAME_LEN) == 0;
+        __sync_synchronize();
+        if (e->seq != seq) {
+            return false;
+        }
+
+        if (match) {
+            *iref = found;
+            return true;
+        }
+    }
+    return false;
+}
+
+__END_DECLS
+
+#endif // BARRELFISH_NAMESERVICE_CACHE_H
@@ -14,10 +14,28 @@
 
 __BEGIN_DECLS
 
+/// Name service cache counters (see barrelfish/nameservice_cache.h)
+struct nameservice_cache_stats {
+    // this domain
+    uint64_t hits;          ///< Lookups answered from the cache
+    uint64_t misses;        ///< Lookups passed on to the monitor
+    uint64_t fallbacks;     ///< Lookups sent to octopus directly
+
+    // the monitor of this core
+    uint64_t mon_lookups;   ///< Misses of all domains
+    uint64_t mon_coalesced; ///< Misses that waited for another's query
+    uint64_t mon_queries;   ///< Queries sent to octopus
+    uint64_t mon_fills;     ///< Entries filled
+    uint64_t mon_updates;   ///< Entries changed by octopus triggers
+    uint64_t mon_invalidations; ///< Entries dropped by octopus triggers
+    uint64_t mon_evictions; ///< Entries replaced by fills
+};
+
 errval_t nameservice_lookup(const char *iface, iref_t *retiref);
 errval_t nameservice_blocking_lookup(const char *iface, iref_t *retiref);
 errval_t nameservice_register(const char *iface, iref_t iref);
 errval_t nameservice_client_blocking_bind(void);
+errval_t nameservice_cache_stats(struct nameservice_cache_stats *stats);
 
 errval_t nameservice_get_capability(const char *key, struct capref *retcap);
 errval_t nameservice_put_capability(const char *key, struct capref cap);
@@ -26,6 +26,15 @@ struct vspace_mmu_vregion_list {
     struct vspace_mmu_vregion_list *next;
 };
 
+/// Statistics of the frames mapped into a vspace_mmu_aware region
+struct vspace_mmu_aware_stats {
+    size_t huge_bytes;  ///< Bytes mapped with huge pages
+    size_t large_bytes; ///< Bytes mapped with large pages
+    size_t base_bytes;  ///< Bytes mapped with base pages
+    size_t frames;      ///< Number of frames mapped
+    size_t fallbacks;   ///< Chunks backed by smaller frames than requested
+};
+
 /// Struct to support mmu_aware memory management
 struct vspace_mmu_aware {
     size_t size;
@@ -36,6 +45,7 @@ struct vspace_mmu_aware {
     struct memobj_anon memobj;        ///< Needs just one memobj
     lvaddr_t offset;    ///< Offset of free space in anon
     lvaddr_t mapoffset; ///< Offset into the anon that has been mapped in
+    struct vspace_mmu_aware_stats stats; ///< Frames mapped so far
 };
 
 errval_t vspace_mmu_aware_init(struct vspace_mmu_aware *state, size_t size);
@@ -293,6 +293,8 @@ enum kernel_cmd {
     KernelCmd_Revoke_mark_relations,
     KernelCmd_Delete_step,
     KernelCmd_Clear_step,
+    KernelCmd_Delete_steps,       ///< Batch of delete steps within a cycle budget
+    KernelCmd_Clear_steps,        ///< Batch of clear steps within a cycle budget
     KernelCmd_Retype,
     KernelCmd_Has_descendants,
     KernelCmd_Sync_timer,
@@ -61,6 +61,7 @@ struct dispatcher_shared_generic {
 #ifdef __k1om__
     uint8_t     xeon_phi_id;
 #endif
+    uint32_t    pagefault_fixup;   ///< Page faults reported by a user fixup (W/O to kernel)
 };
 
 static inline struct dispatcher_shared_generic*
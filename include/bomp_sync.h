@@ -0,0 +1,47 @@
+/**
+ * \file
+ * \brief Topology aware synchronization for the OpenMP runtimes
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef BOMP_SYNC_H
+#define BOMP_SYNC_H
+
+#include <barrelfish_kpi/types.h>
+#include <omp.h>
+
+struct bomp_hbarrier;
+
+struct bomp_hbarrier *bomp_hbarrier_new(coreid_t nthreads,
+                                        const coreid_t *cores);
+void bomp_hbarrier_free(struct bomp_hbarrier *b);
+nodeid_t bomp_hbarrier_num_groups(struct bomp_hbarrier *b);
+void bomp_hbarrier_wait(struct bomp_hbarrier *b, coreid_t tid);
+uint64_t bomp_hbarrier_reduce(struct bomp_hbarrier *b, coreid_t tid,
+                              uint64_t value, bomp_reduce_op_t op);
+
+/*
+ * the values are passed as their bit patterns
+ */
+
+static inline uint64_t bomp_reduce_from_double(double d)
+{
+    union { double d; uint64_t u; } v = { .d = d };
+    return v.u;
+}
+
+static inline double bomp_reduce_to_double(uint64_t u)
+{
+    union { double d; uint64_t u; } v = { .u = u };
+    return v.d;
+}
+
+#endif /* BOMP_SYNC_H */
@@ -0,0 +1,112 @@
+/**
+ * \file
+ * \brief Barrelfish collections library open-addressing hash table
+ *
+ * A drop-in alternative to the hash table in collections/hash_table.h. The
+ * key/data pairs are stored inline in a single array of slots, which is
+ * searched by linear probing and grows and shrinks with the number of
+ * elements. A lookup therefore does not chase list pointers and an insert
+ * does not allocate memory, except when the table is resized.
+ *
+ * The table must not be modified while it is traversed.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef _OAHASH_TABLE_H_
+#define _OAHASH_TABLE_H_
+
+#include "collections/hash_table.h"
+
+/*
+ * A slot of the table; the key/data pair is stored inline.
+ */
+typedef struct _collections_oahash_slot {
+    uint64_t key;
+    void *data;
+} collections_oahash_slot;
+
+typedef struct _collections_oahash_table {
+    // number of slots, a power of two.
+    uint32_t capacity;
+
+    // the table does not shrink below this number of slots.
+    uint32_t min_capacity;
+
+    // total number of elements in the table.
+    uint32_t num_elems;
+
+    // the key/data pairs.
+    collections_oahash_slot *slots;
+
+    // per slot: 0 if empty, otherwise 0x80 | 7 bits of the hash of the key.
+    uint8_t *tags;
+
+    // function that knows how to free inserted data resources
+    collections_hash_data_free data_free;
+
+    // slot of the current traversal, -1 if none is in progress
+    int32_t cur_slot;
+} collections_oahash_table;
+
+#define OAHASH_MIN_CAPACITY 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+void     collections_oahash_create(collections_oahash_table **t,
+                                   collections_hash_data_free f);
+void     collections_oahash_create_with_capacity(collections_oahash_table **t,
+                                                 uint32_t num_elems,
+                                                 collections_hash_data_free f);
+void     collections_oahash_release(collections_oahash_table *t);
+void     collections_oahash_insert(collections_oahash_table *t, uint64_t key,
+                                   void *data);
+void*    collections_oahash_find(collections_oahash_table *t, uint64_t key);
+void     collections_oahash_delete(collections_oahash_table *t, uint64_t key);
+uint32_t collections_oahash_size(collections_oahash_table *t);
+int32_t  collections_oahash_traverse_start(collections_oahash_table *t);
+void*    collections_oahash_traverse_next(collections_oahash_table *t,
+                                          uint64_t *key);
+int32_t  collections_oahash_traverse_end(collections_oahash_table *t);
+
+/*
+ * Inserts n key/data pairs, resizing the table at most once.
+ */
+void     collections_oahash_insert_batch(collections_oahash_table *t,
+                                         const uint64_t *keys, void **data,
+                                         size_t n);
+
+/*
+ * Looks up n keys, overlapping the memory accesses of the lookups. Sets
+ * data[i] to the data of keys[i], or NULL if it is not in the table.
+ *
+ * Returns the number of keys found.
+ */
+size_t   collections_oahash_find_batch(collections_oahash_table *t,
+                                       const uint64_t *keys, void **data,
+                                       size_t n);
+
+/*
+ * Apply function to all elements in hash table or until function indicates
+ * function application should stop.
+ *
+ * Returns non-zero if all elements in table visited, 0 otherwise.
+ */
+int      collections_oahash_visit(collections_oahash_table *t,
+                                  collections_hash_visitor_func func,
+                                  void *arg);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif
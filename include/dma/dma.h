@@ -51,7 +51,8 @@ typedef enum dma_dev_type {
     DMA_DEV_TYPE_INVALID=0,
     DMA_DEV_TYPE_IOAT=1,
     DMA_DEV_TYPE_XEON_PHI=2,
-    DMA_DEV_TYPE_CLIENT=3
+    DMA_DEV_TYPE_CLIENT=3,
+    DMA_DEV_TYPE_SOFT=4
 } dma_dev_type_t;
 
 
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef LIB_SOFT_DMA_H
+#define LIB_SOFT_DMA_H
+
+#include <dma/dma.h>
+
+struct soft_dma_device;
+struct soft_dma_channel;
+struct soft_dma_request;
+
+/*
+ * The software DMA device has no hardware behind it: each channel is served
+ * by a copy thread running on a chosen core, which executes the descriptors
+ * issued to the channel's descriptor ring and signals their completion in
+ * the same way the hardware engines do.
+ */
+
+/// size of the software DMA descriptor ring in bits
+#define SOFT_DMA_RING_SIZE 10
+
+/// size of a software DMA descriptor in bytes
+#define SOFT_DMA_DESC_SIZE 64
+
+/// alignment of the software DMA descriptors
+#define SOFT_DMA_DESC_ALIGN 64
+
+/// transfers of at least this size bypass the cache with non-temporal stores
+#define SOFT_DMA_NT_THRESHOLD (256 * 1024)
+
+#endif  /* LIB_SOFT_DMA_H */
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef LIB_SOFT_DMA_CHANNEL_H
+#define LIB_SOFT_DMA_CHANNEL_H
+
+#include <dma/dma_channel.h>
+
+/**
+ * \brief pointer type conversion
+ */
+static inline struct soft_dma_channel *dma_channel_to_soft(struct dma_channel *chan)
+{
+    return (struct soft_dma_channel *)chan;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Channel Status
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief polls the software DMA channel for completed events
+ *
+ * \param chan  software DMA channel
+ *
+ * \returns SYS_ERR_OK if there was something processed
+ *          DMA_ERR_CHAN_IDLE if there was no request on the channel
+ *          DMA_ERR_REQUEST_UNFINISHED if the request has not been completed yet
+ */
+errval_t soft_dma_channel_poll(struct dma_channel *chan);
+
+#endif  /* LIB_SOFT_DMA_CHANNEL_H */
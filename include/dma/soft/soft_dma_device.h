@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef LIB_SOFT_DMA_DEVICE_H
+#define LIB_SOFT_DMA_DEVICE_H
+
+#include <dma/dma_device.h>
+
+/// forward declaration of the device
+struct soft_dma_device;
+struct soft_dma_channel;
+
+/// The maximum transfer size per descriptor
+#define SOFT_DMA_DEVICE_MAX_XFER (1024 * 1024)
+
+/// the maximum number of channels of a software DMA device
+#define SOFT_DMA_DEVICE_CHANNELS_MAX 8
+
+/**
+ * \brief pointer type conversion
+ */
+static inline struct soft_dma_device *dma_device_to_soft(struct dma_device *dev)
+{
+    return (struct soft_dma_device *) dev;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * device initialization / termination
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief initializes a software DMA device
+ *
+ * \param channels  number of channels of the device
+ * \param core      core on which the copy threads of the channels run
+ * \param dev       returns a pointer to the device structure
+ *
+ * If the domain is not yet running on the given core, it is spanned to it.
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+errval_t soft_dma_device_init(uint8_t channels,
+                              coreid_t core,
+                              struct soft_dma_device **dev);
+
+/*
+ * ----------------------------------------------------------------------------
+ * Device Operation Functions
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief polls the channels of the software DMA device
+ *
+ * \param dev   software DMA device
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_DEVICE_IDLE if there is nothing completed on the channels
+ *          errval on error
+ */
+errval_t soft_dma_device_poll_channels(struct dma_device *dev);
+
+#endif  /* LIB_SOFT_DMA_DEVICE_H */
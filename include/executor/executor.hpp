@@ -0,0 +1,760 @@
+/**
+ * \file
+ * \brief Work-stealing task executor on spanned Barrelfish dispatchers
+ *
+ * An executor runs a fixed set of worker threads on the cores it is given,
+ * spanning the domain to those cores as needed. Each worker keeps a deque of
+ * tasks: it runs its own tasks newest first and, when it runs out, steals
+ * the oldest tasks of other workers. Tasks submitted to a core with
+ * submit_on()/async_on() are pinned: only the workers of that core run them.
+ *
+ * Workers are plain Barrelfish threads rather than pthreads, so tasks should
+ * synchronise with thread_mutex/thread_cond or the futures below. A worker
+ * waiting on a future or a parallel loop keeps running other tasks instead
+ * of blocking.
+ *
+ * Example:
+ *
+ *   barrelfish::executor ex({ 0, 1, 2, 3 });
+ *   auto f = ex.async([] { return 6 * 7; });
+ *   auto g = f.then([] (barrelfish::future<int> r) { return r.get() + 1; });
+ *   int sum = ex.parallel_reduce(0, n, 0,
+ *                                [&] (size_t i) { return a[i]; },
+ *                                [] (int x, int y) { return x + y; });
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef EXECUTOR_EXECUTOR_HPP_
+#define EXECUTOR_EXECUTOR_HPP_
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/threads.h>
+#include <barrelfish/domain.h>
+#include <barrelfish/waitset.h>
+
+namespace barrelfish {
+
+class executor;
+template <typename T> class future;
+
+/// Holds a thread_mutex for the lifetime of the guard
+class mutex_guard {
+public:
+    explicit mutex_guard(struct thread_mutex &m) : m_(m)
+    {
+        thread_mutex_lock(&m_);
+    }
+    ~mutex_guard()
+    {
+        thread_mutex_unlock(&m_);
+    }
+    mutex_guard(const mutex_guard &) = delete;
+    mutex_guard &operator=(const mutex_guard &) = delete;
+
+private:
+    struct thread_mutex &m_;
+};
+
+namespace detail {
+
+typedef std::function<void()> task;
+
+/// State of one worker thread
+struct worker {
+    executor *exec;
+    size_t index;
+    coreid_t core;
+    struct thread *thread;
+    struct thread_mutex lock;
+    std::deque<task> tasks;     ///< owner takes the back, thieves the front
+    std::deque<task> pinned;    ///< tasks only this worker runs, in order
+    size_t executed;            ///< tasks run by this worker
+    size_t stolen;              ///< of which stolen from other workers
+};
+
+/**
+ * \brief Creates a thread on core, spanning the domain to core if it has no
+ *        dispatcher there yet
+ */
+inline errval_t thread_create_on(coreid_t core, thread_func_t fn, void *arg,
+                                 size_t stack_size, struct thread **ret)
+{
+    // only one caller spans the domain to a core
+    static struct thread_mutex lock = THREAD_MUTEX_INITIALIZER;
+    mutex_guard guard(lock);
+
+    errval_t err = domain_thread_create_on_varstack(core, fn, arg, stack_size,
+                                                    ret);
+    if (err_no(err) != LIB_ERR_NO_SPANNED_DISP) {
+        return err;
+    }
+
+    struct span_state {
+        static void cb(void *arg, errval_t err)
+        {
+            *static_cast<errval_t *>(arg) = err;
+        }
+    };
+    errval_t span_err = LIB_ERR_NO_SPANNED_DISP;
+    err = domain_new_dispatcher(core, span_state::cb, &span_err);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    while (err_no(span_err) == LIB_ERR_NO_SPANNED_DISP) {
+        err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_EVENT_DISPATCH);
+        }
+    }
+    if (err_is_fail(span_err)) {
+        return span_err;
+    }
+
+    return domain_thread_create_on_varstack(core, fn, arg, stack_size, ret);
+}
+
+/// State shared by a future and the task producing its value
+class shared_state_base {
+public:
+    explicit shared_state_base(executor *exec) : exec_(exec), ready_(false)
+    {
+        thread_mutex_init(&lock_);
+        thread_cond_init(&cond_);
+    }
+
+    bool ready() const
+    {
+        return ready_;
+    }
+
+    executor *exec() const
+    {
+        return exec_;
+    }
+
+    void set_error(std::exception_ptr e)
+    {
+        error_ = e;
+        finish();
+    }
+
+    void rethrow() const
+    {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void wait();
+
+    /// Runs t on the executor once the state is ready
+    void then(task t);
+
+protected:
+    void finish();
+
+private:
+    executor *exec_;
+    volatile bool ready_;
+    std::exception_ptr error_;
+    std::vector<task> continuations_;
+    struct thread_mutex lock_;
+    struct thread_cond cond_;
+};
+
+template <typename T>
+class shared_state : public shared_state_base {
+public:
+    explicit shared_state(executor *exec) : shared_state_base(exec) {}
+
+    void set_value(T v)
+    {
+        value_.reset(new T(std::move(v)));
+        finish();
+    }
+
+    T take()
+    {
+        return std::move(*value_);
+    }
+
+private:
+    std::unique_ptr<T> value_;
+};
+
+template <>
+class shared_state<void> : public shared_state_base {
+public:
+    explicit shared_state(executor *exec) : shared_state_base(exec) {}
+
+    void set_value()
+    {
+        finish();
+    }
+
+    void take() {}
+};
+
+/// Runs f and stores its result or exception in st
+template <typename R, typename F>
+void fulfil(shared_state<R> &st, F &f)
+{
+    try {
+        st.set_value(f());
+    } catch (...) {
+        st.set_error(std::current_exception());
+    }
+}
+
+template <typename F>
+void fulfil(shared_state<void> &st, F &f)
+{
+    try {
+        f();
+        st.set_value();
+    } catch (...) {
+        st.set_error(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+/**
+ * \brief Result of a task run by an executor.
+ *
+ * Unlike std::future, continuations can be attached with then(), and
+ * waiting from a worker runs other tasks.
+ */
+template <typename T>
+class future {
+public:
+    future() {}
+
+    bool valid() const
+    {
+        return state_ != nullptr;
+    }
+
+    bool is_ready() const
+    {
+        return state_->ready();
+    }
+
+    void wait() const
+    {
+        state_->wait();
+    }
+
+    /// Waits for the result, rethrowing the exception of the task if any
+    T get()
+    {
+        state_->wait();
+        state_->rethrow();
+        std::shared_ptr<detail::shared_state<T> > st = std::move(state_);
+        return st->take();
+    }
+
+    /**
+     * \brief Runs f with this future once it is ready.
+     *
+     * \returns A future for the result of f. This future is invalidated.
+     */
+    template <typename F>
+    future<typename std::result_of<F(future<T>)>::type> then(F f);
+
+private:
+    friend class executor;
+    template <typename U> friend class future;
+
+    explicit future(std::shared_ptr<detail::shared_state<T> > st)
+        : state_(std::move(st)) {}
+
+    std::shared_ptr<detail::shared_state<T> > state_;
+};
+
+/**
+ * \brief Work-stealing executor with a fixed set of workers.
+ */
+class executor {
+public:
+    /**
+     * \brief Starts threads_per_core workers on each of the given cores.
+     *
+     * The domain is spanned to cores it does not run on yet. Failing to span
+     * or to create a thread is fatal.
+     */
+    explicit executor(const std::vector<coreid_t> &cores,
+                      size_t threads_per_core = 1,
+                      size_t stack_size = THREADS_DEFAULT_STACK_BYTES)
+        : pending_(0), outstanding_(0), sleepers_(0), next_(0),
+          stopping_(false)
+    {
+        thread_mutex_init(&idle_lock_);
+        thread_cond_init(&idle_cond_);
+
+        for (size_t i = 0; i < cores.size(); i++) {
+            for (size_t t = 0; t < threads_per_core; t++) {
+                detail::worker *w = new detail::worker();
+                w->exec = this;
+                w->index = workers_.size();
+                w->core = cores[i];
+                w->thread = NULL;
+                w->executed = w->stolen = 0;
+                thread_mutex_init(&w->lock);
+                workers_.push_back(w);
+            }
+        }
+        assert(!workers_.empty());
+
+        // start the workers once workers_ does not change any more
+        for (size_t i = 0; i < workers_.size(); i++) {
+            detail::worker *w = workers_[i];
+            struct thread *t;
+            errval_t err = detail::thread_create_on(w->core, worker_main, w,
+                                                    stack_size, &t);
+            if (err_is_fail(err)) {
+                USER_PANIC_ERR(err, "executor: creating worker on core %d",
+                               w->core);
+            }
+        }
+    }
+
+    /// Waits for all tasks to complete and stops the workers
+    ~executor()
+    {
+        wait_idle();
+
+        {
+            mutex_guard guard(idle_lock_);
+            stopping_ = true;
+            thread_cond_broadcast(&idle_cond_);
+        }
+
+        for (size_t i = 0; i < workers_.size(); i++) {
+            while (workers_[i]->thread == NULL) {
+                thread_yield();
+            }
+            errval_t err = domain_thread_join(workers_[i]->thread, NULL);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "executor: joining worker");
+            }
+            delete workers_[i];
+        }
+    }
+
+    executor(const executor &) = delete;
+    executor &operator=(const executor &) = delete;
+
+    /// Number of workers
+    size_t size() const
+    {
+        return workers_.size();
+    }
+
+    /// Tasks run and tasks stolen by all workers so far
+    void stats(size_t *executed, size_t *stolen) const
+    {
+        *executed = *stolen = 0;
+        for (size_t i = 0; i < workers_.size(); i++) {
+            *executed += workers_[i]->executed;
+            *stolen += workers_[i]->stolen;
+        }
+    }
+
+    /**
+     * \brief Runs t on any worker.
+     *
+     * A task submitted by a worker goes to that worker's deque, others are
+     * spread round-robin. Exceptions escaping t are fatal.
+     */
+    void submit(detail::task t)
+    {
+        detail::worker *w = current_worker();
+        if (w == NULL) {
+            w = workers_[__sync_fetch_and_add(&next_, 1) % workers_.size()];
+        }
+        push(w, std::move(t), false);
+    }
+
+    /// Runs t on a worker of the given core
+    void submit_on(coreid_t core, detail::task t)
+    {
+        detail::worker *w = current_worker();
+        if (w == NULL || w->core != core) {
+            w = NULL;
+            size_t n = workers_.size();
+            size_t start = __sync_fetch_and_add(&next_, 1);
+            for (size_t i = 0; i < n && w == NULL; i++) {
+                if (workers_[(start + i) % n]->core == core) {
+                    w = workers_[(start + i) % n];
+                }
+            }
+            assert(w != NULL && "no worker on this core");
+        }
+        push(w, std::move(t), true);
+    }
+
+    /// Runs f on any worker and returns a future for its result
+    template <typename F>
+    future<typename std::result_of<F()>::type> async(F f)
+    {
+        typedef typename std::result_of<F()>::type R;
+        std::shared_ptr<detail::shared_state<R> > st =
+            std::make_shared<detail::shared_state<R> >(this);
+        submit([st, f] () mutable { detail::fulfil(*st, f); });
+        return future<R>(st);
+    }
+
+    /// Runs f on a worker of the given core
+    template <typename F>
+    future<typename std::result_of<F()>::type> async_on(coreid_t core, F f)
+    {
+        typedef typename std::result_of<F()>::type R;
+        std::shared_ptr<detail::shared_state<R> > st =
+            std::make_shared<detail::shared_state<R> >(this);
+        submit_on(core, [st, f] () mutable { detail::fulfil(*st, f); });
+        return future<R>(st);
+    }
+
+    /**
+     * \brief Calls body(i) for all i in [begin, end) and waits for all calls.
+     *
+     * \param grain Indices per task; 0 picks about 8 tasks per worker.
+     *
+     * The first exception thrown by body is rethrown once all tasks finished.
+     */
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, F body, size_t grain = 0)
+    {
+        if (end <= begin) {
+            return;
+        }
+        grain = grain_for(end - begin, grain);
+
+        volatile size_t remaining = (end - begin + grain - 1) / grain;
+        loop_error error;
+        for (size_t b = begin; b < end; b += grain) {
+            size_t e = (end - b > grain) ? b + grain : end;
+            submit([b, e, &body, &remaining, &error] {
+                try {
+                    for (size_t i = b; i < e; i++) {
+                        body(i);
+                    }
+                } catch (...) {
+                    error.set(std::current_exception());
+                }
+                __sync_fetch_and_sub(&remaining, 1);
+            });
+        }
+
+        wait_until([&remaining] { return remaining == 0; });
+        error.rethrow();
+    }
+
+    /**
+     * \brief Folds map(i) for all i in [begin, end) with reduce.
+     *
+     * reduce has to be associative; identity is its neutral element.
+     */
+    template <typename T, typename M, typename R>
+    T parallel_reduce(size_t begin, size_t end, T identity, M map, R reduce,
+                      size_t grain = 0)
+    {
+        if (end <= begin) {
+            return identity;
+        }
+        grain = grain_for(end - begin, grain);
+
+        std::vector<T> partial((end - begin + grain - 1) / grain, identity);
+        parallel_for(0, partial.size(),
+                     [&] (size_t chunk) {
+                         size_t b = begin + chunk * grain;
+                         size_t e = (end - b > grain) ? b + grain : end;
+                         T acc = identity;
+                         for (size_t i = b; i < e; i++) {
+                             acc = reduce(acc, map(i));
+                         }
+                         partial[chunk] = acc;
+                     }, 1);
+
+        T result = identity;
+        for (size_t i = 0; i < partial.size(); i++) {
+            result = reduce(result, partial[i]);
+        }
+        return result;
+    }
+
+    /**
+     * \brief Waits until pred() holds.
+     *
+     * Workers run other tasks while waiting, other threads yield.
+     */
+    template <typename P>
+    void wait_until(P pred)
+    {
+        detail::worker *w = current_worker();
+        while (!pred()) {
+            if (w == NULL || !run_one(*w)) {
+                thread_yield();
+            }
+        }
+    }
+
+    /// Waits until all submitted tasks have completed
+    void wait_idle()
+    {
+        wait_until([this] { return outstanding_ == 0; });
+    }
+
+    /// The worker the calling thread is, or NULL
+    detail::worker *current_worker() const
+    {
+        struct thread *me = thread_self();
+        for (size_t i = 0; i < workers_.size(); i++) {
+            if (workers_[i]->thread == me) {
+                return workers_[i];
+            }
+        }
+        return NULL;
+    }
+
+private:
+    /// Idle rounds a worker spins, yielding, before it sleeps
+    static const size_t spin_rounds = 64;
+
+    /// First exception of a parallel loop
+    class loop_error {
+    public:
+        loop_error()
+        {
+            thread_mutex_init(&lock_);
+        }
+        void set(std::exception_ptr e)
+        {
+            mutex_guard guard(lock_);
+            if (!error_) {
+                error_ = e;
+            }
+        }
+        void rethrow()
+        {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+    private:
+        std::exception_ptr error_;
+        struct thread_mutex lock_;
+    };
+
+    size_t grain_for(size_t n, size_t grain) const
+    {
+        if (grain == 0) {
+            grain = n / (8 * workers_.size());
+        }
+        return (grain > 0) ? grain : 1;
+    }
+
+    void push(detail::worker *w, detail::task t, bool pin)
+    {
+        __sync_fetch_and_add(&outstanding_, 1);
+        {
+            mutex_guard guard(w->lock);
+            if (pin) {
+                w->pinned.push_back(std::move(t));
+            } else {
+                w->tasks.push_back(std::move(t));
+            }
+        }
+        // full barrier: either we see the sleeper, or it sees the task
+        __sync_fetch_and_add(&pending_, 1);
+        if (sleepers_ > 0) {
+            mutex_guard guard(idle_lock_);
+            thread_cond_broadcast(&idle_cond_);
+        }
+    }
+
+    bool take(detail::worker &w, detail::task &t)
+    {
+        mutex_guard guard(w.lock);
+        if (!w.pinned.empty()) {
+            t = std::move(w.pinned.front());
+            w.pinned.pop_front();
+        } else if (!w.tasks.empty()) {
+            t = std::move(w.tasks.back());
+            w.tasks.pop_back();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool steal(detail::worker &victim, detail::task &t)
+    {
+        mutex_guard guard(victim.lock);
+        if (victim.tasks.empty()) {
+            return false;
+        }
+        t = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+
+    /// Runs one task of w or stolen by w; returns false if there was none
+    bool run_one(detail::worker &w)
+    {
+        detail::task t;
+        if (!take(w, t)) {
+            size_t n = workers_.size();
+            bool found = false;
+            for (size_t i = 1; i < n && !found; i++) {
+                found = steal(*workers_[(w.index + i) % n], t);
+            }
+            if (!found) {
+                return false;
+            }
+            w.stolen++;
+        }
+        __sync_fetch_and_sub(&pending_, 1);
+
+        try {
+            t();
+        } catch (...) {
+            USER_PANIC("executor: uncaught exception in task");
+        }
+
+        w.executed++;
+        __sync_fetch_and_sub(&outstanding_, 1);
+        return true;
+    }
+
+    /// Sleeps until work is pending; returns true if the worker should exit
+    bool sleep()
+    {
+        mutex_guard guard(idle_lock_);
+        __sync_fetch_and_add(&sleepers_, 1);
+        while (pending_ == 0 && !stopping_) {
+            thread_cond_wait(&idle_cond_, &idle_lock_);
+        }
+        __sync_fetch_and_sub(&sleepers_, 1);
+        return stopping_ && pending_ == 0;
+    }
+
+    void run(detail::worker &w)
+    {
+        size_t idle = 0;
+        for (;;) {
+            if (run_one(w)) {
+                idle = 0;
+                continue;
+            }
+            if (++idle < spin_rounds) {
+                thread_yield();
+                continue;
+            }
+            idle = 0;
+            if (sleep()) {
+                return;
+            }
+        }
+    }
+
+    static int worker_main(void *arg)
+    {
+        detail::worker *w = static_cast<detail::worker *>(arg);
+        w->thread = thread_self();
+        w->exec->run(*w);
+        return 0;
+    }
+
+    std::vector<detail::worker *> workers_;
+    volatile size_t pending_;       ///< tasks queued and not yet taken
+    volatile size_t outstanding_;   ///< tasks submitted and not completed
+    volatile size_t sleepers_;      ///< workers in sleep()
+    volatile size_t next_;          ///< round-robin worker of submit()
+    bool stopping_;                     ///< protected by idle_lock_
+    struct thread_mutex idle_lock_;
+    struct thread_cond idle_cond_;
+};
+
+namespace detail {
+
+inline void shared_state_base::finish()
+{
+    std::vector<task> conts;
+    {
+        mutex_guard guard(lock_);
+        __sync_synchronize();
+        ready_ = true;
+        conts.swap(continuations_);
+        thread_cond_broadcast(&cond_);
+    }
+    for (size_t i = 0; i < conts.size(); i++) {
+        exec_->submit(std::move(conts[i]));
+    }
+}
+
+inline void shared_state_base::then(task t)
+{
+    {
+        mutex_guard guard(lock_);
+        if (!ready_) {
+            continuations_.push_back(std::move(t));
+            return;
+        }
+    }
+    exec_->submit(std::move(t));
+}
+
+inline void shared_state_base::wait()
+{
+    if (ready_) {
+        return;
+    }
+    if (exec_->current_worker() != NULL) {
+        exec_->wait_until([this] { return ready_; });
+        return;
+    }
+    mutex_guard guard(lock_);
+    while (!ready_) {
+        thread_cond_wait(&cond_, &lock_);
+    }
+}
+
+} // namespace detail
+
+template <typename T>
+template <typename F>
+future<typename std::result_of<F(future<T>)>::type> future<T>::then(F f)
+{
+    typedef typename std::result_of<F(future<T>)>::type R;
+    std::shared_ptr<detail::shared_state<T> > st = std::move(state_);
+    std::shared_ptr<detail::shared_state<R> > next =
+        std::make_shared<detail::shared_state<R> >(st->exec());
+    st->then([st, next, f] () mutable {
+        future<T> ready(st);
+        auto call = [&ready, &f] () { return f(std::move(ready)); };
+        detail::fulfil(*next, call);
+    });
+    return future<R>(next);
+}
+
+} // namespace barrelfish
+
+#endif // EXECUTOR_EXECUTOR_HPP_
@@ -0,0 +1,245 @@
+/**
+ * \file
+ * \brief Runtime support for the C++ Flounder bindings
+ *
+ * The C++ bindings generated by flounder --cxx-header (if/<ifn>_cxx.hpp)
+ * wrap the C binding of an interface. They use the types below for message
+ * payloads:
+ *
+ *  - string_view, span<T>: non-owning views. Receive handlers see the
+ *    strings and arrays of a message through these; they point into the
+ *    buffers allocated by the stubs and are valid until the handler returns.
+ *  - owned_string, owned_buffer<T>: move-only owners of malloc()ed storage.
+ *    Send functions take payloads as these and free them once the send has
+ *    completed. A handler that wants to keep a payload takes its storage
+ *    from the message instead of copying it.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef FLOUNDER_FLOUNDER_CXX_HPP_
+#define FLOUNDER_FLOUNDER_CXX_HPP_
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset.h>
+
+namespace flounder {
+
+/// Called once the payload of a send has been handed to the channel
+typedef std::function<void()> completion;
+
+/// Non-owning view of a string
+class string_view {
+public:
+    string_view() : data_(""), size_(0) {}
+    string_view(const char *s) : data_(s), size_(strlen(s)) {}
+    string_view(const char *s, size_t size) : data_(s), size_(size) {}
+    string_view(const std::string &s) : data_(s.data()), size_(s.size()) {}
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char *begin() const { return data_; }
+    const char *end() const { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    /// Copies the viewed characters
+    std::string str() const { return std::string(data_, size_); }
+
+    bool operator==(string_view o) const
+    {
+        return size_ == o.size_ && memcmp(data_, o.data_, size_) == 0;
+    }
+    bool operator!=(string_view o) const { return !(*this == o); }
+
+private:
+    const char *data_;
+    size_t size_;
+};
+
+/// Non-owning view of an array
+template <typename T>
+class span {
+public:
+    span() : data_(NULL), size_(0) {}
+    span(T *data, size_t size) : data_(data), size_(size) {}
+
+    T *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T *begin() const { return data_; }
+    T *end() const { return data_ + size_; }
+    T &operator[](size_t i) const { return data_[i]; }
+
+private:
+    T *data_;
+    size_t size_;
+};
+
+/// Move-only owner of a malloc()ed, NUL-terminated string
+class owned_string {
+public:
+    owned_string() : data_(NULL), size_(0) {}
+
+    /// Adopts s, which must have been allocated with malloc()
+    explicit owned_string(char *s) : data_(s), size_(s ? strlen(s) : 0) {}
+
+    /// Allocates a copy of s
+    static owned_string copy(string_view s)
+    {
+        char *p = static_cast<char *>(malloc(s.size() + 1));
+        if (p == NULL) {
+            USER_PANIC("owned_string: out of memory\n");
+        }
+        memcpy(p, s.data(), s.size());
+        p[s.size()] = '\0';
+        return owned_string(p, s.size());
+    }
+
+    owned_string(owned_string &&o) : data_(o.data_), size_(o.size_)
+    {
+        o.data_ = NULL;
+        o.size_ = 0;
+    }
+
+    owned_string &operator=(owned_string &&o)
+    {
+        if (this != &o) {
+            free(data_);
+            data_ = o.data_;
+            size_ = o.size_;
+            o.data_ = NULL;
+            o.size_ = 0;
+        }
+        return *this;
+    }
+
+    owned_string(const owned_string &) = delete;
+    owned_string &operator=(const owned_string &) = delete;
+
+    ~owned_string() { free(data_); }
+
+    /// NUL-terminated contents, or "" if nothing is owned
+    const char *c_str() const { return data_ ? data_ : ""; }
+    char *data() { return data_; }
+    size_t size() const { return size_; }
+    string_view view() const { return string_view(c_str(), size_); }
+
+    /// Gives up ownership; the caller must free() the result
+    char *release()
+    {
+        char *p = data_;
+        data_ = NULL;
+        size_ = 0;
+        return p;
+    }
+
+private:
+    owned_string(char *s, size_t size) : data_(s), size_(size) {}
+
+    char *data_;
+    size_t size_;
+};
+
+/// Move-only owner of a malloc()ed array
+template <typename T>
+class owned_buffer {
+public:
+    owned_buffer() : data_(NULL), size_(0) {}
+
+    /// Adopts size elements at data, which must have been allocated with malloc()
+    owned_buffer(T *data, size_t size) : data_(data), size_(size) {}
+
+    /// Allocates an uninitialised buffer of size elements
+    static owned_buffer allocate(size_t size)
+    {
+        T *p = static_cast<T *>(malloc(size * sizeof(T)));
+        if (p == NULL && size > 0) {
+            USER_PANIC("owned_buffer: out of memory\n");
+        }
+        return owned_buffer(p, size);
+    }
+
+    /// Allocates a copy of data
+    static owned_buffer copy(span<const T> data)
+    {
+        owned_buffer b = allocate(data.size());
+        memcpy(b.data_, data.data(), data.size() * sizeof(T));
+        return b;
+    }
+
+    owned_buffer(owned_buffer &&o) : data_(o.data_), size_(o.size_)
+    {
+        o.data_ = NULL;
+        o.size_ = 0;
+    }
+
+    owned_buffer &operator=(owned_buffer &&o)
+    {
+        if (this != &o) {
+            free(data_);
+            data_ = o.data_;
+            size_ = o.size_;
+            o.data_ = NULL;
+            o.size_ = 0;
+        }
+        return *this;
+    }
+
+    owned_buffer(const owned_buffer &) = delete;
+    owned_buffer &operator=(const owned_buffer &) = delete;
+
+    ~owned_buffer() { free(data_); }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    size_t size() const { return size_; }
+    T &operator[](size_t i) { return data_[i]; }
+    span<const T> view() const { return span<const T>(data_, size_); }
+
+    /// Gives up ownership; the caller must free() the result
+    T *release()
+    {
+        T *p = data_;
+        data_ = NULL;
+        size_ = 0;
+        return p;
+    }
+
+private:
+    T *data_;
+    size_t size_;
+};
+
+/**
+ * \brief Dispatches events on ws until *busy is cleared
+ *
+ * Used by the generated bindings to wait for an outstanding send.
+ */
+static inline errval_t wait_while(struct waitset *ws, const volatile bool *busy)
+{
+    while (*busy) {
+        errval_t err = event_dispatch(ws);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+    return SYS_ERR_OK;
+}
+
+} // namespace flounder
+
+#endif // FLOUNDER_FLOUNDER_CXX_HPP_
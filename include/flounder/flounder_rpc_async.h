@@ -0,0 +1,88 @@
+/**
+ * \file
+ * \brief Bookkeeping of outstanding calls for asynchronous RPC clients
+ *
+ * The rpcclient backend generates, next to the blocking RPC functions, an
+ * asynchronous variant of every RPC (rpc->async_vtbl). Any number of calls
+ * may be outstanding on one binding; the call messages are queued on a
+ * tx_queue and each reply completes the continuation given to its call.
+ *
+ * Replies are matched to calls per RPC in FIFO order, which is correct as
+ * long as the server answers calls of the same RPC in the order it received
+ * them. RPCs which carry a request ID (first arguments "in uint64 seq_in,
+ * out uint64 seq_out", as used by the THC out-of-order RPCs) get the ID
+ * assigned by the stub and their replies are matched by ID, so the server
+ * may answer them in any order.
+ *
+ * The ID is part of the interface definition rather than added to every
+ * message, because each server has to echo it in its reply. Interfaces whose
+ * calls may be answered out of order should offer request ID variants of
+ * those RPCs for asynchronous clients (e.g. get_seq in octopus.if).
+ *
+ * String and buffer arguments are referenced, not copied, until the call
+ * message has been sent; callers keep them valid until the continuation runs.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef __FLOUNDER_RPC_ASYNC_H
+#define __FLOUNDER_RPC_ASYNC_H
+
+#include <barrelfish/waitset.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+struct flounder_rpc_pending;
+
+/// generic type of the interface-specific continuations
+typedef void flounder_rpc_async_cont_fn(void);
+
+/// completes an outstanding call with an error
+typedef void flounder_rpc_async_fail_fn(void *rpc,
+                                        struct flounder_rpc_pending *p,
+                                        errval_t err);
+
+/// an outstanding asynchronous call
+struct flounder_rpc_pending {
+    struct flounder_rpc_pending *next;
+    int rpcnum;                         ///< number of the RPC in the interface
+    uint64_t seq;                       ///< request ID
+    flounder_rpc_async_cont_fn *cont;   ///< continuation of the caller
+    flounder_rpc_async_fail_fn *fail;   ///< invokes cont with an error
+    void *st;                           ///< argument of the continuation
+};
+
+/// per RPC client state of the asynchronous calls
+struct flounder_rpc_async {
+    struct flounder_rpc_pending *head;  ///< outstanding calls, oldest first
+    struct flounder_rpc_pending *tail;
+    struct flounder_rpc_pending *free;  ///< free list of call records
+    uint64_t next_seq;                  ///< next request ID to assign
+    size_t outstanding;                 ///< number of outstanding calls
+};
+
+void flounder_rpc_async_init(struct flounder_rpc_async *as);
+struct flounder_rpc_pending *flounder_rpc_pending_alloc(struct flounder_rpc_async *as);
+void flounder_rpc_pending_free(struct flounder_rpc_async *as,
+                               struct flounder_rpc_pending *p);
+void flounder_rpc_pending_enqueue(struct flounder_rpc_async *as,
+                                  struct flounder_rpc_pending *p);
+struct flounder_rpc_pending *flounder_rpc_pending_take(struct flounder_rpc_async *as,
+                                                       int rpcnum, bool by_seq,
+                                                       uint64_t seq);
+void flounder_rpc_async_fail_all(struct flounder_rpc_async *as, void *rpc,
+                                 errval_t err);
+errval_t flounder_rpc_async_wait(struct flounder_rpc_async *as,
+                                 struct waitset *ws, size_t max_outstanding);
+
+__END_DECLS
+
+#endif // __FLOUNDER_RPC_ASYNC_H
@@ -0,0 +1,105 @@
+/**
+ * \file
+ * \brief Optional per-message statistics for flounder-generated stubs
+ *
+ * When built with FLOUNDER_STATS defined (see flounder_stats in Config.hs),
+ * the generated stubs count messages and payload bytes per interface and
+ * message type, the time a message spends in the binding between being
+ * accepted by a send function and handed to the channel (tx wait), and the
+ * time between the arrival of the first fragment of a message and the
+ * invocation of its receive handler (rx latency). Without FLOUNDER_STATS all
+ * hooks compile to nothing.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef __FLOUNDER_STATS_H
+#define __FLOUNDER_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/// Number of log2 buckets of the cycle histograms
+#define FLOUNDER_STATS_HIST_BUCKETS 32
+
+/// Counters for a single message type of an interface
+struct flounder_msg_stats {
+    uint64_t tx_count;      ///< messages sent
+    uint64_t tx_bytes;      ///< payload bytes sent
+    uint64_t tx_wait;       ///< total cycles between send call and channel
+    uint64_t rx_count;      ///< messages received
+    uint64_t rx_bytes;      ///< payload bytes received
+    uint64_t rx_lat;        ///< total cycles from first fragment to handler
+
+    /// tx wait histogram, bucket i counts waits of [2^(i-1), 2^i) cycles
+    uint64_t tx_wait_hist[FLOUNDER_STATS_HIST_BUCKETS];
+    /// rx latency histogram, same bucketing as tx_wait_hist
+    uint64_t rx_lat_hist[FLOUNDER_STATS_HIST_BUCKETS];
+};
+
+/// Statistics of an interface, emitted by flounder for every interface
+struct flounder_if_stats {
+    const char *name;                   ///< interface name
+    int nmsgs;                          ///< number of entries in msgs
+    const char **msgnames;              ///< message names, by message number
+    struct flounder_msg_stats *msgs;    ///< counters, by message number
+
+    struct flounder_if_stats *next;     ///< next registered interface
+    volatile int registered;            ///< 0: no, 1: in progress, 2: yes
+};
+
+void flounder_stats_register(struct flounder_if_stats *ifs);
+uint64_t flounder_stats_now(void);
+void flounder_stats_tx_start(struct flounder_if_stats *ifs,
+                             struct flounder_msg_stats **txp,
+                             uint64_t *startp, int msgnum, size_t bytes);
+void flounder_stats_tx_done(struct flounder_msg_stats **txp, uint64_t start);
+void flounder_stats_rx(struct flounder_if_stats *ifs, uint64_t *startp,
+                       int msgnum, size_t bytes);
+
+struct flounder_if_stats *flounder_stats_find(const char *ifname);
+void flounder_stats_print(void);
+void flounder_stats_reset(void);
+void flounder_stats_trace_dump(void);
+
+/// payload size of a string argument including its terminator
+static inline size_t flounder_stats_strlen(const char *s)
+{
+    return s == NULL ? 0 : strlen(s) + 1;
+}
+
+#if defined(FLOUNDER_STATS)
+# define FL_STATS_TX_START(ifs, b, msgnum, bytes) \
+    flounder_stats_tx_start(ifs, &(b)->tx_stats, &(b)->tx_stats_start, \
+                            msgnum, bytes)
+# define FL_STATS_TX_DONE(b) \
+    do { \
+        if ((b)->tx_stats != NULL) { \
+            flounder_stats_tx_done(&(b)->tx_stats, (b)->tx_stats_start); \
+        } \
+    } while (0)
+# define FL_STATS_RX_START(b) \
+    ((b)->rx_stats_start = flounder_stats_now())
+# define FL_STATS_RX(ifs, b, msgnum, bytes) \
+    flounder_stats_rx(ifs, &(b)->rx_stats_start, msgnum, bytes)
+#else
+# define FL_STATS_TX_START(ifs, b, msgnum, bytes) ((void)0)
+# define FL_STATS_TX_DONE(b) ((void)0)
+# define FL_STATS_RX_START(b) ((void)0)
+# define FL_STATS_RX(ifs, b, msgnum, bytes) ((void)0)
+#endif
+
+__END_DECLS
+
+#endif // __FLOUNDER_STATS_H
@@ -16,6 +16,7 @@
 #define __FLOUNDER_SUPPORT_H
 
 #include <flounder/flounder.h>
+#include <flounder/flounder_stats.h>
 #include <sys/cdefs.h>
 
 __BEGIN_DECLS
@@ -51,14 +51,17 @@ errval_t flounder_stub_ump_send_string(struct flounder_ump_state *s,
                                        int msgnum, const char *str,
                                        size_t *pos, size_t *len);
 
-errval_t flounder_stub_ump_recv_string(volatile struct ump_message *msg,
+errval_t flounder_stub_ump_recv_string(struct flounder_ump_state *s,
+                                       int msgnum,
+                                       volatile struct ump_message *msg,
                                        char **str, size_t *pos, size_t *len);
 
 errval_t flounder_stub_ump_send_buf(struct flounder_ump_state *s,
                                        int msgnum, const void *buf,
                                        size_t len, size_t *pos);
 
-errval_t flounder_stub_ump_recv_buf(volatile struct ump_message *msg,
+errval_t flounder_stub_ump_recv_buf(struct flounder_ump_state *s, int msgnum,
+                                    volatile struct ump_message *msg,
                                     void **buf, size_t *len, size_t *pos);
 
 /// Computes (from seq/ack numbers) whether we can currently send on the channel
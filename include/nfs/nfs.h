@@ -193,6 +193,19 @@ typedef void (*nfs_mkdir_callback_t)(void *arg, struct nfs_client *client,
 typedef void (*nfs_remove_callback_t)(void *arg, struct nfs_client *client,
                                       REMOVE3res *result);
 
+/**
+ * \brief Callback function for commit operation
+ *
+ * \param arg Opaque argument pointer, as provided to nfs_commit()
+ * \param client NFS client instance
+ * \param result Result pointer, or NULL on error
+ *
+ * The memory referred to by #result, if any, is now the property of the callee,
+ * and must be freed by the appropriate XDR free operations.
+ */
+typedef void (*nfs_commit_callback_t)(void *arg, struct nfs_client *client,
+                                      COMMIT3res *result);
+
 struct nfs_client *nfs_mount(struct ip_addr server, const char *path,
                              nfs_mount_callback_t callback, void *cbarg);
 err_t nfs_getattr(struct nfs_client *client, struct nfs_fh3 fh,
@@ -223,6 +236,8 @@ err_t nfs_mkdir(struct nfs_client *client, struct nfs_fh3 dir, const char *name,
 err_t nfs_remove(struct nfs_client *client, struct nfs_fh3 dir,
                  const char *name, nfs_remove_callback_t callback,
                  void *cbarg);
+err_t nfs_commit(struct nfs_client *client, struct nfs_fh3 fh, offset3 offset,
+                 count3 count, nfs_commit_callback_t callback, void *cbarg);
 void nfs_destroy(struct nfs_client *client);
 
 void nfs_copyfh(struct nfs_fh3 *dest, struct nfs_fh3 src);
@@ -377,6 +377,12 @@ void *numa_alloc(size_t size, size_t pagesize);
  * \param old_addr  pointer ot the old memory region
  * \param old_size  size of the old memory region
  * \param new_size  new size to allocate
+ *
+ * \returns pointer to the resized memory region
+ *
+ * The new region is allocated on the node of the first page of the old region
+ * and the contents are copied over. On errors NULL is returned and the old
+ * region is left untouched.
  */
 void *numa_realloc(void *old_addr, size_t old_size, size_t new_size);
 
@@ -387,6 +393,7 @@ void *numa_realloc(void *old_addr, size_t old_size, size_t new_size);
  * \param size  number of bytes to free
  *
  * the memory must be previously allocated by one of the numa_alloc* functions
+ * and is freed as a whole, together with the frames backing it.
  */
 void numa_free(void *start, size_t size);
 
@@ -733,6 +740,10 @@ uint32_t numa_bitmask_weight(const struct bitmap *bmp);
  * \param flags  flags for moving the pages
  *
  * \returns SYS_ERR_OK on SUCCESS
+ *
+ * Pages are moved with the whole frame backing them, so neighbouring pages
+ * may move as well. The outcome for every page is returned in status, which
+ * may be NULL. Only the calling domain is supported; flags are unused.
  */
 errval_t numa_move_pages(domainid_t did,
                          size_t count,
@@ -748,11 +759,128 @@ errval_t numa_move_pages(domainid_t did,
  * \param tonodes    bitmap representing the
  *
  * \returns SYS_ERR_OK on SUCCESS
+ *
+ * Moves the anonymous memory of the domain, which includes its heap, that
+ * is on a node in fromnodes to the corresponding node in tonodes. Memory
+ * mapped from frames is left in place, as the frames may be shared. Frames
+ * which cannot be moved are skipped. Only the calling domain is supported.
  */
 errval_t numa_migrate_pages(domainid_t did,
                             struct bitmap *fromnodes,
                             struct bitmap *tonodes);
 
+/**
+ * \brief returns the node on which a page resides
+ *
+ * \param page      address of the page
+ * \param ret_node  returns the node ID
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_PAGE_ABSENT if the page is not backed by memory
+ *          NUMA_ERR_PAGE_NODE if the memory is not on any node
+ */
+errval_t numa_get_page_node(void *page, nodeid_t *ret_node);
+
+struct vregion;
+
+/**
+ * \brief counts the pages of a vregion on each node
+ *
+ * \param vregion   the vregion
+ * \param pages     array of numa_max_node() + 1 counters, returns the number
+ *                  of pages on each node
+ * \param ret_other returns the number of pages which are not backed by memory
+ *                  or whose node cannot be determined
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ */
+errval_t numa_vregion_residency(struct vregion *vregion, size_t *pages,
+                                size_t *ret_other);
+
+/**
+ * \brief prints the number of pages on each node for all vregions of the
+ *        calling domain
+ */
+void numa_dump_residency(void);
+
+/*
+ * ----------------------------------------------------------------------------
+ * Automatic balancing
+ * ----------------------------------------------------------------------------
+ */
+
+///< default time between two sampling rounds in milliseconds
+#define NUMA_BALANCE_PERIOD_MS    100
+
+///< default number of sampling rounds before the samples are evaluated
+#define NUMA_BALANCE_SCAN_ROUNDS  4
+
+///< default and maximum number of frames sampled at a time
+#define NUMA_BALANCE_SAMPLES      64
+
+///< default number of faults from a node needed to move a frame there
+#define NUMA_BALANCE_MIN_FAULTS   3
+
+///< default number of frames moved per evaluation at most
+#define NUMA_BALANCE_MAX_MOVES    8
+
+/// parameters of the automatic balancing
+struct numa_balance_params {
+    uint32_t period_ms;     ///< time between two sampling rounds
+    uint32_t scan_rounds;   ///< sampling rounds before the samples are evaluated
+    uint32_t samples;       ///< number of frames sampled at a time
+    uint32_t min_faults;    ///< faults from a node needed to move a frame there
+    uint32_t max_moves;     ///< frames moved per evaluation at most
+};
+
+/// counters of the automatic balancing
+struct numa_balance_stats {
+    uint64_t rounds;        ///< sampling rounds
+    uint64_t sampled;       ///< frames sampled
+    uint64_t faults;        ///< faults on sampled frames
+    uint64_t local;         ///< faults from the node of the frame
+    uint64_t remote;        ///< faults from other nodes
+    uint64_t moved;         ///< frames moved
+    uint64_t failed;        ///< frames which could not be moved
+    uint64_t ratelimited;   ///< frames not moved due to the rate limit
+};
+
+/**
+ * \brief starts the automatic balancing of the memory of the calling domain
+ *
+ * \param params    parameters of the balancing, NULL for the defaults
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_BALANCE_RUNNING if the balancing is already running
+ *
+ * A thread on the calling core periodically write protects a sample of the
+ * frames of the anonymous memory of the domain, and counts the faults on them
+ * by the node of the faulting core. Frames that are mostly accessed from a
+ * remote node are moved to that node. Setting NUMA_BALANCING in the
+ * environment starts the balancing with the defaults in numa_available().
+ */
+errval_t numa_balance_start(struct numa_balance_params *params);
+
+/**
+ * \brief stops the automatic balancing
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_BALANCE_STOPPED if the balancing is not running
+ */
+errval_t numa_balance_stop(void);
+
+/**
+ * \brief returns the counters of the automatic balancing
+ *
+ * \param stats returns the counters
+ */
+void numa_balance_get_stats(struct numa_balance_stats *stats);
+
+/**
+ * \brief prints the counters of the automatic balancing
+ */
+void numa_balance_dump_stats(void);
+
 /**
  * is a libnuma internal function that can be overridden by the user program. This
  * function is called with a char * argument when a libnuma function fails.
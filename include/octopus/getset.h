@@ -44,4 +44,20 @@ errval_t oct_wait_for(char**, const char*, ...);
 
 errval_t oct_read(const char*, const char*, ...);
 
+/**
+ * \brief Continuation of an asynchronous call.
+ *
+ * \param st Argument given to the call.
+ * \param err Outcome of the call.
+ * \param record Record returned by the server or NULL, to be freed by the
+ * continuation.
+ */
+typedef void oct_async_cont_fn(void *st, errval_t err, char *record);
+
+errval_t oct_get_async(oct_async_cont_fn*, void*, const char*, ...);
+errval_t oct_mset_async(oct_async_cont_fn*, void*, oct_mode_t, const char*, ...);
+errval_t oct_del_async(oct_async_cont_fn*, void*, const char*, ...);
+errval_t oct_exists_async(oct_async_cont_fn*, void*, const char*, ...);
+errval_t oct_async_wait(size_t);
+
 #endif /* OCTOPUS_GETSET_H_ */
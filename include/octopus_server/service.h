@@ -49,6 +49,9 @@ struct oct_reply_state {
     octopus_mode_t mode;
     octopus_trigger_id_t server_id;
 
+    // Request ID echoed by the *_seq replies
+    uint64_t seq;
+
     // For capability storage
     struct capref cap;
 
@@ -66,6 +69,14 @@ void set_with_idcap_handler(struct octopus_binding*, struct capref, char*,
                             uint64_t, octopus_trigger_t, bool);
 void del_handler(struct octopus_binding*, char*, octopus_trigger_t);
 void exists_handler(struct octopus_binding*, char*, octopus_trigger_t);
+void get_seq_handler(struct octopus_binding*, uint64_t, char*,
+        octopus_trigger_t);
+void set_seq_handler(struct octopus_binding*, uint64_t, char*, uint64_t,
+        octopus_trigger_t, bool);
+void del_seq_handler(struct octopus_binding*, uint64_t, char*,
+        octopus_trigger_t);
+void exists_seq_handler(struct octopus_binding*, uint64_t, char*,
+        octopus_trigger_t);
 void wait_for_handler(struct octopus_binding*, char*);
 void remove_trigger_handler(struct octopus_binding*, octopus_trigger_id_t);
 
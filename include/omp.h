@@ -70,6 +70,19 @@ typedef enum omp_sched {
     OMP_SCHED_AUTO    = 4
 } omp_sched_t;
 
+/**
+ * BOMP reduction operations
+ */
+typedef enum bomp_reduce_op {
+    BOMP_REDUCE_NONE       = 0,  ///< barrier only
+    BOMP_REDUCE_ADD_INT    = 1,
+    BOMP_REDUCE_MIN_INT    = 2,
+    BOMP_REDUCE_MAX_INT    = 3,
+    BOMP_REDUCE_ADD_DOUBLE = 4,
+    BOMP_REDUCE_MIN_DOUBLE = 5,
+    BOMP_REDUCE_MAX_DOUBLE = 6
+} bomp_reduce_op_t;
+
 #if OMP_VERSION >= OMP_VERSION_40
 /**
  * OpenMP processor task affinitiy
@@ -175,6 +188,26 @@ static inline int bomp_init(unsigned int nthreads)
 
 
 
+/*
+ * BOMP reductions
+ */
+
+/**
+ * \brief combines a value of each thread of the team
+ *
+ * \param value     the contribution of the calling thread
+ * \param op        the operation to combine the values with
+ *
+ * \returns the combined value, in every thread
+ *
+ * All threads of the team have to call this function with the same operation.
+ * It is a barrier, and combines the values of the threads on the same NUMA
+ * node before combining the results of the nodes.
+ */
+int64_t bomp_reduce_int64(int64_t value, bomp_reduce_op_t op);
+double bomp_reduce_double(double value, bomp_reduce_op_t op);
+
+
 #if 0
 /*
  * Backend specific main thread runners
@@ -17,11 +17,27 @@ __BEGIN_DECLS
 
 errval_t skb_client_connect(void);
 errval_t skb_evaluate(char *query, char **result, char **str_error, int32_t *int_error);
+errval_t skb_evaluate_facts(char *facts, char **str_error, int32_t *int_error);
+errval_t skb_evaluate_cached(char *goal, char *args, char **result,
+                             char **str_error, int32_t *int_error);
 errval_t skb_add_fact(char *fmt, ...) __attribute__((format(printf, 1, 2)));
+errval_t skb_add_fact_batched(char *fmt, ...) __attribute__((format(printf, 1, 2)));
+errval_t skb_flush_facts(void);
 errval_t skb_set_memory_affinity(void);
 
 #define ELEMENT_NAME_BUF_SIZE 80
 #define SKB_REPLY_BUF_SIZE (128*1024)
+#define SKB_FACT_BATCH_SIZE (16*1024)
+
+/// Work done by the SKB server since it started
+struct skb_stats {
+    uint64_t queries;       ///< goals run, including cached ones
+    uint64_t facts;         ///< facts asserted in batches
+    uint64_t fact_batches;  ///< batches of facts
+    uint64_t cache_hits;    ///< cached goals run without compiling
+    uint64_t cache_misses;  ///< cached goals compiled on first use
+    uint64_t cycles;        ///< cycles spent running goals
+};
 
 struct list_parser_status {
     char *s;
@@ -37,6 +53,8 @@ char *skb_get_output(void);
 char *skb_get_error_output(void);
 errval_t skb_execute(char *goal);
 errval_t skb_execute_query(char *fmt, ...) __attribute__((format(printf, 1, 2)));
+errval_t skb_execute_cached(char *goal, char *fmt, ...) __attribute__((format(printf, 2, 3)));
+errval_t skb_get_stats(struct skb_stats *stats);
 errval_t skb_read_output_at(char *output, char *fmt, ...) __attribute__((format(scanf, 2, 3)));
 errval_t skb_vread_output_at(char *output, char *fmt, va_list va_l);
 errval_t skb_read_output(char *fmt, ...) __attribute__((format(scanf, 1, 2)));
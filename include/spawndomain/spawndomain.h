@@ -44,6 +44,8 @@ struct spawninfo {
     struct vregion *vregion[16];
     genvaddr_t base[16];
     unsigned int vregions;
+    uint32_t segflags[16];  ///< ELF flags of the segment in each vregion
+    cslot_t segslot[16];    ///< first frame of each vregion in segcn
 
     dispatcher_handle_t handle;
     enum cpu_type cpu_type;
@@ -70,6 +72,39 @@ struct spawninfo {
     uint8_t flags;
 };
 
+/// A loaded segment of a cached image
+struct spawn_image_segment {
+    genvaddr_t base;        ///< page-aligned base address in the domain
+    size_t size;            ///< page-aligned size
+    uint32_t flags;         ///< ELF segment flags
+    struct capref *frames;  ///< frames of a read-only segment, shared
+    size_t nframes;
+    struct capref data_frame; ///< copy of the contents of a writable segment
+    void *data;             ///< mapping of data_frame
+};
+
+#define SPAWN_IMAGE_MAX_SEGMENTS 16
+
+/**
+ * \brief An ELF image loaded and relocated once, to spawn further domains
+ *
+ * Filled in by the first spawn_load_image_cached() with the image, and used
+ * by later calls instead of loading the ELF file again.
+ */
+struct spawn_image {
+    bool cached;            ///< segments are valid
+    bool omp_parsed;        ///< OpenMP functions have been registered
+    genvaddr_t entry;
+    genvaddr_t tls_init_base;
+    size_t tls_init_len, tls_total_len;
+    genvaddr_t eh_frame;
+    size_t eh_frame_size;
+    genvaddr_t eh_frame_hdr;
+    size_t eh_frame_hdr_size;
+    struct spawn_image_segment seg[SPAWN_IMAGE_MAX_SEGMENTS];
+    unsigned int nsegs;
+};
+
 #define SPAWN_FLAGS_DEFAULT (0)
 #define SPAWN_FLAGS_NEW_DOMAIN    (1 << 0) ///< allocate a new domain ID
 #define SPAWN_FLAGS_OMP           (1 << 1) ///< do the OpenMP parsing
@@ -90,9 +125,22 @@ errval_t spawn_load_image(struct spawninfo *si, lvaddr_t binary,
                           const char *name, coreid_t coreid,
                           char *const argv[], char *const envp[],
                           struct capref inheritcn_cap, struct capref argcn_cap);
+bool spawn_image_needs_binary(struct spawn_image *img, uint8_t flags);
+errval_t spawn_load_image_cached(struct spawninfo *si,
+                                 struct spawn_image *img, lvaddr_t binary,
+                                 size_t binary_size, enum cpu_type type,
+                                 const char *name, coreid_t coreid,
+                                 char *const argv[], char *const envp[],
+                                 struct capref inheritcn_cap,
+                                 struct capref argcn_cap);
 errval_t spawn_run(struct spawninfo *si);
 errval_t spawn_free(struct spawninfo *si);
 
+/* spawn_image.c */
+errval_t spawn_image_capture(struct spawninfo *si, struct spawn_image *img,
+                             genvaddr_t entry);
+void spawn_image_free(struct spawn_image *img);
+
 errval_t multiboot_cleanup_mapping(void);
 
 /* spawn_vspace.c */
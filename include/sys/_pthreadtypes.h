@@ -58,11 +58,11 @@ struct pthread_mutex_attr;
 struct pthread_rwlock;
 struct pthread_rwlockattr;
 typedef struct {
-	int count;
-	int max_count;
-	struct thread_sem mutex;
-	struct thread_sem barrier;
-	struct thread_sem reset;
+	volatile unsigned count;	/* threads yet to arrive */
+	unsigned max_count;
+	volatile int sense;		/* flipped by the last thread to arrive */
+	struct thread_mutex mutex;	/* for threads that stop spinning */
+	struct thread_cond cond;
 } pthread_barrier_t;
 struct pthread_barrier_attr;
 struct pthread_spinlock;
@@ -10,6 +10,8 @@
 typedef int errval_t;
 #define SYS_ERR_OK   0
 #define THC_CANCELED 1
+#else
+#include <barrelfish/barrelfish.h>
 #endif
 
 // The implementation of do..finish relies on shadowing so that 
@@ -262,6 +264,40 @@ void THCYield(void);
 // to THCYieldTo on the run-queue.)
 void THCYieldTo(awe_t *awe_ptr);
 
+// Worker pool.  THCPoolYield finishes the current AWE and makes its
+// continuation available to the idle threads of the pool, each of which
+// runs its own THC dispatch loop on a different dispatcher of the domain.
+// Idle threads take the oldest such AWEs from other threads (work
+// stealing), and a thread takes its own most recent AWE back first.
+//
+// The intended use is at the start of an ASYNC body, after copying any
+// variables of the enclosing scope that the body needs:
+//
+//   DO_FINISH({
+//     for (int i = 0; i < n; i++) {
+//       ASYNC({ int j = i; THCPoolYield(); work(j); });
+//     }
+//   });
+//
+// The enclosing DO_FINISH joins such bodies wherever they end.  A body
+// that has been passed to the pool may continue on any dispatcher of the
+// pool, so it must not use bindings or waitsets tied to its original
+// dispatcher, nor cancel items.  Without a running pool THCPoolYield
+// returns immediately.
+void THCPoolYield(void);
+
+#ifdef BARRELFISH
+// Start a pool with one worker thread on each of the given cores.  The
+// domain is spanned to any of these cores it is not running on yet.  The
+// calling thread becomes part of the pool, and while the pool runs it
+// polls its waitset rather than blocking when it is idle.
+errval_t THCPoolStart(coreid_t *cores, int ncores);
+
+// Stop the workers of the pool started by THCPoolStart.  Work passed to
+// the pool should have completed (e.g., by an enclosing DO_FINISH).
+errval_t THCPoolStop(void);
+#endif
+
 // Cancellation actions.  These are executed in LIFO order when cancellation 
 // occurs.  Once cancellation has been requested, it is assumed that no
 // further cancellation actions will be added.  Cancellation actions can be 
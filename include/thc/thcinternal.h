@@ -84,6 +84,11 @@ struct finish_t {
   finish_t       *enclosing_fb;
   void           *enclosing_lazy_stack;
   cancel_item_t  *cancel_item;
+
+  // Latch serializing the last _thc_endasync against the finish block
+  // registering its waiting AWE.  Async calls of a finish block may end
+  // on other threads once they have been passed to the worker pool.
+  struct thc_latch latch;
 };
 
 /***********************************************************************/
@@ -157,6 +162,7 @@ struct ptstate_t {
   int lock;
   int sendCount;
   int recvCount;
+  int aweStolen;
 #endif
 
   // Shared fields: ...................................................
@@ -169,6 +175,12 @@ struct ptstate_t {
   // this thread
   awe_t aweRemoteHead;
   awe_t aweRemoteTail;
+
+  // Head/tail sentinels of the list of AWEs passed to the worker pool
+  // by THCPoolYield.  The owner takes work from the head, idle threads
+  // of the pool steal from the tail.
+  awe_t awePoolHead;
+  awe_t awePoolTail;
 };
 
 typedef void (*THCContFn_t)(void *cont, void *args);
@@ -17,16 +17,25 @@
 
 __BEGIN_DECLS
 
+struct vfs_pagecache;
+
 struct memobj_vfs {
-    struct memobj_anon anon; // underlying anon memobj that manages the frames
+    struct memobj_pagecache pc; // underlying memobj that maps cached pages
+    struct vfs_pagecache *cache; // page cache of the file
+    struct capref zero_frame; // page mapped above filesize, if allocated
+    struct capref tail_frame; // last partial page of file data, if allocated
     vfs_handle_t vh; // VFS handle for file
-    off_t offset; // offset within file
+    off_t offset; // offset within file, page-aligned
     size_t filesize; // size to read from file (rest is zero-filled)
+    struct memobj_vfs *next_user; // next memobj using the same page cache
 };
 
 errval_t memobj_create_vfs(struct memobj_vfs *memobj, size_t size,
                            memobj_flags_t flags, vfs_handle_t vh, off_t offset,
                            size_t filesize);
+errval_t memobj_create_vfs_shared(struct memobj_vfs *memobj, size_t size,
+                                  memobj_flags_t flags, const char *path,
+                                  off_t offset, size_t filesize);
 errval_t memobj_destroy_vfs(struct memobj *memobj);
 errval_t memobj_flush_vfs(struct memobj *memobj, struct vregion *vregion);
 
@@ -34,6 +43,10 @@ errval_t vspace_map_file(size_t size, vregion_flags_t flags,
                          vfs_handle_t file, off_t offset, size_t filesize,
                          struct vregion **ret_vregion,
                          struct memobj **ret_memobj);
+errval_t vspace_map_file_shared(size_t size, vregion_flags_t flags,
+                                const char *path, off_t offset,
+                                size_t filesize, struct vregion **ret_vregion,
+                                struct memobj **ret_memobj);
 errval_t vspace_map_file_fixed(genvaddr_t base, size_t size,
                                vregion_flags_t flags, vfs_handle_t file,
                                off_t offset, size_t filesize,
@@ -52,6 +52,17 @@ struct vfs_fileinfo {
     size_t size;            ///< Size of the object (in bytes, for a regular file)
 };
 
+/// One element of a scatter-gather list for vectored I/O
+struct vfs_iovec {
+    void *base;             ///< Start of buffer
+    size_t len;             ///< Length of buffer in bytes
+};
+
+/// Completion callback for asynchronous I/O, run on the request's waitset
+typedef void (*vfs_io_callback_t)(void *arg, errval_t err, size_t bytes);
+
+struct waitset;
+
 __BEGIN_DECLS
 
 // initialization
@@ -72,6 +83,20 @@ errval_t vfs_stat(vfs_handle_t handle, struct vfs_fileinfo *info);
 errval_t vfs_close(vfs_handle_t handle);
 errval_t vfs_flush(vfs_handle_t handle);
 
+// vectored and asynchronous I/O on file handles
+errval_t vfs_readv(vfs_handle_t handle, const struct vfs_iovec *iov,
+                   size_t iovcnt, size_t *bytes_read);
+errval_t vfs_writev(vfs_handle_t handle, const struct vfs_iovec *iov,
+                    size_t iovcnt, size_t *bytes_written);
+errval_t vfs_read_async(vfs_handle_t handle, size_t offset,
+                        const struct vfs_iovec *iov, size_t iovcnt,
+                        struct waitset *ws, vfs_io_callback_t cb, void *arg);
+errval_t vfs_write_async(vfs_handle_t handle, size_t offset,
+                         const struct vfs_iovec *iov, size_t iovcnt,
+                         struct waitset *ws, vfs_io_callback_t cb, void *arg);
+errval_t vfs_io_set_depth(vfs_handle_t handle, size_t depth);
+errval_t vfs_io_drain(vfs_handle_t handle);
+
 // manipulation of directories
 errval_t vfs_mkdir(const char *path); // fail if already present
 errval_t vfs_rmdir(const char *path); // fail if not empty
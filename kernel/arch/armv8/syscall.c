@@ -478,6 +478,32 @@ INVOCATION_HANDLER(monitor_handle_clear_step)
     return sys_monitor_clear_step(ret_cn_addr, ret_cn_bits, ret_slot);
 }
 
+INVOCATION_HANDLER(monitor_handle_delete_steps)
+{
+    INVOCATION_PRELUDE(7);
+    capaddr_t ret_cn_addr = sa->arg2;
+    capaddr_t ret_cn_bits = sa->arg3;
+    capaddr_t ret_slot    = sa->arg4;
+    cslot_t nslots        = sa->arg5;
+    uint64_t budget       = sa->arg6;
+
+    return sys_monitor_delete_steps(ret_cn_addr, ret_cn_bits, ret_slot,
+                                    nslots, budget);
+}
+
+INVOCATION_HANDLER(monitor_handle_clear_steps)
+{
+    INVOCATION_PRELUDE(7);
+    capaddr_t ret_cn_addr = sa->arg2;
+    capaddr_t ret_cn_bits = sa->arg3;
+    capaddr_t ret_slot    = sa->arg4;
+    cslot_t nslots        = sa->arg5;
+    uint64_t budget       = sa->arg6;
+
+    return sys_monitor_clear_steps(ret_cn_addr, ret_cn_bits, ret_slot,
+                                   nslots, budget);
+}
+
 
 static struct sysret
 monitor_get_core_id(
@@ -858,11 +884,13 @@ static invocation_t invocations[ObjType_Num][CAP_MAX_CMD] = {
     [ObjType_Kernel] = {
         [KernelCmd_Cap_has_relations] = monitor_cap_has_relations,
         [KernelCmd_Clear_step]        = monitor_handle_clear_step,
+        [KernelCmd_Clear_steps]       = monitor_handle_clear_steps,
         [KernelCmd_Copy_existing]     = monitor_copy_existing,
         [KernelCmd_Create_cap]        = monitor_create_cap,
         [KernelCmd_Delete_foreigns]   = monitor_handle_delete_foreigns,
         [KernelCmd_Delete_last]       = monitor_handle_delete_last,
         [KernelCmd_Delete_step]       = monitor_handle_delete_step,
+        [KernelCmd_Delete_steps]      = monitor_handle_delete_steps,
         [KernelCmd_Domain_Id]         = monitor_handle_domain_id,
         [KernelCmd_Get_arch_id]       = monitor_get_arch_id,
         [KernelCmd_Get_cap_owner]     = monitor_get_cap_owner,
@@ -739,10 +739,20 @@ static __attribute__ ((used))
         __asm volatile("mov %%cr2, %[fault_address]"
                        : [fault_address] "=r" (fault_address));
 
-        printk(LOG_WARN, "user page fault%s in '%.*s': addr %lx IP %lx SP %lx "
-                         "error 0x%lx\n",
-               disabled ? " WHILE DISABLED" : "", DISP_NAME_LEN,
-               disp->name, fault_address, rip, rsp, error);
+        // a domain with a page fault fixup (e.g. NUMA balancing) takes
+        // faults as part of normal operation, and warns about those its
+        // fixup does not claim itself
+        if (disp->pagefault_fixup) {
+            debug(SUBSYS_DISPATCH, "user page fault%s in '%.*s': addr %lx "
+                  "IP %lx SP %lx error 0x%lx\n",
+                  disabled ? " WHILE DISABLED" : "", DISP_NAME_LEN,
+                  disp->name, fault_address, rip, rsp, error);
+        } else {
+            printk(LOG_WARN, "user page fault%s in '%.*s': addr %lx IP %lx SP %lx "
+                             "error 0x%lx\n",
+                   disabled ? " WHILE DISABLED" : "", DISP_NAME_LEN,
+                   disp->name, fault_address, rip, rsp, error);
+        }
 
         /* sanity-check that the trap handler saved in the right place */
         assert((disabled && disp_save_area == dispatcher_get_trap_save_area(handle))
@@ -350,6 +350,30 @@ static struct sysret monitor_handle_clear_step(struct capability *kernel_cap,
     return sys_monitor_clear_step(ret_cn_addr, ret_cn_bits, ret_slot);
 }
 
+static struct sysret monitor_handle_delete_steps(struct capability *kernel_cap,
+                                                 int cmd, uintptr_t *args)
+{
+    capaddr_t ret_cn_addr = args[0];
+    capaddr_t ret_cn_bits = args[1];
+    capaddr_t ret_slot = args[2];
+    cslot_t nslots = args[3];
+    uint64_t budget = args[4];
+    return sys_monitor_delete_steps(ret_cn_addr, ret_cn_bits, ret_slot,
+                                    nslots, budget);
+}
+
+static struct sysret monitor_handle_clear_steps(struct capability *kernel_cap,
+                                                int cmd, uintptr_t *args)
+{
+    capaddr_t ret_cn_addr = args[0];
+    capaddr_t ret_cn_bits = args[1];
+    capaddr_t ret_slot = args[2];
+    cslot_t nslots = args[3];
+    uint64_t budget = args[4];
+    return sys_monitor_clear_steps(ret_cn_addr, ret_cn_bits, ret_slot,
+                                   nslots, budget);
+}
+
 static struct sysret monitor_handle_register(struct capability *kernel_cap,
                                              int cmd, uintptr_t *args)
 {
@@ -1137,6 +1161,8 @@ static invocation_handler_t invocations[ObjType_Num][CAP_MAX_CMD] = {
         [KernelCmd_Revoke_mark_relations] = monitor_handle_revoke_mark_rels,
         [KernelCmd_Delete_step] = monitor_handle_delete_step,
         [KernelCmd_Clear_step] = monitor_handle_clear_step,
+        [KernelCmd_Delete_steps] = monitor_handle_delete_steps,
+        [KernelCmd_Clear_steps] = monitor_handle_clear_steps,
         [KernelCmd_Sync_timer]   = monitor_handle_sync_timer,
         [KernelCmd_IPI_Register] = kernel_ipi_register,
         [KernelCmd_IPI_Delete]   = kernel_ipi_delete,
@@ -28,6 +28,7 @@
 #include <mdb/mdb_tree.h>
 #include <trace/trace.h>
 #include <wakeup.h>
+#include <misc.h>
 
 struct cte *clear_head, *clear_tail;
 struct cte *delete_head, *delete_tail;
@@ -631,6 +632,94 @@ errval_t caps_clear_step(struct cte *ret_ram_cap)
     return err;
 }
 
+/*
+ * Batched delete and clear steps
+ */
+
+/// Upper bound on the cycles spent in one batch of steps, so that large
+/// revocations stay preemptible
+#define DELETE_STEPS_MAX_CYCLES (1UL << 20)
+
+/// Estimated cost of a step on architectures without a cycle counter
+#define DELETE_STEP_CYCLES      2048
+
+typedef errval_t (*delete_step_fn)(struct cte *ret_cte);
+
+static errval_t caps_steps(delete_step_fn step, struct cte *ret_slots,
+                           size_t nslots, uint64_t budget, size_t *ret_count)
+{
+    errval_t err = SYS_ERR_OK;
+    size_t count = 0;
+
+    assert(nslots > 0);
+    if (budget > DELETE_STEPS_MAX_CYCLES) {
+        budget = DELETE_STEPS_MAX_CYCLES;
+    }
+
+#ifdef arch_get_cycle_count
+    uint64_t start = arch_get_cycle_count();
+#else
+    uint64_t spent = 0;
+#endif
+
+    while (count < nslots) {
+        err = step(&ret_slots[count]);
+        if (err_no(err) == SYS_ERR_RAM_CAP_CREATED) {
+            count++;
+            err = SYS_ERR_OK;
+        }
+        else if (err_is_fail(err)) {
+            break;
+        }
+
+#ifdef arch_get_cycle_count
+        if (arch_get_cycle_count() - start >= budget) {
+            break;
+        }
+#else
+        spent += DELETE_STEP_CYCLES;
+        if (spent >= budget) {
+            break;
+        }
+#endif
+    }
+
+    *ret_count = count;
+    return err;
+}
+
+/**
+ * \brief Perform delete steps until the delete list is empty, a step needs
+ *        the monitor, or the cycle budget is spent.
+ *
+ * \param ret_slots Empty slots that receive the reclaimed RAM caps
+ * \param nslots    Number of slots in ret_slots
+ * \param budget    Cycles to spend, at most DELETE_STEPS_MAX_CYCLES
+ * \param ret_count Returns the number of RAM caps placed in ret_slots
+ *
+ * \returns SYS_ERR_OK if the budget or the slots ran out, otherwise the
+ *          result of the step that ended the batch. On
+ *          SYS_ERR_DELETE_LAST_OWNED, the cap to delete is in
+ *          ret_slots[*ret_count].
+ */
+errval_t caps_delete_steps(struct cte *ret_slots, size_t nslots,
+                           uint64_t budget, size_t *ret_count)
+{
+    return caps_steps(caps_delete_step, ret_slots, nslots, budget, ret_count);
+}
+
+/**
+ * \brief Perform clear steps until the clear list is empty or the cycle
+ *        budget is spent.
+ *
+ * Same parameters and results as caps_delete_steps().
+ */
+errval_t caps_clear_steps(struct cte *ret_slots, size_t nslots,
+                          uint64_t budget, size_t *ret_count)
+{
+    return caps_steps(caps_clear_step, ret_slots, nslots, budget, ret_count);
+}
+
 static errval_t caps_copyout_last(struct cte *target, struct cte *ret_cte)
 {
     errval_t err;
@@ -126,6 +126,10 @@ errval_t caps_delete_foreigns(struct cte *cte);
 errval_t caps_mark_revoke(struct capability *base, struct cte *revoked);
 errval_t caps_delete_step(struct cte *ret_next);
 errval_t caps_clear_step(struct cte *ret_ram_cap);
+errval_t caps_delete_steps(struct cte *ret_slots, size_t nslots,
+                           uint64_t budget, size_t *ret_count);
+errval_t caps_clear_steps(struct cte *ret_slots, size_t nslots,
+                          uint64_t budget, size_t *ret_count);
 errval_t caps_delete(struct cte *cte);
 errval_t caps_revoke(struct cte *cte);
 
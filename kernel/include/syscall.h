@@ -113,5 +113,13 @@ struct sysret sys_monitor_delete_step(capaddr_t ret_cn_addr,
 struct sysret sys_monitor_clear_step(capaddr_t ret_cn_addr,
                                      uint8_t ret_cn_bits,
                                      cslot_t ret_slot);
+struct sysret sys_monitor_delete_steps(capaddr_t ret_cn_addr,
+                                       uint8_t ret_cn_bits,
+                                       cslot_t ret_slot, cslot_t nslots,
+                                       uint64_t budget);
+struct sysret sys_monitor_clear_steps(capaddr_t ret_cn_addr,
+                                      uint8_t ret_cn_bits,
+                                      cslot_t ret_slot, cslot_t nslots,
+                                      uint64_t budget);
 
 #endif
@@ -447,3 +447,74 @@ struct sysret sys_monitor_clear_step(capaddr_t ret_cn_addr,
 
     return SYSRET(caps_clear_step(retslot));
 }
+
+static errval_t sys_retslots_lookup(capaddr_t cnptr, uint8_t cnbits,
+                                    cslot_t slot, cslot_t nslots,
+                                    struct cte **cte)
+{
+    errval_t err;
+
+    struct capability *retcn;
+    err = caps_lookup_cap(&dcb_current->cspace.cap, cnptr, cnbits, &retcn, CAPRIGHTS_WRITE);
+    if (err_is_fail(err)) {
+        return err_push(err, SYS_ERR_DEST_CNODE_LOOKUP);
+    }
+
+    if (retcn->type != ObjType_CNode) {
+        return SYS_ERR_DEST_CNODE_INVALID;
+    }
+    if (nslots == 0 || slot >= (1UL << retcn->u.cnode.bits) ||
+        nslots > (1UL << retcn->u.cnode.bits) - slot) {
+        return SYS_ERR_SLOTS_INVALID;
+    }
+
+    struct cte *retslots;
+    retslots = caps_locate_slot(retcn->u.cnode.cnode, slot);
+
+    for (cslot_t i = 0; i < nslots; i++) {
+        if (retslots[i].cap.type != ObjType_Null) {
+            return SYS_ERR_SLOT_IN_USE;
+        }
+    }
+
+    *cte = retslots;
+    return SYS_ERR_OK;
+}
+
+struct sysret sys_monitor_delete_steps(capaddr_t ret_cn_addr,
+                                       uint8_t ret_cn_bits,
+                                       cslot_t ret_slot, cslot_t nslots,
+                                       uint64_t budget)
+{
+    errval_t err;
+
+    struct cte *retslots;
+    err = sys_retslots_lookup(ret_cn_addr, ret_cn_bits, ret_slot, nslots,
+                              &retslots);
+    if (err_is_fail(err)) {
+        return SYSRET(err);
+    }
+
+    size_t count;
+    err = caps_delete_steps(retslots, nslots, budget, &count);
+    return (struct sysret) { .error = err, .value = count };
+}
+
+struct sysret sys_monitor_clear_steps(capaddr_t ret_cn_addr,
+                                      uint8_t ret_cn_bits,
+                                      cslot_t ret_slot, cslot_t nslots,
+                                      uint64_t budget)
+{
+    errval_t err;
+
+    struct cte *retslots;
+    err = sys_retslots_lookup(ret_cn_addr, ret_cn_bits, ret_slot, nslots,
+                              &retslots);
+    if (err_is_fail(err)) {
+        return SYSRET(err);
+    }
+
+    size_t count;
+    err = caps_clear_steps(retslots, nslots, budget, &count);
+    return (struct sysret) { .error = err, .value = count };
+}
@@ -426,7 +426,9 @@ errval_t ahci_issue_command(struct ahci_binding *_binding,
     }
     err = ahci_setup_command(&command, port, fis, fis_length, num_prds, is_write);
     if (err_is_fail(err)) {
-        DEBUG_ERR(err, "ahci_setup_command failed");
+        if (err_no(err) != AHCI_ERR_NO_FREE_SLOT) {
+            DEBUG_ERR(err, "ahci_setup_command failed");
+        }
         return err;
     }
 
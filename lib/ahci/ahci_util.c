@@ -83,8 +83,10 @@ errval_t ahci_setup_command(int *command, struct ahci_port_info *port,
             command, port, fis, fis_length, num_prds, is_write);
 
     int command_slot = ahci_find_free_command_slot(port);
-    assert(command_slot != -1); //TODO: what to do if we run out of slots? wait?
-    port->command_slots[command_slot].in_use = true;
+    if (command_slot == -1) {
+        // the caller may retry once a command has completed
+        return AHCI_ERR_NO_FREE_SLOT;
+    }
 
     // setup command table w/ enough entries for PRDs
     size_t prdt_size = num_prds*ahci_port_prd_size;
@@ -95,6 +97,7 @@ errval_t ahci_setup_command(int *command, struct ahci_port_info *port,
         DEBUG_ERR(r, "failed to allocate memory for command table");
         return r;
     }
+    port->command_slots[command_slot].in_use = true;
     port->command_slots[command_slot].command_table = ct;
 
 
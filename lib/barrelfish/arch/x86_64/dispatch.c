@@ -118,6 +118,58 @@ void disp_resume(dispatcher_handle_t handle, arch_registers_state_t *archregs)
     __asm volatile ("disp_resume_end:");
 }
 
+/**
+ * \brief Resume execution of a given register state, staying disabled
+ *
+ * This resumes disabled code from the trap save area after a page fault taken
+ * while disabled has been fixed up. It may only be called while the dispatcher
+ * is disabled.
+ *
+ * \param regs Register state snapshot
+ */
+void disp_resume_disabled(arch_registers_state_t *archregs)
+{
+    struct registers_x86_64 *regs = archregs;
+    assert_disabled(regs->rip > BASE_PAGE_SIZE);
+    assert_disabled((regs->eflags & USER_EFLAGS) == USER_EFLAGS); // flags
+
+    // Resume execution of the disabled code. Unlike in disp_resume(), the
+    // dispatcher stays disabled, so there is no critical section.
+    __asm volatile ("mov        %[fs], %%ax             \n\t"
+                    "mov        %%ax, %%fs              \n\t"
+                    "mov        %[gs], %%ax             \n\t"
+                    "mov        %%ax, %%gs              \n\t"
+                    "movq        0*8(%[regs]), %%rax    \n\t"
+                    "movq        2*8(%[regs]), %%rcx    \n\t"
+                    "movq        3*8(%[regs]), %%rdx    \n\t"
+                    "movq        4*8(%[regs]), %%rsi    \n\t"
+                    "movq        5*8(%[regs]), %%rdi    \n\t"
+                    "movq        6*8(%[regs]), %%rbp    \n\t"
+                    "movq        8*8(%[regs]), %%r8     \n\t"
+                    "movq        9*8(%[regs]), %%r9     \n\t"
+                    "movq       10*8(%[regs]), %%r10    \n\t"
+                    "movq       11*8(%[regs]), %%r11    \n\t"
+                    "movq       12*8(%[regs]), %%r12    \n\t"
+                    "movq       13*8(%[regs]), %%r13    \n\t"
+                    "movq       14*8(%[regs]), %%r14    \n\t"
+                    "movq       15*8(%[regs]), %%r15    \n\t"
+                    "pushq      %[ss]                   \n\t"   // SS
+                    "pushq       7*8(%[regs])           \n\t"   // RSP
+                    "pushq      17*8(%[regs])           \n\t"   // RFLAGS
+                    "pushq      %[cs]                   \n\t"   // CS
+                    "pushq      16*8(%[regs])           \n\t"   // RIP
+                    "movq        1*8(%[regs]), %%rbx    \n\t"   // RBX was base register
+                    "iretq                              \n\t"
+                    : /* No output */
+                    :
+                    [regs] "b" (regs),
+                    [ss] "i" (USER_SS),
+                    [cs] "i" (USER_CS),
+                    [fs] "m" (regs->fs),
+                    [gs] "m" (regs->gs)
+                    );
+}
+
 /**
  * \brief Switch execution between two register states, and turn off
  * disabled activations.
@@ -374,6 +374,63 @@ errval_t cap_revoke(struct capref cap)
     }
 }
 
+/// Max. number of caps revoked by one monitor RPC
+#define REVOKE_MULTI_MAX 128
+
+/**
+ * \brief Revoke a set of capabilities
+ *
+ * \param caps  Capabilities to be revoked
+ * \param count Number of capabilities
+ *
+ * Same as calling cap_revoke() on each capability, but the monitors revoke
+ * up to REVOKE_MULTI_MAX capabilities with one round of messages between
+ * them.
+ */
+errval_t cap_revoke_multi(struct capref *caps, size_t count)
+{
+    struct monitor_blocking_rpc_client *mrc = get_monitor_blocking_rpc_client();
+    if (!mrc) {
+        return LIB_ERR_MONITOR_RPC_NULL;
+    }
+
+    uint64_t batch[REVOKE_MULTI_MAX];
+    errval_t err, remote_cap_err = SYS_ERR_OK;
+
+    for (size_t done = 0; done < count; ) {
+        size_t n = count - done;
+        if (n > REVOKE_MULTI_MAX) {
+            n = REVOKE_MULTI_MAX;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            uint8_t vbits = get_cap_valid_bits(caps[done + i]);
+            capaddr_t caddr = get_cap_addr(caps[done + i]) >> (CPTR_BITS - vbits);
+            batch[i] = ((uint64_t)caddr << 8) | vbits;
+        }
+
+        int retries = 0;
+        do {
+            err = mrc->vtbl.remote_cap_revoke_multi(mrc, cap_root,
+                                                    (uint8_t *)batch,
+                                                    n * sizeof(uint64_t),
+                                                    &remote_cap_err);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "remote cap revoke\n");
+                return err;
+            }
+        } while (err_no(remote_cap_err) == MON_ERR_REMOTE_CAP_RETRY
+                 && backoff(++retries));
+
+        if (err_is_fail(remote_cap_err)) {
+            return remote_cap_err;
+        }
+        done += n;
+    }
+
+    return SYS_ERR_OK;
+}
+
 /**
  * \brief Destroy a capability, i.e. delete it and free the slot.
  *
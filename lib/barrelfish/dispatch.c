@@ -60,6 +60,9 @@ static inline void assert_print(const char *str)
     sys_print(str, strlen(str));
 }
 
+/// Page fault fixup, called before faults are delivered to the thread
+static pagefault_fixup_fn pagefault_fixup = NULL;
+
 static uint64_t run_counter = 0;
 uint64_t disp_run_counter(void)
 {
@@ -101,6 +104,9 @@ void disp_run(dispatcher_handle_t handle)
     // Trigger any deferred events
     trigger_deferred_events_disabled(handle, disp->systime);
 
+    // Tell the kernel whether a fixup reports our page faults
+    disp->pagefault_fixup = (pagefault_fixup != NULL);
+
 #ifdef CONFIG_INTERCONNECT_DRIVER_LMP
     // Check for incoming LMP messages
     if (disp->lmp_delivered != disp->lmp_seen) {
@@ -276,6 +282,28 @@ uint8_t disp_xeon_phi_id(void)
 }
 #endif
 
+/**
+ * \brief Sets the page fault fixup of the domain
+ *
+ * \param fixup New fixup function, or NULL to deliver all faults
+ *
+ * \returns the previous fixup function
+ *
+ * The fixup sees every page fault of the domain, on all its dispatchers,
+ * before the exception handler of the faulting thread. This lets libraries
+ * use page protection transparently to the application. While a fixup is
+ * set, the kernel does not warn about user page faults; the faults the fixup
+ * does not claim are reported here instead. Other dispatchers of the domain
+ * pick this up the next time they run.
+ */
+pagefault_fixup_fn disp_set_pagefault_fixup(pagefault_fixup_fn fixup)
+{
+    pagefault_fixup_fn old = pagefault_fixup;
+    pagefault_fixup = fixup;
+    get_dispatcher_shared_generic(curdispatcher())->pagefault_fixup =
+        (fixup != NULL);
+    return old;
+}
 
 /**
  * \brief Page fault entry point
@@ -323,6 +351,22 @@ void disp_pagefault(dispatcher_handle_t handle, lvaddr_t fault_address,
     // sanity-check that we were on a thread
     assert_disabled(disp_gen->current != NULL);
 
+    // retry the access if the fault was fixed up
+    pagefault_fixup_fn fixup = pagefault_fixup;
+    if (disp->pagefault_fixup && fixup != NULL) {
+        if (fixup((void *)fault_address, fault_type, false)) {
+            disp_resume(handle, regs);
+        }
+
+        // the kernel left the warning to us
+        static char str[256];
+        snprintf(str, sizeof(str), "user page fault in '%.*s': addr %"
+                 PRIxPTR " IP %" PRIxPTR " SP %" PRIxPTR " error 0x%"
+                 PRIxPTR "\n", DISP_NAME_LEN, disp->name, fault_address, ip,
+                 registers_get_sp(regs), error);
+        assert_print(str);
+    }
+
     // Save FPU context if used
 #ifdef FPU_LAZY_CONTEXT_SWITCH
     if (disp_gen->fpu_thread == disp_gen->current) {
@@ -384,6 +428,19 @@ void disp_pagefault_disabled(dispatcher_handle_t handle, lvaddr_t fault_address,
 {
     struct dispatcher_shared_generic *disp =
         get_dispatcher_shared_generic(handle);
+
+#ifdef __x86_64__
+    // retry the access if the fault was fixed up
+    pagefault_fixup_fn fixup = pagefault_fixup;
+    if (disp->pagefault_fixup && fixup != NULL) {
+        enum pagefault_exception_type fault_type =
+            (error & (1 << 1)) ? PAGEFLT_WRITE : PAGEFLT_READ;
+        if (fixup((void *)fault_address, fault_type, true)) {
+            disp_resume_disabled(dispatcher_get_trap_save_area(handle));
+        }
+    }
+#endif
+
     static char str[256];
     snprintf(str, 256, "%.*s: page fault WHILE DISABLED"
              " (error code 0x%" PRIxPTR ") on %" PRIxPTR " at IP %" PRIxPTR "\n",
@@ -0,0 +1,162 @@
+/**
+ * \file
+ * \brief Bookkeeping of outstanding calls for asynchronous RPC clients
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset.h>
+#include <flounder/flounder_rpc_async.h>
+
+/**
+ * \brief initialises the asynchronous call state of an RPC client
+ */
+void flounder_rpc_async_init(struct flounder_rpc_async *as)
+{
+    as->head = NULL;
+    as->tail = NULL;
+    as->free = NULL;
+    as->next_seq = 1;
+    as->outstanding = 0;
+}
+
+/**
+ * \brief allocates a call record and assigns it the next request ID
+ *
+ * \returns call record, or NULL if out of memory
+ */
+struct flounder_rpc_pending *flounder_rpc_pending_alloc(struct flounder_rpc_async *as)
+{
+    struct flounder_rpc_pending *p = as->free;
+
+    if (p != NULL) {
+        as->free = p->next;
+    } else {
+        p = malloc(sizeof(*p));
+        if (p == NULL) {
+            return NULL;
+        }
+    }
+
+    p->next = NULL;
+    p->seq = as->next_seq++;
+    return p;
+}
+
+/**
+ * \brief returns a call record which is not outstanding to the free list
+ */
+void flounder_rpc_pending_free(struct flounder_rpc_async *as,
+                               struct flounder_rpc_pending *p)
+{
+    p->next = as->free;
+    as->free = p;
+}
+
+/**
+ * \brief appends a call record to the outstanding calls
+ */
+void flounder_rpc_pending_enqueue(struct flounder_rpc_async *as,
+                                  struct flounder_rpc_pending *p)
+{
+    p->next = NULL;
+    if (as->tail == NULL) {
+        as->head = p;
+    } else {
+        as->tail->next = p;
+    }
+    as->tail = p;
+    as->outstanding++;
+}
+
+/**
+ * \brief removes the outstanding call a reply belongs to
+ *
+ * \param as        asynchronous call state
+ * \param rpcnum    number of the RPC the reply is for
+ * \param by_seq    match by request ID instead of the oldest call
+ * \param seq       request ID of the reply, if by_seq
+ *
+ * \returns the call record, or NULL if no asynchronous call matches. The
+ *          caller returns it with flounder_rpc_pending_free().
+ */
+struct flounder_rpc_pending *flounder_rpc_pending_take(struct flounder_rpc_async *as,
+                                                       int rpcnum, bool by_seq,
+                                                       uint64_t seq)
+{
+    struct flounder_rpc_pending *prev = NULL;
+
+    for (struct flounder_rpc_pending *p = as->head; p != NULL;
+         prev = p, p = p->next) {
+        if (p->rpcnum != rpcnum || (by_seq && p->seq != seq)) {
+            continue;
+        }
+
+        if (prev == NULL) {
+            as->head = p->next;
+        } else {
+            prev->next = p->next;
+        }
+        if (as->tail == p) {
+            as->tail = prev;
+        }
+        as->outstanding--;
+        return p;
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief completes all outstanding calls with an error
+ *
+ * \param as    asynchronous call state
+ * \param rpc   RPC client, passed to the continuations
+ * \param err   error to report
+ */
+void flounder_rpc_async_fail_all(struct flounder_rpc_async *as, void *rpc,
+                                 errval_t err)
+{
+    struct flounder_rpc_pending *p;
+
+    while ((p = as->head) != NULL) {
+        as->head = p->next;
+        if (as->head == NULL) {
+            as->tail = NULL;
+        }
+        as->outstanding--;
+
+        p->fail(rpc, p, err);
+        flounder_rpc_pending_free(as, p);
+    }
+}
+
+/**
+ * \brief dispatches events until at most max_outstanding calls are left
+ *
+ * \param as                asynchronous call state
+ * \param ws                waitset of the RPC client
+ * \param max_outstanding   number of calls which may remain outstanding
+ *
+ * \returns SYS_ERR_OK on success
+ *          LIB_ERR_EVENT_DISPATCH on failure
+ */
+errval_t flounder_rpc_async_wait(struct flounder_rpc_async *as,
+                                 struct waitset *ws, size_t max_outstanding)
+{
+    while (as->outstanding > max_outstanding) {
+        errval_t err = event_dispatch(ws);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_EVENT_DISPATCH);
+        }
+    }
+    return SYS_ERR_OK;
+}
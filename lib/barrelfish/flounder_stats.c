@@ -0,0 +1,268 @@
+/**
+ * \file
+ * \brief Runtime support for the optional flounder message statistics
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include <barrelfish/barrelfish.h>
+#include <flounder/flounder_stats.h>
+#include <trace/trace.h>
+#include <trace_definitions/trace_defs.h>
+
+#if defined(__k1om__)
+#include <barrelfish_kpi/asm_inlines_arch.h>
+#define stats_cycles() rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <arch/x86/barrelfish_kpi/asm_inlines_arch.h>
+#define stats_cycles() rdtsc()
+#elif defined(__arm__) && !defined(__gem5__)
+#include <arch/arm/barrelfish_kpi/asm_inlines_arch.h>
+#define stats_cycles() get_cycle_count()
+#else
+/* no usable cycle counter, only counts and bytes are meaningful */
+#define stats_cycles() 0
+#endif
+
+/// All interfaces which have sent or received a message, most recent first
+static struct flounder_if_stats *registered_ifs = NULL;
+
+/**
+ * \brief adds an interface to the list of registered interfaces
+ *
+ * Called on the first message of the interface. Lock-free, as bindings of
+ * the same interface may be used concurrently on several dispatchers.
+ */
+void flounder_stats_register(struct flounder_if_stats *ifs)
+{
+    if (ifs->registered != 0
+        || !__sync_bool_compare_and_swap(&ifs->registered, 0, 1)) {
+        return;
+    }
+
+    struct flounder_if_stats *head;
+    do {
+        head = registered_ifs;
+        ifs->next = head;
+    } while (!__sync_bool_compare_and_swap(&registered_ifs, head, ifs));
+
+    ifs->registered = 2;
+}
+
+/// \brief returns the current cycle count used for all statistics
+uint64_t flounder_stats_now(void)
+{
+    return stats_cycles();
+}
+
+static inline int hist_bucket(uint64_t cycles)
+{
+    if (cycles == 0) {
+        return 0;
+    }
+    int b = 64 - __builtin_clzll(cycles);
+    return b < FLOUNDER_STATS_HIST_BUCKETS ? b : FLOUNDER_STATS_HIST_BUCKETS - 1;
+}
+
+static inline struct flounder_msg_stats *msg_stats(struct flounder_if_stats *ifs,
+                                                   int msgnum)
+{
+    assert(msgnum >= 0 && msgnum < ifs->nmsgs);
+    if (ifs->registered != 2) {
+        flounder_stats_register(ifs);
+    }
+    return &ifs->msgs[msgnum];
+}
+
+/**
+ * \brief accounts a message accepted by a send function
+ *
+ * \param ifs       statistics of the interface
+ * \param txp       returns the counters to charge the tx wait to
+ * \param startp    returns the time the message was accepted
+ * \param msgnum    message number
+ * \param bytes     payload size of the message
+ */
+void flounder_stats_tx_start(struct flounder_if_stats *ifs,
+                             struct flounder_msg_stats **txp,
+                             uint64_t *startp, int msgnum, size_t bytes)
+{
+    struct flounder_msg_stats *ms = msg_stats(ifs, msgnum);
+
+    __sync_fetch_and_add(&ms->tx_count, 1);
+    __sync_fetch_and_add(&ms->tx_bytes, bytes);
+
+    *txp = ms;
+    *startp = stats_cycles();
+}
+
+/**
+ * \brief accounts the tx wait of a message once its last fragment was sent
+ *
+ * \param txp   counters set by flounder_stats_tx_start(), cleared on return
+ * \param start time the message was accepted
+ */
+void flounder_stats_tx_done(struct flounder_msg_stats **txp, uint64_t start)
+{
+    struct flounder_msg_stats *ms = *txp;
+    uint64_t wait = stats_cycles() - start;
+
+    __sync_fetch_and_add(&ms->tx_wait, wait);
+    __sync_fetch_and_add(&ms->tx_wait_hist[hist_bucket(wait)], 1);
+
+    *txp = NULL;
+}
+
+/**
+ * \brief accounts a received message just before its handler is invoked
+ *
+ * \param ifs       statistics of the interface
+ * \param startp    arrival time of the first fragment, 0 if unknown; reset
+ * \param msgnum    message number
+ * \param bytes     payload size of the message
+ */
+void flounder_stats_rx(struct flounder_if_stats *ifs, uint64_t *startp,
+                       int msgnum, size_t bytes)
+{
+    struct flounder_msg_stats *ms = msg_stats(ifs, msgnum);
+
+    __sync_fetch_and_add(&ms->rx_count, 1);
+    __sync_fetch_and_add(&ms->rx_bytes, bytes);
+
+    if (*startp != 0) {
+        uint64_t lat = stats_cycles() - *startp;
+        __sync_fetch_and_add(&ms->rx_lat, lat);
+        __sync_fetch_and_add(&ms->rx_lat_hist[hist_bucket(lat)], 1);
+        *startp = 0;
+    }
+}
+
+/**
+ * \brief looks up the statistics of an interface by name
+ *
+ * \returns the statistics, or NULL if the interface has not been used yet
+ */
+struct flounder_if_stats *flounder_stats_find(const char *ifname)
+{
+    for (struct flounder_if_stats *ifs = registered_ifs; ifs != NULL;
+         ifs = ifs->next) {
+        if (strcmp(ifs->name, ifname) == 0) {
+            return ifs;
+        }
+    }
+    return NULL;
+}
+
+static void print_hist(const char *what, uint64_t *hist)
+{
+    printf("      %s:", what);
+    for (int i = 0; i < FLOUNDER_STATS_HIST_BUCKETS; i++) {
+        if (hist[i] != 0) {
+            printf(" <2^%d:%" PRIu64, i, hist[i]);
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * \brief prints the statistics of all messages sent or received so far
+ */
+void flounder_stats_print(void)
+{
+    for (struct flounder_if_stats *ifs = registered_ifs; ifs != NULL;
+         ifs = ifs->next) {
+        printf("flounder stats for interface %s:\n", ifs->name);
+        for (int i = 0; i < ifs->nmsgs; i++) {
+            struct flounder_msg_stats *ms = &ifs->msgs[i];
+            if (ms->tx_count == 0 && ms->rx_count == 0) {
+                continue;
+            }
+            printf("  %-24s tx %8" PRIu64 " msgs %10" PRIu64 " bytes %8" PRIu64
+                   " cycles/wait\n", ifs->msgnames[i], ms->tx_count,
+                   ms->tx_bytes, ms->tx_count ? ms->tx_wait / ms->tx_count : 0);
+            printf("  %-24s rx %8" PRIu64 " msgs %10" PRIu64 " bytes %8" PRIu64
+                   " cycles/lat\n", "", ms->rx_count, ms->rx_bytes,
+                   ms->rx_count ? ms->rx_lat / ms->rx_count : 0);
+            print_hist("tx wait", ms->tx_wait_hist);
+            print_hist("rx lat ", ms->rx_lat_hist);
+        }
+    }
+}
+
+/**
+ * \brief clears the counters of all registered interfaces
+ *
+ * Not atomic with respect to concurrent senders and receivers.
+ */
+void flounder_stats_reset(void)
+{
+    for (struct flounder_if_stats *ifs = registered_ifs; ifs != NULL;
+         ifs = ifs->next) {
+        memset(ifs->msgs, 0, ifs->nmsgs * sizeof(struct flounder_msg_stats));
+    }
+}
+
+static inline uint32_t clamp32(uint64_t v)
+{
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+/**
+ * \brief writes the statistics of all registered interfaces to the trace
+ *        buffer
+ *
+ * Interfaces are identified by their position in the output of
+ * flounder_stats_print(). Every message type with traffic is introduced by a
+ * FLOUNDER_MSG event carrying (interface << 16 | message number), followed by
+ * its counters and the non-empty histogram buckets as (bucket << 24 | count).
+ */
+void flounder_stats_trace_dump(void)
+{
+    uint32_t ifidx = 0;
+
+    for (struct flounder_if_stats *ifs = registered_ifs; ifs != NULL;
+         ifs = ifs->next, ifidx++) {
+        for (int i = 0; i < ifs->nmsgs; i++) {
+            struct flounder_msg_stats *ms = &ifs->msgs[i];
+            if (ms->tx_count == 0 && ms->rx_count == 0) {
+                continue;
+            }
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_MSG,
+                        ifidx << 16 | i);
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_TX_COUNT,
+                        clamp32(ms->tx_count));
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_TX_BYTES,
+                        clamp32(ms->tx_bytes));
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_TX_WAIT,
+                        clamp32(ms->tx_count ? ms->tx_wait / ms->tx_count : 0));
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_RX_COUNT,
+                        clamp32(ms->rx_count));
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_RX_BYTES,
+                        clamp32(ms->rx_bytes));
+            trace_event(TRACE_SUBSYS_FLOUNDER, TRACE_EVENT_FLOUNDER_RX_LAT,
+                        clamp32(ms->rx_count ? ms->rx_lat / ms->rx_count : 0));
+            for (uint32_t b = 0; b < FLOUNDER_STATS_HIST_BUCKETS; b++) {
+                if (ms->tx_wait_hist[b] != 0) {
+                    trace_event(TRACE_SUBSYS_FLOUNDER,
+                                TRACE_EVENT_FLOUNDER_TX_WAIT_HIST,
+                                b << 24 | MIN(ms->tx_wait_hist[b], 0xffffff));
+                }
+                if (ms->rx_lat_hist[b] != 0) {
+                    trace_event(TRACE_SUBSYS_FLOUNDER,
+                                TRACE_EVENT_FLOUNDER_RX_LAT_HIST,
+                                b << 24 | MIN(ms->rx_lat_hist[b], 0xffffff));
+                }
+            }
+        }
+    }
+}
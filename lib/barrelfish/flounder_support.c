@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/param.h>
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/monitor_client.h>
 #include <barrelfish/waitset_chan.h>
@@ -371,6 +372,25 @@ void flounder_stub_ump_state_init(struct flounder_ump_state *s, void *binding)
     flounder_stub_cap_state_init(&s->capst, binding);
 }
 
+/// Number of payload bytes in a UMP message fragment
+#define UMP_FRAG_BYTES      (UMP_PAYLOAD_WORDS * sizeof(uintptr_t))
+
+/// Offset of the payload in the first fragment of a buffer, after its length
+/// XXX: skip as many words as the largest word size
+#define UMP_FRAG_LEN_BYTES  sizeof(uint64_t)
+
+/**
+ * \brief Send a buffer as a sequence of UMP message fragments
+ *
+ * The first fragment carries the length of the buffer, followed by as much of
+ * the payload as fits. The payload is copied into the ring in bulk, a slot at
+ * a time, and we keep filling slots for as long as the channel has space,
+ * rather than returning to the stub state machine for every fragment.
+ *
+ * \returns SYS_ERR_OK once the whole buffer has been sent
+ *          FLOUNDER_ERR_BUF_SEND_MORE if the channel is full, in which case
+ *          the caller should retry with the same 'pos' once it is acked
+ */
 errval_t flounder_stub_ump_send_buf(struct flounder_ump_state *s,
                                        int msgnum, const void *bufp,
                                        size_t len, size_t *pos)
@@ -378,7 +398,6 @@ errval_t flounder_stub_ump_send_buf(struct flounder_ump_state *s,
     volatile struct ump_message *msg;
     const uint8_t *buf = bufp;
     struct ump_control ctrl;
-    int msgpos;
 
     do {
         if (!flounder_stub_ump_can_send(s)) {
@@ -388,19 +407,21 @@ errval_t flounder_stub_ump_send_buf(struct flounder_ump_state *s,
         msg = ump_chan_get_next(&s->chan, &ctrl);
         flounder_stub_ump_control_fill(s, &ctrl, msgnum);
 
+        uint8_t *payload = (uint8_t *)msg->data;
+        size_t space = UMP_FRAG_BYTES;
+
         // is this the start of the buffer?
         if (*pos == 0) {
             // if so, send the length in the first word
-            msg->data[0] = len;
-            // XXX: skip as many words as the largest word size
-            msgpos = (sizeof(uint64_t) / sizeof(uintptr_t));
-        } else {
-            // otherwise use it for payload
-            msgpos = 0;
+            *(volatile uint64_t *)payload = len;
+            payload += UMP_FRAG_LEN_BYTES;
+            space -= UMP_FRAG_LEN_BYTES;
         }
 
-        for (; msgpos < UMP_PAYLOAD_WORDS && *pos < len; msgpos++) {
-            msg->data[msgpos] = getword(buf, pos, len);
+        size_t bytes = MIN(space, len - *pos);
+        if (bytes > 0) {
+            memcpy(payload, buf + *pos, bytes);
+            *pos += bytes;
         }
 
         flounder_stub_ump_barrier();
@@ -414,15 +435,35 @@ errval_t flounder_stub_ump_send_buf(struct flounder_ump_state *s,
     return SYS_ERR_OK;
 }
 
-errval_t flounder_stub_ump_recv_buf(volatile struct ump_message *msg,
+/**
+ * \brief Receive a buffer sent with flounder_stub_ump_send_buf()
+ *
+ * Copies the payload of the given fragment, and then keeps receiving the
+ * following fragments of the buffer directly from the channel while they are
+ * already there, instead of returning to the stub state machine for each of
+ * them. It stops at a fragment of another message (e.g. an ACK, which is then
+ * handled by the stub), and when we owe the sender an ACK, so that the sender
+ * does not stall while we copy.
+ *
+ * \param s      UMP state of the binding
+ * \param msgnum Message number of the message the buffer belongs to
+ * \param msg    Fragment that was just received
+ *
+ * \returns SYS_ERR_OK once the whole buffer has been received
+ *          FLOUNDER_ERR_BUF_RECV_MORE if more fragments are still to come
+ *          LIB_ERR_MALLOC_FAIL if the buffer could not be allocated
+ */
+errval_t flounder_stub_ump_recv_buf(struct flounder_ump_state *s, int msgnum,
+                                    volatile struct ump_message *msg,
                                     void **bufp, size_t *len, size_t *pos)
 {
-    int msgpos;
+    const uint8_t *payload = (const uint8_t *)msg->data;
+    size_t avail = UMP_FRAG_BYTES;
 
     // is this the first fragment?
     // if so, unmarshall the length and allocate a buffer
     if (*pos == 0) {
-        *len = msg->data[0];
+        *len = *(volatile uint64_t *)payload;
         if (*len == 0) {
             *bufp = NULL;
         } else {
@@ -432,26 +473,43 @@ errval_t flounder_stub_ump_recv_buf(volatile struct ump_message *msg,
             }
         }
 
-        // XXX: skip as many words as the largest word size
-        msgpos = (sizeof(uint64_t) / sizeof(uintptr_t));
-    } else {
-        msgpos = 0;
+        payload += UMP_FRAG_LEN_BYTES;
+        avail -= UMP_FRAG_LEN_BYTES;
     }
 
     uint8_t *buf = *bufp;
 
-    // copy remainder of fragment to buffer
-    for (; msgpos < UMP_PAYLOAD_WORDS && *pos < *len; msgpos++) {
-        putword(msg->data[msgpos], buf, pos, *len);
-    }
+    while (true) {
+        // copy remainder of fragment to buffer
+        size_t bytes = MIN(avail, *len - *pos);
+        if (bytes > 0) {
+            memcpy(buf + *pos, payload, bytes);
+            *pos += bytes;
+        }
 
-    // are we done?
-    if (*pos < *len) {
-        return FLOUNDER_ERR_BUF_RECV_MORE;
-    } else {
-        // reset state for next buffer
-        *pos = 0;
-        return SYS_ERR_OK;
+        // are we done?
+        if (*pos >= *len) {
+            // reset state for next buffer
+            *pos = 0;
+            return SYS_ERR_OK;
+        }
+
+        // is the next fragment of this buffer already there?
+        if (flounder_stub_ump_needs_ack(s)) {
+            return FLOUNDER_ERR_BUF_RECV_MORE;
+        }
+        msg = ump_impl_poll(&s->chan.endpoint.chan);
+        if (msg == NULL
+            || (msg->header.control.header >> UMP_INDEX_BITS) != msgnum) {
+            return FLOUNDER_ERR_BUF_RECV_MORE;
+        }
+
+        errval_t err = ump_chan_recv(&s->chan, &msg);
+        assert(err_is_ok(err));
+        flounder_stub_ump_control_process(s, msg->header.control);
+
+        payload = (const uint8_t *)msg->data;
+        avail = UMP_FRAG_BYTES;
     }
 }
 
@@ -472,10 +530,11 @@ errval_t flounder_stub_ump_send_string(struct flounder_ump_state *s,
     return flounder_stub_ump_send_buf(s, msgnum, str, *len, pos);
 }
 
-errval_t flounder_stub_ump_recv_string(volatile struct ump_message *msg,
+errval_t flounder_stub_ump_recv_string(struct flounder_ump_state *s,
+                                       int msgnum,
+                                       volatile struct ump_message *msg,
                                        char **strp, size_t *pos, size_t *len)
 {
-    return flounder_stub_ump_recv_buf(msg, (void **)strp, len, pos);
+    return flounder_stub_ump_recv_buf(s, msgnum, msg, (void **)strp, len, pos);
 }
-
 #endif // CONFIG_INTERCONNECT_DRIVER_UMP
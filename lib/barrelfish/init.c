@@ -158,7 +158,10 @@ static bool parse_argv(struct spawn_domain_params *params, size_t *morecore_alig
     bool found = false;
     for (; i < params->argc; i++) {
         if (!found) {
-            if (!strncmp(params->argv[i], "morecore=", 9)) {
+            if (!strcmp(params->argv[i], "morecore=auto")) {
+                morecore_pagesize = MORECORE_PAGESIZE_AUTO;
+                found = true;
+            } else if (!strncmp(params->argv[i], "morecore=", 9)) {
                 morecore_pagesize = strtol(params->argv[i]+9, NULL, 0);
                 // check for valid page size
                 switch (morecore_pagesize) {
@@ -16,6 +16,7 @@
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/core_state.h>
 #include <barrelfish/morecore.h>
+#include <barrelfish/vspace_mmu_aware.h>
 #include <stdio.h>
 
 /// Amount of virtual space for malloc
@@ -109,6 +110,18 @@ errval_t morecore_init(size_t alignment)
 
     // setup flags that match the alignment
     vregion_flags_t morecore_flags = VREGION_FLAGS_READ_WRITE;
+    if (alignment == MORECORE_PAGESIZE_AUTO) {
+        // use the largest pages for which there is contiguous memory
+#if __x86_64__
+        alignment = HUGE_PAGE_SIZE;
+        morecore_flags |= VREGION_FLAGS_HUGE | VREGION_FLAGS_LARGE;
+#elif defined(__i386__) && defined(CONFIG_PSE)
+        alignment = LARGE_PAGE_SIZE;
+        morecore_flags |= VREGION_FLAGS_LARGE;
+#else
+        alignment = BASE_PAGE_SIZE;
+#endif
+    }
 #if __x86_64__
     morecore_flags |= (alignment == HUGE_PAGE_SIZE ? VREGION_FLAGS_HUGE : 0);
 #endif
@@ -126,13 +139,30 @@ errval_t morecore_init(size_t alignment)
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Returns statistics of the frames backing the heap
+ *
+ * \param stats Returns the number of bytes mapped with each page size, and
+ *              how often there was no contiguous memory for a chunk
+ */
+void morecore_get_stats(struct vspace_mmu_aware_stats *stats)
+{
+    *stats = get_morecore_state()->mmu_state.stats;
+}
+
 errval_t morecore_reinit(void)
 {
     errval_t err;
     struct morecore_state *state = get_morecore_state();
 
     size_t mapoffset = state->mmu_state.mapoffset;
-    size_t remapsize = ROUND_UP(mapoffset, state->mmu_state.alignment);
+    size_t alignment = state->mmu_state.alignment;
+    if (state->mmu_state.vregion.flags & VREGION_FLAGS_LARGE) {
+        // don't spend a huge page on the small early heap if large pages
+        // will do
+        alignment = LARGE_PAGE_SIZE;
+    }
+    size_t remapsize = ROUND_UP(mapoffset, alignment);
     if (remapsize <= mapoffset) {
         // don't need to do anything if we only recreate the exact same
         // mapping
@@ -16,13 +16,77 @@
 
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/nameservice_client.h>
+#include <barrelfish/nameservice_cache.h>
 
 #include <if/octopus_defs.h>
 #include <if/octopus_rpcclient_defs.h>
 #include <if/monitor_defs.h>
+#include <if/monitor_blocking_rpcclient_defs.h>
 #include <octopus/getset.h> // for oct_read TODO
 #include <octopus/trigger.h> // for NOP_TRIGGER
 
+/// Name service cache of this core, NULL if the monitor provides none
+static struct ns_cache *ns_cache;
+
+static struct {
+    uint64_t hits, misses, fallbacks;
+} ns_stats;
+
+/**
+ * \brief Looks up iface through the name service cache
+ *
+ * Probes the cache and asks the monitor on a miss, which queries octopus and
+ * fills the cache for the other domains on this core.
+ *
+ * \param iface Name of interface to look up
+ * \param retiref Returns IREF on success
+ * \param reterr Returns the result of the lookup if it has been answered
+ *
+ * \returns true if the lookup has been answered, false if it has to be sent
+ *          to octopus
+ */
+static bool cache_lookup(const char *iface, iref_t *retiref, errval_t *reterr)
+{
+    if (ns_cache == NULL || !ns_cache_name_ok(iface)) {
+        return false;
+    }
+
+    iref_t iref;
+    if (ns_cache_probe(ns_cache, iface, &iref)) {
+        __sync_fetch_and_add(&ns_stats.hits, 1);
+        goto found;
+    }
+
+    struct monitor_blocking_rpc_client *mc = get_monitor_blocking_rpc_client();
+    errval_t err, msgerr;
+    msgerr = mc->vtbl.ns_cache_lookup(mc, iface, &err, &iref);
+    if (err_is_fail(msgerr)) {
+        return false;
+    }
+    __sync_fetch_and_add(&ns_stats.misses, 1);
+
+    switch (err_no(err)) {
+    case SYS_ERR_OK:
+        goto found;
+
+    case LIB_ERR_NAMESERVICE_UNKNOWN_NAME:
+    case LIB_ERR_NAMESERVICE_INVALID_NAME:
+        *reterr = err;
+        return true;
+
+    default:
+        // the monitor could not reach octopus
+        return false;
+    }
+
+found:
+    if (retiref != NULL) {
+        *retiref = iref;
+    }
+    *reterr = SYS_ERR_OK;
+    return true;
+}
+
 /**
  * \brief Non-blocking name service lookup
  *
@@ -33,10 +97,15 @@ errval_t nameservice_lookup(const char *iface, iref_t *retiref)
 {
     errval_t err;
 
+    if (cache_lookup(iface, retiref, &err)) {
+        return err;
+    }
+
     struct octopus_rpc_client *r = get_octopus_rpc_client();
     if (r == NULL) {
         return LIB_ERR_NAMESERVICE_NOT_BOUND;
     }
+    __sync_fetch_and_add(&ns_stats.fallbacks, 1);
 
     char* record = NULL;
     octopus_trigger_id_t tid;
@@ -78,10 +147,17 @@ errval_t nameservice_blocking_lookup(const char *iface, iref_t *retiref)
 {
     errval_t err;
 
+    // names that are not registered yet are waited for at octopus
+    if (cache_lookup(iface, retiref, &err)
+        && err_no(err) != LIB_ERR_NAMESERVICE_UNKNOWN_NAME) {
+        return err;
+    }
+
     struct octopus_rpc_client *r = get_octopus_rpc_client();
     if (r == NULL) {
         return LIB_ERR_NAMESERVICE_NOT_BOUND;
     }
+    __sync_fetch_and_add(&ns_stats.fallbacks, 1);
 
     char* record = NULL;
     errval_t error_code;
@@ -150,8 +226,67 @@ out:
     return err;
 }
 
+/**
+ * \brief Returns the name service cache counters
+ *
+ * \param stats Returns the counters of this domain and of the monitor
+ *
+ * \retval LIB_ERR_NAMESERVICE_NOT_CACHEABLE if this domain does not use the
+ *         cache; the counters of the domain are still returned
+ */
+errval_t nameservice_cache_stats(struct nameservice_cache_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->hits = ns_stats.hits;
+    stats->misses = ns_stats.misses;
+    stats->fallbacks = ns_stats.fallbacks;
+
+    if (ns_cache == NULL) {
+        return LIB_ERR_NAMESERVICE_NOT_CACHEABLE;
+    }
+
+    struct ns_cache_counters *c = &ns_cache->counters;
+    stats->mon_lookups = c->lookups;
+    stats->mon_coalesced = c->coalesced;
+    stats->mon_queries = c->queries;
+    stats->mon_fills = c->fills;
+    stats->mon_updates = c->updates;
+    stats->mon_invalidations = c->invalidations;
+    stats->mon_evictions = c->evictions;
+
+    return SYS_ERR_OK;
+}
+
 /* ----------------------- BIND/INIT CODE FOLLOWS ----------------------- */
 
+/// Maps the name service cache of this core read-only, if there is one
+static void cache_map(void)
+{
+    errval_t err, msgerr;
+
+    struct monitor_blocking_rpc_client *mc = get_monitor_blocking_rpc_client();
+    if (mc == NULL || ns_cache != NULL) {
+        return;
+    }
+
+    struct capref frame;
+    msgerr = mc->vtbl.get_nameservice_cache(mc, &err, &frame);
+    if (err_is_fail(msgerr) || err_is_fail(err)) {
+        // lookups go to octopus
+        return;
+    }
+
+    void *buf;
+    err = vspace_map_one_frame_attr(&buf, NS_CACHE_SIZE, frame,
+                                    VREGION_FLAGS_READ, NULL, NULL);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "mapping the name service cache");
+        cap_destroy(frame);
+        return;
+    }
+    ns_cache = buf;
+}
+
 
 static void error_handler(struct octopus_binding *b, errval_t err)
 {
@@ -234,6 +369,10 @@ errval_t nameservice_client_blocking_bind(void)
         }
     }
 
+    if (err_is_ok(st.err)) {
+        cache_map();
+    }
+
     return st.err;
 }
 
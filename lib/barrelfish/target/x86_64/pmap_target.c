@@ -559,24 +559,27 @@ static errval_t map(struct pmap *pmap, genvaddr_t vaddr, struct capref frame,
     // TODO: overestimating needed slabs shouldn't hurt much in the long run,
     // and would keep the code easier to read and possibly faster due to less
     // branching
-    if ((flags & VREGION_FLAGS_LARGE) &&
-        (vaddr & X86_64_LARGE_PAGE_MASK) == 0 &&
-        (fi.base & X86_64_LARGE_PAGE_MASK) == 0 &&
+    // check huge pages first, like do_map(), as both may be requested
+    if ((flags & VREGION_FLAGS_HUGE) &&
+        (vaddr & X86_64_HUGE_PAGE_MASK) == 0 &&
+        fi.bits >= X86_64_HUGE_PAGE_BITS &&
+        (fi.base & X86_64_HUGE_PAGE_MASK) == 0 &&
         (1UL<<fi.bits) >= offset+size) {
-        //case large pages (2MB)
-        size   += LARGE_PAGE_OFFSET(offset);
-        size    = ROUND_UP(size, LARGE_PAGE_SIZE);
-        offset -= LARGE_PAGE_OFFSET(offset);
-        max_slabs = max_slabs_for_mapping_large(size);
-    } else if ((flags & VREGION_FLAGS_HUGE) &&
-               (vaddr & X86_64_HUGE_PAGE_MASK) == 0 &&
-               (fi.base & X86_64_HUGE_PAGE_MASK) == 0 &&
-               (1UL<<fi.bits) >= offset+size) {
         // case huge pages (1GB)
         size   += HUGE_PAGE_OFFSET(offset);
         size    = ROUND_UP(size, HUGE_PAGE_SIZE);
         offset -= HUGE_PAGE_OFFSET(offset);
         max_slabs = max_slabs_for_mapping_huge(size);
+    } else if ((flags & VREGION_FLAGS_LARGE) &&
+               (vaddr & X86_64_LARGE_PAGE_MASK) == 0 &&
+               fi.bits >= X86_64_LARGE_PAGE_BITS &&
+               (fi.base & X86_64_LARGE_PAGE_MASK) == 0 &&
+               (1UL<<fi.bits) >= offset+size) {
+        //case large pages (2MB)
+        size   += LARGE_PAGE_OFFSET(offset);
+        size    = ROUND_UP(size, LARGE_PAGE_SIZE);
+        offset -= LARGE_PAGE_OFFSET(offset);
+        max_slabs = max_slabs_for_mapping_large(size);
     } else {
         //case normal pages (4KB)
         size   += BASE_PAGE_OFFSET(offset);
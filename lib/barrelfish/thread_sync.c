@@ -15,6 +15,7 @@
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/dispatch.h>
 #include <barrelfish/dispatcher_arch.h>
+#include <barrelfish/curdispatcher_arch.h>
 #include <trace/trace.h>
 #include <trace_definitions/trace_defs.h>
 #include "threads_priv.h"
@@ -229,6 +230,55 @@ void thread_mutex_lock_nested(struct thread_mutex *mutex)
                 (uintptr_t)mutex);
 }
 
+/// Hint to the CPU that we are spinning on a lock
+static inline void spin_hint(void)
+{
+#if defined(__k1om__)
+    __asm__ __volatile__("delay %0" :: "r"(16) : "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * \brief Lock a mutex, spinning briefly before blocking
+ *
+ * If the mutex is held by a thread running on another dispatcher, that thread
+ * may release it soon, so this spins for up to 'spins' iterations waiting for
+ * the mutex to become free before falling back to thread_mutex_lock(). It does
+ * not spin if the holder runs on our own dispatcher, as it cannot make progress
+ * while we spin, nor if other threads are already queued on the mutex, as it
+ * is then handed over to them on unlock.
+ *
+ * \param mutex Mutex pointer
+ * \param spins Maximum number of spin iterations
+ */
+void thread_mutex_lock_spin(struct thread_mutex *mutex, unsigned int spins)
+{
+    dispatcher_handle_t handle = curdispatcher();
+
+    for (unsigned int i = 0; i < spins; i++) {
+        if (mutex->locked == 0) {
+            if (thread_mutex_trylock(mutex)) {
+                return;
+            }
+        } else if (mutex->queue != NULL) {
+            break;
+        } else {
+            // the holder is only read as a hint, it may change under our feet
+            struct thread *holder = mutex->holder;
+            if (holder != NULL && holder->disp == handle) {
+                break;
+            }
+        }
+        spin_hint();
+    }
+
+    thread_mutex_lock(mutex);
+}
+
 /**
  * \brief Try to lock a mutex
  *
@@ -10,6 +10,11 @@
  *
  * morecore uses this memory object so it cannot use malloc for its lists.
  * Therefore, this uses slabs and grows them using the pinned memory.
+ *
+ * With #MEMOBJ_ANON_DEMAND_ZERO, offsets that were not filled are backed by
+ * zeroed pages on first touch. Each fault allocates the missing pages of an
+ * aligned window around the faulting page (fault-around), taking them from
+ * a per-domain cache of single-page frames.
  */
 
 /*
@@ -22,9 +27,123 @@
  * ETH Zurich D-INFK, Universitaetstr. 6, CH-8092 Zurich. Attn: Systems Group.
  */
 
+#include <string.h>
 #include <barrelfish/barrelfish.h>
 #include "vspace_internal.h"
 
+/// log2 of the number of frames retyped at once to refill the frame cache
+#define FRAME_CACHE_BATCH_BITS  6
+/// Max. number of frames of destroyed objects kept for reuse
+#define FRAME_CACHE_RECYCLE     256
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+/*
+ * Per-domain cache of single-page frames for demand-zero objects. Fresh
+ * frames are retyped from RAM in batches, which the kernel zeroes. Frames of
+ * destroyed objects are kept as well, but have to be cleared before reuse.
+ */
+static struct {
+    struct thread_mutex mutex;
+    struct cnoderef batch;                   ///< CNode of the current batch
+    cslot_t next;                            ///< Next unused slot of the batch
+    cslot_t count;                           ///< Frames in the batch
+    struct capref recycled[FRAME_CACHE_RECYCLE]; ///< Frames to clear on reuse
+    size_t nrecycled;                        ///< Number of recycled frames
+} frame_cache = {
+    .mutex = THREAD_MUTEX_INITIALIZER,
+};
+
+/// Retype a batch of RAM into single-page frames
+static errval_t frame_cache_refill(void)
+{
+    struct capref ram, cncap;
+    struct cnoderef batch;
+    cslot_t slots;
+    errval_t err;
+
+    err = ram_alloc(&ram, BASE_PAGE_BITS + FRAME_CACHE_BATCH_BITS);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_RAM_ALLOC);
+    }
+
+    err = cnode_create(&cncap, &batch, 1 << FRAME_CACHE_BATCH_BITS, &slots);
+    if (err_is_fail(err)) {
+        cap_destroy(ram);
+        return err_push(err, LIB_ERR_CNODE_CREATE);
+    }
+    assert(slots >= (1 << FRAME_CACHE_BATCH_BITS));
+
+    struct capref first = {
+        .cnode = batch,
+        .slot = 0
+    };
+    err = cap_retype(first, ram, ObjType_Frame, BASE_PAGE_BITS);
+    if (err_is_fail(err)) {
+        cap_destroy(ram);
+        cap_destroy(cncap);
+        // the previous batch is used up; the next allocation refills again
+        frame_cache.next = frame_cache.count = 0;
+        return err_push(err, LIB_ERR_CAP_RETYPE);
+    }
+
+    // the frames keep the memory alive
+    err = cap_destroy(ram);
+    assert(err_is_ok(err));
+
+    frame_cache.batch = batch;
+    frame_cache.next = 0;
+    frame_cache.count = 1 << FRAME_CACHE_BATCH_BITS;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Get a single-page frame from the frame cache
+ *
+ * \param ret    Returns the frame
+ * \param clean  Only return a frame that is already zeroed
+ * \param dirty  Returns whether the frame has to be cleared before use
+ */
+static errval_t frame_cache_alloc(struct capref *ret, bool clean, bool *dirty)
+{
+    errval_t err = SYS_ERR_OK;
+
+    thread_mutex_lock(&frame_cache.mutex);
+    if (!clean && frame_cache.nrecycled > 0) {
+        *ret = frame_cache.recycled[--frame_cache.nrecycled];
+        *dirty = true;
+        goto out;
+    }
+    if (frame_cache.next == frame_cache.count) {
+        err = frame_cache_refill();
+        if (err_is_fail(err)) {
+            goto out;
+        }
+    }
+    ret->cnode = frame_cache.batch;
+    ret->slot = frame_cache.next++;
+    *dirty = false;
+
+ out:
+    thread_mutex_unlock(&frame_cache.mutex);
+    return err;
+}
+
+/// Return a single-page frame to the frame cache, or delete it if it is full
+static errval_t frame_cache_free(struct capref frame)
+{
+    bool kept = false;
+
+    thread_mutex_lock(&frame_cache.mutex);
+    if (frame_cache.nrecycled < FRAME_CACHE_RECYCLE) {
+        frame_cache.recycled[frame_cache.nrecycled++] = frame;
+        kept = true;
+    }
+    thread_mutex_unlock(&frame_cache.mutex);
+
+    return kept ? SYS_ERR_OK : cap_delete(frame);
+}
+
 /**
  * \brief Map the memory object into a region
  *
@@ -231,11 +350,14 @@ static errval_t unpin(struct memobj *memobj, struct vregion *vregion,
  * \param offset  Offset into the memory object
  * \param frame   The frame cap for the offset
  * \param size    The size of frame cap
+ * \param foffset Offset into the frame
+ * \param cached  Frame comes from the frame cache and goes back there
  *
  * Pagefault relies on frames inserted in order
  */
-static errval_t fill_foff(struct memobj *memobj, genvaddr_t offset, struct capref frame,
-                     size_t size, genpaddr_t foffset)
+static errval_t fill_cached(struct memobj *memobj, genvaddr_t offset,
+                            struct capref frame, size_t size,
+                            genpaddr_t foffset, bool cached)
 {
     errval_t err;
     struct memobj_anon *anon = (struct memobj_anon*)memobj;
@@ -267,6 +389,7 @@ static errval_t fill_foff(struct memobj *memobj, genvaddr_t offset, struct capre
     new->frame   = frame;
     new->size    = size;
     new->foffset = foffset;
+    new->cached  = cached;
 
     {
         struct frame_identity id;
@@ -275,6 +398,15 @@ static errval_t fill_foff(struct memobj *memobj, genvaddr_t offset, struct capre
         new->pa = id.base;
     }
 
+    // Appending is the common case, e.g. for sequential demand-zero faults
+    struct memobj_frame_list *tail = anon->frame_tail;
+    if (tail != NULL && new->offset >= tail->offset + tail->size) {
+        tail->next = new;
+        new->next = NULL;
+        anon->frame_tail = new;
+        return SYS_ERR_OK;
+    }
+
     // Insert in order
     struct memobj_frame_list *walk = anon->frame_list;
     struct memobj_frame_list *prev = NULL;
@@ -309,8 +441,14 @@ static errval_t fill_foff(struct memobj *memobj, genvaddr_t offset, struct capre
         anon->frame_list = new;
         new->next = NULL;
     }
+    anon->frame_tail = new;
     return SYS_ERR_OK;
 }
+static errval_t fill_foff(struct memobj *memobj, genvaddr_t offset, struct capref frame,
+                     size_t size, genpaddr_t foffset)
+{
+    return fill_cached(memobj, offset, frame, size, foffset, false);
+}
 static errval_t fill(struct memobj *memobj, genvaddr_t offset, struct capref frame,
                      size_t size)
 {
@@ -383,10 +521,105 @@ static errval_t unfill(struct memobj *memobj, genvaddr_t offset,
     } else {
         anon->frame_list = fwalk->next;
     }
+    if (fwalk == anon->frame_tail) {
+        anon->frame_tail = fprev;
+    }
     slab_free(&anon->frame_slab, fwalk);
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Back a page with a zeroed frame from the frame cache and map it
+ *
+ * \param anon     The memory object
+ * \param vregion  The vregion to map the page in
+ * \param offset   Page-aligned offset into the memory object
+ */
+static errval_t zero_page(struct memobj_anon *anon, struct vregion *vregion,
+                          genvaddr_t offset)
+{
+    struct pmap *pmap = vspace_get_pmap(vregion_get_vspace(vregion));
+    genvaddr_t vaddr = vregion_get_base_addr(vregion)
+                       + vregion_get_offset(vregion) + offset;
+    vregion_flags_t flags = vregion_get_flags(vregion);
+    struct capref frame;
+    bool dirty;
+    errval_t err;
+
+    // recycled frames are cleared through the new mapping, if it is writable
+    err = frame_cache_alloc(&frame, !(flags & VREGION_FLAGS_WRITE), &dirty);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    err = pmap->f.map(pmap, vaddr, frame, 0, BASE_PAGE_SIZE, flags, NULL, NULL);
+    if (err_is_fail(err)) {
+        frame_cache_free(frame);
+        return err_push(err, LIB_ERR_PMAP_MAP);
+    }
+
+    if (dirty) {
+        memset((void *)vspace_genvaddr_to_lvaddr(vaddr), 0, BASE_PAGE_SIZE);
+    }
+
+    err = fill_cached(&anon->m, offset, frame, BASE_PAGE_SIZE, 0, true);
+    if (err_is_fail(err)) {
+        pmap->f.unmap(pmap, vaddr, BASE_PAGE_SIZE, NULL);
+        frame_cache_free(frame);
+        return err_push(err, LIB_ERR_MEMOBJ_FILL);
+    }
+
+    anon->resident += BASE_PAGE_SIZE;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Demand-zero page fault handler
+ *
+ * \param anon     The memory object
+ * \param vregion  The associated vregion
+ * \param offset   Offset into memory object of the page fault
+ *
+ * Backs the faulting page, which has no frame, and the other pages without a
+ * frame in the aligned fault-around window containing it.
+ */
+static errval_t pagefault_zero(struct memobj_anon *anon, struct vregion *vregion,
+                               genvaddr_t offset)
+{
+    errval_t err;
+
+    genvaddr_t page = offset & ~(genvaddr_t)BASE_PAGE_MASK;
+    genvaddr_t window = anon->fault_around * BASE_PAGE_SIZE;
+    genvaddr_t start = page - page % window;
+    genvaddr_t end = MIN(start + window, anon->m.size);
+
+    // no need to look for backed pages in a window beyond the last frame
+    struct memobj_frame_list *tail = anon->frame_tail;
+    bool empty = tail == NULL || tail->offset + tail->size <= start;
+
+    err = zero_page(anon, vregion, page);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_MEMOBJ_PAGEFAULT_HANDLER);
+    }
+
+    // fault-around is only an optimisation, so stop at the first failure
+    struct memobj_frame_list *walk = empty ? NULL : anon->frame_list;
+    for (genvaddr_t off = start; off < end; off += BASE_PAGE_SIZE) {
+        while (walk != NULL && walk->offset + walk->size <= off) {
+            walk = walk->next;
+        }
+        if (off == page || (walk != NULL && walk->offset <= off)) {
+            continue; // already backed
+        }
+        err = zero_page(anon, vregion, off);
+        if (err_is_fail(err)) {
+            break;
+        }
+    }
+
+    return SYS_ERR_OK;
+}
+
 /**
  * \brief Page fault handler
  *
@@ -404,8 +637,14 @@ static errval_t pagefault(struct memobj *memobj, struct vregion *vregion,
     errval_t err;
     struct memobj_anon *anon = (struct memobj_anon*)memobj;
 
+    anon->faults++;
+
     // Walk the ordered list for the frame and map it in
     struct memobj_frame_list *walk = anon->frame_list;
+    if (anon->frame_tail != NULL
+        && offset >= anon->frame_tail->offset + anon->frame_tail->size) {
+        walk = NULL; // beyond the last frame
+    }
     while (walk) {
         if (offset >= walk->offset && offset < walk->offset + walk->size) {
             struct vspace *vspace = vregion_get_vspace(vregion);
@@ -424,6 +663,10 @@ static errval_t pagefault(struct memobj *memobj, struct vregion *vregion,
         walk = walk->next;
     }
 
+    if ((memobj->flags & MEMOBJ_ANON_DEMAND_ZERO) && offset < memobj->size) {
+        return pagefault_zero(anon, vregion, offset);
+    }
+
     return LIB_ERR_MEMOBJ_WRONG_OFFSET;
 }
 
@@ -481,6 +724,37 @@ errval_t memobj_create_anon(struct memobj_anon *anon, size_t size,
 
     anon->vregion_list = NULL;
     anon->frame_list = NULL;
+    anon->frame_tail = NULL;
+    anon->fault_around = MEMOBJ_ANON_FAULT_AROUND;
+    anon->faults = 0;
+    anon->resident = 0;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Initialize a demand-zero anonymous memory object
+ *
+ * \param anon          The memory object
+ * \param size          Size of the memory region
+ * \param flags         Memory object specific flags
+ * \param fault_around  Number of pages to allocate per page fault
+ *
+ * Offsets that are not filled are backed by zeroed pages when they are first
+ * touched, which needs the faulting thread to pass its page faults to
+ * #vspace_pagefault_handler. Each fault allocates all missing pages of the
+ * fault_around-sized window containing the faulting page.
+ */
+errval_t memobj_create_anon_lazy(struct memobj_anon *anon, size_t size,
+                                 memobj_flags_t flags, size_t fault_around)
+{
+    errval_t err;
+
+    err = memobj_create_anon(anon, size, flags | MEMOBJ_ANON_DEMAND_ZERO);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    anon->fault_around = fault_around > 0 ? fault_around : 1;
     return SYS_ERR_OK;
 }
 
@@ -507,7 +781,12 @@ errval_t memobj_destroy_anon(struct memobj *memobj)
 
     struct memobj_frame_list *fwalk = m->frame_list;
     while (fwalk) {
-        err = cap_delete(fwalk->frame);
+        // keep the pages allocated on demand for reuse
+        if (fwalk->cached) {
+            err = frame_cache_free(fwalk->frame);
+        } else {
+            err = cap_delete(fwalk->frame);
+        }
         if (err_is_fail(err)) {
             return err;
         }
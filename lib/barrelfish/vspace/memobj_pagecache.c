@@ -0,0 +1,468 @@
+/**
+ * \file
+ * \brief Memory object backed by a page cache
+ *
+ * The pages are owned by a page cache, which is accessed through the ops
+ * given at creation time, and are mapped in on demand by the page fault
+ * handler. Cached pages are always mapped read-only, so that all mappings
+ * of the same data share the same frames. In a writable vregion, a write
+ * fault replaces the page with a private copy.
+ *
+ * Faults at consecutive pages grow a read-ahead window, which is passed on
+ * to the page cache so that it can fetch several pages at once. Pages of the
+ * window that are already cached are mapped in with the faulting page
+ * (fault-around), so a sequential scan only faults once per window.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/except.h>
+#include "vspace_internal.h"
+
+/// Read-ahead window on the first sequential fault, in pages
+#define PAGECACHE_MIN_READAHEAD 4
+/// Max. read-ahead window, in pages
+#define PAGECACHE_MAX_READAHEAD 64
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+// mapping state of one page
+struct memobj_pagecache_map {
+    struct capref cap;  ///< cap used for the mapping, NULL_CAP if unmapped
+    bool private;       ///< cap is a private copy rather than a cached frame
+};
+
+static genvaddr_t page_vaddr(struct memobj_pagecache *pc, size_t page)
+{
+    return vregion_get_base_addr(pc->vregion) + vregion_get_offset(pc->vregion)
+           + page * BASE_PAGE_SIZE;
+}
+
+/// Map a page of a frame; the frame is consumed
+static errval_t map_page(struct memobj_pagecache *pc, size_t page,
+                         struct capref frame, genpaddr_t foffset,
+                         vregion_flags_t flags, bool private)
+{
+    struct pmap *pmap = vspace_get_pmap(vregion_get_vspace(pc->vregion));
+
+    errval_t err = pmap->f.map(pmap, page_vaddr(pc, page), frame, foffset,
+                               BASE_PAGE_SIZE, flags, NULL, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_PMAP_MAP);
+    }
+
+    pc->map[page].cap = frame;
+    pc->map[page].private = private;
+    pc->pages_mapped++;
+    return SYS_ERR_OK;
+}
+
+/// Map a read-only view of a cached page
+static errval_t map_shared(struct memobj_pagecache *pc, size_t page,
+                           struct capref frame, genpaddr_t foffset)
+{
+    errval_t err;
+
+    // every mapping needs its own copy of the cap
+    struct capref copy;
+    err = slot_alloc(&copy);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_SLOT_ALLOC);
+    }
+    err = cap_copy(copy, frame);
+    if (err_is_fail(err)) {
+        slot_free(copy);
+        return err_push(err, LIB_ERR_CAP_COPY);
+    }
+
+    vregion_flags_t flags = vregion_get_flags(pc->vregion) & ~VREGION_FLAGS_WRITE;
+    err = map_page(pc, page, copy, foffset, flags, false);
+    if (err_is_fail(err)) {
+        cap_destroy(copy);
+    }
+    return err;
+}
+
+static errval_t unmap_page(struct memobj_pagecache *pc, size_t page)
+{
+    struct pmap *pmap = vspace_get_pmap(vregion_get_vspace(pc->vregion));
+    errval_t err;
+
+    err = pmap->f.unmap(pmap, page_vaddr(pc, page), BASE_PAGE_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_PMAP_UNMAP);
+    }
+
+    // deletes either our copy of the cached frame, or the private frame
+    err = cap_destroy(pc->map[page].cap);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_CAP_DESTROY);
+    }
+
+    pc->map[page].cap = NULL_CAP;
+    pc->map[page].private = false;
+    return SYS_ERR_OK;
+}
+
+/// Replace a mapped shared page by a writable private copy
+static errval_t make_private(struct memobj_pagecache *pc, size_t page)
+{
+    errval_t err;
+    struct capref frame;
+    void *buf;
+
+    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    err = vspace_map_one_frame(&buf, BASE_PAGE_SIZE, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    memcpy(buf, (void *)vspace_genvaddr_to_lvaddr(page_vaddr(pc, page)),
+           BASE_PAGE_SIZE);
+
+    err = vspace_unmap(buf);
+    assert(err_is_ok(err));
+
+    err = unmap_page(pc, page);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err;
+    }
+
+    err = map_page(pc, page, frame, 0, vregion_get_flags(pc->vregion), true);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err;
+    }
+
+    pc->cow_faults++;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Map the memory object into a region
+ *
+ * \param memobj  The memory object
+ * \param region  The region to add
+ */
+static errval_t map_region(struct memobj *memobj, struct vregion *vregion)
+{
+    struct memobj_pagecache *pc = (struct memobj_pagecache *)memobj;
+
+    if (pc->vregion != NULL) {
+        return LIB_ERR_MEMOBJ_VREGION_ALREADY_MAPPED;
+    }
+
+    pc->vregion = vregion;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Unmap the memory object from a region
+ *
+ * \param memobj   The memory object
+ * \param region  The region to remove
+ */
+static errval_t unmap_region(struct memobj *memobj, struct vregion *vregion)
+{
+    struct memobj_pagecache *pc = (struct memobj_pagecache *)memobj;
+    errval_t err;
+
+    if (pc->vregion != vregion) {
+        return LIB_ERR_VSPACE_VREGION_NOT_FOUND;
+    }
+
+    for (size_t page = 0; page < pc->npages; page++) {
+        if (!capref_is_null(pc->map[page].cap)) {
+            err = unmap_page(pc, page);
+            if (err_is_fail(err)) {
+                return err;
+            }
+        }
+    }
+
+    pc->vregion = NULL;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Set the protection on a range
+ *
+ * \param memobj  The memory object
+ * \param region  The vregion to modify the mappings on
+ * \param offset  Offset into the memory object
+ * \param range   The range of space to set the protection for
+ * \param flags   The protection flags
+ */
+static errval_t protect(struct memobj *memobj, struct vregion *vregion,
+                        genvaddr_t offset, size_t range, vs_prot_flags_t flags)
+{
+    USER_PANIC("NYI");
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Pin a range
+ *
+ * \param memobj  The memory object
+ * \param region  The vregion to modify the state on
+ * \param offset  Offset into the memory object
+ * \param range   The range of space to pin
+ */
+static errval_t pin(struct memobj *memobj, struct vregion *vregion,
+                    genvaddr_t offset, size_t range)
+{
+    USER_PANIC("NYI");
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Unpin a range
+ *
+ * \param memobj  The memory object
+ * \param region  The vregion to modify the state on
+ * \param offset  Offset into the memory object
+ * \param range   The range of space to unpin
+ */
+static errval_t unpin(struct memobj *memobj, struct vregion *vregion,
+                      genvaddr_t offset, size_t range)
+{
+    USER_PANIC("NYI");
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Page fault handler
+ *
+ * \param memobj  The memory object
+ * \param region  The associated vregion
+ * \param offset  Offset into memory object of the page fault
+ * \param type    The fault type
+ *
+ * Maps in the page from the page cache, fetching it if needed, and any
+ * cached pages of the read-ahead window that follow it.
+ */
+static errval_t pagefault(struct memobj *memobj, struct vregion *vregion,
+                          genvaddr_t offset, vm_fault_type_t type)
+{
+    struct memobj_pagecache *pc = (struct memobj_pagecache *)memobj;
+    errval_t err;
+
+    assert(vregion == pc->vregion);
+
+    // the memory object starts at the offset into the vregion
+    genvaddr_t vregion_off = vregion_get_offset(vregion);
+    if (offset < vregion_off) {
+        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
+    }
+    size_t page = (offset - vregion_off) / BASE_PAGE_SIZE;
+    if (page >= pc->npages) {
+        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
+    }
+
+    bool write = type == PAGEFLT_WRITE;
+    if (write && !(vregion_get_flags(vregion) & VREGION_FLAGS_WRITE)) {
+        return LIB_ERR_MEMOBJ_WRONG_FLAGS;
+    }
+
+    pc->faults++;
+
+    if (!capref_is_null(pc->map[page].cap)) {
+        // already mapped, so this can only be a write to a shared page
+        if (write && !pc->map[page].private) {
+            return make_private(pc, page);
+        }
+        return SYS_ERR_OK;
+    }
+
+    // adapt the read-ahead window to the access pattern
+    if (page == pc->next_page) {
+        pc->readahead = pc->readahead == 0 ? PAGECACHE_MIN_READAHEAD
+                        : MIN(pc->readahead * 2, PAGECACHE_MAX_READAHEAD);
+    } else {
+        pc->readahead = 0;
+    }
+    size_t readahead = MIN(pc->readahead, pc->npages - page - 1);
+
+    struct capref frame;
+    genpaddr_t foffset;
+    err = pc->ops->get_page(pc->st, pc->first_page + page, readahead,
+                            &frame, &foffset);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_MEMOBJ_PAGEFAULT_HANDLER);
+    }
+
+    err = map_shared(pc, page, frame, foffset);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    if (write) {
+        err = make_private(pc, page);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    // fault-around; this is only an optimisation, so stop at the first
+    // page that is not cached or cannot be mapped
+    size_t next = page + 1;
+    while (next <= page + readahead && capref_is_null(pc->map[next].cap)) {
+        if (!pc->ops->lookup_page(pc->st, pc->first_page + next, &frame,
+                                  &foffset)) {
+            break;
+        }
+        err = map_shared(pc, next, frame, foffset);
+        if (err_is_fail(err)) {
+            break;
+        }
+        next++;
+    }
+    pc->next_page = next;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Unmap the shared pages of a range of the page cache
+ *
+ * \param pc     The memory object
+ * \param first  First page of the page cache to drop
+ * \param count  Number of pages
+ *
+ * Called when the page cache no longer holds valid data for the pages, e.g.
+ * because the file was written. The next access faults the pages in again.
+ * Private copies of pages are kept.
+ */
+errval_t memobj_pagecache_invalidate(struct memobj_pagecache *pc,
+                                     size_t first, size_t count)
+{
+    errval_t err;
+
+    size_t start = first > pc->first_page ? first - pc->first_page : 0;
+    size_t end = first + count > pc->first_page ? first + count - pc->first_page
+                                                : 0;
+    end = MIN(end, pc->npages);
+
+    for (size_t page = start; page < end; page++) {
+        if (!capref_is_null(pc->map[page].cap) && !pc->map[page].private) {
+            err = unmap_page(pc, page);
+            if (err_is_fail(err)) {
+                return err;
+            }
+        }
+    }
+
+    // restart read-ahead detection
+    pc->next_page = 0;
+    pc->readahead = 0;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Free up some pages by placing them in the backing storage
+ *
+ * \param memobj      The memory object
+ * \param size        The amount of space to free up
+ * \param frames      An array of capref frames to return the freed pages
+ * \param num_frames  The number of frames returned
+ *
+ * This will affect all the vregions that are associated with the object
+ */
+static errval_t pager_free(struct memobj *memobj, size_t size,
+                           struct capref *frames, size_t num_frames)
+{
+    USER_PANIC("NYI");
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Initialize a memory object backed by a page cache
+ *
+ * \param pc          The memory object
+ * \param size        Size of the memory region
+ * \param flags       Memory object specific flags
+ * \param ops         Functions to get pages from the page cache
+ * \param st          Argument passed to ops
+ * \param first_page  Page of the page cache that appears at offset 0
+ */
+errval_t memobj_create_pagecache(struct memobj_pagecache *pc, size_t size,
+                                 memobj_flags_t flags,
+                                 const struct memobj_pagecache_ops *ops,
+                                 void *st, size_t first_page)
+{
+    struct memobj *memobj = &pc->m;
+
+    /* Generic portion */
+    memobj->f.map_region   = map_region;
+    memobj->f.unmap_region = unmap_region;
+    memobj->f.protect      = protect;
+    memobj->f.pin          = pin;
+    memobj->f.unpin        = unpin;
+    memobj->f.pagefault    = pagefault;
+    memobj->f.pager_free   = pager_free;
+
+    memobj->size  = size;
+    memobj->flags = flags;
+
+    memobj->type = MEMOBJ_PAGECACHE;
+
+    /* pagecache specific portion */
+    pc->npages = DIVIDE_ROUND_UP(size, BASE_PAGE_SIZE);
+    pc->map = calloc(pc->npages, sizeof(struct memobj_pagecache_map));
+    if (pc->map == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    for (size_t i = 0; i < pc->npages; i++) {
+        pc->map[i].cap = NULL_CAP;
+    }
+
+    pc->vregion = NULL;
+    pc->ops = ops;
+    pc->st = st;
+    pc->first_page = first_page;
+    pc->next_page = 0;
+    pc->readahead = 0;
+    pc->faults = 0;
+    pc->cow_faults = 0;
+    pc->pages_mapped = 0;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Destroy the object
+ *
+ * Unmaps all pages. The pages themselves belong to the page cache and are
+ * not freed, except for private copies.
+ */
+errval_t memobj_destroy_pagecache(struct memobj *memobj)
+{
+    struct memobj_pagecache *pc = (struct memobj_pagecache *)memobj;
+    errval_t err = SYS_ERR_OK;
+
+    if (pc->vregion != NULL) {
+        err = vregion_destroy(pc->vregion);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    free(pc->map);
+    pc->map = NULL;
+    return err;
+}
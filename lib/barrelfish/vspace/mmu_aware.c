@@ -57,6 +57,7 @@ errval_t vspace_mmu_aware_init_aligned(struct vspace_mmu_aware *state,
     state->size = size;
     state->consumed = 0;
     state->alignment = alignment;
+    memset(&state->stats, 0, sizeof(state->stats));
 
     vspace_mmu_aware_set_slot_alloc(state, slot_allocator);
 
@@ -79,11 +80,164 @@ errval_t vspace_mmu_aware_init_aligned(struct vspace_mmu_aware *state,
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Returns the page size with which to back the next chunk
+ *
+ * Large and huge pages are only used if the vregion asks for them and the
+ * chunk starts at a suitably aligned offset. If the vregion asks for both,
+ * huge pages are used once the region is big enough to make them worth it.
+ */
+static size_t mmu_aware_pagesize(struct vspace_mmu_aware *state,
+                                 size_t req_size)
+{
+    vregion_flags_t flags = state->vregion.flags;
+
+#if __x86_64__
+    if ((flags & VREGION_FLAGS_HUGE) &&
+        (state->mapoffset & HUGE_PAGE_MASK) == 0)
+    {
+        if (!(flags & VREGION_FLAGS_LARGE) || req_size >= HUGE_PAGE_SIZE / 2
+            || state->mapoffset >= HUGE_PAGE_SIZE)
+        {
+            return HUGE_PAGE_SIZE;
+        }
+    }
+#endif
+    if ((flags & VREGION_FLAGS_LARGE) &&
+        (state->mapoffset & LARGE_PAGE_MASK) == 0)
+    {
+        return LARGE_PAGE_SIZE;
+    }
+
+    return BASE_PAGE_SIZE;
+}
+
+/**
+ * \brief Accounts a frame mapped at an offset in the statistics
+ */
+static void mmu_aware_account(struct vspace_mmu_aware *state,
+                              genvaddr_t offset, size_t bytes)
+{
+    vregion_flags_t flags = state->vregion.flags;
+    genvaddr_t vaddr = vregion_get_base_addr(&state->vregion) + offset;
+
+    state->stats.frames++;
+#if __x86_64__
+    if ((flags & VREGION_FLAGS_HUGE) && bytes >= HUGE_PAGE_SIZE &&
+        (vaddr & HUGE_PAGE_MASK) == 0)
+    {
+        state->stats.huge_bytes += bytes;
+        return;
+    }
+#endif
+    if ((flags & VREGION_FLAGS_LARGE) && bytes >= LARGE_PAGE_SIZE &&
+        (vaddr & LARGE_PAGE_MASK) == 0)
+    {
+        state->stats.large_bytes += bytes;
+        return;
+    }
+    state->stats.base_bytes += bytes;
+}
+
+/**
+ * \brief Backs a chunk at the end of the mapped part of the region
+ *
+ * \param state     The object metadata
+ * \param size      Size of the chunk
+ * \param retsize   Returns the number of bytes backed, which may be more
+ *
+ * The chunk is backed by a single frame if there is enough contiguous memory.
+ * Otherwise it is filled with smaller frames, so that it still ends at the
+ * same offset and the next chunk can use large pages again.
+ *
+ * If backing fails part way, the frames already added stay in the region
+ * and the mapped part is extended over them, so that a later call continues
+ * behind them. A frame that could not be added to the region is deleted.
+ */
+static errval_t mmu_aware_fill(struct vspace_mmu_aware *state, size_t size,
+                               size_t *retsize)
+{
+    errval_t err = SYS_ERR_OK;
+    struct capref frame;
+    size_t filled = 0;
+    size_t frame_size = size;
+
+    while (filled < size) {
+        size_t ret_size = 0;
+        if (frame_size > size - filled) {
+            frame_size = size - filled;
+        }
+
+        err = state->slot_alloc->alloc(state->slot_alloc, &frame);
+        if (err_is_fail(err)) {
+            err = err_push(err, LIB_ERR_SLOT_ALLOC_NO_SPACE);
+            goto out;
+        }
+
+        err = frame_create(frame, frame_size, &ret_size);
+        if (err_is_fail(err)) {
+            state->slot_alloc->free(state->slot_alloc, frame);
+            if (err_no(err) == LIB_ERR_RAM_ALLOC_MS_CONSTRAINTS) {
+                // no contiguous memory of this size: retry with smaller frames
+                if (frame_size > BASE_PAGE_SIZE) {
+                    if (frame_size == size) {
+                        state->stats.fallbacks++;
+                    }
+                    frame_size = ROUND_UP(frame_size / 2, BASE_PAGE_SIZE);
+                    continue;
+                }
+                err = err_push(err, LIB_ERR_FRAME_CREATE_MS_CONSTRAINTS);
+                goto out;
+            }
+            err = err_push(err, LIB_ERR_FRAME_CREATE);
+            goto out;
+        }
+
+        if (state->consumed + filled + ret_size > state->size) {
+            err = LIB_ERR_VSPACE_MMU_AWARE_NO_SPACE;
+            goto delete_frame;
+        }
+
+        // Map it in
+        genvaddr_t offset = state->mapoffset + filled;
+        err = state->memobj.m.f.fill(&state->memobj.m, offset, frame,
+                                     ret_size);
+        if (err_is_fail(err)) {
+            err = err_push(err, LIB_ERR_MEMOBJ_FILL);
+            goto delete_frame;
+        }
+        // The frame now belongs to the region even if it cannot be mapped
+        // here, as the memobj maps it again when it is touched
+        mmu_aware_account(state, offset, ret_size);
+        filled += ret_size;
+
+        err = state->memobj.m.f.pagefault(&state->memobj.m, &state->vregion,
+                                          offset, 0);
+        if (err_is_fail(err)) {
+            err = err_push(err, LIB_ERR_MEMOBJ_PAGEFAULT_HANDLER);
+            goto out;
+        }
+    }
+
+    *retsize = filled;
+    return SYS_ERR_OK;
+
+delete_frame: {
+        errval_t err2 = cap_destroy(frame);
+        if (err_is_fail(err2)) {
+            DEBUG_ERR(err2, "cap_destroy failed");
+        }
+    }
+out:
+    // keep what was added so far
+    state->mapoffset += filled;
+    return err;
+}
+
 /**
  * \brief Create mappings
  *
  * \param state     The object metadata
- * \param frame     An empty slot to place the frame capability in
  * \param req_size  The required amount by the application
  * \param retbuf    Pointer to return the mapped buffer
  * \param retsize   The actual size returned
@@ -98,8 +252,6 @@ errval_t vspace_mmu_aware_map(struct vspace_mmu_aware *state, size_t req_size,
 {
     errval_t err;
 
-    struct capref frame;
-
     // Calculate how much still to map in
     size_t origsize = req_size;
     assert(state->mapoffset >= state->offset);
@@ -108,79 +260,20 @@ errval_t vspace_mmu_aware_map(struct vspace_mmu_aware *state, size_t req_size,
     } else {
         req_size -= state->mapoffset - state->offset;
     }
-    size_t alloc_size = ROUND_UP(req_size, BASE_PAGE_SIZE);
-    size_t ret_size = 0;
 
     if (req_size > 0) {
-#if __x86_64__
-        if ((state->vregion.flags & VREGION_FLAGS_HUGE) &&
-            (state->mapoffset & HUGE_PAGE_MASK) == 0)
-        {
-            // this is an opportunity to switch to 1G pages if requested.
-            // we know that we can use large pages without jumping through hoops
-            // if state->vregion.flags has VREGION_FLAGS_HUGE set and
-            // mapoffset is aligned to at least HUGE_PAGE_SIZE.
-            alloc_size = ROUND_UP(req_size, HUGE_PAGE_SIZE);
-
-            // goto allocation directly so we can avoid nasty code interaction
-            // between #if __x86_64__ and the size checks, we want to be able
-            // to use 2M pages on x86_64 also. -SG, 2015-04-30.
-            goto allocate;
-        }
-#endif
-        if ((state->vregion.flags & VREGION_FLAGS_LARGE) &&
-            (state->mapoffset & LARGE_PAGE_MASK) == 0)
-        {
-            // this is an opportunity to switch to 2M pages if requested.
-            // we know that we can use large pages without jumping through hoops
-            // if state->vregion.flags has VREGION_FLAGS_LARGE set and
-            // mapoffset is aligned to at least LARGE_PAGE_SIZE.
-            alloc_size = ROUND_UP(req_size, LARGE_PAGE_SIZE);
-        }
-        // Create frame of appropriate size
-allocate:
-        err = state->slot_alloc->alloc(state->slot_alloc, &frame);
-        if (err_is_fail(err)) {
-            return err_push(err, LIB_ERR_SLOT_ALLOC_NO_SPACE);
-        }
+        // back whole pages of the size the region can use here
+        size_t alloc_size = ROUND_UP(req_size,
+                                     mmu_aware_pagesize(state, req_size));
+        size_t ret_size = 0;
 
-        err = frame_create(frame, alloc_size, &ret_size);
+        err = mmu_aware_fill(state, alloc_size, &ret_size);
         if (err_is_fail(err)) {
-            if (err_no(err) == LIB_ERR_RAM_ALLOC_MS_CONSTRAINTS) {
-                // we can only get 4k frames for now; retry with 4k
-                if (alloc_size > BASE_PAGE_SIZE && req_size <= BASE_PAGE_SIZE) {
-                    alloc_size = BASE_PAGE_SIZE;
-                    goto allocate;
-                }
-                return err_push(err, LIB_ERR_FRAME_CREATE_MS_CONSTRAINTS);
-            }
-            return err_push(err, LIB_ERR_FRAME_CREATE);
+            return err;
         }
         assert(ret_size >= req_size);
         origsize += ret_size - req_size;
         req_size = ret_size;
-
-        if (state->consumed + req_size > state->size) {
-            err = cap_delete(frame);
-            if (err_is_fail(err)) {
-                debug_err(__FILE__, __func__, __LINE__, err,
-                          "cap_delete failed");
-            }
-            state->slot_alloc->free(state->slot_alloc, frame);
-            return LIB_ERR_VSPACE_MMU_AWARE_NO_SPACE;
-        }
-
-        // Map it in
-        err = state->memobj.m.f.fill(&state->memobj.m, state->mapoffset, frame,
-                                     req_size);
-        if (err_is_fail(err)) {
-            return err_push(err, LIB_ERR_MEMOBJ_FILL);
-        }
-        err = state->memobj.m.f.pagefault(&state->memobj.m, &state->vregion,
-                                          state->mapoffset, 0);
-        if (err_is_fail(err)) {
-            return err_push(err, LIB_ERR_MEMOBJ_PAGEFAULT_HANDLER);
-        }
     }
 
     // Return buffer
@@ -259,6 +352,9 @@ errval_t vspace_mmu_aware_reset(struct vspace_mmu_aware *state,
         return err_push(err, LIB_ERR_MEMOBJ_PAGEFAULT_HANDLER);
     }
 
+    memset(&state->stats, 0, sizeof(state->stats));
+    mmu_aware_account(state, 0, size);
+
     state->mapoffset = size;
     return SYS_ERR_OK;
 }
@@ -100,6 +100,19 @@ void bomp_start_processing(void (*fn)(void *),
     memory += sizeof(struct bomp_barrier);
     bomp_barrier_init(barrier, nthreads);
 
+    /* the barrier of the GOMP_barrier() calls, combining per NUMA node */
+    struct bomp_hbarrier *hbarrier = NULL;
+    coreid_t *cores = calloc(nthreads, sizeof(coreid_t));
+    if (cores != NULL) {
+        cores[0] = disp_get_core_id();
+        for (i = 1; i < nthreads; i++) {
+            cores[i] = disp_get_core_id() + i * BOMP_DEFAULT_CORE_STRIDE
+                        + THREAD_OFFSET;
+        }
+        hbarrier = bomp_hbarrier_new(nthreads, cores);
+        free(cores);
+    }
+
     /* For main thread */
     xdata = (struct bomp_work *) memory;
     memory += sizeof(struct bomp_work);
@@ -108,6 +121,7 @@ void bomp_start_processing(void (*fn)(void *),
     xdata->data = data;
     xdata->thread_id = 0;
     xdata->barrier = barrier;
+    xdata->hbarrier = hbarrier;
     bomp_set_tls(xdata);
 
     for (i = 1; i < nthreads; i++) {
@@ -118,6 +132,7 @@ void bomp_start_processing(void (*fn)(void *),
         xdata->data = data;
         xdata->thread_id = i;
         xdata->barrier = barrier;
+        xdata->hbarrier = hbarrier;
 
         /* Create threads */
         bomp_run_on(i * BOMP_DEFAULT_CORE_STRIDE + THREAD_OFFSET, bomp_thread_fn,
@@ -134,6 +149,7 @@ void bomp_end_processing(void)
 
     /* Clear the barrier created */
     bomp_clear_barrier(g_bomp_state->tld[i]->work->barrier);
+    bomp_hbarrier_free(g_bomp_state->tld[i]->work->hbarrier);
 
     free(g_bomp_state->tld);
     g_bomp_state->tld = NULL;
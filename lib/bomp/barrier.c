@@ -18,7 +18,13 @@ void GOMP_barrier(void)
 
     struct bomp_thread_local_data *th_local_data = g_bomp_state->backend.get_tls();
     assert(th_local_data != NULL);
-    bomp_barrier_wait(th_local_data->work->barrier);
+
+    struct bomp_work *work = th_local_data->work;
+    if (work->hbarrier) {
+        bomp_hbarrier_wait(work->hbarrier, work->thread_id);
+    } else {
+        bomp_barrier_wait(work->barrier);
+    }
 }
 
 bool GOMP_barrier_cancel (void)
@@ -22,6 +22,7 @@
 #include <bomp_backend.h>
 
 #include <barrelfish/barrelfish.h>
+#include <bomp_sync.h>
 
 
 #if XOMP_BENCH_ENABLED
@@ -63,6 +64,7 @@ struct bomp_work {
     unsigned num_threads;
     unsigned num_vtreads;
     struct bomp_barrier *barrier;
+    struct bomp_hbarrier *hbarrier;   ///< topology aware barrier, if any
 };
 
 struct bomp_thread_local_data {
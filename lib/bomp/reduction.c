@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+#include <bomp_internal.h>
+
+/*
+ * These functions combine a value of each thread of the team, like the
+ * reduction clause but without going through an atomic section. They are only
+ * available with the BOMP backend.
+ */
+
+static uint64_t bomp_reduce(uint64_t value, bomp_reduce_op_t op)
+{
+    assert(g_bomp_state);
+
+    struct bomp_thread_local_data *th_local_data = g_bomp_state->backend.get_tls();
+    if (th_local_data == NULL || g_bomp_state->num_threads <= 1) {
+        /* sequential part of the program */
+        return value;
+    }
+
+    struct bomp_work *work = th_local_data->work;
+    if (work->hbarrier == NULL) {
+        USER_PANIC("bomp: reductions are not supported by this backend\n");
+    }
+
+    return bomp_hbarrier_reduce(work->hbarrier, work->thread_id, value, op);
+}
+
+int64_t bomp_reduce_int64(int64_t value, bomp_reduce_op_t op)
+{
+    assert(op <= BOMP_REDUCE_MAX_INT);
+    return (int64_t)bomp_reduce((uint64_t)value, op);
+}
+
+double bomp_reduce_double(double value, bomp_reduce_op_t op)
+{
+    assert(op == BOMP_REDUCE_NONE || op >= BOMP_REDUCE_ADD_DOUBLE);
+    return bomp_reduce_to_double(bomp_reduce(bomp_reduce_from_double(value),
+                                             op));
+}
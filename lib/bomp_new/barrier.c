@@ -14,12 +14,10 @@
 
 void GOMP_barrier(void)
 {
-    assert(!"NYI");
-//    assert(g_bomp_state);
-//
-//    struct bomp_thread_local_data *th_local_data = g_bomp_state->backend.get_tls();
-//    assert(th_local_data != NULL);
-//    bomp_barrier_wait(th_local_data->work->barrier);
+    coreid_t tid;
+    struct bomp_team *team = bomp_team_get(&tid);
+
+    bomp_team_barrier(team, tid);
 }
 
 bool GOMP_barrier_cancel (void)
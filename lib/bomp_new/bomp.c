@@ -138,6 +138,7 @@ void bomp_end_processing(void)
         }
     }
 
+    bomp_team_free(tls->icv.task->team);
     free(tls->icv.task);
     tls->icv.task = NULL;
 
@@ -72,6 +72,7 @@ static errval_t bomp_node_init_threads(nodeid_t nodeid,
         BOMP_DEBUG_NODE("spanning to core %u\n", core);
         node->threads_max++;
         node->threads[i].node = node;
+        node->threads[i].coreid = core;
         if (core == disp_get_core_id()) {
             /* master thread */
             core = (coreid_t)bitmap_get_next(bm, core);
@@ -21,6 +21,7 @@
 #include <omp_environment.h>
 
 #include <bomp_debug.h>
+#include <bomp_sync.h>
 
 
 #include <if/bomp_defs.h>
@@ -117,6 +118,7 @@ struct bomp_tls {
     struct omp_icv icv;             ///< pointer holding the environment variables
     coreid_t thread_id;
     bomp_thread_role_t role;     ///< identifies the role of the thread
+    struct bomp_team *serial;    ///< team of one for constructs outside a team
     union {
         struct bomp_master master;
         struct bomp_node   node;
@@ -126,6 +128,87 @@ struct bomp_tls {
 };
 
 
+/*
+ * ---------------------------------------------------------------------------
+ * Teams: barriers and work sharing loops
+ * ---------------------------------------------------------------------------
+ */
+
+///< maximum number of rounds of the dissemination barrier (2^16 threads)
+#define BOMP_BARRIER_ROUNDS_MAX 16
+
+///< number of work sharing loops that may be in progress at the same time
+#define BOMP_LOOP_MAX 4
+
+/**
+ * \brief shared descriptor of a work sharing loop
+ *
+ * The iterations are numbered 0..count-1, iteration i being start + i * incr.
+ * The descriptor is set up by the first thread reaching the loop, the other
+ * threads wait until gen matches the generation of their loop.
+ */
+struct bomp_loop {
+    volatile long gen;          ///< generation of the loop held by the descriptor
+    volatile long claim;        ///< generation claimed for setting up the loop
+    omp_sched_t sched;          ///< schedule of the loop
+    long start;                 ///< value of the first iteration
+    long incr;                  ///< increment between two iterations
+    unsigned long count;        ///< number of iterations
+    unsigned long chunk;        ///< chunk size
+    coreid_t nthreads;          ///< number of threads sharing the loop
+
+    ///< next iteration to hand out, on its own cache line
+    volatile unsigned long next __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    ///< number of threads not done with the loop
+    volatile coreid_t active __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+/**
+ * \brief per thread state of a team
+ */
+struct bomp_team_thread {
+    ///< barrier episode signalled by the partner in each round
+    volatile uint64_t barrier_flags[BOMP_BARRIER_ROUNDS_MAX];
+    uint64_t barrier_episode;   ///< number of barriers entered by the thread
+    long loop_gen;              ///< generation of the next loop to enter
+    struct bomp_loop *loop;     ///< the current loop of the thread
+    unsigned long loop_next;    ///< next chunk of a static schedule
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/**
+ * \brief the threads executing a parallel region
+ */
+struct bomp_team {
+    coreid_t nthreads;                      ///< number of threads in the team
+    uint8_t barrier_rounds;                 ///< rounds of the barrier
+    struct bomp_hbarrier *hbarrier;         ///< NUMA aware barrier
+    bool hierarchical;                      ///< the team spans NUMA nodes
+    void *mem;                              ///< the unaligned allocation
+    struct bomp_loop loops[BOMP_LOOP_MAX];  ///< work sharing loops
+    struct bomp_team_thread threads[];      ///< per thread state
+};
+
+///< arguments of a loop combined with a parallel construct
+struct bomp_loop_args {
+    omp_sched_t sched;
+    long start;
+    long end;
+    long incr;
+    long chunk;
+};
+
+struct bomp_team *bomp_team_new(coreid_t nthreads, struct bomp_node *node);
+void bomp_team_free(struct bomp_team *team);
+struct bomp_team *bomp_team_get(coreid_t *ret_tid);
+void bomp_team_barrier(struct bomp_team *team, coreid_t tid);
+void bomp_team_loop_init(struct bomp_team *team, struct bomp_loop_args *args);
+struct bomp_loop *bomp_team_loop_enter(struct bomp_team *team, coreid_t tid,
+                                       struct bomp_loop_args *args);
+void bomp_team_loop_leave(struct bomp_team *team, coreid_t tid);
+void bomp_parallel_start(void (*fn)(void *), void *data, unsigned nthreads,
+                         struct bomp_loop_args *loop);
+
 errval_t bomp_node_init(bomp_node_type_t type, nodeid_t numanode, nodeid_t nodeid, coreid_t nthreads,
                         size_t stack_size, struct bomp_node *node);
 coreid_t bomp_node_exec(struct bomp_node *node, void *fn, void *arg, coreid_t tid_start, coreid_t nthreads);
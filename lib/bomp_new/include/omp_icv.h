@@ -128,6 +128,13 @@ struct omp_icv_task
      */
     omp_sched_t run_sched;
     int         run_sched_modifier;
+
+    /**
+     * the team of threads executing the parallel region of the task
+     *
+     * This variable is purely BOMP related
+     */
+    struct bomp_team *team;
 };
 
 /**
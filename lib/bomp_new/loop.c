@@ -31,14 +31,165 @@
  * GOMP_parallel_end ();
  */
 
-bool GOMP_loop_ordered_runtime_start(long start,
-                                     long end,
-                                     long incr,
-                                     long *istart,
-                                     long *iend)
+/*
+ * The iterations of a loop are handed out in chunks from the loop descriptor
+ * shared by the team:
+ *
+ *  - static:  thread t executes the chunks t, t + n, t + 2n, ... without any
+ *             synchronization. Without a chunk size, each thread gets one
+ *             block of iterations.
+ *  - dynamic: the threads grab the next chunk by atomically advancing the
+ *             shared iteration counter.
+ *  - guided:  like dynamic, but the chunks are proportional to the number of
+ *             remaining iterations divided by the number of threads, and
+ *             never smaller than the chunk size.
+ *  - runtime: one of the above, as selected by the run-sched-var ICV.
+ */
+
+/**
+ * \brief hands out the next chunk of iterations of a loop
+ *
+ * \param self      the loop state of the calling thread
+ * \param istart    returns the first iteration of the chunk
+ * \param iend      returns the iteration after the last one of the chunk
+ *
+ * \returns TRUE if there is a chunk to execute
+ *          FALSE if the loop is done
+ */
+static bool loop_next(struct bomp_team_thread *self,
+                      long *istart,
+                      long *iend)
 {
-    assert(!"NYI");
-    return 0;
+    struct bomp_loop *loop = self->loop;
+    unsigned long first, n;
+
+    assert(loop != NULL);
+
+    switch (loop->sched) {
+        case OMP_SCHED_STATIC:
+            first = self->loop_next * loop->chunk;
+            if (self->loop_next >= loop->count || first >= loop->count) {
+                return false;
+            }
+            self->loop_next += loop->nthreads;
+            n = loop->chunk;
+            break;
+
+        case OMP_SCHED_DYNAMIC:
+            /* the counter overshoots by at most one chunk per thread */
+            first = __sync_fetch_and_add(&loop->next, loop->chunk);
+            if (first >= loop->count) {
+                return false;
+            }
+            n = loop->chunk;
+            break;
+
+        case OMP_SCHED_GUIDED:
+            first = loop->next;
+            while (1) {
+                if (first >= loop->count) {
+                    return false;
+                }
+                unsigned long left = loop->count - first;
+                n = (left + loop->nthreads - 1) / loop->nthreads;
+                if (n < loop->chunk) {
+                    n = loop->chunk;
+                }
+                if (n > left) {
+                    n = left;
+                }
+                unsigned long seen = __sync_val_compare_and_swap(&loop->next,
+                                                                 first,
+                                                                 first + n);
+                if (seen == first) {
+                    break;
+                }
+                first = seen;
+            }
+            break;
+
+        default:
+            USER_PANIC("bomp: unknown loop schedule %u\n", loop->sched);
+            return false;
+    }
+
+    if (n > loop->count - first) {
+        n = loop->count - first;
+    }
+
+    *istart = loop->start + (long)first * loop->incr;
+    *iend = loop->start + (long)(first + n) * loop->incr;
+
+    return true;
+}
+
+/**
+ * \brief enters a work sharing loop and hands out its first chunk
+ */
+static bool loop_start(omp_sched_t sched,
+                       long start,
+                       long end,
+                       long incr,
+                       long chunk_size,
+                       long *istart,
+                       long *iend)
+{
+    struct bomp_loop_args args = {
+        .sched = sched,
+        .start = start,
+        .end = end,
+        .incr = incr,
+        .chunk = chunk_size
+    };
+
+    coreid_t tid;
+    struct bomp_team *team = bomp_team_get(&tid);
+
+    bomp_team_loop_enter(team, tid, &args);
+
+    return loop_next(&team->threads[tid], istart, iend);
+}
+
+static bool loop_next_current(long *istart,
+                              long *iend)
+{
+    coreid_t tid;
+    struct bomp_team *team = bomp_team_get(&tid);
+
+    return loop_next(&team->threads[tid], istart, iend);
+}
+
+/**
+ * \brief returns the schedule of a loop with the runtime schedule
+ */
+static omp_sched_t loop_runtime_sched(long *chunk_size)
+{
+    struct omp_icv_task *task = bomp_icv_get()->task;
+    if (task == NULL) {
+        task = &g_omp_icv_task_default;
+    }
+
+    *chunk_size = task->run_sched_modifier;
+
+    switch (task->run_sched) {
+        case OMP_SCHED_DYNAMIC:
+        case OMP_SCHED_GUIDED:
+            return task->run_sched;
+        default:
+            /* auto is static */
+            return OMP_SCHED_STATIC;
+    }
+}
+
+bool GOMP_loop_static_start(long start,
+                            long end,
+                            long incr,
+                            long chunk_size,
+                            long *istart,
+                            long *iend)
+{
+    return loop_start(OMP_SCHED_STATIC, start, end, incr, chunk_size,
+                      istart, iend);
 }
 
 bool GOMP_loop_dynamic_start(long start,
@@ -47,16 +198,66 @@ bool GOMP_loop_dynamic_start(long start,
                              long chunk_size,
                              long *istart,
                              long *iend)
+{
+    return loop_start(OMP_SCHED_DYNAMIC, start, end, incr, chunk_size,
+                      istart, iend);
+}
+
+bool GOMP_loop_guided_start(long start,
+                            long end,
+                            long incr,
+                            long chunk_size,
+                            long *istart,
+                            long *iend)
+{
+    return loop_start(OMP_SCHED_GUIDED, start, end, incr, chunk_size,
+                      istart, iend);
+}
+
+bool GOMP_loop_runtime_start(long start,
+                             long end,
+                             long incr,
+                             long *istart,
+                             long *iend)
+{
+    long chunk_size;
+    omp_sched_t sched = loop_runtime_sched(&chunk_size);
+
+    return loop_start(sched, start, end, incr, chunk_size, istart, iend);
+}
+
+bool GOMP_loop_ordered_runtime_start(long start,
+                                     long end,
+                                     long incr,
+                                     long *istart,
+                                     long *iend)
 {
     assert(!"NYI");
     return 0;
 }
 
+bool GOMP_loop_static_next(long *istart,
+                           long *iend)
+{
+    return loop_next_current(istart, iend);
+}
+
+bool GOMP_loop_dynamic_next(long *istart,
+                            long *iend)
+{
+    return loop_next_current(istart, iend);
+}
+
+bool GOMP_loop_guided_next(long *istart,
+                           long *iend)
+{
+    return loop_next_current(istart, iend);
+}
+
 bool GOMP_loop_runtime_next(long *istart,
                             long *iend)
 {
-    assert(!"NYI");
-    return 0;
+    return loop_next_current(istart, iend);
 }
 
 bool GOMP_loop_ordered_runtime_next(long *istart,
@@ -66,20 +267,156 @@ bool GOMP_loop_ordered_runtime_next(long *istart,
     return 0;
 }
 
-bool GOMP_loop_dynamic_next(long *istart,
-                            long *iend)
+/*
+ * combined parallel loop constructs
+ *
+ * #pragma omp parallel for schedule(dynamic)
+ *
+ * sets up the loop for all threads of the team before they are started, the
+ * threads then only call GOMP_loop_dynamic_next().
+ */
+
+static void parallel_loop_start(void (*fn)(void *),
+                                void *data,
+                                unsigned num_threads,
+                                omp_sched_t sched,
+                                long start,
+                                long end,
+                                long incr,
+                                long chunk_size)
 {
-    assert(!"NYI");
-    return 0;
+    struct bomp_loop_args args = {
+        .sched = sched,
+        .start = start,
+        .end = end,
+        .incr = incr,
+        .chunk = chunk_size
+    };
+
+    bomp_parallel_start(fn, data, num_threads, &args);
+}
+
+void GOMP_parallel_loop_static_start(void (*fn)(void *),
+                                     void *data,
+                                     unsigned num_threads,
+                                     long start,
+                                     long end,
+                                     long incr,
+                                     long chunk_size)
+{
+    parallel_loop_start(fn, data, num_threads, OMP_SCHED_STATIC, start, end,
+                        incr, chunk_size);
+}
+
+void GOMP_parallel_loop_dynamic_start(void (*fn)(void *),
+                                      void *data,
+                                      unsigned num_threads,
+                                      long start,
+                                      long end,
+                                      long incr,
+                                      long chunk_size)
+{
+    parallel_loop_start(fn, data, num_threads, OMP_SCHED_DYNAMIC, start, end,
+                        incr, chunk_size);
+}
+
+void GOMP_parallel_loop_guided_start(void (*fn)(void *),
+                                     void *data,
+                                     unsigned num_threads,
+                                     long start,
+                                     long end,
+                                     long incr,
+                                     long chunk_size)
+{
+    parallel_loop_start(fn, data, num_threads, OMP_SCHED_GUIDED, start, end,
+                        incr, chunk_size);
+}
+
+void GOMP_parallel_loop_runtime_start(void (*fn)(void *),
+                                      void *data,
+                                      unsigned num_threads,
+                                      long start,
+                                      long end,
+                                      long incr)
+{
+    long chunk_size;
+    omp_sched_t sched = loop_runtime_sched(&chunk_size);
+
+    parallel_loop_start(fn, data, num_threads, sched, start, end, incr,
+                        chunk_size);
+}
+
+void GOMP_parallel_loop_static(void (*fn)(void *),
+                               void *data,
+                               unsigned num_threads,
+                               long start,
+                               long end,
+                               long incr,
+                               long chunk_size,
+                               unsigned flags)
+{
+    GOMP_parallel_loop_static_start(fn, data, num_threads, start, end, incr,
+                                    chunk_size);
+    fn(data);
+    GOMP_parallel_end();
+}
+
+void GOMP_parallel_loop_dynamic(void (*fn)(void *),
+                                void *data,
+                                unsigned num_threads,
+                                long start,
+                                long end,
+                                long incr,
+                                long chunk_size,
+                                unsigned flags)
+{
+    GOMP_parallel_loop_dynamic_start(fn, data, num_threads, start, end, incr,
+                                     chunk_size);
+    fn(data);
+    GOMP_parallel_end();
+}
+
+void GOMP_parallel_loop_guided(void (*fn)(void *),
+                               void *data,
+                               unsigned num_threads,
+                               long start,
+                               long end,
+                               long incr,
+                               long chunk_size,
+                               unsigned flags)
+{
+    GOMP_parallel_loop_guided_start(fn, data, num_threads, start, end, incr,
+                                    chunk_size);
+    fn(data);
+    GOMP_parallel_end();
+}
+
+void GOMP_parallel_loop_runtime(void (*fn)(void *),
+                                void *data,
+                                unsigned num_threads,
+                                long start,
+                                long end,
+                                long incr,
+                                unsigned flags)
+{
+    GOMP_parallel_loop_runtime_start(fn, data, num_threads, start, end, incr);
+    fn(data);
+    GOMP_parallel_end();
 }
 
 void GOMP_loop_end_nowait(void)
 {
-    assert(!"NYI");
+    coreid_t tid;
+    struct bomp_team *team = bomp_team_get(&tid);
+
+    bomp_team_loop_leave(team, tid);
 }
 
 void GOMP_loop_end(void)
 {
-    assert(!"NYI");
-}
+    coreid_t tid;
+    struct bomp_team *team = bomp_team_get(&tid);
 
+    bomp_team_loop_leave(team, tid);
+    bomp_team_barrier(team, tid);
+}
@@ -28,9 +28,19 @@
  *  GOMP_parallel_end ();
  */
 
-void GOMP_parallel_start(void (*fn)(void *),
+/**
+ * \brief starts a parallel region
+ *
+ * \param fn        the function executed by the threads
+ * \param data      argument to the function
+ * \param nthreads  requested number of threads
+ * \param loop      a loop to set up for the team before its threads are
+ *                  started, or NULL
+ */
+void bomp_parallel_start(void (*fn)(void *),
                          void *data,
-                         unsigned nthreads)
+                         unsigned nthreads,
+                         struct bomp_loop_args *loop)
 {
     debug_printf("GOMP_parallel_start(%p, %p, %u)\n", fn, data, nthreads);
 
@@ -53,6 +63,21 @@ void GOMP_parallel_start(void (*fn)(void *),
             debug_printf("resetting to = %u\n", icv_task->nthreads);
         }
 
+        struct bomp_tls *tls = thread_get_tls();
+        struct bomp_node *node = (tls->role == BOMP_THREAD_ROLE_MASTER)
+                                    ? &tls->r.master.local : &tls->r.node;
+
+        icv_task->team = bomp_team_new(icv_task->nthreads, node);
+        if (!icv_task->team) {
+            debug_printf("no team\n");
+            free(icv_task);
+            return;
+        }
+
+        if (loop) {
+            bomp_team_loop_init(icv_task->team, loop);
+        }
+
         bomp_icv_set_task(icv_task);
         debug_printf("icv task set %u\n", icv_task->nthreads);
 
@@ -69,9 +94,22 @@ void GOMP_parallel_start(void (*fn)(void *),
         //debug_printf("setting active_levels to %u\n", active_levels+1);
 
         OMP_SET_ICV_TASK(active_levels, active_levels+1);
+
+        if (loop) {
+            /* the thread executes the nested region on its own */
+            coreid_t tid;
+            bomp_team_loop_init(bomp_team_get(&tid), loop);
+        }
     }
 }
 
+void GOMP_parallel_start(void (*fn)(void *),
+                         void *data,
+                         unsigned nthreads)
+{
+    bomp_parallel_start(fn, data, nthreads, NULL);
+}
+
 void GOMP_parallel_end(void)
 {
 //    debug_printf("GOMP_parallel_end\n");
@@ -0,0 +1,345 @@
+/**
+ * \file
+ * \brief Teams of threads executing a parallel region
+ *
+ * A team holds the state the threads of a parallel region share: the
+ * barrier and the descriptors of the work sharing loops. Every thread of the
+ * team has its own cache line with its barrier flags and loop state.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <bomp_internal.h>
+#include <bitmap.h>
+
+///< number of spins before yielding the core while waiting
+#define BOMP_SPIN_YIELD 0x400
+
+static inline void spin_wait(uint64_t *waitcnt)
+{
+    if (++(*waitcnt) == BOMP_SPIN_YIELD) {
+        *waitcnt = 0;
+        thread_yield();
+    }
+}
+
+/**
+ * \brief determines the core of each thread of a new team
+ *
+ * \param node      the node of the calling thread
+ * \param nthreads  the number of threads in the team
+ * \param cores     returns the core of each thread
+ *
+ * The thread IDs follow bomp_start_processing(): the calling thread is 0,
+ * the threads handed to the other nodes come next, then the local threads.
+ * The threads of other nodes are only known by the NUMA node they run on, so
+ * the first core of that node stands in for them.
+ */
+static errval_t team_cores(struct bomp_node *node, coreid_t nthreads,
+                           coreid_t *cores)
+{
+    struct bomp_tls *tls = thread_get_tls();
+    coreid_t tid = 0;
+
+    cores[tid++] = disp_get_core_id();
+
+    if (tls->role == BOMP_THREAD_ROLE_MASTER && nthreads > node->threads_max) {
+        struct bitmap *bm = numa_allocate_cpumask();
+        if (bm == NULL) {
+            return LIB_ERR_MALLOC_FAIL;
+        }
+
+        coreid_t remote = nthreads - node->threads_max;
+        for (nodeid_t n = 0; n < tls->r.master.num_nodes && remote > 0; ++n) {
+            struct bomp_node *child = &tls->r.master.nodes[n];
+            errval_t err = numa_node_to_cpus(child->numa_node, bm);
+            if (err_is_fail(err)) {
+                numa_free_cpumask(bm);
+                return err;
+            }
+            coreid_t core = (coreid_t)bitmap_get_first(bm);
+            for (coreid_t i = 0; i < child->threads_max && remote > 0; ++i) {
+                cores[tid++] = core;
+                remote--;
+            }
+        }
+
+        numa_free_cpumask(bm);
+    }
+
+    /* the local threads are started from index 1 */
+    for (coreid_t i = 1; tid < nthreads; ++i) {
+        /* more threads than the nodes have: they can only run here */
+        cores[tid++] = (i < node->threads_max) ? node->threads[i].coreid
+                                               : cores[0];
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief allocates a new team
+ *
+ * \param nthreads  the number of threads in the team
+ * \param node      the node whose threads form the team, thread 0 being the
+ *                  calling thread. NULL for a team of one.
+ *
+ * \returns pointer to the team on SUCCESS
+ *          NULL on FAILURE
+ */
+struct bomp_team *bomp_team_new(coreid_t nthreads, struct bomp_node *node)
+{
+    assert(nthreads > 0);
+
+    size_t size = sizeof(struct bomp_team)
+                    + nthreads * sizeof(struct bomp_team_thread);
+    void *mem = calloc(1, size + CACHE_LINE_SIZE);
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    struct bomp_team *team = (struct bomp_team *)ROUND_UP((lvaddr_t)mem,
+                                                          CACHE_LINE_SIZE);
+    team->mem = mem;
+    team->nthreads = nthreads;
+
+    team->barrier_rounds = 0;
+    while ((1UL << team->barrier_rounds) < nthreads) {
+        team->barrier_rounds++;
+    }
+    assert(team->barrier_rounds <= BOMP_BARRIER_ROUNDS_MAX);
+
+    if (node) {
+        coreid_t *cores = calloc(nthreads, sizeof(coreid_t));
+        if (cores == NULL) {
+            free(mem);
+            return NULL;
+        }
+
+        errval_t err = team_cores(node, nthreads, cores);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "determining the cores of the team");
+            free(cores);
+            free(mem);
+            return NULL;
+        }
+
+        team->hbarrier = bomp_hbarrier_new(nthreads, cores);
+        free(cores);
+        if (team->hbarrier == NULL) {
+            free(mem);
+            return NULL;
+        }
+
+        /* within a NUMA node the dissemination barrier does better */
+        team->hierarchical = (bomp_hbarrier_num_groups(team->hbarrier) > 1);
+    }
+
+    /* loop generation g uses slot g % BOMP_LOOP_MAX, the first being 0 */
+    for (long i = 0; i < BOMP_LOOP_MAX; ++i) {
+        team->loops[i].gen = i - BOMP_LOOP_MAX;
+        team->loops[i].claim = i - BOMP_LOOP_MAX;
+    }
+
+    return team;
+}
+
+/**
+ * \brief frees a team after all its threads are done
+ */
+void bomp_team_free(struct bomp_team *team)
+{
+    if (team) {
+        bomp_hbarrier_free(team->hbarrier);
+        free(team->mem);
+    }
+}
+
+/**
+ * \brief returns the team of the calling thread
+ *
+ * \param ret_tid   returns the ID of the thread within the team
+ *
+ * Outside of a parallel region, and in nested regions, the thread executes
+ * the constructs on its own and gets a team of one.
+ */
+struct bomp_team *bomp_team_get(coreid_t *ret_tid)
+{
+    struct bomp_tls *tls = thread_get_tls();
+    struct omp_icv_task *task = tls->icv.task;
+
+    if (task && task->team && task->active_levels == 1) {
+        *ret_tid = tls->thread_id;
+        return task->team;
+    }
+
+    if (tls->serial == NULL) {
+        tls->serial = bomp_team_new(1, NULL);
+        if (tls->serial == NULL) {
+            USER_PANIC("bomp: could not allocate team\n");
+        }
+    }
+
+    *ret_tid = 0;
+    return tls->serial;
+}
+
+/**
+ * \brief waits until all threads of the team have reached the barrier
+ *
+ * \param team  the team
+ * \param tid   ID of the calling thread
+ *
+ * This is a dissemination barrier: in round r, thread i signals thread
+ * (i + 2^r) mod n and waits for the signal of thread (i - 2^r) mod n. Each
+ * thread spins on its own cache line only, and after ceil(log2(n)) rounds all
+ * threads have transitively heard from every other thread. The flags hold the
+ * episode of the barrier, which only grows, so no flag needs to be reset.
+ *
+ * Teams spanning several NUMA nodes use the hierarchical barrier instead,
+ * which crosses nodes only once per node.
+ */
+void bomp_team_barrier(struct bomp_team *team, coreid_t tid)
+{
+    if (team->hierarchical) {
+        bomp_hbarrier_wait(team->hbarrier, tid);
+        return;
+    }
+
+    struct bomp_team_thread *self = &team->threads[tid];
+    uint64_t episode = ++self->barrier_episode;
+
+    /* make the writes before the barrier visible to the other threads */
+    __sync_synchronize();
+
+    for (uint8_t r = 0; r < team->barrier_rounds; ++r) {
+        coreid_t partner = (tid + (1UL << r)) % team->nthreads;
+        team->threads[partner].barrier_flags[r] = episode;
+
+        uint64_t waitcnt = 0;
+        while (self->barrier_flags[r] < episode) {
+            spin_wait(&waitcnt);
+        }
+    }
+
+    __sync_synchronize();
+}
+
+/**
+ * \brief fills in a loop descriptor
+ */
+static void loop_setup(struct bomp_loop *loop, coreid_t nthreads,
+                       struct bomp_loop_args *args)
+{
+    long start = args->start, end = args->end, incr = args->incr;
+
+    if (incr > 0) {
+        loop->count = (start < end) ? (end - start + incr - 1) / incr : 0;
+    } else {
+        loop->count = (start > end) ? (start - end - incr - 1) / -incr : 0;
+    }
+
+    loop->sched = args->sched;
+    loop->start = start;
+    loop->incr = incr;
+    loop->nthreads = nthreads;
+    loop->chunk = (args->chunk > 0) ? args->chunk : 0;
+    if (loop->chunk == 0) {
+        if (loop->sched == OMP_SCHED_STATIC) {
+            /* one block per thread */
+            loop->chunk = (loop->count + nthreads - 1) / nthreads;
+        }
+        if (loop->chunk == 0) {
+            loop->chunk = 1;
+        }
+    }
+
+    loop->next = 0;
+    loop->active = nthreads;
+}
+
+/**
+ * \brief sets up the next loop of all threads before the team is started
+ *
+ * \param team  the team, none of its threads may be executing yet
+ * \param args  the loop
+ *
+ * This is used by the combined parallel loop constructs whose threads call
+ * the GOMP_loop_*_next() functions without starting the loop first.
+ */
+void bomp_team_loop_init(struct bomp_team *team, struct bomp_loop_args *args)
+{
+    long gen = team->threads[0].loop_gen;
+    struct bomp_loop *loop = &team->loops[gen % BOMP_LOOP_MAX];
+
+    assert(loop->claim == gen - BOMP_LOOP_MAX && loop->active == 0);
+
+    loop_setup(loop, team->nthreads, args);
+    loop->claim = gen;
+    loop->gen = gen;
+
+    for (coreid_t i = 0; i < team->nthreads; ++i) {
+        team->threads[i].loop_gen = gen + 1;
+        team->threads[i].loop = loop;
+        team->threads[i].loop_next = i;
+    }
+}
+
+/**
+ * \brief enters the next work sharing loop of the calling thread
+ *
+ * \param team  the team of the thread
+ * \param tid   ID of the calling thread
+ * \param args  the loop
+ *
+ * \returns the shared loop descriptor
+ *
+ * The first thread to arrive claims the descriptor and sets it up, once the
+ * threads still in the loop that used the same descriptor before have left.
+ */
+struct bomp_loop *bomp_team_loop_enter(struct bomp_team *team, coreid_t tid,
+                                       struct bomp_loop_args *args)
+{
+    struct bomp_team_thread *self = &team->threads[tid];
+    long gen = self->loop_gen++;
+    struct bomp_loop *loop = &team->loops[gen % BOMP_LOOP_MAX];
+    uint64_t waitcnt = 0;
+
+    if (__sync_bool_compare_and_swap(&loop->claim, gen - BOMP_LOOP_MAX, gen)) {
+        while (loop->active != 0) {
+            spin_wait(&waitcnt);
+        }
+        loop_setup(loop, team->nthreads, args);
+        __sync_synchronize();
+        loop->gen = gen;
+    } else {
+        while (loop->gen != gen) {
+            spin_wait(&waitcnt);
+        }
+        __sync_synchronize();
+    }
+
+    self->loop = loop;
+    self->loop_next = tid;
+
+    return loop;
+}
+
+/**
+ * \brief leaves the current loop of the calling thread
+ */
+void bomp_team_loop_leave(struct bomp_team *team, coreid_t tid)
+{
+    struct bomp_team_thread *self = &team->threads[tid];
+
+    assert(self->loop != NULL);
+    __sync_fetch_and_sub(&self->loop->active, 1);
+    self->loop = NULL;
+}
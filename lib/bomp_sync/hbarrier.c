@@ -0,0 +1,340 @@
+/**
+ * \file
+ * \brief Hierarchical barrier and reduction
+ *
+ * The threads are grouped by the NUMA node of the core they run on. A thread
+ * entering the barrier publishes its value on its own cache line and counts
+ * itself in its group. The last thread of a group combines the values of the
+ * group and counts the group at the top level, and the last group combines
+ * the results of all groups. It then releases each group by writing the
+ * result to the group's cache line, on which the threads of that group spin.
+ *
+ * Like this, only one thread per node touches state shared between nodes,
+ * and the group state is allocated in the memory of its node.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <numa.h>
+#include <bomp_sync.h>
+
+///< number of spins before yielding the core while waiting
+#define HBARRIER_SPIN_YIELD 0x400
+
+/// per thread state
+struct hbarrier_thread {
+    volatile uint64_t value;    ///< contribution to the current episode
+    uint64_t episode;           ///< number of barriers entered by the thread
+    nodeid_t group;             ///< the group of the thread
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/// state of the threads on one NUMA node, allocated on that node
+struct hbarrier_group {
+    nodeid_t node;              ///< the NUMA node
+    struct capref frame;        ///< the frame holding the group
+    coreid_t nmembers;          ///< number of threads in the group
+    coreid_t *members;          ///< IDs of the threads in the group
+    uint64_t value;             ///< combined value of the group
+
+    ///< threads arrived in the current episode
+    volatile coreid_t arrived __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    ///< the last episode released, and its result
+    volatile uint64_t release __attribute__((aligned(CACHE_LINE_SIZE)));
+    volatile uint64_t result;
+};
+
+struct bomp_hbarrier {
+    coreid_t nthreads;                  ///< number of threads
+    nodeid_t ngroups;                   ///< number of groups
+    struct hbarrier_group **groups;     ///< groups, one per used node
+    struct hbarrier_thread *threads;    ///< per thread state
+    void *threads_mem;                  ///< unaligned allocation of threads
+    void *mem;                          ///< unaligned allocation of the barrier
+
+    ///< groups arrived in the current episode
+    volatile nodeid_t arrived __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+static inline void spin_wait(uint64_t *waitcnt)
+{
+    if (++(*waitcnt) == HBARRIER_SPIN_YIELD) {
+        *waitcnt = 0;
+        thread_yield();
+    }
+}
+
+static uint64_t combine(bomp_reduce_op_t op, uint64_t a, uint64_t b)
+{
+    double da = bomp_reduce_to_double(a), db = bomp_reduce_to_double(b);
+
+    switch (op) {
+        case BOMP_REDUCE_NONE:
+            return 0;
+        case BOMP_REDUCE_ADD_INT:
+            return (uint64_t)((int64_t)a + (int64_t)b);
+        case BOMP_REDUCE_MIN_INT:
+            return ((int64_t)a < (int64_t)b) ? a : b;
+        case BOMP_REDUCE_MAX_INT:
+            return ((int64_t)a > (int64_t)b) ? a : b;
+        case BOMP_REDUCE_ADD_DOUBLE:
+            return bomp_reduce_from_double(da + db);
+        case BOMP_REDUCE_MIN_DOUBLE:
+            return (da < db) ? a : b;
+        case BOMP_REDUCE_MAX_DOUBLE:
+            return (da > db) ? a : b;
+        default:
+            USER_PANIC("bomp: unknown reduction %u\n", op);
+            return 0;
+    }
+}
+
+static nodeid_t node_of_core(coreid_t core)
+{
+    if (err_is_fail(numa_available())) {
+        return 0;
+    }
+
+    nodeid_t node = numa_node_of_cpu(core);
+    if (node > numa_max_node()) {
+        return 0;
+    }
+    return node;
+}
+
+/*
+ * The groups are mapped from frames allocated here rather than with
+ * numa_alloc_onnode(), so that freeing them depends only on libbarrelfish.
+ */
+static struct hbarrier_group *group_new(nodeid_t node, coreid_t nmembers)
+{
+    errval_t err = LIB_ERR_FRAME_ALLOC;
+    size_t size = sizeof(struct hbarrier_group) + nmembers * sizeof(coreid_t);
+    size = ROUND_UP(size, BASE_PAGE_SIZE);
+    struct capref frame;
+
+    if (err_is_ok(numa_available())) {
+        err = numa_frame_alloc_on_node(&frame, size, node, NULL);
+    }
+    if (err_is_fail(err)) {
+        /* not on the right node, but still on its own cache lines */
+        err = frame_alloc(&frame, size, NULL);
+        if (err_is_fail(err)) {
+            return NULL;
+        }
+    }
+
+    struct hbarrier_group *g;
+    err = vspace_map_one_frame((void **)&g, size, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return NULL;
+    }
+
+    memset(g, 0, size);
+    g->frame = frame;
+    g->node = node;
+    g->members = (coreid_t *)(g + 1);
+
+    return g;
+}
+
+static void group_free(struct hbarrier_group *g)
+{
+    struct capref frame = g->frame;
+
+    errval_t err = vspace_unmap(g);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "vspace_unmap");
+        return;
+    }
+
+    err = cap_destroy(frame);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "cap_destroy");
+    }
+}
+
+/**
+ * \brief creates a new hierarchical barrier
+ *
+ * \param nthreads  number of threads taking part in the barrier
+ * \param cores     the core each thread runs on
+ *
+ * \returns pointer to the barrier on SUCCESS
+ *          NULL on FAILURE
+ */
+struct bomp_hbarrier *bomp_hbarrier_new(coreid_t nthreads,
+                                        const coreid_t *cores)
+{
+    assert(nthreads > 0);
+
+    void *mem = calloc(1, sizeof(struct bomp_hbarrier) + CACHE_LINE_SIZE);
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    struct bomp_hbarrier *b = (struct bomp_hbarrier *)ROUND_UP((lvaddr_t)mem,
+                                                               CACHE_LINE_SIZE);
+    b->mem = mem;
+    b->nthreads = nthreads;
+    b->threads_mem = calloc(1, nthreads * sizeof(struct hbarrier_thread)
+                                + CACHE_LINE_SIZE);
+    b->groups = calloc(nthreads, sizeof(struct hbarrier_group *));
+    nodeid_t *nodes = calloc(nthreads, sizeof(nodeid_t));
+    coreid_t *count = calloc(nthreads, sizeof(coreid_t));
+    if (b->threads_mem == NULL || b->groups == NULL || nodes == NULL
+            || count == NULL) {
+        goto out_err;
+    }
+
+    b->threads = (struct hbarrier_thread *)ROUND_UP((lvaddr_t)b->threads_mem,
+                                                    CACHE_LINE_SIZE);
+
+    /* assign the threads to groups in the order the nodes first appear */
+    for (coreid_t i = 0; i < nthreads; ++i) {
+        nodeid_t node = node_of_core(cores[i]);
+        nodeid_t g;
+        for (g = 0; g < b->ngroups; ++g) {
+            if (nodes[g] == node) {
+                break;
+            }
+        }
+        if (g == b->ngroups) {
+            nodes[b->ngroups++] = node;
+        }
+        b->threads[i].group = g;
+        count[g]++;
+    }
+
+    for (nodeid_t g = 0; g < b->ngroups; ++g) {
+        b->groups[g] = group_new(nodes[g], count[g]);
+        if (b->groups[g] == NULL) {
+            goto out_err;
+        }
+    }
+
+    for (coreid_t i = 0; i < nthreads; ++i) {
+        struct hbarrier_group *g = b->groups[b->threads[i].group];
+        g->members[g->nmembers++] = i;
+    }
+
+    free(nodes);
+    free(count);
+
+    return b;
+
+    out_err:
+    free(nodes);
+    free(count);
+    bomp_hbarrier_free(b);
+    return NULL;
+}
+
+/**
+ * \brief frees a hierarchical barrier no thread is waiting on
+ */
+void bomp_hbarrier_free(struct bomp_hbarrier *b)
+{
+    if (b == NULL) {
+        return;
+    }
+
+    if (b->groups) {
+        for (nodeid_t g = 0; g < b->ngroups; ++g) {
+            if (b->groups[g]) {
+                group_free(b->groups[g]);
+            }
+        }
+    }
+
+    free(b->groups);
+    free(b->threads_mem);
+    free(b->mem);
+}
+
+/**
+ * \brief returns the number of NUMA nodes the threads of the barrier are on
+ */
+nodeid_t bomp_hbarrier_num_groups(struct bomp_hbarrier *b)
+{
+    return b->ngroups;
+}
+
+/**
+ * \brief waits until all threads have reached the barrier and combines their
+ *        values
+ *
+ * \param b     the barrier
+ * \param tid   ID of the calling thread
+ * \param value contribution of the calling thread
+ * \param op    how to combine the values, the same in all threads
+ *
+ * \returns the combined value of all threads
+ */
+uint64_t bomp_hbarrier_reduce(struct bomp_hbarrier *b, coreid_t tid,
+                              uint64_t value, bomp_reduce_op_t op)
+{
+    struct hbarrier_thread *self = &b->threads[tid];
+    struct hbarrier_group *group = b->groups[self->group];
+    uint64_t episode = ++self->episode;
+    uint64_t waitcnt = 0;
+
+    self->value = value;
+
+    /* the atomic operations make the earlier writes visible */
+    if (__sync_add_and_fetch(&group->arrived, 1) == group->nmembers) {
+        /* last of the group: combine the group, then arrive at the top */
+        group->arrived = 0;
+
+        uint64_t v = b->threads[group->members[0]].value;
+        for (coreid_t i = 1; i < group->nmembers; ++i) {
+            v = combine(op, v, b->threads[group->members[i]].value);
+        }
+        group->value = v;
+
+        if (__sync_add_and_fetch(&b->arrived, 1) == b->ngroups) {
+            /* last group: combine the groups and release them */
+            b->arrived = 0;
+
+            v = b->groups[0]->value;
+            for (nodeid_t g = 1; g < b->ngroups; ++g) {
+                v = combine(op, v, b->groups[g]->value);
+            }
+
+            for (nodeid_t g = 0; g < b->ngroups; ++g) {
+                b->groups[g]->result = v;
+                __sync_synchronize();
+                b->groups[g]->release = episode;
+            }
+        }
+    }
+
+    while (group->release < episode) {
+        spin_wait(&waitcnt);
+    }
+
+    __sync_synchronize();
+
+    return group->result;
+}
+
+/**
+ * \brief waits until all threads have reached the barrier
+ *
+ * \param b     the barrier
+ * \param tid   ID of the calling thread
+ */
+void bomp_hbarrier_wait(struct bomp_hbarrier *b, coreid_t tid)
+{
+    bomp_hbarrier_reduce(b, tid, 0, BOMP_REDUCE_NONE);
+}
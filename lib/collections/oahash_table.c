@@ -0,0 +1,383 @@
+/**
+ * \file
+ * \brief Barrelfish collections library open-addressing hash table
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include "collections/oahash_table.h"
+#include "inttypes.h"
+
+/******************************************************
+ * a hash table with linear probing and inline slots
+ ******************************************************/
+
+/*
+ * The table is resized to keep the load between 1/8 and 3/4, so that
+ * probe sequences stay short. Deleted elements are not marked with
+ * tombstones; instead the following elements of the probe sequence are
+ * shifted back, which keeps lookups of missing keys short as well.
+ */
+#define LOAD_MAX_NUM    3
+#define LOAD_MAX_DEN    4
+#define LOAD_MIN_DEN    8
+
+#define TAG_EMPTY       0
+#define TAG_USED        0x80
+
+// number of lookups of a batch whose slots are prefetched at once
+#define BATCH_GROUP     8
+
+/*
+ * Mixes the key, so that keys which only differ in their upper bits, or
+ * are multiples of the table size, do not collide.
+ */
+static inline uint64_t hash_key(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static inline uint8_t hash_tag(uint64_t hash)
+{
+    return TAG_USED | (hash >> 57);
+}
+
+/*
+ * Returns the number of slots needed to hold num_elems elements.
+ */
+static uint32_t capacity_for(uint64_t num_elems)
+{
+    uint32_t capacity = OAHASH_MIN_CAPACITY;
+    while ((uint64_t)capacity * LOAD_MAX_NUM < num_elems * LOAD_MAX_DEN) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+static void alloc_slots(collections_oahash_table *t, uint32_t capacity)
+{
+    t->capacity = capacity;
+    t->slots = (collections_oahash_slot *)
+                    malloc(sizeof(collections_oahash_slot) * capacity);
+    t->tags = (uint8_t *) calloc(capacity, sizeof(uint8_t));
+    assert(t->slots != NULL && t->tags != NULL);
+}
+
+/*
+ * Returns the slot of the key, or -1 if it is not in the table.
+ */
+static int64_t find_slot(collections_oahash_table *t, uint64_t key,
+                         uint64_t hash)
+{
+    uint32_t mask = t->capacity - 1;
+    uint8_t tag = hash_tag(hash);
+
+    for (uint32_t i = hash & mask; t->tags[i] != TAG_EMPTY; i = (i + 1) & mask) {
+        if (t->tags[i] == tag && t->slots[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Stores a pair in the first free slot of its probe sequence; the key must
+ * not be in the table yet and there must be a free slot.
+ */
+static void place(collections_oahash_table *t, uint64_t key, void *data,
+                  uint64_t hash)
+{
+    uint32_t mask = t->capacity - 1;
+    uint32_t i = hash & mask;
+
+    while (t->tags[i] != TAG_EMPTY) {
+        i = (i + 1) & mask;
+    }
+    t->tags[i] = hash_tag(hash);
+    t->slots[i].key = key;
+    t->slots[i].data = data;
+}
+
+static void resize(collections_oahash_table *t, uint32_t capacity)
+{
+    collections_oahash_slot *slots = t->slots;
+    uint8_t *tags = t->tags;
+    uint32_t old_capacity = t->capacity;
+
+    assert(t->cur_slot == -1);
+
+    alloc_slots(t, capacity);
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (tags[i] != TAG_EMPTY) {
+            place(t, slots[i].key, slots[i].data, hash_key(slots[i].key));
+        }
+    }
+
+    free(slots);
+    free(tags);
+}
+
+/*
+ * Grows the table if needed to hold n more elements.
+ */
+static void reserve(collections_oahash_table *t, uint64_t n)
+{
+    uint64_t needed = t->num_elems + n;
+    if (needed * LOAD_MAX_DEN > (uint64_t)t->capacity * LOAD_MAX_NUM) {
+        resize(t, capacity_for(needed));
+    }
+}
+
+/*
+ * Create a hash table.
+ */
+void collections_oahash_create_with_capacity(collections_oahash_table **t,
+                                             uint32_t num_elems,
+                                             collections_hash_data_free data_free)
+{
+    *t = (collections_oahash_table *) malloc(sizeof(collections_oahash_table));
+    assert(*t != NULL);
+    memset(*t, 0, sizeof(collections_oahash_table));
+
+    (*t)->min_capacity = capacity_for(num_elems);
+    alloc_slots(*t, (*t)->min_capacity);
+
+    (*t)->num_elems = 0;
+    (*t)->data_free = data_free;
+
+    // to keep track of traversing the hash table
+    (*t)->cur_slot = -1;
+}
+
+void collections_oahash_create(collections_oahash_table **t,
+                               collections_hash_data_free data_free)
+{
+    collections_oahash_create_with_capacity(t, 0, data_free);
+}
+
+// delete the entire hash table
+void collections_oahash_release(collections_oahash_table *t)
+{
+    if (t->data_free) {
+        for (uint32_t i = 0; i < t->capacity; i++) {
+            if (t->tags[i] != TAG_EMPTY) {
+                t->data_free(t->slots[i].data);
+            }
+        }
+    }
+
+    free(t->slots);
+    free(t->tags);
+    free(t);
+}
+
+/*
+ * Inserts an element into the hash table.
+ */
+void collections_oahash_insert(collections_oahash_table *t, uint64_t key,
+                               void *data)
+{
+    uint64_t hash = hash_key(key);
+
+    if (find_slot(t, key, hash) >= 0) {
+        printf("Error: key %" PRIu64 " already present in hash table\n", key);
+        assert(0);
+        return;
+    }
+
+    reserve(t, 1);
+    place(t, key, data, hash);
+    t->num_elems++;
+}
+
+void collections_oahash_insert_batch(collections_oahash_table *t,
+                                     const uint64_t *keys, void **data,
+                                     size_t n)
+{
+    reserve(t, n);
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t hash = hash_key(keys[i]);
+
+        if (find_slot(t, keys[i], hash) >= 0) {
+            printf("Error: key %" PRIu64 " already present in hash table\n",
+                   keys[i]);
+            assert(0);
+            continue;
+        }
+
+        place(t, keys[i], data[i], hash);
+        t->num_elems++;
+    }
+}
+
+/*
+ * Retrieves an element from the hash table.
+ */
+void *collections_oahash_find(collections_oahash_table *t, uint64_t key)
+{
+    int64_t i = find_slot(t, key, hash_key(key));
+    return (i >= 0) ? t->slots[i].data : NULL;
+}
+
+size_t collections_oahash_find_batch(collections_oahash_table *t,
+                                     const uint64_t *keys, void **data,
+                                     size_t n)
+{
+    uint64_t hashes[BATCH_GROUP];
+    uint32_t mask = t->capacity - 1;
+    size_t found = 0;
+
+    for (size_t base = 0; base < n; base += BATCH_GROUP) {
+        size_t group = (n - base < BATCH_GROUP) ? n - base : BATCH_GROUP;
+
+        // start fetching the home slots of the whole group ...
+        for (size_t i = 0; i < group; i++) {
+            hashes[i] = hash_key(keys[base + i]);
+            __builtin_prefetch(&t->tags[hashes[i] & mask]);
+            __builtin_prefetch(&t->slots[hashes[i] & mask]);
+        }
+
+        // ... before probing them one after the other
+        for (size_t i = 0; i < group; i++) {
+            int64_t slot = find_slot(t, keys[base + i], hashes[i]);
+            if (slot >= 0) {
+                data[base + i] = t->slots[slot].data;
+                found++;
+            } else {
+                data[base + i] = NULL;
+            }
+        }
+    }
+
+    return found;
+}
+
+/*
+ * Removes a specific element from the table.
+ */
+void collections_oahash_delete(collections_oahash_table *t, uint64_t key)
+{
+    int64_t slot = find_slot(t, key, hash_key(key));
+    if (slot < 0) {
+        printf("Error: cannot find the node with key %" PRIu64
+               " in collections_oahash_delete\n", key);
+        return;
+    }
+
+    uint32_t mask = t->capacity - 1;
+    uint32_t hole = slot;
+
+    if (t->data_free) {
+        t->data_free(t->slots[hole].data);
+    }
+
+    // shift back the elements that would not be found across the hole
+    for (uint32_t i = (hole + 1) & mask; t->tags[i] != TAG_EMPTY;
+         i = (i + 1) & mask) {
+        uint32_t home = hash_key(t->slots[i].key) & mask;
+        // move i into the hole, unless its home lies cyclically in (hole, i]
+        int stays = (hole <= i) ? (hole < home && home <= i)
+                                 : (hole < home || home <= i);
+        if (!stays) {
+            t->slots[hole] = t->slots[i];
+            t->tags[hole] = t->tags[i];
+            hole = i;
+        }
+    }
+    t->tags[hole] = TAG_EMPTY;
+    t->num_elems--;
+
+    if (t->capacity > t->min_capacity && t->cur_slot == -1
+        && (uint64_t)t->num_elems * LOAD_MIN_DEN < t->capacity) {
+        uint32_t capacity = capacity_for(t->num_elems);
+        resize(t, (capacity < t->min_capacity) ? t->min_capacity : capacity);
+    }
+}
+
+/*
+ * Returns the number of elements in the hash table.
+ */
+uint32_t collections_oahash_size(collections_oahash_table *t)
+{
+    return t->num_elems;
+}
+
+int32_t collections_oahash_traverse_start(collections_oahash_table *t)
+{
+    if (t->cur_slot != -1) {
+        // if the cur_slot is valid, a
+        // traversal is already in progress.
+        printf("Error: collections_oahash_table is already opened for traversal.\n");
+        return -1;
+    }
+
+    t->cur_slot = 0;
+    return 1;
+}
+
+/*
+ * Returns the next element in the hash table. If
+ * a valid element is found, the key is set to the
+ * key of the element. If there is no valid element,
+ * returns null and key is not modified.
+ */
+void *collections_oahash_traverse_next(collections_oahash_table *t,
+                                       uint64_t *key)
+{
+    if (t->cur_slot == -1) {
+        // if the cur_slot is invalid,
+        // hash traversal has not been started.
+        printf("Error: collections_oahash_table must be opened for traversal first.\n");
+        return NULL;
+    }
+
+    while ((uint32_t)t->cur_slot < t->capacity) {
+        uint32_t i = t->cur_slot++;
+        if (t->tags[i] != TAG_EMPTY) {
+            *key = t->slots[i].key;
+            return t->slots[i].data;
+        }
+    }
+
+    // all the slots have been traversed.
+    return NULL;
+}
+
+int32_t collections_oahash_traverse_end(collections_oahash_table *t)
+{
+    if (t->cur_slot == -1) {
+        // if the cur_slot is invalid,
+        // hash traversal has not been started.
+        printf("Error: collections_oahash_table must be opened for traversal first.\n");
+        return -1;
+    }
+
+    t->cur_slot = -1;
+    return 1;
+}
+
+int collections_oahash_visit(collections_oahash_table *t,
+                             collections_hash_visitor_func func, void *arg)
+{
+    for (uint32_t i = 0; i < t->capacity; i++) {
+        if (t->tags[i] != TAG_EMPTY
+            && func(t->slots[i].key, t->slots[i].data, arg) == 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
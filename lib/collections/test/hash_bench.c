@@ -0,0 +1,151 @@
+/**
+ * \file
+ * \brief Benchmark of the open-addressing hash table against the chained one
+ *
+ * Usage: hash_bench [elements]
+ *
+ * Measures inserting the elements, looking up present and missing keys,
+ * one by one and in batches, and deleting the elements again.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <time.h>
+#include <collections/hash_table.h>
+#include <collections/oahash_table.h>
+
+#define DEFAULT_ELEMS   1000000
+#define BATCH           256
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void report(const char *table, const char *what, uint64_t ns, size_t n)
+{
+    printf("%-8s %-14s %10.1f ns/op\n", table, what, (double)ns / n);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? atol(argv[1]) : DEFAULT_ELEMS;
+    uint64_t *keys = malloc(2 * n * sizeof(uint64_t));
+    void **found = malloc(BATCH * sizeof(void *));
+    assert(keys != NULL && found != NULL);
+
+    // the first n keys are inserted, the others are looked up as misses
+    srand(42);
+    for (size_t i = 0; i < 2 * n; i++) {
+        keys[i] = ((uint64_t)rand() << 31) ^ rand();
+        keys[i] = (keys[i] & ~(uint64_t)1) | (i < n);
+    }
+
+    volatile uintptr_t sink = 0;
+    uint64_t start;
+
+    /* chained */
+    collections_hash_table *ref;
+    collections_hash_create(&ref, NULL);
+
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        if (collections_hash_find(ref, keys[i]) == NULL) {
+            collections_hash_insert(ref, keys[i], &keys[i]);
+        }
+    }
+    report("chained", "insert", now_ns() - start, n);
+
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        sink += (uintptr_t)collections_hash_find(ref, keys[i]);
+    }
+    report("chained", "find hit", now_ns() - start, n);
+
+    start = now_ns();
+    for (size_t i = n; i < 2 * n; i++) {
+        sink += (uintptr_t)collections_hash_find(ref, keys[i]);
+    }
+    report("chained", "find miss", now_ns() - start, n);
+
+    start = now_ns();
+    collections_hash_release(ref);
+    report("chained", "release", now_ns() - start, n);
+
+    /* open addressing */
+    collections_oahash_table *t;
+    collections_oahash_create(&t, NULL);
+
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        if (collections_oahash_find(t, keys[i]) == NULL) {
+            collections_oahash_insert(t, keys[i], &keys[i]);
+        }
+    }
+    report("oahash", "insert", now_ns() - start, n);
+
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        sink += (uintptr_t)collections_oahash_find(t, keys[i]);
+    }
+    report("oahash", "find hit", now_ns() - start, n);
+
+    start = now_ns();
+    for (size_t i = n; i < 2 * n; i++) {
+        sink += (uintptr_t)collections_oahash_find(t, keys[i]);
+    }
+    report("oahash", "find miss", now_ns() - start, n);
+
+    start = now_ns();
+    for (size_t i = 0; i + BATCH <= n; i += BATCH) {
+        sink += collections_oahash_find_batch(t, &keys[i], found, BATCH);
+    }
+    report("oahash", "find batch", now_ns() - start, n - n % BATCH);
+
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        if (collections_oahash_find(t, keys[i]) != NULL) {
+            collections_oahash_delete(t, keys[i]);
+        }
+    }
+    report("oahash", "delete", now_ns() - start, n);
+    collections_oahash_release(t);
+
+    /* batched inserts into a fresh table */
+    collections_oahash_create(&t, NULL);
+    void **data = malloc(n * sizeof(void *));
+    assert(data != NULL);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        // drop duplicate keys, which the batch insert does not accept
+        if (collections_oahash_find(t, keys[i]) == NULL) {
+            collections_oahash_insert(t, keys[i], NULL);
+            keys[unique] = keys[i];
+            data[unique++] = &keys[i];
+        }
+    }
+    collections_oahash_release(t);
+    collections_oahash_create(&t, NULL);
+
+    start = now_ns();
+    for (size_t i = 0; i < unique; i += BATCH) {
+        size_t count = (unique - i < BATCH) ? unique - i : BATCH;
+        collections_oahash_insert_batch(t, &keys[i], &data[i], count);
+    }
+    report("oahash", "insert batch", now_ns() - start, unique);
+    collections_oahash_release(t);
+
+    free(data);
+    free(found);
+    free(keys);
+    return 0;
+}
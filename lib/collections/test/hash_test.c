@@ -0,0 +1,158 @@
+/**
+ * \file
+ * \brief Test of the open-addressing hash table against the chained one
+ *
+ * Applies the same random sequence of inserts, lookups and deletes to both
+ * tables and checks that they always agree, including across resizes.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <collections/hash_table.h>
+#include <collections/oahash_table.h>
+
+#define NUM_OPS     200000
+#define KEY_RANGE   5000
+#define BATCH       1000
+
+static size_t freed;
+
+static void count_free(void *data)
+{
+    freed++;
+}
+
+static int sum_visitor(uint64_t key, void *data, void *arg)
+{
+    *(uint64_t *)arg += key;
+    return 1;
+}
+
+static void *data_of(uint64_t key)
+{
+    return (void *)(uintptr_t)(key * 2 + 1);
+}
+
+/// keys that share their low bits, which must not collide in the table
+static uint64_t make_key(uint64_t i)
+{
+    return (i % 3 == 0) ? i << 40 : i * 1024;
+}
+
+static void check_equal(collections_hash_table *ref, collections_oahash_table *t)
+{
+    assert(collections_hash_size(ref) == collections_oahash_size(t));
+
+    uint64_t key, ref_sum = 0, sum = 0, count = 0;
+    collections_hash_visit(ref, sum_visitor, &ref_sum);
+    assert(collections_oahash_visit(t, sum_visitor, &sum) != 0);
+    assert(ref_sum == sum);
+
+    sum = 0;
+    collections_oahash_traverse_start(t);
+    void *data;
+    while ((data = collections_oahash_traverse_next(t, &key)) != NULL) {
+        assert(data == data_of(key));
+        assert(collections_hash_find(ref, key) == data);
+        sum += key;
+        count++;
+    }
+    collections_oahash_traverse_end(t);
+    assert(count == collections_oahash_size(t));
+    assert(sum == ref_sum);
+}
+
+static void test_random(void)
+{
+    collections_hash_table *ref;
+    collections_oahash_table *t;
+
+    collections_hash_create(&ref, NULL);
+    collections_oahash_create(&t, count_free);
+    freed = 0;
+
+    size_t deletes = 0;
+    for (size_t op = 0; op < NUM_OPS; op++) {
+        uint64_t key = make_key(rand() % KEY_RANGE);
+        void *data = collections_hash_find(ref, key);
+        assert(collections_oahash_find(t, key) == data);
+
+        // insert more often than delete while the table is small
+        size_t size = collections_hash_size(ref);
+        if (data == NULL && (op / (NUM_OPS / 4)) % 2 == 0) {
+            collections_hash_insert(ref, key, data_of(key));
+            collections_oahash_insert(t, key, data_of(key));
+        } else if (data != NULL && (size > KEY_RANGE / 2 || rand() % 2)) {
+            collections_hash_delete(ref, key);
+            collections_oahash_delete(t, key);
+            deletes++;
+        }
+
+        if (op % (NUM_OPS / 20) == 0) {
+            check_equal(ref, t);
+        }
+    }
+    check_equal(ref, t);
+    assert(freed == deletes);
+
+    size_t remaining = collections_oahash_size(t);
+    collections_hash_release(ref);
+    collections_oahash_release(t);
+    assert(freed == deletes + remaining);
+
+    printf("random: passed (%zu deletes)\n", deletes);
+}
+
+static void test_batch(void)
+{
+    collections_oahash_table *t;
+    uint64_t keys[BATCH];
+    void *data[BATCH];
+    void *found[BATCH];
+
+    collections_oahash_create(&t, NULL);
+
+    for (size_t i = 0; i < BATCH; i++) {
+        keys[i] = make_key(i);
+        data[i] = data_of(keys[i]);
+    }
+    collections_oahash_insert_batch(t, keys, data, BATCH / 2);
+    collections_oahash_insert_batch(t, keys + BATCH / 2, data + BATCH / 2,
+                                    BATCH / 2);
+    assert(collections_oahash_size(t) == BATCH);
+
+    // every other key is missing
+    for (size_t i = 0; i < BATCH; i += 2) {
+        collections_oahash_delete(t, keys[i]);
+    }
+    size_t n = collections_oahash_find_batch(t, keys, found, BATCH);
+    assert(n == BATCH / 2);
+    for (size_t i = 0; i < BATCH; i++) {
+        assert(found[i] == ((i % 2) ? data[i] : NULL));
+    }
+
+    // shrinks back down when emptied
+    for (size_t i = 1; i < BATCH; i += 2) {
+        collections_oahash_delete(t, keys[i]);
+    }
+    assert(collections_oahash_size(t) == 0);
+    assert(t->capacity == OAHASH_MIN_CAPACITY);
+
+    collections_oahash_release(t);
+    printf("batch: passed\n");
+}
+
+int main(int argc, char *argv[])
+{
+    srand(42);
+    test_random();
+    test_batch();
+    return 0;
+}
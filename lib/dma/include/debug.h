@@ -50,6 +50,15 @@
 #define XPHI_DEBUG_DESC_ENABLED    1
 #define XPHI_DEBUG_INTR_ENABLED    1
 
+/*
+ * ---------------------------------------------------------------------------
+ *  Software DMA debug switches
+ */
+#define SOFT_DEBUG_ENABLED         1
+#define SOFT_DEBUG_CHAN_ENABLED    1
+#define SOFT_DEBUG_DEVICE_ENABLED  1
+#define SOFT_DEBUG_REQUEST_ENABLED 1
+
 /*
  * ---------------------------------------------------------------------------
  *  DMA client debug switches
@@ -194,6 +203,33 @@
 #endif
 
 
+/*
+ * --------------------------------------------------------------------------
+ *  Software DMA debug output generation
+ */
+
+#if (LIB_DMA_DEBUG_ENABLED && SOFT_DEBUG_ENABLED)
+#define SOFT_DEBUG_PRINT(x...) debug_printf(x)
+#else
+#define SOFT_DEBUG_PRINT(x... )
+#endif
+#if SOFT_DEBUG_CHAN_ENABLED
+#define SOFTCHAN_DEBUG(x...) SOFT_DEBUG_PRINT("[soft chan.%04x] " x)
+#else
+#define SOFTCHAN_DEBUG(x...)
+#endif
+#if SOFT_DEBUG_REQUEST_ENABLED
+#define SOFTREQ_DEBUG(x...) SOFT_DEBUG_PRINT("[soft req] " x)
+#else
+#define SOFTREQ_DEBUG(x...)
+#endif
+#if SOFT_DEBUG_DEVICE_ENABLED
+#define SOFTDEV_DEBUG(x...) SOFT_DEBUG_PRINT("[soft dev.%02x] " x)
+#else
+#define SOFTDEV_DEBUG(x...)
+#endif
+
+
 /*
  * --------------------------------------------------------------------------
  *  DMA Client debug output generation
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef SOFT_DMA_CHANNEL_INTERNAL_H
+#define SOFT_DMA_CHANNEL_INTERNAL_H
+
+#include <dma_channel_internal.h>
+#include <dma/soft/soft_dma_channel.h>
+
+/**
+ * \brief initializes and allocates resources for a new software DMA channel
+ *        belonging to a device and starts its copy thread
+ *
+ * \param dev       software DMA device
+ * \param id        id of this channel
+ * \param max_xfer  maximum size in bytes for a transfer
+ * \param core      core on which the copy thread runs
+ * \param ret_chan  returned channel pointer
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+errval_t soft_dma_channel_init(struct soft_dma_device *dev,
+                               uint8_t id,
+                               uint32_t max_xfer,
+                               coreid_t core,
+                               struct soft_dma_channel **ret_chan);
+
+/**
+ * \brief enqueues a request onto the software DMA channel and issues its
+ *        descriptors to the copy thread
+ *
+ * \param chan  software DMA channel
+ * \param req   software DMA request to be submitted
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_* on failure
+ */
+errval_t soft_dma_channel_submit_request(struct soft_dma_channel *chan,
+                                         struct soft_dma_request *req);
+
+/**
+ * \brief returns the descriptor ring of a software DMA channel
+ *
+ * \param chan  software DMA channel
+ *
+ * \returns DMA descriptor ring handle
+ */
+struct dma_ring *soft_dma_channel_get_ring(struct soft_dma_channel *chan);
+
+#endif /* SOFT_DMA_CHANNEL_INTERNAL_H */
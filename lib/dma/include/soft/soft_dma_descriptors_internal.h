@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef SOFT_DMA_DESCRIPTORS_INTERNAL_H
+#define SOFT_DMA_DESCRIPTORS_INTERNAL_H
+
+#include <barrelfish/static_assert.h>
+#include <dma_descriptor_internal.h>
+#include <dma/soft/soft_dma.h>
+
+/// descriptor operations executed by the copy thread
+#define SOFT_DMA_DESC_OP_NOP    0x0
+#define SOFT_DMA_DESC_OP_MEMCPY 0x1
+#define SOFT_DMA_DESC_OP_MEMSET 0x2
+
+/**
+ * layout of a software DMA descriptor. In contrast to the hardware
+ * descriptors, the addresses are the virtual addresses of the copy thread.
+ */
+struct soft_dma_desc
+{
+    lvaddr_t src;       ///< source address of a memcpy
+    lvaddr_t dst;       ///< destination address
+    uint64_t bytes;     ///< size of the transfer in bytes
+    uint64_t val;       ///< value pattern of a memset
+    uint32_t op;        ///< the operation to execute
+};
+
+STATIC_ASSERT(sizeof(struct soft_dma_desc) <= SOFT_DMA_DESC_SIZE,
+              "software DMA descriptor too large");
+
+/**
+ * \brief returns the software descriptor layout of a DMA descriptor
+ */
+static inline struct soft_dma_desc *soft_dma_desc(struct dma_descriptor *desc)
+{
+    return (struct soft_dma_desc *) dma_desc_get_desc_handle(desc);
+}
+
+/**
+ * \brief fills a descriptor with a memcpy operation
+ *
+ * \param desc  DMA descriptor
+ * \param src   virtual source address
+ * \param dst   virtual destination address
+ * \param bytes size of the transfer in bytes
+ */
+static inline void soft_dma_desc_fill_memcpy(struct dma_descriptor *desc,
+                                             lvaddr_t src,
+                                             lvaddr_t dst,
+                                             uint64_t bytes)
+{
+    struct soft_dma_desc *d = soft_dma_desc(desc);
+    d->src = src;
+    d->dst = dst;
+    d->bytes = bytes;
+    d->op = SOFT_DMA_DESC_OP_MEMCPY;
+}
+
+/**
+ * \brief fills a descriptor with a memset operation
+ *
+ * \param desc  DMA descriptor
+ * \param val   64-bit value pattern to be written
+ * \param dst   virtual destination address
+ * \param bytes size of the transfer in bytes
+ */
+static inline void soft_dma_desc_fill_memset(struct dma_descriptor *desc,
+                                             uint64_t val,
+                                             lvaddr_t dst,
+                                             uint64_t bytes)
+{
+    struct soft_dma_desc *d = soft_dma_desc(desc);
+    d->val = val;
+    d->dst = dst;
+    d->bytes = bytes;
+    d->op = SOFT_DMA_DESC_OP_MEMSET;
+}
+
+#endif /* SOFT_DMA_DESCRIPTORS_INTERNAL_H */
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef SOFT_DMA_DEVICE_INTERNAL_H
+#define SOFT_DMA_DEVICE_INTERNAL_H
+
+#include <dma_device_internal.h>
+#include <dma/soft/soft_dma_device.h>
+
+/**
+ * \brief translates a physical address range into the virtual address at
+ *        which the device accesses it
+ *
+ * \param dev   software DMA device
+ * \param paddr physical start address of the range
+ * \param bytes size of the range in bytes
+ * \param vaddr returns the virtual address of the range
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_MEM_NOT_REGISTERED if the range is not within a registered
+ *          memory region
+ */
+errval_t soft_dma_device_translate(struct soft_dma_device *dev,
+                                   lpaddr_t paddr,
+                                   size_t bytes,
+                                   lvaddr_t *vaddr);
+
+#endif /* SOFT_DMA_DEVICE_INTERNAL_H */
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2015, ETH Zurich. All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset.h>
+
+#include <dma_ring_internal.h>
+#include <soft/soft_dma_internal.h>
+#include <soft/soft_dma_device_internal.h>
+#include <soft/soft_dma_channel_internal.h>
+#include <soft/soft_dma_descriptors_internal.h>
+#include <soft/soft_dma_request_internal.h>
+
+#include <debug.h>
+
+/*
+ * The channel works like a hardware engine whose registers live in memory:
+ * the client writes the descriptors, then publishes the number of issued
+ * descriptors in the doorbell. The copy thread executes the descriptors up
+ * to the doorbell in order and publishes the number of completed ones, from
+ * which the client's poll finishes the requests. Both counters run freely
+ * and are only written by one side each.
+ */
+
+/// the copy threads use movnti for the non-temporal stores
+#if defined(__x86_64__) && !defined(__k1om__)
+#define SOFT_DMA_HAVE_NT_STORES 1
+#else
+#define SOFT_DMA_HAVE_NT_STORES 0
+#endif
+
+struct soft_dma_channel
+{
+    struct dma_channel common;
+
+    struct dma_ring *ring;          ///< Descriptor ring
+    struct thread *worker;          ///< the copy thread
+    coreid_t core;                  ///< core of the copy thread
+
+    /// written by the client: number of issued descriptors
+    volatile uint16_t doorbell;
+
+    /// keeps the two counters on separate cache lines
+    uint8_t pad[64];
+
+    /// written by the copy thread: number of completed descriptors
+    volatile uint16_t completed;
+};
+
+/*
+ * ----------------------------------------------------------------------------
+ * Copy Thread
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief orders the preceding stores, including non-temporal ones, before
+ *        the following ones
+ */
+static inline void store_fence(void)
+{
+#if SOFT_DMA_HAVE_NT_STORES
+    __asm volatile("sfence" ::: "memory");
+#else
+    __asm volatile("" ::: "memory");
+#endif
+}
+
+#if SOFT_DMA_HAVE_NT_STORES
+static inline void store_nt(uint64_t *dst, uint64_t val)
+{
+    __asm volatile("movnti %1, %0" : "=m" (*dst) : "r" (val));
+}
+
+/**
+ * \brief copies a buffer bypassing the cache for the destination
+ */
+static void copy_nt(uint8_t *dst, const uint8_t *src, size_t bytes)
+{
+    /* the non-temporal stores need an aligned destination */
+    size_t head = (-(uintptr_t) dst) & (sizeof(uint64_t) - 1);
+    if (head > bytes) {
+        head = bytes;
+    }
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    bytes -= head;
+
+    uint64_t *d = (uint64_t *) dst;
+    const uint64_t *s = (const uint64_t *) src;
+    for (; bytes >= 64; bytes -= 64, d += 8, s += 8) {
+        __builtin_prefetch(s + 64);
+        store_nt(d + 0, s[0]);
+        store_nt(d + 1, s[1]);
+        store_nt(d + 2, s[2]);
+        store_nt(d + 3, s[3]);
+        store_nt(d + 4, s[4]);
+        store_nt(d + 5, s[5]);
+        store_nt(d + 6, s[6]);
+        store_nt(d + 7, s[7]);
+    }
+    for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t)) {
+        store_nt(d++, *s++);
+    }
+
+    memcpy(d, s, bytes);
+}
+
+/**
+ * \brief fills a buffer with a 64-bit pattern bypassing the cache
+ */
+static void set_nt(uint8_t *dst, uint64_t val, size_t bytes)
+{
+    uint64_t *d = (uint64_t *) dst;
+    for (; bytes >= 64; bytes -= 64, d += 8) {
+        store_nt(d + 0, val);
+        store_nt(d + 1, val);
+        store_nt(d + 2, val);
+        store_nt(d + 3, val);
+        store_nt(d + 4, val);
+        store_nt(d + 5, val);
+        store_nt(d + 6, val);
+        store_nt(d + 7, val);
+    }
+    for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t)) {
+        store_nt(d++, val);
+    }
+
+    memcpy(d, &val, bytes);
+}
+#endif
+
+/**
+ * \brief fills a buffer with a 64-bit pattern
+ */
+static void set_pattern(uint8_t *dst, uint64_t val, size_t bytes)
+{
+    uint64_t *d = (uint64_t *) dst;
+    for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t)) {
+        *d++ = val;
+    }
+
+    memcpy(d, &val, bytes);
+}
+
+/**
+ * \brief executes a descriptor
+ *
+ * Large transfers would evict the whole cache without being read again
+ * soon, so they are written with non-temporal stores.
+ */
+static void desc_execute(struct soft_dma_desc *desc)
+{
+    uint8_t *dst = (uint8_t *) desc->dst;
+    size_t bytes = desc->bytes;
+
+    switch (desc->op) {
+        case SOFT_DMA_DESC_OP_MEMCPY:
+#if SOFT_DMA_HAVE_NT_STORES
+            if (bytes >= SOFT_DMA_NT_THRESHOLD) {
+                copy_nt(dst, (uint8_t *) desc->src, bytes);
+                break;
+            }
+#endif
+            memcpy(dst, (uint8_t *) desc->src, bytes);
+            break;
+        case SOFT_DMA_DESC_OP_MEMSET:
+#if SOFT_DMA_HAVE_NT_STORES
+            if (bytes >= SOFT_DMA_NT_THRESHOLD
+                && !((uintptr_t) dst & (sizeof(uint64_t) - 1))) {
+                set_nt(dst, desc->val, bytes);
+                break;
+            }
+#endif
+            set_pattern(dst, desc->val, bytes);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * \brief the copy thread of a channel
+ *
+ * \param arg   software DMA channel
+ */
+static int channel_worker(void *arg)
+{
+    struct soft_dma_channel *chan = arg;
+    uint16_t next = chan->completed;
+
+    SOFTCHAN_DEBUG("copy thread started on core %u\n", chan->common.id,
+                   disp_get_core_id());
+
+    while (chan->common.state != DMA_CHAN_ST_SUSPENDED) {
+        uint16_t issued = chan->doorbell;
+        if (next == issued) {
+            thread_yield();
+            continue;
+        }
+
+        /* the descriptors are written before the doorbell */
+        __asm volatile("" ::: "memory");
+
+        while (next != issued) {
+            struct dma_descriptor *desc = dma_ring_get_desc(chan->ring, next);
+            desc_execute(soft_dma_desc(desc));
+            next++;
+
+            /* the data must be visible before the completion */
+            store_fence();
+            chan->completed = next;
+        }
+    }
+
+    SOFTCHAN_DEBUG("copy thread stopped\n", chan->common.id);
+
+    return 0;
+}
+
+/**
+ * \brief processes the completed descriptors of a DMA channel and finishes
+ *        the requests
+ *
+ * \param chan      software DMA channel
+ * \param completed index of the last completed descriptor plus one
+ *
+ * \returns SYS_ERR_OK on if the request was processed to completion
+ *          DMA_ERR_REQUEST_UNFINISHED if the request is still not finished
+ *          errval on error
+ */
+static errval_t channel_process_descriptors(struct soft_dma_channel *chan,
+                                            uint16_t completed)
+{
+    errval_t err;
+
+    uint16_t size = dma_ring_get_size(chan->ring);
+    uint8_t request_done = 0;
+
+    while (dma_ring_get_tail(chan->ring) != (completed & (size - 1))) {
+        struct dma_descriptor *desc = dma_ring_get_tail_desc(chan->ring);
+
+        /*
+         * check if there is a request associated with the descriptor
+         * this indicates the last descriptor of a request
+         */
+        struct dma_request *req = dma_desc_get_request(desc);
+        if (req) {
+            struct dma_request *req_head = dma_channel_deq_request_head(&chan->common);
+            assert(req_head == req);
+            err = soft_dma_request_process((struct soft_dma_request *) req);
+            if (err_is_fail(err)) {
+                dma_channel_enq_request_head(&chan->common, req_head);
+                return err;
+            }
+            request_done = 1;
+        }
+    }
+
+    if (request_done) {
+        return SYS_ERR_OK;
+    }
+
+    return DMA_ERR_REQUEST_UNFINISHED;
+}
+
+/*
+ * ============================================================================
+ * Library Internal Interface
+ * ============================================================================
+ */
+
+static void span_cb(void *arg, errval_t err)
+{
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "spanning the domain for the copy thread");
+    }
+    *((errval_t *) arg) = err;
+}
+
+/**
+ * \brief starts the copy thread of a channel on its core, spanning the
+ *        domain to the core if needed
+ *
+ * \param chan  software DMA channel
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+static errval_t channel_start_worker(struct soft_dma_channel *chan)
+{
+    errval_t err;
+
+    err = domain_thread_create_on(chan->core, channel_worker, chan,
+                                  &chan->worker);
+    if (err_no(err) != LIB_ERR_NO_SPANNED_DISP) {
+        return err;
+    }
+
+    SOFTCHAN_DEBUG("spanning domain to core %u\n", chan->common.id, chan->core);
+
+    errval_t span_err = LIB_ERR_NO_SPANNED_DISP;
+    err = domain_new_dispatcher(chan->core, span_cb, &span_err);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    while (err_no(span_err) == LIB_ERR_NO_SPANNED_DISP) {
+        err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+    if (err_is_fail(span_err)) {
+        return span_err;
+    }
+
+    return domain_thread_create_on(chan->core, channel_worker, chan,
+                                   &chan->worker);
+}
+
+/**
+ * \brief initializes and allocates resources for a new software DMA channel
+ *        belonging to a device and starts its copy thread
+ *
+ * \param dev       software DMA device
+ * \param id        id of this channel
+ * \param max_xfer  maximum size in bytes for a transfer
+ * \param core      core on which the copy thread runs
+ * \param ret_chan  returned channel pointer
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+errval_t soft_dma_channel_init(struct soft_dma_device *dev,
+                               uint8_t id,
+                               uint32_t max_xfer,
+                               coreid_t core,
+                               struct soft_dma_channel **ret_chan)
+{
+    errval_t err;
+
+    struct soft_dma_channel *chan = calloc(1, sizeof(*chan));
+    if (chan == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    struct dma_device *dma_dev = (struct dma_device *) dev;
+    struct dma_channel *dma_chan = &chan->common;
+
+    dma_chan->id = dma_channel_id_build(dma_device_get_id(dma_dev), id);
+    dma_chan->device = dma_dev;
+    dma_chan->max_xfer_size = max_xfer;
+
+    SOFTCHAN_DEBUG("initialize channel with max. xfer size of %u bytes\n",
+                   dma_chan->id, max_xfer);
+
+    err = dma_ring_alloc(SOFT_DMA_RING_SIZE, SOFT_DMA_DESC_ALIGN,
+                         SOFT_DMA_DESC_SIZE, 0x0, dma_chan, &chan->ring);
+    if (err_is_fail(err)) {
+        free(chan);
+        return err;
+    }
+
+    dma_chan->state = DMA_CHAN_ST_RUNNING;
+    dma_chan->f.memcpy = soft_dma_request_memcpy_chan;
+    dma_chan->f.memset = soft_dma_request_memset_chan;
+    dma_chan->f.poll = soft_dma_channel_poll;
+
+    chan->core = core;
+
+    err = channel_start_worker(chan);
+    if (err_is_fail(err)) {
+        dma_ring_free(chan->ring);
+        free(chan);
+        return err_push(err, LIB_ERR_THREAD_CREATE);
+    }
+
+    *ret_chan = chan;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief enqueues a request onto the software DMA channel and issues its
+ *        descriptors to the copy thread
+ *
+ * \param chan  software DMA channel
+ * \param req   software DMA request to be submitted
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_* on failure
+ */
+errval_t soft_dma_channel_submit_request(struct soft_dma_channel *chan,
+                                         struct soft_dma_request *req)
+{
+    SOFTCHAN_DEBUG("submit request [%016lx]\n", chan->common.id,
+                   dma_request_get_id((struct dma_request * )req));
+
+    dma_channel_enq_request_tail(&chan->common, (struct dma_request *) req);
+
+    uint16_t issued = dma_ring_submit_pending(chan->ring);
+
+    /* the descriptors must be written before the doorbell */
+    __asm volatile("" ::: "memory");
+    chan->doorbell = issued;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief returns the descriptor ring of a software DMA channel
+ *
+ * \param chan  software DMA channel
+ *
+ * \returns DMA descriptor ring handle
+ */
+inline struct dma_ring *soft_dma_channel_get_ring(struct soft_dma_channel *chan)
+{
+    return chan->ring;
+}
+
+/*
+ * ============================================================================
+ * Public Interface
+ * ============================================================================
+ */
+
+/**
+ * \brief polls the software DMA channel for completed events
+ *
+ * \param chan  software DMA channel
+ *
+ * \returns SYS_ERR_OK if there was something processed
+ *          DMA_ERR_CHAN_IDLE if there was no request on the channel
+ *          DMA_ERR_REQUEST_UNFINISHED if the request has not been completed yet
+ */
+errval_t soft_dma_channel_poll(struct dma_channel *chan)
+{
+    errval_t err;
+
+    struct soft_dma_channel *soft_chan = (struct soft_dma_channel *) chan;
+
+    /* check if there can be something to process */
+    if (chan->req_list.head == NULL) {
+        return DMA_ERR_CHAN_IDLE;
+    }
+
+    uint16_t completed = soft_chan->completed;
+
+    /* the completion is read before the descriptors and the data */
+    __asm volatile("" ::: "memory");
+
+    err = channel_process_descriptors(soft_chan, completed);
+    switch (err_no(err)) {
+        case SYS_ERR_OK:
+            /* this means we processed a descriptor request */
+            return SYS_ERR_OK;
+        case DMA_ERR_REQUEST_UNFINISHED:
+            return DMA_ERR_CHAN_IDLE;
+        default:
+            return err;
+    }
+}
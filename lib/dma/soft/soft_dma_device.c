@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2015, ETH Zurich. All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+
+#include <soft/soft_dma_internal.h>
+#include <soft/soft_dma_device_internal.h>
+#include <soft/soft_dma_channel_internal.h>
+
+#include <debug.h>
+
+/**
+ * memory region registered with the software DMA device. Requests carry
+ * physical addresses, which the device translates using these regions.
+ */
+struct soft_dma_mem
+{
+    lpaddr_t paddr;             ///< physical base address of the region
+    lvaddr_t vaddr;             ///< where the region is mapped
+    size_t bytes;               ///< size of the region in bytes
+    struct soft_dma_mem *next;  ///< next registered region
+};
+
+/**
+ * software DMA device representation
+ */
+struct soft_dma_device
+{
+    struct dma_device common;
+
+    coreid_t core;              ///< core of the copy threads
+    struct soft_dma_mem *mem;   ///< registered memory regions
+};
+
+/// counter for device ID enumeration
+static dma_dev_id_t device_id = 1;
+
+/*
+ * ===========================================================================
+ * Memory Registration
+ * ===========================================================================
+ */
+
+/**
+ * \brief registers a frame with the device, so that requests can use it
+ *
+ * \param dev   software DMA device
+ * \param frame frame capability of the memory region
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+static errval_t device_register_memory(struct dma_device *dev,
+                                       struct capref frame)
+{
+    errval_t err;
+
+    struct soft_dma_device *sdev = (struct soft_dma_device *) dev;
+
+    struct frame_identity id;
+    err = invoke_frame_identify(frame, &id);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct soft_dma_mem *mem = calloc(1, sizeof(*mem));
+    if (mem == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    mem->paddr = id.base;
+    mem->bytes = (1UL << id.bits);
+
+    void *addr;
+    err = vspace_map_one_frame(&addr, mem->bytes, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        free(mem);
+        return err;
+    }
+    mem->vaddr = (lvaddr_t) addr;
+
+    SOFTDEV_DEBUG("registered memory [0x%016lx, 0x%016lx] @ 0x%016lx\n",
+                  dev->id, mem->paddr, mem->paddr + mem->bytes - 1, mem->vaddr);
+
+    mem->next = sdev->mem;
+    sdev->mem = mem;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief deregisters a previously registered frame
+ *
+ * \param dev   software DMA device
+ * \param frame frame capability of the memory region
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_MEM_NOT_REGISTERED if the frame was not registered
+ *          errval on error
+ */
+static errval_t device_deregister_memory(struct dma_device *dev,
+                                         struct capref frame)
+{
+    errval_t err;
+
+    struct soft_dma_device *sdev = (struct soft_dma_device *) dev;
+
+    struct frame_identity id;
+    err = invoke_frame_identify(frame, &id);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct soft_dma_mem **prev = &sdev->mem;
+    while (*prev) {
+        struct soft_dma_mem *mem = *prev;
+        if (mem->paddr == id.base && mem->bytes == (1UL << id.bits)) {
+            *prev = mem->next;
+            err = vspace_unmap((void *) mem->vaddr);
+            free(mem);
+            return err;
+        }
+        prev = &mem->next;
+    }
+
+    return DMA_ERR_MEM_NOT_REGISTERED;
+}
+
+/*
+ * ===========================================================================
+ * Library Internal Interface
+ * ===========================================================================
+ */
+
+/**
+ * \brief translates a physical address range into the virtual address at
+ *        which the device accesses it
+ *
+ * \param dev   software DMA device
+ * \param paddr physical start address of the range
+ * \param bytes size of the range in bytes
+ * \param vaddr returns the virtual address of the range
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_MEM_NOT_REGISTERED if the range is not within a registered
+ *          memory region
+ */
+errval_t soft_dma_device_translate(struct soft_dma_device *dev,
+                                   lpaddr_t paddr,
+                                   size_t bytes,
+                                   lvaddr_t *vaddr)
+{
+    for (struct soft_dma_mem *mem = dev->mem; mem; mem = mem->next) {
+        if (paddr >= mem->paddr && paddr + bytes <= mem->paddr + mem->bytes) {
+            *vaddr = mem->vaddr + (paddr - mem->paddr);
+            return SYS_ERR_OK;
+        }
+    }
+
+    return DMA_ERR_MEM_NOT_REGISTERED;
+}
+
+/*
+ * ===========================================================================
+ * Public Interface
+ * ===========================================================================
+ */
+
+/*
+ * ----------------------------------------------------------------------------
+ * device initialization / termination
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief initializes a software DMA device
+ *
+ * \param channels  number of channels of the device
+ * \param core      core on which the copy threads of the channels run
+ * \param dev       returns a pointer to the device structure
+ *
+ * If the domain is not yet running on the given core, it is spanned to it.
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on error
+ */
+errval_t soft_dma_device_init(uint8_t channels,
+                              coreid_t core,
+                              struct soft_dma_device **dev)
+{
+    errval_t err;
+
+    if (channels == 0 || channels > SOFT_DMA_DEVICE_CHANNELS_MAX) {
+        return DMA_ERR_ARG_INVALID;
+    }
+
+    struct soft_dma_device *sdev = calloc(1, sizeof(*sdev));
+    if (sdev == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    struct dma_device *dma_dev = (struct dma_device *) sdev;
+
+    SOFTDEV_DEBUG("initializing software DMA device on core %u\n", device_id,
+                  core);
+
+    sdev->core = core;
+
+    dma_dev->id = device_id++;
+    dma_dev->irq_type = DMA_IRQ_DISABLED;
+    dma_dev->type = DMA_DEV_TYPE_SOFT;
+    dma_dev->f.register_memory = device_register_memory;
+    dma_dev->f.deregister_memory = device_deregister_memory;
+    dma_dev->f.poll = soft_dma_device_poll_channels;
+
+    dma_dev->channels.count = channels;
+    dma_dev->channels.c = calloc(channels, sizeof(void *));
+    if (dma_dev->channels.c == NULL) {
+        device_id--;
+        free(sdev);
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    for (uint8_t i = 0; i < channels; ++i) {
+        struct dma_channel **chan = &dma_dev->channels.c[i];
+        err = soft_dma_channel_init(sdev, i, SOFT_DMA_DEVICE_MAX_XFER, core,
+                                    (struct soft_dma_channel **) chan);
+        if (err_is_fail(err)) {
+            free(dma_dev->channels.c);
+            device_id--;
+            free(sdev);
+            return err;
+        }
+    }
+
+    *dev = sdev;
+
+    SOFTDEV_DEBUG("software DMA device initialized\n", dma_dev->id);
+
+    return SYS_ERR_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Device Operation Functions
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief polls the channels of the software DMA device
+ *
+ * \param dev   software DMA device
+ *
+ * \returns SYS_ERR_OK on success
+ *          DMA_ERR_DEVICE_IDLE if there is nothing completed on the channels
+ *          errval on error
+ */
+errval_t soft_dma_device_poll_channels(struct dma_device *dev)
+{
+    errval_t err;
+
+    uint8_t idle = 0x1;
+
+    for (uint8_t i = 0; i < dev->channels.count; ++i) {
+        err = soft_dma_channel_poll(dev->channels.c[i]);
+        switch (err_no(err)) {
+            case DMA_ERR_CHAN_IDLE:
+                /* no op */
+                break;
+            case SYS_ERR_OK:
+                idle = 0;
+                break;
+            default:
+                return err;
+        }
+    }
+
+    if (idle) {
+        return DMA_ERR_DEVICE_IDLE;
+    }
+
+    return SYS_ERR_OK;
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2015, ETH Zurich. All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+
+#include <soft/soft_dma_internal.h>
+#include <dma_ring_internal.h>
+#include <soft/soft_dma_device_internal.h>
+#include <soft/soft_dma_channel_internal.h>
+#include <soft/soft_dma_request_internal.h>
+#include <soft/soft_dma_descriptors_internal.h>
+
+#include <debug.h>
+
+/**
+ * represents the software DMA requests
+ */
+struct soft_dma_request
+{
+    struct dma_request common;
+    struct dma_descriptor *desc_head;
+    struct dma_descriptor *desc_tail;
+};
+
+/*
+ * ---------------------------------------------------------------------------
+ * Request Management
+ * ---------------------------------------------------------------------------
+ */
+
+/// caches allocated requests which are no longer used
+static struct dma_request *req_free_list = NULL;
+
+/**
+ * \brief allocates a software DMA request structure
+ *
+ * \returns software DMA request
+ *          NULL on failure
+ */
+static struct soft_dma_request *request_alloc(void)
+{
+    struct soft_dma_request *ret;
+
+    if (req_free_list) {
+        ret = (struct soft_dma_request *) req_free_list;
+        req_free_list = ret->common.next;
+
+        DMAREQ_DEBUG("meta: reusing request %p. freelist:%p\n", ret, req_free_list);
+
+        return ret;
+    }
+    return calloc(1, sizeof(*ret));
+}
+
+/**
+ * \brief frees up the used DMA request structure
+ *
+ * \param req   DMA request to be freed
+ */
+static void request_free(struct soft_dma_request *req)
+{
+    DMAREQ_DEBUG("meta: freeing request %p.\n", req);
+    req->desc_head = NULL;
+    req->desc_tail = NULL;
+    req->common.next = req_free_list;
+    req_free_list = &req->common;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Helper Functions
+ * ---------------------------------------------------------------------------
+ */
+
+inline static uint32_t req_num_desc_needed(struct soft_dma_channel *chan,
+                                           size_t bytes)
+{
+    struct dma_channel *dma_chan = (struct dma_channel *) chan;
+    uint32_t max_xfer_size = dma_channel_get_max_xfer_size(dma_chan);
+    bytes += (max_xfer_size - 1);
+    return (uint32_t) (bytes / max_xfer_size);
+}
+
+/**
+ * \brief allocates a request and checks that there are enough descriptors
+ *
+ * \param chan  software DMA channel
+ * \param setup request setup information
+ * \param bytes size of the request in bytes
+ * \param ret   returns the allocated request
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+static errval_t request_prepare(struct soft_dma_channel *chan,
+                                struct dma_req_setup *setup,
+                                size_t bytes,
+                                struct soft_dma_request **ret)
+{
+    uint32_t num_desc = req_num_desc_needed(chan, bytes);
+    if (num_desc == 0) {
+        /* an empty request still takes one descriptor */
+        num_desc = 1;
+    }
+
+    struct dma_ring *ring = soft_dma_channel_get_ring(chan);
+
+    if (num_desc > dma_ring_get_space(ring)) {
+        SOFTREQ_DEBUG("Too less space in ring: %u / %u\n", num_desc,
+                      dma_ring_get_space(ring));
+        return DMA_ERR_NO_DESCRIPTORS;
+    }
+
+    struct soft_dma_request *req = request_alloc();
+    if (req == NULL) {
+        SOFTREQ_DEBUG("No request descriptors for holding request data\n");
+        return DMA_ERR_NO_REQUESTS;
+    }
+
+    dma_request_common_init(&req->common, (struct dma_channel *) chan,
+                            setup->type);
+
+    *ret = req;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief stores the request in its last descriptor and submits it
+ *
+ * \param chan  software DMA channel
+ * \param req   software DMA request
+ * \param setup request setup information
+ * \param id    returns the generated request id
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+static errval_t request_submit(struct soft_dma_channel *chan,
+                               struct soft_dma_request *req,
+                               struct dma_req_setup *setup,
+                               dma_req_id_t *id)
+{
+    req->common.setup = *setup;
+
+    if (id) {
+        *id = req->common.id;
+    }
+    /* set the request pointer in the last descriptor */
+    dma_desc_set_request(req->desc_tail, &req->common);
+
+    return soft_dma_channel_submit_request(chan, req);
+}
+
+/*
+ * ===========================================================================
+ * Library Internal Interface
+ * ===========================================================================
+ */
+
+/**
+ * \brief handles the processing of completed DMA requests
+ *
+ * \param req   the DMA request to process
+ *
+ * \returns SYS_ERR_OK on sucess
+ *          errval on failure
+ */
+errval_t soft_dma_request_process(struct soft_dma_request *req)
+{
+    errval_t err;
+
+    req->common.state = DMA_REQ_ST_DONE;
+
+    err = dma_request_process(&req->common);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    request_free(req);
+
+    return SYS_ERR_OK;
+}
+
+/*
+ * ===========================================================================
+ * Public Interface
+ * ===========================================================================
+ */
+
+/**
+ * \brief issues a memcpy request to the given channel
+ *
+ * \param chan  software DMA channel
+ * \param setup request setup information
+ * \param id    returns the generated request id
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+errval_t soft_dma_request_memcpy_chan(struct dma_channel *chan,
+                                      struct dma_req_setup *setup,
+                                      dma_req_id_t *id)
+{
+    errval_t err;
+
+    assert(chan->device->type == DMA_DEV_TYPE_SOFT);
+
+    struct soft_dma_channel *soft_chan = (struct soft_dma_channel *) chan;
+    struct soft_dma_device *dev = (struct soft_dma_device *) chan->device;
+
+    SOFTREQ_DEBUG("DMA Memcpy request: [0x%016lx]->[0x%016lx] of %lu bytes\n",
+                  setup->args.memcpy.src, setup->args.memcpy.dst,
+                  setup->args.memcpy.bytes);
+
+    size_t length = setup->args.memcpy.bytes;
+    lvaddr_t src, dst;
+
+    err = soft_dma_device_translate(dev, setup->args.memcpy.src, length, &src);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    err = soft_dma_device_translate(dev, setup->args.memcpy.dst, length, &dst);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct soft_dma_request *req;
+    err = request_prepare(soft_chan, setup, length, &req);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct dma_ring *ring = soft_dma_channel_get_ring(soft_chan);
+    struct dma_descriptor *desc;
+    size_t bytes, max_xfer_size = dma_channel_get_max_xfer_size(chan);
+    do {
+        desc = dma_ring_get_next_desc(ring);
+
+        if (!req->desc_head) {
+            req->desc_head = desc;
+        }
+        if (length <= max_xfer_size) {
+            /* the last one */
+            bytes = length;
+            req->desc_tail = desc;
+        } else {
+            bytes = max_xfer_size;
+        }
+
+        soft_dma_desc_fill_memcpy(desc, src, dst, bytes);
+        dma_desc_set_request(desc, NULL);
+
+        length -= bytes;
+        src += bytes;
+        dst += bytes;
+    } while (length > 0);
+
+    return request_submit(soft_chan, req, setup, id);
+}
+
+/**
+ * \brief issues a memcpy request to a channel of the given device
+ *
+ * \param dev   software DMA device
+ * \param setup request setup information
+ * \param id    returns the generated request id
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+errval_t soft_dma_request_memcpy(struct dma_device *dev,
+                                 struct dma_req_setup *setup,
+                                 dma_req_id_t *id)
+{
+    struct dma_channel *chan = dma_device_get_channel(dev);
+    return soft_dma_request_memcpy_chan(chan, setup, id);
+}
+
+/**
+ * \brief issues a memset request to the given channel
+ *
+ * \param chan  software DMA channel
+ * \param setup request setup information
+ * \param id    returns the generated request id
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+errval_t soft_dma_request_memset_chan(struct dma_channel *chan,
+                                      struct dma_req_setup *setup,
+                                      dma_req_id_t *id)
+{
+    errval_t err;
+
+    assert(chan->device->type == DMA_DEV_TYPE_SOFT);
+
+    struct soft_dma_channel *soft_chan = (struct soft_dma_channel *) chan;
+    struct soft_dma_device *dev = (struct soft_dma_device *) chan->device;
+
+    SOFTREQ_DEBUG("DMA Memset request: [0x%016lx]->[0x%016lx] of %lu bytes\n",
+                  setup->args.memset.val, setup->args.memset.dst,
+                  setup->args.memset.bytes);
+
+    size_t length = setup->args.memset.bytes;
+    lvaddr_t dst;
+
+    err = soft_dma_device_translate(dev, setup->args.memset.dst, length, &dst);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct soft_dma_request *req;
+    err = request_prepare(soft_chan, setup, length, &req);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct dma_ring *ring = soft_dma_channel_get_ring(soft_chan);
+    struct dma_descriptor *desc;
+    size_t bytes, max_xfer_size = dma_channel_get_max_xfer_size(chan);
+    do {
+        desc = dma_ring_get_next_desc(ring);
+
+        if (!req->desc_head) {
+            req->desc_head = desc;
+        }
+        if (length <= max_xfer_size) {
+            /* the last one */
+            bytes = length;
+            req->desc_tail = desc;
+        } else {
+            bytes = max_xfer_size;
+        }
+
+        soft_dma_desc_fill_memset(desc, setup->args.memset.val, dst, bytes);
+        dma_desc_set_request(desc, NULL);
+
+        length -= bytes;
+        dst += bytes;
+    } while (length > 0);
+
+    return request_submit(soft_chan, req, setup, id);
+}
+
+/**
+ * \brief issues a memset request to a channel of the given device
+ *
+ * \param dev   software DMA device
+ * \param setup request setup information
+ * \param id    returns the generated request id
+ *
+ * \returns SYS_ERR_OK on success
+ *          errval on failure
+ */
+errval_t soft_dma_request_memset(struct dma_device *dev,
+                                 struct dma_req_setup *setup,
+                                 dma_req_id_t *id)
+{
+    struct dma_channel *chan = dma_device_get_channel(dev);
+    return soft_dma_request_memset_chan(chan, setup, id);
+}
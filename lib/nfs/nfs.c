@@ -860,6 +860,65 @@ err_t nfs_remove(struct nfs_client *client, struct nfs_fh3 dir,
 }
 
 
+/// RPC callback for commit replies
+static void commit_reply_handler(struct rpc_client *rpc_client, void *arg1,
+                                 void *arg2, uint32_t replystat,
+                                 uint32_t acceptstat, XDR *xdr)
+{
+    struct nfs_client *client = (void *)rpc_client;
+    nfs_commit_callback_t callback = (nfs_commit_callback_t)arg1;
+    COMMIT3res result;
+    bool rb;
+
+    if (replystat != RPC_MSG_ACCEPTED || acceptstat != RPC_SUCCESS) {
+        printf("Commit failed\n");
+        callback(arg2, client, NULL);
+    } else {
+        memset(&result, 0, sizeof(result));
+        rb = xdr_COMMIT3res(xdr, &result);
+        assert(rb);
+        if (rb) {
+            callback(arg2, client, &result);
+        } else {
+            /* free partial results if the xdr fails */
+            xdr_COMMIT3res(&xdr_free, &result);
+            callback(arg2, client, NULL);
+        }
+    }
+}
+
+/** \brief Initiate an NFS commit operation
+ *
+ * Asks the server to flush data previously written with UNSTABLE or
+ * DATA_SYNC stability to stable storage.
+ *
+ * \param client NFS client pointer, which has completed the mount process
+ * \param fh Filehandle for file to commit
+ * \param offset Start of the range to commit
+ * \param count Number of bytes to commit, or 0 for everything from offset to
+ *              the end of the file
+ * \param callback Callback function to call when operation returns
+ * \param cbarg Opaque argument word passed to callback function
+ *
+ * \returns ERR_OK on success, error code on failure
+ */
+err_t nfs_commit(struct nfs_client *client, struct nfs_fh3 fh, offset3 offset,
+                 count3 count, nfs_commit_callback_t callback, void *cbarg)
+{
+    assert(client->mount_state == NFS_INIT_COMPLETE);
+
+    struct COMMIT3args args = {
+        .file = fh,
+        .offset = offset,
+        .count = count,
+    };
+
+    return rpc_call(&client->rpc_client, client->nfs_port, NFS_PROGRAM,
+                    NFS_V3, NFSPROC3_COMMIT, (xdrproc_t) xdr_COMMIT3args,
+                    &args, sizeof(args) + RNDUP(fh.data_len),
+                    commit_reply_handler, callback, cbarg);
+}
+
 /**
  * \brief Reclaim memory and terminate any outstanding operations
  */
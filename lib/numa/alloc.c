@@ -14,6 +14,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <barrelfish/barrelfish.h>
@@ -28,6 +29,14 @@ struct bitmap *numa_alloc_interleave_mask;
 ///< numa bind mask for allocations
 struct bitmap *numa_alloc_bind_mask;
 
+/**
+ * \brief returns the virtual base address of a vregion
+ */
+static inline lvaddr_t vregion_base(struct vregion *vregion)
+{
+    return vspace_genvaddr_to_lvaddr(vregion_get_base_addr(vregion));
+}
+
 /**
  * \brief validates the given page size and sets the flags
  *
@@ -443,11 +452,49 @@ void *numa_alloc(size_t size, size_t pagesize)
  * \param old_addr  pointer ot the old memory region
  * \param old_size  size of the old memory region
  * \param new_size  new size to allocate
+ *
+ * \returns pointer to the resized memory region
+ *
+ * The new region is allocated on the node of the first page of the old region
+ * and the contents are copied over. On errors NULL is returned and the old
+ * region is left untouched.
  */
 void *numa_realloc(void *old_addr, size_t old_size, size_t new_size)
 {
-    assert(!"NYI");
-    return 0;
+    errval_t err;
+
+    if (old_addr == NULL) {
+        return numa_alloc(new_size, BASE_PAGE_SIZE);
+    }
+
+    struct vregion *vregion = vspace_get_region(get_current_vspace(), old_addr);
+    if (vregion == NULL || vregion_base(vregion) != (lvaddr_t)old_addr) {
+        /* numa_alloc() fell back to malloc() */
+        return realloc(old_addr, new_size);
+    }
+
+    size_t pagesize = BASE_PAGE_SIZE;
+    if (vregion_get_flags(vregion) & VREGION_FLAGS_LARGE) {
+        pagesize = LARGE_PAGE_SIZE;
+    }
+
+    void *new_addr;
+    nodeid_t node;
+    err = numa_get_page_node(old_addr, &node);
+    if (err_is_ok(err)) {
+        new_addr = numa_alloc_onnode(new_size, node, pagesize);
+    } else {
+        new_addr = numa_alloc(new_size, pagesize);
+    }
+    if (new_addr == NULL) {
+        return NULL;
+    }
+
+    memcpy(new_addr, old_addr, (old_size < new_size) ? old_size : new_size);
+
+    numa_free(old_addr, old_size);
+
+    return new_addr;
 }
 
 
@@ -458,12 +505,71 @@ void *numa_realloc(void *old_addr, size_t old_size, size_t new_size)
  * \param size  number of bytes to free
  *
  * the memory must be previously allocated by one of the numa_alloc* functions
+ * and is freed as a whole, together with the frames backing it.
  */
 void numa_free(void *start, size_t size)
 {
-    assert(!"NYI");
-}
+    errval_t err;
 
+    struct vregion *vregion = vspace_get_region(get_current_vspace(), start);
+    if (vregion == NULL || vregion_base(vregion) != (lvaddr_t)start) {
+        /* numa_alloc() fell back to malloc() */
+        free(start);
+        return;
+    }
+
+    assert(size <= vregion_get_size(vregion));
+
+    struct memobj *memobj = vregion_get_memobj(vregion);
+    switch (memobj->type) {
+        case ONE_FRAME: {
+            struct capref frame = ((struct memobj_one_frame *)memobj)->frame;
+
+            /* this frees the memobj as well */
+            err = vregion_destroy(vregion);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "vregion_destroy");
+                return;
+            }
+
+            err = numa_frame_free(frame);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "numa_frame_free");
+            }
+            break;
+        }
+        case MEMOBJ_NUMA: {
+            struct memobj_numa *mo_numa = (struct memobj_numa *)memobj;
+
+            err = vregion_destroy(vregion);
+            if (err_is_fail(err)) {
+                DEBUG_ERR(err, "vregion_destroy");
+                return;
+            }
+
+            for (uint32_t i = 0; i < mo_numa->node_count; ++i) {
+                struct capref frame;
+                err = memobj->f.unfill(memobj, i, &frame, NULL);
+                if (err_is_fail(err)) {
+                    continue;
+                }
+                err = numa_frame_free(frame);
+                if (err_is_fail(err)) {
+                    DEBUG_ERR(err, "numa_frame_free");
+                }
+            }
+
+            free(mo_numa->frames);
+            free(mo_numa);
+            break;
+        }
+        default:
+            NUMA_WARNING("region %p was not allocated by libnuma", start);
+            return;
+    }
+
+    free(vregion);
+}
 
 
 /**
@@ -519,48 +625,6 @@ errval_t numa_frame_alloc_on_node(struct capref *dest,
  */
 errval_t numa_frame_free(struct capref frame)
 {
-    assert(!"NYI");
-    return 0;
-}
-
-
-/**
- * \brief  moves a list of pages in the address space of the current domain
- *
- * \param did    the domain ID
- * \param count  number of pages to move
- * \param pages  list of pages
- * \param nodes  list of nodes to which the pages can be moved
- * \param status returns the outcome for each page
- * \param flags  flags for moving the pages
- *
- * \returns SYS_ERR_OK on SUCCESS
- */
-errval_t numa_move_pages(domainid_t did,
-                         size_t count,
-                         void **pages,
-                         const nodeid_t *nodes,
-                         errval_t *status,
-                         int flags)
-{
-    assert(!"NYI");
-    return 0;
+    return cap_destroy(frame);
 }
 
-
-/**
- * \brief migrate a domain from one set of nodes to another
- *
- * \param did        the domain ID
- * \param fromnodes  bitmap representing the current nodes
- * \param tonodes    bitmap representing the
- *
- * \returns SYS_ERR_OK on SUCCESS
- */
-errval_t numa_migrate_pages(domainid_t did,
-                            struct bitmap *fromnodes,
-                            struct bitmap *tonodes)
-{
-    assert(!"NYI");
-    return 0;
-}
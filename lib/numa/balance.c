@@ -0,0 +1,487 @@
+/**
+ * \file
+ * \brief Automatic NUMA balancing
+ *
+ * The balancing thread samples the accesses to the anonymous memory of the
+ * domain, which includes its heap. In every round it write protects a set of
+ * frames, and the page fault fixup counts the first fault on each of them by
+ * the node of the faulting core and lifts the protection again. After a number
+ * of rounds, frames which were written mostly from one remote node are moved
+ * there, at most a fixed number per evaluation, and the next set of frames is
+ * sampled.
+ *
+ * Only writes are seen, as pages cannot be made inaccessible on x86 without
+ * unmapping them. The protection of sampled frames overrides any protection
+ * the application set itself.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/except.h>
+#include <barrelfish/deferred.h>
+#include <barrelfish/curdispatcher_arch.h>
+
+#include <numa.h>
+#include "numa_internal.h"
+
+/// states of a sample
+enum sample_state {
+    SAMPLE_FREE,        ///< the slot is not in use
+    SAMPLE_IDLE,        ///< the frame is sampled, but not protected
+    SAMPLE_ARMED,       ///< the frame is protected, waiting for a fault
+    SAMPLE_RESTORING,   ///< the protection is being lifted
+};
+
+/// a sampled frame
+struct balance_sample {
+    volatile uint32_t state;            ///< enum sample_state
+    struct vregion *vregion;            ///< the vregion mapping the frame
+    genvaddr_t offset;                  ///< offset of the frame in the vregion
+    lvaddr_t vaddr;                     ///< address at which it is mapped
+    size_t size;                        ///< size of the frame
+    nodeid_t node;                      ///< node of the frame
+    uint32_t faults[NUMA_MAX_NUMNODES]; ///< faults by node of the faulting core
+};
+
+///< the sampled frames, the fixup may not allocate memory
+static struct balance_sample samples[NUMA_BALANCE_SAMPLES];
+
+static struct numa_balance_params balance_params;
+static struct numa_balance_stats balance_stats;
+
+static struct thread *balance_thread = NULL;
+static volatile bool balance_stop = false;
+
+///< index of the frame where the next set of samples starts
+static size_t balance_cursor = 0;
+
+static bool balance_fixup(void *addr, enum pagefault_exception_type subtype,
+                          bool disabled);
+
+/**
+ * \brief installs the page fault fixup of libnuma
+ *
+ * The fixup retries accesses to frames being migrated, and counts the faults
+ * on frames sampled by the balancing service.
+ */
+void numa_balance_fixup_install(void)
+{
+    static bool installed = false;
+
+    if (!installed) {
+        pagefault_fixup_fn old = disp_set_pagefault_fixup(balance_fixup);
+        assert(old == NULL || old == balance_fixup);
+        installed = true;
+    }
+}
+
+/**
+ * \brief checks whether the frames of a vregion can be sampled
+ */
+static bool balance_vregion_ok(struct vregion *vregion)
+{
+    vregion_flags_t flags = vregion_get_flags(vregion);
+
+    if (vregion_get_memobj(vregion)->type != ANONYMOUS) {
+        return false;
+    }
+
+    if ((flags & VREGION_FLAGS_READ_WRITE) != VREGION_FLAGS_READ_WRITE) {
+        return false;
+    }
+
+    return !(flags & (VREGION_FLAGS_GUARD | VREGION_FLAGS_MPB
+                      | VREGION_FLAGS_NOCACHE));
+}
+
+/**
+ * \brief fills the sample slots with the next set of frames
+ *
+ * The anonymous frames of the domain are sampled round robin.
+ */
+static void balance_pick(void)
+{
+    struct vspace *vspace = get_current_vspace();
+    size_t total = 0;
+
+    for (struct vregion *v = vspace->head; v != NULL; v = v->next) {
+        if (!balance_vregion_ok(v)) {
+            continue;
+        }
+        struct memobj_anon *anon = (struct memobj_anon *)vregion_get_memobj(v);
+        for (struct memobj_frame_list *walk = anon->frame_list; walk;
+             walk = walk->next) {
+            total++;
+        }
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    size_t count = balance_params.samples;
+    if (count > total) {
+        count = total;
+    }
+
+    balance_cursor %= total;
+
+    uint32_t slot = 0;
+    size_t index = 0;
+    for (struct vregion *v = vspace->head; v != NULL; v = v->next) {
+        if (!balance_vregion_ok(v)) {
+            continue;
+        }
+        struct memobj_anon *anon = (struct memobj_anon *)vregion_get_memobj(v);
+        for (struct memobj_frame_list *walk = anon->frame_list; walk;
+             walk = walk->next, index++) {
+            if ((index + total - balance_cursor) % total >= count) {
+                continue;
+            }
+
+            /* protect() takes offsets relative to the vregion */
+            genvaddr_t vregion_off = vregion_get_offset(v);
+            if (walk->offset < vregion_off || walk->offset + walk->size
+                    > vregion_off + vregion_get_size(v)) {
+                continue;
+            }
+
+            struct balance_sample *s = &samples[slot];
+            s->vregion = v;
+            s->offset = walk->offset - vregion_off;
+            s->vaddr = vspace_genvaddr_to_lvaddr(vregion_get_base_addr(v)
+                                                 + walk->offset);
+            s->size = walk->size;
+            if (err_is_fail(numa_get_page_node((void *)s->vaddr, &s->node))) {
+                continue;
+            }
+            memset(s->faults, 0, sizeof(s->faults));
+
+            __sync_synchronize();
+            s->state = SAMPLE_IDLE;
+            balance_stats.sampled++;
+            slot++;
+        }
+    }
+
+    balance_cursor += count;
+}
+
+/**
+ * \brief write protects a sampled frame
+ */
+static void balance_arm(struct balance_sample *s)
+{
+    if (s->state != SAMPLE_IDLE) {
+        return;
+    }
+
+    struct memobj *memobj = vregion_get_memobj(s->vregion);
+    vregion_flags_t flags = vregion_get_flags(s->vregion);
+
+    s->state = SAMPLE_ARMED;
+    __sync_synchronize();
+
+    errval_t err = memobj->f.protect(memobj, s->vregion, s->offset, s->size,
+                                     flags & ~VREGION_FLAGS_WRITE);
+    if (err_is_fail(err)) {
+        /* not mapped yet, or gone */
+        NUMA_DEBUG_BALANCE("not sampling 0x%" PRIxLVADDR ": %s\n", s->vaddr,
+                           err_getstring(err));
+        __sync_bool_compare_and_swap(&s->state, SAMPLE_ARMED, SAMPLE_IDLE);
+    }
+}
+
+/**
+ * \brief lifts the protection of a sampled frame if it had no fault
+ */
+static void balance_disarm(struct balance_sample *s)
+{
+    if (__sync_bool_compare_and_swap(&s->state, SAMPLE_ARMED,
+                                     SAMPLE_RESTORING)) {
+        struct memobj *memobj = vregion_get_memobj(s->vregion);
+        errval_t err = memobj->f.protect(memobj, s->vregion, s->offset,
+                                         s->size, vregion_get_flags(s->vregion));
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "lifting the protection of 0x%" PRIxLVADDR, s->vaddr);
+        }
+        s->state = SAMPLE_IDLE;
+    }
+
+    /* the fixup on another core may be lifting it */
+    while (s->state == SAMPLE_RESTORING) {
+        thread_yield();
+    }
+}
+
+/**
+ * \brief ends the sampling of the current set of frames, and moves those
+ *        accessed mostly from a remote node
+ */
+static void balance_evaluate(void)
+{
+    uint32_t moves = 0;
+
+    for (uint32_t i = 0; i < NUMA_BALANCE_SAMPLES; ++i) {
+        struct balance_sample *s = &samples[i];
+        if (s->state == SAMPLE_FREE) {
+            continue;
+        }
+
+        balance_disarm(s);
+
+        nodeid_t best = s->node;
+        uint32_t total = 0;
+        for (nodeid_t node = 0; node < numa_topology.num_nodes; ++node) {
+            total += s->faults[node];
+            if (s->faults[node] > s->faults[best]) {
+                best = node;
+            }
+        }
+
+        if (best != s->node && s->faults[best] >= balance_params.min_faults
+                && 2 * s->faults[best] > total) {
+            if (moves >= balance_params.max_moves) {
+                balance_stats.ratelimited++;
+            } else {
+                moves++;
+
+                void *page = (void *)s->vaddr;
+                errval_t status;
+                errval_t err = numa_move_pages(disp_get_domain_id(), 1, &page,
+                                               &best, &status, 0);
+                if (err_is_ok(err)) {
+                    err = status;
+                }
+                if (err_is_fail(err)) {
+                    NUMA_DEBUG_BALANCE("not moving 0x%" PRIxLVADDR ": %s\n",
+                                       s->vaddr, err_getstring(err));
+                    balance_stats.failed++;
+                } else {
+                    NUMA_DEBUG_BALANCE("moved 0x%" PRIxLVADDR " to node %"
+                                       PRIuNODEID "\n", s->vaddr, best);
+                    balance_stats.moved++;
+                }
+            }
+        }
+
+        s->state = SAMPLE_FREE;
+    }
+}
+
+static int balance_thread_func(void *arg)
+{
+    uint64_t round = 0;
+
+    while (!balance_stop) {
+        if (round % balance_params.scan_rounds == 0) {
+            balance_evaluate();
+            balance_pick();
+        }
+
+        for (uint32_t i = 0; i < NUMA_BALANCE_SAMPLES; ++i) {
+            balance_arm(&samples[i]);
+        }
+
+        barrelfish_usleep((delayus_t)balance_params.period_ms * 1000);
+
+        balance_stats.rounds++;
+        round++;
+    }
+
+    /* lift all protections */
+    for (uint32_t i = 0; i < NUMA_BALANCE_SAMPLES; ++i) {
+        if (samples[i].state != SAMPLE_FREE) {
+            balance_disarm(&samples[i]);
+            samples[i].state = SAMPLE_FREE;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * \brief starts the automatic balancing of the memory of the calling domain
+ *
+ * \param params    parameters of the balancing, NULL for the defaults
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_BALANCE_RUNNING if the balancing is already running
+ */
+errval_t numa_balance_start(struct numa_balance_params *params)
+{
+    numa_check_init();
+
+    if (balance_thread != NULL) {
+        return NUMA_ERR_BALANCE_RUNNING;
+    }
+
+    if (params) {
+        balance_params = *params;
+    } else {
+        balance_params.period_ms = NUMA_BALANCE_PERIOD_MS;
+        balance_params.scan_rounds = NUMA_BALANCE_SCAN_ROUNDS;
+        balance_params.samples = NUMA_BALANCE_SAMPLES;
+        balance_params.min_faults = NUMA_BALANCE_MIN_FAULTS;
+        balance_params.max_moves = NUMA_BALANCE_MAX_MOVES;
+    }
+
+    if (balance_params.samples > NUMA_BALANCE_SAMPLES) {
+        balance_params.samples = NUMA_BALANCE_SAMPLES;
+    }
+    if (balance_params.scan_rounds == 0) {
+        balance_params.scan_rounds = 1;
+    }
+
+    NUMA_DEBUG_BALANCE("starting: period %" PRIu32 " ms, %" PRIu32 " rounds, %"
+                       PRIu32 " samples\n", balance_params.period_ms,
+                       balance_params.scan_rounds, balance_params.samples);
+
+    numa_balance_fixup_install();
+
+    balance_stop = false;
+    balance_thread = thread_create(balance_thread_func, NULL);
+    if (balance_thread == NULL) {
+        return LIB_ERR_THREAD_CREATE;
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief stops the automatic balancing
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_BALANCE_STOPPED if the balancing is not running
+ */
+errval_t numa_balance_stop(void)
+{
+    errval_t err;
+
+    if (balance_thread == NULL) {
+        return NUMA_ERR_BALANCE_STOPPED;
+    }
+
+    balance_stop = true;
+    err = thread_join(balance_thread, NULL);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    balance_thread = NULL;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief returns the counters of the automatic balancing
+ *
+ * \param stats returns the counters
+ */
+void numa_balance_get_stats(struct numa_balance_stats *stats)
+{
+    *stats = balance_stats;
+}
+
+/**
+ * \brief prints the counters of the automatic balancing
+ */
+void numa_balance_dump_stats(void)
+{
+    struct numa_balance_stats *s = &balance_stats;
+
+    printf("numa balancing: %" PRIu64 " rounds, %" PRIu64 " frames sampled\n",
+           s->rounds, s->sampled);
+    printf("  faults: %" PRIu64 " (%" PRIu64 " local, %" PRIu64 " remote)\n",
+           s->faults, s->local, s->remote);
+    printf("  moved: %" PRIu64 ", failed: %" PRIu64 ", rate limited: %" PRIu64
+           "\n", s->moved, s->failed, s->ratelimited);
+}
+
+/*
+ * ----------------------------------------------------------------------------
+ * Page fault fixup
+ * ----------------------------------------------------------------------------
+ */
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__ICC) \
+    && (defined(__x86_64__) || (defined(__i386__)))
+// Disable SSE/MMX -- the fixup runs disabled and may not touch the FPU state
+#       pragma GCC target ("no-mmx,no-sse,no-sse2,no-sse3,no-sse4.1,no-sse4.2,no-sse4,no-sse4a,no-3dnow")
+#endif
+
+/**
+ * \brief page fault fixup of libnuma
+ *
+ * \param addr      the fault address
+ * \param subtype   the type of the fault
+ * \param disabled  the fault was taken while disabled
+ *
+ * \returns true if the access is to be retried
+ *
+ * This runs disabled on the core which took the fault.
+ */
+static bool balance_fixup(void *addr, enum pagefault_exception_type subtype,
+                          bool disabled)
+{
+    lvaddr_t vaddr = (lvaddr_t)addr;
+
+    /*
+     * the frame is being migrated, wait until it is mapped again. A fault
+     * taken while disabled on the dispatcher of the migrating thread would
+     * wait forever, so it is delivered.
+     */
+    if (numa_migrate_active && vaddr - numa_migrate_base < numa_migrate_size) {
+        return !disabled || curdispatcher() != numa_migrate_disp;
+    }
+
+    if (subtype != PAGEFLT_WRITE) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < NUMA_BALANCE_SAMPLES; ++i) {
+        struct balance_sample *s = &samples[i];
+        if (s->state == SAMPLE_FREE || vaddr - s->vaddr >= s->size) {
+            continue;
+        }
+
+        if (!__sync_bool_compare_and_swap(&s->state, SAMPLE_ARMED,
+                                          SAMPLE_RESTORING)) {
+            /*
+             * being lifted by another core, or armed again in between: retry.
+             * An idle sample is not protected by us, so the fault is real.
+             */
+            uint32_t state = s->state;
+            return state == SAMPLE_RESTORING || state == SAMPLE_ARMED;
+        }
+
+        coreid_t core = disp_get_core_id();
+        if (core < numa_topology.num_cores) {
+            nodeid_t node = numa_topology.cores[core]->node->id;
+            __sync_fetch_and_add(&s->faults[node], 1);
+            __sync_fetch_and_add((node == s->node) ? &balance_stats.local
+                                                   : &balance_stats.remote, 1);
+        }
+        __sync_fetch_and_add(&balance_stats.faults, 1);
+
+        struct pmap *pmap = get_current_pmap();
+        errval_t err = pmap->f.modify_flags(pmap, s->vaddr, s->size,
+                                            vregion_get_flags(s->vregion),
+                                            NULL);
+        s->state = SAMPLE_IDLE;
+
+        return err_is_ok(err);
+    }
+
+    return false;
+}
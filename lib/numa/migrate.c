@@ -0,0 +1,627 @@
+/**
+ * \file
+ * \brief Page migration between NUMA nodes
+ *
+ * Pages are migrated with the frame that backs them in their memory object:
+ * a new frame is allocated on the target node, the contents are copied, and
+ * the memory object is refilled with the new frame and mapped again at the
+ * same virtual address. The old frame is freed afterwards.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/curdispatcher_arch.h>
+
+#include <numa.h>
+#include <bitmap.h>
+#include "numa_internal.h"
+
+///< the range being migrated, accesses to it are retried until it is done
+volatile lvaddr_t numa_migrate_base = 0;
+volatile size_t numa_migrate_size = 0;
+///< set while a migration is in progress on the range
+volatile bool numa_migrate_active = false;
+///< the dispatcher of the migrating thread
+dispatcher_handle_t numa_migrate_disp = 0;
+
+/// a frame backing part of a memory object
+struct migrate_frame {
+    struct capref frame;    ///< the frame
+    genvaddr_t offset;      ///< offset of the frame in the memory object
+    genpaddr_t foffset;     ///< offset into the frame
+    size_t size;            ///< number of bytes backed by the frame
+    genpaddr_t paddr;       ///< physical address backing offset
+};
+
+/**
+ * \brief finds the frame backing an offset in a memory object
+ *
+ * \param memobj    the memory object
+ * \param offset    the offset into the memory object
+ * \param ret       returns the frame
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_PAGE_ABSENT if no frame backs the offset
+ *          NUMA_ERR_MIGRATE_MEMOBJ if the type of memory object is unknown
+ */
+static errval_t find_frame(struct memobj *memobj, genvaddr_t offset,
+                           struct migrate_frame *ret)
+{
+    errval_t err;
+
+    switch (memobj->type) {
+        case ANONYMOUS: {
+            struct memobj_anon *anon = (struct memobj_anon *)memobj;
+            struct memobj_frame_list *walk = anon->frame_list;
+            while (walk) {
+                if (offset >= walk->offset && offset < walk->offset + walk->size) {
+                    ret->frame = walk->frame;
+                    ret->offset = walk->offset;
+                    ret->foffset = walk->foffset;
+                    ret->size = walk->size;
+                    ret->paddr = walk->pa + walk->foffset;
+                    return SYS_ERR_OK;
+                }
+                walk = walk->next;
+            }
+            return NUMA_ERR_PAGE_ABSENT;
+        }
+        case ONE_FRAME: {
+            struct memobj_one_frame *one_frame = (struct memobj_one_frame *)memobj;
+            if (capref_is_null(one_frame->frame) || offset >= memobj->size) {
+                return NUMA_ERR_PAGE_ABSENT;
+            }
+            ret->frame = one_frame->frame;
+            ret->offset = 0;
+            ret->foffset = one_frame->offset;
+            ret->size = memobj->size;
+            break;
+        }
+        case MEMOBJ_NUMA: {
+            /* stripes of stride bytes go round robin to the frames */
+            struct memobj_numa *mo_numa = (struct memobj_numa *)memobj;
+            size_t stripe = offset / mo_numa->stride;
+            uint32_t idx = stripe % mo_numa->node_count;
+            if (offset >= memobj->size || capref_is_null(mo_numa->frames[idx])) {
+                return NUMA_ERR_PAGE_ABSENT;
+            }
+            ret->frame = mo_numa->frames[idx];
+            ret->offset = stripe * mo_numa->stride;
+            ret->foffset = (stripe / mo_numa->node_count) * mo_numa->stride;
+            ret->size = mo_numa->stride;
+            break;
+        }
+        default:
+            return NUMA_ERR_MIGRATE_MEMOBJ;
+    }
+
+    struct frame_identity id;
+    err = invoke_frame_identify(ret->frame, &id);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    ret->paddr = id.base + ret->foffset;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief returns the node whose memory contains a physical address
+ */
+static nodeid_t node_of_paddr(genpaddr_t paddr)
+{
+    for (nodeid_t node = 0; node < numa_topology.num_nodes; ++node) {
+        if (paddr >= numa_topology.nodes[node].mem_base
+                && paddr < numa_topology.nodes[node].mem_limit) {
+            return node;
+        }
+    }
+    return (nodeid_t)NUMA_NODE_INVALID;
+}
+
+/**
+ * \brief returns the memory object offset of an address in a vregion
+ */
+static inline genvaddr_t vregion_offset_of(struct vregion *vregion,
+                                           lvaddr_t addr)
+{
+    lvaddr_t base = vspace_genvaddr_to_lvaddr(vregion_get_base_addr(vregion));
+    return addr - base - vregion_get_offset(vregion);
+}
+
+/**
+ * \brief returns the address at which a memory object offset is mapped
+ *
+ * This matches where the page fault handlers of the memory objects map
+ * their frames.
+ */
+static inline lvaddr_t vregion_addr_of(struct vregion *vregion,
+                                       genvaddr_t offset)
+{
+    return vspace_genvaddr_to_lvaddr(vregion_get_base_addr(vregion)
+                                     + vregion_get_offset(vregion) + offset);
+}
+
+static inline bool range_contains(lvaddr_t base, size_t size, const void *p)
+{
+    return (lvaddr_t)p >= base && (lvaddr_t)p < base + size;
+}
+
+/**
+ * \brief checks whether another part of the memory object uses a frame
+ */
+static bool frame_is_shared(struct memobj *memobj, struct capref frame)
+{
+    if (memobj->type != ANONYMOUS) {
+        return false;
+    }
+
+    struct memobj_anon *anon = (struct memobj_anon *)memobj;
+    for (struct memobj_frame_list *walk = anon->frame_list; walk;
+         walk = walk->next) {
+        if (capcmp(walk->frame, frame)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief ends the migration of a frame and removes its temporary mapping
+ *
+ * The temporary mapping is only torn down once the frame is mapped again, as
+ * this writes to the heap, which may be in the frame just moved.
+ */
+static void migrate_done(struct vregion *tmp)
+{
+    numa_migrate_active = false;
+    __sync_synchronize();
+    numa_migrate_base = 0;
+    numa_migrate_size = 0;
+    __sync_synchronize();
+
+    errval_t err = vregion_destroy(tmp);
+    if (err_is_fail(err)) {
+        /* the frame has moved, so carry on and leak the mapping */
+        DEBUG_ERR(err, "vregion_destroy");
+    } else {
+        free(tmp);
+    }
+}
+
+/**
+ * \brief moves a frame of a memory object to a node
+ *
+ * \param vregion   the vregion through which the frame is accessed
+ * \param mf        the frame
+ * \param node      the target node
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          errval on FAILURE
+ *
+ * The frame is write protected while it is copied, and not backed in the
+ * memory object between unmapping the old frame and mapping the new one.
+ * Other threads faulting on it in the meantime retry the access until the
+ * frame is mapped again. The calling thread may not touch the frame, so
+ * frames holding its stack or the bookkeeping of the memory object are
+ * refused.
+ */
+static errval_t migrate_frame(struct vregion *vregion, struct migrate_frame *mf,
+                              nodeid_t node)
+{
+    errval_t err;
+    struct memobj *memobj = vregion_get_memobj(vregion);
+    lvaddr_t vaddr = vregion_addr_of(vregion, mf->offset);
+
+    if (memobj->type != ANONYMOUS && memobj->type != ONE_FRAME) {
+        return NUMA_ERR_MIGRATE_MEMOBJ;
+    }
+
+    if (!(vregion_get_flags(vregion) & VREGION_FLAGS_READ)) {
+        return NUMA_ERR_MIGRATE_MEMOBJ;
+    }
+
+    if (range_contains(vaddr, mf->size, &err)
+            || range_contains(vaddr, mf->size, memobj)
+            || range_contains(vaddr, mf->size, vregion)) {
+        return NUMA_ERR_MIGRATE_IN_USE;
+    }
+
+    NUMA_DEBUG_MIGRATE("moving 0x%" PRIxLVADDR " (%zu bytes) to node %"
+                       PRIuNODEID "\n", vaddr, mf->size, node);
+
+    struct capref frame;
+    err = numa_frame_alloc_on_node(&frame, mf->size, node, NULL);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    /* copy the contents through a temporary mapping of the new frame */
+    void *buf;
+    struct vregion *tmp;
+    err = vspace_map_one_frame_attr(&buf, mf->size, frame,
+                                    VREGION_FLAGS_READ_WRITE, NULL, &tmp);
+    if (err_is_fail(err)) {
+        numa_frame_free(frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    /*
+     * other threads faulting on the frame until it is mapped again retry the
+     * access, so writes during the copy are not lost
+     */
+    numa_balance_fixup_install();
+    numa_migrate_size = mf->size;
+    numa_migrate_base = vaddr;
+    numa_migrate_disp = curdispatcher();
+    __sync_synchronize();
+    numa_migrate_active = true;
+    __sync_synchronize();
+
+    struct pmap *pmap = vspace_get_pmap(vregion_get_vspace(vregion));
+    err = pmap->f.modify_flags(pmap, vaddr, mf->size,
+                               vregion_get_flags(vregion) & ~VREGION_FLAGS_WRITE,
+                               NULL);
+    if (err_is_fail(err)) {
+        /* not mapped yet, accesses fault anyway */
+        NUMA_DEBUG_MIGRATE("not protecting 0x%" PRIxLVADDR ": %s\n", vaddr,
+                           err_getstring(err));
+    }
+
+    memcpy(buf, (void *)vaddr, mf->size);
+
+    /* replace the frame in the memory object, this unmaps the old one */
+    struct capref old = mf->frame;
+    if (memobj->type == ANONYMOUS) {
+        err = memobj->f.unfill(memobj, mf->offset, &old, NULL);
+        if (err_is_fail(err)) {
+            pmap->f.modify_flags(pmap, vaddr, mf->size,
+                                 vregion_get_flags(vregion), NULL);
+            migrate_done(tmp);
+            numa_frame_free(frame);
+            return err_push(err, LIB_ERR_MEMOBJ_UNMAP_REGION);
+        }
+    } else {
+        struct memobj_one_frame *one_frame = (struct memobj_one_frame *)memobj;
+        for (struct vregion_list *walk = one_frame->vregion_list; walk;
+             walk = walk->next) {
+            struct pmap *vpmap = vspace_get_pmap(vregion_get_vspace(walk->region));
+            genvaddr_t base = vregion_get_base_addr(walk->region)
+                                + vregion_get_offset(walk->region);
+            err = vpmap->f.unmap(vpmap, base, memobj->size, NULL);
+            if (err_is_fail(err)) {
+                USER_PANIC_ERR(err, "unmapping frame to migrate");
+            }
+        }
+    }
+
+    err = memobj->f.fill(memobj, mf->offset, frame, mf->size);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "refilling migrated frame");
+    }
+
+    err = memobj->f.pagefault(memobj, vregion, mf->offset, 0);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "mapping migrated frame");
+    }
+
+    migrate_done(tmp);
+
+    if (!frame_is_shared(memobj, old)) {
+        err = numa_frame_free(old);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "numa_frame_free");
+        }
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief returns the node on which a page resides
+ *
+ * \param page      address of the page
+ * \param ret_node  returns the node ID
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *          NUMA_ERR_PAGE_ABSENT if the page is not backed by memory
+ *          NUMA_ERR_PAGE_NODE if the memory is not on any node
+ */
+errval_t numa_get_page_node(void *page, nodeid_t *ret_node)
+{
+    errval_t err;
+
+    numa_check_init();
+
+    struct vregion *vregion = vspace_get_region(get_current_vspace(), page);
+    if (vregion == NULL) {
+        return NUMA_ERR_PAGE_ABSENT;
+    }
+
+    genvaddr_t offset = vregion_offset_of(vregion, (lvaddr_t)page);
+
+    struct migrate_frame mf;
+    err = find_frame(vregion_get_memobj(vregion), offset, &mf);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    nodeid_t node = node_of_paddr(mf.paddr + (offset - mf.offset));
+    if (node == (nodeid_t)NUMA_NODE_INVALID) {
+        return NUMA_ERR_PAGE_NODE;
+    }
+
+    *ret_node = node;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief counts the pages of a vregion on each node
+ *
+ * \param vregion   the vregion
+ * \param pages     array of numa_max_node() + 1 counters, returns the number
+ *                  of pages on each node
+ * \param ret_other returns the number of pages which are not backed by memory
+ *                  or whose node cannot be determined
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ */
+errval_t numa_vregion_residency(struct vregion *vregion, size_t *pages,
+                                size_t *ret_other)
+{
+    numa_check_init();
+
+    struct memobj *memobj = vregion_get_memobj(vregion);
+    genvaddr_t offset = vregion_get_offset(vregion);
+    genvaddr_t end = offset + vregion_get_size(vregion);
+    size_t other = 0;
+
+    memset(pages, 0, numa_topology.num_nodes * sizeof(size_t));
+
+    while (offset < end) {
+        struct migrate_frame mf;
+        errval_t err = find_frame(memobj, offset, &mf);
+        if (err_is_fail(err)) {
+            other++;
+            offset += BASE_PAGE_SIZE;
+            continue;
+        }
+
+        /* a frame may span nodes, so look at each page */
+        genvaddr_t frame_end = mf.offset + mf.size;
+        if (frame_end > end) {
+            frame_end = end;
+        }
+        for (; offset < frame_end; offset += BASE_PAGE_SIZE) {
+            nodeid_t node = node_of_paddr(mf.paddr + (offset - mf.offset));
+            if (node == (nodeid_t)NUMA_NODE_INVALID) {
+                other++;
+            } else {
+                pages[node]++;
+            }
+        }
+    }
+
+    if (ret_other) {
+        *ret_other = other;
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief prints the number of pages on each node for all vregions of the
+ *        calling domain
+ */
+void numa_dump_residency(void)
+{
+    numa_check_init();
+
+    size_t *pages = calloc(numa_topology.num_nodes, sizeof(size_t));
+    if (pages == NULL) {
+        return;
+    }
+
+    printf("%-18s %10s %5s", "vregion", "size", "type");
+    for (nodeid_t node = 0; node < numa_topology.num_nodes; ++node) {
+        printf("    node %-2" PRIuNODEID, node);
+    }
+    printf("      other\n");
+
+    struct vspace *vspace = get_current_vspace();
+    for (struct vregion *v = vspace->head; v != NULL; v = v->next) {
+        size_t other;
+        numa_vregion_residency(v, pages, &other);
+        printf("0x%016" PRIxGENVADDR " %10" PRIuGENVADDR " %5u",
+               vregion_get_base_addr(v), vregion_get_size(v),
+               (unsigned)vregion_get_memobj(v)->type);
+        for (nodeid_t node = 0; node < numa_topology.num_nodes; ++node) {
+            printf(" %10zu", pages[node]);
+        }
+        printf(" %10zu\n", other);
+    }
+
+    free(pages);
+}
+
+/**
+ * \brief moves the frame backing a page to a node, unless it is there already
+ */
+static errval_t move_page(void *page, nodeid_t node)
+{
+    errval_t err;
+
+    if (node >= numa_topology.num_nodes) {
+        return NUMA_ERR_NODEID_INVALID;
+    }
+
+    struct vregion *vregion = vspace_get_region(get_current_vspace(), page);
+    if (vregion == NULL) {
+        return NUMA_ERR_PAGE_ABSENT;
+    }
+
+    genvaddr_t offset = vregion_offset_of(vregion, (lvaddr_t)page);
+
+    struct migrate_frame mf;
+    err = find_frame(vregion_get_memobj(vregion), offset, &mf);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    /* earlier pages in the list may have moved this one already */
+    if (node_of_paddr(mf.paddr + (offset - mf.offset)) == node) {
+        return SYS_ERR_OK;
+    }
+
+    return migrate_frame(vregion, &mf, node);
+}
+
+/**
+ * \brief  moves a list of pages in the address space of the current domain
+ *
+ * \param did    the domain ID
+ * \param count  number of pages to move
+ * \param pages  list of pages
+ * \param nodes  list of nodes to which the pages can be moved
+ * \param status returns the outcome for each page
+ * \param flags  flags for moving the pages
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *
+ * Pages are moved with the whole frame backing them, so neighbouring pages
+ * may move as well. The outcome for every page is returned in status, which
+ * may be NULL. Only the calling domain is supported; flags are unused.
+ */
+errval_t numa_move_pages(domainid_t did,
+                         size_t count,
+                         void **pages,
+                         const nodeid_t *nodes,
+                         errval_t *status,
+                         int flags)
+{
+    errval_t err;
+
+    numa_check_init();
+
+    if (did != disp_get_domain_id()) {
+        return NUMA_ERR_MIGRATE_DOMAIN;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        err = move_page(pages[i], nodes[i]);
+        if (status) {
+            status[i] = err;
+        }
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief returns the node in tonodes corresponding to a node in fromnodes
+ *
+ * The n-th node of fromnodes maps to the n-th node of tonodes, wrapping
+ * around if tonodes has fewer nodes.
+ */
+static nodeid_t map_node(struct bitmap *fromnodes, struct bitmap *tonodes,
+                         nodeid_t node)
+{
+    uint32_t idx = 0;
+    bitmap_bit_t bit = bitmap_get_first(fromnodes);
+    while (bit != node) {
+        bit = bitmap_get_next(fromnodes, bit);
+        idx++;
+    }
+
+    idx %= bitmap_get_weight(tonodes);
+    bit = bitmap_get_first(tonodes);
+    while (idx--) {
+        bit = bitmap_get_next(tonodes, bit);
+    }
+
+    return (nodeid_t)bit;
+}
+
+/**
+ * \brief migrate a domain from one set of nodes to another
+ *
+ * \param did        the domain ID
+ * \param fromnodes  bitmap representing the current nodes
+ * \param tonodes    bitmap representing the
+ *
+ * \returns SYS_ERR_OK on SUCCESS
+ *
+ * Moves the anonymous memory of the domain, which includes its heap, that
+ * is on a node in fromnodes to the corresponding node in tonodes. Memory
+ * mapped from frames is left in place, as the frames may be shared. Frames
+ * which cannot be moved are skipped. Only the calling domain is supported.
+ */
+errval_t numa_migrate_pages(domainid_t did,
+                            struct bitmap *fromnodes,
+                            struct bitmap *tonodes)
+{
+    errval_t err;
+
+    numa_check_init();
+
+    if (did != disp_get_domain_id()) {
+        return NUMA_ERR_MIGRATE_DOMAIN;
+    }
+
+    if (bitmap_get_weight(tonodes) == 0) {
+        return NUMA_ERR_BITMAP_RANGE;
+    }
+
+    struct vspace *vspace = get_current_vspace();
+    for (struct vregion *v = vspace->head; v != NULL; v = v->next) {
+        struct memobj *memobj = vregion_get_memobj(v);
+        if (memobj->type != ANONYMOUS) {
+            continue;
+        }
+
+        genvaddr_t offset = vregion_get_offset(v);
+        genvaddr_t end = offset + vregion_get_size(v);
+        while (offset < end) {
+            struct migrate_frame mf;
+            err = find_frame(memobj, offset, &mf);
+            if (err_is_fail(err)) {
+                offset += BASE_PAGE_SIZE;
+                continue;
+            }
+            offset = mf.offset + mf.size;
+
+            nodeid_t node = node_of_paddr(mf.paddr);
+            if (node == (nodeid_t)NUMA_NODE_INVALID
+                    || !bitmap_is_bit_set(fromnodes, node)) {
+                continue;
+            }
+
+            nodeid_t target = map_node(fromnodes, tonodes, node);
+            if (target == node) {
+                continue;
+            }
+
+            err = migrate_frame(v, &mf, target);
+            if (err_is_fail(err)) {
+                NUMA_DEBUG_MIGRATE("not moving 0x%" PRIxGENVADDR ": %s\n",
+                                   vregion_get_base_addr(v) + mf.offset,
+                                   err_getstring(err));
+            }
+        }
+    }
+
+    return SYS_ERR_OK;
+}
@@ -14,6 +14,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <barrelfish/barrelfish.h>
@@ -126,6 +127,14 @@ errval_t numa_available(void)
 
     numa_initialized = 0x1;
 
+    /* applications can be balanced without asking for it */
+    if (getenv("NUMA_BALANCING") != NULL) {
+        err = numa_balance_start(NULL);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "starting automatic balancing");
+        }
+    }
+
     return SYS_ERR_OK;
 
     /* cleanup in case of error */
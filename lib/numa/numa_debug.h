@@ -34,6 +34,10 @@
 
 #define NUMA_DEBUG_ALLOC(x...) NUMA_DEBUG_PRINT("[numa alloc] " x);
 
+#define NUMA_DEBUG_MIGRATE(x...) NUMA_DEBUG_PRINT("[numa migr.] " x);
+
+#define NUMA_DEBUG_BALANCE(x...) NUMA_DEBUG_PRINT("[numa  bal.] " x);
+
 #define NUMA_ERROR(fmt, ...) \
                 debug_printf("[numa error] " fmt " in %s():", \
                              __VA_ARGS__, __FUNCTION__);
@@ -86,6 +86,26 @@ extern struct bitmap *numa_alloc_interleave_mask;
 ///< numa bind mask for allocations
 extern struct bitmap *numa_alloc_bind_mask;
 
+///< the range being migrated, accesses to it are retried until it is done
+extern volatile lvaddr_t numa_migrate_base;
+extern volatile size_t numa_migrate_size;
+extern volatile bool numa_migrate_active;
+extern dispatcher_handle_t numa_migrate_disp;
+
+/*
+ * ----------------------------------------------------------------------------
+ * Balancing
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \brief installs the page fault fixup of libnuma
+ *
+ * The fixup retries accesses to frames being migrated, and counts the faults
+ * on frames sampled by the balancing service.
+ */
+void numa_balance_fixup_install(void);
+
 /*
  * ----------------------------------------------------------------------------
  * Queriying the SKB
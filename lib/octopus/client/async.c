@@ -0,0 +1,268 @@
+/**
+ * \file
+ * \brief Asynchronous get/set client API implementation
+ *
+ * Issues octopus RPCs through the asynchronous calls of the domain's octopus
+ * RPC client. Any number of calls may be outstanding. The calls use the
+ * request ID variants of get/set/del/exists, so each reply is matched to its
+ * call by ID and invokes the continuation given to that call, whatever order
+ * the server answers in.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#include <barrelfish/barrelfish.h>
+
+#include <octopus/getset.h>
+#include <octopus/trigger.h>
+#include <if/octopus_defs.h>
+#include <if/octopus_rpcclient_defs.h>
+
+#include "common.h"
+
+/// State of an outstanding asynchronous call
+struct oct_async_call {
+    oct_async_cont_fn *cont;
+    void *st;
+    char *query;    ///< formatted query, referenced until the call is sent
+};
+
+static errval_t async_call_alloc(oct_async_cont_fn *cont, void *st,
+                                 char *query, struct oct_async_call **retcall)
+{
+    struct oct_async_call *call = malloc(sizeof(*call));
+    if (call == NULL) {
+        free(query);
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    call->cont = cont;
+    call->st = st;
+    call->query = query;
+    *retcall = call;
+    return SYS_ERR_OK;
+}
+
+static void async_call_done(struct oct_async_call *call, errval_t err,
+                            errval_t error_code, char *record)
+{
+    if (err_is_ok(err)) {
+        err = error_code;
+    }
+
+    oct_async_cont_fn *cont = call->cont;
+    void *st = call->st;
+    free(call->query);
+    free(call);
+
+    if (cont != NULL) {
+        cont(st, err, record);
+    } else {
+        free(record);
+    }
+}
+
+static void get_cont(struct octopus_rpc_client *rpc, void *st, errval_t err,
+                     char *output, octopus_trigger_id_t tid,
+                     errval_t error_code)
+{
+    async_call_done(st, err, error_code, output);
+}
+
+static void set_cont(struct octopus_rpc_client *rpc, void *st, errval_t err,
+                     char *record, octopus_trigger_id_t tid,
+                     errval_t error_code)
+{
+    async_call_done(st, err, error_code, record);
+}
+
+static void del_cont(struct octopus_rpc_client *rpc, void *st, errval_t err,
+                     octopus_trigger_id_t tid, errval_t error_code)
+{
+    async_call_done(st, err, error_code, NULL);
+}
+
+static struct octopus_rpc_client *async_client(void)
+{
+    struct octopus_rpc_client *rpc = get_octopus_rpc_client();
+    assert(rpc != NULL);
+    return rpc;
+}
+
+/**
+ * \brief Gets one record matching the given query without waiting for the
+ * reply.
+ *
+ * \param cont Continuation invoked with the record, which it has to free,
+ * or the error of the call. May be NULL.
+ * \param st Argument passed to cont.
+ * \param query The query sent to the server.
+ * \param ... Additional arguments to format the query using vsprintf.
+ *
+ * \retval SYS_ERR_OK The call was issued, cont will be invoked.
+ * \retval OCT_ERR_QUERY_SIZE
+ * \retval LIB_ERR_MALLOC_FAIL
+ */
+errval_t oct_get_async(oct_async_cont_fn *cont, void *st, const char *query, ...)
+{
+    assert(query != NULL);
+    errval_t err = SYS_ERR_OK;
+    va_list args;
+
+    char* buf = NULL;
+    FORMAT_QUERY(query, args, buf);
+
+    struct oct_async_call *call;
+    err = async_call_alloc(cont, st, buf, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct octopus_rpc_client *rpc = async_client();
+    err = rpc->async_vtbl.get_seq(rpc, buf, NOP_TRIGGER, get_cont, call);
+    if (err_is_fail(err)) {
+        free(buf);
+        free(call);
+    }
+    return err;
+}
+
+/**
+ * \brief Sets a record without waiting for the reply.
+ *
+ * \param cont Continuation invoked with the outcome of the call (the record
+ * is always NULL). May be NULL.
+ * \param st Argument passed to cont.
+ * \param mode A combination of mode bits (see getset.h).
+ * \param query The record to set.
+ * \param ... Additional arguments to format the query using vsprintf.
+ *
+ * \retval SYS_ERR_OK The call was issued, cont will be invoked.
+ * \retval OCT_ERR_QUERY_SIZE
+ * \retval LIB_ERR_MALLOC_FAIL
+ */
+errval_t oct_mset_async(oct_async_cont_fn *cont, void *st, oct_mode_t mode,
+                        const char *query, ...)
+{
+    assert(query != NULL);
+    errval_t err = SYS_ERR_OK;
+    va_list args;
+
+    char* buf = NULL;
+    FORMAT_QUERY(query, args, buf);
+
+    struct oct_async_call *call;
+    err = async_call_alloc(cont, st, buf, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct octopus_rpc_client *rpc = async_client();
+    err = rpc->async_vtbl.set_seq(rpc, buf, mode, NOP_TRIGGER, false, set_cont,
+                              call);
+    if (err_is_fail(err)) {
+        free(buf);
+        free(call);
+    }
+    return err;
+}
+
+/**
+ * \brief Deletes the records matching a query without waiting for the reply.
+ *
+ * \param cont Continuation invoked with the outcome of the call. May be NULL.
+ * \param st Argument passed to cont.
+ * \param query Record(s) to delete.
+ * \param ... Additional arguments to format the query using vsprintf.
+ *
+ * \retval SYS_ERR_OK The call was issued, cont will be invoked.
+ * \retval OCT_ERR_QUERY_SIZE
+ * \retval LIB_ERR_MALLOC_FAIL
+ */
+errval_t oct_del_async(oct_async_cont_fn *cont, void *st, const char *query, ...)
+{
+    assert(query != NULL);
+    errval_t err = SYS_ERR_OK;
+    va_list args;
+
+    char* buf = NULL;
+    FORMAT_QUERY(query, args, buf);
+
+    struct oct_async_call *call;
+    err = async_call_alloc(cont, st, buf, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct octopus_rpc_client *rpc = async_client();
+    err = rpc->async_vtbl.del_seq(rpc, buf, NOP_TRIGGER, del_cont, call);
+    if (err_is_fail(err)) {
+        free(buf);
+        free(call);
+    }
+    return err;
+}
+
+/**
+ * \brief Checks if a record matching a query exists without waiting for the
+ * reply.
+ *
+ * \param cont Continuation invoked with SYS_ERR_OK if a record exists, or
+ * the error of the call (OCT_ERR_NO_RECORD if none exists). May be NULL.
+ * \param st Argument passed to cont.
+ * \param query The query sent to the server.
+ * \param ... Additional arguments to format the query using vsprintf.
+ *
+ * \retval SYS_ERR_OK The call was issued, cont will be invoked.
+ * \retval OCT_ERR_QUERY_SIZE
+ * \retval LIB_ERR_MALLOC_FAIL
+ */
+errval_t oct_exists_async(oct_async_cont_fn *cont, void *st,
+                          const char *query, ...)
+{
+    assert(query != NULL);
+    errval_t err = SYS_ERR_OK;
+    va_list args;
+
+    char* buf = NULL;
+    FORMAT_QUERY(query, args, buf);
+
+    struct oct_async_call *call;
+    err = async_call_alloc(cont, st, buf, &call);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    struct octopus_rpc_client *rpc = async_client();
+    err = rpc->async_vtbl.exists_seq(rpc, buf, NOP_TRIGGER, del_cont, call);
+    if (err_is_fail(err)) {
+        free(buf);
+        free(call);
+    }
+    return err;
+}
+
+/**
+ * \brief Handles replies until at most max_outstanding asynchronous calls
+ * are left.
+ *
+ * Pass 0 to wait for all outstanding calls to complete.
+ *
+ * \retval SYS_ERR_OK
+ * \retval LIB_ERR_EVENT_DISPATCH
+ */
+errval_t oct_async_wait(size_t max_outstanding)
+{
+    return octopus_rpc_async_wait(async_client(), max_outstanding);
+}
@@ -39,6 +39,10 @@ static const struct octopus_rx_vtbl rpc_rx_vtbl = {
         .set_with_idcap_call = set_with_idcap_handler,
         .del_call = del_handler,
         .exists_call = exists_handler,
+        .get_seq_call = get_seq_handler,
+        .set_seq_call = set_seq_handler,
+        .del_seq_call = del_seq_handler,
+        .exists_seq_call = exists_seq_handler,
         .wait_for_call = wait_for_handler,
         .remove_trigger_call = remove_trigger_handler,
 
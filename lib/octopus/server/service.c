@@ -77,6 +77,9 @@ errval_t new_oct_reply_state(struct oct_reply_state** drt,
     (*drt)->client_handler = 0;
     (*drt)->server_id = 0;
 
+    // For the request ID variants of get/set/del/exists
+    (*drt)->seq = 0;
+
     (*drt)->reply = reply_handler;
     (*drt)->next = NULL;
 
@@ -213,14 +216,28 @@ static void get_reply(struct octopus_binding* b, struct oct_reply_state* drt)
     }
 }
 
-void get_handler(struct octopus_binding *b, char *query, octopus_trigger_t trigger)
+static void get_seq_reply(struct octopus_binding* b,
+        struct oct_reply_state* drt)
 {
-    errval_t err = SYS_ERR_OK;
+    errval_t err;
+    char* reply = err_is_ok(drt->error) ?
+            drt->query_state.std_out.buffer : NULL;
+    err = b->tx_vtbl.get_seq_response(b, MKCONT(free_oct_reply_state, drt),
+            drt->seq, reply, drt->server_id, drt->error);
+    if (err_is_fail(err)) {
+        if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            oct_rpc_enqueue_reply(b, drt);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
 
-    struct oct_reply_state* drs = NULL;
+static void do_get(struct octopus_binding *b, struct oct_reply_state* drs,
+        char *query, octopus_trigger_t trigger)
+{
+    errval_t err = SYS_ERR_OK;
     struct ast_object* ast = NULL;
-    err = new_oct_reply_state(&drs, get_reply);
-    assert(err_is_ok(err));
 
     err = check_query_length(query);
     if (err_is_fail(err)) {
@@ -241,6 +258,26 @@ out:
     free(query);
 }
 
+void get_handler(struct octopus_binding *b, char *query, octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, get_reply);
+    assert(err_is_ok(err));
+
+    do_get(b, drs, query, trigger);
+}
+
+void get_seq_handler(struct octopus_binding *b, uint64_t seq, char *query,
+        octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, get_seq_reply);
+    assert(err_is_ok(err));
+
+    drs->seq = seq;
+    do_get(b, drs, query, trigger);
+}
+
 static void get_names_reply(struct octopus_binding* b,
         struct oct_reply_state* drt)
 {
@@ -306,18 +343,31 @@ static void set_reply(struct octopus_binding* b, struct oct_reply_state* drs)
     }
 }
 
-void set_handler(struct octopus_binding *b, char *query, uint64_t mode,
-        octopus_trigger_t trigger, bool get)
+static void set_seq_reply(struct octopus_binding* b,
+        struct oct_reply_state* drs)
+{
+    char* record = err_is_ok(drs->error) && drs->return_record ?
+            drs->query_state.std_out.buffer : NULL;
+
+    errval_t err;
+    err = b->tx_vtbl.set_seq_response(b, MKCONT(free_oct_reply_state, drs),
+            drs->seq, record, drs->server_id, drs->error);
+    if (err_is_fail(err)) {
+        if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            oct_rpc_enqueue_reply(b, drs);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
+
+static void do_set(struct octopus_binding *b, struct oct_reply_state* drs,
+        char *query, uint64_t mode, octopus_trigger_t trigger, bool get)
 {
     OCT_DEBUG(" set_handler: %s\n", query);
     errval_t err = SYS_ERR_OK;
-
-    struct oct_reply_state* drs = NULL;
     struct ast_object* ast = NULL;
 
-    err = new_oct_reply_state(&drs, set_reply);
-    assert(err_is_ok(err));
-
     err = check_query_length(query);
     if (err_is_fail(err)) {
         goto out;
@@ -347,6 +397,27 @@ out:
     free(query);
 }
 
+void set_handler(struct octopus_binding *b, char *query, uint64_t mode,
+        octopus_trigger_t trigger, bool get)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, set_reply);
+    assert(err_is_ok(err));
+
+    do_set(b, drs, query, mode, trigger, get);
+}
+
+void set_seq_handler(struct octopus_binding *b, uint64_t seq, char *query,
+        uint64_t mode, octopus_trigger_t trigger, bool get)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, set_seq_reply);
+    assert(err_is_ok(err));
+
+    drs->seq = seq;
+    do_set(b, drs, query, mode, trigger, get);
+}
+
 static errval_t build_query_with_idcap(char **query_p, struct capref idcap,
                                        char *attributes)
 {
@@ -515,17 +586,28 @@ static void del_reply(struct octopus_binding* b, struct oct_reply_state* drs)
     }
 }
 
-void del_handler(struct octopus_binding* b, char* query, octopus_trigger_t trigger)
+static void del_seq_reply(struct octopus_binding* b,
+        struct oct_reply_state* drs)
+{
+    errval_t err;
+    err = b->tx_vtbl.del_seq_response(b, MKCONT(free_oct_reply_state, drs),
+            drs->seq, drs->server_id, drs->error);
+    if (err_is_fail(err)) {
+        if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            oct_rpc_enqueue_reply(b, drs);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
+
+static void do_del(struct octopus_binding* b, struct oct_reply_state* drs,
+        char* query, octopus_trigger_t trigger)
 {
     OCT_DEBUG(" del_handler: %s\n", query);
     errval_t err = SYS_ERR_OK;
-
-    struct oct_reply_state* drs = NULL;
     struct ast_object* ast = NULL;
 
-    err = new_oct_reply_state(&drs, del_reply);
-    assert(err_is_ok(err));
-
     err = check_query_length(query);
     if (err_is_fail(err)) {
         goto out;
@@ -553,6 +635,26 @@ out:
     free(query);
 }
 
+void del_handler(struct octopus_binding* b, char* query, octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, del_reply);
+    assert(err_is_ok(err));
+
+    do_del(b, drs, query, trigger);
+}
+
+void del_seq_handler(struct octopus_binding* b, uint64_t seq, char* query,
+        octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, del_seq_reply);
+    assert(err_is_ok(err));
+
+    drs->seq = seq;
+    do_del(b, drs, query, trigger);
+}
+
 static void exists_reply(struct octopus_binding* b, struct oct_reply_state* drs)
 {
     errval_t err;
@@ -568,16 +670,27 @@ static void exists_reply(struct octopus_binding* b, struct oct_reply_state* drs)
     }
 }
 
-void exists_handler(struct octopus_binding* b, char* query,
-        octopus_trigger_t trigger)
+static void exists_seq_reply(struct octopus_binding* b,
+        struct oct_reply_state* drs)
 {
-    errval_t err = SYS_ERR_OK;
+    errval_t err;
+    err = b->tx_vtbl.exists_seq_response(b, MKCONT(free_oct_reply_state, drs),
+            drs->seq, drs->server_id, drs->error);
 
-    struct oct_reply_state* drs = NULL;
-    struct ast_object* ast = NULL;
+    if (err_is_fail(err)) {
+        if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            oct_rpc_enqueue_reply(b, drs);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
 
-    err = new_oct_reply_state(&drs, exists_reply);
-    assert(err_is_ok(err));
+static void do_exists(struct octopus_binding* b, struct oct_reply_state* drs,
+        char* query, octopus_trigger_t trigger)
+{
+    errval_t err = SYS_ERR_OK;
+    struct ast_object* ast = NULL;
 
     err = check_query_length(query);
     if (err_is_fail(err)) {
@@ -598,6 +711,27 @@ out:
     free(query);
 }
 
+void exists_handler(struct octopus_binding* b, char* query,
+        octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, exists_reply);
+    assert(err_is_ok(err));
+
+    do_exists(b, drs, query, trigger);
+}
+
+void exists_seq_handler(struct octopus_binding* b, uint64_t seq, char* query,
+        octopus_trigger_t trigger)
+{
+    struct oct_reply_state* drs = NULL;
+    errval_t err = new_oct_reply_state(&drs, exists_seq_reply);
+    assert(err_is_ok(err));
+
+    drs->seq = seq;
+    do_exists(b, drs, query, trigger);
+}
+
 static void wait_for_reply(struct octopus_binding* b, struct oct_reply_state* drs)
 {
     errval_t err;
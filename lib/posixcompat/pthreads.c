@@ -10,9 +10,11 @@
 #include <pthread.h>
 #include <assert.h>
 #include <barrelfish/barrelfish.h>
+#include <barrelfish/deferred.h>
 #include <errno.h>
 #include <string.h>
 #include <signal.h>
+#include <sys/time.h>
 
 #include <posixcompat.h> // for pthread_placement stuff
 
@@ -40,6 +42,7 @@ struct pthread_mutex {
 
 struct pthread_cond {
     struct thread_cond cond;
+    volatile uint32_t seq;      ///< incremented on every signal and broadcast
 };
 
 #define PTHREADS_RWLOCK_MAGIC 0xdeadbeef
@@ -211,33 +214,86 @@ int pthread_attr_destroy(pthread_attr_t *attr)
     return 0;
 }
 
-static struct thread_mutex mutex_mutex = THREAD_MUTEX_INITIALIZER;
+/// Spin iterations before blocking on a contended mutex
+#define PTHREAD_MUTEX_SPINS             100
+/// Spin iterations before blocking on a contended PTHREAD_MUTEX_ADAPTIVE_NP mutex
+#define PTHREAD_MUTEX_ADAPTIVE_SPINS    1000
+/// Spin iterations before blocking at a barrier
+#define PTHREAD_BARRIER_SPINS           1000
+/// Yields before a timed condition wait starts to sleep
+#define PTHREAD_COND_YIELDS             16
+/// Maximum sleep between polls of a timed condition wait, in microseconds
+#define PTHREAD_COND_MAX_SLEEP_US       1000
 
-int pthread_mutex_init(pthread_mutex_t *mutex,
-                       const pthread_mutexattr_t *attr)
+static struct pthread_mutex *mutex_alloc(const struct pthread_mutex_attr *attrs)
 {
-    // XXX: Attributes ignored.
-    *mutex = malloc(sizeof(struct pthread_mutex));
-    if(*mutex == NULL) {
-        return -1;
+    struct pthread_mutex *m = malloc(sizeof(struct pthread_mutex));
+    if (m == NULL) {
+        return NULL;
     }
 
-    thread_mutex_init(&(*mutex)->mutex);
-    (*mutex)->locked = 0;
+    thread_mutex_init(&m->mutex);
+    m->locked = 0;
+    m->attrs = *attrs;
+    return m;
+}
+
+/**
+ * \brief Returns the mutex, initialising statically initialised ones
+ *
+ * Statically initialised mutexes are allocated on first use. Threads racing
+ * to do so install their mutex with a compare-and-swap, and the losers free
+ * theirs again, so that no global lock is taken on the fast path.
+ */
+static struct pthread_mutex *mutex_get(pthread_mutex_t *mutex)
+{
+    pthread_mutex_t init = *mutex;
+    if (init != PTHREAD_MUTEX_INITIALIZER
+        && init != PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP) {
+        return init;
+    }
+
+    struct pthread_mutex_attr attrs = {
+        .pshared = PTHREAD_PROCESS_PRIVATE,
+        .kind = (init == PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+                ? PTHREAD_MUTEX_ADAPTIVE_NP : PTHREAD_MUTEX_NORMAL,
+        .robustness = 0,
+    };
+    struct pthread_mutex *m = mutex_alloc(&attrs);
+    if (m == NULL) {
+        return NULL;
+    }
+
+    if (!__sync_bool_compare_and_swap(mutex, init, m)) {
+        free(m);
+    }
+    return *mutex;
+}
+
+int pthread_mutex_init(pthread_mutex_t *mutex,
+                       const pthread_mutexattr_t *attr)
+{
+    struct pthread_mutex_attr attrs = {
+        .pshared = PTHREAD_PROCESS_PRIVATE,
+        .kind = PTHREAD_MUTEX_NORMAL,
+        .robustness = 0,
+    };
     if (attr && *attr) {
         POSIXCOMPAT_DEBUG("kind = %u\n", (*attr)->kind);
-        memcpy(&(*mutex)->attrs, *attr, sizeof(struct pthread_mutex_attr));
-    } else {
-        (*mutex)->attrs.kind = PTHREAD_MUTEX_NORMAL;
-        (*mutex)->attrs.robustness = 0;
-        (*mutex)->attrs.pshared = PTHREAD_PROCESS_PRIVATE;
+        attrs = **attr;
+    }
+
+    *mutex = mutex_alloc(&attrs);
+    if(*mutex == NULL) {
+        return -1;
     }
     return  0;
 }
 
 int pthread_mutex_destroy(pthread_mutex_t *mutex)
 {
-    if(*mutex != PTHREAD_MUTEX_INITIALIZER) {
+    if(*mutex != PTHREAD_MUTEX_INITIALIZER
+       && *mutex != PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP) {
         free(*mutex);
     }
 
@@ -246,60 +302,57 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex)
 
 int pthread_mutex_lock(pthread_mutex_t *mutex)
 {
-    thread_mutex_lock(&mutex_mutex);
-
-    if(*mutex == PTHREAD_MUTEX_INITIALIZER) {
-        pthread_mutex_init(mutex, NULL);
+    struct pthread_mutex *m = mutex_get(mutex);
+    if (m == NULL) {
+        return ENOMEM;
     }
 
-    (*mutex)->locked++;
-    thread_mutex_unlock(&mutex_mutex);
-    if ((*mutex)->attrs.kind == PTHREAD_MUTEX_RECURSIVE) {
-        thread_mutex_lock_nested(&(*mutex)->mutex);
-    } else {
-        thread_mutex_lock(&(*mutex)->mutex);
+    switch (m->attrs.kind) {
+    case PTHREAD_MUTEX_RECURSIVE:
+        thread_mutex_lock_nested(&m->mutex);
+        break;
+    case PTHREAD_MUTEX_ADAPTIVE_NP:
+        thread_mutex_lock_spin(&m->mutex, PTHREAD_MUTEX_ADAPTIVE_SPINS);
+        break;
+    default:
+        thread_mutex_lock_spin(&m->mutex, PTHREAD_MUTEX_SPINS);
+        break;
     }
+
+    // only the holder updates the lock count
+    m->locked++;
     return 0;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex)
 {
-    thread_mutex_lock(&mutex_mutex);
-
-    if(*mutex == PTHREAD_MUTEX_INITIALIZER) {
-        pthread_mutex_init(mutex, NULL);
+    struct pthread_mutex *m = mutex_get(mutex);
+    if (m == NULL) {
+        return ENOMEM;
     }
 
-    if((*mutex)->locked == 0) {
-        thread_mutex_unlock(&mutex_mutex);
+    if(m->locked == 0) {
         return 0;
     }
 
-    (*mutex)->locked--;
-    thread_mutex_unlock(&mutex_mutex);
-    thread_mutex_unlock(&(*mutex)->mutex);
+    m->locked--;
+    thread_mutex_unlock(&m->mutex);
     return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t *mutex)
 {
-    thread_mutex_lock(&mutex_mutex);
-
-    if(*mutex == PTHREAD_MUTEX_INITIALIZER) {
-        pthread_mutex_init(mutex, NULL);
+    struct pthread_mutex *m = mutex_get(mutex);
+    if (m == NULL) {
+        return ENOMEM;
     }
 
-    thread_mutex_unlock(&mutex_mutex);
-
-    int retval = (thread_mutex_trylock(&(*mutex)->mutex) ? 0 : EBUSY);
-
-    if(retval != EBUSY) {
-        thread_mutex_lock(&mutex_mutex);
-        (*mutex)->locked++;
-        thread_mutex_unlock(&mutex_mutex);
+    if (!thread_mutex_trylock(&m->mutex)) {
+        return EBUSY;
     }
 
-    return retval;
+    m->locked++;
+    return 0;
 }
 
 int pthread_cond_init(pthread_cond_t *cond,
@@ -311,63 +364,132 @@ int pthread_cond_init(pthread_cond_t *cond,
     }
 
     thread_cond_init(&(*cond)->cond);
+    (*cond)->seq = 0;
     return 0;
 }
 
+/**
+ * \brief Returns the condition variable, initialising static ones on first use
+ */
+static struct pthread_cond *cond_get(pthread_cond_t *cond)
+{
+    if (*cond != PTHREAD_COND_INITIALIZER) {
+        return *cond;
+    }
+
+    pthread_cond_t c;
+    if (pthread_cond_init(&c, NULL) != 0) {
+        return NULL;
+    }
+
+    if (!__sync_bool_compare_and_swap(cond, PTHREAD_COND_INITIALIZER, c)) {
+        free(c);
+    }
+    return *cond;
+}
+
 int pthread_cond_signal(pthread_cond_t *cond)
 {
-    thread_mutex_lock(&mutex_mutex);
-    if(*cond == PTHREAD_COND_INITIALIZER) {
-        pthread_cond_init(cond, NULL);
+    struct pthread_cond *c = cond_get(cond);
+    if (c == NULL) {
+        return ENOMEM;
     }
-    thread_mutex_unlock(&mutex_mutex);
 
-    thread_cond_signal(&(*cond)->cond);
+    __sync_fetch_and_add(&c->seq, 1);
+    thread_cond_signal(&c->cond);
     return 0;
 }
 
+/// Returns the current time of day in microseconds
+static uint64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * \brief Waits for a condition variable with a timeout
+ *
+ * A waiter cannot be on the queue of the condition variable and on the waitset
+ * of a timer at the same time, so timed waiters do not queue. Instead, they
+ * watch the signal sequence number of the condition variable, first yielding
+ * and then sleeping with exponential backoff on a deferred event until the
+ * deadline. Every signal or broadcast wakes all timed waiters, which POSIX
+ * permits as spurious wakeups.
+ */
 int pthread_cond_timedwait(pthread_cond_t *cond,
                            pthread_mutex_t *mutex,
                            const struct timespec *timeout)
 {
-    thread_mutex_lock(&mutex_mutex);
-    if(*cond == PTHREAD_COND_INITIALIZER) {
-        pthread_cond_init(cond, NULL);
+    struct pthread_cond *c = cond_get(cond);
+    struct pthread_mutex *m = mutex_get(mutex);
+    if (c == NULL || m == NULL) {
+        return ENOMEM;
     }
-    if(*mutex == PTHREAD_MUTEX_INITIALIZER) {
-        pthread_mutex_init(mutex, NULL);
+
+    if (timeout->tv_nsec < 0 || timeout->tv_nsec >= 1000000000) {
+        return EINVAL;
     }
-    thread_mutex_unlock(&mutex_mutex);
+    uint64_t deadline = (uint64_t)timeout->tv_sec * 1000000
+                        + timeout->tv_nsec / 1000;
 
-    assert(!"NYI");
-    return -1;
+    // read under the mutex, so no signal after the unlock is missed
+    uint32_t seq = c->seq;
+    thread_mutex_unlock(&m->mutex);
+
+    int retval = 0;
+    delayus_t delay = 1;
+    for (int i = 0; c->seq == seq; i++) {
+        uint64_t now = now_us();
+        if (now >= deadline) {
+            retval = ETIMEDOUT;
+            break;
+        }
+
+        if (i < PTHREAD_COND_YIELDS) {
+            thread_yield();
+            continue;
+        }
+
+        if (delay > deadline - now) {
+            delay = deadline - now;
+        }
+        errval_t err = barrelfish_usleep(delay);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "barrelfish_usleep in pthread_cond_timedwait");
+            thread_yield();
+        }
+        if (delay < PTHREAD_COND_MAX_SLEEP_US) {
+            delay *= 2;
+        }
+    }
+
+    thread_mutex_lock(&m->mutex);
+    return retval;
 }
 
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
-    thread_mutex_lock(&mutex_mutex);
-    if(*cond == PTHREAD_COND_INITIALIZER) {
-        pthread_cond_init(cond, NULL);
-    }
-    if(*mutex == PTHREAD_MUTEX_INITIALIZER) {
-        pthread_mutex_init(mutex, NULL);
+    struct pthread_cond *c = cond_get(cond);
+    struct pthread_mutex *m = mutex_get(mutex);
+    if (c == NULL || m == NULL) {
+        return ENOMEM;
     }
-    thread_mutex_unlock(&mutex_mutex);
 
-    thread_cond_wait(&(*cond)->cond, &(*mutex)->mutex);
+    thread_cond_wait(&c->cond, &m->mutex);
     return 0;
 }
 
 int pthread_cond_broadcast(pthread_cond_t *cond)
 {
-    thread_mutex_lock(&mutex_mutex);
-
-    if(*cond == PTHREAD_COND_INITIALIZER) {
-         pthread_cond_init(cond, NULL);
+    struct pthread_cond *c = cond_get(cond);
+    if (c == NULL) {
+        return ENOMEM;
     }
-    thread_mutex_unlock(&mutex_mutex);
 
-    thread_cond_broadcast(&(*cond)->cond);
+    __sync_fetch_and_add(&c->seq, 1);
+    thread_cond_broadcast(&c->cond);
 
     return 0;
 }
@@ -549,41 +671,51 @@ int pthread_barrier_init(pthread_barrier_t *barrier,
 			const pthread_barrierattr_t *attr,
 			unsigned max_count)
 {
-	barrier->count = 0;
+	if (max_count == 0) {
+		return EINVAL;
+	}
+
+	barrier->count = max_count;
 	barrier->max_count = max_count;
+	barrier->sense = 0;
 
-	thread_sem_init(&barrier->mutex, 1);
-	thread_sem_init(&barrier->barrier, 0);
-	thread_sem_init(&barrier->reset, 1);
+	thread_mutex_init(&barrier->mutex);
+	thread_cond_init(&barrier->cond);
 
 	return 0;
 }
 
+/*
+ * Sense-reversing barrier: each arriving thread decrements the count, and the
+ * last one resets it and flips the sense, which releases the others. They spin
+ * on the sense for a while and then block on the condition variable, which the
+ * last thread broadcasts under the mutex so that no wakeup is lost.
+ */
 int pthread_barrier_wait(pthread_barrier_t *barrier)
 {
-	// waiting at the barrier
-	thread_sem_wait(&barrier->mutex);
-	barrier->count++;
-	if (barrier->count == barrier->max_count) {
-		thread_sem_wait(&barrier->reset);
-		thread_sem_post(&barrier->barrier);
-	}
-	thread_sem_post(&barrier->mutex);
+	int sense = !barrier->sense;
 
-	thread_sem_wait(&barrier->barrier);
-	thread_sem_post(&barrier->barrier);
+	if (__sync_sub_and_fetch(&barrier->count, 1) == 0) {
+		barrier->count = barrier->max_count;
+		thread_mutex_lock(&barrier->mutex);
+		__sync_synchronize();
+		barrier->sense = sense;
+		thread_cond_broadcast(&barrier->cond);
+		thread_mutex_unlock(&barrier->mutex);
+		return PTHREAD_BARRIER_SERIAL_THREAD;
+	}
 
-	// reseting the barrier to be reused further
-	thread_sem_wait(&barrier->mutex);
-	barrier->count--;
-	if (barrier->count == 0) {
-		thread_sem_wait(&barrier->barrier);
-		thread_sem_post(&barrier->reset);
+	for (int i = 0; i < PTHREAD_BARRIER_SPINS; i++) {
+		if (barrier->sense == sense) {
+			return 0;
+		}
 	}
-	thread_sem_post(&barrier->mutex);
 
-	thread_sem_wait(&barrier->reset);
-	thread_sem_post(&barrier->reset);
+	thread_mutex_lock(&barrier->mutex);
+	while (barrier->sense != sense) {
+		thread_cond_wait(&barrier->cond, &barrier->mutex);
+	}
+	thread_mutex_unlock(&barrier->mutex);
 
 	return 0;
 }
@@ -18,6 +18,7 @@
 #include <skb/skb.h>
 #include <if/skb_rpcclient_defs.h>
 #include <barrelfish/core_state_arch.h>
+#include "skb_internal.h"
 
 /* ------------------------- Connecting to skb ------------------------------ */
 
@@ -80,6 +81,9 @@ errval_t skb_evaluate(char *query, char **result, char **str_error, int32_t *int
     errval_t err;
     struct skb_state *skb_state = get_skb_state();
 
+    // queries have to see the facts added before them
+    skb_flush_facts_before_goal();
+
     err = skb_state->skb->vtbl.run(skb_state->skb, query, result, str_error,
                                    int_error);
     if (err_is_fail(err)) {
@@ -87,3 +91,60 @@ errval_t skb_evaluate(char *query, char **result, char **str_error, int32_t *int
     }
     return SYS_ERR_OK;
 }
+
+/**
+ * \brief Asserts a batch of facts in one call.
+ *
+ * \param facts Facts separated by newlines, without the terminating '.'.
+ */
+errval_t skb_evaluate_facts(char *facts, char **str_error, int32_t *int_error)
+{
+    errval_t err;
+    struct skb_state *skb_state = get_skb_state();
+
+    err = skb_state->skb->vtbl.add_facts(skb_state->skb, facts, str_error,
+                                         int_error);
+    if (err_is_fail(err)) {
+        return err_push(err, SKB_ERR_RUN);
+    }
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Evaluates a goal template which the SKB compiles once and caches.
+ *
+ * \param goal Goal whose parameters are the variables Arg1..ArgN.
+ * \param args Comma-separated terms bound to Arg1..ArgN.
+ */
+errval_t skb_evaluate_cached(char *goal, char *args, char **result,
+                             char **str_error, int32_t *int_error)
+{
+    errval_t err;
+    struct skb_state *skb_state = get_skb_state();
+
+    skb_flush_facts_before_goal();
+
+    err = skb_state->skb->vtbl.run_cached(skb_state->skb, goal, args, result,
+                                          str_error, int_error);
+    if (err_is_fail(err)) {
+        return err_push(err, SKB_ERR_RUN);
+    }
+    return SYS_ERR_OK;
+}
+
+errval_t skb_get_stats(struct skb_stats *stats)
+{
+    errval_t err;
+    struct skb_state *skb_state = get_skb_state();
+
+    skb_flush_facts_before_goal();
+
+    err = skb_state->skb->vtbl.get_stats(skb_state->skb, &stats->queries,
+                                         &stats->facts, &stats->fact_batches,
+                                         &stats->cache_hits,
+                                         &stats->cache_misses, &stats->cycles);
+    if (err_is_fail(err)) {
+        return err_push(err, SKB_ERR_RUN);
+    }
+    return SYS_ERR_OK;
+}
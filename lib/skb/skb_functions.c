@@ -17,6 +17,7 @@
 #include <barrelfish/barrelfish.h>
 #include <skb/skb.h>
 #include "skb_debug.h"
+#include "skb_internal.h"
 
 #define BUFFER_SIZE SKB_REPLY_BUF_SIZE
 #define OUTPUT_SIZE SKB_REPLY_BUF_SIZE
@@ -29,6 +30,12 @@ static char output[OUTPUT_SIZE];
 static char error_output[OUTPUT_SIZE];
 static int error_code;
 
+// Facts added by skb_add_fact_batched() and not yet sent
+static char fact_batch[SKB_FACT_BATCH_SIZE];
+static size_t fact_batch_len;
+// First error of a batch sent before a goal, not yet reported
+static errval_t fact_batch_err = SYS_ERR_OK;
+
 int skb_read_error_code(void)
 {
     return error_code;
@@ -90,6 +97,104 @@ errval_t skb_add_fact(char *fmt, ...)
     return err;
 }
 
+/**
+ * \brief Adds a fact to the SKB, batched with other facts.
+ *
+ * The fact is sent with the facts added before and after it once the batch
+ * is full, skb_flush_facts() is called, or any goal is run on the SKB.
+ * Errors asserting the fact are therefore returned by a later call to
+ * skb_add_fact_batched() or skb_flush_facts(); goals run regardless.
+ */
+errval_t skb_add_fact_batched(char *fmt, ...)
+{
+    va_list va_l;
+    va_start(va_l, fmt);
+    int len = vsnprintf(buffer, BUFFER_SIZE, fmt, va_l);
+    va_end(va_l);
+
+    if (len >= SKB_FACT_BATCH_SIZE) {
+        return SKB_ERR_OVERFLOW;
+    }
+
+    if (len > 0 && buffer[len - 1] == '.') {
+        len--;
+    }
+
+    SKB_DEBUG("skb_add_fact_batched(): %s\n", buffer);
+    // one byte for the separator or terminator
+    if (fact_batch_len + len + 1 > SKB_FACT_BATCH_SIZE) {
+        errval_t err = skb_flush_facts();
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    if (fact_batch_len > 0) {
+        fact_batch[fact_batch_len - 1] = '\n';
+    }
+    memcpy(fact_batch + fact_batch_len, buffer, len);
+    fact_batch_len += len;
+    fact_batch[fact_batch_len++] = '\0';
+
+    return SYS_ERR_OK;
+}
+
+static errval_t send_fact_batch(void)
+{
+    if (fact_batch_len == 0) {
+        return SYS_ERR_OK;
+    }
+    fact_batch_len = 0;
+
+    int32_t error;
+    char *error_out;
+    errval_t err = skb_evaluate_facts(fact_batch, &error_out, &error);
+    if (err_is_fail(err)) {
+        return err_push(err, SKB_ERR_EVALUATE);
+    }
+    error_code = error;
+    output[0] = '\0';
+    strncpy(error_output, error_out, OUTPUT_SIZE);
+    free(error_out);
+    if (error != 0) {
+        return SKB_ERR_EXECUTION;
+    }
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Sends the facts added by skb_add_fact_batched() to the SKB.
+ *
+ * \returns The error of the first fact that failed since the last call,
+ * including facts sent before a goal ran. A failing fact does not keep the
+ * other facts of its batch from being asserted.
+ */
+errval_t skb_flush_facts(void)
+{
+    errval_t err = send_fact_batch();
+    if (err_is_ok(err)) {
+        err = fact_batch_err;
+    }
+    fact_batch_err = SYS_ERR_OK;
+    return err;
+}
+
+/**
+ * \brief Sends the pending facts before a goal runs, so it sees them.
+ *
+ * Errors are kept for the next skb_flush_facts() instead of failing the goal.
+ */
+void skb_flush_facts_before_goal(void)
+{
+    errval_t err = send_fact_batch();
+    if (err_is_fail(err)) {
+        SKB_DEBUG("sending facts before goal failed: %s\n", error_output);
+        if (err_is_ok(fact_batch_err)) {
+            fact_batch_err = err;
+        }
+    }
+}
+
 errval_t skb_execute_query(char *fmt, ...)
 {
     va_list va_l;
@@ -108,6 +213,45 @@ errval_t skb_execute_query(char *fmt, ...)
     return skb_execute(buffer);
 }
 
+/**
+ * \brief Runs a goal template which the SKB compiles on first use.
+ *
+ * The parameters of the template are the variables Arg1..ArgN; fmt formats
+ * the comma-separated terms bound to them. Results are read with
+ * skb_read_output() as for skb_execute_query(). For example:
+ *
+ *   skb_execute_cached("pci_get_bar(Arg1, Arg2, B), write(B)", "%d, %d",
+ *                      bus, dev);
+ */
+errval_t skb_execute_cached(char *goal, char *fmt, ...)
+{
+    va_list va_l;
+    va_start(va_l, fmt);
+    int len = vsnprintf(buffer, BUFFER_SIZE, fmt, va_l);
+    va_end(va_l);
+
+    if (len >= BUFFER_SIZE) {
+        return SKB_ERR_OVERFLOW;
+    }
+
+    int32_t error;
+    char *result, *error_out;
+    errval_t err = skb_evaluate_cached(goal, buffer, &result, &error_out,
+                                       &error);
+    if (err_is_fail(err)) {
+        return err_push(err, SKB_ERR_EVALUATE);
+    }
+    error_code = error;
+    strncpy(output, result, OUTPUT_SIZE);
+    strncpy(error_output, error_out, OUTPUT_SIZE);
+    free(result);
+    free(error_out);
+    if (error != 0) {
+        return err_push(err, SKB_ERR_EXECUTION);
+    }
+    return err;
+}
+
 static inline int count_expected_conversions(char *s, int len)
 {
     int expected_conversions = 0;
@@ -0,0 +1,20 @@
+/**
+ * \file
+ * \brief Functions shared between the files of the SKB client library
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef SKB_INTERNAL_H_
+#define SKB_INTERNAL_H_
+
+void skb_flush_facts_before_goal(void);
+
+#endif // SKB_INTERNAL_H_
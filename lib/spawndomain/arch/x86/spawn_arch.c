@@ -52,13 +52,19 @@ static vregion_flags_t elf_to_vregion_flags(uint32_t flags)
     return vregion_flags;
 }
 
-static errval_t elf_allocate(void *state, genvaddr_t base, size_t size,
-                             uint32_t flags, void **retbase)
+/**
+ * \brief Allocate a segment and map it into both vspaces
+ *
+ * If shared is given, the frames of the cached segment are mapped instead of
+ * allocating new ones.
+ */
+static errval_t allocate_segment(struct spawninfo *si, genvaddr_t base,
+                                 size_t size, uint32_t flags,
+                                 struct spawn_image_segment *shared,
+                                 void **retbase)
 {
     errval_t err;
 
-    struct spawninfo *si = state;
-
     // Increase size by space wasted on first page due to page-alignment
     size_t base_offset = BASE_PAGE_OFFSET(base);
     size += base_offset;
@@ -69,17 +75,29 @@ static errval_t elf_allocate(void *state, genvaddr_t base, size_t size,
     cslot_t vspace_slot = si->elfload_slot;
     cslot_t spawn_vspace_slot = si->elfload_slot;
 
+    assert(si->vregions < ARRAY_LENGTH(si->vregion));
+    si->segflags[si->vregions] = flags;
+    si->segslot[si->vregions] = si->elfload_slot;
+
     // Allocate the frames
-    size_t sz = 0;
+    size_t sz = 0, nframes = 0;
     for (lpaddr_t offset = 0; offset < size; offset += sz) {
         sz = 1UL << log2floor(size - offset);
         struct capref frame = {
             .cnode = si->segcn,
             .slot  = si->elfload_slot++,
         };
-        err = frame_create(frame, sz, NULL);
-        if (err_is_fail(err)) {
-            return err_push(err, LIB_ERR_FRAME_CREATE);
+        if (shared != NULL) {
+            assert(nframes < shared->nframes);
+            err = cap_copy(frame, shared->frames[nframes++]);
+            if (err_is_fail(err)) {
+                return err_push(err, LIB_ERR_CAP_COPY);
+            }
+        } else {
+            err = frame_create(frame, sz, NULL);
+            if (err_is_fail(err)) {
+                return err_push(err, LIB_ERR_FRAME_CREATE);
+            }
         }
     }
 
@@ -155,6 +173,12 @@ static errval_t elf_allocate(void *state, genvaddr_t base, size_t size,
     return SYS_ERR_OK;
 }
 
+static errval_t elf_allocate(void *state, genvaddr_t base, size_t size,
+                             uint32_t flags, void **retbase)
+{
+    return allocate_segment(state, base, size, flags, NULL, retbase);
+}
+
 static errval_t spawn_parse_omp_functions(const char *name,
                                           lvaddr_t binary, size_t binary_size)
 {
@@ -271,6 +295,64 @@ errval_t spawn_arch_load(struct spawninfo *si,
     return SYS_ERR_OK;
 }
 
+/**
+ * \brief Load an image from the segments cached by an earlier load
+ *
+ * Read-only segments are mapped from the cached frames. Writable segments
+ * get new frames, initialised with the relocated contents from the cache.
+ */
+errval_t spawn_arch_load_cached(struct spawninfo *si, struct spawn_image *img,
+                                genvaddr_t *entry, void **arch_load_info)
+{
+    errval_t err;
+
+    assert(img->cached);
+
+    // Reset the elfloader_slot
+    si->elfload_slot = 0;
+    si->vregions = 0;
+
+    struct capref cnode_cap = {
+        .cnode = si->rootcn,
+        .slot  = ROOTCN_SLOT_SEGCN,
+    };
+    err = cnode_create_raw(cnode_cap, &si->segcn, DEFAULT_CNODE_SLOTS, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, SPAWN_ERR_CREATE_SEGCN);
+    }
+
+    for (unsigned int i = 0; i < img->nsegs; i++) {
+        struct spawn_image_segment *seg = &img->seg[i];
+        void *dest;
+
+        if (seg->flags & PF_W) {
+            err = allocate_segment(si, seg->base, seg->size, seg->flags, NULL,
+                                   &dest);
+            if (err_is_fail(err)) {
+                return err_push(err, ELF_ERR_ALLOCATE);
+            }
+            memcpy(dest, seg->data, seg->size);
+        } else {
+            err = allocate_segment(si, seg->base, seg->size, seg->flags, seg,
+                                   &dest);
+            if (err_is_fail(err)) {
+                return err_push(err, ELF_ERR_ALLOCATE);
+            }
+        }
+    }
+
+    *entry = img->entry;
+    si->tls_init_base = img->tls_init_base;
+    si->tls_init_len = img->tls_init_len;
+    si->tls_total_len = img->tls_total_len;
+    si->eh_frame = img->eh_frame;
+    si->eh_frame_size = img->eh_frame_size;
+    si->eh_frame_hdr = img->eh_frame_hdr;
+    si->eh_frame_hdr_size = img->eh_frame_hdr_size;
+
+    return SYS_ERR_OK;
+}
+
 void spawn_arch_set_registers(void *arch_load_info,
                               dispatcher_handle_t handle,
                               arch_registers_state_t *enabled_area,
@@ -693,9 +693,50 @@ errval_t spawn_load_image(struct spawninfo *si, lvaddr_t binary,
                           const char *name, coreid_t coreid,
                           char *const argv[], char *const envp[],
                           struct capref inheritcn_cap, struct capref argcn_cap)
+{
+    return spawn_load_image_cached(si, NULL, binary, binary_size, type, name,
+                                   coreid, argv, envp, inheritcn_cap,
+                                   argcn_cap);
+}
+
+/**
+ * \brief Whether spawn_load_image_cached() needs the ELF file for an image
+ */
+bool spawn_image_needs_binary(struct spawn_image *img, uint8_t flags)
+{
+    return img == NULL || !img->cached
+           || ((flags & SPAWN_FLAGS_OMP) && !img->omp_parsed);
+}
+
+/**
+ * \brief Setup a domain from an image, using and filling an image cache
+ *
+ * \param img           Cached image, or NULL. If img has not been filled in
+ *                      yet, the image is loaded from binary as usual and its
+ *                      segments are kept in img. Otherwise, the segments are
+ *                      set up from img, and binary is only needed when
+ *                      spawn_image_needs_binary() says so.
+ *
+ * The other parameters are as for spawn_load_image().
+ */
+errval_t spawn_load_image_cached(struct spawninfo *si,
+                                 struct spawn_image *img, lvaddr_t binary,
+                                 size_t binary_size, enum cpu_type type,
+                                 const char *name, coreid_t coreid,
+                                 char *const argv[], char *const envp[],
+                                 struct capref inheritcn_cap,
+                                 struct capref argcn_cap)
 {
     errval_t err;
 
+#ifndef __x86__ // SK: si->vregions only valid on x86
+    img = NULL;
+#endif
+    // OpenMP functions are registered while parsing the ELF file, so load it
+    // again if this was not done when the image was cached
+    bool use_cache = img != NULL && img->cached
+                     && (img->omp_parsed || !(si->flags & SPAWN_FLAGS_OMP));
+
     si->cpu_type = type;
 
     /* Initialize cspace */
@@ -712,13 +753,32 @@ errval_t spawn_load_image(struct spawninfo *si, lvaddr_t binary,
 
     si->name = name;
     genvaddr_t entry;
-    void* arch_info;
+    void* arch_info = NULL;
     /* Load the image */
-    err = spawn_arch_load(si, binary, binary_size, &entry, &arch_info);
+#ifdef __x86__
+    if (use_cache) {
+        err = spawn_arch_load_cached(si, img, &entry, &arch_info);
+    } else
+#endif
+    {
+        assert(binary != 0);
+        err = spawn_arch_load(si, binary, binary_size, &entry, &arch_info);
+    }
     if (err_is_fail(err)) {
         return err_push(err, SPAWN_ERR_LOAD);
     }
 
+    if (img != NULL && !img->cached) {
+        // the image has not run yet, so its segments are still pristine
+        err = spawn_image_capture(si, img, entry);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "caching image %s", name);
+        }
+    }
+    if (img != NULL && img->cached && (si->flags & SPAWN_FLAGS_OMP)) {
+        img->omp_parsed = true;
+    }
+
     /* Setup dispatcher frame */
     err = spawn_setup_dispatcher(si, coreid, name, entry, arch_info);
     if (err_is_fail(err)) {
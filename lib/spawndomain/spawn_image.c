@@ -0,0 +1,150 @@
+/**
+ * \file
+ * \brief Caching of loaded images for spawning further instances
+ *
+ * After an image has been loaded and relocated for one domain, its segments
+ * are kept so that later domains running the same binary can be set up
+ * without loading the ELF file again. Read-only segments keep the frames of
+ * the first domain and are shared by all later ones; writable segments keep
+ * a copy of their initial contents, which is copied to new frames for every
+ * domain.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <spawndomain/spawndomain.h>
+#include <elf/elf.h>
+
+static errval_t capture_segment(struct spawninfo *si, unsigned int i,
+                                struct spawn_image_segment *seg)
+{
+    errval_t err;
+
+    seg->base = si->base[i];
+    seg->size = vregion_get_size(si->vregion[i]);
+    seg->flags = si->segflags[i];
+    seg->frames = NULL;
+    seg->nframes = 0;
+    seg->data_frame = NULL_CAP;
+    seg->data = NULL;
+
+    if (seg->flags & PF_W) {
+        // the domain will modify its frames, so keep a copy of the contents
+        err = frame_alloc(&seg->data_frame, seg->size, NULL);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_FRAME_ALLOC);
+        }
+        err = vspace_map_one_frame(&seg->data, seg->size, seg->data_frame,
+                                   NULL, NULL);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_VSPACE_MAP);
+        }
+        genvaddr_t local = vregion_get_base_addr(si->vregion[i]);
+        memcpy(seg->data, (void *)vspace_genvaddr_to_lvaddr(local), seg->size);
+        return SYS_ERR_OK;
+    }
+
+    // share the frames of the domain
+    cslot_t end = i + 1 < si->vregions ? si->segslot[i + 1] : si->elfload_slot;
+    seg->nframes = end - si->segslot[i];
+    seg->frames = calloc(seg->nframes, sizeof(struct capref));
+    if (seg->frames == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    for (size_t f = 0; f < seg->nframes; f++) {
+        struct capref src = {
+            .cnode = si->segcn,
+            .slot  = si->segslot[i] + f,
+        };
+        err = slot_alloc(&seg->frames[f]);
+        if (err_is_fail(err)) {
+            return err_push(err, LIB_ERR_SLOT_ALLOC);
+        }
+        err = cap_copy(seg->frames[f], src);
+        if (err_is_fail(err)) {
+            slot_free(seg->frames[f]);
+            seg->frames[f] = NULL_CAP;
+            return err_push(err, LIB_ERR_CAP_COPY);
+        }
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Keep the segments of a domain that has just been loaded
+ *
+ * \param si    The domain, after the image was loaded and before it is run
+ * \param img   The image to fill in
+ * \param entry Entry point of the image
+ */
+errval_t spawn_image_capture(struct spawninfo *si, struct spawn_image *img,
+                             genvaddr_t entry)
+{
+    errval_t err;
+
+    memset(img, 0, sizeof(*img));
+
+    if (si->vregions == 0 || si->vregions > SPAWN_IMAGE_MAX_SEGMENTS) {
+        return SPAWN_ERR_LOAD;
+    }
+
+    for (unsigned int i = 0; i < si->vregions; i++) {
+        img->nsegs++;
+        err = capture_segment(si, i, &img->seg[i]);
+        if (err_is_fail(err)) {
+            spawn_image_free(img);
+            return err;
+        }
+    }
+
+    img->entry = entry;
+    img->tls_init_base = si->tls_init_base;
+    img->tls_init_len = si->tls_init_len;
+    img->tls_total_len = si->tls_total_len;
+    img->eh_frame = si->eh_frame;
+    img->eh_frame_size = si->eh_frame_size;
+    img->eh_frame_hdr = si->eh_frame_hdr;
+    img->eh_frame_hdr_size = si->eh_frame_hdr_size;
+    img->cached = true;
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Free a cached image
+ *
+ * Frames still mapped by running domains stay valid until those exit.
+ */
+void spawn_image_free(struct spawn_image *img)
+{
+    for (unsigned int i = 0; i < img->nsegs; i++) {
+        struct spawn_image_segment *seg = &img->seg[i];
+
+        if (seg->data != NULL) {
+            vspace_unmap(seg->data);
+        }
+        if (!capref_is_null(seg->data_frame)) {
+            cap_destroy(seg->data_frame);
+        }
+        for (size_t f = 0; f < seg->nframes; f++) {
+            if (!capref_is_null(seg->frames[f])) {
+                cap_destroy(seg->frames[f]);
+            }
+        }
+        free(seg->frames);
+    }
+
+    memset(img, 0, sizeof(*img));
+}
@@ -108,6 +108,8 @@ static PTState_t *thc_get_pts_0(void);
 static void thc_set_pts_0(PTState_t *pts);
 
 static inline void thc_schedule_local(awe_t *awe);
+static int thc_has_work(PTState_t *pts);
+static int thc_pool_find_work(PTState_t *pts);
 
 /***********************************************************************/
 
@@ -182,6 +184,8 @@ static void thc_print_pts_stats(PTState_t *t, int clear) {
                           t->sendCount));
   DEBUG_STATS(DEBUGPRINTF(DEBUG_STATS_PREFIX "    message recv   %8d\n",
                           t->recvCount));
+  DEBUG_STATS(DEBUGPRINTF(DEBUG_STATS_PREFIX "    awe stolen     %8d\n",
+                          t->aweStolen));
   DEBUG_STATS(DEBUGPRINTF(DEBUG_STATS_PREFIX "----------------------------------------\n"));
 
   if (clear) {
@@ -203,6 +207,7 @@ static void thc_print_pts_stats(PTState_t *t, int clear) {
     t->cancelsAdded = 0;
     t->cancelsRun = 0;
     t->cancelsRemoved = 0;
+    t->aweStolen = 0;
   }
 
   thc_latch_release(&debug_latch);
@@ -456,6 +461,8 @@ static void thc_init_dispatch_loop(void) {
   pts->aweTail.prev = &(pts->aweHead);
   pts->aweRemoteHead.next = &(pts->aweRemoteTail);
   pts->aweRemoteTail.prev = &(pts->aweRemoteHead);
+  pts->awePoolHead.next = &(pts->awePoolTail);
+  pts->awePoolTail.prev = &(pts->awePoolHead);
 
   DEBUG_INIT(DEBUGPRINTF(DEBUG_INIT_PREFIX
                          "  initialized dispatch awe %p\n",
@@ -643,6 +650,7 @@ void _thc_startfinishblock(finish_t *fb, int fb_kind) {
   fb -> finish_awe = NULL;
   fb->cancel_item = NULL;
   fb->cancel_requested = 0;
+  thc_latch_init(&fb->latch);
   fb->start_node.fb = fb;
   fb->end_node.fb = fb;
   fb->enclosing_lazy_stack = PTS()->curr_lazy_stack;
@@ -702,8 +710,18 @@ static void _thc_endfinishblock0(void *a, void *f) {
   
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "  Waiting f=%p awe=%p\n",
                            fb, a));
+  thc_latch_acquire(&fb->latch);
+  if (fb->count == 0) {
+    // The last async call ended on another thread since we looked
+    thc_latch_release(&fb->latch);
+    DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "  Done meanwhile f=%p\n",
+                             fb));
+    thc_awe_execute_0(awe);
+    NOT_REACHED;
+  }
   assert(fb->finish_awe == NULL);
   fb->finish_awe = a;
+  thc_latch_release(&fb->latch);
   thc_dispatch(awe->pts);
   NOT_REACHED;
 }
@@ -818,7 +836,7 @@ void _thc_startasync(void *f, void *stack) {
   finish_t *fb = (finish_t*)f;
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "> StartAsync(%p,%p)\n",
                            fb, stack));
-  fb->count ++;
+  __sync_fetch_and_add(&fb->count, 1);
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "< StartAsync count now %d\n",
                            (int)fb->count));
 #ifndef NDEBUG
@@ -835,7 +853,16 @@ void _thc_endasync(void *f, void *s) {
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "> EndAsync(%p,%p)\n",
                            fb, s));
   assert(fb->count > 0);
-  fb->count --;
+
+  // Only the last async call takes the finish block's waiting AWE.  The
+  // latch orders this against _thc_endfinishblock0 registering it.
+  awe_t *finish_awe = NULL;
+  thc_latch_acquire(&fb->latch);
+  if (__sync_sub_and_fetch(&fb->count, 1) == 0) {
+    finish_awe = fb->finish_awe;
+    fb->finish_awe = NULL;
+  }
+  thc_latch_release(&fb->latch);
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "  count now %d\n",
                            (int)fb->count));
   assert(pts->pendingFree == NULL);
@@ -850,13 +877,11 @@ void _thc_endasync(void *f, void *s) {
   pts->pendingFree = s;
 #endif // CONFIG_LAZY_THC
 
-  if (fb->count == 0) {
-    if (fb -> finish_awe) {
-      DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "  waiting AWE %p\n",
-                               fb->finish_awe));
-      thc_schedule_local(fb -> finish_awe);
-      fb -> finish_awe = NULL;
-    }
+  if (finish_awe != NULL) {
+    DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "  waiting AWE %p\n",
+                             finish_awe));
+    // The finish block may be waiting on another thread
+    THCSchedule(finish_awe);
   }
 
   DEBUG_FINISH(DEBUGPRINTF(DEBUG_FINISH_PREFIX "< EndAsync\n"));
@@ -1110,6 +1135,118 @@ int THCIsCancelRequested(void) {
   return result;
 }
 
+/**********************************************************************/
+
+// Worker pool
+//
+// AWEs passed to the pool are held on the awePool list of the thread
+// that passed them.  Threads of the pool look for such work when their
+// dispatch loop is idle: first on their own list (most recent first),
+// then on the lists of the other threads (oldest first).  A stolen AWE
+// is re-homed to the thief by updating its pts before it is scheduled.
+
+#define THC_POOL_MAX_THREADS 64
+
+struct thc_pool_thread {
+  PTState_t * volatile pts;
+  awe_t *main_awe;
+  coreid_t core;
+  struct thread *thread;
+};
+
+static struct {
+  volatile int active;
+  volatile int stopping;
+  int nthreads;           // including the thread that started the pool
+  struct thc_pool_thread threads[THC_POOL_MAX_THREADS];
+} thc_pool;
+
+// Does pts have local or remote work which its dispatch loop will run?
+
+static int thc_has_work(PTState_t *pts) {
+  return (pts->aweHead.next != &pts->aweTail ||
+          pts->aweRemoteHead.next != &pts->aweRemoteTail);
+}
+
+static awe_t *thc_pool_take(PTState_t *victim, int oldest) {
+  awe_t *awe = NULL;
+  if (victim->awePoolHead.next == &victim->awePoolTail) {
+    return NULL;
+  }
+  thc_pts_lock(victim);
+  if (victim->awePoolHead.next != &victim->awePoolTail) {
+    awe = oldest ? victim->awePoolTail.prev : victim->awePoolHead.next;
+    awe->prev->next = awe->next;
+    awe->next->prev = awe->prev;
+  }
+  thc_pts_unlock(victim);
+  return awe;
+}
+
+// Index of pts in the pool, or -1 if it is not a thread of the pool
+
+static int thc_pool_index(PTState_t *pts) {
+  for (int i = 0; i < thc_pool.nthreads; i++) {
+    if (thc_pool.threads[i].pts == pts) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Move one AWE passed to the pool onto the run queue of pts.  Returns
+// non-zero if one was found.  Only threads of the pool take pool work.
+
+static int thc_pool_find_work(PTState_t *pts) {
+  int me = thc_pool_index(pts);
+  if (me < 0) {
+    return 0;
+  }
+  awe_t *awe = thc_pool_take(pts, 0);
+  if (awe == NULL) {
+    int n = thc_pool.nthreads;
+    for (int i = 1; i < n && awe == NULL; i++) {
+      PTState_t *victim = thc_pool.threads[(me + i) % n].pts;
+      if (victim != NULL) {
+        awe = thc_pool_take(victim, 1);
+      }
+    }
+    if (awe == NULL) {
+      return 0;
+    }
+#ifndef NDEBUG
+    pts->aweStolen++;
+#endif
+  }
+  DEBUG_AWE(DEBUGPRINTF(DEBUG_AWE_PREFIX "  pool AWE %p to pts %p\n",
+                        awe, pts));
+  awe->pts = pts;
+  thc_schedule_local(awe);
+  return 1;
+}
+
+__attribute__ ((unused))
+static void thc_poolyield_with_cont(void *a, void *arg) {
+  awe_t *awe = (awe_t*)a;
+  PTState_t *pts = awe->pts;
+  awe->lazy_stack = pts->curr_lazy_stack;
+  // check if we have yielded within a lazy awe
+  check_for_lazy_awe(awe->ebp);
+  thc_pts_lock(pts);
+  awe->prev = &(pts->awePoolHead);
+  awe->next = pts->awePoolHead.next;
+  pts->awePoolHead.next->prev = awe;
+  pts->awePoolHead.next = awe;
+  thc_pts_unlock(pts);
+  thc_dispatch(pts);
+}
+
+void THCPoolYield(void) {
+  if (thc_pool.active && thc_pool_index(PTS()) >= 0) {
+    CALL_CONT_LAZY((void*)&thc_poolyield_with_cont, NULL);
+  }
+}
+
 #if 0
 int THCRun(THCFn_t fn,
            void *args,
@@ -1138,8 +1275,24 @@ static void IdleFn(void *arg) {
   PTState_t *pts = PTS();
 
   while (!pts->shouldExit) {
-    // Block for the next event to occur
-    errval_t err = event_dispatch(ws);
+    errval_t err;
+    if (thc_pool.active && thc_pool_index(pts) >= 0) {
+      // Work from other threads of the pool does not raise an event on
+      // our waitset, so poll rather than block
+      if (thc_pool_find_work(pts)) {
+        break;
+      }
+      err = event_dispatch_non_block(ws);
+      if (err_no(err) == LIB_ERR_NO_EVENT) {
+        if (!thc_has_work(pts)) {
+          thread_yield();
+        }
+        err = SYS_ERR_OK;
+      }
+    } else {
+      // Block for the next event to occur
+      err = event_dispatch(ws);
+    }
     if (err_is_fail(err)) {
       assert(0 && "event_dispatch failed in THC idle function");
       abort();
@@ -1153,13 +1306,153 @@ static void IdleFn(void *arg) {
     } 
 
     // Yield while some real work is now available
-    while (pts->aweHead.next != &pts->aweTail &&
+    while (thc_has_work(pts) &&
            !pts->shouldExit) {
       THCYield();
     }
   }
 }
 
+// Idle function of the worker threads: run work of the pool, serve the
+// dispatcher's default waitset, and resume the thread's main AWE once
+// the pool stops.
+
+static void thc_pool_idle_fn(void *arg) {
+  struct thc_pool_thread *t = (struct thc_pool_thread *)arg;
+  struct waitset *ws = get_default_waitset();
+  PTState_t *pts = PTS();
+
+  while (!thc_has_work(pts)) {
+    if (thc_pool_find_work(pts)) {
+      break;
+    }
+    if (thc_pool.stopping && t->main_awe != NULL) {
+      awe_t *awe = t->main_awe;
+      t->main_awe = NULL;
+      THCSchedule(awe);
+      break;
+    }
+    errval_t err = event_dispatch_non_block(ws);
+    if (err_no(err) == LIB_ERR_NO_EVENT) {
+      thread_yield();
+    } else if (err_is_fail(err)) {
+      assert(0 && "event_dispatch failed in THC pool idle function");
+      abort();
+    }
+  }
+}
+
+static int thc_pool_thread_main(void *arg) {
+  struct thc_pool_thread *t = (struct thc_pool_thread *)arg;
+
+  thc_start_rts();
+  PTS()->idle_fn = thc_pool_idle_fn;
+  PTS()->idle_args = t;
+  PTS()->idle_stack = NULL;
+  __sync_synchronize();
+  t->pts = PTS();
+
+  // Run the dispatch loop until the pool stops
+  THCSuspend(&t->main_awe);
+
+  thc_end_rts();
+  return 0;
+}
+
+static void thc_pool_span_cb(void *arg, errval_t err) {
+  *((errval_t *)arg) = err;
+}
+
+// Create the worker thread t on core, spanning the domain to the core
+// if it has no dispatcher there yet
+
+static errval_t thc_pool_create_worker(struct thc_pool_thread *t,
+                                       coreid_t core) {
+  errval_t err;
+
+  t->core = core;
+  err = domain_thread_create_on(core, thc_pool_thread_main, t, &t->thread);
+  if (err_no(err) != LIB_ERR_NO_SPANNED_DISP) {
+    return err;
+  }
+
+  errval_t span_err = LIB_ERR_NO_SPANNED_DISP;
+  err = domain_new_dispatcher(core, thc_pool_span_cb, &span_err);
+  if (err_is_fail(err)) {
+    return err;
+  }
+  while (err_no(span_err) == LIB_ERR_NO_SPANNED_DISP) {
+    err = event_dispatch(get_default_waitset());
+    if (err_is_fail(err)) {
+      return err_push(err, LIB_ERR_EVENT_DISPATCH);
+    }
+  }
+  if (err_is_fail(span_err)) {
+    return span_err;
+  }
+
+  return domain_thread_create_on(core, thc_pool_thread_main, t, &t->thread);
+}
+
+// Stop the worker threads started so far and wait for them to exit
+
+static errval_t thc_pool_join_workers(void) {
+  errval_t err = SYS_ERR_OK;
+
+  thc_pool.stopping = 1;
+  for (int i = 1; i < thc_pool.nthreads; i++) {
+    errval_t e = domain_thread_join(thc_pool.threads[i].thread, NULL);
+    if (err_is_fail(e)) {
+      err = e;
+    }
+  }
+  thc_pool.active = 0;
+  thc_pool.nthreads = 0;
+  return err;
+}
+
+errval_t THCPoolStart(coreid_t *cores, int ncores) {
+  struct waitset *ws = get_default_waitset();
+  errval_t err;
+
+  assert(!thc_pool.active && "THC pool already running");
+  if (ncores + 1 > THC_POOL_MAX_THREADS) {
+    return LIB_ERR_THREAD_CREATE;
+  }
+
+  memset(&thc_pool, 0, sizeof(thc_pool));
+  thc_pool.threads[0].pts = PTS();
+  thc_pool.threads[0].core = disp_get_core_id();
+  thc_pool.nthreads = 1;
+
+  for (int i = 0; i < ncores; i++) {
+    err = thc_pool_create_worker(&thc_pool.threads[thc_pool.nthreads],
+                                 cores[i]);
+    if (err_is_fail(err)) {
+      thc_pool_join_workers();
+      return err_push(err, LIB_ERR_THREAD_CREATE);
+    }
+    thc_pool.nthreads++;
+  }
+
+  // Wait for the workers to publish their runtime state
+  for (int i = 1; i < thc_pool.nthreads; i++) {
+    while (thc_pool.threads[i].pts == NULL) {
+      event_dispatch_non_block(ws);
+      thread_yield();
+    }
+  }
+
+  thc_pool.active = 1;
+  return SYS_ERR_OK;
+}
+
+errval_t THCPoolStop(void) {
+  assert(thc_pool.active && "THC pool not running");
+  assert(thc_pool.threads[0].pts == PTS());
+  return thc_pool_join_workers();
+}
+
 __attribute__((constructor))
 static void thc_init(void) {
   thc_start_rts();
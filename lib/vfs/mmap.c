@@ -1,8 +1,13 @@
 /**
  * \file
- * \brief Hacky MMAP support for VFS.
- * \bug The current implementation is a thin layer over an anonymous memobj.
- *      It does not share memory, and does not propagate any updates.
+ * \brief MMAP support for VFS.
+ *
+ * File pages are mapped in on demand from a page cache (see vfs_pagecache.c),
+ * with read-ahead. Mappings created by path share the cached frames of the
+ * file read-only, and get a private copy of a page when they write to it.
+ * Writes to the file through the VFS, including memobj_flush_vfs(), are seen
+ * by the pages a mapping has not copied.
+ * \bug Changes to a mapping are only written back by memobj_flush_vfs().
  */
 
 /*
@@ -21,106 +26,189 @@
 #include <barrelfish/memobj.h>
 #include <vfs/mmap.h>
 
+#include "vfs_pagecache.h"
+
+/// Allocate a page and fill it with nbytes of file data from offset
+static errval_t read_page(struct memobj_vfs *mv, off_t offset, size_t nbytes,
+                          struct capref *ret_frame)
+{
+    errval_t err, err2;
+    struct capref frame;
+    void *buf;
+
+    err = frame_alloc(&frame, BASE_PAGE_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    err = vspace_map_one_frame(&buf, BASE_PAGE_SIZE, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    size_t rsize, pos = 0;
+    if (nbytes > 0) {
+        err = vfs_seek(mv->vh, VFS_SEEK_SET, offset);
+        while (err_is_ok(err) && pos < nbytes) {
+            err = vfs_read(mv->vh, (char *)buf + pos, nbytes - pos, &rsize);
+            if (err_no(err) == VFS_ERR_EOF) {
+                err = SYS_ERR_OK;
+                break;
+            } else if (err_is_fail(err) || rsize == 0) {
+                break;
+            }
+            pos += rsize;
+        }
+    }
+    memset((char *)buf + pos, 0, BASE_PAGE_SIZE - pos);
+
+    err2 = vspace_unmap(buf);
+    assert(err_is_ok(err2));
+
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err;
+    }
+
+    *ret_frame = frame;
+    return SYS_ERR_OK;
+}
+
 /**
- * \brief Page fault handler
+ * \brief Get a page for the page fault handler of the memobj
  *
- * \param memobj  The memory object
- * \param region  The associated vregion
- * \param offset  Offset into memory object of the page fault
- * \param type    The fault type
+ * Pages entirely within filesize come from the page cache. The partial page
+ * at filesize, and the pages above it, are not file pages and get a frame of
+ * their own.
  */
-static errval_t pagefault(struct memobj *memobj, struct vregion *vregion,
-                          genvaddr_t offset, vm_fault_type_t type)
+static errval_t get_page(void *st, size_t page, size_t readahead,
+                         struct capref *ret_frame, genpaddr_t *ret_offset)
 {
+    struct memobj_vfs *mv = st;
     errval_t err;
-    assert(memobj->type == MEMOBJ_VFS);
-    struct memobj_vfs *mv = (struct memobj_vfs *)memobj;
-    struct memobj_anon *anon = &mv->anon;
-    struct vspace *vspace = vregion_get_vspace(vregion);
-    struct pmap *pmap     = vspace_get_pmap(vspace);
-    genvaddr_t vregion_base  = vregion_get_base_addr(vregion);
-    genvaddr_t vregion_off   = vregion_get_offset(vregion);
 
-    assert(vregion_off == 0); // not sure if we handle this correctly
+    size_t off = (page - mv->pc.first_page) * BASE_PAGE_SIZE;
 
-    // Walk the ordered list to find the matching frame, but don't map it yet
-    struct memobj_frame_list *walk = anon->frame_list;
-    while (walk) {
-        if (offset >= walk->offset && offset < walk->offset + walk->size) {
-            break;
+    if (off >= mv->filesize) {
+        if (capref_is_null(mv->zero_frame)) {
+            err = read_page(mv, 0, 0, &mv->zero_frame);
+            if (err_is_fail(err)) {
+                return err;
+            }
+        }
+        *ret_frame = mv->zero_frame;
+        *ret_offset = 0;
+        return SYS_ERR_OK;
+    } else if (off + BASE_PAGE_SIZE > mv->filesize) {
+        if (capref_is_null(mv->tail_frame)) {
+            err = read_page(mv, mv->offset + off, mv->filesize - off,
+                            &mv->tail_frame);
+            if (err_is_fail(err)) {
+                return err;
+            }
         }
-        walk = walk->next;
+        *ret_frame = mv->tail_frame;
+        *ret_offset = 0;
+        return SYS_ERR_OK;
     }
 
-    if (walk == NULL) {
-        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
-    }
+    return vfs_pagecache_get_page(mv->cache, page, readahead, ret_frame,
+                                  ret_offset);
+}
 
-    genvaddr_t map_offset = vregion_off + walk->offset;
-    size_t nbytes = walk->size;
+static bool lookup_page(void *st, size_t page, struct capref *ret_frame,
+                        genpaddr_t *ret_offset)
+{
+    struct memobj_vfs *mv = st;
 
-    // how much do we need to read from the file?
-    if (map_offset >= mv->filesize) {
-        // nothing
-        goto do_map;
-    } else if (map_offset + nbytes > mv->filesize) {
-        // limit size of read to maximum mapping (rest is zero-filled)
-        nbytes = mv->filesize - map_offset;
+    size_t off = (page - mv->pc.first_page) * BASE_PAGE_SIZE;
+
+    if (off + BASE_PAGE_SIZE > mv->filesize) {
+        struct capref frame = off >= mv->filesize ? mv->zero_frame
+                                                   : mv->tail_frame;
+        if (capref_is_null(frame)) {
+            return false;
+        }
+        *ret_frame = frame;
+        *ret_offset = 0;
+        return true;
     }
 
-#if 0
-    debug_printf("fault at offset %lx, mapping at %lx-%lx from file data %lx-%lx\n",
-                 offset, vregion_base + map_offset,
-                 vregion_base + map_offset + walk->size,
-                 map_offset + mv->offset,
-                 map_offset + mv->offset + nbytes);
-#endif
+    return vfs_pagecache_lookup_page(mv->cache, page, ret_frame, ret_offset);
+}
+
+static const struct memobj_pagecache_ops vfs_pagecache_ops = {
+    .get_page = get_page,
+    .lookup_page = lookup_page,
+};
 
-    // map frame writable at temporary location so that we can safely fill it
-    void *buf;
-    struct memobj *tmp_memobj = NULL;
-    struct vregion *tmp_vregion = NULL;
-    err = vspace_map_one_frame(&buf, walk->size, walk->frame,
-                               &tmp_memobj, &tmp_vregion);
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "error setting up temp mapping in mmap pagefault handler\n");
-        return err; // XXX
+static errval_t create_vfs(struct memobj_vfs *memobj, size_t size,
+                           memobj_flags_t flags, struct vfs_pagecache *cache,
+                           off_t offset, size_t filesize)
+{
+    errval_t err;
+
+    // pages are mapped straight from the cache, so they must line up
+    if (offset % BASE_PAGE_SIZE != 0) {
+        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
     }
 
-    // seek file handle
-    err = vfs_seek(mv->vh, VFS_SEEK_SET, map_offset + mv->offset);
+    err = memobj_create_pagecache(&memobj->pc, size, flags, &vfs_pagecache_ops,
+                                  memobj, offset / BASE_PAGE_SIZE);
     if (err_is_fail(err)) {
         return err;
     }
 
-    // read contents into frame
-    size_t rsize, pos = 0;
-    do {
-        err = vfs_read(mv->vh, (char *)buf + pos, nbytes - pos, &rsize);
-        if (err_is_fail(err)) {
-            break;
+    // reset type
+    ((struct memobj *)memobj)->type = MEMOBJ_VFS;
+
+    memobj->cache = cache;
+    memobj->zero_frame = NULL_CAP;
+    memobj->tail_frame = NULL_CAP;
+    memobj->vh = cache->vh;
+    memobj->offset = offset;
+    memobj->filesize = filesize;
+
+    vfs_pagecache_add_user(cache, memobj);
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Drop the pages of a mapping that changed in the file
+ *
+ * \param mv        The memory object
+ * \param first     First page of the file that changed
+ * \param last      Page after the last one that changed
+ * \param filesize  New size of the file
+ *
+ * Called by the page cache with its lock held. A file that shrank below the
+ * data of the mapping ends the data there; a file that grew does not extend
+ * it, as the size of the data is given at creation.
+ */
+void memobj_vfs_file_changed(struct memobj_vfs *mv, size_t first, size_t last,
+                             size_t filesize)
+{
+    size_t mapend = mv->offset + mv->filesize;
+    size_t tail = mapend / BASE_PAGE_SIZE; // page held by tail_frame
+
+    if (filesize < mapend) {
+        mv->filesize = filesize > mv->offset ? filesize - mv->offset : 0;
+        // pages from the new end on are no longer file pages
+        if (filesize / BASE_PAGE_SIZE < first) {
+            first = filesize / BASE_PAGE_SIZE;
         }
-        pos += rsize;
-    } while(rsize > 0 && pos < nbytes);
-
-    // destroy temp mappings
-    // FIXME: the API for tearing down mappings is really unclear! is this sufficient?
-    err = vregion_destroy(tmp_vregion);
-    assert(err_is_ok(err));
-    err = memobj_destroy_one_frame(tmp_memobj);
-    assert(err_is_ok(err));
-    //free(tmp_vregion);
-    //free(tmp_memobj);
-
-do_map:
-    // map at target address with appropriate flags
-    err = pmap->f.map(pmap, vregion_base + map_offset, walk->frame, 0,
-                      walk->size, vregion_get_flags(vregion), NULL, NULL);
+    }
+
+    errval_t err = memobj_pagecache_invalidate(&mv->pc, first, last - first);
     if (err_is_fail(err)) {
-        return err_push(err, LIB_ERR_PMAP_MAP);
+        DEBUG_ERR(err, "unmapping changed file pages");
     }
 
-    return SYS_ERR_OK;
+    if (!capref_is_null(mv->tail_frame) && tail >= first && tail < last) {
+        cap_destroy(mv->tail_frame);
+        mv->tail_frame = NULL_CAP;
+    }
 }
 
 /**
@@ -130,38 +218,92 @@ do_map:
  * \param size    Size of the memory region
  * \param flags   Memory object specific flags
  * \param vh      VFS handle for underlying file
- * \param offset  Offset within file to start mapping
+ * \param offset  Offset within file to start mapping, must be page-aligned
  * \param filesize Size of file data to map, anything above this is zero-filled
+ *
+ * The pages are cached privately for this memory object.
  */
 errval_t memobj_create_vfs(struct memobj_vfs *memobj, size_t size,
                            memobj_flags_t flags, vfs_handle_t vh, off_t offset,
                            size_t filesize)
 {
+    struct vfs_pagecache *cache;
     errval_t err;
 
-    // create anon memobj
-    err = memobj_create_anon(&memobj->anon, size, flags);
+    err = vfs_pagecache_create(vh, &cache);
     if (err_is_fail(err)) {
         return err;
     }
 
-    // replace pagefault handler with our own
-    ((struct memobj *)memobj)->f.pagefault = pagefault;
+    err = create_vfs(memobj, size, flags, cache, offset, filesize);
+    if (err_is_fail(err)) {
+        vfs_pagecache_release(cache);
+    }
+    return err;
+}
 
-    // reset type
-    ((struct memobj *)memobj)->type = MEMOBJ_VFS;
+/**
+ * \brief Initialize a memory object sharing cached pages with other mappings
+ *
+ * \param memobj  The memory object
+ * \param size    Size of the memory region
+ * \param flags   Memory object specific flags
+ * \param path    Path to the file
+ * \param offset  Offset within file to start mapping, must be page-aligned
+ * \param filesize Size of file data to map, anything above this is zero-filled
+ *
+ * All memory objects created for the same file share the page cache.
+ */
+errval_t memobj_create_vfs_shared(struct memobj_vfs *memobj, size_t size,
+                                  memobj_flags_t flags, const char *path,
+                                  off_t offset, size_t filesize)
+{
+    struct vfs_pagecache *cache;
+    errval_t err;
 
-    memobj->vh = vh;
-    memobj->offset = offset;
-    memobj->filesize = filesize;
+    err = vfs_pagecache_open(path, &cache);
+    if (err_is_fail(err)) {
+        return err;
+    }
 
-    return SYS_ERR_OK;
+    err = create_vfs(memobj, size, flags, cache, offset, filesize);
+    if (err_is_fail(err)) {
+        vfs_pagecache_release(cache);
+    }
+    return err;
 }
 
 // FIXME: why aren't the destructors instance methods? -AB
 errval_t memobj_destroy_vfs(struct memobj *memobj)
 {
-    USER_PANIC("NYI");
+    struct memobj_vfs *mv = (struct memobj_vfs *)memobj;
+    errval_t err;
+
+    if (mv->cache == NULL) {
+        return SYS_ERR_OK; // never initialized
+    }
+
+    // unmaps all pages, before their frames are freed
+    err = memobj_destroy_pagecache(memobj);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    vfs_pagecache_remove_user(mv->cache, mv);
+
+    if (!capref_is_null(mv->zero_frame)) {
+        cap_destroy(mv->zero_frame);
+        mv->zero_frame = NULL_CAP;
+    }
+    if (!capref_is_null(mv->tail_frame)) {
+        cap_destroy(mv->tail_frame);
+        mv->tail_frame = NULL_CAP;
+    }
+
+    vfs_pagecache_release(mv->cache);
+    mv->cache = NULL;
+
+    return SYS_ERR_OK;
 }
 
 // Kludge to push changes in VFS memobj back out to disk
@@ -191,10 +333,10 @@ errval_t memobj_flush_vfs(struct memobj *memobj, struct vregion *vregion)
                              NULL, NULL, &retflags);
         if (err_is_fail(err)) {
             continue; // Page not in memory
-#if 0 /* this optimisation may not be correct if flags were changed -AB */
         } else if ((retflags & VREGION_FLAGS_WRITE) == 0) {
-            continue; // Not writable
-#endif
+            // Not writable: an unmodified page from the page cache. Written
+            // pages are always private copies mapped writable.
+            continue;
         }
 
         //TRACE("Flushing page at address: %lx\n", vregion_base + off);
@@ -230,13 +372,14 @@ errval_t memobj_flush_vfs(struct memobj *memobj, struct vregion *vregion)
  * \brief Wrapper to create and map a file object, optionally at a fixed address
  *
  * The memory object and vregion are returned so the user can call fill and
- * pagefault on it to create actual mappings.
+ * pagefault on it to create actual mappings. If path is given, the file is
+ * opened by path and its cached pages are shared, otherwise file is used.
  */
 static errval_t vspace_map_file_internal(genvaddr_t opt_base,
                                          size_t opt_alignment,
                                          size_t size, vregion_flags_t flags,
-                                         vfs_handle_t file, off_t offset,
-                                         size_t filesize,
+                                         vfs_handle_t file, const char *path,
+                                         off_t offset, size_t filesize,
                                          struct vregion **ret_vregion,
                                          struct memobj **ret_memobj)
 {
@@ -245,7 +388,7 @@ static errval_t vspace_map_file_internal(genvaddr_t opt_base,
     struct vregion *vregion = NULL;
 
     // Allocate space
-    memobj = malloc(sizeof(struct memobj_vfs));
+    memobj = calloc(1, sizeof(struct memobj_vfs));
     if (!memobj) {
         err1 = LIB_ERR_MALLOC_FAIL;
         goto error;
@@ -257,8 +400,13 @@ static errval_t vspace_map_file_internal(genvaddr_t opt_base,
     }
 
     // Create a memobj and vregion
-    err1 = memobj_create_vfs((struct memobj_vfs *)memobj, size, 0, file, offset,
-                             filesize);
+    if (path != NULL) {
+        err1 = memobj_create_vfs_shared((struct memobj_vfs *)memobj, size, 0,
+                                        path, offset, filesize);
+    } else {
+        err1 = memobj_create_vfs((struct memobj_vfs *)memobj, size, 0, file,
+                                 offset, filesize);
+    }
     if (err_is_fail(err1)) {
         err1 = err_push(err1, LIB_ERR_MEMOBJ_CREATE_VFS);
         goto error;
@@ -287,7 +435,7 @@ static errval_t vspace_map_file_internal(genvaddr_t opt_base,
     if (memobj) {
         err2 = memobj_destroy_vfs(memobj);
         if (err_is_fail(err2)) {
-            DEBUG_ERR(err2, "memobj_destroy_anon failed");
+            DEBUG_ERR(err2, "memobj_destroy_vfs failed");
         }
         free(memobj);
     }
@@ -306,8 +454,17 @@ errval_t vspace_map_file(size_t size, vregion_flags_t flags,
                          struct vregion **ret_vregion,
                          struct memobj **ret_memobj)
 {
-    return vspace_map_file_internal(0, 0, size, flags, file, offset, filesize,
-                                    ret_vregion, ret_memobj);
+    return vspace_map_file_internal(0, 0, size, flags, file, NULL, offset,
+                                    filesize, ret_vregion, ret_memobj);
+}
+
+errval_t vspace_map_file_shared(size_t size, vregion_flags_t flags,
+                                const char *path, off_t offset,
+                                size_t filesize, struct vregion **ret_vregion,
+                                struct memobj **ret_memobj)
+{
+    return vspace_map_file_internal(0, 0, size, flags, NULL_VFS_HANDLE, path,
+                                    offset, filesize, ret_vregion, ret_memobj);
 }
 
 errval_t vspace_map_file_fixed(genvaddr_t base, size_t size,
@@ -317,8 +474,8 @@ errval_t vspace_map_file_fixed(genvaddr_t base, size_t size,
                                struct memobj **ret_memobj)
 {
     assert(base != 0);
-    return vspace_map_file_internal(base, 0, size, flags, file, offset, filesize,
-                                    ret_vregion, ret_memobj);
+    return vspace_map_file_internal(base, 0, size, flags, file, NULL, offset,
+                                    filesize, ret_vregion, ret_memobj);
 }
 
 errval_t vspace_map_file_aligned(size_t alignment, size_t size,
@@ -327,6 +484,6 @@ errval_t vspace_map_file_aligned(size_t alignment, size_t size,
                                  struct vregion **ret_vregion,
                                  struct memobj **ret_memobj)
 {
-    return vspace_map_file_internal(0, alignment, size, flags, file, offset,
-                                    filesize, ret_vregion, ret_memobj);
+    return vspace_map_file_internal(0, alignment, size, flags, file, NULL,
+                                    offset, filesize, ret_vregion, ret_memobj);
 }
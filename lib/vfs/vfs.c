@@ -16,13 +16,7 @@
 
 #include "vfs_ops.h"
 #include "vfs_backends.h"
-
-struct vfs_mount {
-    const char *mountpoint;
-    struct vfs_ops *ops;
-    void *st;
-    struct vfs_mount *next;
-};
+#include "vfs_pagecache.h"
 
 static struct vfs_mount *mounts;
 
@@ -218,8 +212,9 @@ errval_t vfs_open(const char *path, vfs_handle_t *handle)
 
     // update handle with mount pointer
     if (err_is_ok(ret)) {
-        struct vfs_handle *h = *handle;
-        h->mount = m;
+        vfs_io_handle_init(*handle, m);
+        // identifies the file to page caches opened by path
+        ((struct vfs_handle *)*handle)->path = vfs_path_mkabs(path);
     }
 
     return ret;
@@ -248,8 +243,8 @@ errval_t vfs_create(const char *path, vfs_handle_t *handle)
 
     // update handle with mount pointer
     if (err_is_ok(ret)) {
-        struct vfs_handle *h = *handle;
-        h->mount = m;
+        vfs_io_handle_init(*handle, m);
+        ((struct vfs_handle *)*handle)->path = vfs_path_mkabs(path);
     }
 
     return ret;
@@ -306,7 +301,24 @@ errval_t vfs_write(vfs_handle_t handle, const void *buffer, size_t bytes,
 {
     struct vfs_handle *h = handle;
     struct vfs_mount *m = h->mount;
+    errval_t err;
     assert(m->ops->write != NULL);
+
+    // cached pages of the file must be read again
+    if (vfs_pagecache_in_use()) {
+        size_t pos;
+        assert(m->ops->tell != NULL);
+        err = m->ops->tell(m->st, handle, &pos);
+        if (err_is_fail(err)) {
+            return err;
+        }
+        size_t done = 0;
+        err = m->ops->write(m->st, handle, buffer, bytes, &done);
+        vfs_pagecache_written(h, pos, done);
+        *bytes_written = done;
+        return err;
+    }
+
     return m->ops->write(m->st, handle, buffer, bytes, bytes_written);
 }
 
@@ -325,7 +337,11 @@ errval_t vfs_truncate(vfs_handle_t handle, size_t bytes)
     struct vfs_mount *m = h->mount;
 
     assert(m->ops->truncate != NULL);
-    return m->ops->truncate(m->st, handle, bytes);
+    errval_t err = m->ops->truncate(m->st, handle, bytes);
+    if (err_is_ok(err) && vfs_pagecache_in_use()) {
+        vfs_pagecache_truncated(h, bytes);
+    }
+    return err;
 }
 
 /**
@@ -402,6 +418,11 @@ errval_t vfs_close(vfs_handle_t handle)
     struct vfs_handle *h = handle;
     struct vfs_mount *m = h->mount;
 
+    // wait for any outstanding asynchronous I/O first
+    vfs_io_handle_destroy(h);
+    free(h->path);
+    h->path = NULL;
+
     assert(m->ops->close != NULL);
     return m->ops->close(m->st, handle);
 }
@@ -430,8 +451,7 @@ errval_t vfs_opendir(const char *path, vfs_handle_t *dhandle)
 
     // update handle with mount pointer
     if (err_is_ok(ret)) {
-        struct vfs_handle *h = *dhandle;
-        h->mount = m;
+        vfs_io_handle_init(*dhandle, m);
     }
 
     return ret;
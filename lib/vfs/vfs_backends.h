@@ -10,14 +10,54 @@
 #ifndef VFS_BACKENDS_H
 #define VFS_BACKENDS_H
 
+#include <barrelfish/waitset.h>
 #include "vfs_ops.h"
 
-struct vfs_mount;
+struct vfs_mount {
+    const char *mountpoint;
+    struct vfs_ops *ops;
+    void *st;
+    struct vfs_mount *next;
+};
+
+struct vfs_io_queue;
 
 struct vfs_handle {
     struct vfs_mount *mount;
+    struct vfs_io_queue *ioq;   ///< async I/O queue, created on first use
+    char *path;                 ///< absolute path of an open file, or NULL
+};
+
+enum vfs_io_op {
+    VFS_IO_READ,
+    VFS_IO_WRITE,
 };
 
+/// An asynchronous I/O request, as seen by a backend's submit_io
+struct vfs_io_req {
+    struct vfs_io_req *next;    ///< next in submission queue
+    struct vfs_io_req *out_next, *out_prev; ///< outstanding requests of handle
+    struct vfs_handle *handle;  ///< handle the request was submitted on
+    enum vfs_io_op op;
+    size_t offset;              ///< file offset of first byte
+    struct vfs_iovec *iov;      ///< private copy of caller's iovec array
+    size_t iovcnt;              ///< number of entries in iov
+    size_t total;               ///< total bytes described by iov
+    void *backend_st;           ///< private to the backend
+
+    // completion
+    errval_t err;
+    size_t bytes;
+    struct waitset *ws;
+    struct waitset_chanstate chan;
+    vfs_io_callback_t cb;
+    void *cb_arg;
+};
+
+void vfs_io_complete(struct vfs_io_req *req, errval_t err, size_t bytes);
+void vfs_io_handle_init(struct vfs_handle *h, struct vfs_mount *m);
+void vfs_io_handle_destroy(struct vfs_handle *h);
+
 errval_t vfs_nfs_mount(const char *uri, void **retst, struct vfs_ops **retops);
 errval_t vfs_ramfs_mount(const char *uri, void **retst, struct vfs_ops **retops);
 errval_t vfs_blockdevfs_mount(const char *uri, void **retst, struct vfs_ops **retops);
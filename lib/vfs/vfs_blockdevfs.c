@@ -67,6 +67,8 @@ struct backend_ops {
     errval_t (*write)(void *handle, size_t pos, const void *buffer, size_t bytes,
                       size_t *bytes_written);
     errval_t (*flush)(void *handle);
+    // optional, see vfs_ops.h
+    errval_t (*submit_io)(void *handle, struct vfs_io_req *req);
 };
 
 
@@ -77,7 +79,8 @@ struct backend_ops backends[3] = {
         .close = blockdevfs_ahci_close,
         .read = blockdevfs_ahci_read,
         .write = blockdevfs_ahci_write,
-        .flush = blockdevfs_ahci_flush
+        .flush = blockdevfs_ahci_flush,
+        .submit_io = blockdevfs_ahci_submit_io,
     },
     {
         .open = blockdevfs_ata_open,
@@ -318,6 +321,41 @@ static errval_t flush(void *st, vfs_handle_t inhandle)
     return backends[entry->type].flush(entry->backend_handle);
 }
 
+static errval_t submit_io(void *st, vfs_handle_t inhandle,
+                          struct vfs_io_req *req)
+{
+    struct blockdevfs_handle *handle = inhandle;
+    struct blockdev_entry *entry = handle->entry;
+
+    if (backends[entry->type].submit_io != NULL) {
+        return backends[entry->type].submit_io(entry->backend_handle, req);
+    }
+
+    // backend is synchronous, but positional, so just run it here
+    size_t pos = req->offset, done = 0;
+    errval_t err = SYS_ERR_OK;
+    for (size_t i = 0; i < req->iovcnt && err_is_ok(err); i++) {
+        size_t bytes = 0;
+        if (req->op == VFS_IO_READ) {
+            err = backends[entry->type].read(entry->backend_handle, pos,
+                                             req->iov[i].base,
+                                             req->iov[i].len, &bytes);
+        } else {
+            err = backends[entry->type].write(entry->backend_handle, pos,
+                                              req->iov[i].base,
+                                              req->iov[i].len, &bytes);
+        }
+        pos += bytes;
+        done += bytes;
+        if (bytes < req->iov[i].len) {
+            break;
+        }
+    }
+
+    vfs_io_complete(req, err, done);
+    return SYS_ERR_OK;
+}
+
 static struct vfs_ops blockdevfsops = {
     .open = open,
     .create = create,
@@ -335,6 +373,7 @@ static struct vfs_ops blockdevfsops = {
     .mkdir = mkdir,
     .rmdir = rmdir,
     .flush = flush,
+    .submit_io = submit_io,
 };
 
 errval_t vfs_blockdevfs_mount(const char *uri, void **retst, struct vfs_ops **retops)
@@ -18,6 +18,8 @@
 #endif
 #endif // VFS_DEBUG
 
+struct vfs_io_req;
+
 struct blockdev_entry {
     struct blockdev_entry *prev;
     struct blockdev_entry *next;
@@ -48,6 +50,7 @@ errval_t blockdevfs_ahci_read(void *handle, size_t pos, void *buffer,
 errval_t blockdevfs_ahci_write(void *handle, size_t pos, const void *buffer,
 		size_t bytes, size_t *bytes_written);
 errval_t blockdevfs_ahci_flush(void *handle);
+errval_t blockdevfs_ahci_submit_io(void *handle, struct vfs_io_req *req);
 // AHCI (using Flounder-AHCI)
 errval_t blockdevfs_ata_init(void);
 errval_t blockdevfs_ata_open(void *handle);
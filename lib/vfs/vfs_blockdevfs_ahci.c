@@ -20,6 +20,7 @@
 #include <ahci/sata_fis.h>
 #include <ahci/ahci_dma_pool.h>
 
+#include "vfs_backends.h"
 #include "vfs_blockdevfs.h"
 
 static struct ahci_mgmt_rpc_client ahci_mgmt_rpc;
@@ -32,14 +33,98 @@ static bool ahci_mgmt_bound = false;
 #define RFIS_OFFSET_SET_DEVICE_BITS_FIS 0x58
 #define RFIS_OFFSET_UNKNOWN_FIS 0x60
 
+// tag of one asynchronous command
+struct ahci_async_cmd {
+    struct ahci_async_cmd *next;    ///< next command waiting for a slot
+    struct ahci_async_io *io;
+    struct ahci_dma_region *region;
+    void *buffer;
+    size_t bytes;
+    bool is_write;
+    struct sata_fis_reg_h2d fis;
+};
+
 struct ahci_handle {
     struct ahci_binding *binding;
     uint8_t port_num;
     bool waiting;
     errval_t wait_status;
     size_t bytes_transferred;
+    // asynchronous commands waiting for a free command slot, in order
+    struct ahci_async_cmd *pending_head, *pending_tail;
+};
+
+// state for an ongoing asynchronous request: one command per iovec
+struct ahci_async_io {
+    struct vfs_io_req *req;
+    int cmds_in_progress;
+    size_t bytes;
+    errval_t err;
 };
 
+static void async_command_done(struct ahci_async_cmd *cmd, errval_t err)
+{
+    struct ahci_async_io *io = cmd->io;
+
+    if (err_is_ok(err)) {
+        if (io->req->op == VFS_IO_READ) {
+            ahci_dma_region_copy_out(cmd->region, cmd->buffer, 0, cmd->bytes);
+        }
+        io->bytes += cmd->bytes;
+    } else if (err_is_ok(io->err)) {
+        io->err = err;
+    }
+    ahci_dma_region_free(cmd->region);
+    free(cmd);
+
+    if (--io->cmds_in_progress == 0) {
+        vfs_io_complete(io->req, io->err, io->bytes);
+        free(io);
+    }
+}
+
+/// Issue queued asynchronous commands until the port runs out of slots
+static void async_issue_pending(struct ahci_handle *h)
+{
+    while (h->pending_head != NULL) {
+        struct ahci_async_cmd *cmd = h->pending_head;
+
+        errval_t err = ahci_issue_command(h->binding, NOP_CONT, cmd,
+                                          (uint8_t*)&cmd->fis,
+                                          sizeof(cmd->fis), cmd->is_write,
+                                          cmd->region, cmd->bytes);
+        if (err_no(err) == AHCI_ERR_NO_FREE_SLOT) {
+            // retried when the next command completes
+            return;
+        }
+
+        h->pending_head = cmd->next;
+        if (h->pending_head == NULL) {
+            h->pending_tail = NULL;
+        }
+        if (err_is_fail(err)) {
+            async_command_done(cmd, err);
+        }
+    }
+}
+
+static void rx_command_completed_cb(struct ahci_binding *binding, void *tag)
+{
+    struct ahci_handle *h = binding->st;
+    VFS_BLK_DEBUG("rx_command_completed_cb(%p, tag: %p): entering\n",
+            binding, tag);
+
+    // synchronous commands are issued without a tag
+    if (tag == NULL) {
+        h->waiting = false;
+    } else {
+        async_command_done(tag, SYS_ERR_OK);
+    }
+
+    // a command slot is free again
+    async_issue_pending(h);
+}
+
 static void ahci_init_cb(void *st, errval_t err, struct ahci_binding *binding)
 {
     struct ahci_handle *h = st;
@@ -53,6 +138,7 @@ static void ahci_init_cb(void *st, errval_t err, struct ahci_binding *binding)
 
     h->binding = binding;
     binding->st = h;
+    binding->rx_vtbl.command_completed = rx_command_completed_cb;
     h->waiting = false;
 }
 
@@ -103,14 +189,6 @@ errval_t blockdevfs_ahci_close(void *handle)
     return SYS_ERR_OK;
 }
 
-static void rx_flush_command_completed_cb(struct ahci_binding *binding, void *tag)
-{
-    struct ahci_handle *h = binding->st;
-    VFS_BLK_DEBUG("rx_flush_command_completed_cb(%p, tag: %p): entering\n",
-            binding, tag);
-    h->waiting = false;
-}
-
 errval_t blockdevfs_ahci_flush(void *handle)
 {
     errval_t err = SYS_ERR_OK;
@@ -129,7 +207,6 @@ errval_t blockdevfs_ahci_flush(void *handle)
     h->waiting = true;
     h->wait_status = SYS_ERR_OK;
     h->bytes_transferred = 0;
-    h->binding->rx_vtbl.command_completed = rx_flush_command_completed_cb;
 
     // load fis and fire commands
     err = ahci_issue_command(h->binding, NOP_CONT, 0,
@@ -145,21 +222,9 @@ errval_t blockdevfs_ahci_flush(void *handle)
     }
 
 cleanup:
-
-    h->binding->rx_vtbl.command_completed = NULL;
-
     return err;
 }
 
-static void rx_read_command_completed_cb(struct ahci_binding *binding, void *tag)
-{
-    struct ahci_handle *h = binding->st;
-    VFS_BLK_DEBUG("rx_read_command_completed_cb(%p, tag: %p): entering\n",
-            binding, tag);
-
-    h->waiting = false;
-}
-
 errval_t blockdevfs_ahci_read(void *handle, size_t pos, void *buffer, size_t
         bytes, size_t *bytes_read)
 {
@@ -192,7 +257,6 @@ errval_t blockdevfs_ahci_read(void *handle, size_t pos, void *buffer, size_t
     h->waiting = true;
     h->wait_status = SYS_ERR_OK;
     h->bytes_transferred = 0;
-    h->binding->rx_vtbl.command_completed = rx_read_command_completed_cb;
 
     // load fis and fire commands
     err = ahci_issue_command(h->binding, NOP_CONT, 0,
@@ -219,9 +283,6 @@ errval_t blockdevfs_ahci_read(void *handle, size_t pos, void *buffer, size_t
     }
 
 cleanup:
-
-    h->binding->rx_vtbl.command_completed = NULL;
-
     VFS_BLK_DEBUG("read: freeing bufregion (%p)\n", bufregion);
     ahci_dma_region_free(bufregion);
 
@@ -229,14 +290,6 @@ cleanup:
 
 }
 
-static void rx_write_command_completed_cb(struct ahci_binding *binding, void *tag)
-{
-    struct ahci_handle *h = binding->st;
-    VFS_BLK_DEBUG("rx_write_command_completed_cb(%p, tag: %p): entering\n",
-            binding, tag);
-    h->waiting = false;
-}
-
 errval_t blockdevfs_ahci_write(void *handle, size_t pos, const void *buffer,
         size_t bytes, size_t *bytes_written)
 {
@@ -265,7 +318,6 @@ errval_t blockdevfs_ahci_write(void *handle, size_t pos, const void *buffer,
     // set handle to waiting
     h->waiting = true;
     h->wait_status = SYS_ERR_OK;
-    h->binding->rx_vtbl.command_completed = rx_write_command_completed_cb;
 
     // load fis and fire commands
     err = ahci_issue_command(h->binding, NOP_CONT, 0,
@@ -282,7 +334,6 @@ errval_t blockdevfs_ahci_write(void *handle, size_t pos, const void *buffer,
     }
 
     // cleanup and output
-    h->binding->rx_vtbl.command_completed = NULL;
     ahci_dma_region_free(bufregion);
     if (err_is_ok(h->wait_status)) {
         *bytes_written = aligned_bytes;
@@ -290,6 +341,90 @@ errval_t blockdevfs_ahci_write(void *handle, size_t pos, const void *buffer,
     return h->wait_status;
 }
 
+errval_t blockdevfs_ahci_submit_io(void *handle, struct vfs_io_req *req)
+{
+    errval_t err = SYS_ERR_OK;
+    struct ahci_handle *h = handle;
+    size_t pos = req->offset;
+
+    // the device transfers whole sectors only
+    if (pos % PR_SIZE != 0) {
+        return VFS_ERR_BAD_IOVEC;
+    }
+    for (size_t i = 0; i < req->iovcnt; i++) {
+        if (req->iov[i].len == 0 || req->iov[i].len % PR_SIZE != 0) {
+            return VFS_ERR_BAD_IOVEC;
+        }
+    }
+
+    struct ahci_async_io *io = calloc(1, sizeof(struct ahci_async_io));
+    if (io == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    io->req = req;
+    io->err = SYS_ERR_OK;
+
+    // hold a reference while issuing, so that completion can't run early
+    io->cmds_in_progress = 1;
+
+    for (size_t i = 0; i < req->iovcnt; i++) {
+        size_t bytes = req->iov[i].len;
+
+        struct ahci_async_cmd *cmd = malloc(sizeof(struct ahci_async_cmd));
+        if (cmd == NULL) {
+            err = LIB_ERR_MALLOC_FAIL;
+            break;
+        }
+        cmd->next = NULL;
+        cmd->io = io;
+        cmd->buffer = req->iov[i].base;
+        cmd->bytes = bytes;
+        cmd->is_write = req->op == VFS_IO_WRITE;
+
+        err = ahci_dma_region_alloc(bytes, &cmd->region);
+        if (err_is_fail(err)) {
+            free(cmd);
+            break;
+        }
+
+        if (cmd->is_write) {
+            ahci_dma_region_copy_in(cmd->region, cmd->buffer, 0, bytes);
+        }
+
+        memset(&cmd->fis, 0, sizeof(struct sata_fis_reg_h2d));
+        cmd->fis.type = SATA_FIS_TYPE_H2D;
+        cmd->fis.device = 1 << 6; // LBA mode, not CHS; ???
+        // read/write dma; ATA Command Set, 7.24/7.60
+        sata_set_command(&cmd->fis, cmd->is_write ? 0xCA : 0xC8);
+        sata_set_count(&cmd->fis, bytes / PR_SIZE); // nr. of sectors/blocks
+        sata_set_lba28(&cmd->fis, pos / PR_SIZE);
+
+        // queue behind earlier commands, which keeps them in order when the
+        // port runs out of command slots
+        io->cmds_in_progress++;
+        if (h->pending_tail == NULL) {
+            h->pending_head = cmd;
+        } else {
+            h->pending_tail->next = cmd;
+        }
+        h->pending_tail = cmd;
+
+        pos += bytes;
+    }
+
+    io->err = err;
+
+    async_issue_pending(h);
+
+    // drop the reference taken above
+    if (--io->cmds_in_progress == 0) {
+        vfs_io_complete(req, io->err, io->bytes);
+        free(io);
+    }
+
+    return SYS_ERR_OK;
+}
+
 static void ahci_mgmt_bind_cb(void *st, errval_t err, struct ahci_mgmt_binding *b)
 {
     if (err_is_fail(err)) {
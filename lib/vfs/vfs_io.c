@@ -0,0 +1,423 @@
+/**
+ * \file
+ * \brief Vectored and asynchronous I/O on VFS file handles
+ *
+ * Every handle gets a submission queue on first use of the asynchronous API.
+ * Up to depth requests are handed to the backend's submit_io function at a
+ * time, and further ones are submitted as completions are delivered.
+ * Backends that can overlap requests (NFS, AHCI) do so; for all others,
+ * requests are run one at a time from the waitset using the backend's
+ * synchronous seek/read/write operations. Completion callbacks are always
+ * delivered on the waitset given at submission time.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset_chan.h>
+#include <vfs/vfs.h>
+
+#include "vfs_ops.h"
+#include "vfs_backends.h"
+#include "vfs_pagecache.h"
+
+/// Default number of requests handed to the backend at once, per handle
+#define VFS_IO_DEFAULT_DEPTH    8
+
+struct vfs_io_queue {
+    struct thread_mutex lock;
+    struct vfs_io_req *head, *tail; ///< requests not yet submitted
+    size_t depth;                   ///< max. requests submitted to backend
+    size_t inflight;                ///< requests submitted to backend
+    size_t outstanding;             ///< requests whose callback has not run
+    struct vfs_io_req *out_head;    ///< list of outstanding requests
+};
+
+void vfs_io_handle_init(struct vfs_handle *h, struct vfs_mount *m)
+{
+    h->mount = m;
+    h->ioq = NULL;
+    h->path = NULL;
+}
+
+static struct vfs_io_queue *get_queue(struct vfs_handle *h)
+{
+    if (h->ioq == NULL) {
+        struct vfs_io_queue *q = calloc(1, sizeof(struct vfs_io_queue));
+        if (q == NULL) {
+            return NULL;
+        }
+        thread_mutex_init(&q->lock);
+        q->depth = VFS_IO_DEFAULT_DEPTH;
+        h->ioq = q;
+    }
+    return h->ioq;
+}
+
+static void free_req(struct vfs_io_req *req)
+{
+    waitset_chanstate_destroy(&req->chan);
+    free(req->iov);
+    free(req);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/// Run a request using the synchronous ops, for backends without submit_io
+static void io_emulate(void *arg)
+{
+    struct vfs_io_req *req = arg;
+    struct vfs_handle *h = req->handle;
+    struct vfs_mount *m = h->mount;
+    size_t oldpos, bytes = 0;
+    errval_t err;
+
+    err = m->ops->tell(m->st, h, &oldpos);
+    if (err_is_fail(err)) {
+        goto out;
+    }
+
+    err = m->ops->seek(m->st, h, VFS_SEEK_SET, req->offset);
+    if (err_is_fail(err)) {
+        goto out;
+    }
+
+    for (size_t i = 0; i < req->iovcnt && err_is_ok(err); i++) {
+        size_t done = 0;
+        if (req->op == VFS_IO_READ) {
+            err = m->ops->read(m->st, h, req->iov[i].base, req->iov[i].len,
+                               &done);
+        } else {
+            err = m->ops->write(m->st, h, req->iov[i].base, req->iov[i].len,
+                                &done);
+        }
+        bytes += done;
+        if (done < req->iov[i].len && err_is_ok(err)) {
+            break; // short transfer
+        }
+    }
+
+    errval_t err2 = m->ops->seek(m->st, h, VFS_SEEK_SET, oldpos);
+    if (err_is_ok(err)) {
+        err = err2;
+    }
+
+out:
+    vfs_io_complete(req, err, bytes);
+}
+
+static errval_t io_start(struct vfs_io_req *req)
+{
+    struct vfs_mount *m = req->handle->mount;
+
+    if (m->ops->submit_io != NULL) {
+        return m->ops->submit_io(m->st, req->handle, req);
+    }
+
+    // defer to the waitset, so that the caller can keep submitting
+    return waitset_chan_trigger_closure(req->ws, &req->chan,
+                                        MKCLOSURE(io_emulate, req));
+}
+
+/// Hand as many queued requests to the backend as the depth allows
+static void io_pump(struct vfs_io_queue *q)
+{
+    for (;;) {
+        thread_mutex_lock(&q->lock);
+        struct vfs_io_req *req = q->head;
+        if (req == NULL || q->inflight >= q->depth) {
+            thread_mutex_unlock(&q->lock);
+            return;
+        }
+        q->head = req->next;
+        if (q->head == NULL) {
+            q->tail = NULL;
+        }
+        q->inflight++;
+        thread_mutex_unlock(&q->lock);
+
+        errval_t err = io_start(req);
+        if (err_is_fail(err)) {
+            vfs_io_complete(req, err, 0);
+        }
+    }
+}
+
+static void io_deliver(void *arg)
+{
+    struct vfs_io_req *req = arg;
+    struct vfs_io_queue *q = req->handle->ioq;
+    vfs_io_callback_t cb = req->cb;
+    void *cb_arg = req->cb_arg;
+    errval_t err = req->err;
+    size_t bytes = req->bytes;
+
+    if (req->op == VFS_IO_WRITE && vfs_pagecache_in_use()) {
+        vfs_pagecache_written(req->handle, req->offset, bytes);
+    }
+
+    thread_mutex_lock(&q->lock);
+    assert(q->outstanding > 0);
+    q->outstanding--;
+    if (req->out_prev == NULL) {
+        q->out_head = req->out_next;
+    } else {
+        req->out_prev->out_next = req->out_next;
+    }
+    if (req->out_next != NULL) {
+        req->out_next->out_prev = req->out_prev;
+    }
+    thread_mutex_unlock(&q->lock);
+
+    free_req(req);
+
+    // a slot at the backend is free again
+    io_pump(q);
+
+    // the callback may drain or close the handle, which frees q
+    if (cb != NULL) {
+        cb(cb_arg, err, bytes);
+    }
+}
+
+/**
+ * \brief Called by a backend when it has finished with a request
+ *
+ * \param req   Request passed to submit_io
+ * \param err   Result of the operation
+ * \param bytes Number of bytes transferred
+ */
+void vfs_io_complete(struct vfs_io_req *req, errval_t err, size_t bytes)
+{
+    struct vfs_io_queue *q = req->handle->ioq;
+    assert(q != NULL);
+
+    req->err = err;
+    req->bytes = bytes;
+
+    thread_mutex_lock(&q->lock);
+    assert(q->inflight > 0);
+    q->inflight--;
+    thread_mutex_unlock(&q->lock);
+
+    // the next request is submitted from io_deliver, not here, as backends
+    // may call us with their own locks held
+    err = waitset_chan_trigger_closure(req->ws, &req->chan,
+                                       MKCLOSURE(io_deliver, req));
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "failed to deliver VFS I/O completion");
+    }
+}
+
+static errval_t submit(vfs_handle_t handle, enum vfs_io_op op, size_t offset,
+                       const struct vfs_iovec *iov, size_t iovcnt,
+                       struct waitset *ws, vfs_io_callback_t cb, void *arg)
+{
+    struct vfs_handle *h = handle;
+
+    if (iov == NULL || iovcnt == 0) {
+        return VFS_ERR_BAD_IOVEC;
+    }
+
+    struct vfs_io_queue *q = get_queue(h);
+    if (q == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    struct vfs_io_req *req = calloc(1, sizeof(struct vfs_io_req));
+    if (req == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    req->iov = malloc(iovcnt * sizeof(struct vfs_iovec));
+    if (req->iov == NULL) {
+        free(req);
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    memcpy(req->iov, iov, iovcnt * sizeof(struct vfs_iovec));
+    req->iovcnt = iovcnt;
+    for (size_t i = 0; i < iovcnt; i++) {
+        req->total += iov[i].len;
+    }
+
+    req->handle = h;
+    req->op = op;
+    req->offset = offset;
+    req->ws = ws == NULL ? get_default_waitset() : ws;
+    req->cb = cb;
+    req->cb_arg = arg;
+    waitset_chanstate_init(&req->chan, CHANTYPE_OTHER);
+
+    // append to submission queue
+    thread_mutex_lock(&q->lock);
+    req->next = NULL;
+    if (q->tail == NULL) {
+        q->head = q->tail = req;
+    } else {
+        q->tail->next = req;
+        q->tail = req;
+    }
+    q->outstanding++;
+    req->out_prev = NULL;
+    req->out_next = q->out_head;
+    if (q->out_head != NULL) {
+        q->out_head->out_prev = req;
+    }
+    q->out_head = req;
+    thread_mutex_unlock(&q->lock);
+
+    io_pump(q);
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Start an asynchronous read at the given offset of an open file
+ *
+ * \param handle Handle to an open file
+ * \param offset Offset in file to read from; the file pointer is not used
+ *               or changed
+ * \param iov    Scatter list of buffers to fill (copied, may be reused)
+ * \param iovcnt Number of entries in iov
+ * \param ws     Waitset on which cb is run (default waitset if NULL)
+ * \param cb     Callback run on completion, with the number of bytes read
+ * \param arg    Argument passed to cb
+ */
+errval_t vfs_read_async(vfs_handle_t handle, size_t offset,
+                        const struct vfs_iovec *iov, size_t iovcnt,
+                        struct waitset *ws, vfs_io_callback_t cb, void *arg)
+{
+    return submit(handle, VFS_IO_READ, offset, iov, iovcnt, ws, cb, arg);
+}
+
+/**
+ * \brief Start an asynchronous write at the given offset of an open file
+ *
+ * Arguments as for #vfs_read_async. The buffers must remain valid until the
+ * callback has run.
+ */
+errval_t vfs_write_async(vfs_handle_t handle, size_t offset,
+                         const struct vfs_iovec *iov, size_t iovcnt,
+                         struct waitset *ws, vfs_io_callback_t cb, void *arg)
+{
+    return submit(handle, VFS_IO_WRITE, offset, iov, iovcnt, ws, cb, arg);
+}
+
+/**
+ * \brief Set the maximum number of requests in flight at the backend
+ */
+errval_t vfs_io_set_depth(vfs_handle_t handle, size_t depth)
+{
+    struct vfs_io_queue *q = get_queue(handle);
+    if (q == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    thread_mutex_lock(&q->lock);
+    q->depth = depth > 0 ? depth : 1;
+    thread_mutex_unlock(&q->lock);
+
+    io_pump(q);
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Wait until all asynchronous requests on a handle have completed and
+ * their callbacks have run
+ *
+ * Dispatches the waitsets the outstanding requests complete on, in turn.
+ */
+errval_t vfs_io_drain(vfs_handle_t handle)
+{
+    struct vfs_handle *h = handle;
+    struct vfs_io_queue *q = h->ioq;
+
+    if (q == NULL) {
+        return SYS_ERR_OK;
+    }
+
+    for (;;) {
+        thread_mutex_lock(&q->lock);
+        struct waitset *ws = q->out_head != NULL ? q->out_head->ws : NULL;
+        thread_mutex_unlock(&q->lock);
+        if (ws == NULL) {
+            return SYS_ERR_OK;
+        }
+
+        errval_t err = event_dispatch(ws);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+}
+
+void vfs_io_handle_destroy(struct vfs_handle *h)
+{
+    if (h->ioq != NULL) {
+        errval_t err = vfs_io_drain(h);
+        assert(err_is_ok(err));
+        free(h->ioq);
+        h->ioq = NULL;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * \brief Read from an open file handle into several buffers
+ *
+ * Fills the buffers in order from the current file position, stopping at the
+ * first short read.
+ */
+errval_t vfs_readv(vfs_handle_t handle, const struct vfs_iovec *iov,
+                   size_t iovcnt, size_t *bytes_read)
+{
+    size_t total = 0;
+    errval_t err = SYS_ERR_OK;
+
+    for (size_t i = 0; i < iovcnt; i++) {
+        size_t done = 0;
+        err = vfs_read(handle, iov[i].base, iov[i].len, &done);
+        total += done;
+        if (err_is_fail(err) || done < iov[i].len) {
+            break;
+        }
+    }
+
+    if (bytes_read != NULL) {
+        *bytes_read = total;
+    }
+    return err;
+}
+
+/**
+ * \brief Write several buffers to an open file handle
+ */
+errval_t vfs_writev(vfs_handle_t handle, const struct vfs_iovec *iov,
+                    size_t iovcnt, size_t *bytes_written)
+{
+    size_t total = 0;
+    errval_t err = SYS_ERR_OK;
+
+    for (size_t i = 0; i < iovcnt; i++) {
+        size_t done = 0;
+        err = vfs_write(handle, iov[i].base, iov[i].len, &done);
+        total += done;
+        if (err_is_fail(err) || done < iov[i].len) {
+            break;
+        }
+    }
+
+    if (bytes_written != NULL) {
+        *bytes_written = total;
+    }
+    return err;
+}
@@ -30,18 +30,24 @@
 
 #include "vfs_backends.h"
 
-/// Define to enable asynchronous writes
-//#define ASYNC_WRITES
-
-#define MAX_NFS_READ_CHUNKS  40  // FIXME: Not used anymore, should be removed
-
-//#define NONBLOCKING_NFS_READ   1
 #define MAX_NFS_READ_BYTES   1330 /*14000*//*workaround for breakage in lwip*/
 
 #define MAX_NFS_WRITE_BYTES  1330 /* workaround for breakage in lwip */
-#define MAX_NFS_WRITE_CHUNKS 1    /* workaround for breakage in lwip */
 #define NFS_WRITE_STABILITY  UNSTABLE
 
+/// Max. bytes of UNSTABLE writes kept per handle before they are committed
+#define NFS_MAX_UNCOMMITTED  (1024 * 1024)
+
+/// Default max. number of READ/WRITE RPCs in flight per request or handle,
+/// can be changed with the window=N mount option
+#define NFS_DEFAULT_WINDOW   16
+#define NFS_MAX_WINDOW       64
+
+/// Sequential reads start read-ahead at the min. size, which then doubles
+/// with every further sequential read up to the max. size
+#define NFS_READAHEAD_MIN    (16 * 1024)
+#define NFS_READAHEAD_MAX    (256 * 1024)
+
 #define MIN(a,b) ((a)<(b)?(a):(b))
 #define assert_err(e,m)     \
 do {                        \
@@ -122,7 +128,24 @@ static void signal_condition(void)
         wait_flag = true;
     } else {
         assert(!thread_mutex_trylock(lwip_mutex));
-        thread_cond_signal(&wait_cond);
+        // all threads share the condition and each checks its own state
+        thread_cond_broadcast(&wait_cond);
+    }
+}
+
+/// Marks a one-shot operation as complete and wakes its waiter
+static void complete(volatile bool *done)
+{
+    *done = true;
+    signal_condition();
+}
+
+/// Blocks until the callback of a one-shot operation has called complete(),
+/// as other threads' replies also wake the waiters
+static void wait_for_completion(volatile bool *done)
+{
+    while (!*done) {
+        wait_for_condition();
     }
 }
 
@@ -248,11 +271,11 @@ struct nfs_file_io_handle {
     size_t      size;
     size_t      size_complete;
     nfs_fh3     handle;
-    int         chunk_count;
     size_t      chunk_pos;
     int         chunks_in_progress;
     nfsstat3    status;
-    struct nfs_handle *back_fh;
+    /// called when the last chunk completes, instead of signalling the waiter
+    void        (*done)(struct nfs_file_io_handle *fh);
 };
 
 struct nfs_file_parallel_io_handle {
@@ -264,14 +287,15 @@ struct nfs_file_parallel_io_handle {
 static void read_callback(void *arg, struct nfs_client *client, READ3res *result)
 {
     struct nfs_file_parallel_io_handle *pfh = arg;
+    struct nfs_file_io_handle *fh = pfh->fh;
 
     assert(result != NULL);
     uint64_t ts = rdtsc();
     // error
     if (result->status != NFS3_OK) {
-        pfh->fh->status = result->status;
+        fh->status = result->status;
+        fh->chunk_pos = fh->size; // don't issue any more chunks
         free(pfh);
-        signal_condition();
         goto out;
     }
 
@@ -280,16 +304,16 @@ static void read_callback(void *arg, struct nfs_client *client, READ3res *result
     assert(res->data.data_len <= pfh->chunk_size);
 
     // copy the data
-    memcpy((char *)pfh->fh->data + pfh->chunk_start, res->data.data_val,
+    memcpy((char *)fh->data + pfh->chunk_start, res->data.data_val,
            res->data.data_len);
-    pfh->fh->size_complete += res->data.data_len;
+    fh->size_complete += res->data.data_len;
 
     // is this the end of the file?
     if (res->eof) {
         // reduce the file size to match whatever we got and avoid useless calls
         size_t newsize = pfh->chunk_start + res->data.data_len;
-        if (pfh->fh->size > newsize) {
-            pfh->fh->size = newsize;
+        if (fh->size > newsize) {
+            fh->size = newsize;
         }
     }
     // check whether the whole chunk was transmitted
@@ -298,103 +322,448 @@ static void read_callback(void *arg, struct nfs_client *client, READ3res *result
         pfh->chunk_start += res->data.data_len;
         pfh->chunk_size -= res->data.data_len;
 
-        err_t e = nfs_read(client, pfh->fh->handle,
-                           pfh->fh->offset + pfh->chunk_start,
+        // still the same chunk, so chunks_in_progress is unchanged
+        err_t e = nfs_read(client, fh->handle, fh->offset + pfh->chunk_start,
                            pfh->chunk_size, read_callback, pfh);
         assert(e == ERR_OK);
-
-        goto out;
+        goto free_result;
     }
 
-    assert(pfh->fh->size >= pfh->fh->size_complete);
+    assert(fh->size >= fh->size_complete);
 
-    // check whether all chunks have been transmitted
-    if (pfh->fh->size == pfh->fh->size_complete) {
-        free(pfh);
-    }
-    // else create a new request
-    else if (pfh->fh->chunk_pos < pfh->fh->size) {
-        pfh->chunk_start =  pfh->fh->chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_READ_BYTES, pfh->fh->size - pfh->chunk_start);
-        pfh->fh->chunk_pos += pfh->chunk_size;
-        pfh->fh->chunks_in_progress++;
-        err_t r = nfs_read(client, pfh->fh->handle,
-                           pfh->fh->offset + pfh->chunk_start,
+    // reuse the state for the next chunk, if there is one
+    if (fh->chunk_pos < fh->size) {
+        pfh->chunk_start = fh->chunk_pos;
+        pfh->chunk_size = MIN(MAX_NFS_READ_BYTES, fh->size - pfh->chunk_start);
+        fh->chunk_pos += pfh->chunk_size;
+        err_t r = nfs_read(client, fh->handle, fh->offset + pfh->chunk_start,
                            pfh->chunk_size, read_callback, pfh);
         assert(r == ERR_OK);
-    } else {
-        free(pfh);
+        goto free_result;
     }
+    free(pfh);
 
 out:
-    pfh->fh->chunks_in_progress--;
+    fh->chunks_in_progress--;
 
     // allow the request thread to resume if we're the last chunk
-    if (pfh->fh->chunks_in_progress == 0) {
-        signal_condition();
+    if (fh->chunks_in_progress == 0) {
+        if (fh->done != NULL) {
+            fh->done(fh);
+        } else {
+            signal_condition();
+        }
     }
+
+free_result:
     // free arguments
     xdr_READ3res(&xdr_free, result);
     lwip_record_event_simple(NFS_READCB_T, ts);
 }
 
-static void write_callback(void *arg, struct nfs_client *client, WRITE3res *result)
+/// Start reading fh->size bytes at fh->offset, keeping up to one window of
+/// READ RPCs in flight. Must be called with the lwip mutex held.
+static void start_read(struct nfs_state *nfs, struct nfs_file_io_handle *fh)
 {
-    struct nfs_file_parallel_io_handle *pfh = arg;
+    while (fh->chunk_pos < fh->size && fh->chunks_in_progress < nfs->window) {
+        struct nfs_file_parallel_io_handle *pfh =
+            malloc(sizeof(struct nfs_file_parallel_io_handle));
+        assert(pfh != NULL);
 
-    assert(result != NULL);
+        pfh->fh = fh;
+        pfh->chunk_start = fh->chunk_pos;
+        pfh->chunk_size = MIN(MAX_NFS_READ_BYTES, fh->size - pfh->chunk_start);
 
-    // error
-    if (result->status != NFS3_OK) {
-        pfh->fh->status = result->status;
+        err_t e = nfs_read(nfs->client, fh->handle,
+                           fh->offset + pfh->chunk_start, pfh->chunk_size,
+                           read_callback, pfh);
+        if (e == ERR_MEM) { // internal resource limit in lwip
+            free(pfh);
+            if (fh->chunks_in_progress == 0) {
+                // nothing in flight to continue from, give up
+                fh->status = NFS3ERR_JUKEBOX;
+            }
+            // otherwise the remaining chunks are issued from read_callback
+            break;
+        }
+        assert(e == ERR_OK);
 
-#ifdef ASYNC_WRITES
-        printf("write_callback: NFS error status %d\n", result->status);
+        fh->chunk_pos += pfh->chunk_size;
+        fh->chunks_in_progress++;
+    }
+}
 
-        pfh->fh->back_fh->inflight--;
-        assert(pfh->fh->back_fh->inflight >= 0);
-        free(pfh->fh);
-#endif
+/* ------------------------------------------------------------------------- */
+/* read-ahead */
 
-        free(pfh);
+// read-ahead data of a file handle
+struct nfs_readahead {
+    struct nfs_file_io_handle fh;   ///< fh.data is the buffer; must be first
+    size_t requested;               ///< bytes asked for; fh.size shrinks at EOF
+    bool waiting;                   ///< reader is blocked on completion
+};
+
+static void readahead_done(struct nfs_file_io_handle *fh)
+{
+    struct nfs_readahead *ra = (struct nfs_readahead *)fh;
+
+    // nobody may be waiting yet, in which case there is no one to signal
+    if (ra->waiting) {
         signal_condition();
+    }
+}
+
+static void readahead_wait(struct nfs_readahead *ra)
+{
+    while (ra->fh.chunks_in_progress > 0) {
+        ra->waiting = true;
+        wait_for_condition();
+        ra->waiting = false;
+    }
+}
+
+static void readahead_discard(struct nfs_handle *h)
+{
+    struct nfs_readahead *ra = h->u.file.ra;
+
+    if (ra != NULL) {
+        readahead_wait(ra); // outstanding RPCs refer to the buffer
+        free(ra->fh.data);
+        free(ra);
+        h->u.file.ra = NULL;
+    }
+}
+
+static void readahead_start(struct nfs_state *nfs, struct nfs_handle *h,
+                            size_t offset, size_t size)
+{
+    assert(h->u.file.ra == NULL);
+
+    // read-ahead is an optimisation, so just skip it if memory is short
+    struct nfs_readahead *ra = calloc(1, sizeof(struct nfs_readahead));
+    if (ra == NULL) {
+        return;
+    }
+    ra->fh.data = malloc(size);
+    if (ra->fh.data == NULL) {
+        free(ra);
+        return;
+    }
+
+    ra->fh.offset = offset;
+    ra->fh.size = size;
+    ra->fh.status = NFS3_OK;
+    ra->fh.handle = h->fh;
+    ra->fh.done = readahead_done;
+    ra->requested = size;
+
+    start_read(nfs, &ra->fh);
+    h->u.file.ra = ra;
+}
+
+/**
+ * \brief Copy data at the file position out of the read-ahead buffer
+ *
+ * Waits for the read-ahead to complete if it covers the file position, and
+ * discards it once it is used up or if it is of no use.
+ *
+ * \returns Number of bytes copied. *eof is set if the buffer was used up and
+ *          ended at the end of the file.
+ */
+static size_t readahead_consume(struct nfs_handle *h, void *buffer,
+                                size_t bytes, bool *eof)
+{
+    struct nfs_readahead *ra = h->u.file.ra;
+    size_t pos = h->u.file.pos;
+
+    *eof = false;
+    if (ra == NULL) {
+        return 0;
+    }
+
+    if (pos < ra->fh.offset || pos >= ra->fh.offset + ra->requested) {
+        readahead_discard(h);
+        return 0;
+    }
+
+    readahead_wait(ra);
+    if (ra->fh.status != NFS3_OK) {
+        // let the synchronous path retry and report the error
+        readahead_discard(h);
+        return 0;
+    }
+
+    size_t end = ra->fh.offset + ra->fh.size;
+    size_t copied = 0;
+    if (pos < end) {
+        copied = MIN(bytes, end - pos);
+        memcpy(buffer, (char *)ra->fh.data + (pos - ra->fh.offset), copied);
+    }
+
+    if (pos + copied >= end) {
+        *eof = ra->fh.size < ra->requested;
+        readahead_discard(h);
+    }
+
+    return copied;
+}
+
+/// Adapt the read-ahead size to the access pattern, and start the next
+/// read-ahead if reads are sequential. Must be called with the lwip mutex held.
+static void readahead_update(struct nfs_state *nfs, struct nfs_handle *h,
+                             size_t offset, size_t bytes, bool eof)
+{
+    if (offset == h->u.file.seq_next) {
+        size_t size = h->u.file.ra_size * 2;
+        h->u.file.ra_size = size < NFS_READAHEAD_MIN ? NFS_READAHEAD_MIN
+                                                     : MIN(size, NFS_READAHEAD_MAX);
+    } else {
+        // random access, read-ahead would only waste bandwidth
+        h->u.file.ra_size = 0;
+        readahead_discard(h);
+    }
+    h->u.file.seq_next = offset + bytes;
+
+    if (h->u.file.ra_size > 0 && h->u.file.ra == NULL && !eof) {
+        readahead_start(nfs, h, h->u.file.seq_next, h->u.file.ra_size);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* write-behind */
+
+// one WRITE RPC of the write-behind path; UNSTABLE writes are kept after the
+// reply until they are committed, to send them again if the server restarts
+struct nfs_wb_chunk {
+    struct nfs_handle *h;
+    struct nfs_wb_chunk *next;  ///< next uncommitted chunk of the handle
+    enum stable_how stable;
+    size_t offset;
+    size_t len;
+    size_t done;                ///< bytes acknowledged by the server
+    uint8_t data[];             ///< copy of the caller's data
+};
+
+/// Record the first error of an outstanding write, to report it later
+static void writebehind_fail(struct nfs_handle *h, nfsstat3 status)
+{
+    if (h->u.file.wb_status == NFS3_OK) {
+        h->u.file.wb_status = status;
+    }
+}
+
+/// Compare a verifier returned by the server with that of the first write
+static void writebehind_verf(struct nfs_handle *h, writeverf3 verf)
+{
+    // a changed verifier means that the server restarted, and may have lost
+    // earlier unstable writes
+    if (!h->u.file.wb_verf_valid) {
+        memcpy(h->u.file.wb_verf, verf, NFS3_WRITEVERFSIZE);
+        h->u.file.wb_verf_valid = true;
+    } else if (memcmp(h->u.file.wb_verf, verf, NFS3_WRITEVERFSIZE) != 0) {
+        h->u.file.wb_verf_changed = true;
+    }
+}
+
+static void writebehind_callback(void *arg, struct nfs_client *client,
+                                 WRITE3res *result)
+{
+    struct nfs_wb_chunk *c = arg;
+    struct nfs_handle *h = c->h;
+
+    if (result == NULL) {
+        writebehind_fail(h, NFS3ERR_IO);
+        free(c);
+        goto done;
+    }
+
+    if (result->status != NFS3_OK) {
+        writebehind_fail(h, result->status);
+        free(c);
         goto out;
     }
 
     WRITE3resok *res = &result->WRITE3res_u.resok;
-    assert(res->count == pfh->chunk_size);
-    pfh->fh->size_complete += res->count;
 
-    assert(pfh->fh->size >= pfh->fh->size_complete);
+    writebehind_verf(h, res->verf);
 
-    // check whether all chunks have been transmitted
-    if (pfh->fh->size == pfh->fh->size_complete) {
-#ifdef ASYNC_WRITES
-        pfh->fh->back_fh->inflight--;
-        assert(pfh->fh->back_fh->inflight >= 0);
-        free(pfh->fh);
-#endif
+    c->done += res->count;
+    if (res->count > 0 && c->done < c->len) { // short write, send the rest
+        err_t e = nfs_write(client, h->fh, c->offset + c->done,
+                            c->data + c->done, c->len - c->done,
+                            c->stable, writebehind_callback, c);
+        assert(e == ERR_OK);
+        xdr_WRITE3res(&xdr_free, result);
+        return;
+    } else if (c->done < c->len) {
+        writebehind_fail(h, NFS3ERR_IO);
+        free(c);
+    } else if (res->committed != FILE_SYNC) {
+        if (c->stable == FILE_SYNC) { // server did not honour the request
+            writebehind_fail(h, NFS3ERR_IO);
+            free(c);
+        } else {
+            c->next = h->u.file.wb_uncommitted;
+            h->u.file.wb_uncommitted = c;
+            h->u.file.wb_uncommitted_bytes += c->len;
+        }
+    } else {
+        free(c);
+    }
 
+out:
+    xdr_WRITE3res(&xdr_free, result);
+done:
+    h->u.file.wb_inflight--;
+    assert(h->u.file.wb_inflight >= 0);
+    if (h->u.file.wb_waiting) {
         signal_condition();
-        free(pfh);
     }
-    // else create a new request
-    else if (pfh->fh->chunk_pos < pfh->fh->size) {
-        pfh->chunk_start = pfh->fh->chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_WRITE_BYTES, pfh->fh->size - pfh->chunk_start);
-        pfh->fh->chunk_pos += pfh->chunk_size;
-        err_t r = nfs_write(client, pfh->fh->handle,
-                            pfh->fh->offset + pfh->chunk_start,
-                            (char *)pfh->fh->data + pfh->chunk_start, pfh->chunk_size,
-                            NFS_WRITE_STABILITY, write_callback, pfh);
-        assert(r == ERR_OK);
+}
+
+static void commit_callback(void *arg, struct nfs_client *client,
+                            COMMIT3res *result)
+{
+    struct nfs_handle *h = arg;
+
+    if (result == NULL) {
+        writebehind_fail(h, NFS3ERR_IO);
     } else {
-        free(pfh);
+        if (result->status != NFS3_OK) {
+            writebehind_fail(h, result->status);
+        } else {
+            writebehind_verf(h, result->COMMIT3res_u.resok.verf);
+        }
+        xdr_COMMIT3res(&xdr_free, result);
     }
 
-out:
-    // free arguments
-    xdr_WRITE3res(&xdr_free, result);
+    h->u.file.wb_inflight--;
+    if (h->u.file.wb_waiting) {
+        signal_condition();
+    }
+}
+
+/// Block until at most max RPCs of the write-behind path are outstanding
+static void writebehind_wait(struct nfs_handle *h, int max)
+{
+    while (h->u.file.wb_inflight > max) {
+        h->u.file.wb_waiting = true;
+        wait_for_condition();
+        h->u.file.wb_waiting = false;
+    }
+}
+
+/// Return and clear the first error of the write-behind path
+static errval_t writebehind_error(struct nfs_handle *h)
+{
+    nfsstat3 status = h->u.file.wb_status;
+    h->u.file.wb_status = NFS3_OK;
+    return status == NFS3_OK ? SYS_ERR_OK : nfsstat_to_errval(status);
+}
+
+/// Wait for all outstanding writes, so that the server has seen them
+static errval_t writebehind_drain(struct nfs_handle *h)
+{
+    writebehind_wait(h, 0);
+    return writebehind_error(h);
+}
+
+/// Send a chunk, keeping at most one window of writes in flight
+static errval_t writebehind_send(struct nfs_state *nfs, struct nfs_wb_chunk *c)
+{
+    struct nfs_handle *h = c->h;
+
+    while (true) {
+        writebehind_wait(h, nfs->window - 1);
+
+        err_t e = nfs_write(nfs->client, h->fh, c->offset + c->done,
+                            c->data + c->done, c->len - c->done, c->stable,
+                            writebehind_callback, c);
+        if (e == ERR_MEM) { // internal resource limit in lwip
+            if (h->u.file.wb_inflight == 0) {
+                return NFS_ERR_TRANSPORT;
+            }
+            // retry once a reply has freed up some resources
+            writebehind_wait(h, h->u.file.wb_inflight - 1);
+            continue;
+        }
+        assert(e == ERR_OK);
+
+        h->u.file.wb_inflight++;
+        return SYS_ERR_OK;
+    }
+}
+
+/// Send all uncommitted writes again, to stable storage this time
+static void writebehind_resend(struct nfs_state *nfs, struct nfs_handle *h)
+{
+    struct nfs_wb_chunk *list = h->u.file.wb_uncommitted;
+    h->u.file.wb_uncommitted = NULL;
+    h->u.file.wb_uncommitted_bytes = 0;
+
+    while (list != NULL) {
+        struct nfs_wb_chunk *c = list;
+        list = c->next;
+        c->stable = FILE_SYNC;
+        c->done = 0;
+        errval_t err = writebehind_send(nfs, c);
+        if (err_is_fail(err)) {
+            writebehind_fail(h, NFS3ERR_IO);
+            free(c);
+        }
+    }
+    writebehind_wait(h, 0);
+}
+
+/// Free the uncommitted writes of a handle
+static void writebehind_discard(struct nfs_handle *h)
+{
+    while (h->u.file.wb_uncommitted != NULL) {
+        struct nfs_wb_chunk *c = h->u.file.wb_uncommitted;
+        h->u.file.wb_uncommitted = c->next;
+        free(c);
+    }
+    h->u.file.wb_uncommitted_bytes = 0;
+}
+
+/// Wait for all outstanding writes and commit them to stable storage, with
+/// a single COMMIT for all UNSTABLE writes since the last flush. If the
+/// server restarted in the meantime, the uncommitted writes are sent again.
+static errval_t writebehind_flush(struct nfs_state *nfs, struct nfs_handle *h)
+{
+    writebehind_wait(h, 0);
+
+    if (h->u.file.wb_uncommitted != NULL && !h->u.file.wb_verf_changed
+        && h->u.file.wb_status == NFS3_OK) {
+        err_t e = nfs_commit(nfs->client, h->fh, 0, 0, commit_callback, h);
+        assert(e == ERR_OK);
+        h->u.file.wb_inflight++;
+        writebehind_wait(h, 0);
+    }
+
+    if (h->u.file.wb_verf_changed && h->u.file.wb_status == NFS3_OK) {
+        writebehind_resend(nfs, h);
+    }
+
+    writebehind_discard(h);
+    h->u.file.wb_verf_valid = false;
+    h->u.file.wb_verf_changed = false;
+    return writebehind_error(h);
+}
+
+static void init_file_state(struct nfs_handle *h)
+{
+    h->u.file.pos = 0;
+    h->u.file.ra = NULL;
+    h->u.file.seq_next = 0;
+    h->u.file.ra_size = 0;
+    h->u.file.wb_inflight = 0;
+    h->u.file.wb_waiting = false;
+    h->u.file.wb_uncommitted = NULL;
+    h->u.file.wb_uncommitted_bytes = 0;
+    h->u.file.wb_verf_valid = false;
+    h->u.file.wb_verf_changed = false;
+    h->u.file.wb_status = NFS3_OK;
 }
 
 static void open_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
@@ -410,7 +779,7 @@ static void open_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
         }
     }
 
-    signal_condition();
+    complete(&h->op_done);
 }
 
 static errval_t open(void *st, const char *path, vfs_handle_t *rethandle)
@@ -420,20 +789,18 @@ static errval_t open(void *st, const char *path, vfs_handle_t *rethandle)
     assert(h != NULL);
 
     h->isdir = false;
-    h->u.file.pos = 0;
+    init_file_state(h);
     h->nfs = nfs;
     h->fh = NULL_NFS_FH;
-#ifdef ASYNC_WRITES
-    h->inflight = 0;
-#endif
 #ifdef WITH_META_DATA_CACHE
     h->filesize_cached = false;
     h->cached_filesize = 0;
 #endif
 
     lwip_mutex_lock();
+    h->op_done = false;
     initiate_resolve(nfs, path, open_resolve_cont, h);
-    wait_for_condition();
+    wait_for_completion(&h->op_done);
     lwip_mutex_unlock();
 
     if (h->fh.data_len > 0 && h->type != NF3DIR) {
@@ -468,7 +835,7 @@ static void create_callback(void *arg, struct nfs_client *client,
         debug_printf("Error in create_callback %d\n", result->status);
     }
 
-    signal_condition();
+    complete(&h->op_done);
 }
 
 static void create_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
@@ -479,7 +846,7 @@ static void create_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
     if (err_is_fail(err) || (fattr != NULL && fattr->type != NF3DIR)) {
         DEBUG_ERR(err, "failure in create_resolve_cont");
         // FIXME: failed to lookup directory. return meaningful error
-        signal_condition();
+        complete(&h->op_done);
         return;
     }
 
@@ -512,22 +879,20 @@ static errval_t create(void *st, const char *path, vfs_handle_t *rethandle)
     assert(h != NULL);
 
     h->isdir = false;
-    h->u.file.pos = 0;
+    init_file_state(h);
     h->nfs = nfs;
     h->fh = NULL_NFS_FH;
     h->st = filename;
     h->fh.data_len = 0;
-#ifdef ASYNC_WRITES
-    h->inflight = 0;
-#endif
 #ifdef WITH_META_DATA_CACHE
     h->filesize_cached = false;
     h->cached_filesize = 0;
 #endif
 
     lwip_mutex_lock();
+    h->op_done = false;
     initiate_resolve(nfs, dir, create_resolve_cont, h);
-    wait_for_condition();
+    wait_for_completion(&h->op_done);
     lwip_mutex_unlock();
 
     free(dir);
@@ -553,9 +918,6 @@ static errval_t opendir(void *st, const char *path, vfs_handle_t *rethandle)
     h->u.dir.readdir_prev = NULL;
     h->nfs = nfs;
     h->fh = NULL_NFS_FH;
-#ifdef ASYNC_WRITES
-    h->inflight = 0;
-#endif
 
     // skip leading '/'s
     while (*path == VFS_PATH_SEP) {
@@ -571,8 +933,9 @@ static errval_t opendir(void *st, const char *path, vfs_handle_t *rethandle)
     }
 
     lwip_mutex_lock();
+    h->op_done = false;
     initiate_resolve(nfs, path, open_resolve_cont, h);
-    wait_for_condition();
+    wait_for_completion(&h->op_done);
     lwip_mutex_unlock();
 
     if (h->fh.data_len > 0 && h->type == NF3DIR) {
@@ -591,77 +954,63 @@ static errval_t read(void *st, vfs_handle_t inhandle, void *buffer,
     struct nfs_state *nfs = st;
     struct nfs_handle *h = inhandle;
     assert(h != NULL);
-    err_t e;
+    errval_t err;
 
     assert(!h->isdir);
 
-    // set up the handle
-    struct nfs_file_io_handle fh;
-    memset(&fh, 0, sizeof(struct nfs_file_io_handle));
-
-    fh.data = buffer;
-    fh.size = bytes;
-    fh.offset = h->u.file.pos;
-    fh.status = NFS3_OK;
-    fh.handle = h->fh;
-    fh.chunks_in_progress = 0;
-
     lwip_mutex_lock();
 
-    // start a parallel load of the file, wait for it to complete
-    int chunks = 0;
-    while (fh.chunk_pos < fh.size && chunks < MAX_NFS_READ_CHUNKS) {
-//    while (fh.chunk_pos < fh.size) {
-        struct nfs_file_parallel_io_handle *pfh =
-            malloc(sizeof(struct nfs_file_parallel_io_handle));
-
-        pfh->fh = &fh;
-        pfh->chunk_start = fh.chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_READ_BYTES, fh.size - pfh->chunk_start);
-        fh.chunk_pos += pfh->chunk_size;
+    // the server must have seen our own writes before we read
+    err = writebehind_drain(h);
+    if (err_is_fail(err)) {
+        lwip_mutex_unlock();
+        return err;
+    }
 
-        fh.chunks_in_progress++;
-        e = nfs_read(nfs->client, fh.handle, fh.offset + pfh->chunk_start,
-                     pfh->chunk_size, read_callback, pfh);
+    size_t offset = h->u.file.pos;
+    bool eof;
+    size_t done = readahead_consume(h, buffer, bytes, &eof);
+
+    if (done < bytes && !eof) {
+        // set up the handle
+        struct nfs_file_io_handle fh;
+        memset(&fh, 0, sizeof(struct nfs_file_io_handle));
+
+        fh.data = (char *)buffer + done;
+        fh.size = bytes - done;
+        fh.offset = offset + done;
+        fh.status = NFS3_OK;
+        fh.handle = h->fh;
+
+        // start a parallel load of the file, wait for it to complete
+        start_read(nfs, &fh);
+        lwip_record_event_simple(NFS_READ_1_T, ts);
+        uint64_t ts1 = rdtsc();
+        while (fh.chunks_in_progress > 0) {
+            wait_for_condition();
+        }
+        lwip_record_event_simple(NFS_READ_w_T, ts1);
 
-        if (e == ERR_MEM) { // internal resource limit in lwip?
-            printf("read: error in nfs_read ran out of mem!!!\n");
-            printf("read: error chunks %d in progress %d!!!\n",
-                    chunks, (int)fh.chunks_in_progress);
-            fh.chunk_pos -= pfh->chunk_size;
-            free(pfh);
-            break;
+        // check result
+        if (fh.status != NFS3_OK) {
+            lwip_mutex_unlock();
+            return nfsstat_to_errval(fh.status);
         }
-        assert(e == ERR_OK);
-        chunks++;
-#ifdef NONBLOCKING_NFS_READ
-        check_and_handle_other_events();
-#endif // NONBLOCKING_NFS_READ
+
+        assert(fh.size <= bytes - done);
+        eof = fh.size < bytes - done;
+        done += fh.size;
     }
-    lwip_record_event_simple(NFS_READ_1_T, ts);
-    uint64_t ts1 = rdtsc();
-    wait_for_condition();
-    lwip_record_event_simple(NFS_READ_w_T, ts1);
 
-    lwip_mutex_unlock();
+    readahead_update(nfs, h, offset, done, eof);
 
-    // check result
-    if (fh.status != NFS3_OK) {
-  //      printf("read:vfs_nfs: fh.status issue %u\n", fh.status);
-        return nfsstat_to_errval(fh.status);
-    }
+    lwip_mutex_unlock();
 
-    assert(fh.size <= bytes);
-    h->u.file.pos += fh.size;
-    *bytes_read = fh.size;
+    h->u.file.pos += done;
+    *bytes_read = done;
 
     lwip_record_event_simple(NFS_READ_T, ts);
-    if (fh.size == 0) {
-        /* XXX: assuming this means EOF, but we really do know from NFS */
-/*        printf("read:vfs_nfs: EOF marking %"PRIuPTR" < %"PRIuPTR","
-                "parallel NFS chunks [%u]\n",
-                fh.size, bytes, MAX_NFS_READ_CHUNKS);
-*/
+    if (done == 0) {
         return VFS_ERR_EOF;
     } else {
         return SYS_ERR_OK;
@@ -674,92 +1023,61 @@ static errval_t write(void *st, vfs_handle_t handle, const void *buffer,
     struct nfs_state *nfs = st;
     struct nfs_handle *h = handle;
     assert(h != NULL);
-    err_t e;
-
-    #if 0
-    if((__builtin_return_address(2) < (void *)fclose ||
-        __builtin_return_address(2) > (void *)memcpy) &&
-       (__builtin_return_address(3) < (void *)fclose ||
-        __builtin_return_address(3) > (void *)memcpy) &&
-       (__builtin_return_address(4) < (void *)fclose ||
-        __builtin_return_address(4) > (void *)memcpy)) {
-        printf("vfs_nfs->write called not from fclose()! %p, %p, %p, %p\n",
-               __builtin_return_address(0),
-               __builtin_return_address(1),
-               __builtin_return_address(2),
-               __builtin_return_address(3));
-    }
-    #endif
+    errval_t err;
 
     assert(!h->isdir);
 
-    // set up the handle
-#ifndef ASYNC_WRITES
-    struct nfs_file_io_handle the_fh;
-    struct nfs_file_io_handle *fh = &the_fh;
-#else
-    struct nfs_file_io_handle *fh = malloc(sizeof(struct nfs_file_io_handle));
-    assert(fh != NULL);
-#endif
-    memset(fh, 0, sizeof(struct nfs_file_io_handle));
-
-#ifdef ASYNC_WRITES
-    fh->data = malloc(bytes);
-    assert(fh->data != NULL);
-    memcpy(fh->data, buffer, bytes);
-    h->inflight++;
-#else
-    fh->data = (void *)buffer;
-#endif
-    fh->size = bytes;
-    fh->offset = h->u.file.pos;
-    fh->status = NFS3_OK;
-    fh->handle = h->fh;
-    fh->back_fh = h;
-
     lwip_mutex_lock();
 
-    // start a parallel write of the file, wait for it to complete
-    int chunks = 0;
-    do {
-        struct nfs_file_parallel_io_handle *pfh =
-            malloc(sizeof(struct nfs_file_parallel_io_handle));
-        pfh->fh = fh;
-        pfh->fh->chunks_in_progress = 0;
-        pfh->chunk_start = fh->chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_WRITE_BYTES, fh->size - pfh->chunk_start);
-        fh->chunk_pos += pfh->chunk_size;
-        e = nfs_write(nfs->client, fh->handle, fh->offset + pfh->chunk_start,
-                      (char *)fh->data + pfh->chunk_start, pfh->chunk_size,
-                      NFS_WRITE_STABILITY, write_callback, pfh);
-        assert(e == ERR_OK);
-        chunks++;
-    } while (fh->chunk_pos < fh->size && chunks < MAX_NFS_WRITE_CHUNKS);
-#ifndef ASYNC_WRITES
-    wait_for_condition();
-#endif
+    // buffered read-ahead data may be stale after this write
+    readahead_discard(h);
 
-    lwip_mutex_unlock();
+    // report errors of earlier writes, and commit them once enough data
+    // is kept to send again
+    if (h->u.file.wb_uncommitted_bytes >= NFS_MAX_UNCOMMITTED) {
+        err = writebehind_flush(nfs, h);
+    } else {
+        err = writebehind_error(h);
+    }
+    if (err_is_fail(err)) {
+        lwip_mutex_unlock();
+        return err;
+    }
 
-#ifndef ASYNC_WRITES
-    // check result
-    if (fh->status != NFS3_OK && fh->status != NFS3ERR_STALE) {
-        printf("NFS Error: %d\n", fh->status);
-        return nfsstat_to_errval(fh->status);
+    // copy the data and send it off, keeping at most one window of writes in
+    // flight; errors are reported by the next write, flush or close
+    size_t done = 0;
+    while (done < bytes) {
+        size_t len = MIN(MAX_NFS_WRITE_BYTES, bytes - done);
+
+        struct nfs_wb_chunk *c = malloc(sizeof(struct nfs_wb_chunk) + len);
+        if (c == NULL) {
+            err = LIB_ERR_MALLOC_FAIL;
+            break;
+        }
+        c->h = h;
+        c->next = NULL;
+        c->stable = NFS_WRITE_STABILITY;
+        c->offset = h->u.file.pos + done;
+        c->len = len;
+        c->done = 0;
+        memcpy(c->data, (const char *)buffer + done, len);
+
+        err = writebehind_send(nfs, c);
+        if (err_is_fail(err)) {
+            free(c);
+            break;
+        }
+        done += len;
     }
 
-    assert(fh->size <= bytes);
-    h->u.file.pos += fh->size;
-    *bytes_written = fh->size;
-#else
-    // This always assumes it succeeded. We'll see failures at file close time.
-    h->u.file.pos += bytes;
-    *bytes_written = bytes;
-#endif
+    lwip_mutex_unlock();
 
-    return SYS_ERR_OK;
-}
+    h->u.file.pos += done;
+    *bytes_written = done;
 
+    return err;
+}
 
 static void setattr_callback(void *arg, struct nfs_client *client,
                              SETATTR3res *result)
@@ -769,7 +1087,7 @@ static void setattr_callback(void *arg, struct nfs_client *client,
     xdr_SETATTR3res(&xdr_free, result);
     assert(result->status == NFS3_OK);
 
-    signal_condition();
+    complete(arg);
 }
 
 
@@ -784,6 +1102,15 @@ static errval_t truncate(void *st, vfs_handle_t handle, size_t bytes)
     err_t e;
 
     lwip_mutex_lock();
+
+    readahead_discard(h);
+    // commit earlier writes, so that none is sent again after the truncation
+    errval_t err = writebehind_flush(nfs, h);
+    if (err_is_fail(err)) {
+        lwip_mutex_unlock();
+        return err;
+    }
+
     // We only set the size field for now
 
     sattr3 new_attributes;
@@ -796,11 +1123,12 @@ static errval_t truncate(void *st, vfs_handle_t handle, size_t bytes)
     new_attributes.size.set_size3_u.size = bytes;
 
 
+    volatile bool done = false;
     e = nfs_setattr(nfs->client, h->fh,
                     new_attributes, false,
-                    setattr_callback, NULL);
+                    setattr_callback, (void *)&done);
     assert(e == ERR_OK);
-    wait_for_condition();
+    wait_for_completion(&done);
     lwip_mutex_unlock();
 
     return SYS_ERR_OK;
@@ -818,10 +1146,17 @@ static enum vfs_filetype nfs_type_to_vfs_type(enum ftype3 type)
     }
 }
 
+// state of a GETATTR, possibly after a LOOKUP
+struct getattr_state {
+    struct vfs_fileinfo *info;
+    volatile bool done;
+};
+
 static void getattr_callback(void *arg, struct nfs_client *client,
                              GETATTR3res *result)
 {
-    struct vfs_fileinfo *info = arg;
+    struct getattr_state *gs = arg;
+    struct vfs_fileinfo *info = gs->info;
 
     assert(result != NULL);
     if (result->status == NFS3_OK) {
@@ -838,7 +1173,7 @@ static void getattr_callback(void *arg, struct nfs_client *client,
 
     xdr_GETATTR3res(&xdr_free, result);
 
-    signal_condition();
+    complete(&gs->done);
 }
 
 static errval_t tell(void *st, vfs_handle_t handle, size_t *pos)
@@ -857,9 +1192,20 @@ static errval_t stat(void *st, vfs_handle_t inhandle, struct vfs_fileinfo *info)
     err_t e;
 
     lwip_mutex_lock();
-    e = nfs_getattr(nfs->client, h->fh, getattr_callback, info);
+
+    // the size must include our own outstanding writes
+    if (!h->isdir) {
+        errval_t err = writebehind_drain(h);
+        if (err_is_fail(err)) {
+            lwip_mutex_unlock();
+            return err;
+        }
+    }
+
+    struct getattr_state gs = { .info = info, .done = false };
+    e = nfs_getattr(nfs->client, h->fh, getattr_callback, &gs);
     assert(e == ERR_OK);
-    wait_for_condition();
+    wait_for_completion(&gs.done);
     lwip_mutex_unlock();
 
     assert(h->isdir == (info->type == VFS_DIRECTORY));
@@ -920,7 +1266,7 @@ static void readdir_callback(void *arg, struct nfs_client *client,
     h->u.dir.readdir_next = result->READDIR3res_u.resok.reply.entries;
     h->u.dir.readdir_prev = NULL;
 
-    signal_condition();
+    complete(&h->op_done);
 }
 
 static void get_info_lookup_cb(void *arg, struct nfs_client *client,
@@ -959,6 +1305,7 @@ top:
         lwip_mutex_unlock();
         return FS_ERR_INDEX_BOUNDS; // end of list
     } else {
+        h->op_done = false;
 
         if (h->u.dir.readdir_result != NULL) { // subsequent call
             struct READDIR3res *oldresult = h->u.dir.readdir_result;
@@ -978,7 +1325,7 @@ top:
             assert(e == ERR_OK);
         }
 
-        wait_for_condition();
+        wait_for_completion(&h->op_done);
 
         entry = h->u.dir.readdir_next;
         h->u.dir.readdir_prev = entry;
@@ -1000,10 +1347,11 @@ top:
         }
         if (info != NULL) {
             // initiate a lookup/getattr call to find out this information
+            struct getattr_state gs = { .info = info, .done = false };
             e = nfs_lookup(nfs->client, h->fh, entry->name, get_info_lookup_cb,
-                           info);
+                           &gs);
             assert(e == ERR_OK);
-            wait_for_condition();
+            wait_for_completion(&gs.done);
         }
         lwip_mutex_unlock();
         return SYS_ERR_OK;
@@ -1012,20 +1360,31 @@ top:
 
 static errval_t close(void *st, vfs_handle_t inhandle)
 {
+    struct nfs_state *nfs = st;
     struct nfs_handle *h = inhandle;
     assert(!h->isdir);
 
-#ifdef ASYNC_WRITES
-    while(h->inflight > 0) {
-        wait_for_condition();
-    }
-
-    // XXX: Errors ignored for now. Will be reported by handler functions though.
-#endif
+    lwip_mutex_lock();
+    readahead_discard(h);
+    errval_t err = writebehind_flush(nfs, h);
+    lwip_mutex_unlock();
 
     nfs_freefh(h->fh);
     free(h);
-    return SYS_ERR_OK;
+    return err;
+}
+
+static errval_t flush(void *st, vfs_handle_t inhandle)
+{
+    struct nfs_state *nfs = st;
+    struct nfs_handle *h = inhandle;
+    assert(!h->isdir);
+
+    lwip_mutex_lock();
+    errval_t err = writebehind_flush(nfs, h);
+    lwip_mutex_unlock();
+
+    return err;
 }
 
 static errval_t closedir(void *st, vfs_handle_t inhandle)
@@ -1050,7 +1409,7 @@ static void remove_callback(void *arg, struct nfs_client *client,
     // XXX: Should find better way to report error
     h->fh.data_len = result->status;
 
-    signal_condition();
+    complete(&h->op_done);
 }
 
 static void remove_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
@@ -1061,7 +1420,7 @@ static void remove_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
     if (err_is_fail(err) || (fattr != NULL && fattr->type != NF3DIR)) {
         DEBUG_ERR(err, "failure in remove_resolve_cont");
         // FIXME: failed to lookup directory. return meaningful error
-        signal_condition();
+        complete(&h->op_done);
         return;
     }
 
@@ -1097,13 +1456,11 @@ static errval_t vfs_nfs_remove(void *st, const char *path)
     h->fh = NULL_NFS_FH;
     h->st = filename;
     h->fh.data_len = 0;
-#ifdef ASYNC_WRITES
-    h->inflight = 0;
-#endif
 
     lwip_mutex_lock();
+    h->op_done = false;
     initiate_resolve(nfs, dir, remove_resolve_cont, h);
-    wait_for_condition();
+    wait_for_completion(&h->op_done);
     lwip_mutex_unlock();
 
     size_t err = h->fh.data_len;
@@ -1127,6 +1484,7 @@ struct mkdir_state {
     struct nfs_client *client;
     const char *dirname;
     errval_t err;
+    volatile bool done;
 };
 
 static void mkdir_callback(void *arg, struct nfs_client *client,
@@ -1138,7 +1496,7 @@ static void mkdir_callback(void *arg, struct nfs_client *client,
 
     st->err = nfsstat_to_errval(result->status);
 
-    signal_condition();
+    complete(&st->done);
 }
 
 static void mkdir_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
@@ -1153,7 +1511,7 @@ static void mkdir_resolve_cont(void *st, errval_t err, struct nfs_fh3 fh,
         } else {
             s->err = FS_ERR_NOTDIR;
         }
-        signal_condition();
+        complete(&s->done);
         return;
     }
 
@@ -1188,11 +1546,12 @@ static errval_t mkdir(void *st, const char *path)
         .dirname = dirname,
         .client = nfs->client,
         .err = SYS_ERR_OK,
+        .done = false,
     };
 
     lwip_mutex_lock();
     initiate_resolve(nfs, parent, mkdir_resolve_cont, &state);
-    wait_for_condition();
+    wait_for_completion(&state.done);
     lwip_mutex_unlock();
 
     free(parent);
@@ -1243,7 +1602,6 @@ static errval_t read_block(void *st, vfs_handle_t inhandle, void *buffer,
     struct nfs_state *nfs = st;
     struct nfs_handle *h = inhandle;
     assert(h != NULL);
-    err_t e;
 
     assert(!h->isdir);
 
@@ -1260,29 +1618,13 @@ static errval_t read_block(void *st, vfs_handle_t inhandle, void *buffer,
 
     lwip_mutex_lock();
 
-    // start a parallel load of the file, wait for it to complete
-    int chunks = 0;
-    while (fh.chunk_pos < fh.size && chunks < MAX_NFS_READ_CHUNKS) {
-//    while (fh.chunk_pos < fh.size) {
-        struct nfs_file_parallel_io_handle *pfh =
-            malloc(sizeof(struct nfs_file_parallel_io_handle));
+    writebehind_wait(h, 0);
 
-        pfh->fh = &fh;
-        pfh->chunk_start = fh.chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_READ_BYTES, fh.size - pfh->chunk_start);
-        fh.chunk_pos += pfh->chunk_size;
-        fh.chunks_in_progress++;
-        e = nfs_read(nfs->client, fh.handle, fh.offset + pfh->chunk_start,
-                     pfh->chunk_size, read_callback, pfh);
-        if (e == ERR_MEM) { // internal resource limit in lwip?
-            fh.chunk_pos -= pfh->chunk_size;
-            free(pfh);
-            break;
-        }
-        assert(e == ERR_OK);
-        chunks++;
-    } // end while
-    wait_for_condition();
+    // start a parallel load of the file, wait for it to complete
+    start_read(nfs, &fh);
+    while (fh.chunks_in_progress > 0) {
+        wait_for_condition();
+    }
 
     lwip_mutex_unlock();
 
@@ -1302,77 +1644,195 @@ static errval_t read_block(void *st, vfs_handle_t inhandle, void *buffer,
     }
 }
 
-#if 0
-static errval_t write_block(void *st, vfs_handle_t handle, const void *buffer,
-                            size_t bytes, size_t *bytes_written)
+#endif
+
+static void
+mount_callback (void *arg, struct nfs_client *client, enum mountstat3 mountstat,
+                struct nfs_fh3 fhandle)
 {
-    struct nfs_state *nfs = st;
-    struct nfs_handle *h = handle;
-    assert(h != NULL);
-    err_t e;
+    struct nfs_state *st = arg;
 
-    assert(!h->isdir);
+    st->mountstat = mountstat;
 
-    // set up the handle
-    struct nfs_file_io_handle fh;
-    memset(&fh, 0, sizeof(struct nfs_file_io_handle));
+    // save the root dir handle
+    nfs_copyfh(&st->rootfh, fhandle);
+    // signal the waiting code to continue execution
+    complete(&st->mount_done);
+}
 
-    assert(bytes <= BUFFER_CACHE_BLOCK_SIZE);
+/* ------------------------------------------------------------------------- */
+/* asynchronous, vectored I/O */
+
+// state for an ongoing asynchronous request
+struct nfs_async_io {
+    struct vfs_io_req *req;
+    struct nfs_fh3 fh;
+    size_t iov_idx;             ///< iovec of next chunk to issue
+    size_t iov_off;             ///< offset within that iovec
+    size_t file_off;            ///< file offset of next chunk
+    int chunks_in_progress;
+    size_t bytes;               ///< bytes transferred so far
+    bool stop;                  ///< don't issue more chunks (EOF or error)
+    nfsstat3 status;
+};
 
-    fh.data = (void *)buffer;
-    fh.size = bytes;
-    fh.offset = (h->u.file.pos / BUFFER_CACHE_BLOCK_SIZE) * BUFFER_CACHE_BLOCK_SIZE;
-    fh.status = NFS3_OK;
-    fh.handle = h->fh;
+// state for one outstanding READ/WRITE RPC of an asynchronous request
+struct nfs_async_chunk {
+    struct nfs_async_io *io;
+    uint8_t *buf;
+    size_t len;
+};
 
-    lwip_mutex_lock();
+static void async_issue(struct nfs_state *nfs, struct nfs_async_io *io);
 
-    // start a parallel write of the file, wait for it to complete
-    int chunks = 0;
-    do {
-        struct nfs_file_parallel_io_handle *pfh =
-            malloc(sizeof(struct nfs_file_parallel_io_handle));
-        pfh->fh = &fh;
-        pfh->chunk_start = fh.chunk_pos;
-        pfh->chunk_size = MIN(MAX_NFS_WRITE_BYTES, fh.size - pfh->chunk_start);
-        fh.chunk_pos += pfh->chunk_size;
-        e = nfs_write(nfs->client, fh.handle, fh.offset + pfh->chunk_start,
-                      (char *)fh.data + pfh->chunk_start, pfh->chunk_size,
-                      NFS_WRITE_STABILITY, write_callback, pfh);
-        assert(e == ERR_OK);
-        chunks++;
-    } while (fh.chunk_pos < fh.size && chunks < MAX_NFS_WRITE_CHUNKS);
-    wait_for_condition();
+static void async_chunk_done(struct nfs_state *nfs, struct nfs_async_chunk *c)
+{
+    struct nfs_async_io *io = c->io;
+    free(c);
 
-    lwip_mutex_unlock();
+    io->chunks_in_progress--;
+    if (!io->stop) {
+        async_issue(nfs, io);
+    }
 
-    // check result
-    if (fh.status != NFS3_OK) {
-        return nfsstat_to_errval(fh.status);
+    if (io->chunks_in_progress == 0
+        && (io->stop || io->iov_idx == io->req->iovcnt)) {
+        errval_t err = io->status == NFS3_OK ? SYS_ERR_OK
+                                             : nfsstat_to_errval(io->status);
+        vfs_io_complete(io->req, err, io->bytes);
+        free(io);
     }
+}
 
-    assert(fh.size <= bytes);
-    h->u.file.pos += fh.size;
-    *bytes_written = fh.size;
+static void async_read_callback(void *arg, struct nfs_client *client,
+                                READ3res *result)
+{
+    struct nfs_async_chunk *c = arg;
+    struct nfs_async_io *io = c->io;
 
-    return SYS_ERR_OK;
+    assert(result != NULL);
+    if (result->status != NFS3_OK) {
+        io->status = result->status;
+        io->stop = true;
+    } else {
+        READ3resok *res = &result->READ3res_u.resok;
+        assert(res->data.data_len <= c->len);
+        memcpy(c->buf, res->data.data_val, res->data.data_len);
+        io->bytes += res->data.data_len;
+        if (res->eof || res->data.data_len < c->len) {
+            io->stop = true;
+        }
+    }
+
+    xdr_READ3res(&xdr_free, result);
+    async_chunk_done(io->req->backend_st, c);
 }
-#endif
 
-#endif
+static void async_write_callback(void *arg, struct nfs_client *client,
+                                 WRITE3res *result)
+{
+    struct nfs_async_chunk *c = arg;
+    struct nfs_async_io *io = c->io;
 
-static void
-mount_callback (void *arg, struct nfs_client *client, enum mountstat3 mountstat,
-                struct nfs_fh3 fhandle)
+    assert(result != NULL);
+    if (result->status != NFS3_OK) {
+        io->status = result->status;
+        io->stop = true;
+    } else {
+        io->bytes += result->WRITE3res_u.resok.count;
+    }
+
+    xdr_WRITE3res(&xdr_free, result);
+    async_chunk_done(io->req->backend_st, c);
+}
+
+/// Issue RPCs for the next chunks of the request, up to the window size.
+/// Must be called with the lwip mutex held.
+static void async_issue(struct nfs_state *nfs, struct nfs_async_io *io)
 {
-    struct nfs_state *st = arg;
+    struct vfs_io_req *req = io->req;
+    size_t maxchunk = req->op == VFS_IO_READ ? MAX_NFS_READ_BYTES
+                                             : MAX_NFS_WRITE_BYTES;
+
+    while (io->chunks_in_progress < nfs->window
+           && io->iov_idx < req->iovcnt) {
+        struct vfs_iovec *iov = &req->iov[io->iov_idx];
+        if (io->iov_off == iov->len) {
+            io->iov_idx++;
+            io->iov_off = 0;
+            continue;
+        }
 
-    st->mountstat = mountstat;
+        struct nfs_async_chunk *c = malloc(sizeof(struct nfs_async_chunk));
+        assert(c != NULL);
+        c->io = io;
+        c->buf = (uint8_t *)iov->base + io->iov_off;
+        c->len = MIN(maxchunk, iov->len - io->iov_off);
 
-    // save the root dir handle
-    nfs_copyfh(&st->rootfh, fhandle);
-    // signal the waiting code to continue execution
-    signal_condition();
+        err_t e;
+        if (req->op == VFS_IO_READ) {
+            e = nfs_read(nfs->client, io->fh, io->file_off, c->len,
+                         async_read_callback, c);
+        } else {
+            e = nfs_write(nfs->client, io->fh, io->file_off, c->buf, c->len,
+                          NFS_WRITE_STABILITY, async_write_callback, c);
+        }
+
+        if (e == ERR_MEM) { // internal resource limit in lwip
+            free(c);
+            if (io->chunks_in_progress == 0) {
+                // nothing in flight to retry from, give up
+                io->status = NFS3ERR_JUKEBOX;
+                io->stop = true;
+            }
+            break;
+        }
+        assert(e == ERR_OK);
+
+        io->chunks_in_progress++;
+        io->iov_off += c->len;
+        io->file_off += c->len;
+    }
+}
+
+static errval_t submit_io(void *st, vfs_handle_t handle, struct vfs_io_req *req)
+{
+    struct nfs_state *nfs = st;
+    struct nfs_handle *h = handle;
+
+    assert(!h->isdir);
+
+    struct nfs_async_io *io = calloc(1, sizeof(struct nfs_async_io));
+    if (io == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    io->req = req;
+    io->fh = h->fh;
+    io->file_off = req->offset;
+    io->status = NFS3_OK;
+    req->backend_st = nfs;
+
+    lwip_mutex_lock();
+
+    // order with respect to the synchronous path of the same handle
+    if (req->op == VFS_IO_WRITE) {
+        readahead_discard(h);
+    }
+    writebehind_wait(h, 0);
+
+    async_issue(nfs, io);
+    bool failed = io->chunks_in_progress == 0;
+    lwip_mutex_unlock();
+
+    if (failed) { // empty request, or nothing could be issued
+        errval_t err = io->status == NFS3_OK ? SYS_ERR_OK
+                                             : nfsstat_to_errval(io->status);
+        vfs_io_complete(req, err, 0);
+        free(io);
+    }
+
+    return SYS_ERR_OK;
 }
 
 static struct vfs_ops nfsops = {
@@ -1385,12 +1845,14 @@ static struct vfs_ops nfsops = {
     .tell = tell,
     .stat = stat,
     .close = close,
+    .flush = flush,
     .opendir = opendir,
     .dir_read_next = dir_read_next,
     .closedir = closedir,
     .remove = vfs_nfs_remove,
     .mkdir = mkdir,
     //.rmdir = rmdir,
+    .submit_io = submit_io,
 
 #ifdef WITH_BUFFER_CACHE
     .get_bcache_key = get_bcache_key,
@@ -1414,6 +1876,26 @@ errval_t vfs_nfs_mount(const char *uri, void **retst, struct vfs_ops **retops)
         return VFS_ERR_BAD_URI;
     }
 
+    // optional mount options after the path: nfs://host/path?window=N
+    int window = NFS_DEFAULT_WINDOW;
+    size_t pathlen = strcspn(path, "?");
+    if (path[pathlen] == '?') {
+        const char *opt = &path[pathlen + 1];
+        if (strncmp(opt, "window=", 7) != 0) {
+            printf("Unknown NFS mount option: %s\n", opt);
+            return VFS_ERR_BAD_URI;
+        }
+        window = atoi(opt + 7);
+        if (window < 1 || window > NFS_MAX_WINDOW) {
+            printf("Invalid NFS window size: %s\n", opt + 7);
+            return VFS_ERR_BAD_URI;
+        }
+    }
+
+    char path_copy[pathlen + 1];
+    memcpy(path_copy, path, pathlen);
+    path_copy[pathlen] = '\0';
+
     char host_copy[path - host + 1];
     memcpy(host_copy, host, path - host);
     host_copy[path - host] = '\0';
@@ -1434,11 +1916,13 @@ errval_t vfs_nfs_mount(const char *uri, void **retst, struct vfs_ops **retops)
 
     struct nfs_state *st = malloc(sizeof(struct nfs_state));
     assert(st != NULL);
+    st->window = window;
 
     lwip_mutex_lock();
-    st->client = nfs_mount(server2, path, mount_callback, st);
+    st->mount_done = false;
+    st->client = nfs_mount(server2, path_copy, mount_callback, st);
     assert(st->client != NULL);
-    wait_for_condition();
+    wait_for_completion(&st->mount_done);
     lwip_mutex_unlock();
 
     if (st->mountstat == MNT3_OK) {
@@ -6,19 +6,22 @@ struct nfs_state {
     struct nfs_client *client;
     struct nfs_fh3 rootfh;
     mountstat3 mountstat;
+    int window;             ///< max. outstanding READ/WRITE RPCs per request
+    volatile bool mount_done;   ///< set by the MOUNT reply
 };
 
+struct nfs_readahead;
+struct nfs_wb_chunk;
+
 // file handle
 struct nfs_handle {
     struct vfs_handle common;
     struct nfs_state *nfs;
     bool isdir;
+    volatile bool op_done;      ///< set by the reply to a one-shot operation
     struct nfs_fh3 fh;
     enum ftype3 type;
     void *st;
-#ifdef ASYNC_WRITES
-    int inflight;
-#endif
 #ifdef WITH_META_DATA_CACHE
     size_t cached_filesize;
     bool filesize_cached;
@@ -26,6 +29,20 @@ struct nfs_handle {
     union {
         struct {
             size_t pos;
+            // read-ahead
+            struct nfs_readahead *ra;   ///< buffered/in-flight data, or NULL
+            size_t seq_next;            ///< offset following the last read
+            size_t ra_size;             ///< current read-ahead size, 0 if off
+            // write-behind
+            int wb_inflight;            ///< outstanding WRITE RPCs
+            bool wb_waiting;            ///< caller blocked on a WRITE reply
+            /// acknowledged UNSTABLE writes, kept until they are committed
+            struct nfs_wb_chunk *wb_uncommitted;
+            size_t wb_uncommitted_bytes;
+            bool wb_verf_valid;
+            bool wb_verf_changed;       ///< server restarted since first write
+            writeverf3 wb_verf;         ///< server verifier of first write
+            nfsstat3 wb_status;         ///< first error of a WRITE/COMMIT
         } file;
         struct {
             struct READDIR3res *readdir_result;
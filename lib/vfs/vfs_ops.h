@@ -12,6 +12,8 @@
 
 #include <vfs/vfs.h>
 
+struct vfs_io_req;
+
 struct vfs_ops {
     // operations on files
     errval_t (*open)(void *st, const char *path, vfs_handle_t *handle);
@@ -31,6 +33,11 @@ struct vfs_ops {
     errval_t (*close)(void *st, vfs_handle_t handle);
     errval_t (*flush)(void *st, vfs_handle_t handle);
 
+    // asynchronous, positional I/O (optional: emulated with seek/read/write
+    // if NULL). The backend must call vfs_io_complete() exactly once per
+    // request, which may happen before submit_io returns.
+    errval_t (*submit_io)(void *st, vfs_handle_t handle, struct vfs_io_req *req);
+
     // manipulation of directories
     errval_t (*mkdir)(void *st, const char *path); // fail if already present
     errval_t (*rmdir)(void *st, const char *path); // fail if not empty
@@ -0,0 +1,713 @@
+/**
+ * \file
+ * \brief Page cache for memory-mapped files
+ *
+ * Keeps the pages of a file in frames, so that mappings can map them in on
+ * demand instead of reading the file up front. Caches opened by path are
+ * shared by all mappings of that file in the domain. Pages are read in
+ * runs of up to the requested read-ahead, into one frame per run, and are
+ * kept until the last reference to the cache is dropped.
+ *
+ * Writes and truncates through the VFS invalidate the affected pages of the
+ * caches of the file, and unmap them from the memory objects using the
+ * cache, so that they are read again on the next access.
+ *
+ * Files in the root file system are the same in all domains. If the page
+ * cache service (usr/pagecached) runs, caches opened by path get the pages
+ * of these files from it, so that all domains mapping a file share the
+ * frames holding its pages. Changes to these files are reported to the
+ * service, which tells the other domains to drop the changed pages. These
+ * notifications are handled on the default waitset.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <vfs/vfs.h>
+#include <vfs/vfs_path.h>
+#include <vfs/mmap.h>
+
+#include <if/pagecache_defs.h>
+#include <if/pagecache_rpcclient_defs.h>
+
+#include "vfs_backends.h"
+#include "vfs_pagecache.h"
+
+#define PAGECACHE_SERVICE "pagecache"
+
+struct vfs_pagecache_page {
+    struct capref frame;    ///< frame holding the page, if valid
+    genpaddr_t offset;      ///< offset of the page within frame
+    bool valid;
+};
+
+struct vfs_pagecache_frame {
+    struct capref cap;
+    struct vfs_pagecache_frame *next;
+};
+
+/// All caches: the ones opened by path, and private ones without a path
+static struct vfs_pagecache *caches;
+static struct thread_mutex caches_mutex = THREAD_MUTEX_INITIALIZER;
+
+enum service_state {
+    SERVICE_UNKNOWN,    ///< not looked up yet
+    SERVICE_ABSENT,     ///< not running, or binding failed
+    SERVICE_BOUND,
+};
+
+/// Connection to the page cache service, shared by all caches
+static struct {
+    enum service_state state;
+    struct pagecache_rpc_client rpc;    ///< for get_pages and file_changed
+    struct pagecache_binding *events;   ///< receives invalidate
+    uint64_t id;                        ///< id of events as subscriber
+    bool bound, subscribed;
+    struct thread_mutex mutex;          ///< serialises connecting and calls
+} service = { .state = SERVICE_UNKNOWN, .mutex = THREAD_MUTEX_INITIALIZER };
+
+static void caches_changed(struct vfs_handle *h, const char *path,
+                           size_t start, size_t end, bool truncated);
+
+static void invalidate_handler(struct pagecache_binding *b, char *path,
+                               uint64_t start, uint64_t end, bool truncated)
+{
+    caches_changed(NULL, path, start, end, truncated);
+    free(path);
+}
+
+static void subscribe_response_handler(struct pagecache_binding *b,
+                                       uint64_t id)
+{
+    service.id = id;
+    service.subscribed = true;
+}
+
+static void rpc_bind_cb(void *st, errval_t err, struct pagecache_binding *b)
+{
+    errval_t *reterr = st;
+
+    if (err_is_ok(err)) {
+        err = pagecache_rpc_client_init(&service.rpc, b);
+    }
+    *reterr = err;
+    service.bound = true;
+}
+
+static void events_bind_cb(void *st, errval_t err, struct pagecache_binding *b)
+{
+    errval_t *reterr = st;
+
+    if (err_is_ok(err)) {
+        b->rx_vtbl.subscribe_response = subscribe_response_handler;
+        b->rx_vtbl.invalidate = invalidate_handler;
+        service.events = b;
+    }
+    *reterr = err;
+    service.bound = true;
+}
+
+/// Bind to the service, once on an RPC binding and once to receive events
+static errval_t service_bind(void)
+{
+    errval_t err, bind_err = SYS_ERR_OK;
+    iref_t iref;
+
+    err = nameservice_lookup(PAGECACHE_SERVICE, &iref);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    service.bound = false;
+    err = pagecache_bind(iref, rpc_bind_cb, &bind_err, get_default_waitset(),
+                         IDC_BIND_FLAG_RPC_CAP_TRANSFER);
+    if (err_is_fail(err)) {
+        return err_push(err, FLOUNDER_ERR_BIND);
+    }
+    while (!service.bound) {
+        messages_wait_and_handle_next();
+    }
+    if (err_is_fail(bind_err)) {
+        return bind_err;
+    }
+
+    service.bound = false;
+    err = pagecache_bind(iref, events_bind_cb, &bind_err,
+                         get_default_waitset(), IDC_BIND_FLAGS_DEFAULT);
+    if (err_is_fail(err)) {
+        return err_push(err, FLOUNDER_ERR_BIND);
+    }
+    while (!service.bound) {
+        messages_wait_and_handle_next();
+    }
+    if (err_is_fail(bind_err)) {
+        return bind_err;
+    }
+
+    err = service.events->tx_vtbl.subscribe_call(service.events, NOP_CONT);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    while (!service.subscribed) {
+        messages_wait_and_handle_next();
+    }
+
+    return SYS_ERR_OK;
+}
+
+/// Returns true if the service runs, binding to it on first use
+static bool service_connect(void)
+{
+    thread_mutex_lock(&service.mutex);
+    if (service.state == SERVICE_UNKNOWN) {
+        errval_t err = service_bind();
+        if (err_is_fail(err)) {
+            if (err_no(err) != LIB_ERR_NAMESERVICE_UNKNOWN_NAME
+                && err_no(err) != LIB_ERR_NAMESERVICE_NOT_BOUND) {
+                DEBUG_ERR(err, "binding to the page cache service");
+            }
+            service.state = SERVICE_ABSENT;
+        } else {
+            service.state = SERVICE_BOUND;
+        }
+    }
+    bool bound = service.state == SERVICE_BOUND;
+    thread_mutex_unlock(&service.mutex);
+
+    return bound;
+}
+
+/// Returns true if the file of a handle is in the file system of all domains
+static bool is_shared_file(struct vfs_handle *h)
+{
+    // the root is the ramfs mounted by vfs_init
+    return h->path != NULL
+           && strcmp(h->mount->mountpoint, VFS_PATH_SEP_STR) == 0;
+}
+
+static errval_t cache_init(struct vfs_pagecache *pc, vfs_handle_t vh)
+{
+    struct vfs_fileinfo info;
+    errval_t err;
+
+    err = vfs_stat(vh, &info);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    if (info.type != VFS_FILE) {
+        return FS_ERR_NOTFILE;
+    }
+
+    pc->vh = vh;
+    pc->filesize = info.size;
+    pc->npages = DIVIDE_ROUND_UP(info.size, BASE_PAGE_SIZE);
+    pc->pages = calloc(pc->npages > 0 ? pc->npages : 1,
+                       sizeof(struct vfs_pagecache_page));
+    if (pc->pages == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    pc->frames = NULL;
+    pc->users = NULL;
+    pc->refcount = 1;
+    thread_mutex_init(&pc->mutex);
+    pc->misses = 0;
+    pc->pages_read = 0;
+
+    return SYS_ERR_OK;
+}
+
+static void cache_free(struct vfs_pagecache *pc)
+{
+    struct vfs_pagecache_frame *f = pc->frames;
+    while (f != NULL) {
+        struct vfs_pagecache_frame *next = f->next;
+        errval_t err = cap_destroy(f->cap);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "freeing page cache frame");
+        }
+        free(f);
+        f = next;
+    }
+
+    if (pc->own_handle) {
+        vfs_close(pc->vh);
+    }
+    free(pc->pages);
+    free(pc->path);
+    free(pc);
+}
+
+/**
+ * \brief Get the page cache of a file, shared with other users of the file
+ *
+ * \param path Path to the file
+ * \param ret  Returns the cache, to be released with #vfs_pagecache_release
+ */
+errval_t vfs_pagecache_open(const char *path, struct vfs_pagecache **ret)
+{
+    errval_t err;
+
+    char *abspath = vfs_path_mkabs(path);
+    if (abspath == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    // before locking, as binding handles messages on the default waitset
+    bool have_service = service_connect();
+
+    thread_mutex_lock(&caches_mutex);
+
+    for (struct vfs_pagecache *pc = caches; pc != NULL; pc = pc->next) {
+        if (pc->path != NULL && strcmp(pc->path, abspath) == 0) {
+            pc->refcount++;
+            thread_mutex_unlock(&caches_mutex);
+            free(abspath);
+            *ret = pc;
+            return SYS_ERR_OK;
+        }
+    }
+
+    struct vfs_pagecache *pc = calloc(1, sizeof(struct vfs_pagecache));
+    if (pc == NULL) {
+        err = LIB_ERR_MALLOC_FAIL;
+        goto fail;
+    }
+
+    vfs_handle_t vh;
+    err = vfs_open(abspath, &vh);
+    if (err_is_fail(err)) {
+        goto fail;
+    }
+
+    err = cache_init(pc, vh);
+    if (err_is_fail(err)) {
+        vfs_close(vh);
+        goto fail;
+    }
+    pc->own_handle = true;
+    pc->path = abspath;
+    pc->remote = have_service && is_shared_file(vh);
+
+    pc->next = caches;
+    caches = pc;
+
+    thread_mutex_unlock(&caches_mutex);
+    *ret = pc;
+    return SYS_ERR_OK;
+
+fail:
+    thread_mutex_unlock(&caches_mutex);
+    free(pc);
+    free(abspath);
+    return err;
+}
+
+/**
+ * \brief Create a private page cache reading through an open handle
+ *
+ * \param vh  Handle to the file, which must stay open until the cache is
+ *            released. Its file position is not changed.
+ * \param ret Returns the cache, to be released with #vfs_pagecache_release
+ */
+errval_t vfs_pagecache_create(vfs_handle_t vh, struct vfs_pagecache **ret)
+{
+    struct vfs_pagecache *pc = calloc(1, sizeof(struct vfs_pagecache));
+    if (pc == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    errval_t err = cache_init(pc, vh);
+    if (err_is_fail(err)) {
+        free(pc);
+        return err;
+    }
+
+    // listed, so that writes through vh find it
+    thread_mutex_lock(&caches_mutex);
+    pc->next = caches;
+    caches = pc;
+    thread_mutex_unlock(&caches_mutex);
+
+    *ret = pc;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Drop a reference to a page cache
+ *
+ * The frames of the cache are freed with the last reference, so all
+ * mappings of them must have been removed by then.
+ */
+void vfs_pagecache_release(struct vfs_pagecache *pc)
+{
+    thread_mutex_lock(&caches_mutex);
+    assert(pc->refcount > 0);
+    if (--pc->refcount > 0) {
+        thread_mutex_unlock(&caches_mutex);
+        return;
+    }
+
+    struct vfs_pagecache **p = &caches;
+    while (*p != pc) {
+        assert(*p != NULL);
+        p = &(*p)->next;
+    }
+    *p = pc->next;
+    thread_mutex_unlock(&caches_mutex);
+
+    cache_free(pc);
+}
+
+/// Read count pages from first on into a new frame. Called with mutex held.
+static errval_t fill_pages(struct vfs_pagecache *pc, size_t first,
+                           size_t count)
+{
+    errval_t err, err2;
+    struct capref frame;
+    size_t framesize;
+    void *buf;
+
+    struct vfs_pagecache_frame *f = malloc(sizeof(struct vfs_pagecache_frame));
+    if (f == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    err = frame_alloc(&frame, count * BASE_PAGE_SIZE, &framesize);
+    if (err_is_fail(err)) {
+        free(f);
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    err = vspace_map_one_frame(&buf, framesize, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        free(f);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    // read the data, without disturbing the file position of the handle
+    size_t oldpos, pos = 0, nbytes = count * BASE_PAGE_SIZE;
+    err = vfs_tell(pc->vh, &oldpos);
+    if (err_is_fail(err)) {
+        goto out;
+    }
+    err = vfs_seek(pc->vh, VFS_SEEK_SET, first * BASE_PAGE_SIZE);
+    if (err_is_fail(err)) {
+        goto out;
+    }
+    while (pos < nbytes) {
+        size_t rsize;
+        err = vfs_read(pc->vh, (char *)buf + pos, nbytes - pos, &rsize);
+        if (err_no(err) == VFS_ERR_EOF) {
+            err = SYS_ERR_OK;
+            break;
+        } else if (err_is_fail(err)) {
+            break;
+        }
+        if (rsize == 0) {
+            break;
+        }
+        pos += rsize;
+    }
+    err2 = vfs_seek(pc->vh, VFS_SEEK_SET, oldpos);
+    if (err_is_ok(err)) {
+        err = err2;
+    }
+
+    // the rest of the last page is past the end of the file
+    memset((char *)buf + pos, 0, nbytes - pos);
+
+out:
+    err2 = vspace_unmap(buf);
+    assert(err_is_ok(err2));
+
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        free(f);
+        return err;
+    }
+
+    f->cap = frame;
+    f->next = pc->frames;
+    pc->frames = f;
+
+    for (size_t i = 0; i < count; i++) {
+        struct vfs_pagecache_page *p = &pc->pages[first + i];
+        p->frame = frame;
+        p->offset = i * BASE_PAGE_SIZE;
+        p->valid = true;
+    }
+
+    pc->misses++;
+    pc->pages_read += count;
+    return SYS_ERR_OK;
+}
+
+/// Get count pages from first on from the service. Called with mutex held.
+static errval_t fill_pages_remote(struct vfs_pagecache *pc, size_t first,
+                                  size_t count)
+{
+    errval_t err, msgerr;
+    struct capref frame;
+    uint64_t offset, npages;
+
+    struct vfs_pagecache_frame *f = malloc(sizeof(struct vfs_pagecache_frame));
+    if (f == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    thread_mutex_lock(&service.mutex);
+    err = service.rpc.vtbl.get_pages(&service.rpc, pc->path, first, count,
+                                     &msgerr, &frame, &offset, &npages);
+    thread_mutex_unlock(&service.mutex);
+    if (err_is_ok(err)) {
+        err = msgerr;
+    }
+    if (err_is_fail(err)) {
+        free(f);
+        return err;
+    }
+
+    // our copy of the service's frame
+    f->cap = frame;
+    f->next = pc->frames;
+    pc->frames = f;
+
+    for (size_t i = 0; i < npages && i < count; i++) {
+        struct vfs_pagecache_page *p = &pc->pages[first + i];
+        p->frame = frame;
+        p->offset = offset + i * BASE_PAGE_SIZE;
+        p->valid = true;
+    }
+
+    pc->misses++;
+    pc->pages_read += npages;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Get the frame holding a page of the file
+ *
+ * \param pc         The page cache
+ * \param page       Page number within the file, below the number of pages
+ * \param readahead  Number of following pages to read as well, if the page
+ *                   is not cached
+ * \param ret_frame  Returns the frame holding the page. The cap belongs to
+ *                   the cache and must be copied to map it.
+ * \param ret_offset Returns the offset of the page within the frame
+ */
+errval_t vfs_pagecache_get_page(struct vfs_pagecache *pc, size_t page,
+                                size_t readahead, struct capref *ret_frame,
+                                genpaddr_t *ret_offset)
+{
+    if (page >= pc->npages) {
+        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
+    }
+
+    thread_mutex_lock(&pc->mutex);
+
+    if (!pc->pages[page].valid) {
+        // read up to the next cached page or the end of the file
+        size_t count = 1;
+        while (count <= readahead && page + count < pc->npages
+               && !pc->pages[page + count].valid) {
+            count++;
+        }
+
+        bool filled = false;
+        errval_t err;
+        if (pc->remote) {
+            err = fill_pages_remote(pc, page, count);
+            if (err_is_ok(err)) {
+                filled = true;
+            } else {
+                DEBUG_ERR(err, "getting pages from the page cache service");
+            }
+        }
+        if (!filled) {
+            // the frames are not shared, but the data is the same
+            err = fill_pages(pc, page, count);
+        }
+        if (err_is_fail(err)) {
+            thread_mutex_unlock(&pc->mutex);
+            return err;
+        }
+    }
+
+    *ret_frame = pc->pages[page].frame;
+    *ret_offset = pc->pages[page].offset;
+
+    thread_mutex_unlock(&pc->mutex);
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Get the frame holding a page of the file, only if it is cached
+ */
+bool vfs_pagecache_lookup_page(struct vfs_pagecache *pc, size_t page,
+                               struct capref *ret_frame, genpaddr_t *ret_offset)
+{
+    bool found = false;
+
+    if (page >= pc->npages) {
+        return false;
+    }
+
+    thread_mutex_lock(&pc->mutex);
+    if (pc->pages[page].valid) {
+        *ret_frame = pc->pages[page].frame;
+        *ret_offset = pc->pages[page].offset;
+        found = true;
+    }
+    thread_mutex_unlock(&pc->mutex);
+
+    return found;
+}
+
+/**
+ * \brief Register a memory object mapping pages of the cache
+ *
+ * The memory object is told about changes to the file until it is removed
+ * with #vfs_pagecache_remove_user.
+ */
+void vfs_pagecache_add_user(struct vfs_pagecache *pc, struct memobj_vfs *mv)
+{
+    thread_mutex_lock(&pc->mutex);
+    mv->next_user = pc->users;
+    pc->users = mv;
+    thread_mutex_unlock(&pc->mutex);
+}
+
+void vfs_pagecache_remove_user(struct vfs_pagecache *pc, struct memobj_vfs *mv)
+{
+    thread_mutex_lock(&pc->mutex);
+    struct memobj_vfs **p = &pc->users;
+    while (*p != mv) {
+        assert(*p != NULL);
+        p = &(*p)->next_user;
+    }
+    *p = mv->next_user;
+    thread_mutex_unlock(&pc->mutex);
+}
+
+/**
+ * \brief Drop the cached pages holding bytes start to end of the file
+ *
+ * \param pc        The page cache
+ * \param start     First byte changed
+ * \param end       End of the change, SIZE_MAX for the rest of the file
+ * \param filesize  New size of the file
+ */
+static void cache_changed(struct vfs_pagecache *pc, size_t start, size_t end,
+                          size_t filesize)
+{
+    thread_mutex_lock(&pc->mutex);
+
+    size_t first = start / BASE_PAGE_SIZE;
+    size_t last = end == SIZE_MAX ? SIZE_MAX
+                                  : DIVIDE_ROUND_UP(end, BASE_PAGE_SIZE);
+    for (size_t page = first; page < last && page < pc->npages; page++) {
+        pc->pages[page].valid = false;
+    }
+
+    size_t npages = DIVIDE_ROUND_UP(filesize, BASE_PAGE_SIZE);
+    if (npages > pc->npages) {
+        struct vfs_pagecache_page *pages =
+            realloc(pc->pages, npages * sizeof(struct vfs_pagecache_page));
+        if (pages == NULL) {
+            // the pages past the old end stay unavailable to mappings
+            DEBUG_ERR(LIB_ERR_MALLOC_FAIL, "growing page cache");
+            npages = pc->npages;
+            filesize = pc->filesize;
+        } else {
+            memset(&pages[pc->npages], 0,
+                   (npages - pc->npages) * sizeof(struct vfs_pagecache_page));
+            pc->pages = pages;
+        }
+    }
+    pc->npages = npages;
+    pc->filesize = filesize;
+
+    for (struct memobj_vfs *mv = pc->users; mv != NULL; mv = mv->next_user) {
+        memobj_vfs_file_changed(mv, first, last, filesize);
+    }
+
+    thread_mutex_unlock(&pc->mutex);
+}
+
+/// Returns true if there are page caches that writes may have to invalidate
+bool vfs_pagecache_in_use(void)
+{
+    // other domains may cache files through the service
+    return caches != NULL || service.state != SERVICE_ABSENT;
+}
+
+/// Apply a change of a file, given by handle or path, to all its caches
+static void caches_changed(struct vfs_handle *h, const char *path,
+                           size_t start, size_t end, bool truncated)
+{
+    thread_mutex_lock(&caches_mutex);
+    for (struct vfs_pagecache *pc = caches; pc != NULL; pc = pc->next) {
+        if ((h == NULL || pc->vh != h) && (pc->path == NULL || path == NULL
+                                           || strcmp(pc->path, path) != 0)) {
+            continue;
+        }
+        size_t filesize = truncated ? start
+                          : (end > pc->filesize ? end : pc->filesize);
+        cache_changed(pc, start, end, filesize);
+    }
+    thread_mutex_unlock(&caches_mutex);
+}
+
+/// Apply a change of the file of handle h to all its caches in all domains
+static void file_changed(struct vfs_handle *h, size_t start, size_t end,
+                         bool truncated)
+{
+    caches_changed(h, h->path, start, end, truncated);
+
+    if (is_shared_file(h) && service_connect()) {
+        thread_mutex_lock(&service.mutex);
+        errval_t err = service.rpc.vtbl.file_changed(&service.rpc, service.id,
+                                                     h->path, start, end,
+                                                     truncated);
+        thread_mutex_unlock(&service.mutex);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "reporting a file change to the page cache service");
+        }
+    }
+}
+
+/**
+ * \brief Invalidate cached pages of a file after a write
+ *
+ * \param h       Handle the file was written through
+ * \param offset  File offset of the write
+ * \param bytes   Number of bytes written
+ */
+void vfs_pagecache_written(struct vfs_handle *h, size_t offset, size_t bytes)
+{
+    if (bytes > 0) {
+        file_changed(h, offset, offset + bytes, false);
+    }
+}
+
+/**
+ * \brief Invalidate cached pages of a file after a truncate
+ *
+ * \param h     Handle the file was truncated through
+ * \param size  New size of the file
+ */
+void vfs_pagecache_truncated(struct vfs_handle *h, size_t size)
+{
+    file_changed(h, size, SIZE_MAX, true);
+}
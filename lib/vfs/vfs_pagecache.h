@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef VFS_PAGECACHE_H
+#define VFS_PAGECACHE_H
+
+#include <barrelfish/barrelfish.h>
+#include <vfs/vfs.h>
+
+struct vfs_pagecache_page;
+struct vfs_pagecache_frame;
+struct vfs_handle;
+struct memobj_vfs;
+
+// cached pages of one file
+struct vfs_pagecache {
+    struct vfs_pagecache *next;         ///< next in list of shared caches
+    char *path;                         ///< absolute path, NULL if private
+    vfs_handle_t vh;                    ///< handle used to read the file
+    bool own_handle;                    ///< vh was opened by the cache
+    bool remote;                        ///< pages come from the service
+    size_t filesize;                    ///< size of file
+    size_t npages;
+    struct vfs_pagecache_page *pages;   ///< per-page state
+    struct vfs_pagecache_frame *frames; ///< all frames held by the cache
+    struct memobj_vfs *users;           ///< memobjs mapping the cache
+    size_t refcount;
+    struct thread_mutex mutex;
+    size_t misses;                      ///< get_page calls that read the file
+    size_t pages_read;                  ///< pages read from the file
+};
+
+// Get the cache of a file, shared by all users in this domain that pass the
+// same path. Must be released with vfs_pagecache_release.
+errval_t vfs_pagecache_open(const char *path, struct vfs_pagecache **ret);
+
+// Create a private cache that reads through an open handle, which must
+// remain open until the cache is released.
+errval_t vfs_pagecache_create(vfs_handle_t vh, struct vfs_pagecache **ret);
+
+// Drop a reference, freeing the cache and its frames when it was the last.
+void vfs_pagecache_release(struct vfs_pagecache *pc);
+
+// Get the frame and offset holding a page of the file, reading it and up to
+// readahead following pages if it is not cached. The part of the last page
+// past the end of the file reads as zeros.
+errval_t vfs_pagecache_get_page(struct vfs_pagecache *pc, size_t page,
+                                size_t readahead, struct capref *ret_frame,
+                                genpaddr_t *ret_offset);
+
+// Get the frame and offset holding a page, only if it is cached.
+bool vfs_pagecache_lookup_page(struct vfs_pagecache *pc, size_t page,
+                               struct capref *ret_frame, genpaddr_t *ret_offset);
+
+// Register and remove memory objects that are told about file changes.
+void vfs_pagecache_add_user(struct vfs_pagecache *pc, struct memobj_vfs *mv);
+void vfs_pagecache_remove_user(struct vfs_pagecache *pc, struct memobj_vfs *mv);
+
+// Invalidate the cached pages of the file of a handle after it was changed
+// through the handle. Cheap to test first with vfs_pagecache_in_use.
+bool vfs_pagecache_in_use(void);
+void vfs_pagecache_written(struct vfs_handle *h, size_t offset, size_t bytes);
+void vfs_pagecache_truncated(struct vfs_handle *h, size_t size);
+
+// Called for each user of a cache, with the cache locked, when pages first
+// to last (exclusive) of the file changed. Implemented in mmap.c.
+void memobj_vfs_file_changed(struct memobj_vfs *mv, size_t first, size_t last,
+                             size_t filesize);
+
+#endif
@@ -26,11 +26,20 @@ static const bool use_bulk_data = true;
 #define BULK_MEM_SIZE       (1U << 16)      // 64kB
 #define BULK_BLOCK_SIZE     BULK_MEM_SIZE   // (it's RPC)
 
+#define DCACHE_SIZE         64              // entries in dentry cache
+
+struct ramfs_dentry {
+    char *path;         ///< malloc'ed path relative to the mount point
+    trivfs_fh_t fh;
+    bool isdir;
+};
+
 struct ramfs_client {
     struct trivfs_rpc_client rpc;
     struct bulk_transfer bulk;
     trivfs_fh_t rootfh;
     bool bound;
+    struct ramfs_dentry dcache[DCACHE_SIZE]; ///< direct-mapped dentry cache
 };
 
 struct ramfs_handle {
@@ -41,80 +50,124 @@ struct ramfs_handle {
     size_t pos;
 };
 
-static errval_t resolve_path(struct ramfs_client *cl, const char *path,
-                             trivfs_fh_t *retfh, size_t *retpos, bool *retisdir)
+/* ------------------------------------------------------------------------- */
+/* client-side dentry cache: path -> fh */
+
+static inline unsigned dcache_hash(const char *path)
 {
-restart: ;
-    errval_t err, msgerr = SYS_ERR_OK;
-    bool isdir = true;
+    // FNV-1a
+    unsigned hash = 2166136261u;
+    for (; *path != '\0'; path++) {
+        hash = (hash ^ (uint8_t)*path) * 16777619u;
+    }
+    return hash % DCACHE_SIZE;
+}
 
-    /* resolve path, starting from the root */
-    trivfs_fh_t fh = cl->rootfh;
+static const char *dcache_key(const char *path)
+{
+    // skip leading /, so that "/a/b" and "a/b" share an entry
+    return path[0] == VFS_PATH_SEP ? &path[1] : path;
+}
 
-    // skip leading /
-    size_t pos = 0;
-    if (path[0] == VFS_PATH_SEP) {
-        pos++;
+static bool dcache_lookup(struct ramfs_client *cl, const char *path,
+                          trivfs_fh_t *retfh, bool *retisdir)
+{
+    const char *key = dcache_key(path);
+    struct ramfs_dentry *d = &cl->dcache[dcache_hash(key)];
+
+    if (d->path != NULL && strcmp(d->path, key) == 0) {
+        *retfh = d->fh;
+        *retisdir = d->isdir;
+        return true;
     }
 
-    while (path[pos] != '\0') {
-        // copy next chunk of path to private buffer
-        char *nextsep = strchr(&path[pos], VFS_PATH_SEP);
-        size_t nextlen;
-        if (nextsep == NULL) {
-            nextlen = strlen(&path[pos]);
-        } else {
-            nextlen = nextsep - &path[pos];
+    return false;
+}
+
+static void dcache_insert(struct ramfs_client *cl, const char *path,
+                          trivfs_fh_t fh, bool isdir)
+{
+    const char *key = dcache_key(path);
+    struct ramfs_dentry *d = &cl->dcache[dcache_hash(key)];
+
+    if (d->path == NULL || strcmp(d->path, key) != 0) {
+        char *newpath = strdup(key);
+        if (newpath == NULL) {
+            return; // not fatal, just don't cache it
         }
+        free(d->path);
+        d->path = newpath;
+    }
+    d->fh = fh;
+    d->isdir = isdir;
+}
+
+/// Drop the cached entry for path, and (if it is a directory) everything below
+static void dcache_invalidate(struct ramfs_client *cl, const char *path)
+{
+    const char *key = dcache_key(path);
+    size_t keylen = strlen(key);
+
+    for (int i = 0; i < DCACHE_SIZE; i++) {
+        struct ramfs_dentry *d = &cl->dcache[i];
+        if (d->path != NULL && strncmp(d->path, key, keylen) == 0
+            && (d->path[keylen] == '\0' || d->path[keylen] == VFS_PATH_SEP)) {
+            free(d->path);
+            d->path = NULL;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
 
-        char pathbuf[nextlen + 1];
-        memcpy(pathbuf, &path[pos], nextlen);
-        pathbuf[nextlen] = '\0';
+static errval_t resolve_path(struct ramfs_client *cl, const char *path,
+                             trivfs_fh_t *retfh, size_t *retpos, bool *retisdir)
+{
+    errval_t err, msgerr = SYS_ERR_OK;
+    trivfs_fh_t fh;
+    bool isdir;
+    uint32_t pos;
+
+    // the position is only needed by create, which wants to know where
+    // the lookup failed, so we only serve successful lookups from the cache
+    if (dcache_lookup(cl, path, &fh, &isdir)) {
+        if (retpos != NULL) {
+            char *lastsep = strrchr(path, VFS_PATH_SEP);
+            *retpos = lastsep == NULL ? 0 : lastsep + 1 - path;
+        }
+        goto out;
+    }
 
-        // lookup
-        trivfs_fh_t nextfh;
-        err = cl->rpc.vtbl.lookup(&cl->rpc, fh, pathbuf, &msgerr, &nextfh, &isdir);
+    /* resolve the whole path, starting from the root, in a single RPC */
+    for (int restarts = 0; ; restarts++) {
+        err = cl->rpc.vtbl.lookup_path(&cl->rpc, cl->rootfh, path, &msgerr,
+                                       &fh, &isdir, &pos);
         if (err_is_fail(err)) {
-            DEBUG_ERR(err, "transport error in lookup");
+            DEBUG_ERR(err, "transport error in lookup_path");
             return err;
-        } else if (err_is_fail(msgerr)) {
-            if (err_no(msgerr) == FS_ERR_INVALID_FH) {
-                if (fh == cl->rootfh) { // revalidate root
-                    err = cl->rpc.vtbl.getroot(&cl->rpc, &cl->rootfh);
-                    if (err_is_fail(err)) {
-                        USER_PANIC_ERR(err, "failed to get root fh");
-                    }
-                    fh = cl->rootfh;
-                    continue;
-                } else {
-                    USER_PANIC("vfs_ramfs: handle we just received is invalid?\n");
-                    goto restart;
-                }
-            } else if (err_no(msgerr) != FS_ERR_NOTFOUND) {
-                DEBUG_ERR(msgerr, "server error in lookup of '%s' while at '%s'",
-                          path, pathbuf);
+        } else if (err_no(msgerr) == FS_ERR_INVALID_FH && restarts == 0) {
+            // revalidate root
+            err = cl->rpc.vtbl.getroot(&cl->rpc, &cl->rootfh);
+            if (err_is_fail(err)) {
+                USER_PANIC_ERR(err, "failed to get root fh");
             }
-            goto out;
-        } else if (!isdir && nextsep != NULL) {
-            // not a directory, don't bother going further
-            fh = nextfh;
-            pos += nextlen + 1;
-            msgerr = FS_ERR_NOTDIR;
-            goto out;
-        }
-
-        fh = nextfh;
-        if (nextsep == NULL) {
-            break;
+            continue;
         }
-
-        pos += nextlen + 1;
+        break;
     }
 
-out:
     if (retpos != NULL) {
         *retpos = pos;
     }
+
+    if (err_is_ok(msgerr)) {
+        dcache_insert(cl, path, fh, isdir);
+    } else if (err_no(msgerr) != FS_ERR_NOTFOUND
+               && err_no(msgerr) != FS_ERR_NOTDIR) {
+        DEBUG_ERR(msgerr, "server error in lookup of '%s'", path);
+    }
+
+out:
     if (retfh != NULL) {
         *retfh = fh;
     }
@@ -124,6 +177,13 @@ out:
     return msgerr;
 }
 
+/// Re-resolve the path of a handle whose fh has become invalid
+static errval_t revalidate(struct ramfs_client *cl, struct ramfs_handle *h)
+{
+    dcache_invalidate(cl, h->path);
+    return resolve_path(cl, h->path, &h->fh, NULL, NULL);
+}
+
 static errval_t open(void *st, const char *path, vfs_handle_t *rethandle)
 {
     struct ramfs_client *cl = st;
@@ -185,6 +245,7 @@ static errval_t create(void *st, const char *path, vfs_handle_t *rethandle)
         return msgerr;
     }
     err = msgerr;
+    dcache_insert(cl, path, fh, false);
 
 out:
     handle = malloc(sizeof(struct ramfs_handle));
@@ -207,6 +268,9 @@ static errval_t ramfs_remove(void *st, const char *path)
     errval_t err, msgerr;
     bool isdir;
 
+    int restarts = 0;
+
+restart:
     err = resolve_path(cl, path, &fh, NULL, &isdir);
     if (err_is_fail(err)) {
         return err;
@@ -219,10 +283,16 @@ static errval_t ramfs_remove(void *st, const char *path)
         DEBUG_ERR(err, "transport error in delete");
         return err;
     } else if (err_is_fail(msgerr)) {
+        if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
+            // cached handle was stale, look it up again
+            dcache_invalidate(cl, path);
+            goto restart;
+        }
         DEBUG_ERR(msgerr, "server error in delete");
         return msgerr;
     }
 
+    dcache_invalidate(cl, path);
     return msgerr;
 }
 
@@ -248,7 +318,7 @@ restart:
         assert(mybuf == NULL);
         if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
             // revalidate handle and try again
-            msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+            msgerr = revalidate(cl, h);
             if (err_is_ok(msgerr)) {
                 goto restart;
             }
@@ -286,7 +356,7 @@ restart:
     } else if (err_is_fail(msgerr)) {
         if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
             // revalidate handle and try again
-            msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+            msgerr = revalidate(cl, h);
             if (err_is_ok(msgerr)) {
                 goto restart;
             }
@@ -342,7 +412,7 @@ restart:
         } else if (err_is_fail(msgerr)) {
             if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
                 // revalidate handle and try again
-                msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+                msgerr = revalidate(cl, h);
                 if (err_is_ok(msgerr)) {
                     goto restart;
                 }
@@ -413,7 +483,7 @@ restart:
         } else if (err_is_fail(msgerr)) {
             if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
                 // revalidate handle and try again
-                msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+                msgerr = revalidate(cl, h);
                 if (err_is_ok(msgerr)) {
                     goto restart;
                 }
@@ -455,7 +525,7 @@ restart:
     } else if (err_is_fail(msgerr)) {
         if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
             // revalidate handle and try again
-            msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+            msgerr = revalidate(cl, h);
             if (err_is_ok(msgerr)) {
                 goto restart;
             }
@@ -491,7 +561,7 @@ restart:
     } else if (err_is_fail(msgerr)) {
         if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
             // revalidate handle and try again
-            msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+            msgerr = revalidate(cl, h);
             if (err_is_ok(msgerr)) {
                 goto restart;
             }
@@ -612,7 +682,7 @@ restart:
                 h->fh = cl->rootfh;
                 goto restart;
             } else {
-                msgerr = resolve_path(cl, h->path, &h->fh, NULL, NULL);
+                msgerr = revalidate(cl, h);
                 if (err_is_ok(msgerr)) {
                     goto restart;
                 }
@@ -658,35 +728,47 @@ static errval_t mkdir(void *st, const char *path)
 
     // find parent directory
     char *lastsep = strrchr(path, VFS_PATH_SEP);
-    if (lastsep != NULL) {
-        childname = lastsep + 1;
-
-        size_t pathlen = lastsep - path;
-        char pathbuf[pathlen + 1];
-        memcpy(pathbuf, path, pathlen);
-        pathbuf[pathlen] = '\0';
+    size_t pathlen = lastsep != NULL ? lastsep - path : 0;
+    char pathbuf[pathlen + 1];
+    memcpy(pathbuf, path, pathlen);
+    pathbuf[pathlen] = '\0';
+    childname = lastsep != NULL ? lastsep + 1 : path;
+
+    for (int restarts = 0; ; restarts++) {
+        if (lastsep != NULL) {
+            // resolve parent directory
+            err = resolve_path(cl, pathbuf, &parent, NULL, &isdir);
+            if (err_is_fail(err)) {
+                return err;
+            } else if (!isdir) {
+                return FS_ERR_NOTDIR; // parent is not a directory
+            }
+        } else {
+            parent = cl->rootfh;
+        }
 
-        // resolve parent directory
-        err = resolve_path(cl, pathbuf, &parent, NULL, &isdir);
+        // create child
+        trivfs_fh_t newfh;
+        err = cl->rpc.vtbl.mkdir(&cl->rpc, parent, childname, &msgerr, &newfh);
         if (err_is_fail(err)) {
+            DEBUG_ERR(err, "transport error in mkdir");
             return err;
-        } else if (!isdir) {
-            return FS_ERR_NOTDIR; // parent is not a directory
         }
-    } else {
-        parent = cl->rootfh;
-        childname = path;
-    }
 
-    // create child
-    trivfs_fh_t newfh;
-    err = cl->rpc.vtbl.mkdir(&cl->rpc, parent, childname, &msgerr, &newfh);
-    if (err_is_fail(err)) {
-        DEBUG_ERR(err, "transport error in mkdir");
-        return err;
+        if (err_no(msgerr) == FS_ERR_INVALID_FH && restarts == 0) {
+            // cached handle of the parent was stale, look it up again
+            if (lastsep != NULL) {
+                dcache_invalidate(cl, pathbuf);
+            } else {
+                err = cl->rpc.vtbl.getroot(&cl->rpc, &cl->rootfh);
+                if (err_is_fail(err)) {
+                    USER_PANIC_ERR(err, "failed to get root fh");
+                }
+            }
+            continue;
+        }
+        return msgerr;
     }
-
-    return msgerr;
 }
 
 static errval_t rmdir(void *st, const char *path)
@@ -696,6 +778,9 @@ static errval_t rmdir(void *st, const char *path)
     errval_t err, msgerr;
     bool isdir;
 
+    int restarts = 0;
+
+restart:
     err = resolve_path(cl, path, &fh, NULL, &isdir);
     if (err_is_fail(err)) {
         return err;
@@ -708,10 +793,16 @@ static errval_t rmdir(void *st, const char *path)
         DEBUG_ERR(err, "transport error in delete");
         return err;
     } else if (err_is_fail(msgerr)) {
+        if (err_no(msgerr) == FS_ERR_INVALID_FH && !restarts++) {
+            // cached handle was stale, look it up again
+            dcache_invalidate(cl, path);
+            goto restart;
+        }
         DEBUG_ERR(msgerr, "server error in delete");
         return msgerr;
     }
 
+    dcache_invalidate(cl, path);
     return msgerr;
 }
 
@@ -830,6 +921,7 @@ errval_t vfs_ramfs_mount(const char *uri, void **retst, struct vfs_ops **retops)
     assert(client != NULL);
 
     client->bound = false;
+    memset(client->dcache, 0, sizeof(client->dcache));
 
     err = trivfs_bind(iref, bind_cb, client, get_default_waitset(),
                       use_bulk_data
@@ -34,6 +34,10 @@ idscope ifn s suffix  = ifscope ifn (s ++ "__" ++ suffix)
 drvscope :: String -> String -> String -> String
 drvscope drv ifn s = ifscope ifn (drv ++ "_" ++ s)
 
+-- Name of the message statistics of an interface
+stats_var_name :: String -> String
+stats_var_name ifn = ifscope ifn "stats"
+
 -- Name of the binding struct for an interface type
 intf_bind_type :: String -> String
 intf_bind_type ifn = ifscope ifn "binding"
@@ -262,7 +266,9 @@ binding_struct_init drv ifn binding_var waitset_ex tx_vtbl_ex = [
     C.StmtList
         [C.Ex $ C.Assignment (C.FieldOf binding_var f) (C.NumConstant 0)
          | f <- ["tx_msgnum", "rx_msgnum", "tx_msg_fragment", "rx_msg_fragment",
-                 "tx_str_pos", "rx_str_pos", "tx_str_len", "rx_str_len"]],
+                 "tx_str_pos", "rx_str_pos", "tx_str_len", "rx_str_len",
+                 "tx_stats_start", "rx_stats_start"]],
+    C.Ex $ C.Assignment (C.FieldOf binding_var "tx_stats") (C.Variable "NULL"),
     C.Ex $ C.Assignment (C.FieldOf binding_var "bind_cont") (C.Variable "NULL")]
 
 binding_struct_destroy :: String -> C.Expr -> [C.Stmt]
@@ -352,15 +358,20 @@ register_txcont cont_ex = [
     ] where
         errvar = C.Variable "_err"
 
--- starting a send: just a debug hook
+-- starting a send: debug and statistics hooks
 start_send :: String -> String -> String -> [MessageArgument] -> [C.Stmt]
 start_send drvn ifn mn msgargs
     = [C.Ex $ C.Call "FL_DEBUG" [C.StringConstant $
-                                 drvn ++ " TX " ++ ifn ++ "." ++ mn ++ "\n"]]
+                                 drvn ++ " TX " ++ ifn ++ "." ++ mn ++ "\n"],
+       C.Ex $ C.Call "FL_STATS_TX_START"
+            [C.AddressOf $ C.Variable $ stats_var_name ifn, bindvar,
+             C.Variable $ msg_enum_elem_name ifn mn,
+             msg_payload_size ifn C.Variable msgargs]]
 
 -- finished a send: clear msgnum, trigger pending waitsets/events
 finished_send :: [C.Stmt]
 finished_send = [
+    C.Ex $ C.Call "FL_STATS_TX_DONE" [bindvar],
     C.Ex $ C.Assignment tx_msgnum_field (C.NumConstant 0)] ++
     [C.Ex $ C.Call "flounder_support_trigger_chan" [wsaddr ws]
     | ws <- ["tx_cont_chanstate", "register_chanstate"]]
@@ -383,11 +394,19 @@ start_recv drvn ifn typedefs mn msgargs
         TArray _ _ _ -> True
         _ -> False
 
+-- first fragment of a new message received: statistics hook
+start_new_recv :: C.Stmt
+start_new_recv = C.Ex $ C.Call "FL_STATS_RX_START" [bindvar]
+
 -- finished recv: debug, run handler and clean up
 finished_recv :: String -> String -> [TypeDef] -> String -> [MessageArgument] -> [C.Stmt]
 finished_recv drvn ifn typedefs mn msgargs
     = [C.Ex $ C.Call "FL_DEBUG" [C.StringConstant $
                                  drvn ++ " RX " ++ ifn ++ "." ++ mn ++ "\n"],
+       C.Ex $ C.Call "FL_STATS_RX"
+            [C.AddressOf $ C.Variable $ stats_var_name ifn, bindvar,
+             C.Variable $ msg_enum_elem_name ifn mn,
+             msg_payload_size ifn (rx_union_elem mn) msgargs],
        C.Ex $ C.Call "assert" [C.Binary C.NotEquals handler (C.Variable "NULL")],
        C.Ex $ C.CallInd handler (bindvar:args),
        C.Ex $ C.Assignment rx_msgnum_field (C.NumConstant 0)]
@@ -400,6 +419,51 @@ finished_recv drvn ifn typedefs mn msgargs
           _ -> [rx_union_elem mn n]
         mkargs _ (DynamicArray n l) = [rx_union_elem mn n, rx_union_elem mn l]
 
+-- statistics of the interface, indexed by message number. Emitted by every
+-- backend that uses them, hence the include guard and the weak definition.
+stats_defs :: String -> [MessageDef] -> C.Unit
+stats_defs ifn msgs =
+    C.IfDef "FLOUNDER_STATS" [
+        C.IfNDef guard [
+            C.Define guard [] "1",
+            C.GVarDecl C.Static C.NonConst
+                (C.Array 0 $ C.Ptr $ C.ConstT $ C.TypeName "char") names_var
+                (Just $ C.ArrayConstant [C.StringConstant n | n <- msgnames]),
+            C.GVarDecl C.Static C.NonConst
+                (C.Array (toInteger nmsgs) $ C.Struct "flounder_msg_stats")
+                msgs_var Nothing,
+            C.GVarDecl C.NoScope C.NonConst (C.Struct "flounder_if_stats")
+                (stats_var_name ifn ++ " __attribute__((weak))")
+                (Just $ C.ArrayConstant [C.StringConstant ifn,
+                                         C.NumConstant $ toInteger nmsgs,
+                                         C.Variable names_var,
+                                         C.Variable msgs_var,
+                                         C.Variable "NULL",
+                                         C.NumConstant 0])] []] []
+    where
+        -- same order as the message number enumeration
+        msgnames = ["__dummy", "__bind", "__bind_reply"] ++ map msg_name msgs
+        nmsgs = length msgnames
+        guard = "__" ++ ifn ++ "_STATS_DEFINED"
+        names_var = ifscope ifn "stats_msgnames"
+        msgs_var = ifscope ifn "stats_msgs"
+
+-- payload size of a message in bytes, for the statistics hooks
+-- (capabilities are not counted)
+msg_payload_size :: String -> (String -> C.Expr) -> [MessageArgument] -> C.Expr
+msg_payload_size ifn argvar msgargs = case concat $ map size msgargs of
+    [] -> C.NumConstant 0
+    sl -> foldl1 (C.Binary C.Plus) sl
+    where
+        size (Arg (Builtin String) (Name n)) = [strlen n]
+        size (Arg (TypeAlias _ String) (Name n)) = [strlen n]
+        size (Arg (Builtin Cap) _) = []
+        size (Arg (Builtin GiveAwayCap) _) = []
+        size (Arg tr (Name _)) = [C.SizeOfT $ type_c_type ifn tr]
+        size (Arg tr (DynamicArray _ l))
+            = [C.Binary C.Times (argvar l) (C.SizeOfT $ type_c_type ifn tr)]
+        strlen n = C.Call "flounder_stats_strlen" [argvar n]
+
 tx_arg_assignment :: String -> [TypeDef] -> String -> MessageArgument -> C.Stmt
 tx_arg_assignment ifn typedefs mn (Arg tr v) = case v of
     Name an -> C.Ex $ C.Assignment (tx_union_elem mn an) (srcarg an)
@@ -0,0 +1,377 @@
+{-
+  CXXBackend: generate C++ bindings for Flounder interfaces
+
+  Part of Flounder: a message passing IDL for Barrelfish
+
+  Copyright (c) 2015, ETH Zurich.
+  All rights reserved.
+
+  This file is distributed under the terms in the attached LICENSE file.
+  If you do not find this file, copies can be found by writing to:
+  ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+-}
+
+-- The generated header wraps the C binding of an interface in a C++ class.
+-- Received messages are passed to handlers as typed message classes whose
+-- strings and arrays are views into the buffers allocated by the stubs, and
+-- send functions take strings and arrays as move-only owned buffers which
+-- the binding frees once the send has completed.  The support types live in
+-- include/flounder/flounder_cxx.hpp.
+--
+-- Since the code is C++ rather than C, it is emitted as text; the C
+-- abstract syntax is only used to render the C types of message arguments.
+
+module CXXBackend where
+
+import Data.Char
+import Data.List
+
+import qualified CAbsSyntax as C
+import qualified BackendCommon as BC
+import Syntax
+import Backend
+
+------------------------------------------------------------------------
+-- Language mapping: C++ identifier names
+------------------------------------------------------------------------
+
+-- Class holding the arguments of a received message
+msg_class_name :: String -> String
+msg_class_name mn = mn ++ "_msg"
+
+-- Receive handler trampoline, and the member holding the user's handler
+rx_trampoline_name, rx_handler_member, rx_setter_name :: String -> String
+rx_trampoline_name mn = "rx_" ++ mn
+rx_handler_member mn = "rx_" ++ mn ++ "_"
+rx_setter_name mn = "on_" ++ mn
+
+-- Members of a message class owning a received string or array
+owned_member_name, take_fn_name :: String -> String
+owned_member_name n = "owned_" ++ n ++ "_"
+take_fn_name n = "take_" ++ n
+
+-- C variable for the C binding in the trampolines
+cbind_var = "_binding"
+
+-- Prefix for constructor and trampoline parameters, to avoid shadowing
+param_name :: String -> String
+param_name n = "_" ++ n
+
+------------------------------------------------------------------------
+-- Message arguments
+------------------------------------------------------------------------
+
+-- How each message argument maps onto C++
+data CxxArg = ValArg MessageArgument String           -- by value
+            | ArrArg MessageArgument C.TypeSpec String -- fixed-size array
+            | StrArg String                           -- string
+            | BufArg C.TypeSpec String String         -- dynamic array
+
+cxx_arg :: String -> [TypeDef] -> MessageArgument -> CxxArg
+cxx_arg ifn types a@(Arg tr (Name n)) = case tr of
+    Builtin String -> StrArg n
+    _ -> case lookup_typeref types tr of
+        TArray etr _ _ -> ArrArg a (BC.type_c_type ifn etr) n
+        _ -> ValArg a n
+cxx_arg ifn types (Arg tr (DynamicArray n l)) = BufArg (BC.type_c_type ifn tr) n l
+
+-- Does the argument carry a buffer that the C++ code owns?
+is_owned :: CxxArg -> Bool
+is_owned (StrArg _) = True
+is_owned (BufArg _ _ _) = True
+is_owned _ = False
+
+-- Render a C type without a declarator
+type_str :: C.TypeSpec -> String
+type_str ts = reverse $ dropWhile isSpace $ reverse $ C.pp_typespec ts ""
+
+-- Render a C parameter list, optionally renaming the parameters
+params_str :: (String -> String) -> [C.Param] -> [String]
+params_str f ps = [ C.pp_typespec t (f n) | C.Param t n <- ps ]
+
+message_args :: MessageDef -> (String, [MessageArgument])
+message_args (Message _ mn args _) = (mn, args)
+
+------------------------------------------------------------------------
+-- The header file
+------------------------------------------------------------------------
+
+compile :: String -> String -> Interface -> String
+compile infile outfile interface =
+    unlines $ intf_cxx_header_file infile interface
+
+intf_cxx_header_file :: String -> Interface -> [String]
+intf_cxx_header_file infile interface@(Interface name descr decls) =
+    let sym = "__" ++ name ++ "_CXX_IF_HPP"
+        (types, messagedecls) = partitionTypesMessages decls
+        messages = BC.rpcs_to_msgs messagedecls
+    in
+      C.pp_unit (BC.intf_preamble infile name descr) ++
+      [ "",
+        "#ifndef " ++ sym,
+        "#define " ++ sym ++ " 1",
+        "",
+        "#include <flounder/flounder_cxx.hpp>",
+        "",
+        "extern \"C\" {",
+        "#include <if/" ++ name ++ "_defs.h>",
+        "}",
+        "",
+        "namespace flounder {",
+        "namespace " ++ name ++ " {",
+        "" ] ++
+      concat [ msg_class name types m ++ [""] | m <- messages ] ++
+      binding_class name types messages ++
+      [ "",
+        "} // namespace " ++ name,
+        "} // namespace flounder",
+        "",
+        "#endif // " ++ sym ]
+
+------------------------------------------------------------------------
+-- Received messages
+------------------------------------------------------------------------
+
+msg_class :: String -> [TypeDef] -> MessageDef -> [String]
+msg_class ifn types m =
+    [ "/// Arguments of a received " ++ mn ++ " message",
+      "class " ++ cn ++ " {",
+      "public:" ] ++
+    [ "    " ++ f | a <- cargs, f <- msg_field a ] ++
+    [ "" | not (null cargs) ] ++
+    [ "    " ++ cn ++ "(" ++ intercalate ", " ctor_params ++ ")" ] ++
+    [ "        : " ++ intercalate ", " inits | not (null inits) ] ++
+    [ "    {" ] ++
+    [ "        " ++ n ++ " = " ++ owned_member_name n ++ ".view();"
+      | a <- owned, let n = arg_name a ] ++
+    [ "    }" ] ++
+    [ "",
+      "    " ++ cn ++ "(const " ++ cn ++ " &) = delete;",
+      "    " ++ cn ++ " &operator=(const " ++ cn ++ " &) = delete;" ] ++
+    concat [ take_fn a | a <- owned ] ++
+    (if null owned then []
+     else [ "", "private:" ] ++
+          [ "    " ++ owned_type a ++ " " ++ owned_member_name (arg_name a) ++ ";"
+            | a <- owned ]) ++
+    [ "};" ]
+    where
+        (mn, args) = message_args m
+        cn = msg_class_name mn
+        cargs = [ cxx_arg ifn types a | a <- args ]
+        owned = filter is_owned cargs
+        ctor_params = params_str param_name $ concat
+                        [ BC.msg_argdecl BC.RX ifn a | a <- args ]
+        -- in declaration order: the plain arguments, then the storage
+        inits = [ n ++ "(" ++ param_name n ++ ")"
+                  | a <- cargs, not (is_owned a), let n = arg_name a ] ++
+                [ owned_member_name (arg_name a) ++ "(" ++ owned_init a ++ ")"
+                  | a <- owned ]
+        owned_init (StrArg n) = param_name n
+        owned_init (BufArg _ n l) = param_name n ++ ", " ++ param_name l
+
+        msg_field (ValArg a _) = [ C.pp_param p ++ ";" | p <- BC.msg_argdecl BC.RX ifn a ]
+        msg_field (ArrArg _ et n) = [ "const " ++ C.pp_typespec (C.Ptr et) n ++ ";" ]
+        msg_field (StrArg n) = [ "flounder::string_view " ++ n ++ ";" ]
+        msg_field (BufArg et n _) =
+            [ "flounder::span<const " ++ type_str et ++ "> " ++ n ++ ";" ]
+
+        take_fn a =
+            [ "",
+              "    /// Takes the storage of " ++ arg_name a
+                ++ ", which remains valid after the handler returns",
+              "    " ++ owned_type a ++ " " ++ take_fn_name (arg_name a) ++ "()",
+              "    {",
+              "        return std::move(" ++ owned_member_name (arg_name a) ++ ");",
+              "    }" ]
+
+arg_name :: CxxArg -> String
+arg_name (ValArg _ n) = n
+arg_name (ArrArg _ _ n) = n
+arg_name (StrArg n) = n
+arg_name (BufArg _ n _) = n
+
+owned_type :: CxxArg -> String
+owned_type (StrArg _) = "flounder::owned_string"
+owned_type (BufArg et _ _) = "flounder::owned_buffer<" ++ type_str et ++ ">"
+
+------------------------------------------------------------------------
+-- The binding class
+------------------------------------------------------------------------
+
+binding_class :: String -> [TypeDef] -> [MessageDef] -> [String]
+binding_class ifn types messages =
+    [ "/**",
+      " * \\brief C++ binding for the " ++ ifn ++ " interface",
+      " *",
+      " * Wraps a connected struct " ++ cbind ++ ", taking over its st pointer,",
+      " * error handler and receive handlers. A message without a handler is",
+      " * fatal. Only one send may be outstanding: send functions return",
+      " * FLOUNDER_ERR_TX_BUSY until the previous send has completed. On success",
+      " * they take the owned strings and arrays passed to them, free them when",
+      " * the send completes and then call the completion, if any. On failure",
+      " * the caller keeps its buffers.",
+      " */",
+      "class binding {",
+      "public:",
+      "    explicit binding(struct " ++ cbind ++ " *b)",
+      "        : b_(b), c_error_handler_(b->error_handler), tx_busy_(false)",
+      "    {",
+      "        for (size_t i = 0; i < " ++ show nheld ++ "; i++) {",
+      "            tx_held_[i] = NULL;",
+      "        }",
+      "        b_->st = this;",
+      "        b_->error_handler = error_handler;" ] ++
+    [ "        b_->rx_vtbl." ++ mn ++ " = " ++ rx_trampoline_name mn ++ ";"
+      | (mn, _) <- msgs ] ++
+    [ "    }",
+      "",
+      "    /// The binding must not be destroyed while a send is outstanding",
+      "    ~binding()",
+      "    {",
+      "        assert(!tx_busy_);",
+      "        b_->error_handler = c_error_handler_;",
+      "        b_->st = NULL;",
+      "    }",
+      "",
+      "    binding(const binding &) = delete;",
+      "    binding &operator=(const binding &) = delete;",
+      "",
+      "    struct " ++ cbind ++ " *c_binding() const { return b_; }",
+      "",
+      "    /// Is a send outstanding?",
+      "    bool tx_busy() const { return tx_busy_; }",
+      "",
+      "    /// Dispatches the binding's waitset until the outstanding send has completed",
+      "    errval_t wait_sent()",
+      "    {",
+      "        return flounder::wait_while(b_->waitset, &tx_busy_);",
+      "    }",
+      "",
+      "    /// Replaces the error handler of the C binding",
+      "    void on_error(std::function<void(errval_t)> h)",
+      "    {",
+      "        error_ = std::move(h);",
+      "    }" ] ++
+    concat [ rx_setter mn | (mn, _) <- msgs ] ++
+    concat [ tx_fn mn args | (mn, args) <- msgs ] ++
+    [ "",
+      "private:",
+      "    static void error_handler(struct " ++ cbind ++ " *" ++ cbind_var
+        ++ ", errval_t err)",
+      "    {",
+      "        binding *self = static_cast<binding *>(" ++ cbind_var ++ "->st);",
+      "        if (self->error_) {",
+      "            self->error_(err);",
+      "        } else if (self->c_error_handler_ != NULL) {",
+      "            self->c_error_handler_(" ++ cbind_var ++ ", err);",
+      "        }",
+      "    }",
+      "",
+      "    static void tx_complete(void *arg)",
+      "    {",
+      "        binding *self = static_cast<binding *>(arg);",
+      "        for (size_t i = 0; i < " ++ show nheld ++ "; i++) {",
+      "            free(self->tx_held_[i]);",
+      "            self->tx_held_[i] = NULL;",
+      "        }",
+      "        self->tx_busy_ = false;",
+      "",
+      "        // the completion may send again",
+      "        flounder::completion done;",
+      "        std::swap(done, self->tx_done_);",
+      "        if (done) {",
+      "            done();",
+      "        }",
+      "    }" ] ++
+    concat [ rx_trampoline mn args | (mn, args) <- msgs ] ++
+    [ "",
+      "    struct " ++ cbind ++ " *b_;",
+      "    " ++ BC.error_handler_fn_type ifn ++ " *c_error_handler_;",
+      "    bool tx_busy_;",
+      "    void *tx_held_[" ++ show nheld ++ "];",
+      "    flounder::completion tx_done_;",
+      "    std::function<void(errval_t)> error_;" ] ++
+    [ "    std::function<void(" ++ msg_class_name mn ++ " &)> "
+        ++ rx_handler_member mn ++ ";"
+      | (mn, _) <- msgs ] ++
+    [ "};" ]
+    where
+        cbind = BC.intf_bind_type ifn
+        msgs = map message_args messages
+        nheld = maximum $ 1 : [ length $ filter is_owned (cxx_args args)
+                                | (_, args) <- msgs ]
+        cxx_args args = [ cxx_arg ifn types a | a <- args ]
+
+        rx_setter mn =
+            [ "",
+              "    void " ++ rx_setter_name mn ++ "(std::function<void("
+                ++ msg_class_name mn ++ " &)> h)",
+              "    {",
+              "        " ++ rx_handler_member mn ++ " = std::move(h);",
+              "    }" ]
+
+        tx_fn mn args =
+            [ "",
+              "    errval_t " ++ mn ++ "("
+                ++ intercalate ", " (concatMap tx_param cargs
+                    ++ ["flounder::completion _done = flounder::completion()"])
+                ++ ")",
+              "    {",
+              "        if (tx_busy_) {",
+              "            return FLOUNDER_ERR_TX_BUSY;",
+              "        }",
+              "",
+              "        // the send may complete before the C stub returns",
+              "        tx_busy_ = true;",
+              "        tx_done_ = std::move(_done);" ] ++
+            [ "        tx_held_[" ++ show i ++ "] = " ++ arg_name a ++ ".data();"
+              | (i, a) <- held ] ++
+            [ "        errval_t _err = b_->tx_vtbl." ++ mn ++ "("
+                ++ intercalate ", " (["b_", "MKCONT(tx_complete, this)"]
+                                     ++ concatMap tx_call_arg cargs)
+                ++ ");",
+              "        if (err_is_fail(_err)) {",
+              "            // the caller keeps its buffers" ] ++
+            [ "            tx_held_[" ++ show i ++ "] = NULL;"
+              | (i, _) <- held ] ++
+            [ "            tx_busy_ = false;",
+              "            tx_done_ = flounder::completion();",
+              "            return _err;",
+              "        }" ] ++
+            [ "        " ++ arg_name a ++ ".release();"
+              | (_, a) <- held ] ++
+            [ "        return _err;",
+              "    }" ]
+            where
+                cargs = cxx_args args
+                held = zip [(0 :: Int) ..] (filter is_owned cargs)
+
+        tx_param (ValArg a _) = params_str id $ BC.msg_argdecl BC.TX ifn a
+        tx_param (ArrArg a _ _) = params_str id $ BC.msg_argdecl BC.TX ifn a
+        tx_param a = [ owned_type a ++ " &&" ++ arg_name a ]
+
+        tx_call_arg (StrArg n) = [ n ++ ".c_str()" ]
+        tx_call_arg (BufArg _ n _) = [ n ++ ".data()", n ++ ".size()" ]
+        tx_call_arg a = [ arg_name a ]
+
+        rx_trampoline mn args =
+            [ "",
+              "    static void " ++ rx_trampoline_name mn ++ "("
+                ++ intercalate ", " (("struct " ++ cbind ++ " *" ++ cbind_var)
+                    : (params_str param_name $ concat
+                        [ BC.msg_argdecl BC.RX ifn a | a <- args ]))
+                ++ ")",
+              "    {",
+              "        binding *self = static_cast<binding *>(" ++ cbind_var ++ "->st);",
+              "        " ++ msg_class_name mn ++ " msg" ++ msg_ctor_args args ++ ";",
+              "        if (!self->" ++ rx_handler_member mn ++ ") {",
+              "            USER_PANIC(\"" ++ ifn ++ ": no handler for message "
+                ++ mn ++ "\\n\");",
+              "        }",
+              "        self->" ++ rx_handler_member mn ++ "(msg);",
+              "    }" ]
+
+        -- no parentheses for a message without arguments
+        msg_ctor_args [] = ""
+        msg_ctor_args args = "(" ++ intercalate ", " [ param_name n | a <- args,
+                                   C.Param _ n <- BC.msg_argdecl BC.RX ifn a ] ++ ")"
@@ -78,6 +78,13 @@ intf_header_body infile interface@(Interface name descr decls) =
         msg_enums name messages,
         C.Blank,
 
+        C.MultiComment [ "Message statistics (only defined with FLOUNDER_STATS)" ],
+        C.StructForwardDecl "flounder_if_stats",
+        C.StructForwardDecl "flounder_msg_stats",
+        C.GVarDecl C.Extern C.NonConst
+            (C.Struct "flounder_if_stats") (stats_var_name name) Nothing,
+        C.Blank,
+
         C.MultiComment [ "Message type signatures (transmit)" ],
         C.UnitList [ msg_signature TX name m | m <- messages ],
         C.Blank,
@@ -283,6 +290,10 @@ binding_struct n ml = C.StructDecl (intf_bind_type n) fields
         C.Param (C.TypeName "size_t") "tx_str_len",
         C.Param (C.TypeName "size_t") "rx_str_len",
         C.Param (C.Struct "event_queue_node") "event_qnode",
+        C.ParamComment "Message statistics (only used with FLOUNDER_STATS)",
+        C.Param (C.Ptr $ C.Struct "flounder_msg_stats") "tx_stats",
+        C.Param (C.TypeName "uint64_t") "tx_stats_start",
+        C.Param (C.TypeName "uint64_t") "rx_stats_start",
         C.Param (C.Ptr $ C.TypeName $ intf_bind_cont_type n) "bind_cont"]
 
 --
@@ -178,6 +178,9 @@ lmp_stub_body arch infile intf@(Interface ifn descr decls) = C.UnitList [
     C.Include C.Standard ("if/" ++ ifn ++ "_defs.h"),
     C.Blank,
 
+    stats_defs ifn messages,
+    C.Blank,
+
     C.MultiComment [ "Send handler functions" ],
     C.UnitList [ tx_handler arch ifn m | m <- msg_specs ],
     C.Blank,
@@ -625,7 +628,8 @@ rx_handler arch ifn typedefs msgdefs msgs =
             C.SComment "unmarshall message number from first word, set fragment to 0",
             C.Ex $ C.Assignment rx_msgnum_field $
                 C.Binary C.BitwiseAnd (C.SubscriptOf msgwords $ C.NumConstant 0) msgnum_mask,
-            C.Ex $ C.Assignment rx_msgfrag_field (C.NumConstant 0)
+            C.Ex $ C.Assignment rx_msgfrag_field (C.NumConstant 0),
+            start_new_recv
         ] [],
         C.SBlank,
 
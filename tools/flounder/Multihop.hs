@@ -263,6 +263,9 @@ multihop_stub_body arch infile intf@(Interface ifn descr decls) = C.UnitList [
       C.Include C.Standard "flounder/flounder_support.h",
       C.Include C.Standard ("if/" ++ ifn ++ "_defs.h"),
       C.Blank,
+
+      stats_defs ifn messages,
+      C.Blank,
  
       C.MultiComment [ "Capability sender function" ],
       (if (contains_caps) then 
@@ -853,7 +856,8 @@ rx_handler arch ifn typedefs msgdefs msgs =
         C.Ex $ C.Assignment rx_msgnum_field $
         C.Binary C.BitwiseAnd (C.SubscriptOf msgwords $ C.NumConstant 0) msgnum_mask,
         C.Ex $ C.Assignment rx_msgfrag_field (C.NumConstant 0),
-        C.Ex $ C.Assignment rx_capnum_field (C.NumConstant 0)] 
+        C.Ex $ C.Assignment rx_capnum_field (C.NumConstant 0),
+        start_new_recv] 
       [C.Ex $ C.Call "assert" [C.Unary C.Not (C.Variable "\"should not happen\"") ]],
       C.SBlank,
       
@@ -17,6 +17,7 @@ import qualified CAbsSyntax as C
 import qualified Backend
 import BackendCommon hiding (errvar)
 import GHBackend (msg_signature_generic, intf_vtbl_param)
+import THCBackend (isOOORPC)
 import Syntax
 
 ------------------------------------------------------------------------
@@ -51,6 +52,27 @@ rpc_error_fn_name ifn = ifscope ifn "rpc_client_error"
 rpc_vtbl_type :: String -> String
 rpc_vtbl_type ifn = ifscope ifn "rpc_vtbl"
 
+-- Names of the asynchronous RPC function, its type and its helpers
+rpc_async_fn_name ifn mn = idscope ifn mn "rpc_async"
+rpc_async_fn_type ifn mn = idscope ifn mn "rpc_async_fn"
+rpc_async_cont_type ifn mn = idscope ifn mn "rpc_async_cont_fn"
+rpc_async_send_fn_name ifn mn = idscope ifn mn "rpc_async_send"
+rpc_async_fail_fn_name ifn mn = idscope ifn mn "rpc_async_fail"
+
+-- Name of the struct type holding the arguments of a queued call
+rpc_async_msg_st_type ifn mn = idscope ifn mn "rpc_async_msg_st"
+
+-- Name of the union of all queued call types
+rpc_async_msg_union_type ifn = ifscope ifn "rpc_async_msg_st"
+
+-- Name of the asynchronous RPC vtable and its type
+rpc_async_vtbl_name ifn = ifscope ifn "rpc_async_vtbl"
+rpc_async_vtbl_type ifn = ifscope ifn "rpc_async_vtbl"
+
+-- Name of the function waiting for asynchronous calls
+rpc_async_wait_fn_name :: String -> String
+rpc_async_wait_fn_name ifn = ifscope ifn "rpc_async_wait"
+
 ------------------------------------------------------------------------
 -- Language mapping: Create the header file for this interconnect driver
 ------------------------------------------------------------------------
@@ -71,6 +93,8 @@ rpc_header_body infile interface@(Interface name descr decls) = [
     C.MultiComment [ "RPC client" ],
     C.Blank,
     C.Include C.Standard ("if/" ++ name ++ "_defs.h"),
+    C.Include C.Standard "flounder/flounder_txqueue.h",
+    C.Include C.Standard "flounder/flounder_rpc_async.h",
     C.Blank,
     C.MultiComment [ "Forward declaration of binding type" ],
     C.StructForwardDecl (rpc_bind_type name),
@@ -79,14 +103,23 @@ rpc_header_body infile interface@(Interface name descr decls) = [
     C.UnitList [ msg_signature_generic TX name types (rpc_binding_param name) m
                 | m <- rpcs ],
     C.Blank,
+    C.MultiComment [ "Asynchronous function and continuation signatures" ],
+    C.UnitList [ rpc_async_signatures name m | m <- rpcs ],
+    C.Blank,
     C.MultiComment [ "VTable struct definition for the interface" ],
     rpc_vtbl_decl name rpcs,
     C.Blank,
+    C.MultiComment [ "VTable struct definition for asynchronous calls" ],
+    rpc_async_vtbl_decl name rpcs,
+    C.Blank,
     C.MultiComment [ "The Binding structure" ],
     rpc_binding_struct name,
     C.Blank,
     C.MultiComment [ "Function to initialise an RPC client" ],
     rpc_init_fn_proto name,
+    C.Blank,
+    C.MultiComment [ "Function to wait for asynchronous calls to complete" ],
+    rpc_async_wait_fn_proto name,
     C.Blank]
     where
         (types, messagedecls) = Backend.partitionTypesMessages decls
@@ -96,6 +129,36 @@ rpc_vtbl_decl :: String -> [MessageDef] -> C.Unit
 rpc_vtbl_decl n ml = 
     C.StructDecl (rpc_vtbl_type n) [ intf_vtbl_param n m TX | m <- ml ]
 
+-- asynchronous calls leave out the request ID, which the stub assigns
+rpc_async_args :: MessageDef -> ([MessageArgument], [MessageArgument])
+rpc_async_args m@(RPC _ args _)
+    | isOOORPC m = (tail txargs, tail rxargs)
+    | otherwise = (txargs, rxargs)
+    where
+        (txargs, rxargs) = partition_rpc_args args
+
+rpc_async_signatures :: String -> MessageDef -> C.Unit
+rpc_async_signatures ifn m@(RPC n _ _) = C.UnitList [
+    C.TypeDef (C.Function C.NoScope C.Void cont_params)
+              (rpc_async_cont_type ifn n),
+    C.TypeDef (C.Function C.NoScope (C.TypeName "errval_t") fn_params)
+              (rpc_async_fn_type ifn n)]
+    where
+        (txargs, rxargs) = rpc_async_args m
+        cont_params = [rpc_binding_param ifn,
+                       C.Param (C.Ptr C.Void) "st",
+                       C.Param (C.TypeName "errval_t") "err"]
+                      ++ concat [msg_argdecl RX ifn a | a <- rxargs]
+        fn_params = [rpc_binding_param ifn]
+                    ++ concat [msg_argdecl TX ifn a | a <- txargs]
+                    ++ [C.Param (C.Ptr $ C.TypeName $ rpc_async_cont_type ifn n) "_cont",
+                        C.Param (C.Ptr C.Void) "_st"]
+
+rpc_async_vtbl_decl :: String -> [MessageDef] -> C.Unit
+rpc_async_vtbl_decl ifn ml =
+    C.StructDecl (rpc_async_vtbl_type ifn)
+        [C.Param (C.Ptr $ C.TypeName $ rpc_async_fn_type ifn n) n | RPC n _ _ <- ml]
+
 rpc_binding_param :: String -> C.Param
 rpc_binding_param ifname = C.Param (C.Ptr $ C.Struct $ rpc_bind_type ifname) rpc_bind_var
 
@@ -109,7 +172,12 @@ rpc_binding_struct name = C.StructDecl (rpc_bind_type name) fields
         C.Param (C.TypeName "bool") "reply_present",
         C.Param (C.TypeName "errval_t") "async_error",
         C.Param (C.Struct "waitset") "rpc_waitset",
-        C.Param (C.Struct "waitset_chanstate") "dummy_chanstate"]
+        C.Param (C.Struct "waitset_chanstate") "dummy_chanstate",
+        C.ParamBlank,
+        C.ParamComment "Asynchronous calls",
+        C.Param (C.Struct $ rpc_async_vtbl_type name) "async_vtbl",
+        C.Param (C.Struct "flounder_rpc_async") "async",
+        C.Param (C.Struct "tx_queue") "async_txq"]
 
 rpc_init_fn_proto :: String -> C.Unit
 rpc_init_fn_proto n = 
@@ -118,6 +186,15 @@ rpc_init_fn_proto n =
     where 
       name = rpc_init_fn_name n
 
+rpc_async_wait_fn_proto :: String -> C.Unit
+rpc_async_wait_fn_proto n =
+    C.GVarDecl C.Extern C.NonConst
+         (C.Function C.NoScope (C.TypeName "errval_t") (rpc_async_wait_fn_params n))
+         (rpc_async_wait_fn_name n) Nothing
+
+rpc_async_wait_fn_params n = [C.Param (C.Ptr $ C.Struct (rpc_bind_type n)) "rpc",
+                              C.Param (C.TypeName "size_t") "max_outstanding"]
+
 ------------------------------------------------------------------------
 -- Language mapping: Create the stub (implementation) for this interconnect driver
 ------------------------------------------------------------------------
@@ -141,14 +218,33 @@ rpc_stub_body infile intf@(Interface ifn descr decls) = C.UnitList [
     C.UnitList [ rpc_fn ifn types m | m <- rpcs ],
     C.Blank,
 
+    C.MultiComment [ "State of queued asynchronous calls" ],
+    C.UnitList [ rpc_async_msg_st ifn types m | m <- rpcs ],
+    C.UnionDecl (rpc_async_msg_union_type ifn)
+        ([C.Param (C.Struct "txq_msg_st") "common"]
+         ++ [C.Param (C.Struct $ rpc_async_msg_st_type ifn n) n | RPC n _ _ <- rpcs]),
+    C.Blank,
+
+    C.MultiComment [ "Asynchronous RPC functions" ],
+    C.UnitList [ rpc_async_fns ifn types m i | (m, i) <- zip rpcs [0..] ],
+    C.Blank,
+
     C.MultiComment [ "Receive handlers" ],
-    C.UnitList [ rpc_rx_handler_fn ifn types m | m <- rpcs ],
+    C.UnitList [ rpc_rx_handler_fn ifn types m i | (m, i) <- zip rpcs [0..] ],
     C.Blank,
 
     C.MultiComment [ "RPC Vtable" ],
     rpc_vtbl ifn rpcs,
     C.Blank,
 
+    C.MultiComment [ "Asynchronous RPC Vtable" ],
+    rpc_async_vtbl ifn rpcs,
+    C.Blank,
+
+    C.MultiComment [ "Wait for asynchronous calls" ],
+    rpc_async_wait_fn ifn,
+    C.Blank,
+
     C.MultiComment [ "Error handler" ],
     rpc_error_fn ifn,
     C.Blank,
@@ -163,6 +259,11 @@ rpc_fn :: String -> [TypeDef] -> MessageDef -> C.Unit
 rpc_fn ifn typedefs msg@(RPC n args _) =
     C.FunctionDef C.Static (C.TypeName "errval_t") (rpc_fn_name ifn n) params [
         localvar (C.TypeName "errval_t") errvar_name (Just $ C.Variable "SYS_ERR_OK"),
+        C.SComment "complete outstanding asynchronous calls first",
+        C.Ex $ C.Assignment errvar $ C.Call "flounder_rpc_async_wait"
+                [C.AddressOf $ C.DerefField rpcvar "async", waitset_var,
+                 C.NumConstant 0],
+        C.If (C.Call "err_is_fail" [errvar]) [C.Return errvar] [],
         C.Ex $ C.Call "assert" [C.Unary C.Not rpc_progress_var],
         C.Ex $ C.Call "assert" [C.Binary C.Equals async_err_var (C.Variable "SYS_ERR_OK")],
         C.Ex $ C.Assignment rpc_progress_var (C.Variable "true"),
@@ -223,13 +324,30 @@ rpc_vtbl ifn ml =
     where
         fields = [let mn = msg_name m in (mn, rpc_fn_name ifn mn) | m <- ml]
 
-rpc_rx_handler_fn :: String -> [TypeDef] -> MessageDef -> C.Unit
-rpc_rx_handler_fn ifn typedefs msg@(RPC mn args _) =
+rpc_rx_handler_fn :: String -> [TypeDef] -> MessageDef -> Integer -> C.Unit
+rpc_rx_handler_fn ifn typedefs msg@(RPC mn args _) rpcnum =
     C.FunctionDef C.Static C.Void (rpc_rx_handler_fn_name ifn mn) params [
         C.SComment "get RPC client state pointer",
         localvar (C.Ptr $ C.Struct $ rpc_bind_type ifn) rpc_bind_var $
             Just $ C.DerefField bindvar "st",
         C.SBlank,
+        C.SComment "is this the reply to an asynchronous call?",
+        localvar (C.Ptr $ C.Struct "flounder_rpc_pending") "_p" $
+            Just $ C.Call "flounder_rpc_pending_take"
+                [async_addr, C.NumConstant rpcnum,
+                 C.Variable $ if isOOORPC msg then "true" else "false",
+                 if isOOORPC msg then C.Variable "seq_out" else C.NumConstant 0],
+        C.If (C.Binary C.NotEquals pvar (C.Variable "NULL")) [
+            localvar (C.Ptr $ C.TypeName $ rpc_async_cont_type ifn mn) "_cont" $
+                Just $ C.Cast (C.Ptr $ C.TypeName $ rpc_async_cont_type ifn mn)
+                              (C.DerefField pvar "cont"),
+            localvar (C.Ptr C.Void) "_st" $ Just $ C.DerefField pvar "st",
+            C.Ex $ C.Call "flounder_rpc_pending_free" [async_addr, pvar],
+            C.Ex $ C.CallInd (C.Variable "_cont")
+                ([C.Variable rpc_bind_var, C.Variable "_st", C.Variable "SYS_ERR_OK"]
+                 ++ map C.Variable (concat $ map arg_names async_rxargs)),
+            C.ReturnVoid] [],
+        C.SBlank,
         C.SComment "XXX: stash reply parameters in binding object",
         C.SComment "depending on the interconnect driver, they're probably already there",
         C.StmtList [rx_arg_assignment ifn typedefs mn a | a <- rxargs ],
@@ -243,6 +361,9 @@ rpc_rx_handler_fn ifn typedefs msg@(RPC mn args _) =
         params = [binding_param ifn] ++ concat [msg_argdecl RX ifn a | a <- rxargs]
         bindvar = C.Variable intf_bind_var
         (_, rxargs) = partition_rpc_args args
+        (_, async_rxargs) = rpc_async_args msg
+        pvar = C.Variable "_p"
+        async_addr = C.AddressOf $ C.DerefField (C.Variable rpc_bind_var) "async"
 
 -- XXX: this mirrors BackendCommon.tx_arg_assignment
 rx_arg_assignment :: String -> [TypeDef] -> String -> MessageArgument -> C.Stmt
@@ -272,6 +393,13 @@ rpc_error_fn ifn = C.FunctionDef C.Static C.Void (rpc_error_fn_name ifn)
      localvar (C.Ptr $ C.Struct $ rpc_bind_type ifn) rpc_bind_var $
         Just $ C.DerefField bindvar "st",
      C.SBlank,
+     C.SComment "fail outstanding asynchronous calls",
+     localvar (C.TypeName "bool") "_async" $ Just $
+        C.Binary C.GreaterThan (rpcvar `C.DerefField` "async" `C.FieldOf` "outstanding")
+                               (C.NumConstant 0),
+     C.Ex $ C.Call "flounder_rpc_async_fail_all"
+                [C.AddressOf $ C.DerefField rpcvar "async", rpcvar, errvar],
+     C.SBlank,
      C.If (rpcvar `C.DerefField` "rpc_in_progress")
         [C.Ex $ C.Call "assert" [C.Call "err_is_fail" [errvar]],
          C.Ex $ C.Assignment (C.DerefField rpcvar "async_error") errvar,
@@ -279,7 +407,9 @@ rpc_error_fn ifn = C.FunctionDef C.Static C.Void (rpc_error_fn_name ifn)
          C.Ex $ C.Call "flounder_support_register"
                     [waitset_addr, chanstate_addr,
                      C.Variable "dummy_event_closure", C.Variable "true"]]
-        [C.Ex $ C.Call "USER_PANIC_ERR" [errvar, C.StringConstant "async error in RPC"]]
+        [C.If (C.Unary C.Not $ C.Variable "_async")
+            [C.Ex $ C.Call "USER_PANIC_ERR" [errvar, C.StringConstant "async error in RPC"]]
+            []]
     ]
     where
         rpcvar = C.Variable rpc_bind_var
@@ -311,6 +441,16 @@ rpc_init_fn ifn ml = C.FunctionDef C.NoScope (C.TypeName "errval_t")
          C.Return $ C.Call "err_push" [errvar, C.Variable "FLOUNDER_ERR_CHANGE_WAITSET"]]
         [],
      C.SBlank,
+     C.SComment "Setup state for asynchronous calls",
+     C.Ex $ C.Assignment (C.DerefField rpcvar "async_vtbl")
+                         (C.Variable $ rpc_async_vtbl_name ifn),
+     C.Ex $ C.Call "flounder_rpc_async_init" [C.AddressOf $ C.DerefField rpcvar "async"],
+     C.Ex $ C.Call "txq_init" [C.AddressOf $ C.DerefField rpcvar "async_txq",
+                               bindvar, waitset_addr,
+                               C.Cast (C.TypeName "txq_register_fn_t")
+                                      (C.DerefField bindvar "register_send"),
+                               C.SizeOfT $ C.Union $ rpc_async_msg_union_type ifn],
+     C.SBlank,
      C.SComment "Set RX handlers on binding object for RPCs",
      C.StmtList [C.Ex $ C.Assignment (C.FieldOf (C.DerefField bindvar "rx_vtbl")
                                         (rpc_resp_name mn))
@@ -336,3 +476,144 @@ rpc_rx_union_elem mn fn =
 
 errvar_name = "_err"
 errvar = C.Variable errvar_name
+
+--
+-- State of a queued asynchronous call: the txqueue header and the arguments
+--
+rpc_async_msg_st :: String -> [TypeDef] -> MessageDef -> C.Unit
+rpc_async_msg_st ifn typedefs m@(RPC n args _) =
+    C.StructDecl (rpc_async_msg_st_type ifn n)
+        ([C.Param (C.Struct "txq_msg_st") "common"]
+         ++ concat [field a | a <- txargs])
+    where
+        (txargs, _) = partition_rpc_args args
+        field a@(Arg tr (Name an))
+            | is_array typedefs tr = [C.Param (C.Ptr $ type_c_type ifn tr) an]
+            | otherwise = msg_argdecl TX ifn a
+        field a = msg_argdecl TX ifn a
+
+is_array :: [TypeDef] -> TypeRef -> Bool
+is_array typedefs tr = case lookup_typeref typedefs tr of
+    TArray _ _ _ -> True
+    _ -> False
+
+--
+-- Functions for an asynchronous call: sending the queued call message,
+-- failing an outstanding call and issuing a call
+--
+rpc_async_fns :: String -> [TypeDef] -> MessageDef -> Integer -> C.Unit
+rpc_async_fns ifn typedefs m@(RPC n args _) rpcnum = C.UnitList [
+    C.FunctionDef C.Static (C.TypeName "errval_t") (rpc_async_send_fn_name ifn n)
+        [C.Param (C.Ptr $ C.Struct "txq_msg_st") "txq_st"] [
+        C.StmtList $ if null txargs then [] else [msg_decl],
+        localvar (C.Ptr $ C.Struct $ intf_bind_type ifn) intf_bind_var $
+            Just $ txq_st `C.DerefField` "queue" `C.DerefField` "binding",
+        C.SBlank,
+        C.Return $ C.CallInd tx_func
+            ([bindvar, C.Call "TXQCONT" [txq_st]] ++ concat (map send_arg txargs))
+        ],
+    C.Blank,
+
+    C.FunctionDef C.Static C.Void (rpc_async_fail_fn_name ifn n)
+        [C.Param (C.Ptr C.Void) "rpc",
+         C.Param (C.Ptr $ C.Struct "flounder_rpc_pending") "p",
+         C.Param (C.TypeName "errval_t") "err"] [
+        C.StmtList [C.StmtList [localvar ts an Nothing,
+                                C.Ex $ C.Call "memset" [C.AddressOf $ C.Variable an,
+                                                        C.NumConstant 0,
+                                                        C.SizeOf $ C.Variable an]]
+                    | C.Param ts an <- concat [msg_argdecl RX ifn a | a <- async_rxargs]],
+        C.Ex $ C.CallInd (C.Cast (C.Ptr $ C.TypeName $ rpc_async_cont_type ifn n)
+                                 (C.Variable "p" `C.DerefField` "cont"))
+            ([C.Variable "rpc", C.Variable "p" `C.DerefField` "st", C.Variable "err"]
+             ++ map C.Variable (concat $ map arg_names async_rxargs))
+        ],
+    C.Blank,
+
+    C.FunctionDef C.Static (C.TypeName "errval_t") (rpc_async_fn_name ifn n)
+        ([rpc_binding_param ifn]
+         ++ concat [msg_argdecl TX ifn a | a <- async_txargs]
+         ++ [C.Param (C.Ptr $ C.TypeName $ rpc_async_cont_type ifn n) "_cont",
+             C.Param (C.Ptr C.Void) "_st"]) [
+        localvar (C.Ptr $ C.Struct "flounder_rpc_pending") "_p" $
+            Just $ C.Call "flounder_rpc_pending_alloc" [async_addr],
+        C.If (C.Binary C.Equals pvar (C.Variable "NULL"))
+            [C.Return $ C.Variable "LIB_ERR_MALLOC_FAIL"] [],
+        localvar (C.Ptr $ C.Struct "txq_msg_st") "txq_st" $
+            Just $ C.Call "txq_msg_st_alloc"
+                [C.AddressOf $ C.DerefField rpcvar "async_txq"],
+        C.If (C.Binary C.Equals txq_st (C.Variable "NULL"))
+            [C.Ex $ C.Call "flounder_rpc_pending_free" [async_addr, pvar],
+             C.Return $ C.Variable "LIB_ERR_MALLOC_FAIL"] [],
+        C.SBlank,
+        C.Ex $ C.Assignment (pvar `C.DerefField` "rpcnum") (C.NumConstant rpcnum),
+        C.Ex $ C.Assignment (pvar `C.DerefField` "cont")
+                (C.Cast (C.Ptr $ C.TypeName "flounder_rpc_async_cont_fn")
+                        (C.Variable "_cont")),
+        C.Ex $ C.Assignment (pvar `C.DerefField` "fail")
+                (C.Variable $ rpc_async_fail_fn_name ifn n),
+        C.Ex $ C.Assignment (pvar `C.DerefField` "st") (C.Variable "_st"),
+        C.SBlank,
+        C.SComment "stash the arguments until the message can be sent",
+        C.StmtList $ if null txargs then [] else [msg_decl],
+        C.Ex $ C.Assignment (txq_st `C.DerefField` "send")
+                (C.Variable $ rpc_async_send_fn_name ifn n),
+        C.Ex $ C.Assignment (txq_st `C.DerefField` "cleanup") (C.Variable "NULL"),
+        C.StmtList $ if isOOORPC m
+            then [C.Ex $ C.Assignment (msgvar `C.DerefField` "seq_in")
+                                      (pvar `C.DerefField` "seq")]
+            else [],
+        C.StmtList $ concat [stash_arg a | a <- async_txargs],
+        C.SBlank,
+        C.Ex $ C.Call "flounder_rpc_pending_enqueue" [async_addr, pvar],
+        C.Ex $ C.Call "txq_send" [txq_st],
+        C.Return $ C.Variable "SYS_ERR_OK"
+        ]
+    ]
+    where
+        (txargs, _) = partition_rpc_args args
+        (async_txargs, async_rxargs) = rpc_async_args m
+        msg_st_type = rpc_async_msg_st_type ifn n
+        txq_st = C.Variable "txq_st"
+        msgvar = C.Variable "_msg"
+        msg_decl = localvar (C.Ptr $ C.Struct msg_st_type) "_msg" $
+                        Just $ C.Cast (C.Ptr $ C.Struct msg_st_type) txq_st
+        pvar = C.Variable "_p"
+        rpcvar = C.Variable rpc_bind_var
+        bindvar = C.Variable intf_bind_var
+        async_addr = C.AddressOf $ C.DerefField rpcvar "async"
+        tx_func = C.DerefField bindvar "tx_vtbl" `C.FieldOf` (rpc_call_name n)
+
+        send_arg (Arg tr (Name an))
+            | is_array typedefs tr = [C.DerefPtr $ msgvar `C.DerefField` an]
+            | otherwise = [msgvar `C.DerefField` an]
+        send_arg (Arg _ (DynamicArray an al))
+            = [msgvar `C.DerefField` an, msgvar `C.DerefField` al]
+
+        stash_arg (Arg tr (Name an))
+            | is_array typedefs tr
+                = [C.Ex $ C.Assignment (msgvar `C.DerefField` an)
+                        (C.Cast (C.Ptr $ type_c_type ifn tr) (C.Variable an))]
+            | otherwise
+                = [C.Ex $ C.Assignment (msgvar `C.DerefField` an) (C.Variable an)]
+        stash_arg (Arg _ (DynamicArray an al))
+            = [C.Ex $ C.Assignment (msgvar `C.DerefField` an) (C.Variable an),
+               C.Ex $ C.Assignment (msgvar `C.DerefField` al) (C.Variable al)]
+
+rpc_async_vtbl :: String -> [MessageDef] -> C.Unit
+rpc_async_vtbl ifn ml =
+    C.StructDef C.Static (rpc_async_vtbl_type ifn) (rpc_async_vtbl_name ifn) fields
+    where
+        fields = [let mn = msg_name m in (mn, rpc_async_fn_name ifn mn) | m <- ml]
+
+rpc_async_wait_fn :: String -> C.Unit
+rpc_async_wait_fn ifn =
+    C.FunctionDef C.NoScope (C.TypeName "errval_t") (rpc_async_wait_fn_name ifn)
+            (rpc_async_wait_fn_params ifn) [
+        C.Return $ C.Call "flounder_rpc_async_wait"
+            [C.AddressOf $ C.DerefField rpcvar "async",
+             C.AddressOf $ C.DerefField rpcvar "rpc_waitset",
+             C.Variable "max_outstanding"]
+    ]
+    where
+        rpcvar = C.Variable "rpc"
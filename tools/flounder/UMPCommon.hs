@@ -280,6 +280,9 @@ stub_body p infile intf@(Interface ifn descr decls) = C.UnitList [
       C.Include C.Standard ("if/" ++ ifn ++ "_defs.h"),
       C.Blank,
 
+      stats_defs ifn messages,
+      C.Blank,
+
       C.MultiComment [ "Send handler function" ],
       tx_handler p ifn msg_specs,
       C.UnitList $ if (drvname == "ump") then [ tx_bind_msg p ifn ] else [],
@@ -1231,7 +1234,8 @@ rx_handler p ifn typedefs msgdefs msgs =
             C.SComment "is this the start of a new message?",
             C.If (C.Binary C.Equals rx_msgnum_field (C.NumConstant 0)) [
                 C.Ex $ C.Assignment rx_msgnum_field (C.Variable "msgnum"),
-                C.Ex $ C.Assignment rx_msgfrag_field (C.NumConstant 0)
+                C.Ex $ C.Assignment rx_msgfrag_field (C.NumConstant 0),
+                start_new_recv
             ] [],
             C.SBlank,
 
@@ -1314,7 +1318,9 @@ rx_handler p ifn typedefs msgdefs msgs =
                 ],
             C.Break]
             where
-                args = [msg_arg, string_arg, pos_arg, len_arg]
+                args = [state_arg, msgnum_arg, msg_arg, string_arg, pos_arg, len_arg]
+                state_arg = C.AddressOf $ C.DerefField my_bindvar "ump_state"
+                msgnum_arg = C.Variable $ msg_enum_elem_name ifn mn
                 msg_arg = C.Variable "msg"
                 string_arg = C.AddressOf $ argfield_expr RX mn af
                 pos_arg = C.AddressOf $ C.DerefField bindvar "rx_str_pos"
@@ -1333,7 +1339,9 @@ rx_handler p ifn typedefs msgdefs msgs =
                 ],
             C.Break]
             where
-                args = [msg_arg, buf_arg, len_arg, pos_arg]
+                args = [state_arg, msgnum_arg, msg_arg, buf_arg, len_arg, pos_arg]
+                state_arg = C.AddressOf $ C.DerefField my_bindvar "ump_state"
+                msgnum_arg = C.Variable $ msg_enum_elem_name ifn mn
                 msg_arg = C.Variable "msg"
                 buf_arg = C.Cast (C.Ptr $ C.Ptr C.Void) $ C.AddressOf $ argfield_expr RX mn afn
                 len_arg = C.AddressOf $ argfield_expr RX mn afl
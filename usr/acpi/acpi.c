@@ -133,7 +133,7 @@ static ACPI_STATUS pci_resource_walker(ACPI_RESOURCE *resource, void *context)
             }
         }
 */
-        skb_add_fact("rootbridge_address_window(addr(%u, %u, %u), mem(%"PRIuLPADDR", %"PRIuLPADDR")).",
+        skb_add_fact_batched("rootbridge_address_window(addr(%u, %u, %u), mem(%"PRIuLPADDR", %"PRIuLPADDR")).",
             ret->addr.bus, ret->addr.device, ret->addr.function,
             min, max);
         if (ret->minmem == ret->maxmem) {
@@ -270,7 +270,7 @@ static ACPI_STATUS fixed_resource_walker(ACPI_RESOURCE *resource, void *context)
         /* XXX: TODO: insert something in the SKB */
         assert(n_reserved_memory_regions < MAX_RESERVED_MEM_REGIONS);
         reserved_memory[n_reserved_memory_regions++] = range;
-        skb_add_fact("fixed_memory(%"PRIuLPADDR",%"PRIuLPADDR").", range.min,
+        skb_add_fact_batched("fixed_memory(%"PRIuLPADDR",%"PRIuLPADDR").", range.min,
             range.limit);
     }
 
@@ -321,8 +321,8 @@ static void get_irq_routing(ACPI_HANDLE handle, uint8_t bus)
 
         if (*prt->Source == 0) {
             /* this is a global interrupt number */
-            skb_add_fact("prt(addr(%"PRIu8", %"PRIu16", _), %"PRIu32", gsi(%"PRIu32")).",
-                         bus, device, prt->Pin, prt->SourceIndex);
+            skb_add_fact_batched("prt(addr(%"PRIu8", %"PRIu16", _), %"PRIu32", gsi(%"PRIu32")).",
+                                 bus, device, prt->Pin, prt->SourceIndex);
             continue;
         }
 
@@ -343,8 +343,8 @@ static void get_irq_routing(ACPI_HANDLE handle, uint8_t bus)
                 esource[++j] = '\\';
             }
         }
-        skb_add_fact("prt(addr(%"PRIu8", %"PRIu16", _), %"PRIu32", pir(\"%s\")).",
-                     bus, device, prt->Pin, esource);
+        skb_add_fact_batched("prt(addr(%"PRIu8", %"PRIu16", _), %"PRIu32", pir(\"%s\")).",
+                             bus, device, prt->Pin, esource);
 
 #ifdef ACPI_SERVICE_DEBUG /* debug code to dump resources */
         ACPI_DEBUG("  INITIAL:  ");
@@ -386,8 +386,8 @@ static void get_irq_routing(ACPI_HANDLE handle, uint8_t bus)
                 ACPI_RESOURCE_IRQ *irqres = &res->Data.Irq;
                 //printf("IRQs:");
                 for (int i = 0; i < irqres->InterruptCount; i++) {
-                    skb_add_fact("pir(\"%s\", %u).",
-                                 esource, irqres->Interrupts[i]);
+                    skb_add_fact_batched("pir(\"%s\", %u).",
+                                         esource, irqres->Interrupts[i]);
                     //printf(" %d", irqres->Interrupts[i]);
                 }
                 //printf("\n");
@@ -400,8 +400,8 @@ static void get_irq_routing(ACPI_HANDLE handle, uint8_t bus)
                 //printf("Extended IRQs:");
                 for (int i = 0; i < irqres->InterruptCount; i++) {
                     //printf(" %d", irqres->Interrupts[i]);
-                    skb_add_fact("pir(\"%s\", %"PRIu32").",
-                                 esource, irqres->Interrupts[i]);
+                    skb_add_fact_batched("pir(\"%s\", %"PRIu32").",
+                                         esource, irqres->Interrupts[i]);
                 }
                 //printf("\n");
                 break;
@@ -549,6 +549,8 @@ static ACPI_STATUS add_pci_device(ACPI_HANDLE handle, UINT32 level,
            resources.minbus, resources.maxbus, resources.minmem,
            resources.maxmem + 1);
 
+    // synchronous: this also sends the PRT facts batched before, which
+    // the PCI server needs once it sees the octopus record below
     skb_add_fact("rootbridge(addr(%u,%u,%u),childbus(%u,%u),mem(%" PRIuPTR ",%" PRIuPTR ")).",
            bridgeaddr.bus, bridgeaddr.device, bridgeaddr.function,
            resources.minbus, resources.maxbus, resources.minmem,
@@ -690,7 +692,7 @@ static void process_srat(ACPI_TABLE_SRAT *srat)
                     ACPI_DEBUG("CPU local APIC ID: %d\n", a->ApicId);
                     ACPI_DEBUG("CPU local SAPIC EID: %d\n", a->LocalSapicEid);
 
-                    skb_add_fact("cpu_affinity(%d,%d,%"PRIu32").",
+                    skb_add_fact_batched("cpu_affinity(%d,%d,%"PRIu32").",
                         a->ApicId, a->LocalSapicEid, proximitydomain);
                 } else {
                     ACPI_DEBUG("CPU affinity table disabled!\n");
@@ -723,7 +725,7 @@ static void process_srat(ACPI_TABLE_SRAT *srat)
                               hotpluggable ? " Hot-pluggable" : "",
                               nonvolatile ? " Non-volatile" : "");
 
-                    skb_add_fact("memory_affinity(%" PRIu64 ", %" PRIu64 ", %"PRIu32").",
+                    skb_add_fact_batched("memory_affinity(%" PRIu64 ", %" PRIu64 ", %"PRIu32").",
                         a->BaseAddress, a->Length, a->ProximityDomain);
 
                 } else {
@@ -774,8 +776,8 @@ static void process_slit(ACPI_TABLE_SLIT *slit)
              *  relative to 10
              */
             UINT8 entry = slit->Entry[i*locality_count + j];
-            skb_add_fact("node_distance(%" PRIu64 ", %" PRIu64 ", %"PRIu8").", i,
-                         j, entry);
+            skb_add_fact_batched("node_distance(%" PRIu64 ", %" PRIu64 ", %"PRIu8").", i,
+                                 j, entry);
             assert(j!=i || entry == 10);
             ACPI_DEBUG("locality: %lu -> %lu = %u\n", i, j, entry);
         }
@@ -863,7 +865,7 @@ int init_acpi(void)
                    "(segment %u, buses %u-%u)\n", mcfg->Address,
                    mcfg->PciSegment, mcfg->StartBusNumber, mcfg->EndBusNumber);
 
-        skb_add_fact("pcie_confspace(%"PRIu64", %"PRIu16", %"PRIu8", %"PRIu8").",
+        skb_add_fact_batched("pcie_confspace(%"PRIu64", %"PRIu16", %"PRIu8", %"PRIu8").",
                 mcfg->Address, mcfg->PciSegment, mcfg->StartBusNumber,
                 mcfg->EndBusNumber);
 
@@ -158,7 +158,7 @@ static errval_t init_allocators(void)
     for (int i = 0; i < bootinfo->regions_length; i++) {
 		struct mem_region *mrp = &bootinfo->regions[i];
 		if (mrp->mr_type == RegionType_Module) {
-			skb_add_fact("memory_region(16'%" PRIxGENPADDR ",%u,%zu,%u,%tu).",
+			skb_add_fact_batched("memory_region(16'%" PRIxGENPADDR ",%u,%zu,%u,%tu).",
 						mrp->mr_base,
 						0,
 						mrp->mrmod_size,
@@ -166,7 +166,7 @@ static errval_t init_allocators(void)
 						mrp->mrmod_data);
 		}
 		else {
-			skb_add_fact("memory_region(16'%" PRIxGENPADDR ",%u,%zu,%u,%tu).",
+			skb_add_fact_batched("memory_region(16'%" PRIxGENPADDR ",%u,%zu,%u,%tu).",
 						mrp->mr_base,
 						mrp->mr_bits,
 						((size_t)1) << mrp->mr_bits,
@@ -214,13 +214,13 @@ static errval_t setup_skb_info(void)
         return err;
     }
 
-    skb_add_fact("mem_region_type(%d,ram).", RegionType_Empty);
-    skb_add_fact("mem_region_type(%d,roottask).", RegionType_RootTask);
-    skb_add_fact("mem_region_type(%d,phyaddr).", RegionType_PhyAddr);
-    skb_add_fact("mem_region_type(%d,multiboot_module).", RegionType_Module);
-    skb_add_fact("mem_region_type(%d,platform_data).", RegionType_PlatformData);
-    skb_add_fact("mem_region_type(%d,apic).", RegionType_LocalAPIC);
-    skb_add_fact("mem_region_type(%d,ioapic).", RegionType_IOAPIC);
+    skb_add_fact_batched("mem_region_type(%d,ram).", RegionType_Empty);
+    skb_add_fact_batched("mem_region_type(%d,roottask).", RegionType_RootTask);
+    skb_add_fact_batched("mem_region_type(%d,phyaddr).", RegionType_PhyAddr);
+    skb_add_fact_batched("mem_region_type(%d,multiboot_module).", RegionType_Module);
+    skb_add_fact_batched("mem_region_type(%d,platform_data).", RegionType_PlatformData);
+    skb_add_fact_batched("mem_region_type(%d,apic).", RegionType_LocalAPIC);
+    skb_add_fact_batched("mem_region_type(%d,ioapic).", RegionType_IOAPIC);
 
     return err;
 }
@@ -286,6 +286,11 @@ int main(int argc, char *argv[])
         video_init();
     }
 
+    err = skb_flush_facts();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "Populating SKB failed.");
+    }
+
     start_service();
 
     messages_handler_loop();
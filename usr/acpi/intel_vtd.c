@@ -629,7 +629,7 @@ static void vtd_parse_dev_scope_structure(int segment, char *begin, char *end, e
 	// A device may have already been reported to the SKB for an earlier
 	// translation structure.
 	if (err_is_fail(err)) {
-	    skb_add_fact("dmar_device(%"PRIu8",%"PRIu8","
+	    skb_add_fact_batched("dmar_device(%"PRIu8",%"PRIu8","
 			 "addr(%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32"),%"PRIu8").",
 			 type, entry->EntryType, segment, bus, dev, func, entry->EnumerationId);
 	    VTD_DEBUG("Adding device %d:%d:%d:%d\n", segment, bus, dev, func);
@@ -648,7 +648,7 @@ static void vtd_parse_drhd_structure(char *begin, char *end)
 
     drhd = (ACPI_DMAR_HARDWARE_UNIT *)begin;
 
-    skb_add_fact("dmar_hardware_unit(%"PRIu8", %"PRIu16", %"PRIu64").",
+    skb_add_fact_batched("dmar_hardware_unit(%"PRIu8", %"PRIu16", %"PRIu64").",
 		 drhd->Flags, drhd->Segment, drhd->Address);
 
     new_unit = vtd_create_unit(vtd_map_registers(drhd->Address), drhd->Segment);
@@ -670,7 +670,7 @@ static void vtd_parse_rmrr_structure(char *begin, char *end)
 {
     ACPI_DMAR_RESERVED_MEMORY *rmrr;
     rmrr = (ACPI_DMAR_RESERVED_MEMORY *)begin;
-    skb_add_fact("dmar_reserved_memory(%"PRIu16", %"PRIu64", %"PRIu64").",
+    skb_add_fact_batched("dmar_reserved_memory(%"PRIu16", %"PRIu64", %"PRIu64").",
 		 rmrr->Segment, rmrr->BaseAddress, rmrr->EndAddress);
     vtd_parse_dev_scope_structure(rmrr->Segment, begin + sizeof(ACPI_DMAR_RESERVED_MEMORY),
 				  end, ACPI_DMAR_TYPE_RESERVED_MEMORY);
@@ -684,7 +684,7 @@ static void vtd_parse_atsr_structure(char *begin, char *end)
 {
     ACPI_DMAR_ATSR *atsr;
     atsr = (ACPI_DMAR_ATSR *)begin;
-    skb_add_fact("dmar_atsr(%"PRIu8", %"PRIu16").", atsr->Flags, atsr->Segment);
+    skb_add_fact_batched("dmar_atsr(%"PRIu8", %"PRIu16").", atsr->Flags, atsr->Segment);
     if (atsr->Flags == ACPI_DMAR_ALL_PORTS) {
         return;
     }
@@ -700,7 +700,7 @@ static void vtd_parse_rhsa_structure(char *begin, char *end)
 {
     ACPI_DMAR_RHSA *rhsa;
     rhsa = (ACPI_DMAR_RHSA *)begin;
-    skb_add_fact("dmar_rhsa(%"PRIu64", %"PRIu32").", rhsa->BaseAddress, rhsa->ProximityDomain);
+    skb_add_fact_batched("dmar_rhsa(%"PRIu64", %"PRIu32").", rhsa->BaseAddress, rhsa->ProximityDomain);
 }
 
 // Parses an ACPI Name-space Device Declaration structure (ANDD).
@@ -710,7 +710,7 @@ static void vtd_parse_andd_structure(char *begin, char *end)
 {
     ACPI_DMAR_ANDD *andd;
     andd = (ACPI_DMAR_ANDD *)begin;
-    skb_add_fact("dmar_andd(%"PRIu8", %s).", andd->DeviceNumber, andd->ObjectName);
+    skb_add_fact_batched("dmar_andd(%"PRIu8", %s).", andd->DeviceNumber, andd->ObjectName);
 }
 
 // Parses the DMA Remapping Reporting (DMAR) ACPI table.
@@ -837,7 +837,7 @@ int vtd_init(void)
     VTD_FOR_EACH(u, vtd_units) {
         vtd_set_root_table(u);
 	vtd_trnsl_enable(u);
-	skb_add_fact("vtd_enabled(%"PRIu16",%"PRIu8").", u->pci_seg, vtd_coherency(u));
+	skb_add_fact_batched("vtd_enabled(%"PRIu16",%"PRIu8").", u->pci_seg, vtd_coherency(u));
     }
 
     VTD_DEBUG("Enabling DMA remapping succeeded\n");
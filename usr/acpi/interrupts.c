@@ -164,12 +164,12 @@ int init_all_apics(void)
 
     // Parse main table entries
     ACPI_DEBUG("Local APIC is at 0x%"PRIx32"\n", madt->Address);
-    skb_add_fact("memory_region(%" PRIu32 ",%u,%zu, %u,%u).",
-                 madt->Address,
-                 APIC_BITS, //from documentation
-                 ((size_t)1) << APIC_BITS, //from documentation
-                 RegionType_LocalAPIC,
-                 0);
+    skb_add_fact_batched("memory_region(%" PRIu32 ",%u,%zu, %u,%u).",
+                         madt->Address,
+                         APIC_BITS, //from documentation
+                         ((size_t)1) << APIC_BITS, //from documentation
+                         RegionType_LocalAPIC,
+                         0);
 
     if((madt->Flags & ACPI_MADT_PCAT_COMPAT) == ACPI_MADT_MULTIPLE_APIC) {
         ACPI_DEBUG("This system also has dual-8259As.\n");
@@ -204,7 +204,7 @@ int init_all_apics(void)
                                          barrelfish_id, CURRENT_CPU_TYPE);
                 assert(err_is_ok(err));
 
-                skb_add_fact("apic(%d,%d,%"PRIu32").",
+                skb_add_fact_batched("apic(%d,%d,%"PRIu32").",
                        s->ProcessorId, s->Id,
                        s->LapicFlags & ACPI_MADT_ENABLED);
 
@@ -223,13 +223,13 @@ int init_all_apics(void)
                 ACPI_DEBUG("Found I/O APIC: ID = %d, mem base = 0x%"PRIx32", "
                        "INTI base = %"PRIu32"\n", s->Id, s->Address, s->GlobalIrqBase);
 
-                skb_add_fact("ioapic(%d,%"PRIu32",%"PRIu32").", s->Id, s->Address, s->GlobalIrqBase);
-                skb_add_fact("memory_region(%"PRIu32",%u,%zu, %u,%u).",
-                             s->Address,
-                             BASE_PAGE_BITS, //as used elswhere in acpi.c
-                             ((size_t)1) << BASE_PAGE_BITS, //as used elswhere in acpi.c
-                             RegionType_IOAPIC,
-                             0);
+                skb_add_fact_batched("ioapic(%d,%"PRIu32",%"PRIu32").", s->Id, s->Address, s->GlobalIrqBase);
+                skb_add_fact_batched("memory_region(%"PRIu32",%u,%zu, %u,%u).",
+                                     s->Address,
+                                     BASE_PAGE_BITS, //as used elswhere in acpi.c
+                                     ((size_t)1) << BASE_PAGE_BITS, //as used elswhere in acpi.c
+                                     RegionType_IOAPIC,
+                                     0);
 
                 err = init_one_ioapic(s);
                 if(err_is_fail(err)) {
@@ -249,7 +249,7 @@ int init_all_apics(void)
                        "GSI = %"PRIu32", flags = %x\n", s->Bus, s->SourceIrq,
                        s->GlobalIrq, s->IntiFlags);
 
-                skb_add_fact("interrupt_override(%d,%d,%"PRIu32",%d).",
+                skb_add_fact_batched("interrupt_override(%d,%d,%"PRIu32",%d).",
                             s->Bus, s->SourceIrq, s->GlobalIrq, s->IntiFlags);
 
                 // ACPI spec says these are only for ISA interrupts
@@ -309,7 +309,7 @@ int init_all_apics(void)
                 ACPI_DEBUG("Found local APIC NMI: CPU ID = %d, flags = %x, "
                        "LINT = %d\n", s->ProcessorId, s->IntiFlags, s->Lint);
 
-                skb_add_fact("apic_nmi(%d,%d,%d).",s->ProcessorId, s->IntiFlags,
+                skb_add_fact_batched("apic_nmi(%d,%d,%d).",s->ProcessorId, s->IntiFlags,
                                                    s->Lint);
 
                 ACPI_DEBUG("Ignoring for now.\n");
@@ -334,6 +334,13 @@ int init_all_apics(void)
         printf("added missing override from GSI 0 to INTI 2 on QEMU\n");
     }
 
+    // the APIC facts have to be in the SKB before Kaluga boots cores
+    errval_t err = skb_flush_facts();
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "adding APIC facts to the SKB");
+        return -1;
+    }
+
     return 0;
 }
 
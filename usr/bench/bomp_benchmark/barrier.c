@@ -0,0 +1,124 @@
+/**
+ * \file
+ * \brief Barrier and reduction latency benchmark.
+ *
+ * Usage: bomp_benchmark_barrier <num threads>
+ *
+ * Measures the cycles per barrier, and per reduction with bomp_reduce_int64()
+ * compared to an atomic update followed by a barrier, which is what the
+ * reduction clause amounts to.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <barrelfish/barrelfish.h>
+
+#define ROUNDS  10000
+#define RUNS    5
+
+static uint64_t run_barrier(void)
+{
+    uint64_t cycles = 0;
+#pragma omp parallel
+    {
+        uint64_t begin = rdtsc();
+        for (int r = 0; r < ROUNDS; r++) {
+#pragma omp barrier
+        }
+        if (omp_get_thread_num() == 0) {
+            cycles = rdtsc() - begin;
+        }
+    }
+    return cycles;
+}
+
+static uint64_t run_reduce(void)
+{
+    uint64_t cycles = 0;
+#pragma omp parallel
+    {
+        int n = omp_get_num_threads();
+        int64_t expected = (int64_t)n * (n - 1) / 2;
+
+        uint64_t begin = rdtsc();
+        for (int r = 0; r < ROUNDS; r++) {
+            int64_t sum = bomp_reduce_int64(omp_get_thread_num(),
+                                            BOMP_REDUCE_ADD_INT);
+            assert(sum == expected);
+        }
+        if (omp_get_thread_num() == 0) {
+            cycles = rdtsc() - begin;
+        }
+    }
+    return cycles;
+}
+
+static uint64_t run_atomic(void)
+{
+    uint64_t cycles = 0;
+    static volatile int64_t sum;
+
+    sum = 0;
+#pragma omp parallel
+    {
+        uint64_t begin = rdtsc();
+        for (int r = 0; r < ROUNDS; r++) {
+#pragma omp atomic
+            sum += omp_get_thread_num();
+#pragma omp barrier
+        }
+        if (omp_get_thread_num() == 0) {
+            cycles = rdtsc() - begin;
+            int n = omp_get_num_threads();
+            assert(sum == (int64_t)ROUNDS * n * (n - 1) / 2);
+        }
+    }
+    return cycles;
+}
+
+static void measure(const char *name, uint64_t (*fn)(void), int nthreads)
+{
+    uint64_t min = UINT64_MAX;
+
+    fn(); // warm up
+    for (int r = 0; r < RUNS; r++) {
+        uint64_t t = fn();
+        if (t < min) {
+            min = t;
+        }
+    }
+
+    printf("%-8s threads %3d: %8lu cycles/round\n", name, nthreads,
+           (unsigned long)(min / ROUNDS));
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        printf("usage: %s <num threads>\n", argv[0]);
+        return 1;
+    }
+
+    int nthreads = atoi(argv[1]);
+    assert(nthreads > 0);
+
+    bomp_init(nthreads);
+
+    measure("barrier", run_barrier, nthreads);
+    measure("reduce", run_reduce, nthreads);
+    measure("atomic", run_atomic, nthreads);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * \file
+ * \brief Loop scheduling benchmark with irregular iterations.
+ *
+ * Usage: bomp_benchmark_irregular <num threads>
+ *
+ * Runs loops whose iterations take very different amounts of time with
+ * static, dynamic and guided schedules and prints the cycles each takes.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <omp.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#ifdef POSIX
+static inline uint64_t rdtsc(void)
+{
+    uint32_t eax, edx;
+    __asm volatile ("rdtsc" : "=a" (eax), "=d" (edx));
+    return ((uint64_t)edx << 32) | eax;
+}
+#else
+#include <barrelfish/barrelfish.h>
+#endif
+
+#define N       4096    ///< iterations per loop
+#define UNIT    256     ///< work of the cheapest iteration
+#define CHUNK   16      ///< chunk size of the chunked schedules
+#define RUNS    5
+
+static uint32_t cost[N];
+static volatile uint64_t result[N];
+
+static inline uint64_t work(uint32_t amount)
+{
+    uint64_t x = amount;
+    for (uint32_t i = 0; i < amount; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return x;
+}
+
+/// iteration i costs i units: the last threads get most of the work
+static void workload_triangular(void)
+{
+    for (int i = 0; i < N; i++) {
+        cost[i] = UNIT + (uint32_t)((uint64_t)i * 64 * UNIT / N);
+    }
+}
+
+/// one in sixteen iterations, at random, is a hundred times more expensive
+static void workload_skewed(void)
+{
+    uint32_t seed = 42;
+    for (int i = 0; i < N; i++) {
+        seed = seed * 1103515245 + 12345;
+        cost[i] = ((seed >> 16) % 16 == 0) ? 100 * UNIT : UNIT;
+    }
+}
+
+static uint64_t run_static(void)
+{
+    uint64_t begin = rdtsc();
+    int i;
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < N; i++) {
+        result[i] = work(cost[i]);
+    }
+    return rdtsc() - begin;
+}
+
+static uint64_t run_static_chunked(void)
+{
+    uint64_t begin = rdtsc();
+    int i;
+#pragma omp parallel for schedule(static, CHUNK)
+    for (i = 0; i < N; i++) {
+        result[i] = work(cost[i]);
+    }
+    return rdtsc() - begin;
+}
+
+static uint64_t run_dynamic(void)
+{
+    uint64_t begin = rdtsc();
+    int i;
+#pragma omp parallel for schedule(dynamic, CHUNK)
+    for (i = 0; i < N; i++) {
+        result[i] = work(cost[i]);
+    }
+    return rdtsc() - begin;
+}
+
+static uint64_t run_guided(void)
+{
+    uint64_t begin = rdtsc();
+    int i;
+#pragma omp parallel for schedule(guided)
+    for (i = 0; i < N; i++) {
+        result[i] = work(cost[i]);
+    }
+    return rdtsc() - begin;
+}
+
+/// the same loops in one parallel region, separated by barriers
+static uint64_t run_region(void)
+{
+    uint64_t begin = rdtsc();
+#pragma omp parallel
+    {
+        int i;
+#pragma omp for schedule(dynamic, CHUNK) nowait
+        for (i = 0; i < N / 2; i++) {
+            result[i] = work(cost[i]);
+        }
+#pragma omp for schedule(guided)
+        for (i = N / 2; i < N; i++) {
+            result[i] = work(cost[i]);
+        }
+#pragma omp barrier
+    }
+    return rdtsc() - begin;
+}
+
+static void measure(const char *workload, const char *schedule,
+                    uint64_t (*fn)(void))
+{
+    uint64_t min = UINT64_MAX, sum = 0;
+
+    fn(); // warm up
+    for (int r = 0; r < RUNS; r++) {
+        uint64_t t = fn();
+        sum += t;
+        if (t < min) {
+            min = t;
+        }
+    }
+
+    printf("%-10s %-14s min %12lu avg %12lu cycles\n", workload, schedule,
+           (unsigned long)min, (unsigned long)(sum / RUNS));
+}
+
+static void measure_all(const char *workload)
+{
+    measure(workload, "static", run_static);
+    measure(workload, "static,16", run_static_chunked);
+    measure(workload, "dynamic,16", run_dynamic);
+    measure(workload, "guided", run_guided);
+    measure(workload, "region", run_region);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        printf("usage: %s <num threads>\n", argv[0]);
+        return 1;
+    }
+
+    int nthreads = atoi(argv[1]);
+    assert(nthreads > 0);
+
+#ifndef POSIX
+    bomp_init(nthreads);
+#else
+    omp_set_num_threads(nthreads);
+#endif
+
+    printf("irregular loops with %d threads\n", nthreads);
+
+    workload_triangular();
+    measure_all("triangular");
+
+    workload_skewed();
+    measure_all("skewed");
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * \file
+ * \brief Compares the C++ task executor with raw pthreads
+ *
+ * Usage: cxx_executor_bench [cores] [tasks]
+ *
+ * Runs the same work with an executor spanning the given number of cores
+ * and with pthreads placed round-robin on those cores:
+ *
+ *  - spawn:  tasks independent tasks of small, fixed work, joined
+ *            individually (async/get against pthread_create/pthread_join)
+ *  - reduce: a sum over an array (parallel_reduce against one thread per
+ *            core summing a slice)
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <pthread.h>
+
+#include <executor/executor.hpp>
+#include <bench/bench.h>
+
+#define DEFAULT_TASKS   10000
+#define TASK_WORK       1000
+#define ARRAY_SIZE      (4 * 1024 * 1024)
+#define PTHREAD_BATCH   64
+
+static int ncores = 1;
+static int ntasks = DEFAULT_TASKS;
+static std::vector<uint32_t> array;
+
+static void report(const char *what, const char *how, cycles_t cycles,
+                   uint64_t ops)
+{
+    printf("%-7s %-9s %2d cores %10" PRIu64 " cycles/op %6" PRIu64 " ms\n",
+           what, how, ncores, cycles / ops, bench_tsc_to_ms(cycles));
+}
+
+static uint64_t work(uint64_t seed)
+{
+    volatile uint64_t x = seed;
+    for (int i = 0; i < TASK_WORK; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return x;
+}
+
+static void *work_thread(void *arg)
+{
+    *(uint64_t *)arg = work(*(uint64_t *)arg);
+    return NULL;
+}
+
+struct slice {
+    size_t begin, end;
+    uint64_t sum;
+};
+
+static void *sum_thread(void *arg)
+{
+    struct slice *s = static_cast<struct slice *>(arg);
+    uint64_t sum = 0;
+    for (size_t i = s->begin; i < s->end; i++) {
+        sum += array[i];
+    }
+    s->sum = sum;
+    return NULL;
+}
+
+static void create_on(pthread_t *thread, int i, void *(*fn)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+
+    pthread_attr_init(&attr);
+    CPU_ZERO(&cpus);
+    CPU_SET(disp_get_core_id() + i % ncores, &cpus);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+    int r = pthread_create(thread, &attr, fn, arg);
+    if (r != 0) {
+        USER_PANIC("pthread_create failed: %d\n", r);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+static void bench_spawn(barrelfish::executor &ex)
+{
+    std::vector<barrelfish::future<uint64_t> > futures(ntasks);
+
+    cycles_t start = bench_tsc();
+    for (int i = 0; i < ntasks; i++) {
+        futures[i] = ex.async([i] { return work(i); });
+    }
+    for (int i = 0; i < ntasks; i++) {
+        futures[i].get();
+    }
+    report("spawn", "executor", bench_tsc() - start, ntasks);
+
+    // pthreads in batches, to bound the number of live threads
+    pthread_t threads[PTHREAD_BATCH];
+    uint64_t results[PTHREAD_BATCH];
+    start = bench_tsc();
+    for (int i = 0; i < ntasks; i += PTHREAD_BATCH) {
+        int n = (ntasks - i < PTHREAD_BATCH) ? ntasks - i : PTHREAD_BATCH;
+        for (int j = 0; j < n; j++) {
+            results[j] = i + j;
+            create_on(&threads[j], j, work_thread, &results[j]);
+        }
+        for (int j = 0; j < n; j++) {
+            pthread_join(threads[j], NULL);
+        }
+    }
+    report("spawn", "pthread", bench_tsc() - start, ntasks);
+}
+
+static void bench_reduce(barrelfish::executor &ex)
+{
+    cycles_t start = bench_tsc();
+    uint64_t sum = ex.parallel_reduce((size_t)0, array.size(), (uint64_t)0,
+                                      [] (size_t i) { return (uint64_t)array[i]; },
+                                      [] (uint64_t a, uint64_t b) { return a + b; });
+    report("reduce", "executor", bench_tsc() - start, array.size());
+
+    std::vector<pthread_t> threads(ncores);
+    std::vector<struct slice> slices(ncores);
+    size_t per = array.size() / ncores;
+    start = bench_tsc();
+    for (int i = 0; i < ncores; i++) {
+        slices[i].begin = i * per;
+        slices[i].end = (i == ncores - 1) ? array.size() : (i + 1) * per;
+        create_on(&threads[i], i, sum_thread, &slices[i]);
+    }
+    uint64_t psum = 0;
+    for (int i = 0; i < ncores; i++) {
+        pthread_join(threads[i], NULL);
+        psum += slices[i].sum;
+    }
+    report("reduce", "pthread", bench_tsc() - start, array.size());
+
+    if (sum != psum) {
+        USER_PANIC("sums differ: %" PRIu64 " != %" PRIu64 "\n", sum, psum);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        ncores = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        ntasks = atoi(argv[2]);
+    }
+    if (ncores < 1 || ntasks < 1) {
+        printf("Usage: %s [cores] [tasks]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_init();
+
+    array.resize(ARRAY_SIZE);
+    for (size_t i = 0; i < array.size(); i++) {
+        array[i] = i;
+    }
+
+    // the executor spans the domain, the pthreads reuse its dispatchers
+    std::vector<coreid_t> cores;
+    for (int i = 0; i < ncores; i++) {
+        cores.push_back(disp_get_core_id() + i);
+    }
+    barrelfish::executor ex(cores);
+
+    bench_spawn(ex);
+    bench_reduce(ex);
+
+    size_t executed, stolen;
+    ex.stats(&executed, &stolen);
+    printf("executor ran %zu tasks, %zu stolen\n", executed, stolen);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,358 @@
+/**
+ * \file
+ * \brief Allocations and cycles of the C++ Flounder bindings against C
+ *
+ * Usage: cxx_flounder_bench client|server
+ *
+ * The server echoes string and buffer messages of the test interface. The
+ * client sends ROUNDS messages of each kind, waiting for every reply, and
+ * reports cycles and heap allocations per round trip on its side for:
+ *
+ *  - c:    the C binding, with malloc() for sends and free() for
+ *          replies and in the send continuations
+ *  - cxx:  the generated C++ binding, with owned_string/owned_buffer for
+ *          sends and views of the replies
+ *
+ * each either sending a fresh copy of the payload every round ("copy") or
+ * sending the previous reply back ("forward"). Allocations are counted
+ * through the alt_malloc hook of the default (oldmalloc) allocator.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <if/test_cxx.hpp>
+#include <bench/bench.h>
+
+using namespace flounder::test;
+
+#define ROUNDS      10000
+#define STR_LEN     64
+#define BUF_SIZE    2048
+
+static const char *service_name = "cxx_flounder_bench";
+
+static char str_payload[STR_LEN + 1];
+static uint8_t buf_payload[BUF_SIZE];
+
+/* ------------------------- ALLOCATION COUNTS ------------------------- */
+
+typedef void *(*alt_malloc_t)(size_t bytes);
+extern "C" alt_malloc_t alt_malloc;
+typedef void *(*alt_realloc_t)(void *p, size_t bytes);
+extern "C" alt_realloc_t alt_realloc;
+
+static size_t nallocs;
+
+// Count, then forward to the default allocator, which malloc() uses while
+// the hook is clear. Only safe in a single-threaded domain.
+static void *counting_malloc(size_t bytes)
+{
+    nallocs++;
+    alt_malloc = NULL;
+    void *p = malloc(bytes);
+    alt_malloc = counting_malloc;
+    return p;
+}
+
+static void *counting_realloc(void *ptr, size_t bytes)
+{
+    nallocs++;
+    alt_realloc = NULL;
+    void *p = realloc(ptr, bytes);
+    alt_realloc = counting_realloc;
+    return p;
+}
+
+/* ------------------------------ COMMON ------------------------------ */
+
+static void dispatch(void)
+{
+    errval_t err = event_dispatch(get_default_waitset());
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "event_dispatch");
+    }
+}
+
+static void wait_for(bool &flag)
+{
+    while (!flag) {
+        dispatch();
+    }
+    flag = false;
+}
+
+/// Retries a send until the previous one has completed
+template <typename F>
+static void send_retry(F send)
+{
+    errval_t err;
+    while (err_no(err = send()) == FLOUNDER_ERR_TX_BUSY) {
+        dispatch();
+    }
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "send");
+    }
+}
+
+static size_t start_allocs;
+static cycles_t start_cycles;
+
+static void start(void)
+{
+    start_allocs = nallocs;
+    start_cycles = bench_tsc();
+}
+
+static void report(const char *msg, const char *path, bool forward)
+{
+    cycles_t cycles = bench_tsc() - start_cycles;
+    size_t allocs = nallocs - start_allocs;
+    printf("%-3s %-3s %-7s %8" PRIu64 " cycles/msg %4zu.%02zu allocs/msg\n",
+           msg, path, forward ? "forward" : "copy", cycles / ROUNDS,
+           allocs / ROUNDS, (allocs * 100 / ROUNDS) % 100);
+}
+
+/* ------------------------------ SERVER ------------------------------ */
+
+static void export_cb(void *st, errval_t err, iref_t iref)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "export failed");
+    }
+    err = nameservice_register(service_name, iref);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "nameservice_register failed");
+    }
+}
+
+static errval_t connect_cb(void *st, struct test_binding *b)
+{
+    binding *sb = new binding(b);
+
+    sb->on_str([sb] (str_msg &m) {
+        send_retry([&] { return sb->str(m.arg, m.take_s()); });
+    });
+    sb->on_buf([sb] (buf_msg &m) {
+        send_retry([&] { return sb->buf(m.take_buf()); });
+    });
+
+    return SYS_ERR_OK;
+}
+
+static void run_server(void)
+{
+    errval_t err = test_export(NULL, export_cb, connect_cb,
+                               get_default_waitset(),
+                               (idc_export_flags_t)IDC_EXPORT_FLAGS_DEFAULT);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "export failed");
+    }
+    messages_handler_loop();
+}
+
+/* ------------------------------ C PATH ------------------------------ */
+
+static bool c_got;
+static char *c_str;
+static uint8_t *c_buf;
+static size_t c_sent;
+
+static void c_rx_str(struct test_binding *b, uint32_t arg, char *s)
+{
+    c_str = s;
+    c_got = true;
+}
+
+static void c_rx_buf(struct test_binding *b, uint8_t *buf, size_t buflen)
+{
+    assert(buflen == BUF_SIZE);
+    c_buf = buf;
+    c_got = true;
+}
+
+static char *c_copy_str(void)
+{
+    char *s = static_cast<char *>(malloc(STR_LEN + 1));
+    memcpy(s, str_payload, STR_LEN + 1);
+    return s;
+}
+
+static void c_free_sent(void *arg)
+{
+    free(arg);
+    c_sent++;
+}
+
+static void bench_c(struct test_binding *b, bool forward)
+{
+    b->rx_vtbl.str = c_rx_str;
+    b->rx_vtbl.buf = c_rx_buf;
+    c_sent = 0;
+
+    start();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        char *s = (forward && i > 0) ? c_str : c_copy_str();
+        send_retry([&] {
+            return b->tx_vtbl.str(b, MKCONT(c_free_sent, s), i, s);
+        });
+        wait_for(c_got);
+        if (!forward) {
+            free(c_str);
+        }
+    }
+    report("str", "c", forward);
+    if (forward) {
+        free(c_str);
+    }
+
+    start();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        uint8_t *buf = c_buf;
+        if (!forward || i == 0) {
+            buf = static_cast<uint8_t *>(malloc(BUF_SIZE));
+            memcpy(buf, buf_payload, BUF_SIZE);
+        }
+        send_retry([&] {
+            return b->tx_vtbl.buf(b, MKCONT(c_free_sent, buf), buf, BUF_SIZE);
+        });
+        wait_for(c_got);
+        if (!forward) {
+            free(c_buf);
+        }
+    }
+    report("buf", "c", forward);
+    if (forward) {
+        free(c_buf);
+    }
+
+    // let the last continuation run before the handlers change
+    while (c_sent < 2 * ROUNDS) {
+        dispatch();
+    }
+}
+
+/* ----------------------------- C++ PATH ----------------------------- */
+
+static void bench_cxx(binding &b, bool forward)
+{
+    bool got = false;
+    flounder::owned_string str;
+    flounder::owned_buffer<uint8_t> buf;
+
+    b.on_str([&] (str_msg &m) {
+        assert(m.s.size() == STR_LEN);
+        if (forward) {
+            str = m.take_s();
+        }
+        got = true;
+    });
+    b.on_buf([&] (buf_msg &m) {
+        assert(m.buf.size() == BUF_SIZE);
+        if (forward) {
+            buf = m.take_buf();
+        }
+        got = true;
+    });
+
+    start();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        flounder::owned_string s = (forward && i > 0)
+            ? std::move(str) : flounder::owned_string::copy(str_payload);
+        send_retry([&] { return b.str(i, std::move(s)); });
+        wait_for(got);
+    }
+    report("str", "cxx", forward);
+
+    start();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        flounder::owned_buffer<uint8_t> d = (forward && i > 0)
+            ? std::move(buf)
+            : flounder::owned_buffer<uint8_t>::copy(
+                flounder::span<const uint8_t>(buf_payload, BUF_SIZE));
+        send_retry([&] { return b.buf(std::move(d)); });
+        wait_for(got);
+    }
+    report("buf", "cxx", forward);
+
+    errval_t err = b.wait_sent();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "wait_sent");
+    }
+}
+
+/* ------------------------------ CLIENT ------------------------------ */
+
+static void bind_cb(void *st, errval_t err, struct test_binding *b)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "bind failed");
+    }
+    *static_cast<struct test_binding **>(st) = b;
+}
+
+static void run_client(void)
+{
+    iref_t iref;
+    errval_t err = nameservice_blocking_lookup(service_name, &iref);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "nameservice_blocking_lookup failed");
+    }
+
+    struct test_binding *b = NULL;
+    err = test_bind(iref, bind_cb, &b, get_default_waitset(),
+                    (idc_bind_flags_t)IDC_BIND_FLAGS_DEFAULT);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "bind failed");
+    }
+    while (b == NULL) {
+        dispatch();
+    }
+
+    memset(str_payload, 'x', STR_LEN);
+    for (size_t i = 0; i < BUF_SIZE; i++) {
+        buf_payload[i] = i;
+    }
+
+    alt_malloc = counting_malloc;
+    alt_realloc = counting_realloc;
+
+    bench_c(b, false);
+    bench_c(b, true);
+
+    // the C++ binding takes over the receive handlers
+    binding cxx(b);
+    bench_cxx(cxx, false);
+    bench_cxx(cxx, true);
+
+    alt_malloc = NULL;
+    alt_realloc = NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+
+    if (argc == 2 && strcmp(argv[1], "client") == 0) {
+        run_client();
+    } else if (argc == 2 && strcmp(argv[1], "server") == 0) {
+        run_server();
+    } else {
+        printf("Usage: %s client|server\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -10,6 +10,7 @@
  *
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <barrelfish/barrelfish.h>
@@ -23,6 +24,7 @@
 #include <dma/dma_bench.h>
 #include <dma/client/dma_client_device.h>
 #include <dma/dma_manager_client.h>
+#include <dma/soft/soft_dma_device.h>
 
 #define BENCH_XEON_PHI_DMA 0
 #define BENCH_XEON_PHI_DMA_BASE (4UL * 1024 * 1024 * 1024)
@@ -106,6 +108,35 @@ static void prepare(void)
     debug_printf("preparation done.\n");
 }
 
+/**
+ * \brief compares the software DMA device with a plain memcpy
+ *
+ * \param core  core on which the copy thread of the device runs
+ */
+static void run_soft(coreid_t core)
+{
+    errval_t err;
+
+    debug_printf("software DMA, copy thread on core %u\n", core);
+
+    struct soft_dma_device *dev;
+    err = soft_dma_device_init(1, core, &dev);
+    EXPECT_SUCCESS(err, "initializing software DMA device");
+
+    err = dma_register_memory((struct dma_device *)dev, frame);
+    EXPECT_SUCCESS(err, "registering memory\n");
+
+    debug_printf("soft DMA: buffer 0 -> buffer 1\n");
+    err = dma_bench_run((struct dma_device *)dev, phys[0], phys[1]);
+    EXPECT_SUCCESS(err, "dma_bench_run\n");
+
+    debug_printf("memcpy: buffer 0 -> buffer 1\n");
+    err = dma_bench_run_memcpy(buffers[1], buffers[0]);
+    EXPECT_SUCCESS(err, "dma_bench_run_memcpy\n");
+
+    debug_printf("DMA Benchmark done.\n");
+}
+
 int main(int argc,
          char *argv[])
 {
@@ -117,6 +148,16 @@ int main(int argc,
 
     bench_init();
 
+    /* dma_bench soft [core]: software DMA device against memcpy */
+    if (argc > 1 && strcmp(argv[1], "soft") == 0) {
+        coreid_t core = disp_get_core_id();
+        if (argc > 2) {
+            core = atoi(argv[2]);
+        }
+        run_soft(core);
+        return 0;
+    }
+
 #if 0
     char svc_name[30];
     uint8_t numa_node = (disp_get_core_id() >= 20);
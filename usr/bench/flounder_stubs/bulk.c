@@ -0,0 +1,209 @@
+/**
+ * \file
+ * \brief Flounder stubs throughput for large buffer and string arguments
+ *
+ * Sends buffers and strings of 64 bytes to 16 KB to a domain on another
+ * core, which acknowledges each with an empty reply, and reports the
+ * round-trip time and throughput for every size.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <barrelfish/barrelfish.h>
+#include <string.h>
+#include <barrelfish/nameservice_client.h>
+#include <barrelfish/spawn_client.h>
+#include <bench/bench.h>
+#include <if/bench_defs.h>
+
+#define MIN_SIZE    64
+#define MAX_SIZE    (16 * 1024)
+#define ITERATIONS  1000
+
+static char my_name[100];
+static char payload[MAX_SIZE];
+
+static struct bench_binding *binding;
+static coreid_t my_core_id;
+
+static size_t size = MIN_SIZE;
+static bool strings = false;
+static int iteration = 0;
+static cycles_t start;
+
+static void send_next(void)
+{
+    errval_t err;
+
+    if (strings) {
+        // the terminating '\0' is part of the transferred bytes
+        payload[size - 1] = '\0';
+        err = binding->tx_vtbl.fsb_string_request(binding, NOP_CONT, payload);
+        payload[size - 1] = 'x';
+    } else {
+        err = binding->tx_vtbl.fsb_buffer_request(binding, NOP_CONT,
+                                                  (uint8_t *)payload, size);
+    }
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "sending request");
+    }
+}
+
+static void experiment(void)
+{
+    if (iteration == 0) {
+        start = bench_tsc();
+    } else if (iteration == ITERATIONS) {
+        cycles_t cycles = bench_tsc() - start;
+        uint64_t ms = bench_tsc_to_ms(cycles);
+        printf("%-6s %6zu bytes %10"PRIuCYCLES" cycles/rtt %8"PRIu64" KB/s\n",
+               strings ? "string" : "buffer", size, cycles / ITERATIONS,
+               ms > 0 ? (uint64_t)size * ITERATIONS / ms : 0);
+
+        iteration = 0;
+        size *= 2;
+        if (size > MAX_SIZE) {
+            if (strings) {
+                printf("client done\n");
+                return;
+            }
+            strings = true;
+            size = MIN_SIZE;
+        }
+        start = bench_tsc();
+    }
+
+    iteration++;
+    send_next();
+}
+
+static void fsb_init_msg(struct bench_binding *b, coreid_t id)
+{
+    binding = b;
+    printf("Running flounder_stubs_bulk between core %d and core %d\n",
+           my_core_id, id);
+    memset(payload, 'x', sizeof(payload));
+    experiment();
+}
+
+static void fsb_empty_reply(struct bench_binding *b)
+{
+    experiment();
+}
+
+static void reply(struct bench_binding *b)
+{
+    errval_t err = b->tx_vtbl.fsb_empty_reply(b, NOP_CONT);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "sending reply");
+    }
+}
+
+static void fsb_buffer_request(struct bench_binding *b, uint8_t *buf,
+                               size_t len)
+{
+    free(buf);
+    reply(b);
+}
+
+static void fsb_string_request(struct bench_binding *b, char *s)
+{
+    free(s);
+    reply(b);
+}
+
+static struct bench_rx_vtbl rx_vtbl = {
+    .fsb_init_msg   = fsb_init_msg,
+    .fsb_empty_reply = fsb_empty_reply,
+    .fsb_buffer_request = fsb_buffer_request,
+    .fsb_string_request = fsb_string_request,
+};
+
+static void bind_cb(void *st, errval_t binderr, struct bench_binding *b)
+{
+    // copy my message receive handler vtable to the binding
+    b->rx_vtbl = rx_vtbl;
+
+    errval_t err;
+    err = b->tx_vtbl.fsb_init_msg(b, NOP_CONT, my_core_id);
+    assert(err_is_ok(err));
+}
+
+static void export_cb(void *st, errval_t err, iref_t iref)
+{
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "export failed");
+        abort();
+    }
+
+    // register this iref with the name service
+    err = nameservice_register("fsb_bulk_server", iref);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "nameservice_register failed");
+        abort();
+    }
+}
+
+static errval_t connect_cb(void *st, struct bench_binding *b)
+{
+    // copy my message receive handler vtable to the binding
+    b->rx_vtbl = rx_vtbl;
+
+    // accept the connection
+    return SYS_ERR_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+
+    /* Set my core id */
+    my_core_id = disp_get_core_id();
+    strcpy(my_name, argv[0]);
+
+    bench_init();
+
+    if (argc == 1) { /* bsp core */
+        /*
+          1. spawn domain,
+          2. setup a server,
+          3. wait for client to connect,
+          4. run experiment
+        */
+        char *xargv[] = {my_name, "dummy", NULL};
+        err = spawn_program(1, my_name, xargv, NULL,
+                            SPAWN_FLAGS_DEFAULT, NULL);
+        assert(err_is_ok(err));
+
+        /* Setup a server */
+        err = bench_export(NULL, export_cb, connect_cb, get_default_waitset(),
+                           IDC_BIND_FLAGS_DEFAULT);
+        assert(err_is_ok(err));
+    } else {
+        /* Connect to the server */
+        iref_t iref;
+
+        err = nameservice_blocking_lookup("fsb_bulk_server", &iref);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "nameservice_blocking_lookup failed");
+            abort();
+        }
+
+        err = bench_bind(iref, bind_cb, NULL,
+                         get_default_waitset(), IDC_BIND_FLAGS_DEFAULT);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "bind failed");
+            abort();
+        }
+    }
+
+    messages_handler_loop();
+}
@@ -0,0 +1,132 @@
+/**
+ * \file
+ * \brief Benchmark of malloc-heavy workloads on heaps with different page sizes
+ *
+ * Usage: largepage_malloc_bench [morecore=<pagesize>|morecore=auto] [MB]
+ *
+ * The morecore argument is consumed by libbarrelfish and selects the pages
+ * backing the heap; run the benchmark once with each to compare them. The
+ * benchmark allocates objects of mixed sizes up to the given heap size, then
+ * chases pointers through them in random order and frees them again.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/morecore.h>
+#include <barrelfish/vspace_mmu_aware.h>
+#include <bench/bench.h>
+
+#define DEFAULT_HEAP_MB 256
+#define CHASE_ROUNDS    4
+
+/// an allocated object, linked in random order
+struct object {
+    struct object *next;
+    size_t size;
+};
+
+static uint64_t seed = 0x2545f4914f6cdd1dULL;
+
+static uint64_t next_random(void)
+{
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 0x2545f4914f6cdd1dULL;
+}
+
+/// object sizes from 32 bytes to 16 KB, skewed towards small ones
+static size_t object_size(void)
+{
+    return (size_t)32 << (next_random() % 10);
+}
+
+static void report(const char *what, cycles_t cycles, size_t count)
+{
+    printf("%-8s %14" PRIu64 " cycles %8" PRIu64 " ms %8" PRIu64
+           " cycles/object\n", what, cycles, bench_tsc_to_ms(cycles),
+           count ? cycles / count : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t heap = (size_t)(argc > 1 ? atol(argv[1]) : DEFAULT_HEAP_MB) << 20;
+
+    bench_init();
+
+    /* allocate */
+    size_t max = heap / 64;
+    struct object **objects = malloc(max * sizeof(struct object *));
+    assert(objects != NULL);
+
+    size_t count = 0, total = 0;
+    cycles_t start = bench_tsc();
+    while (total < heap && count < max) {
+        size_t size = object_size();
+        struct object *o = malloc(size);
+        if (o == NULL) {
+            printf("out of memory after %zu bytes\n", total);
+            break;
+        }
+        o->size = size;
+        objects[count++] = o;
+        total += size;
+    }
+    cycles_t end = bench_tsc();
+    report("malloc", bench_time_diff(start, end), count);
+    if (count == 0) {
+        return 1;
+    }
+
+    /* link the objects in random order */
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = next_random() % (i + 1);
+        struct object *tmp = objects[i];
+        objects[i] = objects[j];
+        objects[j] = tmp;
+    }
+    for (size_t i = 0; i < count; i++) {
+        objects[i]->next = objects[(i + 1) % count];
+    }
+
+    /* chase the pointers, touching the end of each object as well */
+    start = bench_tsc();
+    struct object *o = objects[0];
+    size_t sum = 0;
+    for (size_t i = 0; i < CHASE_ROUNDS * count; i++) {
+        sum += ((uint8_t *)o)[o->size - 1];
+        o = o->next;
+    }
+    end = bench_tsc();
+    report("chase", bench_time_diff(start, end), CHASE_ROUNDS * count);
+
+    /* free */
+    start = bench_tsc();
+    for (size_t i = 0; i < count; i++) {
+        free(objects[i]);
+    }
+    end = bench_tsc();
+    report("free", bench_time_diff(start, end), count);
+
+    free(objects);
+
+    struct vspace_mmu_aware_stats stats;
+    morecore_get_stats(&stats);
+    printf("heap: %zu objects, %zu MB; %zu frames, 1G: %zu MB, 2M: %zu MB, "
+           "4K: %zu MB, fallbacks: %zu (checksum %zu)\n", count, total >> 20,
+           stats.frames, stats.huge_bytes >> 20, stats.large_bytes >> 20,
+           stats.base_bytes >> 20, stats.fallbacks, sum);
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * \file
+ * \brief Revocation latency benchmark
+ *
+ * Usage: revoke_bench [runs=NUM] [logcount=NUM] [type=ram|cnode]
+ *
+ * Builds a two-level tree of 2^logcount descendants of a RAM cap and
+ * measures the time to revoke it. RAM descendants are deleted while the
+ * tree is marked; CNode descendants have to go through the delete and
+ * clear steps performed by the monitor.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+
+#define assert_err(err, msg) do { \
+    if (err_is_fail(err)) \
+        USER_PANIC_ERR(err, msg); \
+} while (0)
+
+/// Leaves per intermediate RAM cap, one holder CNode each
+#define LEAVES_BITS DEFAULT_CNODE_BITS
+
+struct tree {
+    struct capref root;
+    struct capref mid;          ///< first intermediate RAM cap
+    struct capref *leaves;      ///< first leaf in each holder CNode
+    size_t nmid;
+    enum objtype type;
+};
+
+static void tree_init(struct tree *t, uint8_t logcount, enum objtype type)
+{
+    errval_t err;
+    uint8_t leafbits = logcount < LEAVES_BITS ? logcount : LEAVES_BITS;
+
+    t->type = type;
+    t->nmid = 1UL << (logcount - leafbits);
+
+    err = ram_alloc(&t->root, logcount + OBJBITS_CTE);
+    assert_err(err, "ram_alloc");
+
+    struct cnoderef cn;
+    err = cnode_create(&t->mid, &cn, t->nmid, NULL);
+    assert_err(err, "cnode_create");
+    t->mid.cnode = cn;
+    t->mid.slot = 0;
+
+    t->leaves = calloc(t->nmid, sizeof(struct capref));
+    assert(t->leaves != NULL);
+    for (size_t i = 0; i < t->nmid; i++) {
+        struct capref cncap;
+        err = cnode_create(&cncap, &cn, 1UL << leafbits, NULL);
+        assert_err(err, "cnode_create");
+        t->leaves[i].cnode = cn;
+        t->leaves[i].slot = 0;
+    }
+}
+
+static void tree_build(struct tree *t, uint8_t logcount)
+{
+    errval_t err;
+    uint8_t leafbits = logcount < LEAVES_BITS ? logcount : LEAVES_BITS;
+
+    err = cap_retype(t->mid, t->root, ObjType_RAM, leafbits + OBJBITS_CTE);
+    assert_err(err, "retype root");
+
+    for (size_t i = 0; i < t->nmid; i++) {
+        struct capref mid = t->mid;
+        mid.slot += i;
+        // both types of leaves are 2^OBJBITS_CTE bytes in size
+        err = cap_retype(t->leaves[i], mid, t->type,
+                         t->type == ObjType_CNode ? 0 : OBJBITS_CTE);
+        assert_err(err, "retype leaves");
+    }
+}
+
+static void usage(const char *program)
+{
+    printf("usage: %s [runs=NUM] [logcount=NUM] [type=ram|cnode]\n\n",
+           program);
+    printf("\truns defaults to 10\n");
+    printf("\tlogcount defaults to 16\n");
+    printf("\ttype defaults to cnode\n");
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+    size_t runs = 10;
+    uint8_t logcount = 16;
+    enum objtype type = ObjType_CNode;
+    const char *type_name = "cnode";
+
+    for (int arg = 1; arg < argc; arg++) {
+        if (strncmp(argv[arg], "runs=", 5) == 0) {
+            runs = atol(argv[arg] + 5);
+        }
+        else if (strncmp(argv[arg], "logcount=", 9) == 0) {
+            logcount = atoi(argv[arg] + 9);
+        }
+        else if (strcmp(argv[arg], "type=ram") == 0) {
+            type = ObjType_RAM;
+            type_name = "ram";
+        }
+        else if (strcmp(argv[arg], "type=cnode") == 0) {
+            type = ObjType_CNode;
+            type_name = "cnode";
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (logcount > 24) {
+        printf("ERROR: logcount too big\n");
+        return 1;
+    }
+
+    bench_init();
+
+    struct tree t;
+    tree_init(&t, logcount, type);
+
+    size_t ncaps = (1UL << logcount) + t.nmid;
+    for (size_t run = 0; run < runs; run++) {
+        tree_build(&t, logcount);
+
+        cycles_t start = bench_tsc();
+        err = cap_revoke(t.root);
+        cycles_t end = bench_tsc();
+        assert_err(err, "cap_revoke");
+
+        cycles_t val = bench_time_diff(start, end);
+        printf("revoke/%s: %"PRIu64"/%zu (%"PRIu64" cycles/cap, %"PRIu64" ms)\n",
+               type_name, val, ncaps, val / ncaps, bench_tsc_to_ms(val));
+    }
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * \file
+ * \brief Name service lookups of many domains starting at once
+ *
+ * Usage: nameservice_cache_bench [domains] [names]
+ *
+ * Registers names records and then spawns domains copies of itself on this
+ * core, all at once, each looking up every name as a domain does when it
+ * binds to its services at startup. The storm runs twice:
+ *
+ *  - direct: the children query octopus for every name, as
+ *            nameservice_lookup() did without the cache
+ *  - cached: the children use nameservice_lookup(), which is answered from
+ *            the name service cache of this core once the monitor has
+ *            filled it
+ *
+ * and the time until all children have exited is reported, with the cache
+ * counters of the monitor. Finally the latency of a single lookup is
+ * measured for both paths.
+ *
+ * The records map to made-up IREFs; they are only looked up, never bound to.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <barrelfish/spawn_client.h>
+#include <if/octopus_rpcclient_defs.h>
+#include <octopus/getset.h> // for oct_read
+#include <octopus/trigger.h> // for NOP_TRIGGER
+#include <bench/bench.h>
+
+#define BENCH_PATH "/x86_64/sbin/benchmarks/nameservice_cache_bench"
+
+#define DEFAULT_DOMAINS 32
+#define DEFAULT_NAMES   16
+#define ROUNDS          1000
+#define IREF_BASE       0x10000
+
+static void name_of(char *buf, size_t len, int i)
+{
+    snprintf(buf, len, "ns_cache_bench.%d", i);
+}
+
+/// Looks name up at octopus, bypassing the cache
+static errval_t direct_lookup(const char *name, iref_t *retiref)
+{
+    errval_t err, error_code;
+    char *record = NULL;
+    octopus_trigger_id_t tid;
+
+    struct octopus_rpc_client *r = get_octopus_rpc_client();
+    if (r == NULL) {
+        return LIB_ERR_NAMESERVICE_NOT_BOUND;
+    }
+
+    err = r->vtbl.get(r, name, NOP_TRIGGER, &record, &tid, &error_code);
+    if (err_is_ok(err)) {
+        err = error_code;
+    }
+    if (err_is_ok(err)) {
+        uint64_t iref_number = 0;
+        err = oct_read(record, "_ { iref: %d }", &iref_number);
+        *retiref = iref_number;
+    }
+
+    free(record);
+    return err;
+}
+
+typedef errval_t (*lookup_fn_t)(const char *name, iref_t *retiref);
+
+static lookup_fn_t lookup_fn(const char *mode)
+{
+    return strcmp(mode, "direct") == 0 ? direct_lookup : nameservice_lookup;
+}
+
+/* ------------------------------ CHILD ------------------------------ */
+
+static int run_child(const char *mode, int nnames)
+{
+    lookup_fn_t lookup = lookup_fn(mode);
+    char name[32];
+
+    for (int i = 0; i < nnames; i++) {
+        iref_t iref = 0;
+        name_of(name, sizeof(name), i);
+        errval_t err = lookup(name, &iref);
+        if (err_is_fail(err) || iref != IREF_BASE + i) {
+            DEBUG_ERR(err, "lookup of %s returned %"PRIuIREF, name, iref);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------ PARENT ------------------------------ */
+
+static void print_stats(const char *what, struct nameservice_cache_stats *s0,
+                        struct nameservice_cache_stats *s1)
+{
+    printf("%-7s monitor: %" PRIu64 " lookups, %" PRIu64 " coalesced, "
+           "%" PRIu64 " queries, %" PRIu64 " fills, %" PRIu64 " evictions\n",
+           what, s1->mon_lookups - s0->mon_lookups,
+           s1->mon_coalesced - s0->mon_coalesced,
+           s1->mon_queries - s0->mon_queries, s1->mon_fills - s0->mon_fills,
+           s1->mon_evictions - s0->mon_evictions);
+}
+
+static void storm(const char *mode, int ndomains, int nnames)
+{
+    errval_t err;
+    char nnames_str[16];
+    snprintf(nnames_str, sizeof(nnames_str), "%d", nnames);
+    char *const args[] = { BENCH_PATH, "child", (char *)mode, nnames_str,
+                           NULL };
+
+    domainid_t *domains = calloc(ndomains, sizeof(domainid_t));
+    assert(domains != NULL);
+
+    struct nameservice_cache_stats s0, s1;
+    nameservice_cache_stats(&s0);
+
+    cycles_t start = bench_tsc();
+    for (int i = 0; i < ndomains; i++) {
+        err = spawn_program(disp_get_core_id(), BENCH_PATH, args, NULL, 0,
+                            &domains[i]);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "spawn_program");
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i < ndomains; i++) {
+        uint8_t exitcode;
+        err = spawn_wait(domains[i], &exitcode, false);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "spawn_wait");
+        }
+        if (exitcode != EXIT_SUCCESS) {
+            failed++;
+        }
+    }
+    cycles_t cycles = bench_tsc() - start;
+
+    nameservice_cache_stats(&s1);
+    printf("%-7s %d domains x %d names: %" PRIu64 " ms, %" PRIu64
+           " cycles/domain, %d failed\n", mode, ndomains, nnames,
+           bench_tsc_to_ms(cycles), cycles / ndomains, failed);
+    print_stats(mode, &s0, &s1);
+
+    free(domains);
+}
+
+static void latency(const char *mode)
+{
+    lookup_fn_t lookup = lookup_fn(mode);
+    char name[32];
+    name_of(name, sizeof(name), 0);
+
+    cycles_t start = bench_tsc();
+    for (int i = 0; i < ROUNDS; i++) {
+        iref_t iref;
+        errval_t err = lookup(name, &iref);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "lookup");
+        }
+    }
+    printf("%-7s %8" PRIu64 " cycles/lookup\n", mode,
+           (bench_tsc() - start) / ROUNDS);
+}
+
+static void run_parent(int ndomains, int nnames)
+{
+    char name[32];
+    for (int i = 0; i < nnames; i++) {
+        name_of(name, sizeof(name), i);
+        errval_t err = nameservice_register(name, IREF_BASE + i);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "nameservice_register");
+        }
+    }
+
+    storm("direct", ndomains, nnames);
+    storm("cached", ndomains, nnames);
+
+    latency("direct");
+    latency("cached");
+
+    struct nameservice_cache_stats s;
+    errval_t err = nameservice_cache_stats(&s);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "no name service cache on this core");
+    }
+    printf("this domain: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64
+           " fallbacks\n", s.hits, s.misses, s.fallbacks);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 4 && strcmp(argv[1], "child") == 0) {
+        return run_child(argv[2], atoi(argv[3]));
+    }
+
+    int ndomains = argc > 1 ? atoi(argv[1]) : DEFAULT_DOMAINS;
+    int nnames = argc > 2 ? atoi(argv[2]) : DEFAULT_NAMES;
+    if (ndomains < 1 || nnames < 1) {
+        printf("Usage: %s [domains] [names]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench_init();
+    run_parent(ndomains, nnames);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/**
+ * \file
+ * \brief Page migration benchmark and residency report
+ *
+ * Usage: numa_migrate [size in KB]
+ *
+ * Allocates a buffer on node 0, moves it to the last node with
+ * numa_move_pages(), and then moves the heap of the domain to the last node
+ * with numa_migrate_pages(). Prints the per-node residency of all vregions of
+ * the domain before and after, and checks that the contents survived.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <numa.h>
+#include <bitmap.h>
+
+#define DEFAULT_SIZE_KB 4096
+
+static void fill(uint64_t *buf, size_t size, uint64_t seed)
+{
+    for (size_t i = 0; i < size / sizeof(uint64_t); i++) {
+        buf[i] = seed ^ i;
+    }
+}
+
+static bool check(uint64_t *buf, size_t size, uint64_t seed)
+{
+    for (size_t i = 0; i < size / sizeof(uint64_t); i++) {
+        if (buf[i] != (seed ^ i)) {
+            printf("mismatch at offset %zu\n", i * sizeof(uint64_t));
+            return false;
+        }
+    }
+    return true;
+}
+
+/// counts the pages of a buffer on each node
+static void residency(const char *what, void *buf, size_t size)
+{
+    size_t counts[NUMA_MAX_NUMNODES] = { 0 };
+    size_t other = 0;
+
+    for (size_t off = 0; off < size; off += BASE_PAGE_SIZE) {
+        nodeid_t node;
+        errval_t err = numa_get_page_node((char *)buf + off, &node);
+        if (err_is_ok(err)) {
+            counts[node]++;
+        } else {
+            other++;
+        }
+    }
+
+    printf("%-14s", what);
+    for (nodeid_t node = 0; node <= numa_max_node(); node++) {
+        printf(" node %" PRIuNODEID ": %6zu", node, counts[node]);
+    }
+    printf(" other: %zu\n", other);
+}
+
+static void report(const char *what, size_t size, cycles_t cycles)
+{
+    uint64_t ms = bench_tsc_to_ms(cycles);
+    uint64_t mb_per_s = ms > 0 ? (size >> 20) * 1000 / ms : 0;
+
+    printf("%-14s %12" PRIu64 " cycles %6" PRIu64 " ms %6" PRIu64 " MB/s\n",
+           what, cycles, ms, mb_per_s);
+}
+
+static void run_move_pages(size_t size, nodeid_t to)
+{
+    errval_t err;
+
+    void *buf = numa_alloc_onnode(size, 0, BASE_PAGE_SIZE);
+    if (buf == NULL) {
+        USER_PANIC("numa_alloc_onnode failed\n");
+    }
+    fill(buf, size, 0xfeedface);
+    residency("before move", buf, size);
+
+    size_t count = size / BASE_PAGE_SIZE;
+    void **pages = calloc(count, sizeof(void *));
+    nodeid_t *nodes = calloc(count, sizeof(nodeid_t));
+    errval_t *status = calloc(count, sizeof(errval_t));
+    assert(pages != NULL && nodes != NULL && status != NULL);
+    for (size_t i = 0; i < count; i++) {
+        pages[i] = (char *)buf + i * BASE_PAGE_SIZE;
+        nodes[i] = to;
+    }
+
+    cycles_t start = bench_tsc();
+    err = numa_move_pages(disp_get_domain_id(), count, pages, nodes, status, 0);
+    cycles_t end = bench_tsc();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "numa_move_pages");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (err_is_fail(status[i])) {
+            DEBUG_ERR(status[i], "moving page %zu", i);
+            break;
+        }
+    }
+
+    residency("after move", buf, size);
+    report("move_pages", size, bench_time_diff(start, end));
+    if (!check(buf, size, 0xfeedface)) {
+        USER_PANIC("contents changed while moving pages\n");
+    }
+
+    free(pages);
+    free(nodes);
+    free(status);
+    numa_free(buf, size);
+}
+
+static void run_migrate_pages(size_t size, nodeid_t to)
+{
+    errval_t err;
+
+    void *buf = malloc(size);
+    assert(buf != NULL);
+    fill(buf, size, 0xdeadbeef);
+    residency("before migrate", buf, size);
+
+    struct bitmap *fromnodes = numa_allocate_nodemask();
+    struct bitmap *tonodes = numa_allocate_nodemask();
+    assert(fromnodes != NULL && tonodes != NULL);
+    for (nodeid_t node = 0; node <= numa_max_node(); node++) {
+        if (node != to) {
+            bitmap_set_bit(fromnodes, node);
+        }
+    }
+    bitmap_set_bit(tonodes, to);
+
+    cycles_t start = bench_tsc();
+    err = numa_migrate_pages(disp_get_domain_id(), fromnodes, tonodes);
+    cycles_t end = bench_tsc();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "numa_migrate_pages");
+    }
+
+    residency("after migrate", buf, size);
+    report("migrate_pages", size, bench_time_diff(start, end));
+    if (!check(buf, size, 0xdeadbeef)) {
+        USER_PANIC("contents changed while migrating pages\n");
+    }
+
+    numa_free_nodemask(fromnodes);
+    numa_free_nodemask(tonodes);
+    free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = (size_t)(argc > 1 ? atol(argv[1]) : DEFAULT_SIZE_KB) << 10;
+    size = ROUND_UP(size, BASE_PAGE_SIZE);
+
+    if (err_is_fail(numa_available())) {
+        printf("numa_migrate: NUMA is not available\n");
+        return 1;
+    }
+
+    nodeid_t to = numa_max_node();
+    if (to == 0) {
+        printf("numa_migrate: needs at least two nodes\n");
+        return 1;
+    }
+
+    bench_init();
+
+    printf("vregions at start:\n");
+    numa_dump_residency();
+
+    run_move_pages(size, to);
+    run_migrate_pages(size, to);
+
+    printf("vregions at end:\n");
+    numa_dump_residency();
+
+    printf("numa_migrate done\n");
+    return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * \file
+ * \brief Contention benchmark for the pthread synchronisation primitives
+ *
+ * Usage: pthread_bench [threads] [cores] [iterations]
+ *
+ * Spans the domain to the given number of cores, places the threads
+ * round-robin on them, and measures contended mutex lock/unlock pairs,
+ * condition variable ping-pong between pairs of threads, barrier episodes
+ * and the accuracy of timed condition waits.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset.h>
+#include <bench/bench.h>
+
+#define DEFAULT_THREADS     4
+#define DEFAULT_ITERATIONS  100000
+#define MAX_THREADS         64
+#define TIMEDWAIT_US        10000
+
+static int nthreads = DEFAULT_THREADS;
+static int ncores = 1;
+static int iterations = DEFAULT_ITERATIONS;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t adaptive = PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
+static pthread_barrier_t barrier;
+static volatile uint64_t counter;
+
+/// state of a pair of threads playing ping-pong on a condition variable
+static struct pingpong {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    volatile int turn;
+} pairs[MAX_THREADS / 2];
+
+static int spanned = 1;
+
+static void domain_spanned(void *arg, errval_t reterr)
+{
+    if (err_is_fail(reterr)) {
+        USER_PANIC_ERR(reterr, "domain_new_dispatcher");
+    }
+    spanned++;
+}
+
+static void report(const char *what, cycles_t cycles, uint64_t ops)
+{
+    printf("%-14s %3d threads %2d cores %10" PRIu64 " cycles/op %6" PRIu64
+           " ms\n", what, nthreads, ncores, cycles / ops,
+           bench_tsc_to_ms(cycles));
+}
+
+static void *mutex_worker(void *arg)
+{
+    pthread_mutex_t *m = arg;
+
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < iterations; i++) {
+        pthread_mutex_lock(m);
+        counter++;
+        pthread_mutex_unlock(m);
+    }
+    return NULL;
+}
+
+static void *pingpong_worker(void *arg)
+{
+    int id = (int)(uintptr_t)arg;
+    struct pingpong *p = &pairs[id / 2];
+    int me = id % 2;
+
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < iterations; i++) {
+        pthread_mutex_lock(&p->mutex);
+        while (p->turn != me) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+        p->turn = !me;
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+    }
+    return NULL;
+}
+
+static void *barrier_worker(void *arg)
+{
+    for (int i = 0; i < iterations; i++) {
+        pthread_barrier_wait(&barrier);
+    }
+    return NULL;
+}
+
+/// runs a worker on all threads and returns the cycles they took
+static cycles_t run(void *(*worker)(void *), bool pass_id, void *arg)
+{
+    pthread_t threads[MAX_THREADS];
+
+    for (int i = 0; i < nthreads; i++) {
+        pthread_attr_t attr;
+        cpu_set_t cpus;
+
+        pthread_attr_init(&attr);
+        CPU_ZERO(&cpus);
+        CPU_SET(disp_get_core_id() + i % ncores, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+        int r = pthread_create(&threads[i], &attr, worker,
+                               pass_id ? (void *)(uintptr_t)i : arg);
+        if (r != 0) {
+            USER_PANIC("pthread_create failed: %d\n", r);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+    cycles_t start = bench_tsc();
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return bench_tsc() - start;
+}
+
+static void bench_timedwait(void)
+{
+    pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t c = PTHREAD_COND_INITIALIZER;
+    struct timeval tv;
+    struct timespec ts;
+
+    gettimeofday(&tv, NULL);
+    uint64_t start = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    uint64_t deadline = start + TIMEDWAIT_US;
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    pthread_mutex_lock(&m);
+    int r = pthread_cond_timedwait(&c, &m, &ts);
+    pthread_mutex_unlock(&m);
+
+    gettimeofday(&tv, NULL);
+    uint64_t end = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    printf("timedwait      %s after %" PRIu64 " us (timeout %d us)\n",
+           r == ETIMEDOUT ? "timed out" : "returned", end - start,
+           TIMEDWAIT_US);
+
+    pthread_cond_destroy(&c);
+    pthread_mutex_destroy(&m);
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+
+    if (argc > 1) {
+        nthreads = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        ncores = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        iterations = atoi(argv[3]);
+    }
+    if (nthreads < 2 || nthreads > MAX_THREADS || nthreads % 2 != 0
+        || ncores < 1 || iterations < 1) {
+        printf("Usage: %s [threads (even, <= %d)] [cores] [iterations]\n",
+               argv[0], MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    bench_init();
+
+    coreid_t my_core_id = disp_get_core_id();
+    for (int i = 1; i < ncores; i++) {
+        err = domain_new_dispatcher(my_core_id + i, domain_spanned, NULL);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "failed to span domain");
+        }
+    }
+    while (spanned < ncores) {
+        err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "event_dispatch");
+        }
+    }
+
+    cycles_t cycles;
+
+    pthread_barrier_init(&barrier, NULL, nthreads);
+    counter = 0;
+    cycles = run(mutex_worker, false, &mutex);
+    assert(counter == (uint64_t)nthreads * iterations);
+    report("mutex", cycles, counter);
+
+    counter = 0;
+    cycles = run(mutex_worker, false, &adaptive);
+    assert(counter == (uint64_t)nthreads * iterations);
+    report("mutex adaptive", cycles, counter);
+
+    for (int i = 0; i < nthreads / 2; i++) {
+        pthread_mutex_init(&pairs[i].mutex, NULL);
+        pthread_cond_init(&pairs[i].cond, NULL);
+        pairs[i].turn = 0;
+    }
+    cycles = run(pingpong_worker, true, NULL);
+    report("cond pingpong", cycles, (uint64_t)nthreads * iterations);
+
+    cycles = run(barrier_worker, false, NULL);
+    report("barrier", cycles, iterations);
+    pthread_barrier_destroy(&barrier);
+
+    bench_timedwait();
+
+    printf("pthread_bench done.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+/** \file
+ *  \brief THC worker pool scaling benchmark
+ *
+ *  The server receives batches of requests on one THC binding and
+ *  computes their replies in ASYNC blocks which are passed to a pool of
+ *  dispatchers with THCPoolYield.  The client reports the cycles taken
+ *  per batch as the number of pool dispatchers grows.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <barrelfish/debug.h>
+#include <if/bench_defs.h>
+#include <if/bench_thc.h>
+#include <thc/thc.h>
+#include <bench/bench.h>
+
+#define BATCH        64     // requests per batch
+#define ROUNDS      100     // batches per pool size
+#define SKIP         10     // warm-up batches per pool size
+#define WORK      20000     // spin iterations per request
+#define MAX_WORKERS   3     // largest number of additional dispatchers
+
+static const char *my_service_name = "thc_v_flounder_pool";
+
+/* ------------------------------ CLIENT ------------------------------ */
+
+static void client_work(void) {
+  struct bench_binding *b;
+  struct bench_thc_client_binding_t cl;
+  errval_t err;
+
+  debug_printf("connecting to service from core=%d\n", disp_get_core_id());
+
+  err = bench_thc_connect_by_name(my_service_name,
+                                  get_default_waitset(),
+                                  IDC_BIND_FLAGS_DEFAULT,
+                                  &b);
+  if (err_is_fail(err)) {
+    DEBUG_ERR(err, "connect failed");
+    abort();
+  }
+
+  err = bench_thc_init_client(&cl, b, b);
+  assert(err_is_ok(err));
+
+  for (int workers = 0; workers <= MAX_WORKERS; workers++) {
+    cycles_t total_timing = 0;
+
+    for (int r = 0; r < ROUNDS; r++) {
+      cycles_t start = bench_tsc();
+
+      DO_FINISH({
+          ASYNC({
+              for (int i = 0; i < BATCH; i++) {
+                errval_t e = cl.send.fsb_payload1_request(&cl, WORK);
+                assert(err_is_ok(e));
+              }
+            });
+
+          for (int i = 0; i < BATCH; i++) {
+            int result;
+            errval_t e = cl.recv.fsb_payload1_reply(&cl, &result);
+            assert(err_is_ok(e));
+          }
+        });
+
+      if (r >= SKIP) {
+        total_timing += bench_tsc() - start;
+      }
+    }
+
+    debug_printf("workers %d per batch %zd per request %zd\n",
+                 workers, (size_t)(total_timing / (ROUNDS - SKIP)),
+                 (size_t)(total_timing / ((ROUNDS - SKIP) * BATCH)));
+  }
+
+  THCDumpStats(1);
+}
+
+/* ------------------------------ SERVER ------------------------------ */
+
+static int spin(int n) {
+  volatile int x = 0;
+  for (int i = 0; i < n; i++) {
+    x += i;
+  }
+  return x;
+}
+
+static void server_batch(struct bench_thc_service_binding_t *sv) {
+  int work[BATCH];
+  int results[BATCH];
+
+  for (int i = 0; i < BATCH; i++) {
+    errval_t err = sv->recv.fsb_payload1_request(sv, &work[i]);
+    assert(err_is_ok(err));
+  }
+
+  DO_FINISH({
+      for (int i = 0; i < BATCH; i++) {
+        ASYNC({
+            int j = i;
+            int w = work[j];
+            // Let any dispatcher of the pool compute the reply
+            THCPoolYield();
+            results[j] = spin(w);
+          });
+      }
+    });
+
+  for (int i = 0; i < BATCH; i++) {
+    errval_t err = sv->send.fsb_payload1_reply(sv, results[i]);
+    assert(err_is_ok(err));
+  }
+}
+
+static void server_work(void) {
+  struct bench_thc_export_info info;
+  struct bench_binding *b;
+  struct bench_thc_service_binding_t sv;
+  coreid_t cores[MAX_WORKERS];
+  errval_t err;
+
+  debug_printf("exporting service from core=%d\n", disp_get_core_id());
+  err = bench_thc_export(&info,
+                         my_service_name,
+                         get_default_waitset(),
+                         IDC_EXPORT_FLAGS_DEFAULT,
+                         NULL);
+  if (err_is_fail(err)) {
+    DEBUG_ERR(err, "export failed");
+    abort();
+  }
+
+  err = bench_thc_accept(&info, &b);
+  if (err_is_fail(err)) {
+    DEBUG_ERR(err, "accept failed");
+    abort();
+  }
+
+  err = bench_thc_init_service(&sv, b, b);
+  assert(err_is_ok(err));
+
+  for (int i = 0; i < MAX_WORKERS; i++) {
+    cores[i] = disp_get_core_id() + 1 + i;
+  }
+
+  for (int workers = 0; workers <= MAX_WORKERS; workers++) {
+    err = THCPoolStart(cores, workers);
+    if (err_is_fail(err)) {
+      DEBUG_ERR(err, "THCPoolStart failed");
+      abort();
+    }
+
+    for (int r = 0; r < ROUNDS; r++) {
+      server_batch(&sv);
+    }
+
+    err = THCPoolStop();
+    assert(err_is_ok(err));
+  }
+
+  THCDumpStats(1);
+}
+
+/* ------------------------------ MAIN ------------------------------ */
+
+int main(int argc, char *argv[])
+{
+  // Allow arbitrary early parameters (e.g., "boot" when invoked
+  // directly from menu.lst by monitor)
+  if (argc >= 2 && strcmp(argv[argc-1], "client") == 0) {
+    client_work();
+  } else if (argc >= 2 && strcmp(argv[argc-1], "server") == 0) {
+    server_work();
+  } else {
+    debug_printf("Usage: %s ... client|server\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
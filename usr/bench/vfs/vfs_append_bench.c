@@ -0,0 +1,90 @@
+/**
+ * \brief Benchmark for append throughput to a single large file.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <vfs/vfs.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FILENAME        "/appendfile"
+#define CHUNK_SIZE      (64 * 1024)
+#define DEFAULT_MAX_MB  1024 // trivfs file sizes are 32-bit, so < 4096
+
+/**
+ * Append CHUNK_SIZE blocks to a file until it reaches max_mb, reporting the
+ * throughput of each doubling step. With a contiguous backing buffer the
+ * later steps get progressively slower; with extents they should stay flat.
+ */
+static void run(size_t max_mb)
+{
+    errval_t err;
+    vfs_handle_t handle;
+
+    err = vfs_create(FILENAME, &handle);
+    assert(err_is_ok(err));
+
+    uint8_t *chunk = malloc(CHUNK_SIZE);
+    assert(chunk != NULL);
+    memset(chunk, 0xa5, CHUNK_SIZE);
+
+    size_t filesize = 0;
+    for (size_t step_mb = 1; step_mb <= max_mb; step_mb *= 2) {
+        size_t target = step_mb * 1024 * 1024;
+        size_t step_bytes = target - filesize;
+
+        cycles_t start = bench_tsc();
+        while (filesize < target) {
+            size_t written;
+            err = vfs_write(handle, chunk, CHUNK_SIZE, &written);
+            assert(err_is_ok(err));
+            assert(written == CHUNK_SIZE);
+            filesize += written;
+        }
+        cycles_t end = bench_tsc();
+
+        uint64_t ms = bench_tsc_to_ms(bench_time_diff(start, end));
+        double mibps = ms == 0 ? 0.0
+                       : (step_bytes / (1024.0 * 1024.0)) / (ms / 1000.0);
+        printf("append: file size %zu MiB, appended %zu bytes in %" PRIu64
+               " ms -> %.1f MiB/s\n", step_mb, step_bytes, ms, mibps);
+    }
+
+    err = vfs_close(handle);
+    assert(err_is_ok(err));
+    err = vfs_remove(FILENAME);
+    assert(err_is_ok(err));
+    free(chunk);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max_mb = DEFAULT_MAX_MB;
+
+    vfs_init();
+    bench_init();
+
+    if (argc >= 2) {
+        max_mb = atol(argv[1]);
+    }
+
+    printf("vfs_append_bench: appending up to %zu MiB in %u byte chunks\n",
+           max_mb, CHUNK_SIZE);
+    run(max_mb);
+    printf("vfs_append_bench done\n");
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+/**
+ * \brief Benchmark for memory-mapped files.
+ *
+ * Usage: vfs_mmap_bench [file] [file size in MB]
+ *
+ * Compares reading a file with vfs_read against touching every page of a
+ * mapping of it, sequentially (read-ahead and fault-around) and in random
+ * order, and measures a second mapping of the file that finds its pages in
+ * the shared page cache.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/except.h>
+#include <bench/bench.h>
+#include <vfs/vfs.h>
+#include <vfs/mmap.h>
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FILENAME    "/mmapfile"
+#define DEFAULT_FILESIZE_MB 16
+#define BLOCK_SIZE          (64 * 1024)
+#define EX_STACK_SIZE       16384
+
+static char ex_stack[EX_STACK_SIZE];
+
+static void handler(enum exception_type type, int subtype, void *vaddr,
+                    arch_registers_state_t *regs,
+                    arch_registers_fpu_state_t *fpuregs)
+{
+    if (type != EXCEPT_PAGEFAULT) {
+        USER_PANIC("unexpected exception %d(%d) at %p", type, subtype, vaddr);
+    }
+
+    errval_t err = vspace_pagefault_handler(get_current_vspace(),
+                                            (lvaddr_t)vaddr, subtype);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "unhandled page fault at %p", vaddr);
+    }
+}
+
+static void create_file(const char *path, size_t filesize)
+{
+    static uint8_t buf[BLOCK_SIZE];
+    vfs_handle_t vh;
+    errval_t err;
+
+    err = vfs_create(path, &vh);
+    assert(err_is_ok(err));
+    err = vfs_truncate(vh, 0);
+    assert(err_is_ok(err));
+
+    for (size_t pos = 0; pos < filesize; pos += BLOCK_SIZE) {
+        // tag each page, so that the mapped contents can be checked
+        for (size_t i = 0; i < BLOCK_SIZE; i += BASE_PAGE_SIZE) {
+            *(size_t *)&buf[i] = (pos + i) / BASE_PAGE_SIZE;
+        }
+        size_t written;
+        err = vfs_write(vh, buf, BLOCK_SIZE, &written);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "write failed");
+        }
+        assert(written == BLOCK_SIZE);
+    }
+
+    err = vfs_close(vh);
+    assert(err_is_ok(err));
+}
+
+static uint64_t read_file(const char *path, size_t filesize)
+{
+    vfs_handle_t vh;
+    errval_t err;
+
+    uint8_t *buf = malloc(filesize);
+    assert(buf != NULL);
+
+    err = vfs_open(path, &vh);
+    assert(err_is_ok(err));
+
+    cycles_t start = bench_tsc();
+    size_t pos = 0;
+    while (pos < filesize) {
+        size_t bytes;
+        err = vfs_read(vh, buf + pos, filesize - pos, &bytes);
+        if (err_no(err) == VFS_ERR_EOF) {
+            break;
+        } else if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "read failed");
+        }
+        pos += bytes;
+    }
+    cycles_t end = bench_tsc();
+    assert(pos == filesize);
+
+    err = vfs_close(vh);
+    assert(err_is_ok(err));
+    free(buf);
+
+    return bench_tsc_to_ms(bench_time_diff(start, end));
+}
+
+/// Touch the pages of a mapping in the given order, checking their tags
+static uint64_t touch(struct vregion *vregion, size_t *order, size_t npages)
+{
+    uint8_t *base = (void *)vspace_genvaddr_to_lvaddr(
+                                    vregion_get_base_addr(vregion));
+
+    cycles_t start = bench_tsc();
+    for (size_t i = 0; i < npages; i++) {
+        size_t page = order[i];
+        size_t tag = *(volatile size_t *)(base + page * BASE_PAGE_SIZE);
+        if (tag != page) {
+            USER_PANIC("page %zu has tag %zu", page, tag);
+        }
+    }
+    cycles_t end = bench_tsc();
+
+    return bench_tsc_to_ms(bench_time_diff(start, end));
+}
+
+static void report(const char *what, uint64_t ms, struct memobj *memobj)
+{
+    struct memobj_pagecache *pc = (struct memobj_pagecache *)memobj;
+    printf("%-22s %8" PRIu64 " ms  %8zu faults  %8zu pages mapped\n",
+           what, ms, pc->faults, pc->pages_mapped);
+}
+
+static void unmap(struct vregion *vregion, struct memobj *memobj)
+{
+    errval_t err = memobj_destroy_vfs(memobj);
+    assert(err_is_ok(err));
+    free(vregion);
+    free(memobj);
+}
+
+int main(int argc, char *argv[])
+{
+    struct vregion *vregion, *vregion2;
+    struct memobj *memobj, *memobj2;
+    vfs_handle_t vh;
+    errval_t err;
+
+    const char *path = DEFAULT_FILENAME;
+    if (argc >= 2) {
+        path = argv[1];
+    }
+    size_t filesize = DEFAULT_FILESIZE_MB;
+    if (argc >= 3) {
+        filesize = atol(argv[2]);
+    }
+    filesize *= 1024 * 1024;
+    size_t npages = filesize / BASE_PAGE_SIZE;
+
+    vfs_init();
+    bench_init();
+
+    err = thread_set_exception_handler(handler, NULL, ex_stack,
+                                       ex_stack + EX_STACK_SIZE, NULL, NULL);
+    assert(err_is_ok(err));
+
+    create_file(path, filesize);
+    printf("vfs_mmap_bench: %zu MB file %s\n", filesize >> 20, path);
+
+    size_t *seq = malloc(npages * sizeof(size_t));
+    size_t *rnd = malloc(npages * sizeof(size_t));
+    assert(seq != NULL && rnd != NULL);
+    for (size_t i = 0; i < npages; i++) {
+        seq[i] = rnd[i] = i;
+    }
+    for (size_t i = npages - 1; i > 0; i--) {
+        size_t j = rand() % (i + 1);
+        size_t t = rnd[i];
+        rnd[i] = rnd[j];
+        rnd[j] = t;
+    }
+
+    printf("%-22s %8" PRIu64 " ms\n", "vfs_read", read_file(path, filesize));
+
+    // private mappings, each with a cold cache
+    err = vfs_open(path, &vh);
+    assert(err_is_ok(err));
+
+    err = vspace_map_file(filesize, VREGION_FLAGS_READ, vh, 0, filesize,
+                          &vregion, &memobj);
+    assert(err_is_ok(err));
+    report("mmap sequential", touch(vregion, seq, npages), memobj);
+    unmap(vregion, memobj);
+
+    err = vspace_map_file(filesize, VREGION_FLAGS_READ, vh, 0, filesize,
+                          &vregion, &memobj);
+    assert(err_is_ok(err));
+    report("mmap random", touch(vregion, rnd, npages), memobj);
+    unmap(vregion, memobj);
+
+    err = vfs_close(vh);
+    assert(err_is_ok(err));
+
+    // two mappings sharing the page cache; the second one reads nothing
+    err = vspace_map_file_shared(filesize, VREGION_FLAGS_READ_WRITE, path, 0,
+                                 filesize, &vregion, &memobj);
+    assert(err_is_ok(err));
+    err = vspace_map_file_shared(filesize, VREGION_FLAGS_READ, path, 0,
+                                 filesize, &vregion2, &memobj2);
+    assert(err_is_ok(err));
+
+    report("shared, first mapping", touch(vregion, seq, npages), memobj);
+    report("shared, second mapping", touch(vregion2, rnd, npages), memobj2);
+
+    // writes get private copies and are not seen by the other mapping
+    uint8_t *base = (void *)vspace_genvaddr_to_lvaddr(
+                                    vregion_get_base_addr(vregion));
+    uint8_t *base2 = (void *)vspace_genvaddr_to_lvaddr(
+                                    vregion_get_base_addr(vregion2));
+    *(size_t *)base = ~(size_t)0;
+    assert(*(size_t *)base2 == 0);
+    printf("%-22s %8zu copy-on-write faults\n", "shared, after write",
+           ((struct memobj_pagecache *)memobj)->cow_faults);
+
+    unmap(vregion2, memobj2);
+    unmap(vregion, memobj);
+
+    free(seq);
+    free(rnd);
+
+    printf("vfs_mmap_bench done\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * \brief Benchmark for NFS read and write throughput at varying window sizes.
+ *
+ * Usage: vfs_nfs_bench nfs://<server-ip>/<export> [file size in MB]
+ *
+ * For every window size, the export is mounted again with the window=N
+ * option and a file is written sequentially (write-behind) and read back
+ * sequentially in small and large blocks (read-ahead and windowed reads).
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <vfs/vfs.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FILESIZE_MB 16
+#define LARGE_BLOCK         (64 * 1024)
+#define SMALL_BLOCK         (4 * 1024)
+#define MAX_WINDOW          64
+
+static uint8_t buffer[LARGE_BLOCK];
+
+static double mibps(size_t bytes, cycles_t start, cycles_t end)
+{
+    uint64_t ms = bench_tsc_to_ms(bench_time_diff(start, end));
+    return ms == 0 ? 0.0 : (bytes / (1024.0 * 1024.0)) / (ms / 1000.0);
+}
+
+static double write_file(const char *path, size_t filesize)
+{
+    vfs_handle_t vh;
+    errval_t err;
+
+    err = vfs_create(path, &vh);
+    assert(err_is_ok(err));
+    err = vfs_truncate(vh, 0);
+    assert(err_is_ok(err));
+
+    cycles_t start = bench_tsc();
+    for (size_t pos = 0; pos < filesize; pos += LARGE_BLOCK) {
+        size_t written;
+        err = vfs_write(vh, buffer, LARGE_BLOCK, &written);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "write failed");
+        }
+        assert(written == LARGE_BLOCK);
+    }
+
+    // includes waiting for the outstanding writes and the COMMIT
+    err = vfs_close(vh);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "close failed");
+    }
+    cycles_t end = bench_tsc();
+
+    return mibps(filesize, start, end);
+}
+
+static double read_file(const char *path, size_t filesize, size_t blocksize)
+{
+    vfs_handle_t vh;
+    errval_t err;
+    size_t total = 0;
+
+    err = vfs_open(path, &vh);
+    assert(err_is_ok(err));
+
+    cycles_t start = bench_tsc();
+    for (;;) {
+        size_t bytes;
+        err = vfs_read(vh, buffer, blocksize, &bytes);
+        if (err_no(err) == VFS_ERR_EOF) {
+            break;
+        } else if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "read failed");
+        }
+        total += bytes;
+    }
+    cycles_t end = bench_tsc();
+
+    if (total != filesize) {
+        printf("vfs_nfs_bench: read %zu bytes, expected %zu\n", total, filesize);
+    }
+
+    err = vfs_close(vh);
+    assert(err_is_ok(err));
+
+    return mibps(total, start, end);
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+
+    if (argc < 2) {
+        printf("Usage: %s nfs://<server-ip>/<export> [file size in MB]\n",
+               argv[0]);
+        return 1;
+    }
+
+    size_t filesize = DEFAULT_FILESIZE_MB;
+    if (argc >= 3) {
+        filesize = atol(argv[2]);
+    }
+    filesize *= 1024 * 1024;
+
+    vfs_init();
+    bench_init();
+
+    memset(buffer, 0xa5, sizeof(buffer));
+
+    printf("vfs_nfs_bench: %zu MB file on %s\n", filesize >> 20, argv[1]);
+    printf("window  write MiB/s  read %uK MiB/s  read %uK MiB/s\n",
+           SMALL_BLOCK / 1024, LARGE_BLOCK / 1024);
+
+    for (int window = 1; window <= MAX_WINDOW; window *= 2) {
+        // there is no unmount, so use a fresh mount point for every window
+        char mountpoint[32], uri[256], path[64];
+        snprintf(mountpoint, sizeof(mountpoint), "/nfs%d", window);
+        snprintf(uri, sizeof(uri), "%s?window=%d", argv[1], window);
+        snprintf(path, sizeof(path), "%s/vfs_nfs_bench.dat", mountpoint);
+
+        err = vfs_mkdir(mountpoint);
+        assert(err_is_ok(err));
+        err = vfs_mount(mountpoint, uri);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "failed to mount %s", uri);
+        }
+
+        double w = write_file(path, filesize);
+        double rs = read_file(path, filesize, SMALL_BLOCK);
+        double rl = read_file(path, filesize, LARGE_BLOCK);
+
+        printf("%6d  %11.1f  %14.1f  %15.1f\n", window, w, rs, rl);
+    }
+
+    printf("vfs_nfs_bench done\n");
+    return 0;
+}
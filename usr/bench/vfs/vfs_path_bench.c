@@ -0,0 +1,114 @@
+/**
+ * \brief Benchmark for path resolution (open/stat of deeply nested files).
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <vfs/vfs.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BASEDIR     "/pathbench"
+#define MAX_DEPTH   16
+#define NUM_RUNS    1000
+#define PATH_LEN    (sizeof(BASEDIR) + MAX_DEPTH * 4 + 8)
+
+/// Build BASEDIR/d0/d1/.../d<depth-1> in path
+static void make_dirname(char *path, size_t len, int depth)
+{
+    int pos = snprintf(path, len, "%s", BASEDIR);
+    for (int i = 0; i < depth; i++) {
+        pos += snprintf(&path[pos], len - pos, "/d%d", i);
+    }
+}
+
+static void setup(int depth, char *filepath, size_t len)
+{
+    char path[PATH_LEN];
+    errval_t err;
+
+    // create missing directories along the way; existing ones are fine
+    for (int i = 0; i <= depth; i++) {
+        make_dirname(path, sizeof(path), i);
+        err = vfs_mkdir(path);
+        assert(err_is_ok(err) || err_no(err) == FS_ERR_EXISTS);
+    }
+
+    snprintf(filepath, len, "%s/file", path);
+
+    vfs_handle_t handle;
+    err = vfs_create(filepath, &handle);
+    assert(err_is_ok(err));
+    err = vfs_close(handle);
+    assert(err_is_ok(err));
+}
+
+static void run(int depth)
+{
+    char filepath[PATH_LEN];
+    cycles_t tsc_start, tsc_end, result[2];
+    struct vfs_fileinfo info;
+    vfs_handle_t handle;
+    errval_t err;
+
+    setup(depth, filepath, sizeof(filepath));
+
+    bench_ctl_t *ctl = bench_ctl_init(BENCH_MODE_FIXEDRUNS, 2, NUM_RUNS);
+    bench_ctl_dry_runs(ctl, NUM_RUNS / 10);
+
+    do {
+        tsc_start = bench_tsc();
+        err = vfs_open(filepath, &handle);
+        tsc_end = bench_tsc();
+        assert(err_is_ok(err));
+        result[0] = bench_time_diff(tsc_start, tsc_end);
+
+        tsc_start = bench_tsc();
+        err = vfs_stat(handle, &info);
+        tsc_end = bench_tsc();
+        assert(err_is_ok(err));
+        assert(info.type == VFS_FILE);
+        result[1] = bench_time_diff(tsc_start, tsc_end);
+
+        err = vfs_close(handle);
+        assert(err_is_ok(err));
+    } while (!bench_ctl_add_run(ctl, result));
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "open depth=%d", depth);
+    bench_ctl_dump_analysis(ctl, 0, prefix, bench_tsc_per_us());
+    snprintf(prefix, sizeof(prefix), "stat depth=%d", depth);
+    bench_ctl_dump_analysis(ctl, 1, prefix, bench_tsc_per_us());
+
+    bench_ctl_destroy(ctl);
+
+    err = vfs_remove(filepath);
+    assert(err_is_ok(err));
+}
+
+int main(int argc, char *argv[])
+{
+    vfs_init();
+    bench_init();
+
+    printf("vfs_path_bench: open/stat latency vs. path depth\n");
+
+    for (int depth = 0; depth <= MAX_DEPTH; depth += 2) {
+        run(depth);
+    }
+
+    printf("vfs_path_bench done\n");
+    return 0;
+}
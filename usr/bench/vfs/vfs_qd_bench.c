@@ -0,0 +1,160 @@
+/**
+ * \brief Benchmark for asynchronous VFS reads at varying queue depth.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <vfs/vfs.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DEFAULT_FILENAME    "/qdfile"
+#define DEFAULT_FILESIZE    (16 * 1024 * 1024)
+#define BLOCK_SIZE          (64 * 1024)
+#define MAX_DEPTH           32
+
+struct qd_state {
+    vfs_handle_t handle;
+    size_t filesize;
+    size_t next_offset;     ///< offset of next read to submit
+    size_t completed;       ///< bytes completed
+    size_t inflight;
+    uint8_t *bufs[MAX_DEPTH];
+    size_t nextbuf;
+};
+
+static void submit_next(struct qd_state *st);
+
+static void read_done(void *arg, errval_t err, size_t bytes)
+{
+    struct qd_state *st = arg;
+
+    if (err_is_fail(err) && err_no(err) != VFS_ERR_EOF) {
+        USER_PANIC_ERR(err, "async read failed");
+    }
+
+    st->completed += bytes;
+    st->inflight--;
+    submit_next(st);
+}
+
+static void submit_next(struct qd_state *st)
+{
+    if (st->next_offset >= st->filesize) {
+        return;
+    }
+
+    // buffers are reused round-robin; the contents are never looked at
+    struct vfs_iovec iov = {
+        .base = st->bufs[st->nextbuf++ % MAX_DEPTH],
+        .len = BLOCK_SIZE,
+    };
+
+    errval_t err = vfs_read_async(st->handle, st->next_offset, &iov, 1,
+                                  get_default_waitset(), read_done, st);
+    assert(err_is_ok(err));
+
+    st->next_offset += BLOCK_SIZE;
+    st->inflight++;
+}
+
+static void run(struct qd_state *st, size_t depth)
+{
+    errval_t err;
+
+    err = vfs_io_set_depth(st->handle, depth);
+    assert(err_is_ok(err));
+
+    st->next_offset = 0;
+    st->completed = 0;
+    st->inflight = 0;
+
+    cycles_t start = bench_tsc();
+
+    // keep depth requests in flight until the whole file has been read
+    for (size_t i = 0; i < depth; i++) {
+        submit_next(st);
+    }
+    while (st->inflight > 0) {
+        err = event_dispatch(get_default_waitset());
+        assert(err_is_ok(err));
+    }
+
+    cycles_t end = bench_tsc();
+
+    uint64_t ms = bench_tsc_to_ms(bench_time_diff(start, end));
+    double mibps = ms == 0 ? 0.0
+                   : (st->completed / (1024.0 * 1024.0)) / (ms / 1000.0);
+    printf("qd %2zu: read %zu bytes in %" PRIu64 " ms -> %.1f MiB/s\n",
+           depth, st->completed, ms, mibps);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filename = DEFAULT_FILENAME;
+    struct qd_state st;
+    struct vfs_fileinfo info;
+    errval_t err;
+
+    vfs_init();
+    bench_init();
+
+    memset(&st, 0, sizeof(st));
+    for (int i = 0; i < MAX_DEPTH; i++) {
+        st.bufs[i] = malloc(BLOCK_SIZE);
+        assert(st.bufs[i] != NULL);
+    }
+
+    if (argc >= 3) {
+        // argv[1]: mount point, argv[2]: URI, argv[3]: file to read
+        err = vfs_mkdir(argv[1]);
+        assert(err_is_ok(err));
+        err = vfs_mount(argv[1], argv[2]);
+        assert(err_is_ok(err));
+        if (argc >= 4) {
+            filename = argv[3];
+        }
+    }
+
+    err = vfs_open(filename, &st.handle);
+    if (err_no(err) == FS_ERR_NOTFOUND) {
+        // create a test file
+        err = vfs_create(filename, &st.handle);
+        assert(err_is_ok(err));
+        for (size_t i = 0; i < DEFAULT_FILESIZE / BLOCK_SIZE; i++) {
+            size_t written;
+            err = vfs_write(st.handle, st.bufs[0], BLOCK_SIZE, &written);
+            assert(err_is_ok(err));
+        }
+    }
+    assert(err_is_ok(err));
+
+    err = vfs_stat(st.handle, &info);
+    assert(err_is_ok(err));
+    st.filesize = info.size;
+
+    printf("vfs_qd_bench: reading %s (%zu bytes) in %u byte blocks\n",
+           filename, st.filesize, BLOCK_SIZE);
+
+    for (size_t depth = 1; depth <= MAX_DEPTH; depth *= 2) {
+        run(&st, depth);
+    }
+
+    err = vfs_close(st.handle);
+    assert(err_is_ok(err));
+
+    printf("vfs_qd_bench done\n");
+    return 0;
+}
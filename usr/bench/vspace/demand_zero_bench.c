@@ -0,0 +1,163 @@
+/**
+ * \file
+ * \brief Benchmark for demand-zero anonymous memory
+ *
+ * Usage: vspace_demand_zero [region size in MB] [fault-around in pages]
+ *
+ * Touches the pages of a region backed up front by one frame, and of lazily
+ * backed demand-zero regions with and without fault-around, sequentially
+ * and sparsely, and reports the page faults per second and the resident
+ * memory of each run.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/except.h>
+#include <bench/bench.h>
+
+#define DEFAULT_SIZE_MB     64
+#define SPARSE_STRIDE       64      ///< pages between two sparse touches
+#define EX_STACK_SIZE       16384
+
+static char ex_stack[EX_STACK_SIZE];
+
+static void handler(enum exception_type type, int subtype, void *vaddr,
+                    arch_registers_state_t *regs,
+                    arch_registers_fpu_state_t *fpuregs)
+{
+    if (type != EXCEPT_PAGEFAULT) {
+        USER_PANIC("unexpected exception %d(%d) at %p", type, subtype, vaddr);
+    }
+
+    errval_t err = vspace_pagefault_handler(get_current_vspace(),
+                                            (lvaddr_t)vaddr, subtype);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "unhandled page fault at %p", vaddr);
+    }
+}
+
+/// Write to every stride-th page and check that it was zero before
+static cycles_t touch(uint8_t *base, size_t size, size_t stride)
+{
+    cycles_t start = bench_tsc();
+    for (size_t off = 0; off < size; off += stride * BASE_PAGE_SIZE) {
+        volatile size_t *p = (volatile size_t *)(base + off);
+        if (*p != 0) {
+            USER_PANIC("page at offset %zu is not zeroed", off);
+        }
+        *p = off;
+    }
+    cycles_t end = bench_tsc();
+
+    return bench_time_diff(start, end);
+}
+
+static void report(const char *what, cycles_t cycles, size_t faults,
+                   size_t resident)
+{
+    uint64_t rate = cycles ? faults * bench_tsc_per_ms() * 1000 / cycles : 0;
+    printf("%-24s %8" PRIu64 " ms  %8zu faults  %10" PRIu64 " faults/s"
+           "  %6zu MB resident\n", what, bench_tsc_to_ms(cycles), faults,
+           rate, resident >> 20);
+}
+
+/// Map a frame covering the whole region and touch it
+static void run_eager(size_t size, size_t stride, const char *what)
+{
+    struct capref frame;
+    size_t retsize;
+    void *buf;
+    errval_t err;
+
+    cycles_t start = bench_tsc();
+    err = frame_alloc(&frame, size, &retsize);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "frame_alloc");
+    }
+    err = vspace_map_one_frame(&buf, retsize, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "vspace_map_one_frame");
+    }
+    cycles_t end = bench_tsc();
+
+    cycles_t cycles = bench_time_diff(start, end) + touch(buf, size, stride);
+    report(what, cycles, 0, retsize);
+
+    err = vspace_unmap(buf);
+    assert(err_is_ok(err));
+    err = cap_destroy(frame);
+    assert(err_is_ok(err));
+}
+
+/// Map a demand-zero region and touch it
+static void run_lazy(size_t size, size_t stride, size_t fault_around,
+                     const char *what)
+{
+    struct memobj_anon *memobj = malloc(sizeof(struct memobj_anon));
+    struct vregion *vregion = malloc(sizeof(struct vregion));
+    assert(memobj != NULL && vregion != NULL);
+    errval_t err;
+
+    err = memobj_create_anon_lazy(memobj, size, 0, fault_around);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "memobj_create_anon_lazy");
+    }
+    err = vregion_map(vregion, get_current_vspace(), &memobj->m, 0, size,
+                      VREGION_FLAGS_READ_WRITE);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "vregion_map");
+    }
+
+    uint8_t *base = (void *)vspace_genvaddr_to_lvaddr(
+                                    vregion_get_base_addr(vregion));
+    cycles_t cycles = touch(base, size, stride);
+    report(what, cycles, memobj->faults, memobj->resident);
+
+    // the frames go to the frame cache, so later runs reuse them
+    err = memobj_destroy_anon(&memobj->m);
+    assert(err_is_ok(err));
+    free(vregion);
+    free(memobj);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t size = DEFAULT_SIZE_MB;
+    if (argc >= 2) {
+        size = atol(argv[1]);
+    }
+    size <<= 20;
+    size_t fault_around = MEMOBJ_ANON_FAULT_AROUND;
+    if (argc >= 3) {
+        fault_around = atol(argv[2]);
+    }
+    errval_t err;
+
+    bench_init();
+
+    err = thread_set_exception_handler(handler, NULL, ex_stack,
+                                       ex_stack + EX_STACK_SIZE, NULL, NULL);
+    assert(err_is_ok(err));
+
+    printf("vspace_demand_zero: %zu MB region, fault-around %zu pages\n",
+           size >> 20, fault_around);
+
+    run_eager(size, 1, "eager sequential");
+    run_lazy(size, 1, 1, "lazy sequential");
+    run_lazy(size, 1, fault_around, "lazy sequential around");
+    run_eager(size, SPARSE_STRIDE, "eager sparse");
+    run_lazy(size, SPARSE_STRIDE, 1, "lazy sparse");
+    run_lazy(size, SPARSE_STRIDE, fault_around, "lazy sparse around");
+
+    return 0;
+}
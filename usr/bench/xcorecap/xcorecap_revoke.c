@@ -0,0 +1,311 @@
+/**
+ * \file
+ * \brief Cross-core revoke throughput benchmark
+ *
+ * Usage: xcorecap_revoke <num cores> [num caps]
+ *
+ * Sends copies of a set of frame caps to a domain on each of the other
+ * cores, then revokes them, once with one cap_revoke() per cap and once with
+ * cap_revoke_multi(). This is repeated with the copies on 1 to num cores
+ * cores, to show how revoke throughput scales with the number of cores that
+ * take part in the revocation protocol.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <barrelfish/spawn_client.h>
+#include <if/xcorecap_revoke_defs.h>
+#include <if/monitor_blocking_rpcclient_defs.h>
+#include <bench/bench.h>
+
+#define DEFAULT_NUM_CAPS 1024
+
+static coreid_t my_coreid;
+static coreid_t num_cores;
+static size_t num_caps;
+
+static struct xcorecap_revoke_binding *bindings[MAX_CPUS];
+static size_t num_bound;
+static bool exported;
+
+/// Caps sent to other cores and not yet acknowledged
+static size_t pending;
+
+/// Caps received by a client
+static struct capref *received;
+static size_t num_received;
+
+static void get_service_name(char *name, size_t size, coreid_t coreid)
+{
+    snprintf(name, size, "xcorecap_revoke_%d", coreid);
+}
+
+static inline bool redo_message(errval_t err)
+{
+    if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+        messages_wait_and_handle_next();
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/* --- Client --- */
+
+static void reset_handler(struct xcorecap_revoke_binding *b)
+{
+    for (size_t i = 0; i < num_received; i++) {
+        // the caps have been revoked, so only the slots are left
+        slot_free(received[i]);
+    }
+    num_received = 0;
+}
+
+static void send_cap_handler(struct xcorecap_revoke_binding *b,
+                             struct capref cap)
+{
+    errval_t err;
+
+    if (num_received % DEFAULT_NUM_CAPS == 0) {
+        received = realloc(received, (num_received + DEFAULT_NUM_CAPS)
+                                     * sizeof(struct capref));
+        assert(received != NULL);
+    }
+    received[num_received++] = cap;
+
+    do {
+        err = b->tx_vtbl.cap_received(b, NOP_CONT);
+    } while (redo_message(err));
+    assert(err_is_ok(err));
+}
+
+/* --- Master --- */
+
+static void cap_received_handler(struct xcorecap_revoke_binding *b)
+{
+    assert(pending > 0);
+    pending--;
+}
+
+static struct xcorecap_revoke_rx_vtbl rx_vtbl = {
+    .reset        = reset_handler,
+    .send_cap     = send_cap_handler,
+    .cap_received = cap_received_handler,
+};
+
+static errval_t connect_cb(void *st, struct xcorecap_revoke_binding *b)
+{
+    b->rx_vtbl = rx_vtbl;
+    return SYS_ERR_OK;
+}
+
+static void export_cb(void *st, errval_t err, iref_t iref)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "export failed");
+    }
+
+    char name[64];
+    get_service_name(name, sizeof(name), my_coreid);
+    err = nameservice_register(name, iref);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "nameservice_register failed");
+    }
+    exported = true;
+}
+
+static void bind_cb(void *st, errval_t err, struct xcorecap_revoke_binding *b)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "bind failed");
+    }
+
+    b->rx_vtbl = rx_vtbl;
+    bindings[(coreid_t)(uintptr_t)st] = b;
+    num_bound++;
+}
+
+static void spawn_and_bind(char *path)
+{
+    errval_t err;
+    char *xargv[] = { path, "client", NULL };
+
+    for (coreid_t c = 0; c < num_cores; c++) {
+        if (c == my_coreid) {
+            continue;
+        }
+
+        /* XXX: assumes core IDs are 0-based and contiguous */
+        err = spawn_program(c, path, xargv, NULL, SPAWN_FLAGS_DEFAULT, NULL);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "spawning on core %d", c);
+        }
+
+        char name[64];
+        iref_t iref;
+        get_service_name(name, sizeof(name), c);
+        err = nameservice_blocking_lookup(name, &iref);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "nameservice_blocking_lookup");
+        }
+
+        err = xcorecap_revoke_bind(iref, bind_cb, (void *)(uintptr_t)c,
+                                   get_default_waitset(),
+                                   IDC_BIND_FLAGS_DEFAULT);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "bind");
+        }
+    }
+
+    while (num_bound < num_cores - 1) {
+        messages_wait_and_handle_next();
+    }
+}
+
+/// Send a copy of every cap to the clients on the first ncores cores
+static void distribute(struct capref *caps, coreid_t ncores)
+{
+    errval_t err;
+
+    for (coreid_t c = 0, n = 1; c < num_cores && n < ncores; c++) {
+        if (c == my_coreid) {
+            continue;
+        }
+        n++;
+
+        struct xcorecap_revoke_binding *b = bindings[c];
+        do {
+            err = b->tx_vtbl.reset(b, NOP_CONT);
+        } while (redo_message(err));
+        assert(err_is_ok(err));
+
+        for (size_t i = 0; i < num_caps; i++) {
+            do {
+                err = b->tx_vtbl.send_cap(b, NOP_CONT, caps[i]);
+            } while (redo_message(err));
+            assert(err_is_ok(err));
+            pending++;
+        }
+    }
+
+    while (pending > 0) {
+        messages_wait_and_handle_next();
+    }
+}
+
+static void get_stats(uint64_t *rounds, uint64_t *remote_marks)
+{
+    struct monitor_blocking_rpc_client *mrc = get_monitor_blocking_rpc_client();
+    uint64_t ops, caps;
+
+    errval_t err = mrc->vtbl.revoke_stats(mrc, &ops, &caps, rounds,
+                                          remote_marks);
+    assert(err_is_ok(err));
+}
+
+static void report(const char *what, coreid_t ncores, cycles_t cycles,
+                   uint64_t rounds)
+{
+    uint64_t ms = bench_tsc_to_ms(cycles);
+    uint64_t caps_per_s = ms > 0 ? num_caps * 1000 / ms : 0;
+
+    printf("%-8s cores %3d: %10" PRIu64 " cycles/cap %8" PRIu64 " caps/s "
+           "%6" PRIu64 " rounds\n", what, ncores, cycles / num_caps,
+           caps_per_s, rounds);
+}
+
+static void run_master(char *path)
+{
+    errval_t err;
+    uint64_t rounds_start, rounds_end, marks;
+
+    struct capref *caps = calloc(num_caps, sizeof(struct capref));
+    assert(caps != NULL);
+    for (size_t i = 0; i < num_caps; i++) {
+        err = frame_alloc(&caps[i], BASE_PAGE_SIZE, NULL);
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "frame_alloc");
+        }
+    }
+
+    spawn_and_bind(path);
+
+    for (coreid_t ncores = 1; ncores <= num_cores; ncores++) {
+        // one revoke operation per cap
+        distribute(caps, ncores);
+        get_stats(&rounds_start, &marks);
+        cycles_t start = bench_tsc();
+        for (size_t i = 0; i < num_caps; i++) {
+            err = cap_revoke(caps[i]);
+            if (err_is_fail(err)) {
+                USER_PANIC_ERR(err, "cap_revoke");
+            }
+        }
+        cycles_t end = bench_tsc();
+        get_stats(&rounds_end, &marks);
+        report("single", ncores, bench_time_diff(start, end),
+               rounds_end - rounds_start);
+
+        // all caps in batches
+        distribute(caps, ncores);
+        get_stats(&rounds_start, &marks);
+        start = bench_tsc();
+        err = cap_revoke_multi(caps, num_caps);
+        end = bench_tsc();
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "cap_revoke_multi");
+        }
+        get_stats(&rounds_end, &marks);
+        report("multi", ncores, bench_time_diff(start, end),
+               rounds_end - rounds_start);
+    }
+
+    printf("xcorecap_revoke done\n");
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+
+    my_coreid = disp_get_core_id();
+
+    bool client = argc >= 2 && strcmp(argv[1], "client") == 0;
+    if (!client) {
+        if (argc < 2) {
+            printf("usage: %s <num cores> [num caps]\n", argv[0]);
+            return 1;
+        }
+        num_cores = atoi(argv[1]);
+        num_caps = argc >= 3 ? atol(argv[2]) : DEFAULT_NUM_CAPS;
+    }
+
+    err = xcorecap_revoke_export(NULL, export_cb, connect_cb,
+                                 get_default_waitset(),
+                                 IDC_EXPORT_FLAGS_DEFAULT);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "export");
+    }
+    while (!exported) {
+        messages_wait_and_handle_next();
+    }
+
+    if (client) {
+        messages_handler_loop();
+    }
+
+    bench_init();
+    run_master(argv[0]);
+    return 0;
+}
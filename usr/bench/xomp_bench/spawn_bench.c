@@ -12,6 +12,8 @@
 
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/nameservice_client.h>
+#include <barrelfish/spawn_client.h>
+#include <barrelfish/ram_alloc.h>
 
 #include <xeon_phi/xeon_phi.h>
 #include <xeon_phi/xeon_phi_domain.h>
@@ -120,6 +122,75 @@ static int prepare_xomp(int argc,
     return (location == XOMP_WORKER_LOC_LOCAL);
 }
 
+#ifdef __k1om__
+#define SPAWN_BENCH_PATH "/k1om/sbin/benchmarks/xomp_spawn"
+#else
+#define SPAWN_BENCH_PATH "/x86_64/sbin/benchmarks/xomp_spawn"
+#endif
+
+/*
+ * Spawns ninstances idle copies of a binary on this core, one after the
+ * other, and reports the latency of each spawn and the memory used per
+ * instance. The first spawn of a binary fills the image cache of spawnd;
+ * the following ones share its text segments.
+ */
+static int spawn_bench(uint32_t ninstances, const char *path)
+{
+    errval_t err;
+
+    domainid_t *domains = calloc(ninstances, sizeof(domainid_t));
+    assert(domains != NULL);
+
+    char *const args[] = { (char *)path, "idle", NULL };
+
+    genpaddr_t avail_before, avail_after, total;
+    err = ram_available(&avail_before, &total);
+    EXPECT_SUCCESS(err, "ram_available");
+
+    cycles_t first = 0, rest = 0;
+    for (uint32_t i = 0; i < ninstances; ++i) {
+        cycles_t tsc_start = bench_tsc();
+        err = spawn_program(disp_get_core_id(), path, args, NULL,
+                            SPAWN_FLAGS_DEFAULT, &domains[i]);
+        cycles_t tsc_end = bench_tsc();
+        EXPECT_SUCCESS(err, "spawn_program");
+
+        cycles_t t = bench_time_diff(tsc_start, tsc_end);
+        debug_printf("spawn %u: %lu cycles\n", i, t);
+        if (i == 0) {
+            first = t;
+        } else {
+            rest += t;
+        }
+    }
+
+    err = ram_available(&avail_after, &total);
+    EXPECT_SUCCESS(err, "ram_available");
+
+    debug_printf("-------------------------------------\n");
+    debug_printf("spawned %u x %s\n", ninstances, path);
+    debug_printf("first spawn:   %lu cycles (%lu ms)\n", first,
+                 bench_tsc_to_ms(first));
+    if (ninstances > 1) {
+        cycles_t avg = rest / (ninstances - 1);
+        debug_printf("later spawns:  %lu cycles (%lu ms) on average\n", avg,
+                     bench_tsc_to_ms(avg));
+    }
+    debug_printf("memory/instance: %" PRIuGENPADDR " kB\n",
+                 (avail_before - avail_after) / ninstances / 1024);
+    debug_printf("-------------------------------------\n");
+
+    for (uint32_t i = 0; i < ninstances; ++i) {
+        err = spawn_kill(domains[i]);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "spawn_kill");
+        }
+    }
+
+    free(domains);
+    return 0;
+}
+
 int main(int argc,
          char *argv[])
 {
@@ -128,6 +199,18 @@ int main(int argc,
 
     bench_init();
 
+    // instance spawned by spawn_bench()
+    if (argc >= 2 && !strcmp(argv[1], "idle")) {
+        while (1) {
+            event_dispatch(get_default_waitset());
+        }
+    }
+
+    if (argc >= 3 && !strcmp(argv[2], "spawn")) {
+        return spawn_bench(strtoul(argv[1], NULL, 10),
+                           argc >= 4 ? argv[3] : SPAWN_BENCH_PATH);
+    }
+
     err = xomp_worker_parse_cmdline(argc, argv, &wid);
     if (err_is_ok(err)) {
         struct xomp_args xw_arg = {
@@ -143,6 +226,7 @@ int main(int argc,
 
     if (argc < 4) {
         debug_printf("Usage: %s <size> <numthreats>\n", argv[0]);
+        debug_printf("       %s <instances> spawn [path]\n", argv[0]);
         exit(1);
     }
 
@@ -151,6 +151,17 @@ int main(int argc, char** argv)
         USER_PANIC_ERR(err, "Unable to wait for spawnds failed.");
     }
 
+    // Report how much work the SKB did during boot
+    struct skb_stats stats;
+    err = skb_get_stats(&stats);
+    if (err_is_ok(err)) {
+        KALUGA_DEBUG("Kaluga: SKB ran %"PRIu64" goals in %"PRIu64" cycles, "
+                     "%"PRIu64" facts in %"PRIu64" batches, cache %"PRIu64
+                     " hits %"PRIu64" misses\n", stats.queries, stats.cycles,
+                     stats.facts, stats.fact_batches, stats.cache_hits,
+                     stats.cache_misses);
+    }
+
 #elif __pandaboard__
     debug_printf("Kaluga running on Pandaboard.\n");
 
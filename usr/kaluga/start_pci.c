@@ -83,9 +83,10 @@ static void pci_change_event(octopus_mode_t mode, char* device_record, void* st)
         }
 
         // Ask the SKB which binary and where to start it...
-        static char* query = "find_pci_driver(pci_card(%"PRIu64", %"PRIu64", _, _, _), Driver),"
-                             "writeln(Driver).";
-        err = skb_execute_query(query, vendor_id, device_id);
+        static char* query = "find_pci_driver(pci_card(Arg1, Arg2, _, _, _), Driver),"
+                             "writeln(Driver)";
+        err = skb_execute_cached(query, "%"PRIu64", %"PRIu64, vendor_id,
+                                 device_id);
         if (err_no(err) == SKB_ERR_EXECUTION) {
             KALUGA_DEBUG("No PCI driver found for: VendorId=0x%"PRIx64", "
                          "DeviceId=0x%"PRIx64"\n",
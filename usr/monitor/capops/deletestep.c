@@ -6,6 +6,12 @@
 #include <barrelfish/event_queue.h>
 #include <barrelfish/slot_alloc.h>
 
+/// Number of slots for the RAM caps returned by one batch of steps
+#define DELETE_STEPS_SLOTS  32
+
+/// Cycles the kernel may spend in one batch of steps
+#define DELETE_STEPS_BUDGET (1UL << 20)
+
 static struct event_queue trigger_queue;
 static bool triggered;
 static bool enqueued;
@@ -15,6 +21,7 @@ static struct event_closure step_closure;
 static struct event_queue_node caplock_qn;
 static struct delete_st delete_step_st;
 static struct capref delcap;
+static struct capref retcaps;
 static struct event_queue delete_queue;
 static struct delete_queue_node *pending_head, *pending_tail;
 
@@ -51,8 +58,13 @@ delete_steps_init(struct waitset *ws)
 
     delete_step_st.wait = false;
     delete_step_st.result_handler = NULL;
-    err = slot_alloc(&delcap);
-    PANIC_IF_ERR(err, "allocating delete_steps slot");
+    struct capref retcn_cap;
+    struct cnoderef retcn;
+    err = cnode_create(&retcn_cap, &retcn, DELETE_STEPS_SLOTS, NULL);
+    PANIC_IF_ERR(err, "allocating delete_steps slots");
+    retcaps.cnode = retcn;
+    retcaps.slot = 0;
+    delcap = retcaps;
     delete_step_st.capref = get_cap_domref(delcap);
     err = slot_alloc(&delete_step_st.newcap);
     PANIC_IF_ERR(err, "allocating delete_steps new cap slot");
@@ -100,6 +112,19 @@ delete_steps_delete_result(errval_t status, void *st)
     delete_steps_resume();
 }
 
+/// Hand the RAM caps reclaimed by a batch of steps to the memory server
+static void
+send_new_ram_caps(size_t count)
+{
+    DEBUG_CAPOPS("%s: sending %zu reclaimed RAM caps to memserv.\n",
+                 __FUNCTION__, count);
+    for (size_t i = 0; i < count; i++) {
+        struct capref ram = retcaps;
+        ram.slot += i;
+        send_new_ram_cap(ram);
+    }
+}
+
 static void
 delete_steps_cont(void *st)
 {
@@ -113,7 +138,11 @@ delete_steps_cont(void *st)
         return;
     }
 
-    err = monitor_delete_step(delcap);
+    size_t count;
+    err = monitor_delete_steps(retcaps, DELETE_STEPS_SLOTS,
+                               DELETE_STEPS_BUDGET, &count);
+    send_new_ram_caps(count);
+
     if (err_no(err) == SYS_ERR_CAP_LOCKED) {
         // XXX
         DEBUG_CAPOPS("%s: cap locked\n", __FUNCTION__);
@@ -122,6 +151,10 @@ delete_steps_cont(void *st)
     if (err_no(err) == SYS_ERR_DELETE_LAST_OWNED) {
         DEBUG_CAPOPS("%s: deleting last owned\n", __FUNCTION__);
         assert(!delete_step_st.result_handler);
+        // the kernel has put the cap in the slot after the RAM caps
+        delcap = retcaps;
+        delcap.slot += count;
+        delete_step_st.capref = get_cap_domref(delcap);
         delete_step_st.result_handler = delete_steps_delete_result;
         delete_step_st.st = NULL;
         capops_delete_int(&delete_step_st);
@@ -134,10 +167,6 @@ delete_steps_cont(void *st)
         USER_PANIC_ERR(err, "while performing delete steps");
     }
     else {
-        if (err_no(err) == SYS_ERR_RAM_CAP_CREATED) {
-            DEBUG_CAPOPS("%s: sending reclaimed RAM to memserv.\n", __FUNCTION__);
-            send_new_ram_cap(delcap);
-        }
         if (!enqueued) {
             DEBUG_CAPOPS("%s: !enqueued, adding to queue\n", __FUNCTION__);
             event_queue_add(&trigger_queue, &trigger_qn, step_closure);
@@ -153,17 +182,16 @@ delete_steps_clear(void *st)
     DEBUG_CAPOPS("%s\n", __FUNCTION__);
     errval_t err;
     while (true) {
-        err = monitor_clear_step(delcap);
+        size_t count;
+        err = monitor_clear_steps(retcaps, DELETE_STEPS_SLOTS,
+                                  DELETE_STEPS_BUDGET, &count);
+        send_new_ram_caps(count);
         if (err_no(err) == SYS_ERR_CAP_NOT_FOUND) {
             break;
         }
         else if (err_is_fail(err)) {
             USER_PANIC_ERR(err, "while performing clear steps");
         }
-        else if (err_no(err) == SYS_ERR_RAM_CAP_CREATED) {
-            DEBUG_CAPOPS("%s: sending reclaimed RAM to memserv.\n", __FUNCTION__);
-            send_new_ram_cap(delcap);
-        }
     }
     DEBUG_CAPOPS("%s: finished, calling delete_queue_notify\n", __FUNCTION__);
     triggered = false;
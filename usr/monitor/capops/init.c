@@ -20,6 +20,7 @@ errval_t capops_init(struct waitset *ws, struct intermon_binding *b)
     b->rx_vtbl.capops_delete_remote           = delete_remote__rx;
     b->rx_vtbl.capops_delete_remote_result    = delete_remote_result__rx;
     b->rx_vtbl.capops_revoke_mark             = revoke_mark__rx;
+    b->rx_vtbl.capops_revoke_mark_multi       = revoke_mark_multi__rx;
     b->rx_vtbl.capops_revoke_ready            = revoke_ready__rx;
     b->rx_vtbl.capops_revoke_commit           = revoke_commit__rx;
     b->rx_vtbl.capops_revoke_done             = revoke_done__rx;
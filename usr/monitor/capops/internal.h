@@ -104,6 +104,9 @@ void retype_response__rx(struct intermon_binding *b, errval_t status,
 void revoke_mark__rx(struct intermon_binding *b,
                      intermon_caprep_t caprep,
                      genvaddr_t st);
+void revoke_mark_multi__rx(struct intermon_binding *b,
+                           uint8_t *caps, size_t len,
+                           genvaddr_t st);
 void revoke_ready__rx(struct intermon_binding *b, genvaddr_t st);
 void revoke_commit__rx(struct intermon_binding *b, genvaddr_t st);
 void revoke_done__rx(struct intermon_binding *b, genvaddr_t st);
@@ -7,6 +7,7 @@
  * ETH Zurich D-INFK, Haldeneggsteig 4, CH-8092 Zurich. Attn: Systems Group.
  */
 
+#include <string.h>
 #include <barrelfish/barrelfish.h>
 #include "monitor.h"
 #include "capops.h"
@@ -19,10 +20,19 @@
 
 struct revoke_slave_st *slaves_head = 0, *slaves_tail = 0;
 
+static struct capops_revoke_stats revoke_stats;
+
+/*
+ * A revoke operation revokes a set of caps, which share one round of
+ * mark/ready/commit/done messages with the other monitors.
+ */
 struct revoke_master_st {
     struct delete_queue_node del_qn;
-    struct domcapref cap;
-    struct capability rawcap;
+    struct domcapref *caps;
+    struct capability *rawcaps;
+    intermon_caprep_t *capreps;     ///< marshalled caps for revoke_mark_multi
+    size_t count;
+    size_t retrieved;               ///< caps checked for ownership so far
     struct capsend_mc_st revoke_mc_st;
     struct capsend_destset dests;
     revoke_result_handler_t result_handler;
@@ -33,7 +43,8 @@ struct revoke_master_st {
 struct revoke_slave_st {
     struct intermon_msg_queue_elem im_qn;
     struct delete_queue_node del_qn;
-    struct capability rawcap;
+    struct capability *rawcaps;
+    size_t count;
     struct capref cap;
     coreid_t from;
     genvaddr_t st;
@@ -45,11 +56,15 @@ static void revoke_result__rx(errval_t result,
                               struct revoke_master_st *st,
                               bool locked);
 static void revoke_retrieve__rx(errval_t result, void *st_);
+static void revoke_retrieve_next(struct revoke_master_st *st);
 static void revoke_local(struct revoke_master_st *st);
 static void revoke_no_remote(struct revoke_master_st *st);
 static errval_t revoke_mark__send(struct intermon_binding *b,
                                   intermon_caprep_t *caprep,
                                   struct capsend_mc_st *mc_st);
+static errval_t revoke_mark_multi__send(struct intermon_binding *b,
+                                        intermon_caprep_t *caprep,
+                                        struct capsend_mc_st *mc_st);
 static void revoke_ready__send(struct intermon_binding *b,
                                struct intermon_msg_queue_elem *e);
 static errval_t revoke_commit__send(struct intermon_binding *b,
@@ -60,60 +75,95 @@ static void revoke_done__send(struct intermon_binding *b,
                               struct intermon_msg_queue_elem *e);
 static void revoke_master_steps__fin(void *st);
 
+static void
+revoke_master_free(struct revoke_master_st *st)
+{
+    free(st->caps);
+    free(st->rawcaps);
+    free(st->capreps);
+    free(st);
+}
+
 void
 capops_revoke(struct domcapref cap,
               revoke_result_handler_t result_handler,
               void *st)
 {
-    errval_t err;
+    capops_revoke_multi(&cap, 1, result_handler, st);
+}
 
-    DEBUG_CAPOPS("%s ## start revocation protocol\n", __FUNCTION__);
+/**
+ * \brief Revoke a set of caps in one round of the revocation protocol
+ *
+ * All caps are marked before a single mark message is sent to each other
+ * monitor, and their copies and descendants are deleted in the same round of
+ * delete steps. The result handler is called once for the whole set.
+ */
+void
+capops_revoke_multi(struct domcapref *caps, size_t count,
+                    revoke_result_handler_t result_handler,
+                    void *st)
+{
+    errval_t err;
 
-    distcap_state_t state;
-    err = dom_cnode_get_state(cap, &state);
-    GOTO_IF_ERR(err, report_error);
+    DEBUG_CAPOPS("%s ## start revocation protocol for %zu caps\n",
+                 __FUNCTION__, count);
 
-    if (distcap_state_is_busy(state)) {
-        err = MON_ERR_REMOTE_CAP_RETRY;
-        goto report_error;
+    if (count == 0) {
+        result_handler(SYS_ERR_OK, st);
+        return;
     }
 
     struct revoke_master_st *rst;
     err = calloce(1, sizeof(*rst), &rst);
     GOTO_IF_ERR(err, report_error);
-    rst->cap = cap;
-    err = monitor_domains_cap_identify(cap.croot, cap.cptr, cap.bits, &rst->rawcap);
-    GOTO_IF_ERR(err, free_st);
+    rst->count = count;
     rst->result_handler = result_handler;
     rst->st = st;
 
-    if (distcap_state_is_foreign(state)) {
-        // need to retrieve ownership
-        DEBUG_CAPOPS("%s getting cap ownership\n", __FUNCTION__);
-        capops_retrieve(rst->cap, revoke_retrieve__rx, rst);
+    rst->caps = calloc(count, sizeof(*rst->caps));
+    rst->rawcaps = calloc(count, sizeof(*rst->rawcaps));
+    if (!rst->caps || !rst->rawcaps) {
+        err = LIB_ERR_MALLOC_FAIL;
+        goto free_st;
     }
-    else {
-        if (num_monitors_online() == 1) {
-            DEBUG_CAPOPS("%s: only one monitor: do simpler revoke\n",
-                    __FUNCTION__);
-            // no remote monitors exist; do simplified revocation process
-            revoke_no_remote(rst);
-            // return here
-            return;
+
+    for (size_t i = 0; i < count; i++) {
+        distcap_state_t state;
+        err = dom_cnode_get_state(caps[i], &state);
+        GOTO_IF_ERR(err, free_st);
+
+        if (distcap_state_is_busy(state)) {
+            err = MON_ERR_REMOTE_CAP_RETRY;
+            goto free_st;
         }
-        // have ownership, initiate revoke
-        revoke_local(rst);
+
+        rst->caps[i] = caps[i];
+        err = monitor_domains_cap_identify(caps[i].croot, caps[i].cptr,
+                                           caps[i].bits, &rst->rawcaps[i]);
+        GOTO_IF_ERR(err, free_st);
     }
 
+    rst->retrieved = 0;
+    revoke_retrieve_next(rst);
     return;
 
 free_st:
-    free(rst);
+    revoke_master_free(rst);
 
 report_error:
     result_handler(err, st);
 }
 
+/**
+ * \brief Fill in the revoke statistics of this monitor
+ */
+void
+capops_revoke_get_stats(struct capops_revoke_stats *stats)
+{
+    *stats = revoke_stats;
+}
+
 static void
 revoke_result__rx(errval_t result,
                   struct revoke_master_st *st,
@@ -122,25 +172,34 @@ revoke_result__rx(errval_t result,
     DEBUG_CAPOPS("%s\n", __FUNCTION__);
     errval_t err;
 
-    if (locked) {
-        caplock_unlock(st->cap);
+    for (size_t i = 0; i < st->count; i++) {
+        struct domcapref *cap = &st->caps[i];
+
+        if (locked) {
+            caplock_unlock(*cap);
+        }
+
+        if (err_is_ok(result)) {
+            // clear the remote copies bit
+            err = monitor_domcap_remote_relations(cap->croot, cap->cptr,
+                                                  cap->bits, 0,
+                                                  RRELS_COPY_BIT, NULL);
+            if (err_is_fail(err) && err_no(err) != SYS_ERR_CAP_NOT_FOUND) {
+                DEBUG_ERR(err, "resetting remote copies bit after revoke");
+            }
+        }
     }
 
     if (err_is_ok(result)) {
-        // clear the remote copies bit
-        err = monitor_domcap_remote_relations(st->cap.croot, st->cap.cptr,
-                                              st->cap.bits, 0, RRELS_COPY_BIT,
-                                              NULL);
-        if (err_is_fail(err) && err_no(err) != SYS_ERR_CAP_NOT_FOUND) {
-            DEBUG_ERR(err, "resetting remote copies bit after revoke");
-        }
+        revoke_stats.ops++;
+        revoke_stats.caps += st->count;
     }
 
     DEBUG_CAPOPS("%s ## revocation completed, calling %p\n", __FUNCTION__,
                  st->result_handler);
 
     st->result_handler(result, st->st);
-    free(st);
+    revoke_master_free(st);
 }
 
 static void
@@ -155,11 +214,76 @@ revoke_retrieve__rx(errval_t result, void *st_)
 
 #ifndef NDEBUG
         distcap_state_t state;
-        errval_t err = dom_cnode_get_state(st->cap, &state);
+        errval_t err = dom_cnode_get_state(st->caps[st->retrieved], &state);
         PANIC_IF_ERR(err, "dom_cnode_get_state");
         assert(!distcap_state_is_foreign(state));
 #endif
-        revoke_local(st);
+        st->retrieved++;
+        revoke_retrieve_next(st);
+    }
+}
+
+/**
+ * \brief Retrieve ownership of the foreign caps of the set, one after
+ *        another, then start the revocation.
+ */
+static void
+revoke_retrieve_next(struct revoke_master_st *st)
+{
+    errval_t err;
+
+    for (; st->retrieved < st->count; st->retrieved++) {
+        distcap_state_t state;
+        err = dom_cnode_get_state(st->caps[st->retrieved], &state);
+        if (err_is_fail(err)) {
+            revoke_result__rx(err, st, false);
+            return;
+        }
+
+        if (distcap_state_is_foreign(state)) {
+            // need to retrieve ownership
+            DEBUG_CAPOPS("%s getting cap ownership\n", __FUNCTION__);
+            capops_retrieve(st->caps[st->retrieved], revoke_retrieve__rx, st);
+            return;
+        }
+    }
+
+    if (num_monitors_online() == 1) {
+        DEBUG_CAPOPS("%s: only one monitor: do simpler revoke\n",
+                __FUNCTION__);
+        // no remote monitors exist; do simplified revocation process
+        revoke_no_remote(st);
+        return;
+    }
+    // have ownership, initiate revoke
+    revoke_local(st);
+}
+
+/**
+ * \brief Mark the caps of the set in the local kernel
+ */
+static void
+revoke_mark_targets(struct revoke_master_st *st)
+{
+    errval_t err;
+
+    for (size_t i = 0; i < st->count; i++) {
+        struct domcapref *cap = &st->caps[i];
+
+        if (i > 0) {
+            // an earlier cap of the set may have been a copy or ancestor of
+            // this one, in which case it has already been marked for deletion
+            struct capability raw;
+            err = monitor_domains_cap_identify(cap->croot, cap->cptr,
+                                               cap->bits, &raw);
+            if (err_is_fail(err) || raw.type == ObjType_Null) {
+                DEBUG_CAPOPS("%s: cap %zu already revoked\n", __FUNCTION__, i);
+                continue;
+            }
+        }
+
+        err = monitor_revoke_mark_target(cap->croot, cap->cptr, cap->bits);
+        PANIC_IF_ERR(err, "marking revoke");
     }
 }
 
@@ -172,15 +296,22 @@ revoke_local(struct revoke_master_st *st)
 
     delete_steps_pause();
 
-    err = monitor_revoke_mark_target(st->cap.croot,
-                                     st->cap.cptr,
-                                     st->cap.bits);
-    PANIC_IF_ERR(err, "marking revoke");
+    revoke_mark_targets(st);
 
+    capsend_send_fn send_fn = revoke_mark__send;
+    if (st->count > 1) {
+        st->capreps = calloc(st->count, sizeof(*st->capreps));
+        assert(st->capreps);
+        for (size_t i = 0; i < st->count; i++) {
+            capability_to_caprep(&st->rawcaps[i], &st->capreps[i]);
+        }
+        send_fn = revoke_mark_multi__send;
+    }
 
     DEBUG_CAPOPS("%s ## revocation: mark phase\n", __FUNCTION__);
+    revoke_stats.rounds++;
     // XXX: could check whether remote copies exist here(?), -SG, 2014-11-05
-    err = capsend_relations(&st->rawcap, revoke_mark__send,
+    err = capsend_relations(&st->rawcaps[0], send_fn,
             &st->revoke_mc_st, &st->dests);
     PANIC_IF_ERR(err, "initiating revoke mark multicast");
 }
@@ -194,20 +325,15 @@ revoke_no_remote(struct revoke_master_st *st)
         delete_steps_init(get_default_waitset());
     }
 
-    errval_t err;
     DEBUG_CAPOPS("%s\n", __FUNCTION__);
 
     // pause deletion steps
     DEBUG_CAPOPS("%s: delete_steps_pause()\n", __FUNCTION__);
     delete_steps_pause();
 
-    // mark target of revoke
+    // mark targets of revoke
     DEBUG_CAPOPS("%s: mon_revoke_mark_tgt()\n", __FUNCTION__);
-    err = monitor_revoke_mark_target(st->cap.croot,
-                                     st->cap.cptr,
-                                     st->cap.bits);
-    PANIC_IF_ERR(err, "marking revoke");
-
+    revoke_mark_targets(st);
 
     // resume delete steps
     DEBUG_CAPOPS("%s: delete_steps_resume()\n", __FUNCTION__);
@@ -232,12 +358,23 @@ revoke_mark__send(struct intermon_binding *b,
     return intermon_capops_revoke_mark__tx(b, NOP_CONT, *caprep, (lvaddr_t)st);
 }
 
-void
-revoke_mark__rx(struct intermon_binding *b,
-                intermon_caprep_t caprep,
-                genvaddr_t st)
+static errval_t
+revoke_mark_multi__send(struct intermon_binding *b,
+                        intermon_caprep_t *caprep,
+                        struct capsend_mc_st *mc_st)
+{
+    struct revoke_master_st *st;
+    ptrdiff_t off = offsetof(struct revoke_master_st, revoke_mc_st);
+    st = (struct revoke_master_st*)((uintptr_t)mc_st - off);
+    return intermon_capops_revoke_mark_multi__tx(b, NOP_CONT,
+            (uint8_t *)st->capreps, st->count * sizeof(*st->capreps),
+            (lvaddr_t)st);
+}
+
+static void
+revoke_slave_mark(struct intermon_binding *b, struct capability *rawcaps,
+                  size_t count, genvaddr_t st)
 {
-    DEBUG_CAPOPS("%s\n", __FUNCTION__);
     errval_t err;
     struct intermon_state *inter_st = (struct intermon_state*)b->st;
 
@@ -247,7 +384,8 @@ revoke_mark__rx(struct intermon_binding *b,
 
     rvk_st->from = inter_st->core_id;
     rvk_st->st = st;
-    caprep_to_capability(&caprep, &rvk_st->rawcap);
+    rvk_st->rawcaps = rawcaps;
+    rvk_st->count = count;
 
     if (!slaves_head) {
         assert(!slaves_tail);
@@ -264,22 +402,61 @@ revoke_mark__rx(struct intermon_binding *b,
     // to delete all foreign copies before we can delete locally owned caps
     delete_steps_pause();
 
-    // XXX: this invocation could create a scheduling hole that could be
-    // problematic in RT systems and should probably be done in a loop.
-    err = monitor_revoke_mark_relations(&rvk_st->rawcap);
-    if (err_no(err) == SYS_ERR_CAP_NOT_FOUND) {
-        // found no copies or descendants of capability on this core,
-        // do nothing. -SG
-        DEBUG_CAPOPS("no copies on core %d\n", disp_get_core_id());
-    } else if (err_is_fail(err)) {
-        USER_PANIC_ERR(err, "marking revoke");
+    for (size_t i = 0; i < count; i++) {
+        // XXX: this invocation could create a scheduling hole that could be
+        // problematic in RT systems and should probably be done in a loop.
+        err = monitor_revoke_mark_relations(&rawcaps[i]);
+        if (err_no(err) == SYS_ERR_CAP_NOT_FOUND) {
+            // found no copies or descendants of capability on this core,
+            // do nothing. -SG
+            DEBUG_CAPOPS("no copies on core %d\n", disp_get_core_id());
+        } else if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "marking revoke");
+        }
     }
+    revoke_stats.remote_marks += count;
 
     rvk_st->im_qn.cont = revoke_ready__send;
     err = capsend_target(rvk_st->from, (struct msg_queue_elem*)rvk_st);
     PANIC_IF_ERR(err, "enqueing revoke_ready");
 }
 
+void
+revoke_mark__rx(struct intermon_binding *b,
+                intermon_caprep_t caprep,
+                genvaddr_t st)
+{
+    DEBUG_CAPOPS("%s\n", __FUNCTION__);
+
+    struct capability *rawcap = malloc(sizeof(*rawcap));
+    assert(rawcap);
+    caprep_to_capability(&caprep, rawcap);
+
+    revoke_slave_mark(b, rawcap, 1, st);
+}
+
+void
+revoke_mark_multi__rx(struct intermon_binding *b,
+                      uint8_t *caps, size_t len,
+                      genvaddr_t st)
+{
+    DEBUG_CAPOPS("%s\n", __FUNCTION__);
+
+    size_t count = len / sizeof(intermon_caprep_t);
+    assert(count * sizeof(intermon_caprep_t) == len);
+
+    struct capability *rawcaps = calloc(count, sizeof(*rawcaps));
+    assert(rawcaps);
+    for (size_t i = 0; i < count; i++) {
+        intermon_caprep_t caprep;
+        memcpy(&caprep, caps + i * sizeof(caprep), sizeof(caprep));
+        caprep_to_capability(&caprep, &rawcaps[i]);
+    }
+    free(caps);
+
+    revoke_slave_mark(b, rawcaps, count, st);
+}
+
 static void
 revoke_ready__send(struct intermon_binding *b,
                    struct intermon_msg_queue_elem *e)
@@ -304,7 +481,7 @@ revoke_ready__rx(struct intermon_binding *b, genvaddr_t st)
     }
 
     DEBUG_CAPOPS("%s ## revocation: commit phase\n", __FUNCTION__);
-    err = capsend_relations(&rvk_st->rawcap, revoke_commit__send,
+    err = capsend_relations(&rvk_st->rawcaps[0], revoke_commit__send,
             &rvk_st->revoke_mc_st, &rvk_st->dests);
     PANIC_IF_ERR(err, "enqueing revoke_commit multicast");
 
@@ -400,6 +577,7 @@ revoke_done__send(struct intermon_binding *b,
     err = intermon_capops_revoke_done__tx(b, NOP_CONT, rvk_st->st);
     PANIC_IF_ERR(err, "sending revoke_done");
     remove_slave_from_list(rvk_st);
+    free(rvk_st->rawcaps);
     free(rvk_st);
 }
 
@@ -225,6 +225,28 @@ invoke_monitor_clear_step(capaddr_t retcn, int retcnbits, cslot_t retslot)
                        retcn, retcnbits, retslot).error;
 }
 
+static inline errval_t
+invoke_monitor_delete_steps(capaddr_t retcn, int retcnbits, cslot_t retslot,
+                            cslot_t nslots, uintptr_t budget, size_t *count)
+{
+    struct sysret sysret;
+    sysret = cap_invoke6(cap_kernel, KernelCmd_Delete_steps,
+                         retcn, retcnbits, retslot, nslots, budget);
+    *count = sysret.value;
+    return sysret.error;
+}
+
+static inline errval_t
+invoke_monitor_clear_steps(capaddr_t retcn, int retcnbits, cslot_t retslot,
+                           cslot_t nslots, uintptr_t budget, size_t *count)
+{
+    struct sysret sysret;
+    sysret = cap_invoke6(cap_kernel, KernelCmd_Clear_steps,
+                         retcn, retcnbits, retslot, nslots, budget);
+    *count = sysret.value;
+    return sysret.error;
+}
+
 static inline errval_t
 invoke_monitor_has_descendants(uint64_t *raw, bool *res)
 {
@@ -34,6 +34,18 @@ typedef void (*revoke_result_handler_t)(errval_t, void*);
 void capops_revoke(struct domcapref cap,
                    revoke_result_handler_t result_handler,
                    void *st);
+void capops_revoke_multi(struct domcapref *caps, size_t count,
+                         revoke_result_handler_t result_handler,
+                         void *st);
+
+/// Progress counters of the revocation protocol on this monitor
+struct capops_revoke_stats {
+    uint64_t ops;           ///< completed revoke operations
+    uint64_t caps;          ///< caps revoked by these operations
+    uint64_t rounds;        ///< mark/commit rounds with other monitors
+    uint64_t remote_marks;  ///< caps marked for other monitors
+};
+void capops_revoke_get_stats(struct capops_revoke_stats *stats);
 
 typedef void (*retype_result_handler_t)(errval_t, void*);
 void capops_retype(enum objtype type, size_t objbits, struct capref croot,
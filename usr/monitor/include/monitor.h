@@ -188,6 +188,11 @@ void domain_mgmt_init(void);
 errval_t intermon_binding_set(struct intermon_state *st);
 errval_t intermon_binding_get(coreid_t coreid, struct intermon_binding **ret);
 
+/* nameservice_cache.c */
+errval_t ns_cache_init(void);
+errval_t ns_cache_get_frame(struct capref *frame);
+void ns_cache_lookup_call(struct monitor_blocking_binding *b, char *name);
+
 /* iref.c */
 errval_t iref_alloc(struct monitor_binding *binding, uintptr_t service_id,
                     iref_t *iref);
@@ -80,5 +80,9 @@ errval_t monitor_revoke_mark_target(struct capref croot,
 errval_t monitor_revoke_mark_relations(struct capability *cap);
 errval_t monitor_delete_step(struct capref ret_cap);
 errval_t monitor_clear_step(struct capref ret_cap);
+errval_t monitor_delete_steps(struct capref ret_caps, cslot_t nslots,
+                              uint64_t budget, size_t *ret_count);
+errval_t monitor_clear_steps(struct capref ret_caps, cslot_t nslots,
+                             uint64_t budget, size_t *ret_count);
 
 #endif
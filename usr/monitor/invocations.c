@@ -286,3 +286,30 @@ errval_t monitor_clear_step(struct capref ret_cap)
                                      get_cnode_valid_bits(ret_cap),
                                      ret_cap.slot);
 }
+
+/**
+ * \brief Perform delete steps in the kernel until the budget is spent
+ *
+ * Reclaimed RAM caps are returned in the slots following ret_caps; their
+ * number is returned in ret_count.
+ */
+errval_t monitor_delete_steps(struct capref ret_caps, cslot_t nslots,
+                              uint64_t budget, size_t *ret_count)
+{
+    return invoke_monitor_delete_steps(get_cnode_addr(ret_caps),
+                                       get_cnode_valid_bits(ret_caps),
+                                       ret_caps.slot, nslots, budget,
+                                       ret_count);
+}
+
+/**
+ * \brief Perform clear steps in the kernel until the budget is spent
+ */
+errval_t monitor_clear_steps(struct capref ret_caps, cslot_t nslots,
+                             uint64_t budget, size_t *ret_count)
+{
+    return invoke_monitor_clear_steps(get_cnode_addr(ret_caps),
+                                      get_cnode_valid_bits(ret_caps),
+                                      ret_caps.slot, nslots, budget,
+                                      ret_count);
+}
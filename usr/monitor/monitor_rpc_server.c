@@ -70,6 +70,50 @@ static void remote_cap_revoke(struct monitor_blocking_binding *b,
     capops_revoke(cap, revoke_reply_status, (void*)b);
 }
 
+static void revoke_multi_reply_status(errval_t status, void *st)
+{
+    struct monitor_blocking_binding *b = (struct monitor_blocking_binding*)st;
+    errval_t err = b->tx_vtbl.remote_cap_revoke_multi_response(b, NOP_CONT,
+                                                               status);
+    assert(err_is_ok(err));
+}
+
+static void remote_cap_revoke_multi(struct monitor_blocking_binding *b,
+                                    struct capref croot, uint8_t *caps,
+                                    size_t len)
+{
+    size_t count = len / sizeof(uint64_t);
+    struct domcapref *domcaps = calloc(count, sizeof(*domcaps));
+    if (count > 0 && !domcaps) {
+        free(caps);
+        revoke_multi_reply_status(LIB_ERR_MALLOC_FAIL, b);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t cap;
+        memcpy(&cap, caps + i * sizeof(cap), sizeof(cap));
+        domcaps[i].croot = croot;
+        domcaps[i].cptr = cap >> 8;
+        domcaps[i].bits = cap & 0xff;
+    }
+    free(caps);
+
+    capops_revoke_multi(domcaps, count, revoke_multi_reply_status, (void*)b);
+    free(domcaps);
+}
+
+static void revoke_stats(struct monitor_blocking_binding *b)
+{
+    struct capops_revoke_stats stats;
+    capops_revoke_get_stats(&stats);
+
+    errval_t err = b->tx_vtbl.revoke_stats_response(b, NOP_CONT, stats.ops,
+                                                    stats.caps, stats.rounds,
+                                                    stats.remote_marks);
+    assert(err_is_ok(err));
+}
+
 static void rsrc_manifest(struct monitor_blocking_binding *b,
                           struct capref dispcap, char *str)
 {
@@ -508,6 +552,27 @@ static void get_global_paddr(struct monitor_blocking_binding *b)
     }
 }
 
+static void get_nameservice_cache(struct monitor_blocking_binding *b)
+{
+    struct capref frame = NULL_CAP;
+    errval_t err, reterr;
+
+    reterr = ns_cache_get_frame(&frame);
+
+    err = b->tx_vtbl.get_nameservice_cache_response(b, NOP_CONT, reterr, frame);
+    if (err_is_fail(err)) {
+        if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            err = b->register_send(b, get_default_waitset(),
+                                   MKCONT((void (*)(void *))get_nameservice_cache, b));
+            if (err_is_ok(err)) {
+                return;
+            }
+        }
+
+        USER_PANIC_ERR(err, "sending get_nameservice_cache_response failed");
+    }
+}
+
 /*------------------------- Initialization functions -------------------------*/
 
 static struct monitor_blocking_rx_vtbl rx_vtbl = {
@@ -518,6 +583,8 @@ static struct monitor_blocking_rx_vtbl rx_vtbl = {
     .remote_cap_retype_call  = remote_cap_retype,
     .remote_cap_delete_call  = remote_cap_delete,
     .remote_cap_revoke_call  = remote_cap_revoke,
+    .remote_cap_revoke_multi_call = remote_cap_revoke_multi,
+    .revoke_stats_call       = revoke_stats,
 
     .rsrc_manifest_call      = rsrc_manifest,
     .rsrc_join_call          = rpc_rsrc_join,
@@ -537,6 +604,9 @@ static struct monitor_blocking_rx_vtbl rx_vtbl = {
     .forward_kcb_rm_request_call = forward_kcb_rm_request,
 
     .get_global_paddr_call = get_global_paddr,
+
+    .get_nameservice_cache_call = get_nameservice_cache,
+    .ns_cache_lookup_call = ns_cache_lookup_call,
 };
 
 static void export_callback(void *st, errval_t err, iref_t iref)
@@ -567,5 +637,11 @@ errval_t monitor_rpc_init(void)
 
     e.waitset = get_default_waitset();
 
+    errval_t err = ns_cache_init();
+    if (err_is_fail(err)) {
+        // domains on this core then always query octopus
+        DEBUG_ERR(err, "ns_cache_init failed");
+    }
+
     return idc_export_service(&e.common);
 }
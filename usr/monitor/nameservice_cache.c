@@ -0,0 +1,500 @@
+/**
+ * \file
+ * \brief Per-core name service cache
+ *
+ * The monitor keeps the name to IREF mappings that domains on this core
+ * look up in a frame they map read-only (see barrelfish/nameservice_cache.h).
+ * Domains probe the frame themselves and only ask the monitor on a miss.
+ *
+ * The monitor resolves misses over its own binding to octopus, with one
+ * query outstanding at a time: lookups for a name that is already being
+ * queried wait for that query instead of sending another. Every cached
+ * record is watched by a persistent trigger that octopus sends back on the
+ * same binding; a set updates the entry, a delete drops it and removes the
+ * trigger. The trigger of an evicted entry is removed as well. An entry may
+ * be stale until the trigger event for a change has arrived, as it would be
+ * for a domain that looked the name up just before the change.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include "monitor.h"
+#include <barrelfish/nameservice_cache.h>
+#include <if/octopus_defs.h>
+#include <octopus/getset.h> // for oct_read
+#include <octopus/definitions.h>
+
+/// Domain waiting for the result of a query
+struct ns_waiter {
+    struct ns_waiter *next;
+    struct monitor_blocking_binding *b;
+    errval_t err;
+    iref_t iref;
+};
+
+/// Request to octopus, queued until the previous one has been answered
+struct ns_request {
+    struct ns_request *next;
+    char *name;                 ///< Name to query, or NULL to remove tid
+    octopus_trigger_id_t tid;   ///< Trigger to remove
+    struct ns_waiter *waiters;
+};
+
+static struct capref cache_frame;
+static struct ns_cache *cache;
+
+/// Monitor-private state of each cache entry
+static struct {
+    octopus_trigger_id_t tid;   ///< Trigger watching the record, 0 if none
+    uint64_t filled;            ///< Fill clock at the last fill, for eviction
+} slots[NS_CACHE_ENTRIES];
+static uint64_t fill_clock;
+
+static enum {
+    OCT_UNBOUND,
+    OCT_BINDING,
+    OCT_BOUND,
+} oct_state;
+static struct octopus_binding *oct_binding;
+static bool oct_busy;   ///< A request has been sent and not yet answered
+
+static struct ns_request *queue_head, *queue_tail;
+
+/* ------------------------------ ENTRIES ------------------------------ */
+
+/// Sets an entry; name NULL keeps the name, iref 0 empties the entry
+static void entry_write(size_t slot, const char *name, iref_t iref)
+{
+    struct ns_cache_entry *e = &cache->entries[slot];
+
+    e->seq++;
+    __sync_synchronize();
+    if (iref == 0) {
+        memset(e->name, 0, NS_CACHE_NAME_LEN);
+    } else if (name != NULL) {
+        strncpy(e->name, name, NS_CACHE_NAME_LEN);
+    }
+    e->iref = iref;
+    __sync_synchronize();
+    e->seq++;
+}
+
+static bool find_trigger(octopus_trigger_id_t tid, size_t *ret_slot)
+{
+    for (size_t i = 0; i < NS_CACHE_ENTRIES; i++) {
+        if (slots[i].tid == tid) {
+            *ret_slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void queue_request(struct ns_request *r);
+
+static void remove_trigger(octopus_trigger_id_t tid)
+{
+    struct ns_request *r = malloc(sizeof(*r));
+    if (r == NULL) {
+        // the trigger stays installed and its events are ignored
+        DEBUG_ERR(LIB_ERR_MALLOC_FAIL, "ns_cache: cannot remove trigger");
+        return;
+    }
+    r->name = NULL;
+    r->tid = tid;
+    r->waiters = NULL;
+    queue_request(r);
+}
+
+/**
+ * \brief Enters a query result, watched by trigger tid, into the cache
+ *
+ * Takes an empty entry in the probe window of name or else evicts the one
+ * filled longest ago.
+ */
+static void cache_fill(const char *name, iref_t iref, octopus_trigger_id_t tid)
+{
+    size_t first = ns_cache_hash(name);
+    size_t slot = NS_CACHE_ENTRIES;
+    bool empty = false;
+
+    for (int i = 0; i < NS_CACHE_PROBE; i++) {
+        size_t s = (first + i) % NS_CACHE_ENTRIES;
+        struct ns_cache_entry *e = &cache->entries[s];
+        if (e->iref != 0 && strncmp(e->name, name, NS_CACHE_NAME_LEN) == 0) {
+            // already cached through an earlier query
+            if (tid != 0) {
+                remove_trigger(tid);
+            }
+            entry_write(s, name, iref);
+            return;
+        }
+        if (e->iref == 0 && !empty) {
+            slot = s;
+            empty = true;
+        } else if (!empty && (slot == NS_CACHE_ENTRIES
+                              || slots[s].filled < slots[slot].filled)) {
+            slot = s;
+        }
+    }
+
+    if (!empty) {
+        cache->counters.evictions++;
+    }
+    if (slots[slot].tid != 0) {
+        remove_trigger(slots[slot].tid);
+    }
+
+    slots[slot].tid = tid;
+    slots[slot].filled = ++fill_clock;
+    entry_write(slot, name, iref);
+    cache->counters.fills++;
+}
+
+/* ------------------------------ REPLIES ------------------------------ */
+
+static void lookup_reply_cont(void *arg)
+{
+    struct ns_waiter *w = arg;
+    struct monitor_blocking_binding *b = w->b;
+
+    errval_t err = b->tx_vtbl.ns_cache_lookup_response(b, NOP_CONT, w->err,
+                                                       w->iref);
+    if (err_is_ok(err)) {
+        free(w);
+    } else if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+        err = b->register_send(b, get_default_waitset(),
+                               MKCONT(lookup_reply_cont, w));
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "register_send failed");
+        }
+    } else {
+        USER_PANIC_ERR(err, "sending ns_cache_lookup_response failed");
+    }
+}
+
+/// Replies to w, which is freed once the reply has been sent
+static void lookup_reply(struct ns_waiter *w, errval_t err, iref_t iref)
+{
+    w->err = err;
+    w->iref = iref;
+    lookup_reply_cont(w);
+}
+
+static void reply_all(struct ns_request *r, errval_t err, iref_t iref)
+{
+    struct ns_waiter *next;
+    for (struct ns_waiter *w = r->waiters; w != NULL; w = next) {
+        next = w->next;
+        lookup_reply(w, err, iref);
+    }
+    r->waiters = NULL;
+}
+
+static struct ns_request *dequeue(void)
+{
+    struct ns_request *r = queue_head;
+    assert(r != NULL);
+    queue_head = r->next;
+    if (queue_head == NULL) {
+        queue_tail = NULL;
+    }
+    oct_busy = false;
+    return r;
+}
+
+static void free_request(struct ns_request *r)
+{
+    free(r->name);
+    free(r);
+}
+
+/* ------------------------------ OCTOPUS ------------------------------ */
+
+static void send_next(void *arg)
+{
+    struct ns_request *r = queue_head;
+    if (oct_state != OCT_BOUND || oct_busy || r == NULL) {
+        return;
+    }
+
+    errval_t err;
+    if (r->name != NULL) {
+        octopus_trigger_t t = {
+            .in_case = SYS_ERR_OK,
+            .send_to = octopus_BINDING_RPC,
+            .m = OCT_ON_SET | OCT_ON_DEL | OCT_PERSIST,
+        };
+        err = oct_binding->tx_vtbl.get_call(oct_binding, NOP_CONT, r->name, t);
+        if (err_is_ok(err)) {
+            cache->counters.queries++;
+        }
+    } else {
+        err = oct_binding->tx_vtbl.remove_trigger_call(oct_binding, NOP_CONT,
+                                                       r->tid);
+    }
+
+    if (err_is_ok(err)) {
+        oct_busy = true;
+    } else if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+        err = oct_binding->register_send(oct_binding, get_default_waitset(),
+                                         MKCONT(send_next, NULL));
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "register_send failed");
+        }
+    } else {
+        USER_PANIC_ERR(err, "ns_cache: sending request to octopus failed");
+    }
+}
+
+static void get_response(struct octopus_binding *b, char *record,
+                         octopus_trigger_id_t tid, errval_t error_code)
+{
+    struct ns_request *r = dequeue();
+    assert(r->name != NULL);
+
+    errval_t err = error_code;
+    uint64_t iref_number = 0;
+    if (err_is_ok(err)) {
+        err = oct_read(record, "_ { iref: %d }", &iref_number);
+        if (err_is_fail(err) || iref_number == 0) {
+            err = err_push(err, LIB_ERR_NAMESERVICE_INVALID_NAME);
+        }
+    } else if (err_no(err) == OCT_ERR_NO_RECORD) {
+        err = err_push(err, LIB_ERR_NAMESERVICE_UNKNOWN_NAME);
+    }
+
+    if (err_is_ok(err) && tid != 0) {
+        // only cache what we will hear about changes of
+        cache_fill(r->name, iref_number, tid);
+    } else if (tid != 0) {
+        remove_trigger(tid);
+    }
+
+    reply_all(r, err, err_is_ok(err) ? iref_number : 0);
+    free_request(r);
+    free(record);
+
+    send_next(NULL);
+}
+
+static void remove_trigger_response(struct octopus_binding *b,
+                                    errval_t error_code)
+{
+    struct ns_request *r = dequeue();
+    assert(r->name == NULL);
+    if (err_is_fail(error_code)) {
+        DEBUG_ERR(error_code, "ns_cache: remove_trigger");
+    }
+    free_request(r);
+
+    send_next(NULL);
+}
+
+static void trigger_event(struct octopus_binding *b, octopus_trigger_id_t tid,
+                          uint64_t fn, octopus_mode_t mode, char *record,
+                          uint64_t state)
+{
+    size_t slot;
+    if ((mode & OCT_REMOVED) || !find_trigger(tid, &slot)) {
+        // removed with an evicted or deleted entry
+        goto out;
+    }
+
+    uint64_t iref_number = 0;
+    if ((mode & OCT_ON_SET) && record != NULL
+        && err_is_ok(oct_read(record, "_ { iref: %d }", &iref_number))
+        && iref_number != 0) {
+        entry_write(slot, NULL, iref_number);
+        cache->counters.updates++;
+    } else {
+        entry_write(slot, NULL, 0);
+        slots[slot].tid = 0;
+        remove_trigger(tid);
+        cache->counters.invalidations++;
+    }
+
+out:
+    free(record);
+}
+
+/// Fails the queued lookups; later ones try to bind again
+static void fail_queue(errval_t err)
+{
+    oct_state = OCT_UNBOUND;
+    while (queue_head != NULL) {
+        struct ns_request *r = dequeue();
+        reply_all(r, err, 0);
+        free_request(r);
+    }
+}
+
+/**
+ * \brief Drops the binding to octopus after an error on it
+ *
+ * The triggers of the cached records went away with the binding, so the
+ * entries are cleared rather than left to go stale. Domains then miss in the
+ * cache and the next lookup binds again.
+ */
+static void oct_error_handler(struct octopus_binding *b, errval_t err)
+{
+    DEBUG_ERR(err, "ns_cache: asynchronous error in octopus binding");
+    if (b != oct_binding) {
+        return;
+    }
+
+    oct_binding = NULL;
+    fail_queue(err_push(err, LIB_ERR_NAMESERVICE_NOT_BOUND));
+
+    for (size_t i = 0; i < NS_CACHE_ENTRIES; i++) {
+        if (cache->entries[i].iref != 0) {
+            entry_write(i, NULL, 0);
+            cache->counters.invalidations++;
+        }
+        slots[i].tid = 0;
+    }
+}
+
+static void bind_cb(void *st, errval_t err, struct octopus_binding *b)
+{
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "ns_cache: octopus_bind");
+        fail_queue(err);
+        return;
+    }
+
+    b->error_handler = oct_error_handler;
+    b->rx_vtbl.get_response = get_response;
+    b->rx_vtbl.remove_trigger_response = remove_trigger_response;
+    b->rx_vtbl.trigger = trigger_event;
+
+    oct_binding = b;
+    oct_state = OCT_BOUND;
+    send_next(NULL);
+}
+
+static void queue_request(struct ns_request *r)
+{
+    r->next = NULL;
+    if (queue_tail == NULL) {
+        queue_head = r;
+    } else {
+        queue_tail->next = r;
+    }
+    queue_tail = r;
+
+    send_next(NULL);
+}
+
+/* ------------------------------ REQUESTS ------------------------------ */
+
+/**
+ * \brief Handles a lookup of a domain that missed in the cache
+ *
+ * Replies from the cache if the entry has been filled in the meantime,
+ * otherwise waits for the query of name, sending one if there is none yet.
+ */
+void ns_cache_lookup_call(struct monitor_blocking_binding *b, char *name)
+{
+    errval_t err;
+    iref_t iref = 0;
+
+    struct ns_waiter *w = malloc(sizeof(*w));
+    if (w == NULL) {
+        USER_PANIC("ns_cache: out of memory\n");
+    }
+    w->b = b;
+    w->next = NULL;
+
+    if (cache == NULL || !ns_cache_name_ok(name)) {
+        err = LIB_ERR_NAMESERVICE_NOT_CACHEABLE;
+        goto reply;
+    }
+    cache->counters.lookups++;
+
+    if (ns_cache_probe(cache, name, &iref)) {
+        err = SYS_ERR_OK;
+        goto reply;
+    }
+
+    for (struct ns_request *r = queue_head; r != NULL; r = r->next) {
+        if (r->name != NULL && strcmp(r->name, name) == 0) {
+            w->next = r->waiters;
+            r->waiters = w;
+            cache->counters.coalesced++;
+            free(name);
+            return;
+        }
+    }
+
+    if (oct_state == OCT_UNBOUND) {
+        if (name_serv_iref == 0) {
+            err = LIB_ERR_NAMESERVICE_NOT_BOUND;
+            goto reply;
+        }
+        err = octopus_bind(name_serv_iref, bind_cb, NULL,
+                           get_default_waitset(), IDC_BIND_FLAGS_DEFAULT);
+        if (err_is_fail(err)) {
+            goto reply;
+        }
+        oct_state = OCT_BINDING;
+    }
+
+    struct ns_request *r = malloc(sizeof(*r));
+    if (r == NULL) {
+        err = LIB_ERR_MALLOC_FAIL;
+        goto reply;
+    }
+    r->name = name;
+    r->tid = 0;
+    r->waiters = w;
+    queue_request(r);
+    return;
+
+reply:
+    free(name);
+    lookup_reply(w, err, iref);
+}
+
+/**
+ * \brief Returns the frame holding the cache
+ */
+errval_t ns_cache_get_frame(struct capref *frame)
+{
+    if (cache == NULL) {
+        return LIB_ERR_NAMESERVICE_NOT_CACHEABLE;
+    }
+    *frame = cache_frame;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Allocates and maps the cache
+ */
+errval_t ns_cache_init(void)
+{
+    errval_t err;
+
+    err = frame_alloc(&cache_frame, NS_CACHE_SIZE, NULL);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    void *buf;
+    err = vspace_map_one_frame(&buf, NS_CACHE_SIZE, cache_frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(cache_frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    memset(buf, 0, NS_CACHE_SIZE);
+    cache = buf;
+    return SYS_ERR_OK;
+}
@@ -0,0 +1,332 @@
+/**
+ * \file
+ * \brief Page cache daemon.
+ *
+ * Keeps pages of files in frames and hands out copies of the frame
+ * capabilities, so that all domains mapping a file share the frames holding
+ * its pages (see lib/vfs/vfs_pagecache.c). Files are named by their path in
+ * the root file system, which is the same in all domains.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/waitset.h>
+#include <vfs/vfs.h>
+
+#include "pagecached.h"
+
+struct cached_page {
+    struct capref frame;    ///< frame holding the page, if valid
+    genpaddr_t offset;      ///< offset of the page within frame
+    bool valid;
+};
+
+struct cached_frame {
+    struct capref cap;
+    struct cached_frame *next;
+};
+
+struct cached_file {
+    struct cached_file *next;
+    char *path;
+    vfs_handle_t vh;
+    size_t npages;
+    struct cached_page *pages;
+    struct cached_frame *frames;    ///< all frames holding pages of the file
+};
+
+static struct cached_file *files;
+
+static struct cached_file *file_lookup(const char *path)
+{
+    for (struct cached_file *f = files; f != NULL; f = f->next) {
+        if (strcmp(f->path, path) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+/// Update the number of pages of a file to its current size
+static errval_t file_resize(struct cached_file *f)
+{
+    struct vfs_fileinfo info;
+    errval_t err;
+
+    err = vfs_stat(f->vh, &info);
+    if (err_is_fail(err)) {
+        return err;
+    }
+    if (info.type != VFS_FILE) {
+        return FS_ERR_NOTFILE;
+    }
+
+    size_t npages = DIVIDE_ROUND_UP(info.size, BASE_PAGE_SIZE);
+    if (npages > f->npages || f->pages == NULL) {
+        struct cached_page *pages =
+            realloc(f->pages, (npages > 0 ? npages : 1) * sizeof(*pages));
+        if (pages == NULL) {
+            return LIB_ERR_MALLOC_FAIL;
+        }
+        memset(&pages[f->npages], 0, (npages - f->npages) * sizeof(*pages));
+        f->pages = pages;
+    }
+    f->npages = npages;
+
+    return SYS_ERR_OK;
+}
+
+static errval_t file_open(const char *path, struct cached_file **ret)
+{
+    errval_t err;
+
+    struct cached_file *f = file_lookup(path);
+    if (f != NULL) {
+        *ret = f;
+        return SYS_ERR_OK;
+    }
+
+    f = calloc(1, sizeof(struct cached_file));
+    if (f == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    f->path = strdup(path);
+    if (f->path == NULL) {
+        free(f);
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    err = vfs_open(path, &f->vh);
+    if (err_is_fail(err)) {
+        goto fail;
+    }
+
+    err = file_resize(f);
+    if (err_is_fail(err)) {
+        vfs_close(f->vh);
+        goto fail;
+    }
+
+    f->next = files;
+    files = f;
+    *ret = f;
+    return SYS_ERR_OK;
+
+fail:
+    free(f->pages);
+    free(f->path);
+    free(f);
+    return err;
+}
+
+/// Read count pages from first on into a new frame
+static errval_t fill_pages(struct cached_file *f, size_t first, size_t count)
+{
+    errval_t err, err2;
+    struct capref frame;
+    size_t framesize;
+    void *buf;
+
+    struct cached_frame *cf = malloc(sizeof(struct cached_frame));
+    if (cf == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    err = frame_alloc(&frame, count * BASE_PAGE_SIZE, &framesize);
+    if (err_is_fail(err)) {
+        free(cf);
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    err = vspace_map_one_frame(&buf, framesize, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        free(cf);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    size_t pos = 0, nbytes = count * BASE_PAGE_SIZE;
+    err = vfs_seek(f->vh, VFS_SEEK_SET, first * BASE_PAGE_SIZE);
+    while (err_is_ok(err) && pos < nbytes) {
+        size_t rsize;
+        err = vfs_read(f->vh, (char *)buf + pos, nbytes - pos, &rsize);
+        if (err_no(err) == VFS_ERR_EOF) {
+            err = SYS_ERR_OK;
+            break;
+        } else if (err_is_fail(err) || rsize == 0) {
+            break;
+        }
+        pos += rsize;
+    }
+
+    // the rest of the last page is past the end of the file
+    memset((char *)buf + pos, 0, nbytes - pos);
+
+    err2 = vspace_unmap(buf);
+    assert(err_is_ok(err2));
+
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        free(cf);
+        return err;
+    }
+
+    cf->cap = frame;
+    cf->next = f->frames;
+    f->frames = cf;
+
+    for (size_t i = 0; i < count; i++) {
+        struct cached_page *p = &f->pages[first + i];
+        p->frame = frame;
+        p->offset = i * BASE_PAGE_SIZE;
+        p->valid = true;
+    }
+
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Get the frame holding a page of a file
+ *
+ * \param path       Absolute path of the file
+ * \param first      Page number within the file
+ * \param count      Number of pages wanted from first on, read if the first
+ *                   is not cached
+ * \param ret_frame  Returns the frame holding page first, owned by the cache
+ * \param ret_offset Returns the offset of page first within the frame
+ * \param ret_npages Returns the number of pages, at most count, held by the
+ *                   frame from ret_offset on
+ */
+errval_t cache_get_pages(const char *path, size_t first, size_t count,
+                         struct capref *ret_frame, genpaddr_t *ret_offset,
+                         size_t *ret_npages)
+{
+    struct cached_file *f;
+    errval_t err;
+
+    err = file_open(path, &f);
+    if (err_is_fail(err)) {
+        return err;
+    }
+
+    if (first >= f->npages) {
+        return LIB_ERR_MEMOBJ_WRONG_OFFSET;
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    struct cached_page *pages = f->pages;
+    if (!pages[first].valid) {
+        // read up to the next cached page or the end of the file
+        size_t n = 1;
+        while (n < count && first + n < f->npages && !pages[first + n].valid) {
+            n++;
+        }
+
+        err = fill_pages(f, first, n);
+        if (err_is_fail(err)) {
+            return err;
+        }
+    }
+
+    size_t n = 1;
+    while (n < count && first + n < f->npages && pages[first + n].valid
+           && capcmp(pages[first + n].frame, pages[first].frame)
+           && pages[first + n].offset == pages[first].offset
+                                         + n * BASE_PAGE_SIZE) {
+        n++;
+    }
+
+    *ret_frame = pages[first].frame;
+    *ret_offset = pages[first].offset;
+    *ret_npages = n;
+    return SYS_ERR_OK;
+}
+
+/**
+ * \brief Drop the cached pages holding bytes start to end of a file
+ *
+ * \param path  Absolute path of the file
+ * \param start First byte changed
+ * \param end   End of the change, SIZE_MAX for the rest of the file
+ *
+ * \returns true if pages of the file were cached
+ *
+ * Frames no longer holding any page are freed. Clients keep their copies
+ * of the capabilities, and so the memory, until they drop the pages.
+ */
+bool cache_file_changed(const char *path, size_t start, size_t end)
+{
+    struct cached_file *f = file_lookup(path);
+    if (f == NULL) {
+        return false;
+    }
+
+    size_t first = start / BASE_PAGE_SIZE;
+    size_t last = end == SIZE_MAX ? SIZE_MAX
+                                  : DIVIDE_ROUND_UP(end, BASE_PAGE_SIZE);
+    for (size_t page = first; page < last && page < f->npages; page++) {
+        f->pages[page].valid = false;
+    }
+
+    errval_t err = file_resize(f);
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "updating size of %s", path);
+    }
+
+    struct cached_frame **p = &f->frames;
+    while (*p != NULL) {
+        struct cached_frame *cf = *p;
+        bool used = false;
+        for (size_t page = 0; page < f->npages && !used; page++) {
+            used = f->pages[page].valid && capcmp(f->pages[page].frame, cf->cap);
+        }
+        if (used) {
+            p = &cf->next;
+            continue;
+        }
+
+        *p = cf->next;
+        err = cap_destroy(cf->cap);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "freeing page cache frame");
+        }
+        free(cf);
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    errval_t err;
+
+    // the root file system, shared with the clients
+    vfs_init();
+
+    err = start_service();
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "failed to start page cache service");
+    }
+
+    for (;;) {
+        err = event_dispatch(get_default_waitset());
+        if (err_is_fail(err)) {
+            USER_PANIC_ERR(err, "event_dispatch");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#ifndef PAGECACHED_H
+#define PAGECACHED_H
+
+#include <barrelfish/barrelfish.h>
+
+#define SERVICE_NAME    "pagecache"
+
+errval_t start_service(void);
+
+errval_t cache_get_pages(const char *path, size_t first, size_t count,
+                         struct capref *ret_frame, genpaddr_t *ret_offset,
+                         size_t *ret_npages);
+bool cache_file_changed(const char *path, size_t start, size_t end);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * \file
+ * \brief Page cache service.
+ *
+ * Clients call get_pages and file_changed on one binding, and receive
+ * invalidate messages for the changes of other clients on a second, event
+ * binding, which they announce with subscribe.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <if/pagecache_defs.h>
+
+#include "pagecached.h"
+
+/// A change not yet sent to a subscriber
+struct invalidation {
+    struct invalidation *next;
+    char *path;
+    uint64_t start, end;
+    bool truncated;
+};
+
+/// State of a binding, which is a subscriber if id is not 0
+struct pagecache_state {
+    uint64_t id;
+    struct pagecache_binding *b;
+    struct invalidation *head, *tail;   ///< head is being sent
+    struct pagecache_state *next;       ///< next subscriber
+};
+
+static struct pagecache_state *subscribers;
+static uint64_t next_id = 1;
+
+static void send_invalidation(void *arg);
+
+static void invalidation_sent(void *arg)
+{
+    struct pagecache_state *st = arg;
+    struct invalidation *inv = st->head;
+
+    st->head = inv->next;
+    if (st->head == NULL) {
+        st->tail = NULL;
+    }
+    free(inv->path);
+    free(inv);
+
+    if (st->head != NULL) {
+        send_invalidation(st);
+    }
+}
+
+static void send_invalidation(void *arg)
+{
+    struct pagecache_state *st = arg;
+    struct pagecache_binding *b = st->b;
+    struct invalidation *inv = st->head;
+    errval_t err;
+
+    err = b->tx_vtbl.invalidate(b, MKCONT(invalidation_sent, st), inv->path,
+                                inv->start, inv->end, inv->truncated);
+    if (err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+        err = b->register_send(b, get_default_waitset(),
+                               MKCONT(send_invalidation, st));
+    }
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "sending invalidate");
+    }
+}
+
+static void queue_invalidation(struct pagecache_state *st, const char *path,
+                               uint64_t start, uint64_t end, bool truncated)
+{
+    struct invalidation *inv = malloc(sizeof(struct invalidation));
+    assert(inv != NULL);
+    inv->path = strdup(path);
+    assert(inv->path != NULL);
+    inv->start = start;
+    inv->end = end;
+    inv->truncated = truncated;
+    inv->next = NULL;
+
+    if (st->tail == NULL) {
+        st->head = st->tail = inv;
+        send_invalidation(st);
+    } else {
+        st->tail->next = inv;
+        st->tail = inv;
+    }
+}
+
+static void get_pages_handler(struct pagecache_binding *b, char *path,
+                              uint64_t first, uint64_t count)
+{
+    struct capref frame = NULL_CAP;
+    genpaddr_t offset = 0;
+    size_t npages = 0;
+    errval_t err, reterr;
+
+    reterr = cache_get_pages(path, first, count, &frame, &offset, &npages);
+    free(path);
+
+    err = b->tx_vtbl.get_pages_response(b, NOP_CONT, reterr, frame, offset,
+                                        npages);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "get_pages_response");
+    }
+}
+
+static void subscribe_handler(struct pagecache_binding *b)
+{
+    struct pagecache_state *st = b->st;
+    errval_t err;
+
+    if (st->id == 0) {
+        st->id = next_id++;
+        st->next = subscribers;
+        subscribers = st;
+    }
+
+    err = b->tx_vtbl.subscribe_response(b, NOP_CONT, st->id);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "subscribe_response");
+    }
+}
+
+static void file_changed_handler(struct pagecache_binding *b, uint64_t id,
+                                 char *path, uint64_t start, uint64_t end,
+                                 bool truncated)
+{
+    errval_t err;
+
+    // only clients that got pages of the file can have them cached
+    if (cache_file_changed(path, start, end)) {
+        for (struct pagecache_state *st = subscribers; st != NULL;
+             st = st->next) {
+            if (st->id != id) {
+                queue_invalidation(st, path, start, end, truncated);
+            }
+        }
+    }
+    free(path);
+
+    err = b->tx_vtbl.file_changed_response(b, NOP_CONT);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "file_changed_response");
+    }
+}
+
+static struct pagecache_rx_vtbl rx_vtbl = {
+    .get_pages_call = get_pages_handler,
+    .subscribe_call = subscribe_handler,
+    .file_changed_call = file_changed_handler,
+};
+
+static void export_cb(void *st, errval_t err, iref_t iref)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "export failed");
+    }
+
+    // register this iref with the name service
+    err = nameservice_register(SERVICE_NAME, iref);
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "nameservice_register failed");
+    }
+}
+
+static errval_t connect_cb(void *st, struct pagecache_binding *b)
+{
+    struct pagecache_state *pst = calloc(1, sizeof(struct pagecache_state));
+    if (pst == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+    pst->b = b;
+
+    // copy my message receive handler vtable to the binding
+    b->rx_vtbl = rx_vtbl;
+    b->st = pst;
+
+    return SYS_ERR_OK;
+}
+
+errval_t start_service(void)
+{
+    return pagecache_export(NULL, export_cb, connect_cb, get_default_waitset(),
+                            IDC_EXPORT_FLAGS_DEFAULT);
+}
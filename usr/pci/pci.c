@@ -735,10 +735,10 @@ static void assign_bus_numbers(struct pci_address parentaddr,
                 bcfg.sub_bus = 0xff;
                 pci_hdr1_bcfg_wr(&bhdr, bcfg);
 
-                skb_add_fact("bridge(%s,addr(%u,%u,%u),%u,%u,%u,%u,%u, secondary(%hhu)).",
-                             (pcie ? "pcie" : "pci"), addr.bus, addr.device,
-                             addr.function, vendor, device_id, classcode.clss,
-                             classcode.subclss, classcode.prog_if, *busnum);
+                skb_add_fact_batched("bridge(%s,addr(%u,%u,%u),%u,%u,%u,%u,%u, secondary(%hhu)).",
+                                     (pcie ? "pcie" : "pci"), addr.bus, addr.device,
+                                     addr.function, vendor, device_id, classcode.clss,
+                                     classcode.subclss, classcode.prog_if, *busnum);
 
                 //use the original hdr (pci_hdr0_t) here
                 query_bars(hdr, addr, true);
@@ -770,11 +770,11 @@ static void assign_bus_numbers(struct pci_address parentaddr,
 
                 pci_hdr0_t devhdr;
                 pci_hdr0_initialize(&devhdr, addr);
-                skb_add_fact("device(%s,addr(%u,%u,%u),%u,%u,%u, %u, %u, %d).",
-                             (pcie ? "pcie" : "pci"), addr.bus, addr.device,
-                             addr.function, vendor, device_id, classcode.clss,
-                             classcode.subclss, classcode.prog_if,
-                             pci_hdr0_int_pin_rd(&devhdr) - 1);
+                skb_add_fact_batched("device(%s,addr(%u,%u,%u),%u,%u,%u, %u, %u, %d).",
+                                     (pcie ? "pcie" : "pci"), addr.bus, addr.device,
+                                     addr.function, vendor, device_id, classcode.clss,
+                                     classcode.subclss, classcode.prog_if,
+                                     pci_hdr0_int_pin_rd(&devhdr) - 1);
 
                 // octopus start
                 char* record = NULL;
@@ -948,14 +948,14 @@ static void assign_bus_numbers(struct pci_address parentaddr,
                                                   vf_addr.bus, vf_addr.device,
                                                   vf_addr.function);
 
-                                        skb_add_fact("device(%s,addr(%u,%u,%u),%u,%u,%u, %u, %u, %d).",
-                                                     (pcie ? "pcie" : "pci"),
-                                                     vf_addr.bus,
-                                                     vf_addr.device,
-                                                     vf_addr.function, vendor,
-                                                     vf_devid, classcode.clss,
-                                                     classcode.subclss,
-                                                     classcode.prog_if, 0);
+                                        skb_add_fact_batched("device(%s,addr(%u,%u,%u),%u,%u,%u, %u, %u, %d).",
+                                                             (pcie ? "pcie" : "pci"),
+                                                             vf_addr.bus,
+                                                             vf_addr.device,
+                                                             vf_addr.function, vendor,
+                                                             vf_devid, classcode.clss,
+                                                             classcode.subclss,
+                                                             classcode.prog_if, 0);
 
                                         // octopus start
                                         device_fmt ="hw.pci.device. { "
@@ -1053,13 +1053,13 @@ static void assign_bus_numbers(struct pci_address parentaddr,
                                                           bar_mapping_size64(base64),
                                                           (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"));
 
-                                                skb_add_fact("bar(addr(%u, %u, %u), %d, 16'%"
-                                                             PRIxPCIADDR", ""16'%" PRIx64 ", vf, %s, %d).",
-                                                             vf_addr.bus, vf_addr.device, vf_addr.function, i,
-                                                             (origbase64 << 7) + bar_mapping_size64(base64) * vfn,
-                                                             bar_mapping_size64(base64),
-                                                             (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
-                                                             type);
+                                                skb_add_fact_batched("bar(addr(%u, %u, %u), %d, 16'%"
+                                                                     PRIxPCIADDR", ""16'%" PRIx64 ", vf, %s, %d).",
+                                                                     vf_addr.bus, vf_addr.device, vf_addr.function, i,
+                                                                     (origbase64 << 7) + bar_mapping_size64(base64) * vfn,
+                                                                     bar_mapping_size64(base64),
+                                                                     (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
+                                                                     type);
 
                                                 i++;  //step one forward, because it is a 64bit BAR
                                             } else {
@@ -1070,14 +1070,14 @@ static void assign_bus_numbers(struct pci_address parentaddr,
                                                           (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"));
 
                                                 //32bit BAR
-                                                skb_add_fact("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%"
-                                                             PRIx32 ", vf, %s, %d).", vf_addr.bus,
-                                                             vf_addr.device, vf_addr.function, i,
-                                                             (uint32_t) ((barorigaddr.base << 7)
+                                                skb_add_fact_batched("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%"
+                                                                     PRIx32 ", vf, %s, %d).", vf_addr.bus,
+                                                                     vf_addr.device, vf_addr.function, i,
+                                                                     (uint32_t) ((barorigaddr.base << 7)
                                                                          + bar_mapping_size( bar) * vfn),
-                                                             (uint32_t) bar_mapping_size(bar),
-                                                             (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
-                                                             type);
+                                                                     (uint32_t) bar_mapping_size(bar),
+                                                                     (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
+                                                                     type);
                                             }
                                         }
                                     }
@@ -1159,6 +1159,11 @@ void pci_add_root(struct pci_address addr,
     /* get_bridges(addr); */
     assign_bus_numbers(addr, &busnum, maxchild, handle);
     /* get_bridges(addr); */
+
+    errval_t err = skb_flush_facts();
+    if (err_is_fail(err)) {
+        DEBUG_ERR(err, "adding PCI facts to the SKB");
+    }
 }
 
 errval_t pci_setup_root_complex(void)
@@ -1305,12 +1310,12 @@ static void query_bars(pci_hdr0_t devhdr,
 			i, origbase64 << 7, bar_mapping_size64(base64),
 			(bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"));
 
-                skb_add_fact("bar(addr(%u, %u, %u), %d, 16'%"PRIxPCIADDR", "
-                             "16'%" PRIx64 ", mem, %s, %d).", addr.bus,
-                             addr.device, addr.function, i, origbase64,
-                             bar_mapping_size64(base64),
-                             (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
-                             type);
+                skb_add_fact_batched("bar(addr(%u, %u, %u), %d, 16'%"PRIxPCIADDR", "
+                                     "16'%" PRIx64 ", mem, %s, %d).", addr.bus,
+                                     addr.device, addr.function, i, origbase64,
+                                     bar_mapping_size64(base64),
+                                     (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
+                                     type);
 
                 i++;  //step one forward, because it is a 64bit BAR
             } else {
@@ -1320,12 +1325,12 @@ static void query_bars(pci_hdr0_t devhdr,
 			(bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"));
 
                 //32bit BAR
-                skb_add_fact("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%" PRIx32
-                             ", mem, %s, %d).", addr.bus, addr.device, addr.function,
-                             i, (uint32_t) (barorigaddr.base << 7),
-                             (uint32_t) bar_mapping_size(bar),
-                             (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
-                             type);
+                skb_add_fact_batched("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%" PRIx32
+                                     ", mem, %s, %d).", addr.bus, addr.device, addr.function,
+                                     i, (uint32_t) (barorigaddr.base << 7),
+                                     (uint32_t) bar_mapping_size(bar),
+                                     (bar.prefetch == 1 ? "prefetchable" : "nonprefetchable"),
+                                     type);
             }
         } else {
 	  PCI_DEBUG("(%u,%u,%u): IO BAR %d at 0x%x, size %x\n",
@@ -1333,9 +1338,9 @@ static void query_bars(pci_hdr0_t devhdr,
 		    i, barorigaddr.base << 7, bar_mapping_size(bar));
             //bar(addr(bus, device, function), barnr, orig address, size, space).
             //where space = mem | io
-            skb_add_fact("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%" PRIx32 ", io, "
-                         "nonprefetchable, 32).", addr.bus, addr.device, addr.function, i,
-                         (uint32_t) (barorigaddr.base << 7), (uint32_t) bar_mapping_size(bar));
+            skb_add_fact_batched("bar(addr(%u, %u, %u), %d, 16'%"PRIx32", 16'%" PRIx32 ", io, "
+                                 "nonprefetchable, 32).", addr.bus, addr.device, addr.function, i,
+                                 (uint32_t) (barorigaddr.base << 7), (uint32_t) bar_mapping_size(bar));
         }
     }
 }
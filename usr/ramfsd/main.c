@@ -243,17 +243,13 @@ static errval_t write_file(struct dirent *root, const char *path, uint8_t *data,
         return err;
     }
 
-    // allocate storage
-    uint8_t *buf;
-    err = ramfs_grow(f, 0, len, &buf);
+    // copy the payload
+    err = ramfs_write(f, 0, data, len);
     if (err_is_fail(err)) {
         ramfs_delete(f);
         return err;
     }
 
-    // copy the payload
-    memcpy(buf, data, len);
-
     return SYS_ERR_OK;
 }
 
@@ -264,20 +260,14 @@ static errval_t append_to_file(struct dirent *f, const char *str)
     size_t len = strlen(str);
     errval_t err;
 
-    // allocate storage
-    uint8_t *buf;
-    err = ramfs_grow(f, pos, len + 1, &buf);
+    // copy the payload
+    err = ramfs_write(f, pos, str, len);
     if (err_is_fail(err)) {
         return err;
     }
 
-    // copy the payload
-    memcpy(buf, str, len);
-
     // terminate with a \n
-    buf[len] = '\n';
-
-    return SYS_ERR_OK;
+    return ramfs_write(f, pos + len, "\n", 1);
 }
 
 // try to remove the 'irrelevant' prefix of a multiboot path
@@ -15,9 +15,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <barrelfish/barrelfish.h>
+#include <barrelfish/slab.h>
 #include <if/trivfs_defs.h>
 #include "ramfs.h"
 
+/// File data is stored in page-sized extents, allocated from this slab
+#define RAMFS_PAGE_BITS     BASE_PAGE_BITS
+#define RAMFS_PAGE_SIZE     (1UL << RAMFS_PAGE_BITS)
+#define RAMFS_PAGE_MASK     (RAMFS_PAGE_SIZE - 1)
+
+/// Number of data pages to allocate from the memory server at once
+#define RAMFS_REFILL_PAGES  64
+
 struct dirent {
     struct dirent *next;   ///< next entry in same directory
     struct dirent **prevp; ///< locn where the preceding child / parent links us
@@ -28,8 +37,9 @@ struct dirent {
     unsigned refcount;  ///< outstanding references (handles and/or ongoing IDCs)
     union {
         struct {
-            uint8_t *data;  ///< on heap
-            size_t size;    ///< size of data
+            uint8_t **pages; ///< page table; NULL entries are holes
+            size_t npages;   ///< allocated length of page table
+            size_t size;     ///< size of data
         } file;
         struct {
             struct dirent *entries; ///< children of this dir
@@ -38,8 +48,85 @@ struct dirent {
     } u;
 };
 
+static struct slab_allocator page_slabs;
+
+static errval_t page_slabs_refill(struct slab_allocator *slabs)
+{
+    errval_t err;
+    struct capref frame;
+    size_t bytes = SLAB_STATIC_SIZE(RAMFS_REFILL_PAGES, RAMFS_PAGE_SIZE);
+
+    err = frame_alloc(&frame, bytes, &bytes);
+    if (err_is_fail(err)) {
+        return err_push(err, LIB_ERR_FRAME_ALLOC);
+    }
+
+    void *buf;
+    err = vspace_map_one_frame(&buf, bytes, frame, NULL, NULL);
+    if (err_is_fail(err)) {
+        cap_destroy(frame);
+        return err_push(err, LIB_ERR_VSPACE_MAP);
+    }
+
+    slab_grow(slabs, buf, bytes);
+    return SYS_ERR_OK;
+}
+
+static uint8_t *page_alloc(void)
+{
+    uint8_t *page = slab_alloc(&page_slabs);
+    if (page == NULL) {
+        errval_t err = page_slabs_refill(&page_slabs);
+        if (err_is_fail(err)) {
+            DEBUG_ERR(err, "failed to refill ramfs page allocator");
+            return NULL;
+        }
+        page = slab_alloc(&page_slabs);
+    }
+    return page;
+}
+
+/// Free all pages of a file from the given page index onwards
+static void file_free_pages(struct dirent *f, size_t first)
+{
+    for (size_t i = first; i < f->u.file.npages; i++) {
+        if (f->u.file.pages[i] != NULL) {
+            slab_free(&page_slabs, f->u.file.pages[i]);
+            f->u.file.pages[i] = NULL;
+        }
+    }
+}
+
+/// Make sure the page table has space for at least npages entries
+static errval_t file_reserve_pages(struct dirent *f, size_t npages)
+{
+    if (npages <= f->u.file.npages) {
+        return SYS_ERR_OK;
+    }
+
+    // grow geometrically, so that appends are amortised O(1)
+    size_t newnpages = f->u.file.npages == 0 ? 1 : f->u.file.npages;
+    while (newnpages < npages) {
+        newnpages *= 2;
+    }
+
+    uint8_t **newpages = realloc(f->u.file.pages,
+                                 newnpages * sizeof(uint8_t *));
+    if (newpages == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    memset(&newpages[f->u.file.npages], 0,
+           (newnpages - f->u.file.npages) * sizeof(uint8_t *));
+    f->u.file.pages = newpages;
+    f->u.file.npages = newnpages;
+    return SYS_ERR_OK;
+}
+
 struct dirent *ramfs_init(void)
 {
+    slab_init(&page_slabs, RAMFS_PAGE_SIZE, page_slabs_refill);
+
     struct dirent *root = malloc(sizeof(struct dirent));
     assert(root != NULL);
 
@@ -74,7 +161,8 @@ void ramfs_decref(struct dirent *e)
             assert(e->u.dir.nentries == 0);
             assert(e->u.dir.entries == NULL);
         } else {
-            free(e->u.file.data);
+            file_free_pages(e, 0);
+            free(e->u.file.pages);
         }
         free(e);
     }
@@ -147,8 +235,9 @@ errval_t ramfs_lookup(struct dirent *dir, const char *name, struct dirent **ret)
     return FS_ERR_NOTFOUND;
 }
 
-errval_t ramfs_read(struct dirent *f, off_t offset, uint8_t **retbuf,
-                    size_t *maxlen)
+/// Copy up to maxlen bytes from the given offset of the file to buf
+errval_t ramfs_read(struct dirent *f, off_t offset, void *buf, size_t maxlen,
+                    size_t *retlen)
 {
     assert(f->islive && f->refcount > 0);
 
@@ -157,22 +246,39 @@ errval_t ramfs_read(struct dirent *f, off_t offset, uint8_t **retbuf,
     }
 
     if (offset < 0 || offset >= f->u.file.size) {
-        *retbuf = NULL;
-        *maxlen = 0;
-    } else {
-        assert(f->u.file.data != NULL);
-        *retbuf = &f->u.file.data[offset];
-        *maxlen = f->u.file.size - offset;
+        *retlen = 0;
+        return SYS_ERR_OK;
+    }
+
+    if (maxlen > f->u.file.size - offset) {
+        maxlen = f->u.file.size - offset;
     }
 
+    size_t done = 0;
+    while (done < maxlen) {
+        size_t pos = (size_t)offset + done;
+        size_t pageoff = pos & RAMFS_PAGE_MASK;
+        size_t chunk = MIN(RAMFS_PAGE_SIZE - pageoff, maxlen - done);
+        uint8_t *page = f->u.file.pages[pos >> RAMFS_PAGE_BITS];
+
+        if (page == NULL) { // hole
+            memset((uint8_t *)buf + done, 0, chunk);
+        } else {
+            memcpy((uint8_t *)buf + done, &page[pageoff], chunk);
+        }
+        done += chunk;
+    }
+
+    *retlen = done;
     return SYS_ERR_OK;
 }
 
-/// Ensure that the file has at least space for a write of the given size at
-/// the given offset, return buffer pointer
-errval_t ramfs_grow(struct dirent *f, off_t offset, size_t len,
-                    uint8_t **retbuf)
+/// Write len bytes from buf at the given offset, extending the file if needed
+errval_t ramfs_write(struct dirent *f, off_t offset, const void *buf,
+                     size_t len)
 {
+    errval_t err;
+
     assert(f->islive && f->refcount > 0);
 
     if (f->isdir) {
@@ -181,22 +287,40 @@ errval_t ramfs_grow(struct dirent *f, off_t offset, size_t len,
 
     assert(offset >= 0);
 
-    // do we need to grow the file? if not, we're done
-    if (offset + len <= f->u.file.size) {
-        *retbuf = &f->u.file.data[offset];
-        return SYS_ERR_OK;
+    size_t end = (size_t)offset + len;
+    err = file_reserve_pages(f, (end + RAMFS_PAGE_MASK) >> RAMFS_PAGE_BITS);
+    if (err_is_fail(err)) {
+        return err;
     }
 
-    uint8_t *newdata = realloc(f->u.file.data, (size_t)offset + len);
-    if (newdata == NULL) {
-        return LIB_ERR_MALLOC_FAIL;
-    } else {
-        f->u.file.data = newdata;
-        f->u.file.size = (size_t)offset + len;
-        *retbuf = &newdata[offset];
-        // XXX: new data is not initialised, we rely on the caller to do this!
-        return SYS_ERR_OK;
+    size_t done = 0;
+    while (done < len) {
+        size_t pos = (size_t)offset + done;
+        size_t pageoff = pos & RAMFS_PAGE_MASK;
+        size_t chunk = MIN(RAMFS_PAGE_SIZE - pageoff, len - done);
+        uint8_t **pagep = &f->u.file.pages[pos >> RAMFS_PAGE_BITS];
+
+        if (*pagep == NULL) {
+            *pagep = page_alloc();
+            if (*pagep == NULL) {
+                return LIB_ERR_MALLOC_FAIL;
+            }
+            // only the parts we don't overwrite need to be zeroed
+            memset(*pagep, 0, pageoff);
+            memset(*pagep + pageoff + chunk, 0,
+                   RAMFS_PAGE_SIZE - pageoff - chunk);
+        }
+
+        memcpy(*pagep + pageoff, (const uint8_t *)buf + done, chunk);
+        done += chunk;
+
+        // update size as we go, so a partial failure leaves a sane file
+        if (pos + chunk > f->u.file.size) {
+            f->u.file.size = pos + chunk;
+        }
     }
+
+    return SYS_ERR_OK;
 }
 
 errval_t ramfs_resize(struct dirent *f, size_t newlen)
@@ -207,17 +331,25 @@ errval_t ramfs_resize(struct dirent *f, size_t newlen)
         return FS_ERR_NOTFILE;
     }
 
-    uint8_t *newdata = realloc(f->u.file.data, newlen);
-    if (newdata == NULL) {
-        return LIB_ERR_MALLOC_FAIL;
-    }
-
-    if (newlen > f->u.file.size) {
-        // zero-fill new data
-        memset(&newdata[f->u.file.size], 0, newlen - f->u.file.size);
+    if (newlen < f->u.file.size) {
+        // drop all pages past the new end, and zero the tail of the last one
+        // so that a later extension reads back zeroes
+        size_t lastpage = newlen >> RAMFS_PAGE_BITS;
+        size_t pageoff = newlen & RAMFS_PAGE_MASK;
+        if (pageoff != 0 && f->u.file.pages[lastpage] != NULL) {
+            memset(&f->u.file.pages[lastpage][pageoff], 0,
+                   RAMFS_PAGE_SIZE - pageoff);
+        }
+        file_free_pages(f, (newlen + RAMFS_PAGE_MASK) >> RAMFS_PAGE_BITS);
+    } else {
+        // extending leaves holes, which read back as zeroes
+        errval_t err = file_reserve_pages(f, (newlen + RAMFS_PAGE_MASK)
+                                             >> RAMFS_PAGE_BITS);
+        if (err_is_fail(err)) {
+            return err;
+        }
     }
 
-    f->u.file.data = newdata;
     f->u.file.size = newlen;
 
     return SYS_ERR_OK;
@@ -269,7 +401,8 @@ errval_t ramfs_create(struct dirent *dir, const char *name, struct dirent **ret)
     f->isdir = false;
     f->refcount = 1;
     f->islive = true;
-    f->u.file.data = NULL;
+    f->u.file.pages = NULL;
+    f->u.file.npages = 0;
     f->u.file.size = 0;
 
     errval_t err = addchild(dir, f);
@@ -28,9 +28,10 @@ bool ramfs_islive(struct dirent *e);
 
 errval_t ramfs_readdir(struct dirent *dir, uint32_t index, struct dirent **ret);
 errval_t ramfs_lookup(struct dirent *dir, const char *name, struct dirent **ret);
-errval_t ramfs_read(struct dirent *f, off_t offset, uint8_t **retbuf,
-                    size_t *maxlen);
-errval_t ramfs_grow(struct dirent *f, off_t offset, size_t len, uint8_t **retbuf);
+errval_t ramfs_read(struct dirent *f, off_t offset, void *buf, size_t maxlen,
+                    size_t *retlen);
+errval_t ramfs_write(struct dirent *f, off_t offset, const void *buf,
+                     size_t len);
 errval_t ramfs_resize(struct dirent *f, size_t newlen);
 errval_t ramfs_create(struct dirent *dir, const char *name, struct dirent **ret);
 errval_t ramfs_mkdir(struct dirent *dir, const char *name, struct dirent **ret);
@@ -128,6 +128,11 @@ static void txcont(void *arg)
     ramfs_decref(e);
 }
 
+static void txcont_free(void *arg)
+{
+    free(arg);
+}
+
 static bool queue_is_empty(struct client_state *st)
 {
     return st->qstart == NULL;
@@ -211,6 +216,14 @@ static void qrunner(void *arg)
                                          e->a.lookup_response.isdir);
         break;
 
+    case trivfs_lookup_path_response__msgnum:
+        err = b->tx_vtbl.lookup_path_response(b, NOP_CONT,
+                                              e->a.lookup_path_response.err,
+                                              e->a.lookup_path_response.fh,
+                                              e->a.lookup_path_response.isdir,
+                                              e->a.lookup_path_response.pos);
+        break;
+
     case trivfs_getattr_response__msgnum:
         err = b->tx_vtbl.getattr_response(b, NOP_CONT,
                                           e->a.getattr_response.err,
@@ -219,15 +232,15 @@ static void qrunner(void *arg)
         break;
 
     case trivfs_read_response__msgnum:
-        err = b->tx_vtbl.read_response(b, e->dirent
-                                            ? MKCONT(txcont, e->dirent)
-                                            : NOP_CONT,
+        err = b->tx_vtbl.read_response(b, e->a.read_response.data
+                                         ? MKCONT(txcont_free,
+                                                  e->a.read_response.data)
+                                         : NOP_CONT,
                                        e->a.read_response.err,
                                        e->a.read_response.data,
                                        e->a.read_response.retlen);
-        if (e->dirent != NULL && err_is_fail(err)
-            && err_is_ok(e->a.read_response.err)) {
-            ramfs_decref(e->dirent);
+        if (err_is_fail(err)) {
+            free(e->a.read_response.data);
         }
         break;
 
@@ -486,6 +499,81 @@ reply:
     msg_enqueue(st, b, q);
 }
 
+static void lookup_path(struct trivfs_binding *b, trivfs_fh_t dir, char *path)
+{
+    errval_t err, reterr = SYS_ERR_OK;
+    struct client_state *st = b->st;
+    trivfs_fh_t retfh = NULL_FH;
+    bool isdir = false;
+    uint32_t pos = 0;
+
+    struct dirent *e = fh_get(st, dir);
+    if (e == NULL) {
+        reterr = FS_ERR_INVALID_FH;
+        goto reply;
+    }
+
+    if (path != NULL && path[pos] == '/') {
+        pos++;
+    }
+
+    // walk the path one component at a time, but only hand out a single fh
+    while (path != NULL && path[pos] != '\0') {
+        char *name = &path[pos];
+        char *nextsep = strchr(name, '/');
+        if (nextsep != NULL) {
+            *nextsep = '\0';
+        }
+
+        struct dirent *next = NULL;
+        err = ramfs_lookup(e, name, &next);
+        if (err_is_fail(err)) {
+            reterr = err;
+            break;
+        }
+
+        e = next;
+        if (nextsep == NULL) {
+            break;
+        }
+
+        pos = nextsep + 1 - path;
+
+        if (!ramfs_isdir(e)) {
+            // not a directory, don't bother going further
+            reterr = FS_ERR_NOTDIR;
+            break;
+        }
+    }
+
+    retfh = fh_set(st, e);
+    isdir = ramfs_isdir(e);
+
+reply:
+    free(path);
+    if (queue_is_empty(st)) {
+        err = b->tx_vtbl.lookup_path_response(b, NOP_CONT, reterr, retfh,
+                                              isdir, pos);
+        if (err_is_ok(err)) {
+            return;
+        } else if (err_no(err) != FLOUNDER_ERR_TX_BUSY) {
+            DEBUG_ERR(err, "error sending reply");
+            cleanup(b);
+            return;
+        }
+    }
+
+    // enqueue in send queue
+    struct msgq_elem *q = malloc(sizeof(struct msgq_elem));
+    assert(q != NULL);
+    q->msgnum = trivfs_lookup_path_response__msgnum;
+    q->a.lookup_path_response.err = reterr;
+    q->a.lookup_path_response.fh = retfh;
+    q->a.lookup_path_response.isdir = isdir;
+    q->a.lookup_path_response.pos = pos;
+    msg_enqueue(st, b, q);
+}
+
 static void getattr(struct trivfs_binding *b, trivfs_fh_t fh)
 {
     errval_t err, reterr = SYS_ERR_OK;
@@ -538,29 +626,43 @@ static void read(struct trivfs_binding *b, trivfs_fh_t fh,
         goto reply;
     }
 
-    err = ramfs_read(f, offset, &buf, &len);
-    if (err_is_fail(err)) {
-        reterr = err;
+    if (ramfs_isdir(f)) {
+        reterr = FS_ERR_NOTFILE;
         goto reply;
     }
 
-    if (len > maxlen) {
-        len = maxlen;
+    // file data isn't contiguous, so gather it into a reply buffer which
+    // is freed once the message has been sent
+    size_t size = ramfs_get_size(f);
+    if (offset < size && maxlen > 0) {
+        len = MIN(maxlen, size - offset);
+        buf = malloc(len);
+        if (buf == NULL) {
+            reterr = LIB_ERR_MALLOC_FAIL;
+            len = 0;
+            goto reply;
+        }
     }
 
-    ramfs_incref(f);
+    err = ramfs_read(f, offset, buf, len, &len);
+    if (err_is_fail(err)) {
+        free(buf);
+        buf = NULL;
+        len = 0;
+        reterr = err;
+        goto reply;
+    }
 
 reply:
     if (queue_is_empty(st)) {
-        err = b->tx_vtbl.read_response(b, err_is_ok(reterr)
-                                            ? MKCONT(txcont, f) : NOP_CONT,
+        err = b->tx_vtbl.read_response(b, buf != NULL
+                                            ? MKCONT(txcont_free, buf)
+                                            : NOP_CONT,
                                        reterr, buf, len);
         if (err_is_ok(err)) {
             return;
         } else if (err_no(err) != FLOUNDER_ERR_TX_BUSY) {
-            if (err_is_ok(reterr)) {
-                ramfs_decref(f);
-            }
+            free(buf);
             DEBUG_ERR(err, "error sending reply");
             cleanup(b);
             return;
@@ -574,7 +676,7 @@ reply:
     q->a.read_response.err = reterr;
     q->a.read_response.data = buf;
     q->a.read_response.retlen = len;
-    q->dirent = err_is_ok(reterr) ? f : NULL;
+    q->dirent = NULL;
     msg_enqueue(st, b, q);
 }
 
@@ -590,16 +692,12 @@ static void write(struct trivfs_binding *b, trivfs_fh_t fh,
         goto reply;
     }
 
-    uint8_t *buf;
-
-    err = ramfs_grow(f, offset, len, &buf);
+    err = ramfs_write(f, offset, data, len);
     if (err_is_fail(err)) {
         reterr = err;
         goto reply;
     }
 
-    memcpy(buf, data, len);
-
 reply:
     free(data);
     if (queue_is_empty(st)) {
@@ -627,7 +725,6 @@ static void read_bulk(struct trivfs_binding *b, trivfs_fh_t fh,
 {
     errval_t err, reterr = SYS_ERR_OK;
     struct client_state *st = b->st;
-    uint8_t *ramfsbuf = NULL;
     size_t len = 0;
 
     if (st->bulk_vregion == NULL) {
@@ -641,12 +738,6 @@ static void read_bulk(struct trivfs_binding *b, trivfs_fh_t fh,
         goto reply;
     }
 
-    err = ramfs_read(f, offset, &ramfsbuf, &len);
-    if (err_is_fail(err)) {
-        reterr = err;
-        goto reply;
-    }
-
     // determine local address of bulk buffer
     size_t bulk_size;
     void *bulkbuf = bulk_slave_buf_get_mem(&st->bulk, bulkid, &bulk_size);
@@ -656,14 +747,13 @@ static void read_bulk(struct trivfs_binding *b, trivfs_fh_t fh,
         maxlen = bulk_size;
     }
 
-    // limit read len to maxlen
-    if (len > maxlen) {
-        len = maxlen;
+    // copy data from the file's pages straight to the bulk buffer
+    err = ramfs_read(f, offset, bulkbuf, maxlen, &len);
+    if (err_is_fail(err)) {
+        reterr = err;
+        goto reply;
     }
 
-    // copy data to bulk buffer
-    memcpy(bulkbuf, ramfsbuf, len);
-
     // prepare bulk buffer for reply
     bulk_slave_prepare_send(&st->bulk, bulkid);
 
@@ -715,17 +805,15 @@ static void write_bulk(struct trivfs_binding *b, trivfs_fh_t fh,
         len = maxlen;
     }
 
-    uint8_t *ramfsbuf;
-    err = ramfs_grow(f, offset, len, &ramfsbuf);
+    bulk_slave_prepare_recv(&st->bulk, bulkid);
+
+    // copy data from the bulk buffer straight to the file's pages
+    err = ramfs_write(f, offset, bulkbuf, len);
     if (err_is_fail(err)) {
         reterr = err;
         goto reply;
     }
 
-    bulk_slave_prepare_recv(&st->bulk, bulkid);
-
-    memcpy(ramfsbuf, bulkbuf, len);
-
 reply:
     if (queue_is_empty(st)) {
         err = b->tx_vtbl.write_bulk_response(b, NOP_CONT, reterr);
@@ -918,6 +1006,7 @@ static struct trivfs_rx_vtbl rx_vtbl = {
     .getroot_call = getroot,
     .readdir_call = readdir,
     .lookup_call = lookup,
+    .lookup_path_call = lookup_path,
     .getattr_call = getattr,
     .read_call = read,
     .write_call = write,
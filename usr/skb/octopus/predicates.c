@@ -19,7 +19,7 @@
 #include <eclipse.h>
 #include <barrelfish/barrelfish.h>
 #include <include/skb_server.h>
-#include <collections/hash_table.h>
+#include <collections/oahash_table.h>
 
 #include <octopus_server/debug.h>
 #include <octopus_server/service.h>
@@ -30,44 +30,43 @@
 #include "bitfield.h"
 #include "fnv.h"
 
-#define HASH_INDEX_BUCKETS 6151
-static collections_hash_table* record_index = NULL;
+static collections_oahash_table* record_index = NULL;
 
-static collections_hash_table* trigger_index = NULL;
+static collections_oahash_table* trigger_index = NULL;
 static struct bitfield* no_attr_triggers = NULL;
 
-static collections_hash_table* subscriber_index = NULL;
+static collections_oahash_table* subscriber_index = NULL;
 static struct bitfield* no_attr_subscriptions = NULL;
 
 static inline void init_index(void) {
     if(record_index == NULL) {
-        collections_hash_create_with_buckets(&record_index, HASH_INDEX_BUCKETS, NULL);
+        collections_oahash_create(&record_index, NULL);
     }
 
     if(subscriber_index == NULL) {
-        collections_hash_create_with_buckets(&subscriber_index, HASH_INDEX_BUCKETS, NULL);
+        collections_oahash_create(&subscriber_index, NULL);
         bitfield_create(&no_attr_subscriptions);
     }
 
     if(trigger_index == NULL) {
-        collections_hash_create_with_buckets(&trigger_index, HASH_INDEX_BUCKETS, NULL);
+        collections_oahash_create(&trigger_index, NULL);
         bitfield_create(&no_attr_triggers);
     }
 }
 
 
-static int skip_index_insert(collections_hash_table* ht, uint64_t key, char* value)
+static int skip_index_insert(collections_oahash_table* ht, uint64_t key, char* value)
 {
     assert(ht != NULL);
     assert(value != NULL);
 
-    struct skip_list* sl = (struct skip_list*) collections_hash_find(ht, key);
+    struct skip_list* sl = (struct skip_list*) collections_oahash_find(ht, key);
     if (sl == NULL) {
         errval_t err = skip_create_list(&sl);
         if (err_is_fail(err)) {
             return PFAIL;
         }
-        collections_hash_insert(ht, key, sl);
+        collections_oahash_insert(ht, key, sl);
     }
 
     skip_insert(sl, value);
@@ -76,12 +75,12 @@ static int skip_index_insert(collections_hash_table* ht, uint64_t key, char* val
     return PSUCCEED;
 }
 
-static char* skip_index_remove(collections_hash_table* ht, uint64_t key, char* value)
+static char* skip_index_remove(collections_oahash_table* ht, uint64_t key, char* value)
 {
     assert(ht != NULL);
     assert(value != NULL);
 
-    struct skip_list* sl = (struct skip_list*) collections_hash_find(ht, key);
+    struct skip_list* sl = (struct skip_list*) collections_oahash_find(ht, key);
     if (sl == NULL) {
         return NULL;
     }
@@ -172,7 +171,7 @@ int p_index_intersect(void) /* p_index_intersect(type, -[Attributes], -Current,
     if (res != PSUCCEED) {
         return res;
     }
-    collections_hash_table* ht = record_index;
+    collections_oahash_table* ht = record_index;
 
     res = ec_get_string(ec_arg(3), &next);
     if (res != PSUCCEED) {
@@ -194,7 +193,7 @@ int p_index_intersect(void) /* p_index_intersect(type, -[Attributes], -Current,
             }
 
             uint64_t hash_key = fnv_64a_str(key, FNV1A_64_INIT);
-            struct skip_list* sl = collections_hash_find(ht, hash_key);
+            struct skip_list* sl = collections_oahash_find(ht, hash_key);
             if (sl == NULL) {
                 return PFAIL;
             }
@@ -220,7 +219,7 @@ int p_index_intersect(void) /* p_index_intersect(type, -[Attributes], -Current,
 int p_index_union(void) /* p_index_union(type, -[Attributes], -Current, +Next) */
 {
     OCT_DEBUG("p_index_union\n");
-    static collections_hash_table* union_ht = NULL;
+    static collections_oahash_table* union_ht = NULL;
     static char* next = NULL;
 
     int res;
@@ -233,16 +232,16 @@ int p_index_union(void) /* p_index_union(type, -[Attributes], -Current, +Next) *
     if (res != PSUCCEED) {
         return res;
     }
-    collections_hash_table* ht = record_index; // TODO broken
+    collections_oahash_table* ht = record_index; // TODO broken
 
     res = ec_get_string(ec_arg(3), &next);
     if (res != PSUCCEED) {
         OCT_DEBUG("state is not a string, find skip lists\n");
         if (union_ht != NULL) {
-            collections_hash_release(union_ht);
+            collections_oahash_release(union_ht);
             union_ht = NULL;
         }
-        collections_hash_create_with_buckets(&union_ht, HASH_INDEX_BUCKETS, NULL);
+        collections_oahash_create(&union_ht, NULL);
 
         pword list, cur, rest;
         for (list = ec_arg(2); ec_get_list(list, &cur, &rest) == PSUCCEED; list = rest) {
@@ -252,7 +251,7 @@ int p_index_union(void) /* p_index_union(type, -[Attributes], -Current, +Next) *
             }
 
             uint64_t hash_key = fnv_64a_str(key, FNV1A_64_INIT);
-            struct skip_list* sl = collections_hash_find(ht, hash_key);
+            struct skip_list* sl = collections_oahash_find(ht, hash_key);
 
             // Insert all entries in union hash table
             if (sl != NULL) {
@@ -262,9 +261,9 @@ int p_index_union(void) /* p_index_union(type, -[Attributes], -Current, +Next) *
                 struct skip_node* sentry = sl->header->forward[0];
                 while(sentry != NULL) {
                     uint64_t hash_key = fnv_64a_str(sentry->element, FNV1A_64_INIT);
-                    if(collections_hash_find(union_ht, hash_key) == NULL) {
+                    if(collections_oahash_find(union_ht, hash_key) == NULL) {
                         OCT_DEBUG("p_index_union insert: %s\n", sentry->element);
-                        collections_hash_insert(union_ht, hash_key, sentry->element);
+                        collections_oahash_insert(union_ht, hash_key, sentry->element);
                     }
                     sentry = sentry->forward[0];
                 }
@@ -272,46 +271,46 @@ int p_index_union(void) /* p_index_union(type, -[Attributes], -Current, +Next) *
 
         }
         next = NULL;
-        collections_hash_traverse_start(union_ht);
+        collections_oahash_traverse_start(union_ht);
     }
 
     uint64_t hash_key;
-    next = collections_hash_traverse_next(union_ht, &hash_key);
+    next = collections_oahash_traverse_next(union_ht, &hash_key);
     OCT_DEBUG("skip_union found next: %s\n", next);
     if(next != NULL) {
         dident item = ec_did(next, 0);
         return ec_unify_arg(4, ec_atom(item));
     }
     else {
-        collections_hash_traverse_end(union_ht);
+        collections_oahash_traverse_end(union_ht);
         return PFAIL;
     }
 }
 
 
 
-static int bitfield_index_insert(collections_hash_table* ht, uint64_t key, long int id)
+static int bitfield_index_insert(collections_oahash_table* ht, uint64_t key, long int id)
 {
     assert(ht != NULL);
 
-    struct bitfield* bf = (struct bitfield*) collections_hash_find(ht, key);
+    struct bitfield* bf = (struct bitfield*) collections_oahash_find(ht, key);
     if (bf == NULL) {
         errval_t err = bitfield_create(&bf);
         if (err_is_fail(err)) {
             return PFAIL;
         }
-        collections_hash_insert(ht, key, bf);
+        collections_oahash_insert(ht, key, bf);
     }
 
     bitfield_on(bf, id);
     return PSUCCEED;
 }
 
-static int bitfield_index_remove(collections_hash_table* ht, uint64_t key, long int id)
+static int bitfield_index_remove(collections_oahash_table* ht, uint64_t key, long int id)
 {
     assert(ht != NULL);
 
-    struct bitfield* bf = (struct bitfield*) collections_hash_find(ht, key);
+    struct bitfield* bf = (struct bitfield*) collections_oahash_find(ht, key);
     if (bf != NULL) {
         bitfield_off(bf, id);
     }
@@ -326,7 +325,7 @@ int p_bitfield_add(void) /* p_bitfield_add(Storage, +Name, +[AttributeList], +Id
     long int id;
     bool inserted = false;
 
-    collections_hash_table* ht = NULL;
+    collections_oahash_table* ht = NULL;
     struct bitfield* no_attr_bf = NULL;
 
     char* storage;
@@ -373,7 +372,7 @@ int p_bitfield_remove(void) /* p_bitfield_remove(Storage, +Name, +[AttributeList
     int res = 0;
     long int id;
 
-    collections_hash_table* ht = NULL;
+    collections_oahash_table* ht = NULL;
     struct bitfield* no_attr_bf = NULL;
 
     char* storage;
@@ -420,7 +419,7 @@ int p_bitfield_union(void) /* p_index_union(Storage, -[Attributes], -Current, +N
     char* key;
 
     init_index();
-    collections_hash_table* ht = NULL;
+    collections_oahash_table* ht = NULL;
     struct bitfield* no_attr_bf = NULL;
 
     char* storage = NULL;
@@ -455,7 +454,7 @@ int p_bitfield_union(void) /* p_index_union(Storage, -[Attributes], -Current, +N
             }
 
             uint64_t hash_key = fnv_64a_str(key, FNV1A_64_INIT);
-            struct bitfield* sl = collections_hash_find(ht, hash_key);
+            struct bitfield* sl = collections_oahash_find(ht, hash_key);
             if (sl != NULL) {
                 OCT_DEBUG("bitfield_union found bitfield for key: %s\n", key);
                 sets[elems++] = sl;
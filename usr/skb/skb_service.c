@@ -26,9 +26,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ctype.h>
 
 #include <barrelfish/barrelfish.h>
 #include <barrelfish/nameservice_client.h>
+#include <bench/bench.h>
+#include <hashtable/hashtable.h>
 #include <eclipse.h>
 #include <include/skb_server.h>
 #include <include/skb_debug.h>
@@ -36,6 +39,18 @@
 
 #include <skb/skb.h>
 
+// Counters reported by get_stats
+static struct skb_stats stats;
+
+// Goal templates of run_cached, mapped to their compiled predicates
+static struct hashtable *goal_cache;
+static uint64_t goal_cache_next_id;
+
+struct cached_goal {
+    uint64_t id;        ///< predicate name is '$skb_goal_<id>'
+    int arity;          ///< number of Arg<n> parameters
+};
+
 
 errval_t new_reply_state(struct skb_reply_state** srs, rpc_reply_handler_fn reply_handler)
 {
@@ -71,6 +86,7 @@ errval_t execute_query(char* query, struct skb_query_state* st)
 	int res;
 
     ec_ref Start = ec_ref_create_newvar();
+    cycles_t start = bench_tsc();
 
 	st->exec_res = PFLUSHIO;
     st->output_length = 0;
@@ -111,6 +127,9 @@ errval_t execute_query(char* query, struct skb_query_state* st)
 
     ec_ref_destroy(Start);
 
+    stats.queries++;
+    stats.cycles += bench_tsc() - start;
+
     return SYS_ERR_OK;
 }
 
@@ -152,8 +171,221 @@ static void run(struct skb_binding *b, char *query)
 }
 
 
+static void add_facts_reply(struct skb_binding* b,
+                            struct skb_reply_state* srt)
+{
+    errval_t err;
+    err = b->tx_vtbl.add_facts_response(b, MKCONT(free_reply_state, srt),
+                                        srt->skb.error_buffer,
+                                        srt->skb.exec_res);
+    if (err_is_fail(err)) {
+        if(err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            enqueue_reply_state(b, srt);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
+
+
+/**
+ * \brief Asserts newline-separated facts one at a time.
+ *
+ * A fact that fails does not keep the others from being asserted; the reply
+ * carries the result and error output of the first fact that failed.
+ */
+static void add_facts(struct skb_binding *b, char *facts)
+{
+    struct skb_reply_state* srt = NULL;
+    errval_t err = new_reply_state(&srt, add_facts_reply);
+    assert(err_is_ok(err)); // TODO
+
+    struct skb_query_state *st = malloc(sizeof(struct skb_query_state));
+    assert(st != NULL);
+
+    // "assert(" ")." and the terminator
+    char *goal = malloc(strlen(facts) + 10);
+    assert(goal != NULL);
+
+    srt->skb.exec_res = PSUCCEED;
+    char *fact = strtok(facts, "\n");
+    while (fact != NULL) {
+        sprintf(goal, "assert(%s).", fact);
+        err = execute_query(goal, st);
+        assert(err_is_ok(err));
+        stats.facts++;
+
+        if (st->exec_res != PSUCCEED && srt->skb.exec_res == PSUCCEED) {
+            SKB_DEBUG("add_facts: failed to assert %s\n", fact);
+            srt->skb.exec_res = st->exec_res;
+            strcpy(srt->skb.error_buffer, st->error_buffer);
+            srt->skb.error_output_length = st->error_output_length;
+        }
+        fact = strtok(NULL, "\n");
+    }
+    stats.fact_batches++;
+
+    add_facts_reply(b, srt);
+    free(goal);
+    free(st);
+    free(facts);
+}
+
+
+static void run_cached_reply(struct skb_binding* b,
+                             struct skb_reply_state* srt)
+{
+    errval_t err;
+    err = b->tx_vtbl.run_cached_response(b, MKCONT(free_reply_state, srt),
+                                         srt->skb.output_buffer,
+                                         srt->skb.error_buffer,
+                                         srt->skb.exec_res);
+    if (err_is_fail(err)) {
+        if(err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            enqueue_reply_state(b, srt);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
+
+
+/**
+ * \brief Returns the highest n of the variables Arg<n> in a goal.
+ */
+static int goal_arity(char *goal)
+{
+    int arity = 0;
+    for (char *c = strstr(goal, "Arg"); c != NULL; c = strstr(c + 1, "Arg")) {
+        if (c > goal && (isalnum((unsigned char)c[-1]) || c[-1] == '_')) {
+            continue;
+        }
+        char *end;
+        long n = strtol(c + 3, &end, 10);
+        if (end != c + 3 && !isalnum((unsigned char)*end) && *end != '_' &&
+                n > arity) {
+            arity = n;
+        }
+    }
+    return arity;
+}
+
+
+/**
+ * \brief Compiles a goal template into the predicate
+ * '$skb_goal_<id>'(Arg1, ..., ArgN) :- Goal.
+ *
+ * On failure the ECLiPSe error is left in st.
+ */
+static errval_t compile_goal(char *goal, struct cached_goal *cg,
+                             struct skb_query_state *st)
+{
+    size_t len = strlen(goal) + cg->arity * 12 + 64;
+    char *clause = malloc(len);
+    if (clause == NULL) {
+        return LIB_ERR_MALLOC_FAIL;
+    }
+
+    char *pos = clause;
+    pos += sprintf(pos, "compile_term(('$skb_goal_%"PRIu64"'", cg->id);
+    for (int i = 1; i <= cg->arity; i++) {
+        pos += sprintf(pos, "%sArg%d", (i == 1) ? "(" : ",", i);
+    }
+    sprintf(pos, "%s :- (%s))).", (cg->arity > 0) ? ")" : "", goal);
+
+    errval_t err = execute_query(clause, st);
+    free(clause);
+    return err;
+}
+
+
+static void run_cached(struct skb_binding *b, char *goal, char *args)
+{
+    struct skb_reply_state* srt = NULL;
+    errval_t err = new_reply_state(&srt, run_cached_reply);
+    assert(err_is_ok(err)); // TODO
+
+    if (goal_cache == NULL) {
+        goal_cache = create_hashtable();
+        assert(goal_cache != NULL);
+    }
+
+    struct cached_goal *cg;
+    goal_cache->d.get(&goal_cache->d, goal, strlen(goal), (void**)&cg);
+    if (cg == NULL) {
+        stats.cache_misses++;
+        cg = malloc(sizeof(struct cached_goal));
+        assert(cg != NULL);
+        cg->id = goal_cache_next_id++;
+        cg->arity = goal_arity(goal);
+
+        err = compile_goal(goal, cg, &srt->skb);
+        assert(err_is_ok(err));
+        if (srt->skb.exec_res != PSUCCEED) {
+            // Report the compiler's error, and do not cache the goal
+            free(cg);
+            goto reply;
+        }
+        // the cache keeps the goal string as its key
+        goal_cache->d.put_word(&goal_cache->d, goal, strlen(goal),
+                               (uintptr_t)cg);
+        goal = NULL;
+    } else {
+        stats.cache_hits++;
+    }
+
+    size_t len = strlen(args) + 64;
+    char *call = malloc(len);
+    assert(call != NULL);
+    if (cg->arity > 0) {
+        snprintf(call, len, "'$skb_goal_%"PRIu64"'(%s).", cg->id, args);
+    } else {
+        snprintf(call, len, "'$skb_goal_%"PRIu64"'.", cg->id);
+    }
+    err = execute_query(call, &srt->skb);
+    assert(err_is_ok(err));
+    free(call);
+
+reply:
+    run_cached_reply(b, srt);
+    free(goal);
+    free(args);
+}
+
+
+static void get_stats_reply(struct skb_binding* b,
+                            struct skb_reply_state* srt)
+{
+    errval_t err;
+    err = b->tx_vtbl.get_stats_response(b, MKCONT(free_reply_state, srt),
+                                        stats.queries, stats.facts,
+                                        stats.fact_batches, stats.cache_hits,
+                                        stats.cache_misses, stats.cycles);
+    if (err_is_fail(err)) {
+        if(err_no(err) == FLOUNDER_ERR_TX_BUSY) {
+            enqueue_reply_state(b, srt);
+            return;
+        }
+        USER_PANIC_ERR(err, "SKB sending %s failed!", __FUNCTION__);
+    }
+}
+
+
+static void get_stats(struct skb_binding *b)
+{
+    struct skb_reply_state* srt = NULL;
+    errval_t err = new_reply_state(&srt, get_stats_reply);
+    assert(err_is_ok(err)); // TODO
+
+    get_stats_reply(b, srt);
+}
+
+
 static struct skb_rx_vtbl rx_vtbl = {
     .run_call = run,
+    .add_facts_call = add_facts,
+    .run_cached_call = run_cached,
+    .get_stats_call = get_stats,
 };
 
 
@@ -0,0 +1,129 @@
+/**
+ * \file
+ * \brief Cache of loaded images, so that binaries spawned repeatedly are
+ *        only read and loaded once.
+ *
+ * Entries are keyed by path and file size. A binary replaced by one of the
+ * same size is not noticed, which is good enough for the boot images that
+ * are spawned repeatedly.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <barrelfish/barrelfish.h>
+#include <spawndomain/spawndomain.h>
+
+#include "internal.h"
+
+/// Max. number of binaries kept in the cache
+#define IMAGECACHE_SIZE 32
+
+struct imagecache_entry {
+    struct imagecache_entry *next;
+    char *path;
+    size_t filesize;
+    uint64_t lastuse;
+    struct spawn_image img;
+};
+
+static struct imagecache_entry *entries;
+static size_t nentries;
+static uint64_t usecount;
+
+static void entry_free(struct imagecache_entry *e)
+{
+    spawn_image_free(&e->img);
+    free(e->path);
+    free(e);
+}
+
+/// Drop the least recently used entry
+static void evict(void)
+{
+    struct imagecache_entry **victim = NULL;
+
+    for (struct imagecache_entry **p = &entries; *p != NULL; p = &(*p)->next) {
+        if (victim == NULL || (*p)->lastuse < (*victim)->lastuse) {
+            victim = p;
+        }
+    }
+
+    if (victim != NULL) {
+        struct imagecache_entry *e = *victim;
+        *victim = e->next;
+        nentries--;
+        entry_free(e);
+    }
+}
+
+/**
+ * \brief Get the cached image of a binary
+ *
+ * Returns an empty image for binaries that are not cached yet, to be filled
+ * in by spawn_load_image_cached(). Such images must either be filled in or
+ * be dropped with imagecache_drop() before the next call.
+ */
+struct spawn_image *imagecache_get(const char *path, size_t filesize)
+{
+    struct imagecache_entry *e;
+
+    for (e = entries; e != NULL; e = e->next) {
+        if (strcmp(e->path, path) == 0) {
+            break;
+        }
+    }
+
+    if (e != NULL && e->filesize != filesize) {
+        // binary has changed
+        imagecache_drop(path);
+        e = NULL;
+    }
+
+    if (e == NULL) {
+        if (nentries >= IMAGECACHE_SIZE) {
+            evict();
+        }
+
+        e = calloc(1, sizeof(struct imagecache_entry));
+        if (e == NULL) {
+            return NULL;
+        }
+        e->path = strdup(path);
+        if (e->path == NULL) {
+            free(e);
+            return NULL;
+        }
+        e->filesize = filesize;
+        e->next = entries;
+        entries = e;
+        nentries++;
+    }
+
+    e->lastuse = ++usecount;
+    return &e->img;
+}
+
+/**
+ * \brief Remove the image of a binary from the cache
+ */
+void imagecache_drop(const char *path)
+{
+    for (struct imagecache_entry **p = &entries; *p != NULL; p = &(*p)->next) {
+        if (strcmp((*p)->path, path) == 0) {
+            struct imagecache_entry *e = *p;
+            *p = e->next;
+            nentries--;
+            entry_free(e);
+            return;
+        }
+    }
+}
@@ -23,4 +23,8 @@ extern const char *gbootmodules;
 
 errval_t start_service(void);
 
+struct spawn_image;
+struct spawn_image *imagecache_get(const char *path, size_t filesize);
+void imagecache_drop(const char *path);
+
 #endif //INTERNAL_H_
@@ -52,27 +52,38 @@ static errval_t spawn(char *path, char *const argv[], char *argbuf,
     }
 
     assert(info.type == VFS_FILE);
-    uint8_t *image = malloc(info.size);
-    if (image == NULL) {
-        vfs_close(fh);
-        return err_push(err, SPAWN_ERR_LOAD);
-    }
 
-    size_t pos = 0, readlen;
-    do {
-        err = vfs_read(fh, &image[pos], info.size - pos, &readlen);
-        if (err_is_fail(err)) {
+    // binaries that were spawned before need not be read again
+    struct spawn_image *img = imagecache_get(path, info.size);
+    uint8_t *image = NULL;
+    if (spawn_image_needs_binary(img, flags)) {
+        image = malloc(info.size);
+        if (image == NULL) {
             vfs_close(fh);
-            free(image);
+            if (img != NULL) {
+                imagecache_drop(path);
+            }
             return err_push(err, SPAWN_ERR_LOAD);
-        } else if (readlen == 0) {
-            vfs_close(fh);
-            free(image);
-            return SPAWN_ERR_LOAD; // XXX
-        } else {
-            pos += readlen;
         }
-    } while (err_is_ok(err) && readlen > 0 && pos < info.size);
+
+        size_t pos = 0, readlen;
+        do {
+            err = vfs_read(fh, &image[pos], info.size - pos, &readlen);
+            if (err_is_fail(err) || readlen == 0) {
+                vfs_close(fh);
+                free(image);
+                if (img != NULL) {
+                    imagecache_drop(path);
+                }
+                if (err_is_ok(err)) {
+                    return SPAWN_ERR_LOAD; // XXX
+                }
+                return err_push(err, SPAWN_ERR_LOAD);
+            } else {
+                pos += readlen;
+            }
+        } while (err_is_ok(err) && readlen > 0 && pos < info.size);
+    }
 
     err = vfs_close(fh);
     if (err_is_fail(err)) {
@@ -90,16 +101,18 @@ static errval_t spawn(char *path, char *const argv[], char *argbuf,
     /* spawn the image */
     struct spawninfo si;
     si.flags = flags;
-    err = spawn_load_image(&si, (lvaddr_t)image, info.size, CURRENT_CPU_TYPE,
-                           name, my_core_id, argv, envp, inheritcn_cap,
-                           argcn_cap);
+    err = spawn_load_image_cached(&si, img, (lvaddr_t)image, info.size,
+                                  CURRENT_CPU_TYPE, name, my_core_id, argv,
+                                  envp, inheritcn_cap, argcn_cap);
+    free(image);
+    if (img != NULL && !img->cached) {
+        // loading or caching failed, or is not supported here
+        imagecache_drop(path);
+    }
     if (err_is_fail(err)) {
-        free(image);
         return err;
     }
 
-    free(image);
-
     /* request connection from monitor */
     struct monitor_blocking_rpc_client *mrpc = get_monitor_blocking_rpc_client();
     struct capref monep;
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstdlib>
+
+#include <executor/executor.hpp>
+
+using barrelfish::executor;
+using barrelfish::future;
+
+#define CHECK(_c)                                                       \
+    do {                                                                \
+        if (!(_c)) {                                                    \
+            std::cout << "FAILED: " #_c " at line " << __LINE__         \
+                      << std::endl;                                     \
+            exit(EXIT_FAILURE);                                         \
+        }                                                               \
+    } while (0)
+
+static int fib(executor &ex, int n)
+{
+    if (n < 2) {
+        return n;
+    }
+    future<int> a = ex.async([&ex, n] { return fib(ex, n - 1); });
+    int b = fib(ex, n - 2);
+    return a.get() + b;
+}
+
+static void test_async(executor &ex)
+{
+    future<int> f = ex.async([] { return 6 * 7; });
+    CHECK(f.get() == 42);
+
+    future<void> v = ex.async([] { });
+    v.get();
+
+    future<int> e = ex.async([] () -> int {
+        throw std::runtime_error("expected");
+    });
+    bool caught = false;
+    try {
+        e.get();
+    } catch (std::runtime_error &) {
+        caught = true;
+    }
+    CHECK(caught);
+
+    CHECK(fib(ex, 16) == 987);
+}
+
+static void test_then(executor &ex)
+{
+    future<int> f = ex.async([] { return 1; });
+    future<int> g = f.then([] (future<int> r) { return r.get() + 1; });
+    future<int> h = g.then([] (future<int> r) { return r.get() * 10; });
+    CHECK(h.get() == 20);
+}
+
+static void test_parallel(executor &ex)
+{
+    const size_t n = 100000;
+    std::vector<int> a(n);
+    ex.parallel_for(0, n, [&a] (size_t i) { a[i] = i % 7; });
+
+    long expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        expected += i % 7;
+    }
+
+    long sum = ex.parallel_reduce(0, n, 0L,
+                                  [&a] (size_t i) { return (long)a[i]; },
+                                  [] (long x, long y) { return x + y; });
+    CHECK(sum == expected);
+
+    // grain larger than the range, and an empty range
+    sum = ex.parallel_reduce(0, 10, 0L,
+                             [] (size_t i) { return (long)i; },
+                             [] (long x, long y) { return x + y; }, 100);
+    CHECK(sum == 45);
+    CHECK(ex.parallel_reduce(5, 5, 3L,
+                             [] (size_t i) { return (long)i; },
+                             [] (long x, long y) { return x + y; }) == 3);
+}
+
+static void test_pinned(executor &ex, const std::vector<coreid_t> &cores)
+{
+    for (size_t i = 0; i < cores.size(); i++) {
+        coreid_t core = cores[i];
+        future<coreid_t> f = ex.async_on(core, [] { return disp_get_core_id(); });
+        CHECK(f.get() == core);
+    }
+}
+
+/**
+ * Usage: cxx_executor [core ...]
+ *
+ * Runs the executor on the given cores, by default two workers on the
+ * current core.
+ */
+int main(int argc, char *argv[])
+{
+    std::vector<coreid_t> cores;
+    for (int i = 1; i < argc; i++) {
+        cores.push_back(atoi(argv[i]));
+    }
+    size_t threads_per_core = 1;
+    if (cores.empty()) {
+        cores.push_back(disp_get_core_id());
+        threads_per_core = 2;
+    }
+
+    {
+        executor ex(cores, threads_per_core);
+        test_async(ex);
+        test_then(ex);
+        test_parallel(ex);
+        test_pinned(ex, cores);
+
+        size_t executed, stolen;
+        ex.stats(&executed, &stolen);
+        std::cout << "executor: " << ex.size() << " workers ran " << executed
+                  << " tasks, " << stolen << " stolen" << std::endl;
+    }
+
+    std::cout << "Tests done: SUCCESS" << std::endl;
+    return 0;
+}
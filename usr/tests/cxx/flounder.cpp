@@ -0,0 +1,274 @@
+/**
+ * \file
+ * \brief Test of the C++ Flounder bindings
+ *
+ * Usage: cxx_flounder client|server
+ *
+ * The server echoes the messages of the test interface using the generated
+ * C++ binding, handing received strings and buffers straight back to send.
+ * The client checks the replies, completions and FLOUNDER_ERR_TX_BUSY
+ * handling.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+#include <barrelfish/barrelfish.h>
+#include <barrelfish/nameservice_client.h>
+#include <if/test_cxx.hpp>
+
+using namespace flounder::test;
+
+#define BUF_SIZE 4096
+
+#define CHECK(_c)                                                       \
+    do {                                                                \
+        if (!(_c)) {                                                    \
+            USER_PANIC("FAILED: " #_c " at line %d\n", __LINE__);       \
+        }                                                               \
+    } while (0)
+
+#define CHECK_ERR(_e, _what)                                            \
+    do {                                                                \
+        errval_t _err = (_e);                                           \
+        if (err_is_fail(_err)) {                                        \
+            USER_PANIC_ERR(_err, _what);                                \
+        }                                                               \
+    } while (0)
+
+static const char *service_name = "cxx_flounder_test";
+
+/// Dispatches the default waitset until flag is set, then clears it
+static void wait_for(bool &flag)
+{
+    while (!flag) {
+        CHECK_ERR(event_dispatch(get_default_waitset()), "event_dispatch");
+    }
+    flag = false;
+}
+
+/* ------------------------------ SERVER ------------------------------ */
+
+static void export_cb(void *st, errval_t err, iref_t iref)
+{
+    CHECK_ERR(err, "export failed");
+    CHECK_ERR(nameservice_register(service_name, iref),
+              "nameservice_register failed");
+}
+
+/// Echo server of one connection
+class echo_server {
+public:
+    explicit echo_server(struct test_binding *tb) : b_(tb)
+    {
+        b_.on_basic([this] (basic_msg &m) {
+            reply r(reply::BASIC, m.arg + 1);
+            queue(std::move(r));
+        });
+        b_.on_str([this] (str_msg &m) {
+            reply r(reply::STR, m.arg);
+            r.s = m.take_s();
+            queue(std::move(r));
+        });
+        b_.on_buf([this] (buf_msg &m) {
+            reply r(reply::BUF, 0);
+            r.buf = m.take_buf();
+            queue(std::move(r));
+        });
+    }
+
+private:
+    struct reply {
+        enum kind { BASIC, STR, BUF } kind;
+        uint32_t arg;
+        flounder::owned_string s;
+        flounder::owned_buffer<uint8_t> buf;
+
+        reply(enum kind k, uint32_t a) : kind(k), arg(a) {}
+    };
+
+    // the client may send the next request before the completion of the
+    // previous reply has run here, so replies wait in a queue and each
+    // completion sends the next one
+    void queue(reply &&r)
+    {
+        replies_.push_back(std::move(r));
+        send_next();
+    }
+
+    void send_next()
+    {
+        if (b_.tx_busy() || replies_.empty()) {
+            return;
+        }
+
+        // dequeue first, as the completion may run before the send returns
+        reply r = std::move(replies_.front());
+        replies_.pop_front();
+
+        flounder::completion done = [this] { send_next(); };
+        switch (r.kind) {
+        case reply::BASIC:
+            CHECK_ERR(b_.basic(r.arg, done), "reply basic");
+            break;
+        case reply::STR:
+            CHECK_ERR(b_.str(r.arg, std::move(r.s), done), "reply str");
+            break;
+        case reply::BUF:
+            CHECK_ERR(b_.buf(std::move(r.buf), done), "reply buf");
+            break;
+        }
+    }
+
+    binding b_;
+    std::deque<reply> replies_;
+};
+
+static errval_t connect_cb(void *st, struct test_binding *b)
+{
+    // lives as long as the connection
+    new echo_server(b);
+    return SYS_ERR_OK;
+}
+
+static void run_server(void)
+{
+    CHECK_ERR(test_export(NULL, export_cb, connect_cb, get_default_waitset(),
+                          (idc_export_flags_t)IDC_EXPORT_FLAGS_DEFAULT),
+              "export failed");
+    messages_handler_loop();
+}
+
+/* ------------------------------ CLIENT ------------------------------ */
+
+static void bind_cb(void *st, errval_t err, struct test_binding *b)
+{
+    CHECK_ERR(err, "bind failed");
+    *static_cast<struct test_binding **>(st) = b;
+}
+
+static void test_basic(binding &b)
+{
+    bool got = false;
+    uint32_t reply = 0;
+    b.on_basic([&] (basic_msg &m) {
+        reply = m.arg;
+        got = true;
+    });
+
+    CHECK_ERR(b.basic(41), "send basic");
+    wait_for(got);
+    CHECK(reply == 42);
+}
+
+static void test_str(binding &b)
+{
+    bool got = false, sent = false;
+    flounder::owned_string reply;
+    b.on_str([&] (str_msg &m) {
+        CHECK(m.arg == 7);
+        reply = m.take_s();
+        got = true;
+    });
+
+    flounder::owned_string s = flounder::owned_string::copy("hello, world");
+    CHECK_ERR(b.str(7, std::move(s), [&sent] { sent = true; }), "send str");
+    CHECK(s.size() == 0);
+    wait_for(sent);
+    wait_for(got);
+    CHECK(reply.view() == "hello, world");
+    CHECK(strcmp(reply.c_str(), "hello, world") == 0);
+}
+
+static void test_buf(binding &b)
+{
+    bool got = false;
+    b.on_buf([&] (buf_msg &m) {
+        CHECK(m.buf.size() == BUF_SIZE);
+        for (size_t i = 0; i < m.buf.size(); i++) {
+            CHECK(m.buf[i] == (uint8_t)i);
+        }
+        got = true;
+    });
+
+    flounder::owned_buffer<uint8_t> buf =
+        flounder::owned_buffer<uint8_t>::allocate(BUF_SIZE);
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = i;
+    }
+    CHECK_ERR(b.buf(std::move(buf)), "send buf");
+    wait_for(got);
+}
+
+static void test_busy(binding &b)
+{
+    int got = 0;
+    b.on_str([&] (str_msg &m) {
+        CHECK(m.arg == (uint32_t)got);
+        got++;
+    });
+
+    flounder::owned_string first = flounder::owned_string::copy("first");
+    flounder::owned_string second = flounder::owned_string::copy("second");
+    CHECK_ERR(b.str(0, std::move(first)), "send first");
+    CHECK(b.tx_busy());
+
+    // the second send fails and leaves the string with us
+    errval_t err = b.str(1, std::move(second));
+    CHECK(err_no(err) == FLOUNDER_ERR_TX_BUSY);
+    CHECK(second.view() == "second");
+
+    CHECK_ERR(b.wait_sent(), "wait_sent");
+    CHECK_ERR(b.str(1, std::move(second)), "send second");
+    while (got < 2) {
+        CHECK_ERR(event_dispatch(get_default_waitset()), "event_dispatch");
+    }
+}
+
+static void run_client(void)
+{
+    iref_t iref;
+    CHECK_ERR(nameservice_blocking_lookup(service_name, &iref),
+              "nameservice_blocking_lookup failed");
+
+    struct test_binding *cb = NULL;
+    CHECK_ERR(test_bind(iref, bind_cb, &cb, get_default_waitset(),
+                        (idc_bind_flags_t)IDC_BIND_FLAGS_DEFAULT),
+              "bind failed");
+    while (cb == NULL) {
+        CHECK_ERR(event_dispatch(get_default_waitset()), "event_dispatch");
+    }
+
+    binding b(cb);
+    test_basic(b);
+    test_str(b);
+    test_buf(b);
+    test_busy(b);
+    CHECK_ERR(b.wait_sent(), "wait_sent");
+
+    printf("Tests done: SUCCESS\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && strcmp(argv[1], "client") == 0) {
+        run_client();
+    } else if (argc == 2 && strcmp(argv[1], "server") == 0) {
+        run_server();
+    } else {
+        printf("Usage: %s client|server\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
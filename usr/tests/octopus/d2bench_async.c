@@ -0,0 +1,127 @@
+/**
+ * \file
+ * \brief Benchmark get/set throughput of pipelined asynchronous calls.
+ *
+ * Issues a fixed number of get or set calls through the asynchronous octopus
+ * API, keeping up to <window> calls outstanding, and compares the throughput
+ * with the same number of blocking calls.
+ */
+
+/*
+ * Copyright (c) 2015, ETH Zurich.
+ * All rights reserved.
+ *
+ * This file is distributed under the terms in the attached LICENSE file.
+ * If you do not find this file, copies can be found by writing to:
+ * ETH Zurich D-INFK, Universitaetsstrasse 6, CH-8092 Zurich. Attn: Systems Group.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+#include <barrelfish/barrelfish.h>
+#include <bench/bench.h>
+#include <octopus/octopus.h>
+
+#define ITERATIONS 10000
+
+static size_t windows[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+static size_t completed;
+
+static void call_done(void *st, errval_t err, char *record)
+{
+    if (err_is_fail(err)) {
+        USER_PANIC_ERR(err, "asynchronous call failed");
+    }
+    free(record);
+    completed++;
+}
+
+static errval_t issue(bool get, char *record)
+{
+    if (get) {
+        return oct_get_async(call_done, NULL, "rec");
+    } else {
+        return oct_mset_async(call_done, NULL, SET_DEFAULT, "%s", record);
+    }
+}
+
+static void run_blocking(bool get, char *record)
+{
+    errval_t err;
+    char *reply;
+
+    cycles_t start = bench_tsc();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        if (get) {
+            err = oct_get(&reply, "rec");
+            free(reply);
+        } else {
+            err = oct_set("%s", record);
+        }
+        assert(err_is_ok(err));
+    }
+    cycles_t cycles = bench_tsc() - start;
+
+    uint64_t ms = bench_tsc_to_ms(cycles);
+    printf("blocking  %3s window %3d %10"PRIuCYCLES" cycles/call %8"PRIu64
+           " calls/s\n", get ? "get" : "set", 1, cycles / ITERATIONS,
+           ms > 0 ? (uint64_t)ITERATIONS * 1000 / ms : 0);
+}
+
+static void run_async(bool get, char *record, size_t window)
+{
+    errval_t err;
+
+    completed = 0;
+    cycles_t start = bench_tsc();
+    for (size_t i = 0; i < ITERATIONS; i++) {
+        // keep at most window calls in flight
+        err = oct_async_wait(window - 1);
+        assert(err_is_ok(err));
+
+        err = issue(get, record);
+        assert(err_is_ok(err));
+    }
+    err = oct_async_wait(0);
+    assert(err_is_ok(err));
+    cycles_t cycles = bench_tsc() - start;
+    assert(completed == ITERATIONS);
+
+    uint64_t ms = bench_tsc_to_ms(cycles);
+    printf("pipelined %3s window %3zu %10"PRIuCYCLES" cycles/call %8"PRIu64
+           " calls/s\n", get ? "get" : "set", window, cycles / ITERATIONS,
+           ms > 0 ? (uint64_t)ITERATIONS * 1000 / ms : 0);
+}
+
+/**
+ * Usage: d2bench_async <get|set>
+ */
+int main(int argc, char** argv)
+{
+    assert(argc > 1);
+    bool get = strcmp(argv[1], "get") == 0;
+    if (!get && strcmp(argv[1], "set") != 0) {
+        assert(!"Invalid argv[1]");
+    }
+
+    oct_init();
+    bench_init();
+
+    char payload[256] = { [0 ... 254] = 'a', [255] = '\0' };
+    char record[300];
+    sprintf(record, "rec { attr: '%s' }", payload);
+
+    errval_t err = oct_set(record);
+    assert(err_is_ok(err));
+
+    run_blocking(get, record);
+    for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+        run_async(get, record, windows[i]);
+    }
+
+    return EXIT_SUCCESS;
+}